@@ -14,6 +14,7 @@
 * 				"WF" - write File
 * 				"PL" - Print Log
 *				"RFID" - Read message from file by id
+*				"SF" - Search File
 *
 * 				Examples:
 * 				"M:RS:2" - Regular message that will read string in index 2
@@ -23,6 +24,22 @@
 * 				"M:WF <target_file_name> <msg_id> <msg>" - Regular message with id that write into target file
 * 				"M:PL <file_name>" - Regular message that will print log file to screen
 * 				"M:RFID <file name> <msg id> - Regular message that will search message in file according to id and print to screen
+* 				"M:SF <file name> <pattern>" - Regular message that will print all lines of file that contain the pattern
+* 				"M:SF <file name> id:<from>-<to>" - Regular message that will print all messages of file with id in range
+*
+* 				Content of regular message is JSON, or binary if client and server
+* 				negotiated it on connect (gsi_is_network_tcp_client_hello()):
+* 				[0]		message type (1 byte)
+* 				[1]		op code (1 byte)
+* 				[2-3]	port (little endian)
+* 				index, data length, file length - zigzag varints (7 bits per byte, low first)
+* 				file name, data - varint of length + 1 (0 for null), the chars and '\0'
+*
+* 				Batch (GSI_BATCH_MSG) carries up to GSI_IS_MAX_BATCH regular messages in one frame:
+* 				JSON - array of the message objects: [{...},{...}]
+* 				binary - varint of count, then per message varint of length and the message
+* 				Server answers with GSI_BATCH_REPLY_MSG - result per message, in the same order
+* 				(0 - done, 1 - failed): JSON - [0,1,0], binary - varint of count, then byte per result
 *****************************************************************************/
 #ifndef GSI_BUILD_PARSE_DATA_H_
 #define GSI_BUILD_PARSE_DATA_H_
@@ -35,12 +52,35 @@
 #define 	GSI_IS_HEART_BEAT      'H'
 #define 	GSI_IS_MESSAGE	       'M'
 #define 	GSI_IS_COMMENT	       '#'
-#define 	GSI_IS_READ_STR        "RS"
-#define 	GSI_IS_WRITE_STR       "WS"
-#define		GSI_IS_READ_FILE       "RF"
-#define 	GSI_IS_WRITE_FILE  	   "WF"
-#define 	GSI_IS_PRINT_LOG  	   "PL"
-#define		GSI_IS_READ_FILE_BY_ID "RFID"
+#define 	GSI_IS_MAX_BATCH	   64	/* max messages in one batch frame */
+#define 	GSI_IS_BATCH_REPLY_MSECS 10000	/* client waits for the results of batch */
+#define 	GSI_IS_FRAME_HEADER_LEN	 (sizeof(struct gsi_cs_tcp_message) - sizeof(char*))	/* header on the wire */
+
+// Packed tag of up to 4 chars ('\0' for unused), so tags are compared as one number
+#define 	GSI_IS_TAG(c0, c1, c2, c3) \
+			((unsigned int)(unsigned char)(c0) | ((unsigned int)(unsigned char)(c1) << 8) | \
+			 ((unsigned int)(unsigned char)(c2) << 16) | ((unsigned int)(unsigned char)(c3) << 24))
+
+/*****************************************************************************
+ * Name : GSI_IS_OP_CODES
+ * Description: Schema of op codes - the op code enum, tags of messages file,
+ * 				op strings and per op code fields are all made from it.
+ * 				Op codes are numbered in this order (on wire - do not reorder).
+ * 				Message type, op code and port are used by every op code,
+ * 				the strings an op code uses must be in its message.
+ * 				X(op code, tag chars in messages file, op string, used fields)
+ *****************************************************************************/
+#define 	GSI_IS_OP_CODES(X) \
+	X(GSI_READ_STR,        'R', 'S', 0,   0,   "READ_STR",       GSI_FIELD_INDEX) \
+	X(GSI_WRITE_STR,       'W', 'S', 0,   0,   "WRITE_STR",      GSI_FIELD_INDEX | GSI_FIELD_DATA_LEN | GSI_FIELD_DATA) \
+	X(GSI_READ_FILE,       'R', 'F', 0,   0,   "READ_FILE",      GSI_FIELD_FILE_LEN | GSI_FIELD_FILE_NAME) \
+	X(GSI_WRITE_FILE,      'W', 'F', 0,   0,   "WRITE_FILE",     GSI_FIELDS_FILE_AND_DATA) \
+	X(GSI_PRINT_LOG,       'P', 'L', 0,   0,   "PRINT_LOG",      GSI_FIELD_FILE_LEN | GSI_FIELD_FILE_NAME) \
+	X(GSI_READ_FILE_BY_ID, 'R', 'F', 'I', 'D', "READ_STR_BY_ID", GSI_FIELDS_FILE_AND_DATA) \
+	X(GSI_SEARCH_FILE,     'S', 'F', 0,   0,   "SEARCH_FILE",    GSI_FIELDS_FILE_AND_DATA)
+
+#define 	GSI_FIELDS_FILE_AND_DATA \
+			(GSI_FIELD_FILE_LEN | GSI_FIELD_FILE_NAME | GSI_FIELD_DATA_LEN | GSI_FIELD_DATA)
 
 /* Structures */
 /*****************************************************************************
@@ -63,6 +103,11 @@
  *		char* s_file_name	  - file name to read from / write to
  *----------------------------------------------------------------------------
  *		char* s_data		  - message content
+ *----------------------------------------------------------------------------
+ *		char* p_recv_buf	  - received message the strings may point into (views),
+ *								owned by json-msg until gsi_build_parse_reset_object()
+ *----------------------------------------------------------------------------
+ *		int i_views			  - strings that are views into p_recv_buf (gsi_is_json_view)
  *****************************************************************************/
 struct gsi_json_msg
 {
@@ -74,8 +119,53 @@ struct gsi_json_msg
 	int i_file_len;
 	char* s_file_name;
 	char* s_data;
+	char* p_recv_buf;
+	int i_views;
 };
 
+/*****************************************************************************
+ * Name : gsi_json_batch
+ * Used by:	Server - received frame of messages (batch, or regular message as batch of one)
+ * Members:
+ *----------------------------------------------------------------------------
+ *		char* p_recv_buf	  - received frame content, the messages are decoded in it
+ *----------------------------------------------------------------------------
+ *		size_t ul_len		  - length of content
+ *----------------------------------------------------------------------------
+ *		size_t ul_pos		  - offset of next message in content
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_encoding - encoding of the connection (gsi_is_encoding)
+ *----------------------------------------------------------------------------
+ *		int i_type_msg		  - GSI_REGULAR_MSG *OR* GSI_BATCH_MSG
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_left  - max messages left to take: count of binary batch,
+ *								GSI_IS_MAX_BATCH for JSON batch, 1 for regular message
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_count - messages taken so far (results of reply)
+ *----------------------------------------------------------------------------
+ *		unsigned char a_results[GSI_IS_MAX_BATCH] - result of each message taken
+ *****************************************************************************/
+struct gsi_json_batch
+{
+	char* p_recv_buf;
+	size_t ul_len;
+	size_t ul_pos;
+	unsigned int ui_encoding;
+	int i_type_msg;
+	unsigned int ui_left;
+	unsigned int ui_count;
+	unsigned char a_results[GSI_IS_MAX_BATCH];
+};
+
+/* Typedef */
+/***************************************************************************
+ * Name:		gsi_is_frame_func
+ * Description: Called by gsi_is_read_all_frames() for each frame of messages
+ * 				(p_arg is given by the caller).
+ * 				Returns GSI_JSON_SUCCESS to continue, anything else stops the read.
+ ***************************************************************************/
+typedef int (*gsi_is_frame_func)(struct gsi_json_msg* p_json_msgs, int i_count, void* p_arg);
+
 /* Enums */
 /***************************************************************************
  * Name:		gsi_is_json_rc
@@ -88,21 +178,43 @@ enum gsi_is_json_rc
 	GSI_JSON_INVALID_ERR,
 	GSI_JSON_OPEN_ERR,
 	GSI_JSON_CLOSE_ERR,
-	GSI_JSON_READ_ERROR
+	GSI_JSON_READ_ERROR,
+	GSI_JSON_UNKNOWN_LAYOUT
+};
+
+/***************************************************************************
+ * Name:		gsi_is_json_view
+ * Description: Flags of json-msg strings that point into the received message
+ * 				(are not allocated by themselves and MUST NOT be freed)
+ ***************************************************************************/
+enum gsi_is_json_view
+{
+	GSI_JSON_VIEW_FILE_NAME = 0x1,
+	GSI_JSON_VIEW_DATA		= 0x2
+};
+
+/***************************************************************************
+ * Name:		gsi_is_json_field
+ * Description: Fields of json-msg an op code uses (see GSI_IS_OP_CODES)
+ ***************************************************************************/
+enum gsi_is_json_field
+{
+	GSI_FIELD_INDEX 	= 0x1,
+	GSI_FIELD_DATA_LEN  = 0x2,
+	GSI_FIELD_FILE_LEN  = 0x4,
+	GSI_FIELD_FILE_NAME = 0x8,
+	GSI_FIELD_DATA 		= 0x10
 };
 
 /***************************************************************************
  * Name:		gsi_is_op_codes_parse_build
- * Description: Operations Code to send between client and server
+ * Description: Operations Code to send between client and server (GSI_IS_OP_CODES)
  ***************************************************************************/
+#define 	GSI_IS_OP_CODE_ENUM(op, c0, c1, c2, c3, s_op, ui_fields) op,
+
 enum gsi_is_op_codes_parse_build
 {
-	GSI_READ_STR,
-	GSI_WRITE_STR,
-	GSI_READ_FILE,
-	GSI_WRITE_FILE,
-	GSI_PRINT_LOG,
-	GSI_READ_FILE_BY_ID
+	GSI_IS_OP_CODES(GSI_IS_OP_CODE_ENUM)
 };
 
 
@@ -132,6 +244,7 @@ enum gsi_is_json_rc gsi_is_close_msg_file(FILE* f_msg_file);
 /*###########################################################################
 	 * Name:		gsi_build_parse_reset_object
 	 * Description: Reset all the fields of struct gsi_json_msg
+	 * 				(free its strings and the received message they point into)
 	 * Parameter:   [in-out] struct gsi_json_msg* p_json_msg - pointer to reset
 	 * Return:		Success - GSI_JSON_SUCCESS
 	 * 				Failure - GSI_JSON_INVALID_ERR
@@ -141,18 +254,139 @@ enum gsi_is_json_rc gsi_build_parse_reset_object(struct gsi_json_msg* p_json_msg
 
 /*###########################################################################
 	 * Name:		gsi_is_send_all_json_msg
-	 * Description: Send all messages that exist in f_msg_file
+	 * Description: Send all messages that exist in f_msg_file.
+	 * 				With i_batch_size > 1 regular messages are sent in batches of up to
+	 * 				i_batch_size (GSI_IS_MAX_BATCH at most), a heartbeat ends the batch before it.
 	 * Parameter:   [in] FILE* f_msg_file - handler to opened file
 	 * Parameter:   [in] struct gsi_net_tcp* p_client - client that wants to send the messages
+	 * Parameter:   [in] int i_batch_size - max messages in one frame (1 - no batches)
+	 * Return :		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_send_all_json_msg(FILE* f_msg_file, struct gsi_net_tcp* p_client, int i_batch_size);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_read_all_frames
+	 * Description: Read all messages that exist in f_msg_file and pass them to p_frame_func
+	 * 				frame by frame, as gsi_is_send_all_json_msg() sends them:
+	 * 				with i_batch_size > 1 regular messages are passed in batches of up to
+	 * 				i_batch_size (GSI_IS_MAX_BATCH at most), a heartbeat ends the batch before it.
+	 * 				The messages are reset after p_frame_func returns.
+	 * Parameter:   [in] FILE* f_msg_file - handler to opened file
+	 * Parameter:   [in] int i_batch_size - max messages in one frame (1 - no batches)
+	 * Parameter:   [in] gsi_is_frame_func p_frame_func - called for each frame
+	 * Parameter:   [in] void* p_arg - passed to p_frame_func
 	 * Return :		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR (bad file or p_frame_func failed) *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_read_all_frames(FILE* f_msg_file, int i_batch_size,
+										   gsi_is_frame_func p_frame_func, void* p_arg);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_frame_bound
+	 * Description: Max bytes gsi_is_encode_frame() writes for the messages
+	 * Parameter:   [in] const struct gsi_json_msg* p_json_msgs - messages of frame
+	 * Parameter:   [in] int i_count - number of messages (1 to GSI_IS_MAX_BATCH)
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Return:		Bytes of header and content at most
+#############################################################################*/
+size_t gsi_is_frame_bound(const struct gsi_json_msg* p_json_msgs, int i_count, unsigned int ui_encoding);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_encode_frame
+	 * Description: Write a ready to send frame - header of struct gsi_cs_tcp_message
+	 * 				and the content right after it.
+	 * 				One message is a frame of its own type (heartbeat is header only),
+	 * 				more messages are one GSI_BATCH_MSG frame.
+	 * Parameter:   [out] char* p_out - buffer of gsi_is_frame_bound() bytes
+	 * Parameter:   [in-out] struct gsi_json_msg* p_json_msgs - messages of frame (port is set)
+	 * Parameter:   [in] int i_count - number of messages (1 to GSI_IS_MAX_BATCH)
+	 * Parameter:   [in] unsigned int ui_port - port of header
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Return:		Bytes written (header and content)
+#############################################################################*/
+size_t gsi_is_encode_frame(char* p_out, struct gsi_json_msg* p_json_msgs, int i_count,
+						   unsigned int ui_port, unsigned int ui_encoding);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_batch_frame_bound
+	 * Description: Max bytes gsi_is_encode_batch_frame() writes for the messages
+	 * Parameter:   [in] const struct gsi_json_msg* p_json_msgs - messages of frame
+	 * Parameter:   [in] int i_count - number of messages (1 to GSI_IS_MAX_BATCH)
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Return:		Bytes of header and content at most
+#############################################################################*/
+size_t gsi_is_batch_frame_bound(const struct gsi_json_msg* p_json_msgs, int i_count, unsigned int ui_encoding);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_encode_batch_frame
+	 * Description: Write a ready to send GSI_BATCH_MSG frame, even of one message -
+	 * 				every frame is answered by GSI_BATCH_REPLY_MSG (e.g. to time it).
+	 * Parameter:   [out] char* p_out - buffer of gsi_is_batch_frame_bound() bytes
+	 * Parameter:   [in-out] struct gsi_json_msg* p_json_msgs - regular messages of frame (port is set)
+	 * Parameter:   [in] int i_count - number of messages (1 to GSI_IS_MAX_BATCH)
+	 * Parameter:   [in] unsigned int ui_port - port of header
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Return:		Bytes written (header and content)
+#############################################################################*/
+size_t gsi_is_encode_batch_frame(char* p_out, struct gsi_json_msg* p_json_msgs, int i_count,
+								 unsigned int ui_port, unsigned int ui_encoding);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_send_batch_msg
+	 * Description: Send regular messages from client to server in one batch frame
+	 * 				(encoded straight into the send buffer of the client),
+	 * 				and wait up to GSI_IS_BATCH_REPLY_MSECS for the results.
+	 * 				One message is sent alone (regular message has no reply to wait for).
+	 * Parameter:   [in] struct gsi_net_tcp* p_client - client that wants to send the messages
+	 * Parameter:   [in] struct gsi_json_msg* p_json_msgs - messages to send
+	 * Parameter:   [in] int i_count - number of messages (1 to GSI_IS_MAX_BATCH)
+	 * Return:		Success - GSI_JSON_SUCCESS (messages that failed on server are logged)
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_send_batch_msg(struct gsi_net_tcp* p_client, struct gsi_json_msg* p_json_msgs, int i_count);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_recv_batch_reply
+	 * Description: Wait up to GSI_IS_BATCH_REPLY_MSECS for the results of batch
+	 * 				and log the messages that failed
+	 * Parameter:   [in] struct gsi_net_tcp* p_client - client that sent the batch
+	 * Parameter:   [in] int i_count - number of messages in batch
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR (no reply, or reply doesn't match the batch)
+	 * 						  *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_recv_batch_reply(struct gsi_net_tcp* p_client, int i_count);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_decode_batch_reply
+	 * Description: Read results of batch written by gsi_is_send_batch_reply()
+	 * 				(content of GSI_BATCH_REPLY_MSG, e.g. read by an event loop)
+	 * Parameter:   [in] const char* p_reply - reply content ('\0' after it)
+	 * Parameter:   [in] size_t ul_len - length of content
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Parameter:   [out] unsigned char* p_results - GSI_IS_MAX_BATCH results
+	 * Parameter:   [out] unsigned int* p_count - number of results
+	 * Return:		Success - GSI_JSON_SUCCESS
 	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
 #############################################################################*/
-enum gsi_is_json_rc gsi_is_send_all_json_msg(FILE* f_msg_file, struct gsi_net_tcp* p_client);
+enum gsi_is_json_rc gsi_is_decode_batch_reply(const char* p_reply, size_t ul_len, unsigned int ui_encoding,
+											  unsigned char* p_results, unsigned int* p_count);
 
 
 /*###########################################################################
 	 * Name:		gsi_is_send_json_msg
-	 * Description: Send one message from client to server
+	 * Description: Send one message from client to server.
+	 * 				The message is encoded as compact JSON (or binary, if negotiated)
+	 * 				straight into the send buffer of the client (no json object, no copies).
 	 * Parameter:   [in] struct gsi_net_tcp* p_client - client that wants to send the message
 	 * Parameter:   [in] struct gsi_json_msg* p_json_msg - pointer to message structure
 	 * Return:		Success - GSI_JSON_SUCCESS
@@ -164,6 +398,9 @@ enum gsi_is_json_rc gsi_is_send_json_msg(struct gsi_net_tcp* p_client, struct gs
 /*###########################################################################
 	 * Name:		gsi_is_recv_json_msg
 	 * Description: Receive one message on listening port, and make operation according to the OP_CODE
+	 * 				The content is converted by gsi_is_decode_msg() with the encoding of connection:
+	 * 				p_json_msg takes the received message and its strings point into it
+	 * 				until gsi_build_parse_reset_object() (no copy of data / file name).
 	 * Parameter:   [in] struct gsi_net_tcp* p_server - server that listen to port
 	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to message structure
 	 * Return:		Success - GSI_JSON_SUCCESS
@@ -172,6 +409,116 @@ enum gsi_is_json_rc gsi_is_send_json_msg(struct gsi_net_tcp* p_client, struct gs
 enum gsi_is_json_rc gsi_is_recv_json_msg(struct gsi_net_tcp* p_server, struct gsi_json_msg* p_json_msg);
 
 
+/*###########################################################################
+	 * Name:		gsi_is_recv_batch_msg
+	 * Description: Receive one frame on listening port - batch, or regular message as batch of one.
+	 * 				The messages are taken by gsi_is_batch_next_msg(). MUST be reset by
+	 * 				gsi_is_batch_reset() (after the last message taken was reset).
+	 * Parameter:   [in] struct gsi_net_tcp* p_server - server that listen to port
+	 * Parameter:   [out] struct gsi_json_batch* p_batch - batch to fill
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_recv_batch_msg(struct gsi_net_tcp* p_server, struct gsi_json_batch* p_batch);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_batch_next_msg
+	 * Description: Decode the next message of batch in place (as gsi_is_recv_json_msg()),
+	 * 				the strings are views into the batch. Its result is "done" until
+	 * 				gsi_is_batch_set_result(), or "failed" if it couldn't be decoded.
+	 * Parameter:   [in] struct gsi_json_batch* p_batch - received batch
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR (bad message, the next ones may be taken)
+	 * 						  *OR* GSI_JSON_READ_ERROR (no more messages) *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_batch_next_msg(struct gsi_json_batch* p_batch, struct gsi_json_msg* p_json_msg);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_batch_set_result
+	 * Description: Set result of the last message taken by gsi_is_batch_next_msg()
+	 * Parameter:   [in] struct gsi_json_batch* p_batch - received batch
+	 * Parameter:   [in] int i_failed - 0 if the message was done
+	 * Return:		None
+#############################################################################*/
+void gsi_is_batch_set_result(struct gsi_json_batch* p_batch, int i_failed);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_send_batch_reply
+	 * Description: Send the results of the messages taken from batch to the client
+	 * 				(GSI_BATCH_REPLY_MSG). Regular message has no reply.
+	 * Parameter:   [in] struct gsi_net_tcp* p_server - server that received the batch
+	 * Parameter:   [in] struct gsi_json_batch* p_batch - received batch
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_send_batch_reply(struct gsi_net_tcp* p_server, struct gsi_json_batch* p_batch);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_batch_reset
+	 * Description: Free the received frame and reset all the fields of batch
+	 * Parameter:   [in-out] struct gsi_json_batch* p_batch - batch to reset
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_INVALID_ERR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_batch_reset(struct gsi_json_batch* p_batch);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_parse_json_msg
+	 * Description: Convert message content to json-msg object.
+	 * 				Messages of the known layout are parsed in one pass without json-c
+	 * 				(long ones with structural index), others fall back to json-c.
+	 * Parameter:   [in] const char* s_json - message content ('\0' terminated)
+	 * Parameter:   [in] size_t ul_len - length of message content
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_parse_json_msg(const char* s_json, size_t ul_len, struct gsi_json_msg* p_json_msg);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_encode_bound
+	 * Description: Upper bound of encoded message content length
+	 * Parameter:   [in] const struct gsi_json_msg* p_json_msg - message to encode
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Return:		Max number of bytes gsi_is_encode_msg() writes
+#############################################################################*/
+size_t gsi_is_encode_bound(const struct gsi_json_msg* p_json_msg, unsigned int ui_encoding);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_encode_msg
+	 * Description: Encode message content (JSON is ended with '\0')
+	 * Parameter:   [out] char* p_out - buffer of gsi_is_encode_bound() bytes at least
+	 * Parameter:   [in] const struct gsi_json_msg* p_json_msg - message to encode
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Return:		Number of bytes written
+#############################################################################*/
+size_t gsi_is_encode_msg(char* p_out, const struct gsi_json_msg* p_json_msg, unsigned int ui_encoding);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_decode_msg
+	 * Description: Decode message content in place - the strings of p_json_msg
+	 * 				are views into p_buf (it must live until gsi_build_parse_reset_object()).
+	 * 				JSON strings are decoded over p_buf, binary ones are used as is.
+	 * Parameter:   [in] char* p_buf - message content (written by JSON decode)
+	 * Parameter:   [in] size_t ul_len - length of content (with the '\0' of JSON)
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_decode_msg(char* p_buf, size_t ul_len, unsigned int ui_encoding,
+									  struct gsi_json_msg* p_json_msg);
+
+
 /*###########################################################################
 	 * Name:		gsi_is_get_next_msg
 	 * Description:	Get the next message in f_msg_file
@@ -9,12 +9,191 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 #include <json-c/json.h>
 #include "gsi_is_log_api.h"
+#include "gsi_json_index.h"
 #include "gsi_build_parse_data.h"
 
 /* Defines and Macros */
 #define 	GSI_IS_BUFFER_SIZE    1024
+#define 	GSI_IS_JSON_ESC_LEN	  6			/* worst case of one escaped char "\u00XX" */
+
+#define 	GSI_IS_MAX_INT_DIGITS 18		/* longer numbers are left to json-c */
+#define 	GSI_IS_JSON_INDEX_MIN_LEN 512	/* longer messages are scanned by structural index */
+
+#define 	GSI_IS_MAX_TAG_LEN	  4			/* op code tag in messages file */
+#define 	GSI_IS_BIN_VARINT_LEN 5			/* max bytes of 32 bits varint */
+
+/*****************************************************************************
+ * Name : GSI_IS_MSG_FIELDS
+ * Description: Schema of message fields - the keys, the JSON and binary codecs,
+ * 				the key lookup and filling json-msg by op code (GSI_IS_OP_CODES)
+ * 				are all made from it. Fields are encoded in this order.
+ * 				The first 2 chars of key and its length make its packed tag.
+ * 				X(key, JSON key, first 2 chars of key, value type, member of json-msg,
+ * 				  binary kind, field flag (0 - used by every op code))
+ *****************************************************************************/
+#define 	GSI_IS_MSG_FIELDS(X) \
+	X(GSI_KEY_MSG_TYPE,  "Message Type", 'M', 'e', INT,    i_msg_type,  U8,     0) \
+	X(GSI_KEY_OP_CODE,   "Op-Code",      'O', 'p', INT,    i_op_code,   U8,     0) \
+	X(GSI_KEY_OP_STR,    "Op-Str",       'O', 'p', OP_STR, i_op_code,   NONE,   0) \
+	X(GSI_KEY_PORT,      "Port",         'P', 'o', INT,    ui_port,     U16,    0) \
+	X(GSI_KEY_INDEX,     "Index",        'I', 'n', INT,    i_index,     VARINT, GSI_FIELD_INDEX) \
+	X(GSI_KEY_DATA_LEN,  "Data Length",  'D', 'a', INT,    i_data_len,  VARINT, GSI_FIELD_DATA_LEN) \
+	X(GSI_KEY_FILE_LEN,  "File Length",  'F', 'i', INT,    i_file_len,  VARINT, GSI_FIELD_FILE_LEN) \
+	X(GSI_KEY_FILE_NAME, "File Name",    'F', 'i', STRING, s_file_name, STRING, GSI_FIELD_FILE_NAME) \
+	X(GSI_KEY_DATA,      "Data",         'D', 'a', STRING, s_data,      STRING, GSI_FIELD_DATA)
+
+// Packed tag of key - its length and first 2 chars
+#define 	GSI_IS_KEY_TAG(c0, c1, ul_len)	GSI_IS_TAG((c0), (c1), (ul_len), 0)
+
+// Value type of each schema type
+#define 	GSI_IS_VALUE_TYPE_INT	 GSI_VALUE_INT
+#define 	GSI_IS_VALUE_TYPE_STRING GSI_VALUE_STRING
+#define 	GSI_IS_VALUE_TYPE_OP_STR GSI_VALUE_STRING
+
+// Max encoded length of value of each schema type (JSON / binary, without string chars)
+#define 	GSI_IS_JSON_MAX_INT		 20
+#define 	GSI_IS_JSON_MAX_STRING	 sizeof("null")
+#define 	GSI_IS_JSON_MAX_OP_STR	 (2 + GSI_IS_OP_CODES(GSI_IS_OP_STR_SIZE) 0)
+#define 	GSI_IS_BIN_MAX_U8		 1
+#define 	GSI_IS_BIN_MAX_U16		 2
+#define 	GSI_IS_BIN_MAX_VARINT	 GSI_IS_BIN_VARINT_LEN
+#define 	GSI_IS_BIN_MAX_STRING	 (GSI_IS_BIN_VARINT_LEN + 1)
+#define 	GSI_IS_BIN_MAX_NONE		 0
+
+// Keys, numbers and op string of encoded message - '{', '}' and per field "<KEY>":<VALUE>,
+#define 	GSI_IS_JSON_FIXED_LEN	 (2 + GSI_IS_MSG_FIELDS(GSI_IS_JSON_FIELD_SIZE) 0)
+#define 	GSI_IS_BIN_FIXED_LEN	 (GSI_IS_MSG_FIELDS(GSI_IS_BIN_FIELD_SIZE) 0)
+
+#define 	GSI_IS_OP_STR_SIZE(op, c0, c1, c2, c3, s_op, ui_fields) 	sizeof(s_op) +
+#define 	GSI_IS_JSON_FIELD_SIZE(key, s_key, c0, c1, type, member, bin, ui_field) \
+			(sizeof(s_key) + 3 + GSI_IS_JSON_MAX_##type) +
+#define 	GSI_IS_BIN_FIELD_SIZE(key, s_key, c0, c1, type, member, bin, ui_field) \
+			GSI_IS_BIN_MAX_##bin +
+
+// Map signed int to unsigned so small negative numbers are short varints too
+#define 	GSI_IS_ZIGZAG(i)	  ((((unsigned int)(i)) << 1) ^ (unsigned int)((i) >> 31))
+#define 	GSI_IS_UNZIGZAG(ui)	  ((int)(((ui) >> 1) ^ (~((ui) & 1) + 1)))
+
+// Copy string literal to output pointer and move it forward
+#define 	GSI_IS_JSON_PUT_LITERAL(p_out, s_lit) \
+			do { memcpy((p_out), (s_lit), sizeof(s_lit) - 1); (p_out) += sizeof(s_lit) - 1; } while (0)
+
+// JSON white space
+#define 	GSI_IS_JSON_IS_WS(c) ((' ' == (c)) || ('\n' == (c)) || ('\r' == (c)) || ('\t' == (c)))
+
+/* Enums */
+/***************************************************************************
+ * Name:		gsi_build_parse_key
+ * Description: Keys of message JSON (index in parsed values)
+ ***************************************************************************/
+#define 	GSI_IS_KEY_ENUM(key, s_key, c0, c1, type, member, bin, ui_field) key,
+
+enum gsi_build_parse_key
+{
+	GSI_IS_MSG_FIELDS(GSI_IS_KEY_ENUM)
+	GSI_KEY_COUNT
+};
+
+/***************************************************************************
+ * Name:		gsi_build_parse_value_type
+ * Description: Type of parsed value (missing key is like null)
+ ***************************************************************************/
+enum gsi_build_parse_value_type
+{
+	GSI_VALUE_MISSING,
+	GSI_VALUE_NULL,
+	GSI_VALUE_INT,
+	GSI_VALUE_STRING
+};
+
+/* Structures */
+/*****************************************************************************
+ * Name : gsi_build_parse_key_entry
+ * Used by: gsi_build_parse_find_key()
+ * Members:
+ *----------------------------------------------------------------------------
+ *		const char* s_name	- key as written in message
+ *----------------------------------------------------------------------------
+ *		size_t ul_len		- length of s_name
+ *----------------------------------------------------------------------------
+ *		int i_key			- one of gsi_build_parse_key
+ *----------------------------------------------------------------------------
+ *		int i_type			- expected value type (or null)
+ *****************************************************************************/
+struct gsi_build_parse_key_entry
+{
+	const char* s_name;
+	size_t ul_len;
+	int i_key;
+	int i_type;
+};
+
+/*****************************************************************************
+ * Name : gsi_build_parse_value
+ * Used by: gsi_build_parse_fast_parse_object()
+ * Members:
+ *----------------------------------------------------------------------------
+ *		int i_type			- one of gsi_build_parse_value_type
+ *----------------------------------------------------------------------------
+ *		int i_value			- value of number
+ *----------------------------------------------------------------------------
+ *		const char* p_str	- start of string in message (after the '"')
+ *----------------------------------------------------------------------------
+ *		size_t ul_len		- length of string as written in message
+ *----------------------------------------------------------------------------
+ *		int i_escaped		- string has escape sequences to decode
+ *****************************************************************************/
+struct gsi_build_parse_value
+{
+	int i_type;
+	int i_value;
+	const char* p_str;
+	size_t ul_len;
+	int i_escaped;
+};
+
+/*****************************************************************************
+ * Name : gsi_build_parse_fast_ctx
+ * Used by: gsi_build_parse_fast_parse()
+ * Members:
+ *----------------------------------------------------------------------------
+ *		const char* s_json			- message content
+ *----------------------------------------------------------------------------
+ *		struct gsi_json_index index	- offsets of quotes and structural chars
+ *----------------------------------------------------------------------------
+ *		size_t ul_next				- next offset in index to look at
+ *----------------------------------------------------------------------------
+ *		int i_indexed				- index was built (long message)
+ *----------------------------------------------------------------------------
+ *		int i_in_place				- decode strings into the message itself (views)
+ *****************************************************************************/
+struct gsi_build_parse_fast_ctx
+{
+	const char* s_json;
+	struct gsi_json_index index;
+	size_t ul_next;
+	int i_indexed;
+	int i_in_place;
+};
+
+/* Globals */
+#define 	GSI_IS_KEY_ENTRY(key, s_key, c0, c1, type, member, bin, ui_field) \
+			[key] = { s_key, sizeof(s_key) - 1, key, GSI_IS_VALUE_TYPE_##type },
+
+// Keys of message by gsi_build_parse_key
+static const struct gsi_build_parse_key_entry g_json_msg_keys[GSI_KEY_COUNT] = {
+	GSI_IS_MSG_FIELDS(GSI_IS_KEY_ENTRY)
+};
+
+#define 	GSI_IS_OP_FIELDS_ENTRY(op, c0, c1, c2, c3, s_op, ui_fields) [op] = (ui_fields),
+
+// Fields of json-msg each op code uses
+static const unsigned int g_op_code_fields[] = {
+	GSI_IS_OP_CODES(GSI_IS_OP_FIELDS_ENTRY)
+};
 
 /********************************/
 /* Static functions declaration */
@@ -26,14 +205,57 @@ static int gsi_build_parse_get_msg_op_code(char** s_line);
 static int gsi_build_parse_build_msg(char* s_line, struct gsi_json_msg* p_json_msg);
 static int gsi_build_parse_string_to_json_object(char *s_data, struct json_object** p_json);
 static int gsi_build_parse_set_op_code_args(char** s_line, struct gsi_json_msg* p_json_msg);
-static int gsi_build_parse_handle_op_code(struct json_object *p_json, struct gsi_json_msg* p_json_msg);
 static int gsi_build_parse_json_object_to_json_msg(struct json_object *p_json, struct gsi_json_msg* p_json_msg);
 
 static char* gsi_build_parse_op_code_to_string(int i_op_code);
+static int gsi_build_parse_get_op_fields(int i_op_code, unsigned int* p_fields);
 static char* gsi_build_parse_strdup(const char* s_src);
 static char* gsi_build_parse_get_file_name(char** s_line);
 static char* gsi_build_parse_get_msg_content(char** s_line);
-static char* gsi_build_parse_json_obj_to_string(struct json_object *p_json, struct gsi_json_msg* p_json_msg);
+
+static size_t gsi_build_parse_encode_bound(const struct gsi_json_msg* p_json_msg);
+static size_t gsi_build_parse_encode_json_msg(char* p_out, const struct gsi_json_msg* p_json_msg);
+static char* gsi_build_parse_encode_int(char* p_out, long l_value);
+static char* gsi_build_parse_encode_string(char* p_out, const char* s_str);
+
+static size_t gsi_build_parse_strings_len(const struct gsi_json_msg* p_json_msg);
+
+static size_t gsi_build_parse_encode_binary_msg(char* p_out, const struct gsi_json_msg* p_json_msg);
+static unsigned char* gsi_build_parse_encode_varint(unsigned char* p_out, unsigned int ui_value);
+static unsigned char* gsi_build_parse_encode_binary_string(unsigned char* p_out, const char* s_str);
+static int gsi_build_parse_decode_binary_msg(char* p_buf, size_t ul_len, struct gsi_json_msg* p_json_msg);
+static const unsigned char* gsi_build_parse_decode_fixed(const unsigned char* p_cur, const unsigned char* p_end,
+														 int i_bytes, struct gsi_build_parse_value* p_value);
+static const unsigned char* gsi_build_parse_decode_varint(const unsigned char* p_cur, const unsigned char* p_end,
+														  unsigned int* p_value);
+static const unsigned char* gsi_build_parse_decode_int(const unsigned char* p_cur, const unsigned char* p_end,
+													   struct gsi_build_parse_value* p_value);
+static const unsigned char* gsi_build_parse_decode_binary_string(const unsigned char* p_cur, const unsigned char* p_end,
+																 struct gsi_build_parse_value* p_value);
+
+static int gsi_build_parse_flush_batch(struct gsi_json_msg* p_json_msgs, int* p_count,
+									   gsi_is_frame_func p_frame_func, void* p_arg);
+static int gsi_build_parse_send_frame(struct gsi_json_msg* p_json_msgs, int i_count, void* p_arg);
+static int gsi_build_parse_encode_send(struct gsi_net_tcp* p_client, struct gsi_json_msg* p_json_msgs, int i_count);
+static char* gsi_build_parse_encode_json_batch(char* p_out, struct gsi_json_msg* p_json_msgs, int i_count);
+static char* gsi_build_parse_encode_binary_batch(char* p_out, struct gsi_json_msg* p_json_msgs, int i_count);
+static int gsi_build_parse_next_json_object(struct gsi_json_batch* p_batch, char** p_obj, size_t* p_obj_len);
+
+static int gsi_build_parse_convert_msg(const char* s_json, size_t ul_len, int i_in_place, struct gsi_json_msg* p_json_msg);
+
+static int gsi_build_parse_fast_parse(const char* s_json, size_t ul_len, int i_in_place, struct gsi_json_msg* p_json_msg);
+static int gsi_build_parse_fast_parse_object(struct gsi_build_parse_fast_ctx* p_ctx, struct gsi_json_msg* p_json_msg);
+static const struct gsi_build_parse_key_entry* gsi_build_parse_find_key(const char* p_key, size_t ul_len);
+static int gsi_build_parse_fill_msg(const struct gsi_build_parse_value* p_values, int i_in_place,
+									struct gsi_json_msg* p_json_msg);
+static void gsi_build_parse_free_strings(struct gsi_json_msg* p_json_msg, unsigned int ui_fields, int i_in_place);
+static char* gsi_build_parse_fast_get_string(const struct gsi_build_parse_value* p_value, int i_in_place);
+static const char* gsi_build_parse_fast_skip_ws(const char* p_cur);
+static const char* gsi_build_parse_fast_scan_int(const char* p_cur, int* p_value);
+static const char* gsi_build_parse_fast_scan_string(struct gsi_build_parse_fast_ctx* p_ctx, const char* p_cur,
+														struct gsi_build_parse_value* p_value);
+static const char* gsi_build_parse_fast_check_escape(const char* p_cur);
+static const char* gsi_build_parse_fast_scan_unicode(const char* p_cur, unsigned int* p_code);
 
 /**********************/
 /* API implementation */
@@ -95,6 +317,7 @@ enum gsi_is_json_rc gsi_is_close_msg_file(FILE* f_msg_file)
 /*###########################################################################
 	 * Name:		gsi_build_parse_reset_object
 	 * Description: Reset all the fields of struct gsi_json_msg
+	 * 				(free its strings and the received message they point into)
 	 * Parameter:   [in-out] struct gsi_json_msg* p_json_msg - pointer to reset
 	 * Return:		Success - GSI_JSON_SUCCESS
 	 * 				Failure - GSI_JSON_INVALID_ERR
@@ -108,18 +331,24 @@ enum gsi_is_json_rc gsi_build_parse_reset_object(struct gsi_json_msg* p_json_msg
 		return GSI_JSON_INVALID_ERR;
 	}
 
-	// Check if need to free s_file_name
-	if (NULL != p_json_msg->s_file_name)
+	// Check if need to free s_file_name (view is freed with the received message)
+	if ((NULL != p_json_msg->s_file_name) && !(GSI_JSON_VIEW_FILE_NAME & p_json_msg->i_views))
 	{
 		free(p_json_msg->s_file_name);
 	}
 
 	// Check if need to free s_data
-	if (NULL != p_json_msg->s_data)
+	if ((NULL != p_json_msg->s_data) && !(GSI_JSON_VIEW_DATA & p_json_msg->i_views))
 	{
 		free(p_json_msg->s_data);
 	}
 
+	// Check if need to free the received message
+	if (NULL != p_json_msg->p_recv_buf)
+	{
+		free(p_json_msg->p_recv_buf);
+	}
+
 	// Reset fields
 	memset(p_json_msg, 0, sizeof(struct gsi_json_msg));
 
@@ -128,35 +357,81 @@ enum gsi_is_json_rc gsi_build_parse_reset_object(struct gsi_json_msg* p_json_msg
 
 /*###########################################################################
 	 * Name:		gsi_is_send_all_json_msg
-	 * Description: Send all messages that exist in f_msg_file
+	 * Description: Send all messages that exist in f_msg_file.
+	 * 				With i_batch_size > 1 regular messages are sent in batches of up to
+	 * 				i_batch_size (GSI_IS_MAX_BATCH at most), a heartbeat ends the batch before it.
 	 * Parameter:   [in] FILE* f_msg_file - handler to opened file
 	 * Parameter:   [in] struct gsi_net_tcp* p_client - client that wants to send the messages
+	 * Parameter:   [in] int i_batch_size - max messages in one frame (1 - no batches)
 	 * Return :		Success - GSI_JSON_SUCCESS
 	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
 #############################################################################*/
-enum gsi_is_json_rc gsi_is_send_all_json_msg(FILE* f_msg_file, struct gsi_net_tcp* p_client)
+enum gsi_is_json_rc gsi_is_send_all_json_msg(FILE* f_msg_file, struct gsi_net_tcp* p_client, int i_batch_size)
+{
+	// Check input validation
+	if ((NULL == f_msg_file) || (NULL == p_client))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_JSON_INVALID_ERR;
+	}
+
+	return gsi_is_read_all_frames(f_msg_file, i_batch_size, gsi_build_parse_send_frame, p_client);
+}
+
+/*###########################################################################
+	 * Name:		gsi_is_read_all_frames
+	 * Description: Read all messages that exist in f_msg_file and pass them to p_frame_func
+	 * 				frame by frame, as gsi_is_send_all_json_msg() sends them:
+	 * 				with i_batch_size > 1 regular messages are passed in batches of up to
+	 * 				i_batch_size (GSI_IS_MAX_BATCH at most), a heartbeat ends the batch before it.
+	 * 				The messages are reset after p_frame_func returns.
+	 * Parameter:   [in] FILE* f_msg_file - handler to opened file
+	 * Parameter:   [in] int i_batch_size - max messages in one frame (1 - no batches)
+	 * Parameter:   [in] gsi_is_frame_func p_frame_func - called for each frame
+	 * Parameter:   [in] void* p_arg - passed to p_frame_func
+	 * Return :		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR (bad file or p_frame_func failed) *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_read_all_frames(FILE* f_msg_file, int i_batch_size,
+										   gsi_is_frame_func p_frame_func, void* p_arg)
 {
-	struct gsi_json_msg json_msg;
+	struct gsi_json_msg json_msgs[GSI_IS_MAX_BATCH];
+	struct gsi_json_msg* p_json_msg = NULL;
+	int i_count = 0;
+	int i_index = 0;
 	int i_rc = GSI_JSON_SUCCESS;
 
 	// Check input validation
-	if ((NULL == f_msg_file) || (NULL == p_client))
+	if ((NULL == f_msg_file) || (NULL == p_frame_func))
 	{
 		LOG_ERROR("invalid arguments!");
 		return GSI_JSON_INVALID_ERR;
 	}
 
+	// Batch size in range
+	if (1 > i_batch_size)
+	{
+		i_batch_size = 1;
+	}
+	else if (GSI_IS_MAX_BATCH < i_batch_size)
+	{
+		i_batch_size = GSI_IS_MAX_BATCH;
+	}
+
 	// Reset fields
-	memset(&json_msg, 0, sizeof(json_msg));
+	memset(json_msgs, 0, sizeof(json_msgs));
 
-	// Main loop to send all messages
+	// Main loop to read all messages
 	while (1)
 	{
-		// Get next message from file
-		i_rc = gsi_is_get_next_msg(f_msg_file, &json_msg);
+		// Get next message from file (after the messages that wait in batch)
+		p_json_msg = &json_msgs[i_count];
+
+		i_rc = gsi_is_get_next_msg(f_msg_file, p_json_msg);
 		if (GSI_JSON_READ_ERROR == i_rc)
 		{
-			i_rc = GSI_JSON_SUCCESS;
+			// Pass the messages left in batch
+			i_rc = gsi_build_parse_flush_batch(json_msgs, &i_count, p_frame_func, p_arg);
 			break;
 		}
 		else if ((GSI_JSON_ERROR == i_rc) || (GSI_JSON_INVALID_ERR == i_rc))
@@ -164,857 +439,2744 @@ enum gsi_is_json_rc gsi_is_send_all_json_msg(FILE* f_msg_file, struct gsi_net_tc
 			break;
 		}
 
-		if (GSI_COMMENT == json_msg.i_msg_type)
+		if (GSI_COMMENT == p_json_msg->i_msg_type)
+		{
+			continue;
+		}
+
+		// Regular message waits in batch until it is full
+		if ((1 < i_batch_size) && (GSI_REGULAR_MSG == p_json_msg->i_msg_type))
 		{
+			if (++i_count < i_batch_size)
+			{
+				continue;
+			}
+
+			i_rc = gsi_build_parse_flush_batch(json_msgs, &i_count, p_frame_func, p_arg);
+			if (GSI_JSON_SUCCESS != i_rc)
+			{
+				break;
+			}
+
 			continue;
 		}
 
-		// Send message
-		if (GSI_JSON_SUCCESS != gsi_is_send_json_msg(p_client, &json_msg))
+		// Heartbeat is passed after the messages before it
+		i_rc = gsi_build_parse_flush_batch(json_msgs, &i_count, p_frame_func, p_arg);
+		if (GSI_JSON_SUCCESS != i_rc)
+		{
+			break;
+		}
+
+		if (GSI_JSON_SUCCESS != p_frame_func(p_json_msg, 1, p_arg))
 		{
 			i_rc = GSI_JSON_ERROR;
 			break;
 		}
 
 		// Reset the json-msg object
-		gsi_build_parse_reset_object(&json_msg);
+		gsi_build_parse_reset_object(p_json_msg);
 	}
 
-	// Reset the json-msg object
-	if (GSI_JSON_SUCCESS != gsi_build_parse_reset_object(&json_msg))
+	// Reset the json-msg objects
+	for (i_index = 0; i_index < GSI_IS_MAX_BATCH; ++i_index)
 	{
-		return GSI_JSON_ERROR;
+		if (GSI_JSON_SUCCESS != gsi_build_parse_reset_object(&json_msgs[i_index]))
+		{
+			return GSI_JSON_ERROR;
+		}
 	}
 
 	return i_rc;
 }
 
 /*###########################################################################
-	 * Name:		gsi_is_send_json_msg
-	 * Description: Send one message from client to server
-	 * Parameter:   [in] struct gsi_net_tcp* p_client - client that wants to send the message
-	 * Parameter:   [in] struct gsi_json_msg* p_json_msg - pointer to message structure
-	 * Return:		Success - GSI_JSON_SUCCESS
-	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
+	 * Name:		gsi_is_frame_bound
+	 * Description: Max bytes gsi_is_encode_frame() writes for the messages
+	 * Parameter:   [in] const struct gsi_json_msg* p_json_msgs - messages of frame
+	 * Parameter:   [in] int i_count - number of messages (1 to GSI_IS_MAX_BATCH)
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Return:		Bytes of header and content at most
 #############################################################################*/
-enum gsi_is_json_rc gsi_is_send_json_msg(struct gsi_net_tcp* p_client, struct gsi_json_msg* p_json_msg)
+size_t gsi_is_frame_bound(const struct gsi_json_msg* p_json_msgs, int i_count, unsigned int ui_encoding)
+{
+	if (1 == i_count)
+	{
+		return GSI_IS_FRAME_HEADER_LEN + gsi_is_encode_bound(p_json_msgs, ui_encoding);
+	}
+
+	return gsi_is_batch_frame_bound(p_json_msgs, i_count, ui_encoding);
+}
+
+/*###########################################################################
+	 * Name:		gsi_is_encode_frame
+	 * Description: Write a ready to send frame - header of struct gsi_cs_tcp_message
+	 * 				and the content right after it.
+	 * 				One message is a frame of its own type (heartbeat is header only),
+	 * 				more messages are one GSI_BATCH_MSG frame.
+	 * Parameter:   [out] char* p_out - buffer of gsi_is_frame_bound() bytes
+	 * Parameter:   [in-out] struct gsi_json_msg* p_json_msgs - messages of frame (port is set)
+	 * Parameter:   [in] int i_count - number of messages (1 to GSI_IS_MAX_BATCH)
+	 * Parameter:   [in] unsigned int ui_port - port of header
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Return:		Bytes written (header and content)
+#############################################################################*/
+size_t gsi_is_encode_frame(char* p_out, struct gsi_json_msg* p_json_msgs, int i_count,
+						   unsigned int ui_port, unsigned int ui_encoding)
 {
 	struct gsi_cs_tcp_message msg;
-	struct json_object *p_json = NULL;
-	char* s_full_object = NULL;
 
-	// Check input validation
-	if ((NULL == p_client) || (NULL == p_json_msg))
+	if (1 != i_count)
 	{
-		LOG_ERROR("invalid arguments!");
-		return GSI_JSON_INVALID_ERR;
+		return gsi_is_encode_batch_frame(p_out, p_json_msgs, i_count, ui_port, ui_encoding);
 	}
 
 	// Reset message fields
 	memset(&msg, 0, sizeof(msg));
 
 	// Set fields
-	msg.e_type_msg = p_json_msg->i_msg_type;
-	msg.ui_port = p_client->ui_port;
-	p_json_msg->ui_port = p_client->ui_port;
+	msg.ui_port = ui_port;
+	msg.e_type_msg = p_json_msgs->i_msg_type;
+	p_json_msgs->ui_port = ui_port;
 
-	// Create new json object
-	p_json = json_object_new_object();
-	if (NULL == p_json)
+	// Heart beat has no content - header only
+	if (GSI_REGULAR_MSG == msg.e_type_msg)
 	{
-		LOG_ERROR("allocate new json object failed");
-		return GSI_JSON_ERROR;
+		msg.ui_len = gsi_is_encode_msg(p_out + GSI_IS_FRAME_HEADER_LEN, p_json_msgs, ui_encoding);
 	}
 
-	// Stringify the json-msg to string. using JSON-C library functions
-	// create object for each member field in structure and its value
-	s_full_object = gsi_build_parse_json_obj_to_string(p_json, p_json_msg);
-	if (NULL == s_full_object)
-	{
-		LOG_ERROR("json object to string failed");
-		json_object_put(p_json);
-		return GSI_JSON_ERROR;
-	}
+	memcpy(p_out, &msg, GSI_IS_FRAME_HEADER_LEN);
 
-	LOG_DEBUG("\nJSON:\n%s\n", s_full_object);
+	return GSI_IS_FRAME_HEADER_LEN + msg.ui_len;
+}
 
-	// Get full length
-	msg.ui_len = strlen(s_full_object) + 1;
+/*###########################################################################
+	 * Name:		gsi_is_batch_frame_bound
+	 * Description: Max bytes gsi_is_encode_batch_frame() writes for the messages
+	 * Parameter:   [in] const struct gsi_json_msg* p_json_msgs - messages of frame
+	 * Parameter:   [in] int i_count - number of messages (1 to GSI_IS_MAX_BATCH)
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Return:		Bytes of header and content at most
+#############################################################################*/
+size_t gsi_is_batch_frame_bound(const struct gsi_json_msg* p_json_msgs, int i_count, unsigned int ui_encoding)
+{
+	size_t ul_bound = GSI_IS_FRAME_HEADER_LEN;
+	int i_index = 0;
 
-	// Duplicate the new message
-	msg.s_message = gsi_build_parse_strdup(s_full_object);
-	if (NULL == msg.s_message)
+	// Bound of count (or brackets) and of each message with its length (or separator)
+	ul_bound += GSI_IS_BIN_VARINT_LEN + 1;
+	for (i_index = 0; i_index < i_count; ++i_index)
 	{
-		LOG_ERROR("memory allocation for s_message failed");
-		json_object_put(p_json);
-		return GSI_JSON_ERROR;
+		ul_bound += GSI_IS_BIN_VARINT_LEN + gsi_is_encode_bound(&p_json_msgs[i_index], ui_encoding);
 	}
 
-	// Free the json object
-	json_object_put(p_json);
+	return ul_bound;
+}
 
-	// Send message to server
-	if (GSI_NET_RC_SUCCESS != gsi_is_network_tcp_send(p_client, (char *)&msg))
-	{
-		LOG_ERROR("send message failed on port %d", p_client->ui_port);
+/*###########################################################################
+	 * Name:		gsi_is_encode_batch_frame
+	 * Description: Write a ready to send GSI_BATCH_MSG frame, even of one message -
+	 * 				every frame is answered by GSI_BATCH_REPLY_MSG (e.g. to time it).
+	 * Parameter:   [out] char* p_out - buffer of gsi_is_batch_frame_bound() bytes
+	 * Parameter:   [in-out] struct gsi_json_msg* p_json_msgs - regular messages of frame (port is set)
+	 * Parameter:   [in] int i_count - number of messages (1 to GSI_IS_MAX_BATCH)
+	 * Parameter:   [in] unsigned int ui_port - port of header
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Return:		Bytes written (header and content)
+#############################################################################*/
+size_t gsi_is_encode_batch_frame(char* p_out, struct gsi_json_msg* p_json_msgs, int i_count,
+								 unsigned int ui_port, unsigned int ui_encoding)
+{
+	struct gsi_cs_tcp_message msg;
+	char* p_content = p_out + GSI_IS_FRAME_HEADER_LEN;
+	int i_index = 0;
 
-		// Free the message memory
-		free(msg.s_message);
-		msg.s_message = NULL;
+	// Reset message fields
+	memset(&msg, 0, sizeof(msg));
 
-		return GSI_NET_RC_ERROR;
+	// Set fields
+	msg.ui_port = ui_port;
+	msg.e_type_msg = GSI_BATCH_MSG;
+	for (i_index = 0; i_index < i_count; ++i_index)
+	{
+		p_json_msgs[i_index].ui_port = ui_port;
 	}
 
-	// Free the message memory
-	free(msg.s_message);
-	msg.s_message = NULL;
+	msg.ui_len = ((GSI_ENC_BINARY == ui_encoding) ?
+				  gsi_build_parse_encode_binary_batch(p_content, p_json_msgs, i_count) :
+				  gsi_build_parse_encode_json_batch(p_content, p_json_msgs, i_count)) - p_content;
 
-	return GSI_JSON_SUCCESS;
+	memcpy(p_out, &msg, GSI_IS_FRAME_HEADER_LEN);
+
+	return GSI_IS_FRAME_HEADER_LEN + msg.ui_len;
 }
 
 /*###########################################################################
-	 * Name:		gsi_is_recv_json_msg
-	 * Description: Receive one message on listening port, and make operation according to the OP_CODE
-	 * Parameter:   [in] struct gsi_net_tcp* p_server - server that listen to port
-	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to message structure
+	 * Name:		gsi_is_send_json_msg
+	 * Description: Send one message from client to server.
+	 * 				The message is encoded as compact JSON (or binary, if negotiated)
+	 * 				straight into the send buffer of the client (no json object, no copies).
+	 * Parameter:   [in] struct gsi_net_tcp* p_client - client that wants to send the message
+	 * Parameter:   [in] struct gsi_json_msg* p_json_msg - pointer to message structure
 	 * Return:		Success - GSI_JSON_SUCCESS
 	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
 #############################################################################*/
-enum gsi_is_json_rc gsi_is_recv_json_msg(struct gsi_net_tcp* p_server, struct gsi_json_msg* p_json_msg)
+enum gsi_is_json_rc gsi_is_send_json_msg(struct gsi_net_tcp* p_client, struct gsi_json_msg* p_json_msg)
 {
-	struct gsi_cs_tcp_message msg;
-	struct json_object *p_json = NULL;
-
 	// Check input validation
-	if ((NULL == p_server) || (NULL == p_json_msg))
+	if ((NULL == p_client) || (NULL == p_json_msg))
 	{
 		LOG_ERROR("invalid arguments!");
 		return GSI_JSON_INVALID_ERR;
 	}
 
-	// Read new message
-	if (GSI_NET_RC_SUCCESS != gsi_is_network_tcp_server_read(p_server, (char *)&msg))
+	// Send message to server
+	if (GSI_JSON_SUCCESS != gsi_build_parse_encode_send(p_client, p_json_msg, 1))
 	{
-		LOG_ERROR("server read on port %d failed", p_server->ui_port);
-
-		// Check if need to free s_message
-		if (NULL != msg.s_message)
-		{
-			free(msg.s_message);
-			msg.s_message = NULL;
-		}
-
-		return GSI_JSON_ERROR;
+		LOG_ERROR("send message failed on port %d", p_client->ui_port);
+		return GSI_NET_RC_ERROR;
 	}
 
-	LOG_DEBUG("\nGot JSON:\n%s\n", msg.s_message);
+	return GSI_JSON_SUCCESS;
+}
 
-	// Convert string to json object using JSON-C library functions
-	if (GSI_JSON_SUCCESS != gsi_build_parse_string_to_json_object(msg.s_message, &p_json))
+/*###########################################################################
+	 * Name:		gsi_is_send_batch_msg
+	 * Description: Send regular messages from client to server in one batch frame
+	 * 				(encoded straight into the send buffer of the client),
+	 * 				and wait up to GSI_IS_BATCH_REPLY_MSECS for the results.
+	 * 				One message is sent alone (regular message has no reply to wait for).
+	 * Parameter:   [in] struct gsi_net_tcp* p_client - client that wants to send the messages
+	 * Parameter:   [in] struct gsi_json_msg* p_json_msgs - messages to send
+	 * Parameter:   [in] int i_count - number of messages (1 to GSI_IS_MAX_BATCH)
+	 * Return:		Success - GSI_JSON_SUCCESS (messages that failed on server are logged)
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_send_batch_msg(struct gsi_net_tcp* p_client, struct gsi_json_msg* p_json_msgs, int i_count)
+{
+	// Check input validation
+	if ((NULL == p_client) || (NULL == p_json_msgs) || (1 > i_count) || (GSI_IS_MAX_BATCH < i_count))
 	{
-		LOG_ERROR("convert string to json object failed");
-
-		free(msg.s_message);
-		msg.s_message = NULL;
-
-		json_object_put(p_json);
-
-		return GSI_JSON_ERROR;
+		LOG_ERROR("invalid arguments!");
+		return GSI_JSON_INVALID_ERR;
 	}
 
-	// Free s_message, finish his job
-	free(msg.s_message);
-	msg.s_message = NULL;
-
-	// Convert json object to json-msg object using JSON-C library functions
-	if (GSI_JSON_SUCCESS != gsi_build_parse_json_object_to_json_msg(p_json, p_json_msg))
+	if (1 == i_count)
 	{
-		LOG_ERROR("convert json object to json-msg failed");
-
-		json_object_put(p_json);
+		return gsi_is_send_json_msg(p_client, p_json_msgs);
+	}
 
+	// Send batch to server
+	if (GSI_JSON_SUCCESS != gsi_build_parse_encode_send(p_client, p_json_msgs, i_count))
+	{
+		LOG_ERROR("send batch failed on port %d", p_client->ui_port);
 		return GSI_JSON_ERROR;
 	}
 
-	// Free the json object
-	json_object_put(p_json);
-
-	return GSI_JSON_SUCCESS;
+	return gsi_is_recv_batch_reply(p_client, i_count);
 }
 
 /*###########################################################################
-	 * Name:		gsi_is_get_next_msg
-	 * Description:	Get the next message in f_msg_file
-	 * Parameter:   [in] FILE* f_msg_file - handler to opened file
-	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to message structure
+	 * Name:		gsi_is_recv_batch_reply
+	 * Description: Wait up to GSI_IS_BATCH_REPLY_MSECS for the results of batch
+	 * 				and log the messages that failed
+	 * Parameter:   [in] struct gsi_net_tcp* p_client - client that sent the batch
+	 * Parameter:   [in] int i_count - number of messages in batch
 	 * Return:		Success - GSI_JSON_SUCCESS
-	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR *OR* GSI_JSON_READ_ERROR
+	 * 				Failure - GSI_JSON_ERROR (no reply, or reply doesn't match the batch)
+	 * 						  *OR* GSI_JSON_INVALID_ERR
 #############################################################################*/
-enum gsi_is_json_rc gsi_is_get_next_msg(FILE* f_msg_file, struct gsi_json_msg* p_json_msg)
+enum gsi_is_json_rc gsi_is_recv_batch_reply(struct gsi_net_tcp* p_client, int i_count)
 {
-	char s_msg_buffer[GSI_IS_BUFFER_SIZE];
+	struct gsi_cs_tcp_message reply;
+	unsigned char a_results[GSI_IS_MAX_BATCH];
+	unsigned int ui_count = 0;
+	int i_failed = 0;
+	int i_index = 0;
+	int i_rc = GSI_JSON_SUCCESS;
 
 	// Check input validation
-	if ((NULL == f_msg_file) || (NULL == p_json_msg))
+	if ((NULL == p_client) || (1 > i_count) || (GSI_IS_MAX_BATCH < i_count))
 	{
 		LOG_ERROR("invalid arguments!");
 		return GSI_JSON_INVALID_ERR;
 	}
 
-	// Reset buffer
-	memset(s_msg_buffer, 0, sizeof(s_msg_buffer));
-
-	// Get next message from Messages file
-	if (NULL == fgets(s_msg_buffer, sizeof(s_msg_buffer), f_msg_file))
+	if (GSI_NET_RC_SUCCESS != gsi_is_network_tcp_client_read(p_client, (char *)&reply, GSI_IS_BATCH_REPLY_MSECS))
 	{
-		LOG_ERROR("couldn't read from messages file");
-		return GSI_JSON_READ_ERROR;
+		LOG_ERROR("no reply to batch on port %d", p_client->ui_port);
+		return GSI_JSON_ERROR;
 	}
 
-	// Build message according to the current line that read from file
-	if (0 != gsi_build_parse_build_msg(s_msg_buffer, p_json_msg))
+	i_rc = (GSI_BATCH_REPLY_MSG == reply.e_type_msg) ?
+		   gsi_is_decode_batch_reply(reply.s_message, reply.ui_len, p_client->ui_encoding,
+				   	   	   	   	   	   	   	  a_results, &ui_count) :
+		   GSI_JSON_ERROR;
+
+	free(reply.s_message);
+
+	if ((GSI_JSON_SUCCESS != i_rc) || ((unsigned int)i_count != ui_count))
 	{
-		LOG_ERROR("couldn't build message");
+		LOG_ERROR("bad reply to batch of %d messages", i_count);
 		return GSI_JSON_ERROR;
 	}
 
+	for (i_index = 0; i_index < i_count; ++i_index)
+	{
+		if (a_results[i_index])
+		{
+			LOG_WARNING("message %d of batch failed on server", i_index);
+			++i_failed;
+		}
+	}
+
+	LOG_INFO("batch of %d messages sent, %d failed", i_count, i_failed);
 	return GSI_JSON_SUCCESS;
 }
 
-/***********************************/
-/* Static functions implementation */
-/***********************************/
 /*###########################################################################
-	 * Name:		gsi_build_parse_build_msg
-	 * Description: Initialize fields in struct gsi_json_msg according to current line
-	 * Parameter:   [in] char* s_line - current line read from messages file
-	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to json-msg object
+	 * Name:		gsi_is_decode_batch_reply
+	 * Description: Read results of batch written by gsi_is_send_batch_reply()
+	 * 				(content of GSI_BATCH_REPLY_MSG, e.g. read by an event loop)
+	 * Parameter:   [in] const char* p_reply - reply content ('\0' after it)
+	 * Parameter:   [in] size_t ul_len - length of content
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Parameter:   [out] unsigned char* p_results - GSI_IS_MAX_BATCH results
+	 * Parameter:   [out] unsigned int* p_count - number of results
 	 * Return:		Success - GSI_JSON_SUCCESS
-	 * 				Failure - GSI_JSON_INVALID_ERR *OR* GSI_JSON_ERROR
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
 #############################################################################*/
-static int gsi_build_parse_build_msg(char* s_line, struct gsi_json_msg* p_json_msg)
+enum gsi_is_json_rc gsi_is_decode_batch_reply(const char* p_reply, size_t ul_len, unsigned int ui_encoding,
+											  unsigned char* p_results, unsigned int* p_count)
 {
+	const unsigned char* p_cur = (const unsigned char *)p_reply;
+	const unsigned char* p_end = p_cur + ul_len;
+	unsigned int ui_index = 0;
+
 	// Check input validation
-	if ((NULL == s_line) || (NULL == p_json_msg))
+	if ((NULL == p_reply) || (NULL == p_results) || (NULL == p_count))
 	{
 		LOG_ERROR("invalid arguments!");
 		return GSI_JSON_INVALID_ERR;
 	}
 
-	// Set message type
-	p_json_msg->i_msg_type = gsi_build_parse_get_msg_type(&s_line);
-	if (GSI_JSON_ERROR == p_json_msg->i_msg_type)
+	*p_count = 0;
+
+	if (GSI_ENC_BINARY == ui_encoding)
+	{
+		// Count, then byte per result
+		p_cur = gsi_build_parse_decode_varint(p_cur, p_end, p_count);
+		if ((NULL == p_cur) || (GSI_IS_MAX_BATCH < *p_count) || ((size_t)(p_end - p_cur) != *p_count))
+		{
+			return GSI_JSON_ERROR;
+		}
+
+		for (ui_index = 0; ui_index < *p_count; ++ui_index)
+		{
+			if (1 < p_cur[ui_index])
+			{
+				return GSI_JSON_ERROR;
+			}
+
+			p_results[ui_index] = p_cur[ui_index];
+		}
+
+		return GSI_JSON_SUCCESS;
+	}
+
+	// [0,1,...]
+	if ('[' != *p_cur++)
 	{
-		LOG_ERROR("get message type failed");
 		return GSI_JSON_ERROR;
 	}
 
-	// Only if Regular message sent
-	if (GSI_REGULAR_MSG == p_json_msg->i_msg_type)
+	while (']' != *p_cur)
 	{
-		// Set operation code
-		p_json_msg->i_op_code = gsi_build_parse_get_msg_op_code(&s_line);
-		if (GSI_JSON_ERROR == p_json_msg->i_op_code)
+		if ((GSI_IS_MAX_BATCH <= *p_count) || (('0' != *p_cur) && ('1' != *p_cur)))
 		{
-			LOG_ERROR("get message op-code failed");
 			return GSI_JSON_ERROR;
 		}
 
-		// Set operation code arguments
-		if (GSI_JSON_SUCCESS != gsi_build_parse_set_op_code_args(&s_line, p_json_msg))
+		p_results[(*p_count)++] = *p_cur++ - '0';
+
+		if (',' == *p_cur)
+		{
+			++p_cur;
+		}
+		else if (']' != *p_cur)
 		{
-			LOG_ERROR("set op-code-arguments failed");
 			return GSI_JSON_ERROR;
 		}
 	}
 
-	return GSI_JSON_SUCCESS;
+	return ('\0' == p_cur[1]) ? GSI_JSON_SUCCESS : GSI_JSON_ERROR;
 }
 
 /*###########################################################################
-	 * Name:		gsi_build_parse_get_msg_type
-	 * Description: Check the type of the message and moves the pointer forward
-	 * Parameter:   [in] char** s_line - address of current line
-	 * Return:		Success - Number that describe the type of the message
-	 * 				Failure - GSI_JSON_ERROR
+	 * Name:		gsi_is_recv_json_msg
+	 * Description: Receive one message on listening port, and make operation according to the OP_CODE
+	 * 				The content is converted by gsi_is_decode_msg() with the encoding of connection:
+	 * 				p_json_msg takes the received message and its strings point into it
+	 * 				until gsi_build_parse_reset_object() (no copy of data / file name).
+	 * Parameter:   [in] struct gsi_net_tcp* p_server - server that listen to port
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to message structure
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
 #############################################################################*/
-static int gsi_build_parse_get_msg_type(char** s_line)
+enum gsi_is_json_rc gsi_is_recv_json_msg(struct gsi_net_tcp* p_server, struct gsi_json_msg* p_json_msg)
 {
-	int i_type = 0;
+	struct gsi_cs_tcp_message msg;
 
 	// Check input validation
-	if (NULL == s_line)
+	if ((NULL == p_server) || (NULL == p_json_msg))
 	{
-		LOG_ERROR("invalid argument!");
-		return GSI_JSON_ERROR;
+		LOG_ERROR("invalid arguments!");
+		return GSI_JSON_INVALID_ERR;
 	}
 
-	// Look at the first character in the current line: 'H'/'M'/'#'
-	switch(**s_line)
-	{
-	case GSI_IS_HEART_BEAT:
-		i_type = GSI_HEARTBEAT_MSG;
-		break;
-	case GSI_IS_MESSAGE:
-		i_type = GSI_REGULAR_MSG;
-		break;
-	case GSI_IS_COMMENT:
-		i_type = GSI_COMMENT;
-		break;
-	default:
-		LOG_ERROR("classified message failed");
-		return GSI_JSON_ERROR;
-	}
-
-	// Move forward the line pointer
-	++(*s_line);
-
-	return i_type;
-}
-
-/*###########################################################################
-	 * Name:		gsi_build_parse_get_msg_op_code
-	 * Description: Check the type of the op-code and moves the pointer forward
-	 * Parameter:   [in] char** s_line - address of current line
-	 * Return:		Success - Number that describe the operation-code
-	 * 				Failure - GSI_JSON_ERROR
-#############################################################################*/
-static int gsi_build_parse_get_msg_op_code(char** s_line)
-{
-	int i_op_code = 0;
-
-	// Check input validation
-	if (NULL == s_line)
+	// Read new message
+	if (GSI_NET_RC_SUCCESS != gsi_is_network_tcp_server_read(p_server, (char *)&msg))
 	{
-		LOG_ERROR("invalid argument!");
-		return GSI_JSON_ERROR;
-	}
+		LOG_ERROR("server read on port %d failed", p_server->ui_port);
 
-	// Skip the ':' at the beginning of the s_line
-	++(*s_line);
+		// Check if need to free s_message
+		if (NULL != msg.s_message)
+		{
+			free(msg.s_message);
+			msg.s_message = NULL;
+		}
 
-	// Decode operation-code from s_line
-	if (0 == strncmp(*s_line, GSI_IS_READ_FILE_BY_ID, strlen(GSI_IS_READ_FILE_BY_ID)))
-	{
-		i_op_code = GSI_READ_FILE_BY_ID;
-	}
-	else if (0 == strncmp(*s_line, GSI_IS_READ_STR, strlen(GSI_IS_READ_STR)))
-	{
-		i_op_code = GSI_READ_STR;
-	}
-	else if (0 == strncmp(*s_line, GSI_IS_WRITE_STR, strlen(GSI_IS_WRITE_STR)))
-	{
-		i_op_code = GSI_WRITE_STR;
-	}
-	else if (0 == strncmp(*s_line, GSI_IS_READ_FILE, strlen(GSI_IS_READ_FILE)))
-	{
-		i_op_code = GSI_READ_FILE;
-	}
-	else if (0 == strncmp(*s_line, GSI_IS_WRITE_FILE, strlen(GSI_IS_WRITE_FILE)))
-	{
-		i_op_code = GSI_WRITE_FILE;
-	}
-	else if (0 == strncmp(*s_line, GSI_IS_PRINT_LOG, strlen(GSI_IS_PRINT_LOG)))
-	{
-		i_op_code = GSI_PRINT_LOG;
-	}
-	else
-	{
-		LOG_ERROR("invalid op code");
 		return GSI_JSON_ERROR;
 	}
 
-	// Move forward the line pointer
-	if (GSI_READ_FILE_BY_ID == i_op_code)
-	{
-		*s_line += strlen(GSI_IS_READ_FILE_BY_ID);
-	}
-	else
+	if (GSI_ENC_BINARY != p_server->ui_encoding)
 	{
-		*s_line += strlen(GSI_IS_PRINT_LOG);
+		LOG_DEBUG("\nGot JSON:\n%s\n", msg.s_message);
 	}
 
-	return i_op_code;
+	// json-msg owns the message from now on (freed by gsi_build_parse_reset_object())
+	p_json_msg->p_recv_buf = msg.s_message;
+
+	// Convert content to json-msg object, strings are views into the message itself
+	return gsi_is_decode_msg(msg.s_message, msg.ui_len, p_server->ui_encoding, p_json_msg);
 }
 
 /*###########################################################################
-	 * Name:		gsi_build_parse_get_msg_index
-	 * Description: Extract the index number from the current line string and moves the pointer forward
-	 * Parameter:   [in] char** s_line - address of current line
-	 * Return:		Success - Number that describe the index
-	 * 				Failure - GSI_JSON_ERROR
+	 * Name:		gsi_is_recv_batch_msg
+	 * Description: Receive one frame on listening port - batch, or regular message as batch of one.
+	 * 				The messages are taken by gsi_is_batch_next_msg(). MUST be reset by
+	 * 				gsi_is_batch_reset() (after the last message taken was reset).
+	 * Parameter:   [in] struct gsi_net_tcp* p_server - server that listen to port
+	 * Parameter:   [out] struct gsi_json_batch* p_batch - batch to fill
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
 #############################################################################*/
-static int gsi_build_parse_get_msg_index(char** s_line)
+enum gsi_is_json_rc gsi_is_recv_batch_msg(struct gsi_net_tcp* p_server, struct gsi_json_batch* p_batch)
 {
-	int i_index = 0;
+	struct gsi_cs_tcp_message msg;
+	const unsigned char* p_cur = NULL;
+	const char* p_start = NULL;
 
 	// Check input validation
-	if (NULL == s_line)
+	if ((NULL == p_server) || (NULL == p_batch))
 	{
-		LOG_ERROR("invalid argument!");
-		return GSI_JSON_ERROR;
+		LOG_ERROR("invalid arguments!");
+		return GSI_JSON_INVALID_ERR;
 	}
 
-	// Skip the ':' at the beginning of the s_line
-	++(*s_line);
+	// Reset batch fields
+	memset(p_batch, 0, sizeof(struct gsi_json_batch));
 
-	// Extract the index from the s_line, stops at ' '
-	i_index = strtol(*s_line, s_line, 10);
+	// Read new frame
+	if (GSI_NET_RC_SUCCESS != gsi_is_network_tcp_server_read(p_server, (char *)&msg))
+	{
+		LOG_ERROR("server read on port %d failed", p_server->ui_port);
 
-	return i_index;
-}
+		// Check if need to free s_message
+		if (NULL != msg.s_message)
+		{
+			free(msg.s_message);
+			msg.s_message = NULL;
+		}
 
-/*###########################################################################
-	 * Name:		gsi_build_parse_get_msg_len
-	 * Description: Return the message length
-	 * Parameter:   [in] char* s_msg - message
-	 * Return:		Success - message's length
-	 * 				Failure - GSI_JSON_ERROR
-#############################################################################*/
-static int gsi_build_parse_get_msg_len(char* s_msg)
-{
-	// Check input validation
-	if (NULL == s_msg)
-	{
-		LOG_ERROR("invalid argument!");
 		return GSI_JSON_ERROR;
 	}
 
-	return strlen(s_msg);
-}
+	// Batch owns the frame from now on (freed by gsi_is_batch_reset())
+	p_batch->p_recv_buf  = msg.s_message;
+	p_batch->ul_len 	 = msg.ui_len;
+	p_batch->ui_encoding = p_server->ui_encoding;
+	p_batch->i_type_msg  = msg.e_type_msg;
 
-/*###########################################################################
-	 * Name:		gsi_build_parse_get_msg_content
-	 * Description: Return pointer to actual data
-	 * Parameter:   [in] char** s_line - address of current line
-	 * Return:		Success - pointer to data
-	 * 				Failure - NULL
-#############################################################################*/
-static char* gsi_build_parse_get_msg_content(char** s_line)
-{
-	// Check input validation
-	if (NULL == s_line)
+	// Regular message - batch of one
+	if (GSI_BATCH_MSG != msg.e_type_msg)
 	{
-		LOG_ERROR("invalid argument!");
-		return NULL;
+		p_batch->ui_left = 1;
+		return GSI_JSON_SUCCESS;
 	}
 
-	// Skip the white spaces at the beginning of the s_line
-	while (('\0' != **s_line) && (isspace(**s_line)))
+	if (GSI_ENC_BINARY == p_batch->ui_encoding)
 	{
-		++(*s_line);
+		// Count of messages first
+		p_cur = gsi_build_parse_decode_varint((const unsigned char *)p_batch->p_recv_buf,
+											  (const unsigned char *)p_batch->p_recv_buf + p_batch->ul_len,
+											  &p_batch->ui_left);
+		if ((NULL == p_cur) || (GSI_IS_MAX_BATCH < p_batch->ui_left))
+		{
+			LOG_ERROR("bad count of messages in batch");
+			p_batch->ui_left = 0;
+			return GSI_JSON_ERROR;
+		}
+
+		p_batch->ul_pos = p_cur - (const unsigned char *)p_batch->p_recv_buf;
 	}
+	else
+	{
+		LOG_DEBUG("\nGot JSON batch:\n%s\n", p_batch->p_recv_buf);
 
-	return *s_line;
+		// Array of messages
+		p_start = gsi_build_parse_fast_skip_ws(p_batch->p_recv_buf);
+		if ('[' != *p_start)
+		{
+			LOG_ERROR("batch is not JSON array");
+			return GSI_JSON_ERROR;
+		}
+
+		p_batch->ul_pos  = p_start + 1 - p_batch->p_recv_buf;
+		p_batch->ui_left = GSI_IS_MAX_BATCH;
+	}
+
+	return GSI_JSON_SUCCESS;
 }
 
 /*###########################################################################
-	 * Name:		gsi_build_parse_set_op_code_args
-	 * Description:	Fill the relevant fields in json-msg object according to the OP-CODE
-	 * 				Memory allocation must be free by the function gsi_build_parse_reset_object
-	 * Parameter:   [in] char** s_line - address of current line
-	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to json-msg object
+	 * Name:		gsi_is_batch_next_msg
+	 * Description: Decode the next message of batch in place (as gsi_is_recv_json_msg()),
+	 * 				the strings are views into the batch. Its result is "done" until
+	 * 				gsi_is_batch_set_result(), or "failed" if it couldn't be decoded.
+	 * Parameter:   [in] struct gsi_json_batch* p_batch - received batch
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
 	 * Return:		Success - GSI_JSON_SUCCESS
-	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
+	 * 				Failure - GSI_JSON_ERROR (bad message, the next ones may be taken)
+	 * 						  *OR* GSI_JSON_READ_ERROR (no more messages) *OR* GSI_JSON_INVALID_ERR
 #############################################################################*/
-static int gsi_build_parse_set_op_code_args(char** s_line, struct gsi_json_msg* p_json_msg)
+enum gsi_is_json_rc gsi_is_batch_next_msg(struct gsi_json_batch* p_batch, struct gsi_json_msg* p_json_msg)
 {
+	const unsigned char* p_cur = NULL;
+	const unsigned char* p_end = NULL;
+	char* p_msg = NULL;
+	size_t ul_msg_len = 0;
+	unsigned int ui_msg_len = 0;
+	int i_rc = GSI_JSON_SUCCESS;
+
 	// Check input validation
-	if ((NULL == s_line) || (NULL == p_json_msg))
+	if ((NULL == p_batch) || (NULL == p_json_msg))
 	{
 		LOG_ERROR("invalid arguments!");
 		return GSI_JSON_INVALID_ERR;
 	}
 
-	switch(p_json_msg->i_op_code)
+	if (0 == p_batch->ui_left)
 	{
-		case GSI_READ_STR:
-			// Get index
-			p_json_msg->i_index = gsi_build_parse_get_msg_index(s_line);
-			break;
-
-		case GSI_WRITE_STR:
-			// Get index + length
-			p_json_msg->i_index    = gsi_build_parse_get_msg_index(s_line);
-			p_json_msg->i_data_len = gsi_build_parse_get_msg_len(*s_line);
-
-			// Duplicate message content
-			p_json_msg->s_data  = gsi_build_parse_strdup(gsi_build_parse_get_msg_content(s_line));
-			if (NULL == p_json_msg->s_data)
-			{
-				return GSI_JSON_ERROR;
-			}
+		return GSI_JSON_READ_ERROR;
+	}
 
-			break;
+	if (GSI_BATCH_MSG != p_batch->i_type_msg)
+	{
+		// json-msg owns the regular message (as in gsi_is_recv_json_msg())
+		p_json_msg->p_recv_buf = p_batch->p_recv_buf;
+		p_batch->p_recv_buf = NULL;
 
-		case GSI_READ_FILE:
-		case GSI_PRINT_LOG:
-			// Get file length
-			p_json_msg->i_file_len = gsi_build_parse_get_msg_len(*s_line);
+		p_msg = p_json_msg->p_recv_buf;
+		ul_msg_len = p_batch->ul_len;
+	}
+	else if (GSI_ENC_BINARY == p_batch->ui_encoding)
+	{
+		// Length of message, then the message
+		p_end = (const unsigned char *)p_batch->p_recv_buf + p_batch->ul_len;
+		p_cur = gsi_build_parse_decode_varint((const unsigned char *)p_batch->p_recv_buf + p_batch->ul_pos,
+											  p_end, &ui_msg_len);
+		if ((NULL == p_cur) || ((size_t)(p_end - p_cur) < ui_msg_len))
+		{
+			LOG_ERROR("batch is truncated");
+			p_batch->ui_left = 0;
+			return GSI_JSON_READ_ERROR;
+		}
 
-			// Duplicate file name
-			p_json_msg->s_file_name = gsi_build_parse_strdup(gsi_build_parse_get_file_name(s_line));
-			if (NULL == p_json_msg->s_file_name)
+		p_msg = (char *)p_cur;
+		ul_msg_len = ui_msg_len;
+		p_batch->ul_pos = (p_cur + ui_msg_len) - (const unsigned char *)p_batch->p_recv_buf;
+	}
+	else
+	{
+		// Next object of array, ended by '\0' in place
+		i_rc = gsi_build_parse_next_json_object(p_batch, &p_msg, &ul_msg_len);
+		if (GSI_JSON_SUCCESS != i_rc)
+		{
+			if (GSI_JSON_READ_ERROR != i_rc)
 			{
-				return GSI_JSON_ERROR;
+				LOG_ERROR("bad JSON batch");
 			}
 
-			break;
-
-		case GSI_WRITE_FILE:
-		case GSI_READ_FILE_BY_ID:
-			// Get file length
-			p_json_msg->i_file_len = gsi_build_parse_get_msg_len(*s_line);
+			p_batch->ui_left = 0;
+			return GSI_JSON_READ_ERROR;
+		}
 
-			// Duplicate file name
-			p_json_msg->s_file_name = gsi_build_parse_strdup(gsi_build_parse_get_file_name(s_line));
-			if (NULL == p_json_msg->s_file_name)
-			{
-				return GSI_JSON_ERROR;
-			}
+		// With its '\0'
+		++ul_msg_len;
+	}
 
-			// Data length
-			p_json_msg->i_data_len = gsi_build_parse_get_msg_len(*s_line);
+	--(p_batch->ui_left);
 
-			// Allocate memory for s_data
-			p_json_msg->s_data = gsi_build_parse_strdup(gsi_build_parse_get_msg_content(s_line));
-			if (NULL == p_json_msg->s_data)
-			{
-				free(p_json_msg->s_file_name);
-				p_json_msg->s_file_name = NULL;
+	i_rc = gsi_is_decode_msg(p_msg, ul_msg_len, p_batch->ui_encoding, p_json_msg);
 
-				return GSI_JSON_ERROR;
-			}
+	// Result of message - failed if it couldn't be decoded
+	p_batch->a_results[p_batch->ui_count++] = (GSI_JSON_SUCCESS != i_rc);
 
-			break;
+	return (GSI_JSON_SUCCESS == i_rc) ? GSI_JSON_SUCCESS : GSI_JSON_ERROR;
+}
 
-		default:
-			LOG_ERROR("invalid operation code");
-			return GSI_JSON_ERROR;
+/*###########################################################################
+	 * Name:		gsi_is_batch_set_result
+	 * Description: Set result of the last message taken by gsi_is_batch_next_msg()
+	 * Parameter:   [in] struct gsi_json_batch* p_batch - received batch
+	 * Parameter:   [in] int i_failed - 0 if the message was done
+	 * Return:		None
+#############################################################################*/
+void gsi_is_batch_set_result(struct gsi_json_batch* p_batch, int i_failed)
+{
+	if ((NULL != p_batch) && (0 < p_batch->ui_count))
+	{
+		p_batch->a_results[p_batch->ui_count - 1] = (0 != i_failed);
 	}
-
-	return GSI_JSON_SUCCESS;
 }
 
 /*###########################################################################
-	 * Name:		gsi_build_parse_json_obj_to_string
-	 * Description: Convert gsi_json_message to string format.
-	 * 				For each field in structure - generate tuple <NAME>:<VALUE>
-	 * 				according to JSON format
-	 * Parameter:   [in] struct gsi_json_msg* p_json_msg - pointer to structure to convert
-	 * Parameter:   [in-out] struct json_object *p_json - pointer to json object to use JSON-C library
-	 * Return:		Success - char* - string that contatins all the structure in json format
-	 * 				Failure - NULL
+	 * Name:		gsi_is_send_batch_reply
+	 * Description: Send the results of the messages taken from batch to the client
+	 * 				(GSI_BATCH_REPLY_MSG). Regular message has no reply.
+	 * Parameter:   [in] struct gsi_net_tcp* p_server - server that received the batch
+	 * Parameter:   [in] struct gsi_json_batch* p_batch - received batch
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
 #############################################################################*/
-static char* gsi_build_parse_json_obj_to_string(struct json_object *p_json, struct gsi_json_msg* p_json_msg)
+enum gsi_is_json_rc gsi_is_send_batch_reply(struct gsi_net_tcp* p_server, struct gsi_json_batch* p_batch)
 {
-	int i_ret = 0;
+	struct gsi_cs_tcp_message msg;
+	size_t ul_header_len = sizeof(msg) - sizeof(char*);
+	unsigned int ui_index = 0;
+	char* p_buf = NULL;
+	char* p_cur = NULL;
 
 	// Check input validation
-	if (NULL == p_json_msg)
+	if ((NULL == p_server) || (NULL == p_batch))
 	{
-		LOG_ERROR("invalid argument!");
-		return NULL;
+		LOG_ERROR("invalid arguments!");
+		return GSI_JSON_INVALID_ERR;
 	}
 
-	// For each filed in structure - add object: <NAME>:<VALUE>
-	i_ret += json_object_object_add(p_json, "Message Type",json_object_new_int(p_json_msg->i_msg_type));
-	i_ret += json_object_object_add(p_json, "Op-Code", 	   json_object_new_int(p_json_msg->i_op_code));
-	i_ret += json_object_object_add(p_json, "Op-Str", 	   json_object_new_string(gsi_build_parse_op_code_to_string(p_json_msg->i_op_code)));
-	i_ret += json_object_object_add(p_json, "Port", 	   json_object_new_int(p_json_msg->ui_port));
-	i_ret += json_object_object_add(p_json, "Index",   	   json_object_new_int(p_json_msg->i_index));
-	i_ret += json_object_object_add(p_json, "Data Length", json_object_new_int(p_json_msg->i_data_len));
-	i_ret += json_object_object_add(p_json, "File Length", json_object_new_int(p_json_msg->i_file_len));
-
-	// Check if has file name or NULL
-	if (NULL != p_json_msg->s_file_name)
+	if (GSI_BATCH_MSG != p_batch->i_type_msg)
 	{
-		i_ret += json_object_object_add(p_json, "File Name", json_object_new_string(p_json_msg->s_file_name));
+		return GSI_JSON_SUCCESS;
 	}
-	else
+
+	// Header, count (or brackets and '\0') and 2 chars per result at most
+	p_buf = gsi_is_network_tcp_get_send_buf(p_server,
+			ul_header_len + GSI_IS_BIN_VARINT_LEN + 2 + (2 * p_batch->ui_count));
+	if (NULL == p_buf)
 	{
-		i_ret += json_object_object_add(p_json, "File Name", NULL);
+		LOG_ERROR("get send buffer failed");
+		return GSI_JSON_ERROR;
 	}
 
-	// Check if has data or NULL
-	if (NULL != p_json_msg->s_data)
+	p_cur = p_buf + ul_header_len;
+
+	if (GSI_ENC_BINARY == p_batch->ui_encoding)
 	{
-		i_ret += json_object_object_add(p_json, "Data", json_object_new_string(p_json_msg->s_data));
+		p_cur = (char *)gsi_build_parse_encode_varint((unsigned char *)p_cur, p_batch->ui_count);
+		memcpy(p_cur, p_batch->a_results, p_batch->ui_count);
+		p_cur += p_batch->ui_count;
 	}
 	else
 	{
-		i_ret += json_object_object_add(p_json, "Data", NULL);
+		*p_cur++ = '[';
+		for (ui_index = 0; ui_index < p_batch->ui_count; ++ui_index)
+		{
+			*p_cur++ = '0' + p_batch->a_results[ui_index];
+			*p_cur++ = ',';
+		}
+
+		// Last ',' is the end of array
+		if (0 < p_batch->ui_count)
+		{
+			--p_cur;
+		}
+
+		*p_cur++ = ']';
+		*p_cur++ = '\0';
 	}
 
-	// Check status of adding all objects
-	if (0 != i_ret)
+	// Reset message fields
+	memset(&msg, 0, sizeof(msg));
+
+	msg.e_type_msg = GSI_BATCH_REPLY_MSG;
+	msg.ui_port = p_server->ui_port;
+	msg.ui_len = p_cur - (p_buf + ul_header_len);
+	memcpy(p_buf, &msg, ul_header_len);
+
+	// Send results to client
+	if (GSI_NET_RC_SUCCESS != gsi_is_network_tcp_send_buf(p_server, ul_header_len + msg.ui_len))
 	{
-		LOG_ERROR("json object add failed");
-		return NULL;
+		LOG_ERROR("send reply of batch failed on port %d", p_server->ui_port);
+		return GSI_JSON_ERROR;
 	}
 
-	// Converting the json object to string format, using JSON-C library function
-	return (char *)json_object_to_json_string_ext(p_json, JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_SPACED);
+	LOG_DEBUG("reply to batch of %u messages on port %d", p_batch->ui_count, p_server->ui_port);
+	return GSI_JSON_SUCCESS;
 }
 
 /*###########################################################################
-	 * Name:		gsi_build_parse_string_to_json_object
-	 * Description: Convert string to json object using JSON-C library functions
-	 * Parameter:   [in] char *s_data - string to convert
-	 * Parameter:   [out] struct json_object** p_json - pointer to fill
+	 * Name:		gsi_is_batch_reset
+	 * Description: Free the received frame and reset all the fields of batch
+	 * Parameter:   [in-out] struct gsi_json_batch* p_batch - batch to reset
 	 * Return:		Success - GSI_JSON_SUCCESS
-	 * 				Failure - GSI_JSON_INVALID_ERR *OR* GSI_JSON_ERROR
+	 * 				Failure - GSI_JSON_INVALID_ERR
 #############################################################################*/
-static int gsi_build_parse_string_to_json_object(char *s_data, struct json_object** p_json)
+enum gsi_is_json_rc gsi_is_batch_reset(struct gsi_json_batch* p_batch)
 {
 	// Check input validation
-	if (NULL == s_data)
+	if (NULL == p_batch)
 	{
 		LOG_ERROR("invalid argument!");
 		return GSI_JSON_INVALID_ERR;
 	}
 
-	// parse the string to json object
-	*p_json = json_tokener_parse(s_data);
-	if (NULL == *p_json)
-	{
-		LOG_ERROR("string to json failed");
-		return GSI_JSON_ERROR;
-	}
+	// Frame is moved to json-msg for regular message
+	free(p_batch->p_recv_buf);
+
+	// Reset fields
+	memset(p_batch, 0, sizeof(struct gsi_json_batch));
 
 	return GSI_JSON_SUCCESS;
 }
 
 /*###########################################################################
-	 * Name:		gsi_build_parse_json_object_to_json_msg
-	 * Description: Convert json object to structure json-msg object
-	 * Parameter:   [in] struct json_object *p_json - pointer to json object
+	 * Name:		gsi_is_parse_json_msg
+	 * Description: Convert message content to json-msg object.
+	 * 				Messages of the known layout are parsed in one pass without json-c
+	 * 				(long ones with structural index), others fall back to json-c.
+	 * Parameter:   [in] const char* s_json - message content ('\0' terminated)
+	 * Parameter:   [in] size_t ul_len - length of message content
 	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
 	 * Return:		Success - GSI_JSON_SUCCESS
-	 * 				Failure - GSI_JSON_INVALID_ERR *OR* GSI_JSON_ERROR
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
 #############################################################################*/
-static int gsi_build_parse_json_object_to_json_msg(struct json_object *p_json, struct gsi_json_msg* p_json_msg)
+enum gsi_is_json_rc gsi_is_parse_json_msg(const char* s_json, size_t ul_len, struct gsi_json_msg* p_json_msg)
 {
 	// Check input validation
-	if ((NULL == p_json) || (NULL == p_json_msg))
+	if ((NULL == s_json) || (NULL == p_json_msg))
 	{
 		LOG_ERROR("invalid arguments!");
 		return GSI_JSON_INVALID_ERR;
 	}
 
-	// Initialize p_json_msg fields. using JSON-C library functions
-	p_json_msg->i_msg_type = json_object_get_int(json_object_object_get(p_json, "Message Type"));
-	p_json_msg->i_op_code  = json_object_get_int(json_object_object_get(p_json, "Op-Code"));
-	p_json_msg->ui_port    = json_object_get_int(json_object_object_get(p_json, "Port"));
+	return gsi_build_parse_convert_msg(s_json, ul_len, 0, p_json_msg);
+}
 
-	// Initialize relevant fields according to operaion code
-	if (GSI_JSON_SUCCESS != gsi_build_parse_handle_op_code(p_json, p_json_msg))
+/*###########################################################################
+	 * Name:		gsi_is_encode_bound
+	 * Description: Upper bound of encoded message content length
+	 * Parameter:   [in] const struct gsi_json_msg* p_json_msg - message to encode
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Return:		Max number of bytes gsi_is_encode_msg() writes
+#############################################################################*/
+size_t gsi_is_encode_bound(const struct gsi_json_msg* p_json_msg, unsigned int ui_encoding)
+{
+	if (GSI_ENC_BINARY != ui_encoding)
 	{
-		LOG_ERROR("couldn't handle op code");
-		return GSI_JSON_ERROR;
+		// JSON with '\0'
+		return gsi_build_parse_encode_bound(p_json_msg) + 1;
 	}
 
-	return GSI_JSON_SUCCESS;
+	// Strings are written as is
+	return GSI_IS_BIN_FIXED_LEN + gsi_build_parse_strings_len(p_json_msg);
 }
 
 /*###########################################################################
-	 * Name:		gsi_build_parse_handle_op_code
-	 * Description: Initialize fields in json-msg object according to operation code
-	 * Parameter:   [in] struct json_object *p_json - pointer to json object
-	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
-	 * Return: 		Success - GSI_JSON_SUCCESS
-	 * 				Failure - GSI_JSON_INVALID_ERR *OR* GSI_JSON_ERROR
+	 * Name:		gsi_is_encode_msg
+	 * Description: Encode message content (JSON is ended with '\0')
+	 * Parameter:   [out] char* p_out - buffer of gsi_is_encode_bound() bytes at least
+	 * Parameter:   [in] const struct gsi_json_msg* p_json_msg - message to encode
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Return:		Number of bytes written
 #############################################################################*/
-static int gsi_build_parse_handle_op_code(struct json_object *p_json, struct gsi_json_msg* p_json_msg)
+size_t gsi_is_encode_msg(char* p_out, const struct gsi_json_msg* p_json_msg, unsigned int ui_encoding)
 {
-	// Check input validation
-	if (NULL == p_json_msg)
+	size_t ul_len = 0;
+
+	if (GSI_ENC_BINARY == ui_encoding)
+	{
+		return gsi_build_parse_encode_binary_msg(p_out, p_json_msg);
+	}
+
+	ul_len = gsi_build_parse_encode_json_msg(p_out, p_json_msg);
+	p_out[ul_len] = '\0';
+
+	return ul_len + 1;
+}
+
+/*###########################################################################
+	 * Name:		gsi_is_decode_msg
+	 * Description: Decode message content in place - the strings of p_json_msg
+	 * 				are views into p_buf (it must live until gsi_build_parse_reset_object()).
+	 * 				JSON strings are decoded over p_buf, binary ones are used as is.
+	 * Parameter:   [in] char* p_buf - message content (written by JSON decode)
+	 * Parameter:   [in] size_t ul_len - length of content (with the '\0' of JSON)
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_decode_msg(char* p_buf, size_t ul_len, unsigned int ui_encoding,
+									  struct gsi_json_msg* p_json_msg)
+{
+	// Check input validation
+	if ((NULL == p_buf) || (NULL == p_json_msg) || (0 == ul_len))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_JSON_INVALID_ERR;
+	}
+
+	if (GSI_ENC_BINARY == ui_encoding)
+	{
+		if (GSI_JSON_SUCCESS != gsi_build_parse_decode_binary_msg(p_buf, ul_len, p_json_msg))
+		{
+			LOG_ERROR("convert binary message to json-msg failed");
+			return GSI_JSON_ERROR;
+		}
+
+		return GSI_JSON_SUCCESS;
+	}
+
+	// JSON - without its '\0'
+	return gsi_build_parse_convert_msg(p_buf, ul_len - 1, 1, p_json_msg);
+}
+
+/*###########################################################################
+	 * Name:		gsi_is_get_next_msg
+	 * Description:	Get the next message in f_msg_file
+	 * Parameter:   [in] FILE* f_msg_file - handler to opened file
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to message structure
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR *OR* GSI_JSON_READ_ERROR
+#############################################################################*/
+enum gsi_is_json_rc gsi_is_get_next_msg(FILE* f_msg_file, struct gsi_json_msg* p_json_msg)
+{
+	char s_msg_buffer[GSI_IS_BUFFER_SIZE];
+
+	// Check input validation
+	if ((NULL == f_msg_file) || (NULL == p_json_msg))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_JSON_INVALID_ERR;
+	}
+
+	// Reset buffer
+	memset(s_msg_buffer, 0, sizeof(s_msg_buffer));
+
+	// Get next message from Messages file
+	if (NULL == fgets(s_msg_buffer, sizeof(s_msg_buffer), f_msg_file))
+	{
+		LOG_ERROR("couldn't read from messages file");
+		return GSI_JSON_READ_ERROR;
+	}
+
+	// Build message according to the current line that read from file
+	if (0 != gsi_build_parse_build_msg(s_msg_buffer, p_json_msg))
+	{
+		LOG_ERROR("couldn't build message");
+		return GSI_JSON_ERROR;
+	}
+
+	return GSI_JSON_SUCCESS;
+}
+
+/***********************************/
+/* Static functions implementation */
+/***********************************/
+/*###########################################################################
+	 * Name:		gsi_build_parse_build_msg
+	 * Description: Initialize fields in struct gsi_json_msg according to current line
+	 * Parameter:   [in] char* s_line - current line read from messages file
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to json-msg object
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_INVALID_ERR *OR* GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_build_msg(char* s_line, struct gsi_json_msg* p_json_msg)
+{
+	// Check input validation
+	if ((NULL == s_line) || (NULL == p_json_msg))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_JSON_INVALID_ERR;
+	}
+
+	// Set message type
+	p_json_msg->i_msg_type = gsi_build_parse_get_msg_type(&s_line);
+	if (GSI_JSON_ERROR == p_json_msg->i_msg_type)
+	{
+		LOG_ERROR("get message type failed");
+		return GSI_JSON_ERROR;
+	}
+
+	// Only if Regular message sent
+	if (GSI_REGULAR_MSG == p_json_msg->i_msg_type)
+	{
+		// Set operation code
+		p_json_msg->i_op_code = gsi_build_parse_get_msg_op_code(&s_line);
+		if (GSI_JSON_ERROR == p_json_msg->i_op_code)
+		{
+			LOG_ERROR("get message op-code failed");
+			return GSI_JSON_ERROR;
+		}
+
+		// Set operation code arguments
+		if (GSI_JSON_SUCCESS != gsi_build_parse_set_op_code_args(&s_line, p_json_msg))
+		{
+			LOG_ERROR("set op-code-arguments failed");
+			return GSI_JSON_ERROR;
+		}
+	}
+
+	return GSI_JSON_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_get_msg_type
+	 * Description: Check the type of the message and moves the pointer forward
+	 * Parameter:   [in] char** s_line - address of current line
+	 * Return:		Success - Number that describe the type of the message
+	 * 				Failure - GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_get_msg_type(char** s_line)
+{
+	int i_type = 0;
+
+	// Check input validation
+	if (NULL == s_line)
+	{
+		LOG_ERROR("invalid argument!");
+		return GSI_JSON_ERROR;
+	}
+
+	// Look at the first character in the current line: 'H'/'M'/'#'
+	switch(**s_line)
+	{
+	case GSI_IS_HEART_BEAT:
+		i_type = GSI_HEARTBEAT_MSG;
+		break;
+	case GSI_IS_MESSAGE:
+		i_type = GSI_REGULAR_MSG;
+		break;
+	case GSI_IS_COMMENT:
+		i_type = GSI_COMMENT;
+		break;
+	default:
+		LOG_ERROR("classified message failed");
+		return GSI_JSON_ERROR;
+	}
+
+	// Move forward the line pointer
+	++(*s_line);
+
+	return i_type;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_get_msg_op_code
+	 * Description: Check the type of the op-code and moves the pointer forward.
+	 * 				The tag (up to 4 upper case letters) is packed to one number
+	 * 				and switched on (cases are made from GSI_IS_OP_CODES).
+	 * Parameter:   [in] char** s_line - address of current line
+	 * Return:		Success - Number that describe the operation-code
+	 * 				Failure - GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_get_msg_op_code(char** s_line)
+{
+	unsigned int ui_tag = 0;
+	int i_op_code = 0;
+	int i_len = 0;
+
+	// Check input validation
+	if (NULL == s_line)
+	{
+		LOG_ERROR("invalid argument!");
+		return GSI_JSON_ERROR;
+	}
+
+	// Skip the ':' at the beginning of the s_line
+	++(*s_line);
+
+	// Pack the tag
+	while ((GSI_IS_MAX_TAG_LEN > i_len) && isupper((unsigned char)(*s_line)[i_len]))
+	{
+		ui_tag |= (unsigned int)(unsigned char)(*s_line)[i_len] << (8 * i_len);
+		++i_len;
+	}
+
+	// Decode operation-code from tag
+	switch (isupper((unsigned char)(*s_line)[i_len]) ? 0 : ui_tag)
+	{
+#define 	GSI_IS_OP_CODE_TAG_CASE(op, c0, c1, c2, c3, s_op, ui_fields) \
+		case GSI_IS_TAG(c0, c1, c2, c3): \
+			i_op_code = op; \
+			break;
+
+		GSI_IS_OP_CODES(GSI_IS_OP_CODE_TAG_CASE)
+
+		default:
+			LOG_ERROR("invalid op code");
+			return GSI_JSON_ERROR;
+	}
+
+	// Move forward the line pointer
+	*s_line += i_len;
+
+	return i_op_code;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_get_msg_index
+	 * Description: Extract the index number from the current line string and moves the pointer forward
+	 * Parameter:   [in] char** s_line - address of current line
+	 * Return:		Success - Number that describe the index
+	 * 				Failure - GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_get_msg_index(char** s_line)
+{
+	int i_index = 0;
+
+	// Check input validation
+	if (NULL == s_line)
+	{
+		LOG_ERROR("invalid argument!");
+		return GSI_JSON_ERROR;
+	}
+
+	// Skip the ':' at the beginning of the s_line
+	++(*s_line);
+
+	// Extract the index from the s_line, stops at ' '
+	i_index = strtol(*s_line, s_line, 10);
+
+	return i_index;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_get_msg_len
+	 * Description: Return the message length
+	 * Parameter:   [in] char* s_msg - message
+	 * Return:		Success - message's length
+	 * 				Failure - GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_get_msg_len(char* s_msg)
+{
+	// Check input validation
+	if (NULL == s_msg)
+	{
+		LOG_ERROR("invalid argument!");
+		return GSI_JSON_ERROR;
+	}
+
+	return strlen(s_msg);
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_get_msg_content
+	 * Description: Return pointer to actual data
+	 * Parameter:   [in] char** s_line - address of current line
+	 * Return:		Success - pointer to data
+	 * 				Failure - NULL
+#############################################################################*/
+static char* gsi_build_parse_get_msg_content(char** s_line)
+{
+	// Check input validation
+	if (NULL == s_line)
+	{
+		LOG_ERROR("invalid argument!");
+		return NULL;
+	}
+
+	// Skip the white spaces at the beginning of the s_line
+	while (('\0' != **s_line) && (isspace(**s_line)))
+	{
+		++(*s_line);
+	}
+
+	return *s_line;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_set_op_code_args
+	 * Description:	Fill the relevant fields in json-msg object according to the OP-CODE
+	 * 				(its fields in GSI_IS_OP_CODES). The line has them in this order:
+	 * 				index, file name, content.
+	 * 				Memory allocation must be free by the function gsi_build_parse_reset_object
+	 * Parameter:   [in] char** s_line - address of current line
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to json-msg object
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+static int gsi_build_parse_set_op_code_args(char** s_line, struct gsi_json_msg* p_json_msg)
+{
+	unsigned int ui_fields = 0;
+
+	// Check input validation
+	if ((NULL == s_line) || (NULL == p_json_msg))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_JSON_INVALID_ERR;
+	}
+
+	if (GSI_JSON_SUCCESS != gsi_build_parse_get_op_fields(p_json_msg->i_op_code, &ui_fields))
+	{
+		LOG_ERROR("invalid operation code");
+		return GSI_JSON_ERROR;
+	}
+
+	// Get index
+	if (GSI_FIELD_INDEX & ui_fields)
+	{
+		p_json_msg->i_index = gsi_build_parse_get_msg_index(s_line);
+	}
+
+	// Get file length and duplicate file name
+	if (GSI_FIELD_FILE_NAME & ui_fields)
+	{
+		p_json_msg->i_file_len = gsi_build_parse_get_msg_len(*s_line);
+
+		p_json_msg->s_file_name = gsi_build_parse_strdup(gsi_build_parse_get_file_name(s_line));
+		if (NULL == p_json_msg->s_file_name)
+		{
+			return GSI_JSON_ERROR;
+		}
+	}
+
+	// Get data length and duplicate message content
+	if (GSI_FIELD_DATA & ui_fields)
+	{
+		p_json_msg->i_data_len = gsi_build_parse_get_msg_len(*s_line);
+
+		p_json_msg->s_data = gsi_build_parse_strdup(gsi_build_parse_get_msg_content(s_line));
+		if (NULL == p_json_msg->s_data)
+		{
+			free(p_json_msg->s_file_name);
+			p_json_msg->s_file_name = NULL;
+
+			return GSI_JSON_ERROR;
+		}
+	}
+
+	return GSI_JSON_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_encode_bound
+	 * Description: Upper bound of encoded json-msg length (without '\0')
+	 * Parameter:   [in] const struct gsi_json_msg* p_json_msg - message to encode
+	 * Return:		Max number of bytes gsi_build_parse_encode_json_msg() writes
+#############################################################################*/
+static size_t gsi_build_parse_encode_bound(const struct gsi_json_msg* p_json_msg)
+{
+	// Each char of strings may be escaped
+	return GSI_IS_JSON_FIXED_LEN + (GSI_IS_JSON_ESC_LEN * gsi_build_parse_strings_len(p_json_msg));
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_strings_len
+	 * Description: Total length of the strings of json-msg (GSI_IS_MSG_FIELDS)
+	 * Parameter:   [in] const struct gsi_json_msg* p_json_msg - message to encode
+	 * Return:		Length of all the strings (without '\0')
+#############################################################################*/
+static size_t gsi_build_parse_strings_len(const struct gsi_json_msg* p_json_msg)
+{
+	size_t ul_len = 0;
+
+#define 	GSI_IS_STRLEN_INT(member)
+#define 	GSI_IS_STRLEN_OP_STR(member)
+#define 	GSI_IS_STRLEN_STRING(member) \
+	if (NULL != p_json_msg->member) \
+	{ \
+		ul_len += strlen(p_json_msg->member); \
+	}
+#define 	GSI_IS_STRLEN_FIELD(key, s_key, c0, c1, type, member, bin, ui_field) GSI_IS_STRLEN_##type(member)
+
+	GSI_IS_MSG_FIELDS(GSI_IS_STRLEN_FIELD)
+
+	return ul_len;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_encode_json_msg
+	 * Description: Encode json-msg as compact JSON straight into output buffer,
+	 * 				keys and order of GSI_IS_MSG_FIELDS (as the server expects).
+	 * 				Output must have gsi_build_parse_encode_bound() bytes.
+	 * Parameter:   [out] char* p_out - buffer to write to
+	 * Parameter:   [in] const struct gsi_json_msg* p_json_msg - message to encode
+	 * Return:		Number of bytes written (without '\0')
+#############################################################################*/
+static size_t gsi_build_parse_encode_json_msg(char* p_out, const struct gsi_json_msg* p_json_msg)
+{
+	char* p_start = p_out;
+
+#define 	GSI_IS_ENCODE_INT(p_out, value)		gsi_build_parse_encode_int((p_out), (value))
+#define 	GSI_IS_ENCODE_STRING(p_out, value)	gsi_build_parse_encode_string((p_out), (value))
+#define 	GSI_IS_ENCODE_OP_STR(p_out, value)	gsi_build_parse_encode_string((p_out), gsi_build_parse_op_code_to_string(value))
+#define 	GSI_IS_ENCODE_FIELD(key, s_key, c0, c1, type, member, bin, ui_field) \
+	GSI_IS_JSON_PUT_LITERAL(p_out, "\"" s_key "\":"); \
+	p_out = GSI_IS_ENCODE_##type(p_out, p_json_msg->member); \
+	*p_out++ = ',';
+
+	*p_out++ = '{';
+
+	// For each filed in structure - write "<NAME>":<VALUE>,
+	GSI_IS_MSG_FIELDS(GSI_IS_ENCODE_FIELD)
+
+	// Last ',' ends the object
+	p_out[-1] = '}';
+
+	return p_out - p_start;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_encode_int
+	 * Description: Write decimal number to output buffer (at most 20 bytes)
+	 * Parameter:   [out] char* p_out - buffer to write to
+	 * Parameter:   [in] long l_value - number to write
+	 * Return:		Pointer after the last written byte
+#############################################################################*/
+static char* gsi_build_parse_encode_int(char* p_out, long l_value)
+{
+	char s_digits[24];
+	int i_count = 0;
+	unsigned long ul_value = (unsigned long)l_value;
+
+	// Negative - write sign and use absolute value (safe for LONG_MIN)
+	if (0 > l_value)
+	{
+		*p_out++ = '-';
+		ul_value = 0UL - ul_value;
+	}
+
+	// Digits from last to first
+	do
+	{
+		s_digits[i_count++] = '0' + (ul_value % 10);
+		ul_value /= 10;
+	}
+	while (0 != ul_value);
+
+	while (0 < i_count)
+	{
+		*p_out++ = s_digits[--i_count];
+	}
+
+	return p_out;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_encode_string
+	 * Description: Write string as JSON string (quoted and escaped), or null
+	 * 				Runs of chars without escaping are copied at once.
+	 * Parameter:   [out] char* p_out - buffer to write to
+	 * Parameter:   [in] const char* s_str - string to write (may be NULL)
+	 * Return:		Pointer after the last written byte
+#############################################################################*/
+static char* gsi_build_parse_encode_string(char* p_out, const char* s_str)
+{
+	static const char s_hex[] = "0123456789abcdef";
+	const unsigned char* p_run = (const unsigned char*)s_str;
+	const unsigned char* p_cur = (const unsigned char*)s_str;
+
+	if (NULL == s_str)
+	{
+		GSI_IS_JSON_PUT_LITERAL(p_out, "null");
+		return p_out;
+	}
+
+	*p_out++ = '"';
+
+	for (; '\0' != *p_cur; ++p_cur)
+	{
+		// Most chars are written as is
+		if ((0x20 <= *p_cur) && ('"' != *p_cur) && ('\\' != *p_cur))
+		{
+			continue;
+		}
+
+		// Flush the run before this char
+		memcpy(p_out, p_run, p_cur - p_run);
+		p_out += p_cur - p_run;
+		p_run = p_cur + 1;
+
+		*p_out++ = '\\';
+
+		switch (*p_cur)
+		{
+			case '"':
+				*p_out++ = '"';
+				break;
+
+			case '\\':
+				*p_out++ = '\\';
+				break;
+
+			case '\n':
+				*p_out++ = 'n';
+				break;
+
+			case '\t':
+				*p_out++ = 't';
+				break;
+
+			case '\r':
+				*p_out++ = 'r';
+				break;
+
+			case '\b':
+				*p_out++ = 'b';
+				break;
+
+			case '\f':
+				*p_out++ = 'f';
+				break;
+
+			default:
+				*p_out++ = 'u';
+				*p_out++ = '0';
+				*p_out++ = '0';
+				*p_out++ = s_hex[*p_cur >> 4];
+				*p_out++ = s_hex[*p_cur & 0xF];
+				break;
+		}
+	}
+
+	// Flush the last run
+	memcpy(p_out, p_run, p_cur - p_run);
+	p_out += p_cur - p_run;
+
+	*p_out++ = '"';
+
+	return p_out;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_string_to_json_object
+	 * Description: Convert string to json object using JSON-C library functions
+	 * Parameter:   [in] char *s_data - string to convert
+	 * Parameter:   [out] struct json_object** p_json - pointer to fill
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_INVALID_ERR *OR* GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_string_to_json_object(char *s_data, struct json_object** p_json)
+{
+	// Check input validation
+	if (NULL == s_data)
+	{
+		LOG_ERROR("invalid argument!");
+		return GSI_JSON_INVALID_ERR;
+	}
+
+	// parse the string to json object
+	*p_json = json_tokener_parse(s_data);
+	if (NULL == *p_json)
+	{
+		LOG_ERROR("string to json failed");
+		return GSI_JSON_ERROR;
+	}
+
+	return GSI_JSON_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_json_object_to_json_msg
+	 * Description: Convert json object to structure json-msg object
+	 * 				(values by GSI_IS_MSG_FIELDS, filled as the one pass parser does)
+	 * Parameter:   [in] struct json_object *p_json - pointer to json object
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_INVALID_ERR *OR* GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_json_object_to_json_msg(struct json_object *p_json, struct gsi_json_msg* p_json_msg)
+{
+	struct gsi_build_parse_value values[GSI_KEY_COUNT];
+	struct gsi_build_parse_value* p_value = NULL;
+
+	// Check input validation
+	if ((NULL == p_json) || (NULL == p_json_msg))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_JSON_INVALID_ERR;
+	}
+
+	memset(values, 0, sizeof(values));
+
+	// Get values using JSON-C library functions (as json-c converts them)
+#define 	GSI_IS_JSON_C_GET_INT(s_key) \
+	p_value->i_type  = GSI_VALUE_INT; \
+	p_value->i_value = json_object_get_int(json_object_object_get(p_json, s_key));
+#define 	GSI_IS_JSON_C_GET_STRING(s_key) \
+	p_value->p_str = json_object_get_string(json_object_object_get(p_json, s_key)); \
+	if (NULL != p_value->p_str) \
+	{ \
+		p_value->i_type = GSI_VALUE_STRING; \
+		p_value->ul_len = strlen(p_value->p_str); \
+	}
+#define 	GSI_IS_JSON_C_GET_OP_STR(s_key)
+#define 	GSI_IS_JSON_C_GET_FIELD(key, s_key, c0, c1, type, member, bin, ui_field) \
+	p_value = &values[key]; \
+	GSI_IS_JSON_C_GET_##type(s_key)
+
+	GSI_IS_MSG_FIELDS(GSI_IS_JSON_C_GET_FIELD)
+
+	// Initialize relevant fields according to operaion code
+	if (GSI_JSON_SUCCESS != gsi_build_parse_fill_msg(values, 0, p_json_msg))
+	{
+		LOG_ERROR("couldn't handle op code");
+		return GSI_JSON_ERROR;
+	}
+
+	return GSI_JSON_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_get_src_file
+	 * Description: Extract the source file name from the current line and moves the pointer forward
+	 * 				The delimiter to stop extraction is white space: ' '
+	 * Parameter:   [in] char** s_line - address of current line
+	 * Return:		Success - char* - source file name
+	 * 				Failure - NULL
+#############################################################################*/
+static char* gsi_build_parse_get_file_name(char** s_line)
+{
+	char* s_src_file = NULL;
+	char* s_runner = NULL;
+
+	// Check input validation
+	if (NULL == s_line)
+	{
+		LOG_ERROR("invalid argument!");
+		return NULL;
+	}
+
+	//Skip all white space before the file name
+	while (('\0' != **s_line) && (isspace(**s_line)))
+	{
+		++(*s_line);
+	}
+
+	// Start point to hold the name of the file
+	s_src_file = *s_line;
+
+	// Runner pointer to run until meet white space
+	s_runner = s_src_file;
+
+	// Main run loop
+	while (!isspace(*s_runner) && ('\n' != *s_runner))
+	{
+		++s_runner;
+	}
+
+	// Split the string in the current position
+	*s_runner = '\0';
+
+	// Move the original pointer by length of the file name
+	*s_line += strlen(s_src_file) + 1;
+
+	return s_src_file;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_strdup
+	 * Description:	Duplicate a string. using dynamic memory allocation. must free by the user
+	 * Parameter:   [in] char* s_src - source string
+	 * Return:		Success - duplicate string
+	 * 				Failure - NULL
+#############################################################################*/
+static char* gsi_build_parse_strdup(const char* s_src)
+{
+	char* s_dest = NULL;
+
+	// Check input validation
+	if (NULL == s_src)
+	{
+		LOG_ERROR("invalid argument!");
+		return NULL;
+	}
+
+	// Allocate memory for the destination
+	s_dest = (char *)malloc(strlen(s_src) + 1);
+	if (NULL == s_dest)
+	{
+		LOG_ERROR("memory allocation in for dupliaction failed");
+		return NULL;
+	}
+
+	// Copy content
+	strcpy(s_dest, s_src);
+
+	return s_dest;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_op_code_to_string
+	 * Description: Convert op-code to string (GSI_IS_OP_CODES)
+	 * Parameter:   [in] int i_op_code - op code number
+	 * Return:		Success - op code as string literal
+	 * 				Failure - NULL
+#############################################################################*/
+static char* gsi_build_parse_op_code_to_string(int i_op_code)
+{
+#define 	GSI_IS_OP_STR_CASE(op, c0, c1, c2, c3, s_op, ui_fields) \
+		case op: \
+			return s_op;
+
+	switch(i_op_code)
+	{
+		GSI_IS_OP_CODES(GSI_IS_OP_STR_CASE)
+
+		default:
+			return NULL;
+	}
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_get_op_fields
+	 * Description: Fields of json-msg the op code uses (GSI_IS_OP_CODES)
+	 * Parameter:   [in] int i_op_code - op code number
+	 * Parameter:   [out] unsigned int* p_fields - gsi_is_json_field flags
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR (unknown op code)
+#############################################################################*/
+static int gsi_build_parse_get_op_fields(int i_op_code, unsigned int* p_fields)
+{
+	// Op codes are numbered from 0 in schema order
+	if ((0 > i_op_code) || ((sizeof(g_op_code_fields) / sizeof(g_op_code_fields[0])) <= (unsigned int)i_op_code))
+	{
+		return GSI_JSON_ERROR;
+	}
+
+	*p_fields = g_op_code_fields[i_op_code];
+
+	return GSI_JSON_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_encode_binary_msg
+	 * Description: Write json-msg in binary encoding (see gsi_build_parse_data.h),
+	 * 				binary kind and order of GSI_IS_MSG_FIELDS
+	 * Parameter:   [out] char* p_out - buffer of gsi_is_encode_bound() bytes at least
+	 * Parameter:   [in] const struct gsi_json_msg* p_json_msg - message to encode
+	 * Return:		Number of bytes written
+#############################################################################*/
+static size_t gsi_build_parse_encode_binary_msg(char* p_out, const struct gsi_json_msg* p_json_msg)
+{
+	unsigned char* p_cur = (unsigned char*)p_out;
+
+#define 	GSI_IS_BIN_ENCODE_NONE(value)
+#define 	GSI_IS_BIN_ENCODE_U8(value) \
+	*p_cur++ = (unsigned char)(value);
+#define 	GSI_IS_BIN_ENCODE_U16(value) \
+	*p_cur++ = (unsigned char)((value) & 0xFF); \
+	*p_cur++ = (unsigned char)(((value) >> 8) & 0xFF);
+#define 	GSI_IS_BIN_ENCODE_VARINT(value) \
+	p_cur = gsi_build_parse_encode_varint(p_cur, GSI_IS_ZIGZAG(value));
+#define 	GSI_IS_BIN_ENCODE_STRING(value) \
+	p_cur = gsi_build_parse_encode_binary_string(p_cur, (value));
+#define 	GSI_IS_BIN_ENCODE_FIELD(key, s_key, c0, c1, type, member, bin, ui_field) \
+	GSI_IS_BIN_ENCODE_##bin(p_json_msg->member)
+
+	GSI_IS_MSG_FIELDS(GSI_IS_BIN_ENCODE_FIELD)
+
+	return p_cur - (unsigned char*)p_out;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_encode_varint
+	 * Description: Write number as varint (7 bits per byte, low first, high bit - more bytes)
+	 * Parameter:   [out] unsigned char* p_out - buffer to write to
+	 * Parameter:   [in] unsigned int ui_value - number to write
+	 * Return:		Pointer after the last written byte
+#############################################################################*/
+static unsigned char* gsi_build_parse_encode_varint(unsigned char* p_out, unsigned int ui_value)
+{
+	while (0x80 <= ui_value)
+	{
+		*p_out++ = (unsigned char)(ui_value | 0x80);
+		ui_value >>= 7;
+	}
+
+	*p_out++ = (unsigned char)ui_value;
+
+	return p_out;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_encode_binary_string
+	 * Description: Write string as varint of length + 1 (0 for NULL), chars and '\0'
+	 * Parameter:   [out] unsigned char* p_out - buffer to write to
+	 * Parameter:   [in] const char* s_str - string to write (may be NULL)
+	 * Return:		Pointer after the last written byte
+#############################################################################*/
+static unsigned char* gsi_build_parse_encode_binary_string(unsigned char* p_out, const char* s_str)
+{
+	size_t ul_len = 0;
+
+	if (NULL == s_str)
+	{
+		return gsi_build_parse_encode_varint(p_out, 0);
+	}
+
+	ul_len = strlen(s_str);
+
+	p_out = gsi_build_parse_encode_varint(p_out, (unsigned int)ul_len + 1);
+	memcpy(p_out, s_str, ul_len + 1);
+
+	return p_out + ul_len + 1;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_decode_binary_msg
+	 * Description: Convert binary message to json-msg object. Strings are views into
+	 * 				p_buf (each one is ended by '\0' in the message), nothing is copied.
+	 * 				Fields needed by the op code must exist (as for JSON).
+	 * Parameter:   [in] char* p_buf - message content
+	 * Parameter:   [in] size_t ul_len - length of content
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_decode_binary_msg(char* p_buf, size_t ul_len, struct gsi_json_msg* p_json_msg)
+{
+	struct gsi_build_parse_value values[GSI_KEY_COUNT];
+	const unsigned char* p_cur = (const unsigned char*)p_buf;
+	const unsigned char* p_end = p_cur + ul_len;
+
+	// Every value is set by its decoder (no memset of all values)
+#define 	GSI_IS_BIN_DECODE_NONE(p_value) \
+	(p_value)->i_type = GSI_VALUE_MISSING;
+#define 	GSI_IS_BIN_DECODE_U8(p_value) \
+	p_cur = gsi_build_parse_decode_fixed(p_cur, p_end, 1, (p_value));
+#define 	GSI_IS_BIN_DECODE_U16(p_value) \
+	p_cur = gsi_build_parse_decode_fixed(p_cur, p_end, 2, (p_value));
+#define 	GSI_IS_BIN_DECODE_VARINT(p_value) \
+	p_cur = gsi_build_parse_decode_int(p_cur, p_end, (p_value));
+#define 	GSI_IS_BIN_DECODE_STRING(p_value) \
+	p_cur = gsi_build_parse_decode_binary_string(p_cur, p_end, (p_value));
+#define 	GSI_IS_BIN_DECODE_FIELD(key, s_key, c0, c1, type, member, bin, ui_field) \
+	GSI_IS_BIN_DECODE_##bin(&values[key]) \
+	if (NULL == p_cur) \
+	{ \
+		return GSI_JSON_ERROR; \
+	}
+
+	GSI_IS_MSG_FIELDS(GSI_IS_BIN_DECODE_FIELD)
+
+	// Bytes after the message
+	if (p_end != p_cur)
+	{
+		return GSI_JSON_ERROR;
+	}
+
+	// Strings are ended in the message - views
+	return gsi_build_parse_fill_msg(values, 1, p_json_msg);
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_decode_fixed
+	 * Description: Read little endian number of 1 or 2 bytes
+	 * Parameter:   [in] const unsigned char* p_cur - first byte of number
+	 * Parameter:   [in] const unsigned char* p_end - end of message
+	 * Parameter:   [in] int i_bytes - bytes of number
+	 * Parameter:   [out] struct gsi_build_parse_value* p_value - number value
+	 * Return:		Success - position after the number
+	 * 				Failure - NULL (truncated)
+#############################################################################*/
+static const unsigned char* gsi_build_parse_decode_fixed(const unsigned char* p_cur, const unsigned char* p_end,
+														 int i_bytes, struct gsi_build_parse_value* p_value)
+{
+	if ((p_end - p_cur) < i_bytes)
+	{
+		return NULL;
+	}
+
+	p_value->i_type  = GSI_VALUE_INT;
+	p_value->i_value = p_cur[0];
+
+	if (2 == i_bytes)
+	{
+		p_value->i_value |= p_cur[1] << 8;
+	}
+
+	return p_cur + i_bytes;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_decode_varint
+	 * Description: Read varint of 32 bits at most
+	 * Parameter:   [in] const unsigned char* p_cur - first byte of varint
+	 * Parameter:   [in] const unsigned char* p_end - end of message
+	 * Parameter:   [out] unsigned int* p_value - value of varint
+	 * Return:		Success - position after the varint
+	 * 				Failure - NULL (truncated or too long)
+#############################################################################*/
+static const unsigned char* gsi_build_parse_decode_varint(const unsigned char* p_cur, const unsigned char* p_end,
+														  unsigned int* p_value)
+{
+	unsigned int ui_value = 0;
+	int i_shift = 0;
+
+	for (i_shift = 0; i_shift < (7 * GSI_IS_BIN_VARINT_LEN); i_shift += 7)
+	{
+		if (p_cur >= p_end)
+		{
+			return NULL;
+		}
+
+		ui_value |= (unsigned int)(*p_cur & 0x7F) << i_shift;
+
+		if (0 == (*p_cur++ & 0x80))
+		{
+			// Last byte may hold 4 bits only
+			if ((28 == i_shift) && (0x0F < p_cur[-1]))
+			{
+				return NULL;
+			}
+
+			*p_value = ui_value;
+			return p_cur;
+		}
+	}
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_decode_int
+	 * Description: Read zigzag varint
+	 * Parameter:   [in] const unsigned char* p_cur - first byte of varint
+	 * Parameter:   [in] const unsigned char* p_end - end of message
+	 * Parameter:   [out] struct gsi_build_parse_value* p_value - number value
+	 * Return:		Success - position after the varint
+	 * 				Failure - NULL (truncated or too long)
+#############################################################################*/
+static const unsigned char* gsi_build_parse_decode_int(const unsigned char* p_cur, const unsigned char* p_end,
+													   struct gsi_build_parse_value* p_value)
+{
+	unsigned int ui_value = 0;
+
+	p_cur = gsi_build_parse_decode_varint(p_cur, p_end, &ui_value);
+	if (NULL != p_cur)
+	{
+		p_value->i_type  = GSI_VALUE_INT;
+		p_value->i_value = GSI_IS_UNZIGZAG(ui_value);
+	}
+
+	return p_cur;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_decode_binary_string
+	 * Description: Read string written by gsi_build_parse_encode_binary_string()
+	 * Parameter:   [in] const unsigned char* p_cur - first byte of string field
+	 * Parameter:   [in] const unsigned char* p_end - end of message
+	 * Parameter:   [out] struct gsi_build_parse_value* p_value - string in message *OR* null
+	 * Return:		Success - position after the string
+	 * 				Failure - NULL (truncated or not ended by '\0')
+#############################################################################*/
+static const unsigned char* gsi_build_parse_decode_binary_string(const unsigned char* p_cur, const unsigned char* p_end,
+																 struct gsi_build_parse_value* p_value)
+{
+	unsigned int ui_len = 0;
+
+	p_cur = gsi_build_parse_decode_varint(p_cur, p_end, &ui_len);
+	if (NULL == p_cur)
+	{
+		return NULL;
+	}
+
+	// null
+	if (0 == ui_len)
+	{
+		p_value->i_type = GSI_VALUE_NULL;
+		return p_cur;
+	}
+
+	// Chars and '\0' must be in the message
+	if (((size_t)(p_end - p_cur) < ui_len) || ('\0' != p_cur[ui_len - 1]))
+	{
+		return NULL;
+	}
+
+	p_value->i_type    = GSI_VALUE_STRING;
+	p_value->p_str     = (const char *)p_cur;
+	p_value->ul_len    = ui_len - 1;
+	p_value->i_escaped = 0;
+
+	return p_cur + ui_len;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_flush_batch
+	 * Description: Pass the messages that wait in batch to p_frame_func and reset them
+	 * Parameter:   [in] struct gsi_json_msg* p_json_msgs - messages that wait
+	 * Parameter:   [in-out] int* p_count - number of messages (0 after the call)
+	 * Parameter:   [in] gsi_is_frame_func p_frame_func - called for the frame
+	 * Parameter:   [in] void* p_arg - passed to p_frame_func
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_flush_batch(struct gsi_json_msg* p_json_msgs, int* p_count,
+									   gsi_is_frame_func p_frame_func, void* p_arg)
+{
+	int i_rc = GSI_JSON_SUCCESS;
+	int i_index = 0;
+
+	if (0 < *p_count)
+	{
+		i_rc = p_frame_func(p_json_msgs, *p_count, p_arg);
+	}
+
+	// Reset the json-msg objects
+	for (i_index = 0; i_index < *p_count; ++i_index)
+	{
+		gsi_build_parse_reset_object(&p_json_msgs[i_index]);
+	}
+
+	*p_count = 0;
+
+	return (GSI_JSON_SUCCESS == i_rc) ? GSI_JSON_SUCCESS : GSI_JSON_ERROR;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_send_frame
+	 * Description: Frame function of gsi_is_send_all_json_msg() - send the messages
+	 * 				(one message alone, more as batch)
+	 * Parameter:   [in] struct gsi_json_msg* p_json_msgs - messages of frame
+	 * Parameter:   [in] int i_count - number of messages
+	 * Parameter:   [in] void* p_arg - struct gsi_net_tcp* of client
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR *OR* GSI_JSON_INVALID_ERR
+#############################################################################*/
+static int gsi_build_parse_send_frame(struct gsi_json_msg* p_json_msgs, int i_count, void* p_arg)
+{
+	return gsi_is_send_batch_msg((struct gsi_net_tcp *)p_arg, p_json_msgs, i_count);
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_encode_send
+	 * Description: Encode messages as one frame straight into the send buffer of the
+	 * 				client (JSON, or binary if negotiated) and send it. A reconnect that
+	 * 				changed the encoding sends nothing - the frame is encoded again.
+	 * Parameter:   [in] struct gsi_net_tcp* p_client - client that sends the frame
+	 * Parameter:   [in] struct gsi_json_msg* p_json_msgs - messages of frame
+	 * Parameter:   [in] int i_count - number of messages (1 - regular frame, more - batch)
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_encode_send(struct gsi_net_tcp* p_client, struct gsi_json_msg* p_json_msgs, int i_count)
+{
+	size_t ul_bound = 0;
+	size_t ul_len = 0;
+	char* p_buf = NULL;
+	enum gsi_is_network_return_code e_rc = GSI_NET_RC_ENCODING;
+
+	for (int i_try = 0; (i_try < 2) && (GSI_NET_RC_ENCODING == e_rc); ++i_try)
+	{
+		// Get send buffer of connection, big enough for header and encoded messages
+		ul_bound = gsi_is_frame_bound(p_json_msgs, i_count, p_client->ui_encoding);
+		if (UINT_MAX < ul_bound)
+		{
+			LOG_ERROR("message too long");
+			return GSI_JSON_ERROR;
+		}
+
+		p_buf = gsi_is_network_tcp_get_send_buf(p_client, (unsigned int)ul_bound);
+		if (NULL == p_buf)
+		{
+			LOG_ERROR("get send buffer failed");
+			return GSI_JSON_ERROR;
+		}
+
+		ul_len = gsi_is_encode_frame(p_buf, p_json_msgs, i_count, p_client->ui_port, p_client->ui_encoding);
+
+		if (((1 < i_count) || (GSI_REGULAR_MSG == p_json_msgs->i_msg_type)) && (GSI_ENC_BINARY != p_client->ui_encoding))
+		{
+			LOG_DEBUG("\nJSON:\n%s\n", p_buf + GSI_IS_FRAME_HEADER_LEN);
+		}
+
+		e_rc = gsi_is_network_tcp_send_buf(p_client, (unsigned int)ul_len);
+	}
+
+	return (GSI_NET_RC_SUCCESS == e_rc) ? GSI_JSON_SUCCESS : GSI_JSON_ERROR;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_encode_json_batch
+	 * Description: Write messages as JSON array, ended with '\0'
+	 * Parameter:   [out] char* p_out - buffer of 2 + gsi_is_encode_bound() of each message
+	 * Parameter:   [in] struct gsi_json_msg* p_json_msgs - messages to encode
+	 * Parameter:   [in] int i_count - number of messages (1 at least)
+	 * Return:		Pointer after the last written byte
+#############################################################################*/
+static char* gsi_build_parse_encode_json_batch(char* p_out, struct gsi_json_msg* p_json_msgs, int i_count)
+{
+	int i_index = 0;
+
+	*p_out++ = '[';
+
+	// The '\0' after each message is its separator
+	for (i_index = 0; i_index < i_count; ++i_index)
+	{
+		p_out += gsi_is_encode_msg(p_out, &p_json_msgs[i_index], GSI_ENC_JSON);
+		p_out[-1] = ',';
+	}
+
+	// Last ',' is the end of array
+	p_out[-1] = ']';
+	*p_out++ = '\0';
+
+	return p_out;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_encode_binary_batch
+	 * Description: Write messages as binary batch - varint of count, then per message
+	 * 				varint of its length and the message
+	 * Parameter:   [out] char* p_out - buffer of GSI_IS_BIN_VARINT_LEN + gsi_is_encode_bound()
+	 * 								   and GSI_IS_BIN_VARINT_LEN of each message
+	 * Parameter:   [in] struct gsi_json_msg* p_json_msgs - messages to encode
+	 * Parameter:   [in] int i_count - number of messages
+	 * Return:		Pointer after the last written byte
+#############################################################################*/
+static char* gsi_build_parse_encode_binary_batch(char* p_out, struct gsi_json_msg* p_json_msgs, int i_count)
+{
+	char* p_msg_end = NULL;
+	size_t ul_len = 0;
+	int i_index = 0;
+
+	p_out = (char *)gsi_build_parse_encode_varint((unsigned char *)p_out, (unsigned int)i_count);
+
+	for (i_index = 0; i_index < i_count; ++i_index)
+	{
+		// Length is known after the message - write it after room for the longest varint
+		ul_len = gsi_is_encode_msg(p_out + GSI_IS_BIN_VARINT_LEN, &p_json_msgs[i_index], GSI_ENC_BINARY);
+
+		p_msg_end = (char *)gsi_build_parse_encode_varint((unsigned char *)p_out, (unsigned int)ul_len);
+		memmove(p_msg_end, p_out + GSI_IS_BIN_VARINT_LEN, ul_len);
+
+		p_out = p_msg_end + ul_len;
+	}
+
+	return p_out;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_next_json_object
+	 * Description: Find the next object of JSON batch and end it by '\0' in place
+	 * 				(over the white space or separator after it)
+	 * Parameter:   [in] struct gsi_json_batch* p_batch - received JSON batch
+	 * Parameter:   [out] char** p_obj - start of object
+	 * Parameter:   [out] size_t* p_obj_len - length of object (without the '\0')
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_READ_ERROR (end of array) *OR* GSI_JSON_ERROR (bad array)
+#############################################################################*/
+static int gsi_build_parse_next_json_object(struct gsi_json_batch* p_batch, char** p_obj, size_t* p_obj_len)
+{
+	char* p_cur = p_batch->p_recv_buf + p_batch->ul_pos;
+	const char* p_sep = NULL;
+	int i_depth = 0;
+	int i_in_string = 0;
+
+	p_cur = (char *)gsi_build_parse_fast_skip_ws(p_cur);
+	if (']' == *p_cur)
+	{
+		return GSI_JSON_READ_ERROR;
+	}
+
+	if ('{' != *p_cur)
+	{
+		return GSI_JSON_ERROR;
+	}
+
+	*p_obj = p_cur;
+
+	// Find the matching '}' - brackets in strings are not counted
+	for (; '\0' != *p_cur; ++p_cur)
+	{
+		if (i_in_string)
+		{
+			if (('\\' == *p_cur) && ('\0' != p_cur[1]))
+			{
+				++p_cur;
+			}
+			else if ('"' == *p_cur)
+			{
+				i_in_string = 0;
+			}
+		}
+		else if ('"' == *p_cur)
+		{
+			i_in_string = 1;
+		}
+		else if (('{' == *p_cur) || ('[' == *p_cur))
+		{
+			++i_depth;
+		}
+		else if ((('}' == *p_cur) || (']' == *p_cur)) && (0 == --i_depth))
+		{
+			break;
+		}
+	}
+
+	if ('}' != *p_cur)
+	{
+		return GSI_JSON_ERROR;
+	}
+
+	// Object is followed by ',' or by the end of array
+	++p_cur;
+	*p_obj_len = p_cur - *p_obj;
+
+	p_sep = gsi_build_parse_fast_skip_ws(p_cur);
+	if ((',' != *p_sep) && (']' != *p_sep))
+	{
+		return GSI_JSON_ERROR;
+	}
+
+	// Last object - the ']' may be the place of '\0'
+	if (']' == *p_sep)
+	{
+		p_batch->ui_left = 1;
+	}
+
+	p_batch->ul_pos = p_sep + 1 - p_batch->p_recv_buf;
+	*p_cur = '\0';
+
+	return GSI_JSON_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_convert_msg
+	 * Description: Convert message content to json-msg object (see gsi_is_parse_json_msg()).
+	 * 				In place - the one pass parser decodes the strings into s_json itself
+	 * 				and the json-msg strings are views into it (s_json MUST be writable
+	 * 				and live until gsi_build_parse_reset_object()).
+	 * Parameter:   [in] const char* s_json - message content ('\0' terminated)
+	 * Parameter:   [in] size_t ul_len - length of message content
+	 * Parameter:   [in] int i_in_place - decode strings in place (views) instead of copy
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_convert_msg(const char* s_json, size_t ul_len, int i_in_place, struct gsi_json_msg* p_json_msg)
+{
+	struct json_object *p_json = NULL;
+	int i_rc = GSI_JSON_SUCCESS;
+
+	// Parse the known layout in one pass, without json object
+	i_rc = gsi_build_parse_fast_parse(s_json, ul_len, i_in_place, p_json_msg);
+	if (GSI_JSON_UNKNOWN_LAYOUT != i_rc)
+	{
+		if (GSI_JSON_SUCCESS != i_rc)
+		{
+			LOG_ERROR("convert message to json-msg failed");
+			return GSI_JSON_ERROR;
+		}
+
+		return GSI_JSON_SUCCESS;
+	}
+
+	LOG_DEBUG("unknown layout of message, parse it with json-c");
+
+	// Convert string to json object using JSON-C library functions
+	if (GSI_JSON_SUCCESS != gsi_build_parse_string_to_json_object((char *)s_json, &p_json))
+	{
+		LOG_ERROR("convert string to json object failed");
+
+		json_object_put(p_json);
+
+		return GSI_JSON_ERROR;
+	}
+
+	// Convert json object to json-msg object using JSON-C library functions
+	if (GSI_JSON_SUCCESS != gsi_build_parse_json_object_to_json_msg(p_json, p_json_msg))
+	{
+		LOG_ERROR("convert json object to json-msg failed");
+
+		json_object_put(p_json);
+
+		return GSI_JSON_ERROR;
+	}
+
+	// Free the json object
+	json_object_put(p_json);
+
+	return GSI_JSON_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_fast_parse
+	 * Description: Parse message in one pass, for the known layout only:
+	 * 				object of known keys with int / string / null values.
+	 * 				Long messages are first indexed (64 bytes per step, with UTF-8
+	 * 				check) so the ends of long strings are found without reading them.
+	 * 				p_json_msg and s_json are not changed if the layout is unknown.
+	 * Parameter:   [in] const char* s_json - message content ('\0' terminated)
+	 * Parameter:   [in] size_t ul_len - length of message content
+	 * Parameter:   [in] int i_in_place - decode strings into s_json (views)
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_UNKNOWN_LAYOUT (use json-c) *OR* GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_fast_parse(const char* s_json, size_t ul_len, int i_in_place, struct gsi_json_msg* p_json_msg)
+{
+	struct gsi_build_parse_fast_ctx ctx;
+	int i_rc = GSI_JSON_SUCCESS;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.s_json = s_json;
+	ctx.i_in_place = i_in_place;
+
+	// Long message - find strings by structural index, bad UTF-8 is left to json-c
+	if (GSI_IS_JSON_INDEX_MIN_LEN <= ul_len)
+	{
+		if (GSI_JI_RC_SUCCESS != gsi_json_index_build(&ctx.index, s_json, ul_len))
+		{
+			gsi_json_index_free(&ctx.index);
+			return GSI_JSON_UNKNOWN_LAYOUT;
+		}
+
+		ctx.i_indexed = 1;
+	}
+
+	i_rc = gsi_build_parse_fast_parse_object(&ctx, p_json_msg);
+
+	gsi_json_index_free(&ctx.index);
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_fast_parse_object
+	 * Description: Parse the message object. Keys are matched by packed tag,
+	 * 				strings are decoded only if the op code needs them.
+	 * Parameter:   [in] struct gsi_build_parse_fast_ctx* p_ctx - message and its index
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_UNKNOWN_LAYOUT (use json-c) *OR* GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_fast_parse_object(struct gsi_build_parse_fast_ctx* p_ctx, struct gsi_json_msg* p_json_msg)
+{
+	struct gsi_build_parse_value values[GSI_KEY_COUNT];
+	struct gsi_build_parse_value value;
+	const struct gsi_build_parse_key_entry* p_entry = NULL;
+	const char* p_cur = NULL;
+	const char* p_key = NULL;
+	size_t ul_key_len = 0;
+
+	memset(values, 0, sizeof(values));
+
+	p_cur = gsi_build_parse_fast_skip_ws(p_ctx->s_json);
+	if ('{' != *p_cur)
 	{
-		LOG_ERROR("invalid argument!");
-		return GSI_JSON_INVALID_ERR;
+		return GSI_JSON_UNKNOWN_LAYOUT;
 	}
 
-	switch (p_json_msg->i_op_code)
+	p_cur = gsi_build_parse_fast_skip_ws(p_cur + 1);
+
+	// For each "<KEY>":<VALUE>
+	while ('}' != *p_cur)
 	{
-		case GSI_READ_STR:
-			// Get index
-			p_json_msg->i_index = json_object_get_int(json_object_object_get(p_json, "Index"));
-			break;
+		// Key - no escapes in known keys
+		if ('"' != *p_cur)
+		{
+			return GSI_JSON_UNKNOWN_LAYOUT;
+		}
 
-		case GSI_WRITE_STR:
-			// Get index and data length
-			p_json_msg->i_index    = json_object_get_int(json_object_object_get(p_json, "Index"));
-			p_json_msg->i_data_len = json_object_get_int(json_object_object_get(p_json, "Data Length"));
+		p_key = ++p_cur;
+		while ((0x20 <= (unsigned char)*p_cur) && ('"' != *p_cur) && ('\\' != *p_cur))
+		{
+			++p_cur;
+		}
 
-			// Duplicate the data
-			p_json_msg->s_data = gsi_build_parse_strdup(json_object_get_string(json_object_object_get(p_json, "Data")));
-			if (NULL == p_json_msg->s_data)
-			{
-				return GSI_JSON_ERROR;
-			}
+		if ('"' != *p_cur)
+		{
+			return GSI_JSON_UNKNOWN_LAYOUT;
+		}
 
-			break;
+		ul_key_len = p_cur - p_key;
 
-		case GSI_READ_FILE:
-	    case GSI_PRINT_LOG:
-			// Get file name length
-			p_json_msg->i_file_len 	= json_object_get_int(json_object_object_get(p_json, "File Length"));
+		p_entry = gsi_build_parse_find_key(p_key, ul_key_len);
+		if (NULL == p_entry)
+		{
+			return GSI_JSON_UNKNOWN_LAYOUT;
+		}
 
-			// Duplicate the file name
-			p_json_msg->s_file_name = gsi_build_parse_strdup(json_object_get_string(json_object_object_get(p_json, "File Name")));
-			if (NULL == p_json_msg->s_file_name)
-			{
-				return GSI_JSON_ERROR;
-			}
+		p_cur = gsi_build_parse_fast_skip_ws(p_cur + 1);
+		if (':' != *p_cur)
+		{
+			return GSI_JSON_UNKNOWN_LAYOUT;
+		}
 
-			break;
+		p_cur = gsi_build_parse_fast_skip_ws(p_cur + 1);
+
+		// Value
+		memset(&value, 0, sizeof(value));
+
+		if ('"' == *p_cur)
+		{
+			value.i_type = GSI_VALUE_STRING;
+			p_cur = gsi_build_parse_fast_scan_string(p_ctx, p_cur + 1, &value);
+		}
+		else if (('-' == *p_cur) || isdigit((unsigned char)*p_cur))
+		{
+			value.i_type = GSI_VALUE_INT;
+			p_cur = gsi_build_parse_fast_scan_int(p_cur, &value.i_value);
+		}
+		else if (0 == strncmp(p_cur, "null", 4))
+		{
+			value.i_type = GSI_VALUE_NULL;
+			p_cur += 4;
+		}
+		else
+		{
+			return GSI_JSON_UNKNOWN_LAYOUT;
+		}
 
-		case GSI_WRITE_FILE:
-		case GSI_READ_FILE_BY_ID:
+		// Bad value or other type than expected
+		if ((NULL == p_cur) || ((GSI_VALUE_NULL != value.i_type) && (p_entry->i_type != value.i_type)))
+		{
+			return GSI_JSON_UNKNOWN_LAYOUT;
+		}
 
-			// Get source file length
-			p_json_msg->i_file_len 	= json_object_get_int(json_object_object_get(p_json, "File Length"));
+		// Same key twice - last wins
+		values[p_entry->i_key] = value;
 
-			// Duplicate the source file name
-			p_json_msg->s_file_name = gsi_build_parse_strdup(json_object_get_string(json_object_object_get(p_json, "File Name")));
-			if (NULL == p_json_msg->s_file_name)
-			{
-				LOG_ERROR("memory allocation for s_file_name failed");
-				return GSI_JSON_ERROR;
-			}
+		p_cur = gsi_build_parse_fast_skip_ws(p_cur);
+		if (',' == *p_cur)
+		{
+			p_cur = gsi_build_parse_fast_skip_ws(p_cur + 1);
+		}
+		else if ('}' != *p_cur)
+		{
+			return GSI_JSON_UNKNOWN_LAYOUT;
+		}
+	}
+
+	// Nothing but white space after the object
+	if ('\0' != *gsi_build_parse_fast_skip_ws(p_cur + 1))
+	{
+		return GSI_JSON_UNKNOWN_LAYOUT;
+	}
 
-			// Get destination file length
-			p_json_msg->i_data_len = json_object_get_int(json_object_object_get(p_json, "Data Length"));
+	return gsi_build_parse_fill_msg(values, p_ctx->i_in_place, p_json_msg);
+}
 
-			// Duplicate the destination file name
-			p_json_msg->s_data = gsi_build_parse_strdup(json_object_get_string(json_object_object_get(p_json, "Data")));
-			if (NULL == p_json_msg->s_data)
-			{
-				free(p_json_msg->s_file_name);
-				p_json_msg->s_file_name = NULL;
+/*###########################################################################
+	 * Name:		gsi_build_parse_find_key
+	 * Description: Find message key by its packed tag (length and first 2 chars),
+	 * 				cases are made from GSI_IS_MSG_FIELDS
+	 * Parameter:   [in] const char* p_key - key in message (not '\0' terminated)
+	 * Parameter:   [in] size_t ul_len - length of key
+	 * Return:		Success - entry of key
+	 * 				Failure - NULL (unknown key)
+#############################################################################*/
+static const struct gsi_build_parse_key_entry* gsi_build_parse_find_key(const char* p_key, size_t ul_len)
+{
+	const struct gsi_build_parse_key_entry* p_entry = NULL;
 
-				return GSI_JSON_ERROR;
-			}
+	if ((2 > ul_len) || (UCHAR_MAX < ul_len))
+	{
+		return NULL;
+	}
 
+#define 	GSI_IS_KEY_CASE(key, s_key, c0, c1, type, member, bin, ui_field) \
+		case GSI_IS_KEY_TAG(c0, c1, sizeof(s_key) - 1): \
+			p_entry = &g_json_msg_keys[key]; \
 			break;
 
+	switch (GSI_IS_KEY_TAG(p_key[0], p_key[1], ul_len))
+	{
+		GSI_IS_MSG_FIELDS(GSI_IS_KEY_CASE)
+
 		default:
-			LOG_ERROR("invalid operation code");
-			return GSI_JSON_ERROR;
+			return NULL;
+	}
+
+	// Same tag, other key
+	if (0 != memcmp(p_key, p_entry->s_name, ul_len))
+	{
+		return NULL;
+	}
+
+	return p_entry;
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_fill_msg
+	 * Description: Initialize fields in json-msg object from parsed values
+	 * 				(of JSON, json-c or binary message), the fields of every op code
+	 * 				and the ones of operation code (GSI_IS_OP_CODES).
+	 * 				Strings the op code uses must be in the message.
+	 * Parameter:   [in] const struct gsi_build_parse_value* p_values - values by key
+	 * Parameter:   [in] int i_in_place - strings are views into the message
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
+	 * Return: 		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_build_parse_fill_msg(const struct gsi_build_parse_value* p_values, int i_in_place,
+									struct gsi_json_msg* p_json_msg)
+{
+	unsigned int ui_fields = 0;
+	unsigned int ui_filled = 0;
+
+	if (GSI_JSON_SUCCESS != gsi_build_parse_get_op_fields(p_values[GSI_KEY_OP_CODE].i_value, &ui_fields))
+	{
+		LOG_ERROR("invalid operation code");
+		return GSI_JSON_ERROR;
+	}
+
+	// Missing and null numbers are 0
+#define 	GSI_IS_FILL_INT(key, member, ui_field) \
+	p_json_msg->member = p_values[key].i_value;
+#define 	GSI_IS_FILL_STRING(key, member, ui_field) \
+	p_json_msg->member = gsi_build_parse_fast_get_string(&p_values[key], i_in_place); \
+	if (NULL == p_json_msg->member) \
+	{ \
+		gsi_build_parse_free_strings(p_json_msg, ui_filled, i_in_place); \
+		return GSI_JSON_ERROR; \
+	} \
+	ui_filled |= (ui_field);
+#define 	GSI_IS_FILL_OP_STR(key, member, ui_field)
+#define 	GSI_IS_FILL_FIELD(key, s_key, c0, c1, type, member, bin, ui_field) \
+	if ((0 == (ui_field)) || ((ui_field) & ui_fields)) \
+	{ \
+		GSI_IS_FILL_##type(key, member, ui_field) \
+	}
+
+	GSI_IS_MSG_FIELDS(GSI_IS_FILL_FIELD)
+
+	// Strings are views into the message (freed with it, not by themselves)
+	if (i_in_place)
+	{
+		p_json_msg->i_views = GSI_JSON_VIEW_FILE_NAME | GSI_JSON_VIEW_DATA;
 	}
 
 	return GSI_JSON_SUCCESS;
 }
 
 /*###########################################################################
-	 * Name:		gsi_build_parse_get_src_file
-	 * Description: Extract the source file name from the current line and moves the pointer forward
-	 * 				The delimiter to stop extraction is white space: ' '
-	 * Parameter:   [in] char** s_line - address of current line
-	 * Return:		Success - char* - source file name
-	 * 				Failure - NULL
+	 * Name:		gsi_build_parse_free_strings
+	 * Description: Free strings of json-msg filled before failure (views are not freed)
+	 * Parameter:   [in-out] struct gsi_json_msg* p_json_msg - json-msg object
+	 * Parameter:   [in] unsigned int ui_fields - filled strings (gsi_is_json_field)
+	 * Parameter:   [in] int i_in_place - strings are views into the message
+	 * Return: 		None
 #############################################################################*/
-static char* gsi_build_parse_get_file_name(char** s_line)
+static void gsi_build_parse_free_strings(struct gsi_json_msg* p_json_msg, unsigned int ui_fields, int i_in_place)
 {
-	char* s_src_file = NULL;
-	char* s_runner = NULL;
+#define 	GSI_IS_FREE_INT(member, ui_field)
+#define 	GSI_IS_FREE_OP_STR(member, ui_field)
+#define 	GSI_IS_FREE_STRING(member, ui_field) \
+	if ((ui_field) & ui_fields) \
+	{ \
+		if (!i_in_place) \
+		{ \
+			free(p_json_msg->member); \
+		} \
+		p_json_msg->member = NULL; \
+	}
+#define 	GSI_IS_FREE_FIELD(key, s_key, c0, c1, type, member, bin, ui_field) GSI_IS_FREE_##type(member, ui_field)
+
+	GSI_IS_MSG_FIELDS(GSI_IS_FREE_FIELD)
+}
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_fast_get_string
+	 * Description: Decode string value to new allocated string (MUST be freed),
+	 * 				or in place - over the string in message (decoded string is never
+	 * 				longer than the escaped one, and it ends on the closing '"').
+	 * Parameter:   [in] const struct gsi_build_parse_value* p_value - string value
+	 * Parameter:   [in] int i_in_place - decode into the message (view, NOT to be freed)
+	 * Return:		Success - decoded string
+	 * 				Failure - NULL (null / missing value *OR* allocation failed)
+#############################################################################*/
+static char* gsi_build_parse_fast_get_string(const struct gsi_build_parse_value* p_value, int i_in_place)
+{
+	const char* p_cur = p_value->p_str;
+	const char* p_end = p_value->p_str + p_value->ul_len;
+	unsigned int ui_code = 0;
+	char* s_dest = NULL;
+	char* p_out = NULL;
 
 	// Check input validation
-	if (NULL == s_line)
+	if (GSI_VALUE_STRING != p_value->i_type)
 	{
 		LOG_ERROR("invalid argument!");
 		return NULL;
 	}
 
-	//Skip all white space before the file name
-	while (('\0' != **s_line) && (isspace(**s_line)))
+	if (i_in_place)
 	{
-		++(*s_line);
+		// Message is writable (given by gsi_is_recv_json_msg())
+		s_dest = (char *)p_value->p_str;
 	}
+	else
+	{
+		// Decoded string is never longer than the escaped one
+		s_dest = (char *)malloc(p_value->ul_len + 1);
+		if (NULL == s_dest)
+		{
+			LOG_ERROR("memory allocation for string failed");
+			return NULL;
+		}
 
-	// Start point to hold the name of the file
-	s_src_file = *s_line;
+		// Nothing to decode
+		if (!p_value->i_escaped)
+		{
+			memcpy(s_dest, p_value->p_str, p_value->ul_len);
+		}
+	}
 
-	// Runner pointer to run until meet white space
-	s_runner = s_src_file;
+	// Nothing to decode - just end the string (on the closing '"' when in place)
+	if (!p_value->i_escaped)
+	{
+		s_dest[p_value->ul_len] = '\0';
+		return s_dest;
+	}
 
-	// Main run loop
-	while (!isspace(*s_runner) && ('\n' != *s_runner))
+	p_out = s_dest;
+	while (p_cur < p_end)
 	{
-		++s_runner;
+		if ('\\' != *p_cur)
+		{
+			*p_out++ = *p_cur++;
+			continue;
+		}
+
+		// Escape sequence was checked by gsi_build_parse_fast_scan_string()
+		++p_cur;
+		switch (*p_cur++)
+		{
+			case 'b':
+				*p_out++ = '\b';
+				break;
+
+			case 'f':
+				*p_out++ = '\f';
+				break;
+
+			case 'n':
+				*p_out++ = '\n';
+				break;
+
+			case 'r':
+				*p_out++ = '\r';
+				break;
+
+			case 't':
+				*p_out++ = '\t';
+				break;
+
+			case 'u':
+				p_cur = gsi_build_parse_fast_scan_unicode(p_cur, &ui_code);
+
+				// Write code point as UTF-8
+				if (0x80 > ui_code)
+				{
+					*p_out++ = (char)ui_code;
+				}
+				else if (0x800 > ui_code)
+				{
+					*p_out++ = (char)(0xC0 | (ui_code >> 6));
+					*p_out++ = (char)(0x80 | (ui_code & 0x3F));
+				}
+				else if (0x10000 > ui_code)
+				{
+					*p_out++ = (char)(0xE0 | (ui_code >> 12));
+					*p_out++ = (char)(0x80 | ((ui_code >> 6) & 0x3F));
+					*p_out++ = (char)(0x80 | (ui_code & 0x3F));
+				}
+				else
+				{
+					*p_out++ = (char)(0xF0 | (ui_code >> 18));
+					*p_out++ = (char)(0x80 | ((ui_code >> 12) & 0x3F));
+					*p_out++ = (char)(0x80 | ((ui_code >> 6) & 0x3F));
+					*p_out++ = (char)(0x80 | (ui_code & 0x3F));
+				}
+
+				break;
+
+			default:
+				// '"', '\\' and '/'
+				*p_out++ = p_cur[-1];
+				break;
+		}
 	}
 
-	// Split the string in the current position
-	*s_runner = '\0';
+	*p_out = '\0';
 
-	// Move the original pointer by length of the file name
-	*s_line += strlen(s_src_file) + 1;
+	return s_dest;
+}
 
-	return s_src_file;
+/*###########################################################################
+	 * Name:		gsi_build_parse_fast_skip_ws
+	 * Description: Skip JSON white space
+	 * Parameter:   [in] const char* p_cur - current position
+	 * Return:		Position of first char that is not white space
+#############################################################################*/
+static const char* gsi_build_parse_fast_skip_ws(const char* p_cur)
+{
+	while (GSI_IS_JSON_IS_WS(*p_cur))
+	{
+		++p_cur;
+	}
+
+	return p_cur;
 }
 
 /*###########################################################################
-	 * Name:		gsi_build_parse_strdup
-	 * Description:	Duplicate a string. using dynamic memory allocation. must free by the user
-	 * Parameter:   [in] char* s_src - source string
-	 * Return:		Success - duplicate string
-	 * 				Failure - NULL
+	 * Name:		gsi_build_parse_fast_scan_int
+	 * Description: Scan integer number, out of range values are clamped
+	 * 				to int (as json_object_get_int()).
+	 * Parameter:   [in] const char* p_cur - first char of number
+	 * Parameter:   [out] int* p_value - value of number
+	 * Return:		Success - position after the number
+	 * 				Failure - NULL (not an integer or too long)
 #############################################################################*/
-static char* gsi_build_parse_strdup(const char* s_src)
+static const char* gsi_build_parse_fast_scan_int(const char* p_cur, int* p_value)
 {
-	char* s_dest = NULL;
+	long l_value = 0;
+	int i_negative = 0;
+	int i_digits = 0;
 
-	// Check input validation
-	if (NULL == s_src)
+	if ('-' == *p_cur)
+	{
+		i_negative = 1;
+		++p_cur;
+	}
+
+	// At least one digit, no leading zeros
+	if ((!isdigit((unsigned char)p_cur[0])) || (('0' == p_cur[0]) && isdigit((unsigned char)p_cur[1])))
 	{
-		LOG_ERROR("invalid argument!");
 		return NULL;
 	}
 
-	// Allocate memory for the destination
-	s_dest = (char *)malloc(strlen(s_src) + 1);
-	if (NULL == s_dest)
+	for (; isdigit((unsigned char)*p_cur); ++p_cur)
+	{
+		if (GSI_IS_MAX_INT_DIGITS < ++i_digits)
+		{
+			return NULL;
+		}
+
+		l_value = (l_value * 10) + (*p_cur - '0');
+	}
+
+	// Fraction or exponent
+	if (('.' == *p_cur) || ('e' == *p_cur) || ('E' == *p_cur))
 	{
-		LOG_ERROR("memory allocation in for dupliaction failed");
 		return NULL;
 	}
 
-	// Copy content
-	strcpy(s_dest, s_src);
+	if (i_negative)
+	{
+		l_value = -l_value;
+	}
 
-	return s_dest;
+	*p_value = (INT_MAX < l_value) ? INT_MAX : ((INT_MIN > l_value) ? INT_MIN : (int)l_value);
+
+	return p_cur;
 }
 
 /*###########################################################################
-	 * Name:		gsi_build_parse_op_code_to_string
-	 * Description: Convert op-code to string
-	 * Parameter:   [in] int i_op_code - op code number
-	 * Return:		Success - op code as string literal
-	 * 				Failure - NULL
+	 * Name:		gsi_build_parse_fast_scan_string
+	 * Description: Find end of string and check its escape sequences.
+	 * 				With index the closing quote is the next offset after the
+	 * 				opening one, and only the backslashes are visited.
+	 * Parameter:   [in] struct gsi_build_parse_fast_ctx* p_ctx - message and its index
+	 * Parameter:   [in] const char* p_cur - first char after the '"'
+	 * Parameter:   [out] struct gsi_build_parse_value* p_value - string value to fill
+	 * Return:		Success - position after the closing '"'
+	 * 				Failure - NULL (end of message, control char or bad escape)
 #############################################################################*/
-static char* gsi_build_parse_op_code_to_string(int i_op_code)
+static const char* gsi_build_parse_fast_scan_string(struct gsi_build_parse_fast_ctx* p_ctx, const char* p_cur,
+														struct gsi_build_parse_value* p_value)
 {
-	switch(i_op_code)
+	const unsigned int* p_positions = p_ctx->index.p_positions;
+	unsigned int ui_open = 0;
+	const char* p_end = NULL;
+
+	p_value->p_str = p_cur;
+
+	if (p_ctx->i_indexed)
+	{
+		// Skip offsets of keys and structural chars before the opening quote
+		ui_open = (unsigned int)(p_cur - 1 - p_ctx->s_json);
+		while ((p_ctx->ul_next < p_ctx->index.ul_count) && (p_positions[p_ctx->ul_next] < ui_open))
+		{
+			++p_ctx->ul_next;
+		}
+
+		if ((p_ctx->ul_next + 1 >= p_ctx->index.ul_count) || (ui_open != p_positions[p_ctx->ul_next]))
+		{
+			return NULL;
+		}
+
+		p_end = p_ctx->s_json + p_positions[p_ctx->ul_next + 1];
+		p_ctx->ul_next += 2;
+
+		// Control chars were checked by index - check escape sequences only
+		p_cur = (const char*)memchr(p_cur, '\\', p_end - p_cur);
+		while (NULL != p_cur)
+		{
+			p_value->i_escaped = 1;
+
+			p_cur = gsi_build_parse_fast_check_escape(p_cur + 1);
+			if (NULL == p_cur)
+			{
+				return NULL;
+			}
+
+			p_cur = (const char*)memchr(p_cur, '\\', p_end - p_cur);
+		}
+
+		p_value->ul_len = p_end - p_value->p_str;
+
+		return p_end + 1;
+	}
+
+	while (1)
 	{
-		case GSI_READ_STR:
-			return "READ_STR";
+		// Skip plain chars
+		while ((0x20 <= (unsigned char)*p_cur) && ('"' != *p_cur) && ('\\' != *p_cur))
+		{
+			++p_cur;
+		}
+
+		if ('"' == *p_cur)
+		{
+			break;
+		}
 
-		case GSI_WRITE_STR:
-			return "WRITE_STR";
+		// '\0' or raw control char
+		if ('\\' != *p_cur)
+		{
+			return NULL;
+		}
+
+		p_value->i_escaped = 1;
+
+		p_cur = gsi_build_parse_fast_check_escape(p_cur + 1);
+		if (NULL == p_cur)
+		{
+			return NULL;
+		}
+	}
 
-		case GSI_READ_FILE:
-			return "READ_FILE";
+	p_value->ul_len = p_cur - p_value->p_str;
 
-		case GSI_PRINT_LOG:
-			return "PRINT_LOG";
+	return p_cur + 1;
+}
 
-		case GSI_WRITE_FILE:
-			return "WRITE_FILE";
+/*###########################################################################
+	 * Name:		gsi_build_parse_fast_check_escape
+	 * Description: Check one escape sequence
+	 * Parameter:   [in] const char* p_cur - first char after the '\'
+	 * Return:		Success - position after the sequence
+	 * 				Failure - NULL (unknown escape or bad "\uXXXX")
+#############################################################################*/
+static const char* gsi_build_parse_fast_check_escape(const char* p_cur)
+{
+	unsigned int ui_code = 0;
 
-		case GSI_READ_FILE_BY_ID:
-			return "READ_STR_BY_ID";
+	switch (*p_cur)
+	{
+		case '"':
+		case '\\':
+		case '/':
+		case 'b':
+		case 'f':
+		case 'n':
+		case 'r':
+		case 't':
+			return p_cur + 1;
+
+		case 'u':
+			return gsi_build_parse_fast_scan_unicode(p_cur + 1, &ui_code);
 
 		default:
 			return NULL;
 	}
 }
+
+/*###########################################################################
+	 * Name:		gsi_build_parse_fast_scan_unicode
+	 * Description: Scan the hex digits of "\uXXXX", with the low half of
+	 * 				surrogate pair if needed ("\uD83D\uDE00")
+	 * Parameter:   [in] const char* p_cur - first hex digit
+	 * Parameter:   [out] unsigned int* p_code - code point
+	 * Return:		Success - position after the sequence
+	 * 				Failure - NULL (bad hex digits or lone surrogate)
+#############################################################################*/
+static const char* gsi_build_parse_fast_scan_unicode(const char* p_cur, unsigned int* p_code)
+{
+	unsigned int ui_low = 0;
+	int i = 0;
+
+	*p_code = 0;
+	for (i = 0; i < 4; ++i, ++p_cur)
+	{
+		if (!isxdigit((unsigned char)*p_cur))
+		{
+			return NULL;
+		}
+
+		*p_code = (*p_code << 4) | (isdigit((unsigned char)*p_cur) ? (*p_cur - '0') : ((tolower((unsigned char)*p_cur) - 'a') + 10));
+	}
+
+	// Lone low surrogate
+	if ((0xDC00 <= *p_code) && (0xDFFF >= *p_code))
+	{
+		return NULL;
+	}
+
+	// High surrogate must be followed by low surrogate
+	if ((0xD800 <= *p_code) && (0xDBFF >= *p_code))
+	{
+		if (('\\' != p_cur[0]) || ('u' != p_cur[1]))
+		{
+			return NULL;
+		}
+
+		p_cur += 2;
+		for (i = 0; i < 4; ++i, ++p_cur)
+		{
+			if (!isxdigit((unsigned char)*p_cur))
+			{
+				return NULL;
+			}
+
+			ui_low = (ui_low << 4) | (isdigit((unsigned char)*p_cur) ? (*p_cur - '0') : ((tolower((unsigned char)*p_cur) - 'a') + 10));
+		}
+
+		if ((0xDC00 > ui_low) || (0xDFFF < ui_low))
+		{
+			return NULL;
+		}
+
+		*p_code = 0x10000 + ((*p_code - 0xD800) << 10) + (ui_low - 0xDC00);
+	}
+
+	return p_cur;
+}
@@ -4,5 +4,5 @@
 
 USER_OBJS :=
 
-LIBS := -lgsi-build-parse -lgsi-network-tcp -ljson-c -lgsi-logger -lgsi-parse-json-config -lgsi-thread-pool -pthread
+LIBS := -lgsi-build-parse -lgsi-json-index -lgsi-network-tcp -ljson-c -lgsi-logger -lgsi-thread-pool -pthread
 
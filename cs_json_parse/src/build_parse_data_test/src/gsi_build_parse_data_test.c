@@ -0,0 +1,758 @@
+/**************************************************************************
+* Name : gsi_build_parse_data_test.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Tests of the binary encoding of messages (gsi_build_parse_data.h):
+* 				round 	 - encode and decode give the same message (edge numbers, null strings)
+* 				truncate - every prefix of a message is rejected (varints and strings)
+* 				varint 	 - varints longer than 32 bits are rejected
+* 				string 	 - a string without its trailing '\0' is rejected
+* 				trailing - bytes after the message are rejected
+* 				fields 	 - strings needed by the op code and the op code itself are checked
+* 				batch 	 - binary and JSON batch frames give their messages in order
+* 				count 	 - batch count above GSI_IS_MAX_BATCH, truncated or overlong is rejected
+* 				framing  - truncated batch stops, a bad message doesn't stop the next ones
+* 				Usage : ./<a.out> (exit code - number of failed tests)
+*****************************************************************************/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "gsi_is_log_api.h"
+#include "gsi_build_parse_data.h"
+
+/* Defines and Macros */
+#define 	GSI_BPT_PASS			0
+#define 	GSI_BPT_FAIL			1
+#define 	GSI_BPT_BUF_SIZE		512
+#define 	GSI_BPT_BATCH_SIZE		(GSI_IS_MAX_BATCH * GSI_BPT_BUF_SIZE)
+#define 	GSI_BPT_MSGS			((int)(sizeof(g_a_msgs) / sizeof(g_a_msgs[0])))
+
+/* Global variables */
+static const struct gsi_json_msg g_a_msgs[] = {
+	{ GSI_REGULAR_MSG, GSI_READ_STR, 5000, INT_MIN, 0, 0, NULL, NULL, NULL, 0 },
+	{ GSI_REGULAR_MSG, GSI_WRITE_STR, 65535, INT_MAX, 11, 0, NULL, "new-message", NULL, 0 },
+	{ GSI_REGULAR_MSG, GSI_READ_FILE, 1, 0, 0, 5, "a.txt", NULL, NULL, 0 },
+	{ GSI_REGULAR_MSG, GSI_WRITE_FILE, 5001, 0, -1, 3, "log", "", NULL, 0 },
+	{ GSI_REGULAR_MSG, GSI_SEARCH_FILE, 5002, 0, INT_MIN, INT_MAX, "f", "id:1-9", NULL, 0 }
+};
+/********************************/
+/* Static functions declaration */
+/********************************/
+static size_t gsi_bpt_encode(char* p_out, const struct gsi_json_msg* p_json_msg);
+static int gsi_bpt_decode(const char* p_in, size_t ul_len, struct gsi_json_msg* p_json_msg);
+static int gsi_bpt_same_string(const char* s_a, const char* s_b);
+static int gsi_bpt_same_msg(const struct gsi_json_msg* p_a, const struct gsi_json_msg* p_b);
+static char* gsi_bpt_put_varint(char* p_out, unsigned int ui_value);
+static size_t gsi_bpt_binary_batch(char* p_out, unsigned int ui_count, int i_msgs);
+static size_t gsi_bpt_json_batch(char* p_out, int i_msgs);
+static int gsi_bpt_recv_frame(unsigned int ui_encoding, const char* p_content, size_t ul_len,
+							  struct gsi_json_batch* p_batch);
+static int gsi_bpt_next(struct gsi_json_batch* p_batch, struct gsi_json_msg* p_json_msg);
+static int gsi_bpt_take_all(struct gsi_json_batch* p_batch, int i_msgs);
+static int gsi_bpt_round();
+static int gsi_bpt_truncate();
+static int gsi_bpt_varint();
+static int gsi_bpt_string();
+static int gsi_bpt_trailing();
+static int gsi_bpt_fields();
+static int gsi_bpt_batch();
+static int gsi_bpt_count();
+static int gsi_bpt_framing();
+
+int main(int argc, char **argv)
+{
+	FILE* f_log = NULL;
+	int i_failed = 0;
+	int i = 0;
+
+	struct
+	{
+		const char* s_name;
+		int (*f_test)();
+	} a_tests[] = {
+		{ "round", gsi_bpt_round },
+		{ "truncate", gsi_bpt_truncate },
+		{ "varint", gsi_bpt_varint },
+		{ "string", gsi_bpt_string },
+		{ "trailing", gsi_bpt_trailing },
+		{ "fields", gsi_bpt_fields },
+		{ "batch", gsi_bpt_batch },
+		{ "count", gsi_bpt_count },
+		{ "framing", gsi_bpt_framing }
+	};
+
+	// Create log file (rejected messages are logged)
+	f_log = gsi_is_create_log_file("gsi-log-build-parse-data-test", NULL);
+	if (NULL == f_log)
+	{
+		return GSI_BPT_FAIL;
+	}
+
+	for (i = 0; i < (int)(sizeof(a_tests) / sizeof(a_tests[0])); ++i)
+	{
+		if (GSI_BPT_PASS == a_tests[i].f_test())
+		{
+			printf("%-8s PASS\n", a_tests[i].s_name);
+		}
+		else
+		{
+			printf("%-8s FAIL\n", a_tests[i].s_name);
+			++i_failed;
+		}
+	}
+
+	// Close log file to free resources
+	if (GSI_LOG_RC_SUCCESS != gsi_is_close_log(f_log))
+	{
+		printf("couldn't close log file");
+	}
+
+	return i_failed;
+}
+
+/***********************************/
+/* Static functions implementation */
+/***********************************/
+/*###########################################################################
+	 * Name:		gsi_bpt_round
+	 * Description: Every message decodes to the fields it was encoded from - the
+	 * 				numbers with INT_MIN/INT_MAX take the longest varints.
+	 * Return:		GSI_BPT_PASS *OR* GSI_BPT_FAIL
+#############################################################################*/
+static int gsi_bpt_round()
+{
+	char a_buf[GSI_BPT_BUF_SIZE];
+	struct gsi_json_msg json_msg;
+	const struct gsi_json_msg* p_msg = NULL;
+	size_t ul_len = 0;
+	int i = 0;
+
+	for (i = 0; i < GSI_BPT_MSGS; ++i)
+	{
+		p_msg = &g_a_msgs[i];
+		ul_len = gsi_bpt_encode(a_buf, p_msg);
+
+		if (GSI_JSON_SUCCESS != gsi_bpt_decode(a_buf, ul_len, &json_msg))
+		{
+			printf("round: message %d (%zu bytes) was not decoded\n", i, ul_len);
+			return GSI_BPT_FAIL;
+		}
+
+		if (!gsi_bpt_same_msg(p_msg, &json_msg))
+		{
+			printf("round: message %d was decoded with other fields\n", i);
+			return GSI_BPT_FAIL;
+		}
+	}
+
+	return GSI_BPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_truncate
+	 * Description: Every prefix of a message ends inside a varint or a string (the last
+	 * 				field ends the message) - none of them is decoded.
+	 * Return:		GSI_BPT_PASS *OR* GSI_BPT_FAIL
+#############################################################################*/
+static int gsi_bpt_truncate()
+{
+	char a_buf[GSI_BPT_BUF_SIZE];
+	struct gsi_json_msg json_msg;
+	size_t ul_len = 0;
+	size_t ul_prefix = 0;
+	int i = 0;
+
+	for (i = 0; i < GSI_BPT_MSGS; ++i)
+	{
+		ul_len = gsi_bpt_encode(a_buf, &g_a_msgs[i]);
+
+		for (ul_prefix = 1; ul_prefix < ul_len; ++ul_prefix)
+		{
+			if (GSI_JSON_SUCCESS == gsi_bpt_decode(a_buf, ul_prefix, &json_msg))
+			{
+				printf("truncate: message %d was decoded from %zu of %zu bytes\n", i, ul_prefix, ul_len);
+				return GSI_BPT_FAIL;
+			}
+		}
+	}
+
+	return GSI_BPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_varint
+	 * Description: Index of 5 bytes with more than 4 bits in the last one, and of
+	 * 				6 bytes, are rejected (the longest valid index is decoded by round).
+	 * Return:		GSI_BPT_PASS *OR* GSI_BPT_FAIL
+#############################################################################*/
+static int gsi_bpt_varint()
+{
+	char a_buf[GSI_BPT_BUF_SIZE];
+	struct gsi_json_msg json_msg;
+	size_t ul_len = 0;
+
+	// Read string with index INT_MIN - zigzag is UINT_MAX, 5 bytes right after the fixed ones
+	ul_len = gsi_bpt_encode(a_buf, &g_a_msgs[0]);
+	if ((9 > ul_len) || (0x0F != (unsigned char)a_buf[8]))
+	{
+		printf("varint: index is not a varint of 5 bytes\n");
+		return GSI_BPT_FAIL;
+	}
+
+	// 33 bits
+	a_buf[8] = 0x1F;
+	if (GSI_JSON_SUCCESS == gsi_bpt_decode(a_buf, ul_len, &json_msg))
+	{
+		printf("varint: index of 33 bits was decoded\n");
+		return GSI_BPT_FAIL;
+	}
+
+	// 6 bytes - zero of 32 bits with one more byte
+	memmove(a_buf + 10, a_buf + 9, ul_len - 9);
+	memcpy(a_buf + 4, "\x80\x80\x80\x80\x80\x00", 6);
+	if (GSI_JSON_SUCCESS == gsi_bpt_decode(a_buf, ul_len + 1, &json_msg))
+	{
+		printf("varint: index of 6 bytes was decoded\n");
+		return GSI_BPT_FAIL;
+	}
+
+	return GSI_BPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_string
+	 * Description: The last char of data (its '\0') is replaced - the length still
+	 * 				fits the message, but the string is not ended inside it.
+	 * Return:		GSI_BPT_PASS *OR* GSI_BPT_FAIL
+#############################################################################*/
+static int gsi_bpt_string()
+{
+	char a_buf[GSI_BPT_BUF_SIZE];
+	struct gsi_json_msg json_msg;
+	size_t ul_len = 0;
+
+	// Write string - data is the last field
+	ul_len = gsi_bpt_encode(a_buf, &g_a_msgs[1]);
+	a_buf[ul_len - 1] = 'x';
+
+	if (GSI_JSON_SUCCESS == gsi_bpt_decode(a_buf, ul_len, &json_msg))
+	{
+		printf("string: data without '\\0' was decoded\n");
+		return GSI_BPT_FAIL;
+	}
+
+	return GSI_BPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_trailing
+	 * Description: A message with one more byte (any value) is rejected.
+	 * Return:		GSI_BPT_PASS *OR* GSI_BPT_FAIL
+#############################################################################*/
+static int gsi_bpt_trailing()
+{
+	char a_buf[GSI_BPT_BUF_SIZE];
+	struct gsi_json_msg json_msg;
+	size_t ul_len = 0;
+	int i = 0;
+
+	for (i = 0; i < GSI_BPT_MSGS; ++i)
+	{
+		ul_len = gsi_bpt_encode(a_buf, &g_a_msgs[i]);
+		a_buf[ul_len] = '\0';
+
+		if (GSI_JSON_SUCCESS == gsi_bpt_decode(a_buf, ul_len + 1, &json_msg))
+		{
+			printf("trailing: message %d was decoded with a byte after it\n", i);
+			return GSI_BPT_FAIL;
+		}
+	}
+
+	return GSI_BPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_fields
+	 * Description: Well formed messages without the strings of their op code, or
+	 * 				with unknown op code, are rejected.
+	 * Return:		GSI_BPT_PASS *OR* GSI_BPT_FAIL
+#############################################################################*/
+static int gsi_bpt_fields()
+{
+	char a_buf[GSI_BPT_BUF_SIZE];
+	struct gsi_json_msg json_msg;
+	struct gsi_json_msg bad_msg;
+	size_t ul_len = 0;
+
+	// Write string without data
+	bad_msg = g_a_msgs[1];
+	bad_msg.s_data = NULL;
+	ul_len = gsi_bpt_encode(a_buf, &bad_msg);
+
+	if (GSI_JSON_SUCCESS == gsi_bpt_decode(a_buf, ul_len, &json_msg))
+	{
+		printf("fields: write string without data was decoded\n");
+		return GSI_BPT_FAIL;
+	}
+
+	// Search file without file name
+	bad_msg = g_a_msgs[4];
+	bad_msg.s_file_name = NULL;
+	ul_len = gsi_bpt_encode(a_buf, &bad_msg);
+
+	if (GSI_JSON_SUCCESS == gsi_bpt_decode(a_buf, ul_len, &json_msg))
+	{
+		printf("fields: search file without file name was decoded\n");
+		return GSI_BPT_FAIL;
+	}
+
+	// Unknown op code
+	ul_len = gsi_bpt_encode(a_buf, &g_a_msgs[0]);
+	a_buf[1] = (char)(GSI_SEARCH_FILE + 1);
+
+	if (GSI_JSON_SUCCESS == gsi_bpt_decode(a_buf, ul_len, &json_msg))
+	{
+		printf("fields: unknown op code was decoded\n");
+		return GSI_BPT_FAIL;
+	}
+
+	return GSI_BPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_batch
+	 * Description: Binary and JSON batches of the messages, and a binary batch of
+	 * 				GSI_IS_MAX_BATCH messages, give every message in order and then
+	 * 				"no more messages".
+	 * Return:		GSI_BPT_PASS *OR* GSI_BPT_FAIL
+#############################################################################*/
+static int gsi_bpt_batch()
+{
+	static char a_buf[GSI_BPT_BATCH_SIZE];
+	struct gsi_json_batch batch;
+	size_t ul_len = 0;
+	int i_rc = GSI_BPT_PASS;
+
+	ul_len = gsi_bpt_binary_batch(a_buf, GSI_BPT_MSGS, GSI_BPT_MSGS);
+	if ((GSI_JSON_SUCCESS != gsi_bpt_recv_frame(GSI_ENC_BINARY, a_buf, ul_len, &batch)) ||
+		(GSI_BPT_PASS != gsi_bpt_take_all(&batch, GSI_BPT_MSGS)))
+	{
+		printf("batch: binary batch of %d messages failed\n", GSI_BPT_MSGS);
+		i_rc = GSI_BPT_FAIL;
+	}
+
+	gsi_is_batch_reset(&batch);
+
+	ul_len = gsi_bpt_binary_batch(a_buf, GSI_IS_MAX_BATCH, GSI_IS_MAX_BATCH);
+	if ((GSI_BPT_PASS == i_rc) &&
+		((GSI_JSON_SUCCESS != gsi_bpt_recv_frame(GSI_ENC_BINARY, a_buf, ul_len, &batch)) ||
+		 (GSI_BPT_PASS != gsi_bpt_take_all(&batch, GSI_IS_MAX_BATCH))))
+	{
+		printf("batch: binary batch of %d messages failed\n", GSI_IS_MAX_BATCH);
+		i_rc = GSI_BPT_FAIL;
+	}
+
+	gsi_is_batch_reset(&batch);
+
+	ul_len = gsi_bpt_json_batch(a_buf, GSI_BPT_MSGS);
+	if ((GSI_BPT_PASS == i_rc) &&
+		((GSI_JSON_SUCCESS != gsi_bpt_recv_frame(GSI_ENC_JSON, a_buf, ul_len, &batch)) ||
+		 (GSI_BPT_PASS != gsi_bpt_take_all(&batch, GSI_BPT_MSGS))))
+	{
+		printf("batch: JSON batch of %d messages failed\n", GSI_BPT_MSGS);
+		i_rc = GSI_BPT_FAIL;
+	}
+
+	gsi_is_batch_reset(&batch);
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_count
+	 * Description: Binary batch with count GSI_IS_MAX_BATCH + 1 (with its messages),
+	 * 				with a truncated count and with a count of 6 bytes is not received.
+	 * Return:		GSI_BPT_PASS *OR* GSI_BPT_FAIL
+#############################################################################*/
+static int gsi_bpt_count()
+{
+	static char a_buf[GSI_BPT_BATCH_SIZE + GSI_BPT_BUF_SIZE];
+	struct gsi_json_batch batch;
+	unsigned char a_truncated[] = { 0x80 };
+	unsigned char a_6_bytes[] = { 0x81, 0x80, 0x80, 0x80, 0x80, 0x00 };
+	size_t ul_len = 0;
+	int i_rc = GSI_BPT_PASS;
+
+	ul_len = gsi_bpt_binary_batch(a_buf, GSI_IS_MAX_BATCH + 1, GSI_IS_MAX_BATCH + 1);
+	if (GSI_JSON_SUCCESS == gsi_bpt_recv_frame(GSI_ENC_BINARY, a_buf, ul_len, &batch))
+	{
+		printf("count: batch of %d messages was received\n", GSI_IS_MAX_BATCH + 1);
+		i_rc = GSI_BPT_FAIL;
+	}
+
+	gsi_is_batch_reset(&batch);
+
+	if ((GSI_BPT_PASS == i_rc) &&
+		(GSI_JSON_SUCCESS == gsi_bpt_recv_frame(GSI_ENC_BINARY, (char *)a_truncated, sizeof(a_truncated), &batch)))
+	{
+		printf("count: truncated count was received\n");
+		i_rc = GSI_BPT_FAIL;
+	}
+
+	gsi_is_batch_reset(&batch);
+
+	if ((GSI_BPT_PASS == i_rc) &&
+		(GSI_JSON_SUCCESS == gsi_bpt_recv_frame(GSI_ENC_BINARY, (char *)a_6_bytes, sizeof(a_6_bytes), &batch)))
+	{
+		printf("count: count of 6 bytes was received\n");
+		i_rc = GSI_BPT_FAIL;
+	}
+
+	gsi_is_batch_reset(&batch);
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_framing
+	 * Description: Count above the messages sent, a message length past the end of
+	 * 				batch and a JSON array cut inside an object stop the batch. A message
+	 * 				with a byte after it (inside its length) fails alone - the next one
+	 * 				is taken, and the results of the reply say which one failed.
+	 * Return:		GSI_BPT_PASS *OR* GSI_BPT_FAIL
+#############################################################################*/
+static int gsi_bpt_framing()
+{
+	static char a_buf[GSI_BPT_BATCH_SIZE];
+	struct gsi_json_batch batch;
+	struct gsi_json_msg json_msg;
+	char* p_cur = NULL;
+	size_t ul_len = 0;
+	size_t ul_msg_len = 0;
+	int i_rc = GSI_BPT_PASS;
+
+	// Count of 3, with 2 messages
+	ul_len = gsi_bpt_binary_batch(a_buf, 3, 2);
+	if ((GSI_JSON_SUCCESS != gsi_bpt_recv_frame(GSI_ENC_BINARY, a_buf, ul_len, &batch)) ||
+		(GSI_BPT_PASS != gsi_bpt_take_all(&batch, 2)))
+	{
+		printf("framing: batch with a missing message failed\n");
+		i_rc = GSI_BPT_FAIL;
+	}
+
+	gsi_is_batch_reset(&batch);
+
+	// Last message is cut - its length is past the end
+	ul_len = gsi_bpt_binary_batch(a_buf, 2, 2);
+	if ((GSI_BPT_PASS == i_rc) &&
+		((GSI_JSON_SUCCESS != gsi_bpt_recv_frame(GSI_ENC_BINARY, a_buf, ul_len - 1, &batch)) ||
+		 (GSI_BPT_PASS != gsi_bpt_take_all(&batch, 1))))
+	{
+		printf("framing: batch with a cut message failed\n");
+		i_rc = GSI_BPT_FAIL;
+	}
+
+	gsi_is_batch_reset(&batch);
+
+	// Second of 3 messages has a byte after it (inside its length)
+	p_cur = gsi_bpt_put_varint(a_buf, 3);
+	for (int i = 0; i < 3; ++i)
+	{
+		ul_msg_len = gsi_is_encode_msg(p_cur + 1, &g_a_msgs[i], GSI_ENC_BINARY);
+		if (1 == i)
+		{
+			p_cur[1 + ul_msg_len++] = '\0';
+		}
+
+		// Test messages are shorter than 128 bytes - length of one byte
+		*p_cur = (char)ul_msg_len;
+		p_cur += 1 + ul_msg_len;
+	}
+
+	if ((GSI_BPT_PASS == i_rc) &&
+		(GSI_JSON_SUCCESS != gsi_bpt_recv_frame(GSI_ENC_BINARY, a_buf, p_cur - a_buf, &batch)))
+	{
+		printf("framing: batch with a bad message was not received\n");
+		i_rc = GSI_BPT_FAIL;
+	}
+
+	if ((GSI_BPT_PASS == i_rc) &&
+		((GSI_JSON_SUCCESS != gsi_bpt_next(&batch, &json_msg)) ||
+		 (GSI_JSON_ERROR != gsi_bpt_next(&batch, &json_msg)) ||
+		 (GSI_JSON_SUCCESS != gsi_bpt_next(&batch, &json_msg)) ||
+		 (!gsi_bpt_same_msg(&g_a_msgs[2], &json_msg)) ||
+		 (GSI_JSON_READ_ERROR != gsi_bpt_next(&batch, &json_msg)) ||
+		 (3 != batch.ui_count) || (0 != batch.a_results[0]) || (1 != batch.a_results[1]) || (0 != batch.a_results[2])))
+	{
+		printf("framing: bad message in batch was not failed alone\n");
+		i_rc = GSI_BPT_FAIL;
+	}
+
+	gsi_is_batch_reset(&batch);
+
+	// JSON array cut inside the second object
+	ul_len = gsi_bpt_json_batch(a_buf, 2);
+	a_buf[ul_len - 4] = '\0';
+
+	if ((GSI_BPT_PASS == i_rc) &&
+		((GSI_JSON_SUCCESS != gsi_bpt_recv_frame(GSI_ENC_JSON, a_buf, ul_len - 3, &batch)) ||
+		 (GSI_BPT_PASS != gsi_bpt_take_all(&batch, 1))))
+	{
+		printf("framing: cut JSON batch failed\n");
+		i_rc = GSI_BPT_FAIL;
+	}
+
+	gsi_is_batch_reset(&batch);
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_encode
+	 * Description: Encode message in binary, checked against its bound
+	 * Parameter:   [out] char* p_out - buffer of GSI_BPT_BUF_SIZE bytes
+	 * Parameter:   [in] const struct gsi_json_msg* p_json_msg - message to encode
+	 * Return:		Number of bytes written
+#############################################################################*/
+static size_t gsi_bpt_encode(char* p_out, const struct gsi_json_msg* p_json_msg)
+{
+	size_t ul_len = gsi_is_encode_msg(p_out, p_json_msg, GSI_ENC_BINARY);
+
+	if ((ul_len > gsi_is_encode_bound(p_json_msg, GSI_ENC_BINARY)) || (GSI_BPT_BUF_SIZE <= ul_len))
+	{
+		printf("encode: %zu bytes are more than the bound\n", ul_len);
+		exit(GSI_BPT_FAIL);
+	}
+
+	return ul_len;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_decode
+	 * Description: Decode a copy of the message in a buffer of its exact length
+	 * 				(so reading past it is caught by the address sanitizer)
+	 * Parameter:   [in] const char* p_in - message content
+	 * Parameter:   [in] size_t ul_len - length of content
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
+	 * Return:		Return value of gsi_is_decode_msg()
+#############################################################################*/
+static int gsi_bpt_decode(const char* p_in, size_t ul_len, struct gsi_json_msg* p_json_msg)
+{
+	static char* p_copy = NULL;
+
+	// Strings of the last decoded message point into the copy
+	free(p_copy);
+	p_copy = (char *)malloc(ul_len);
+	if (NULL == p_copy)
+	{
+		return GSI_JSON_ERROR;
+	}
+
+	memcpy(p_copy, p_in, ul_len);
+	memset(p_json_msg, 0, sizeof(*p_json_msg));
+
+	return gsi_is_decode_msg(p_copy, ul_len, GSI_ENC_BINARY, p_json_msg);
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_same_string
+	 * Description: Compare strings that may be NULL
+	 * Return:		1 - same, 0 - different
+#############################################################################*/
+static int gsi_bpt_same_string(const char* s_a, const char* s_b)
+{
+	if ((NULL == s_a) || (NULL == s_b))
+	{
+		return s_a == s_b;
+	}
+
+	return 0 == strcmp(s_a, s_b);
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_same_msg
+	 * Description: Compare the fields that are encoded
+	 * Return:		1 - same, 0 - different
+#############################################################################*/
+static int gsi_bpt_same_msg(const struct gsi_json_msg* p_a, const struct gsi_json_msg* p_b)
+{
+	return (p_a->i_msg_type == p_b->i_msg_type) && (p_a->i_op_code == p_b->i_op_code) &&
+		   (p_a->ui_port == p_b->ui_port) && (p_a->i_index == p_b->i_index) &&
+		   (p_a->i_data_len == p_b->i_data_len) && (p_a->i_file_len == p_b->i_file_len) &&
+		   gsi_bpt_same_string(p_a->s_file_name, p_b->s_file_name) &&
+		   gsi_bpt_same_string(p_a->s_data, p_b->s_data);
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_put_varint
+	 * Description: Write number as varint (7 bits per byte, low first)
+	 * Parameter:   [out] char* p_out - buffer to write to
+	 * Parameter:   [in] unsigned int ui_value - number to write
+	 * Return:		Pointer after the last written byte
+#############################################################################*/
+static char* gsi_bpt_put_varint(char* p_out, unsigned int ui_value)
+{
+	while (0x80 <= ui_value)
+	{
+		*p_out++ = (char)(ui_value | 0x80);
+		ui_value >>= 7;
+	}
+
+	*p_out++ = (char)ui_value;
+
+	return p_out;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_binary_batch
+	 * Description: Write binary batch content: count, then messages of g_a_msgs
+	 * 				(in turn) with their length
+	 * Parameter:   [out] char* p_out - buffer to write to
+	 * Parameter:   [in] unsigned int ui_count - count to write (may differ from i_msgs)
+	 * Parameter:   [in] int i_msgs - messages to write
+	 * Return:		Number of bytes written
+#############################################################################*/
+static size_t gsi_bpt_binary_batch(char* p_out, unsigned int ui_count, int i_msgs)
+{
+	char a_msg[GSI_BPT_BUF_SIZE];
+	char* p_cur = gsi_bpt_put_varint(p_out, ui_count);
+	size_t ul_len = 0;
+	int i = 0;
+
+	for (i = 0; i < i_msgs; ++i)
+	{
+		ul_len = gsi_bpt_encode(a_msg, &g_a_msgs[i % GSI_BPT_MSGS]);
+
+		p_cur = gsi_bpt_put_varint(p_cur, (unsigned int)ul_len);
+		memcpy(p_cur, a_msg, ul_len);
+		p_cur += ul_len;
+	}
+
+	return p_cur - p_out;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_json_batch
+	 * Description: Write JSON batch content: array of messages of g_a_msgs, with '\0'
+	 * Parameter:   [out] char* p_out - buffer to write to
+	 * Parameter:   [in] int i_msgs - messages to write
+	 * Return:		Number of bytes written (with the '\0')
+#############################################################################*/
+static size_t gsi_bpt_json_batch(char* p_out, int i_msgs)
+{
+	char* p_cur = p_out;
+	int i = 0;
+
+	*p_cur++ = '[';
+
+	for (i = 0; i < i_msgs; ++i)
+	{
+		// Each message ends with '\0' - replaced by the separator
+		p_cur += gsi_is_encode_msg(p_cur, &g_a_msgs[i % GSI_BPT_MSGS], GSI_ENC_JSON);
+		p_cur[-1] = ',';
+	}
+
+	p_cur[-1] = ']';
+	*p_cur++ = '\0';
+
+	return p_cur - p_out;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_recv_frame
+	 * Description: Write batch frame (header and content) to one end of a socket pair
+	 * 				and receive it on the other end as server
+	 * Parameter:   [in] unsigned int ui_encoding - encoding of the connection
+	 * Parameter:   [in] const char* p_content - content of frame
+	 * Parameter:   [in] size_t ul_len - length of content
+	 * Parameter:   [out] struct gsi_json_batch* p_batch - batch to fill
+	 * Return:		Return value of gsi_is_recv_batch_msg()
+#############################################################################*/
+static int gsi_bpt_recv_frame(unsigned int ui_encoding, const char* p_content, size_t ul_len,
+							  struct gsi_json_batch* p_batch)
+{
+	struct gsi_cs_tcp_message msg;
+	size_t ul_header_len = sizeof(msg) - sizeof(char*);
+	struct gsi_net_tcp server;
+	int a_fds[2];
+	int i_rc = GSI_JSON_ERROR;
+
+	memset(p_batch, 0, sizeof(*p_batch));
+
+	if (0 != socketpair(AF_UNIX, SOCK_STREAM, 0, a_fds))
+	{
+		return GSI_JSON_ERROR;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	msg.e_type_msg = GSI_BATCH_MSG;
+	msg.ui_port = 1;
+	msg.ui_len = (unsigned int)ul_len;
+
+	if (((ssize_t)ul_header_len == write(a_fds[1], &msg, ul_header_len)) &&
+		((ssize_t)ul_len == write(a_fds[1], p_content, ul_len)))
+	{
+		gsi_is_network_tcp_reset(&server);
+		server.i_connection_fd = a_fds[0];
+		server.ui_encoding = ui_encoding;
+
+		i_rc = gsi_is_recv_batch_msg(&server, p_batch);
+	}
+
+	close(a_fds[0]);
+	close(a_fds[1]);
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_next
+	 * Description: Take the next message of batch into a reset json-msg
+	 * 				(decode fills only the fields of its op code)
+	 * Parameter:   [in] struct gsi_json_batch* p_batch - received batch
+	 * Parameter:   [out] struct gsi_json_msg* p_json_msg - pointer to fill
+	 * Return:		Return value of gsi_is_batch_next_msg()
+#############################################################################*/
+static int gsi_bpt_next(struct gsi_json_batch* p_batch, struct gsi_json_msg* p_json_msg)
+{
+	memset(p_json_msg, 0, sizeof(*p_json_msg));
+
+	return gsi_is_batch_next_msg(p_batch, p_json_msg);
+}
+
+/*###########################################################################
+	 * Name:		gsi_bpt_take_all
+	 * Description: Take i_msgs messages from batch - each is the next one of g_a_msgs -
+	 * 				then the batch has no more messages
+	 * Parameter:   [in] struct gsi_json_batch* p_batch - received batch
+	 * Parameter:   [in] int i_msgs - messages expected
+	 * Return:		GSI_BPT_PASS *OR* GSI_BPT_FAIL
+#############################################################################*/
+static int gsi_bpt_take_all(struct gsi_json_batch* p_batch, int i_msgs)
+{
+	struct gsi_json_msg json_msg;
+	int i = 0;
+
+	for (i = 0; i < i_msgs; ++i)
+	{
+		if ((GSI_JSON_SUCCESS != gsi_bpt_next(p_batch, &json_msg)) ||
+			(!gsi_bpt_same_msg(&g_a_msgs[i % GSI_BPT_MSGS], &json_msg)))
+		{
+			printf("message %d of batch is not as sent\n", i);
+			return GSI_BPT_FAIL;
+		}
+	}
+
+	if (GSI_JSON_READ_ERROR != gsi_bpt_next(p_batch, &json_msg))
+	{
+		printf("batch has more than %d messages\n", i_msgs);
+		return GSI_BPT_FAIL;
+	}
+
+	return GSI_BPT_PASS;
+}
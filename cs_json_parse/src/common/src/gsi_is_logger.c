@@ -21,6 +21,7 @@
 #define 	GSI_IS_LOG_FALSE			  0
 #define 	GSI_IS_LOG_THREADS   	  1
 #define 	GSI_IS_LOG_QUEUE		  100
+#define 	GSI_IS_LOG_ADD_MSECS	  1000	/* writer waits for the log thread up to it when the queue is full */
 #define 	GSI_IS_LOG_DEFAULT_PATH   "/var/log"
 #define	 	GSI_IS_LOG_TIME_STAMP_LEN sizeof("YYYY-MM-DD-HH:MM:SS")
 
@@ -196,13 +197,14 @@ enum gsi_is_log_rc gsi_is_write_to_log(FILE* f_log, const char* s_format, ...)
 	// Reset s_message
 	memset(p_thread_args->s_message, 0, sizeof(p_thread_args->s_message));
 
-	// Build message
+	// Build message (long messages are truncated)
 	va_start(optional_args, s_format);
-	vsprintf(p_thread_args->s_message, s_format, optional_args);
+	vsnprintf(p_thread_args->s_message, sizeof(p_thread_args->s_message), s_format, optional_args);
 	va_end(optional_args);
 
-	// Add message work to Queue
-	if (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add(g_p_thread_pool, thread_write_log, p_thread_args))
+	// Add message work to Queue (a burst of writers waits for the log thread, not dropped)
+	if (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add_wait(g_p_thread_pool, thread_write_log, p_thread_args,
+														 GSI_IS_LOG_ADD_MSECS))
 	{
 		if (NULL != p_thread_args)
 		{
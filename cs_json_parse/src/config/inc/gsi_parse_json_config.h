@@ -25,6 +25,8 @@
 /* Defines and Macros */
 #define  GSI_PARSE_JSON_CONFIG_MAX_FILE_NAME 128
 #define  GSI_PARSE_JSON_CONFIG_IP_LEN		 sizeof("255.255.255.255")
+#define  GSI_PARSE_JSON_CONFIG_ENCODING_LEN	 sizeof("binary")
+#define  GSI_PARSE_JSON_CONFIG_ARRIVAL_LEN	 sizeof("poisson")
 
 /* Structures */
 /*****************************************************************************
@@ -44,6 +46,10 @@
  *----------------------------------------------------------------------------
  *		char* s_server_data_file - strings files of server for its global array
  *----------------------------------------------------------------------------
+ *		unsigned long ul_cache_size - size limit in bytes of the RF file cache
+ *----------------------------------------------------------------------------
+ *		char* s_store_dir - directory of the WF/RFID message store
+ *----------------------------------------------------------------------------
 *****************************************************************************/
 struct gsi_prase_json_config_server_params
 {
@@ -51,8 +57,10 @@ struct gsi_prase_json_config_server_params
 	unsigned int ui_port2;
 	unsigned int ui_port3;
 	int i_server_timer;
+	unsigned long ul_cache_size;
 	char s_ip[GSI_PARSE_JSON_CONFIG_IP_LEN];
 	char s_server_data_file[GSI_PARSE_JSON_CONFIG_MAX_FILE_NAME];
+	char s_store_dir[GSI_PARSE_JSON_CONFIG_MAX_FILE_NAME];
 };
 
 /*****************************************************************************
@@ -66,12 +74,46 @@ struct gsi_prase_json_config_server_params
  *----------------------------------------------------------------------------
  *		char* s_messages_file - messages file of client
  *----------------------------------------------------------------------------
+ *		char* s_encoding - wire encoding to ask from server: "json" (default) *OR* "binary"
+ *----------------------------------------------------------------------------
+ *		int i_batch_size - max messages in one frame (1 - no batches, default)
+ *----------------------------------------------------------------------------
+ *		char* s_replay_file - compiled messages file to send instead of s_messages_file
+ *							  (empty - no replay, default)
+ *----------------------------------------------------------------------------
+ *		int i_connections - connections to open to server (1 default)
+ *----------------------------------------------------------------------------
+ *		int i_threads - threads (event loops) the connections are split on (1 default)
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_rate - messages per second of all connections (0 - no limit, default)
+ *----------------------------------------------------------------------------
+ *		char* s_mix - weight per op code tag, e.g. "RS=50,WS=30,RF=20"
+ *					  (empty - messages in the order of s_messages_file, default)
+ *----------------------------------------------------------------------------
+ *		int i_duration - seconds to send (0 - each connection sends the messages once, default)
+ *----------------------------------------------------------------------------
+ *		char* s_latency_file - file to export the latency histograms into
+ *							   (empty - no export, default)
+ *----------------------------------------------------------------------------
+ *		char* s_arrival - when frames are sent: "closed" (after the results of the one
+ *						  before, default) *OR* open loop at ul_rate - "fixed" *OR* "poisson"
+ *----------------------------------------------------------------------------
 *****************************************************************************/
 struct gsi_prase_json_config_client_params
 {
 	unsigned int ui_port;
 	char s_ip[GSI_PARSE_JSON_CONFIG_IP_LEN];
 	char s_messages_file[GSI_PARSE_JSON_CONFIG_MAX_FILE_NAME];
+	char s_encoding[GSI_PARSE_JSON_CONFIG_ENCODING_LEN];
+	int i_batch_size;
+	char s_replay_file[GSI_PARSE_JSON_CONFIG_MAX_FILE_NAME];
+	int i_connections;
+	int i_threads;
+	unsigned long ul_rate;
+	char s_mix[GSI_PARSE_JSON_CONFIG_MAX_FILE_NAME];
+	int i_duration;
+	char s_latency_file[GSI_PARSE_JSON_CONFIG_MAX_FILE_NAME];
+	char s_arrival[GSI_PARSE_JSON_CONFIG_ARRIVAL_LEN];
 };
 
 /* Enums */
@@ -104,11 +146,23 @@ enum gsi_prase_json_config_opts
 	GSI_PARSE_JSON_PARAM_SERVER_IP,
 	GSI_PARSE_JSON_PARAM_SERVER_TIMER,
 	GSI_PARSE_JSON_PARAM_SERVER_DATA,
+	GSI_PARSE_JSON_PARAM_SERVER_CACHE_SIZE,
+	GSI_PARSE_JSON_PARAM_SERVER_STORE_DIR,
 
 	// Client parameters
 	GSI_PARSE_JSON_PARAM_CLIENT_PORT,
 	GSI_PARSE_JSON_PARAM_CLIENT_IP,
 	GSI_PARSE_JSON_PARAM_CLIENT_MSG,
+	GSI_PARSE_JSON_PARAM_CLIENT_ENCODING,
+	GSI_PARSE_JSON_PARAM_CLIENT_BATCH_SIZE,
+	GSI_PARSE_JSON_PARAM_CLIENT_REPLAY,
+	GSI_PARSE_JSON_PARAM_CLIENT_CONNECTIONS,
+	GSI_PARSE_JSON_PARAM_CLIENT_THREADS,
+	GSI_PARSE_JSON_PARAM_CLIENT_RATE,
+	GSI_PARSE_JSON_PARAM_CLIENT_MIX,
+	GSI_PARSE_JSON_PARAM_CLIENT_DURATION,
+	GSI_PARSE_JSON_PARAM_CLIENT_LATENCY_FILE,
+	GSI_PARSE_JSON_PARAM_CLIENT_ARRIVAL,
 };
 
 /*******************/
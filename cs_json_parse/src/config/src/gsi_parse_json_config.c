@@ -42,11 +42,23 @@ static char* g_config_params_keys[] =
 	[GSI_PARSE_JSON_PARAM_SERVER_IP]			= "server_ip",
 	[GSI_PARSE_JSON_PARAM_SERVER_TIMER]   		= "server_timer",
 	[GSI_PARSE_JSON_PARAM_SERVER_DATA] 			= "server_data",
+	[GSI_PARSE_JSON_PARAM_SERVER_CACHE_SIZE]	= "server_cache_size",
+	[GSI_PARSE_JSON_PARAM_SERVER_STORE_DIR]		= "server_store_dir",
 
 	// Client parameters
 	[GSI_PARSE_JSON_PARAM_CLIENT_PORT]  		= "client_port",
 	[GSI_PARSE_JSON_PARAM_CLIENT_IP]			= "client_ip",
 	[GSI_PARSE_JSON_PARAM_CLIENT_MSG] 	  		= "client_messages",
+	[GSI_PARSE_JSON_PARAM_CLIENT_ENCODING]		= "client_encoding",
+	[GSI_PARSE_JSON_PARAM_CLIENT_BATCH_SIZE]	= "client_batch_size",
+	[GSI_PARSE_JSON_PARAM_CLIENT_REPLAY]		= "client_replay",
+	[GSI_PARSE_JSON_PARAM_CLIENT_CONNECTIONS]	= "client_connections",
+	[GSI_PARSE_JSON_PARAM_CLIENT_THREADS]		= "client_threads",
+	[GSI_PARSE_JSON_PARAM_CLIENT_RATE]			= "client_rate",
+	[GSI_PARSE_JSON_PARAM_CLIENT_MIX]			= "client_mix",
+	[GSI_PARSE_JSON_PARAM_CLIENT_DURATION]		= "client_duration",
+	[GSI_PARSE_JSON_PARAM_CLIENT_LATENCY_FILE]	= "client_latency_file",
+	[GSI_PARSE_JSON_PARAM_CLIENT_ARRIVAL]		= "client_arrival",
 };
 
 /**********************/
@@ -308,6 +320,18 @@ static void gsi_parse_json_config_parse_main_args(int i_index, char* s_value)
 			LOG_DEBUG("server_data: %s", g_config_server_params.s_server_data_file);
 			break;
 
+		case GSI_PARSE_JSON_PARAM_SERVER_CACHE_SIZE:
+			g_config_server_params.ul_cache_size = strtoul(s_value, NULL, 10);
+			LOG_DEBUG("server_cache_size: %lu", g_config_server_params.ul_cache_size);
+			break;
+
+		case GSI_PARSE_JSON_PARAM_SERVER_STORE_DIR:
+			strcpy(g_config_server_params.s_store_dir, s_value);
+			// Replace the '\n' by '\0'
+			g_config_server_params.s_store_dir[strlen(g_config_server_params.s_store_dir) - 1] = '\0';
+			LOG_DEBUG("server_store_dir: %s", g_config_server_params.s_store_dir);
+			break;
+
 		// Client parameters
 		case GSI_PARSE_JSON_PARAM_CLIENT_PORT:
 			g_config_client_params.ui_port = atoi(s_value);
@@ -328,6 +352,82 @@ static void gsi_parse_json_config_parse_main_args(int i_index, char* s_value)
 			LOG_DEBUG("client_messages: %s", g_config_client_params.s_messages_file);
 			break;
 
+		case GSI_PARSE_JSON_PARAM_CLIENT_ENCODING:
+			// Any value except binary is JSON
+			if (0 == strncmp(s_value, "binary", sizeof("binary") - 1))
+			{
+				strcpy(g_config_client_params.s_encoding, "binary");
+			}
+			else
+			{
+				strcpy(g_config_client_params.s_encoding, "json");
+			}
+			LOG_DEBUG("client_encoding: %s", g_config_client_params.s_encoding);
+			break;
+
+		case GSI_PARSE_JSON_PARAM_CLIENT_BATCH_SIZE:
+			g_config_client_params.i_batch_size = atoi(s_value);
+			LOG_DEBUG("client_batch_size: %d", g_config_client_params.i_batch_size);
+			break;
+
+		case GSI_PARSE_JSON_PARAM_CLIENT_REPLAY:
+			strcpy(g_config_client_params.s_replay_file ,s_value);
+			// Replace the '\n' by '\0'
+			g_config_client_params.s_replay_file[strlen(g_config_client_params.s_replay_file) - 1] = '\0';
+			LOG_DEBUG("client_replay: %s", g_config_client_params.s_replay_file);
+			break;
+
+		case GSI_PARSE_JSON_PARAM_CLIENT_CONNECTIONS:
+			g_config_client_params.i_connections = atoi(s_value);
+			LOG_DEBUG("client_connections: %d", g_config_client_params.i_connections);
+			break;
+
+		case GSI_PARSE_JSON_PARAM_CLIENT_THREADS:
+			g_config_client_params.i_threads = atoi(s_value);
+			LOG_DEBUG("client_threads: %d", g_config_client_params.i_threads);
+			break;
+
+		case GSI_PARSE_JSON_PARAM_CLIENT_RATE:
+			g_config_client_params.ul_rate = strtoul(s_value, NULL, 10);
+			LOG_DEBUG("client_rate: %lu", g_config_client_params.ul_rate);
+			break;
+
+		case GSI_PARSE_JSON_PARAM_CLIENT_MIX:
+			strcpy(g_config_client_params.s_mix ,s_value);
+			// Replace the '\n' by '\0'
+			g_config_client_params.s_mix[strlen(g_config_client_params.s_mix) - 1] = '\0';
+			LOG_DEBUG("client_mix: %s", g_config_client_params.s_mix);
+			break;
+
+		case GSI_PARSE_JSON_PARAM_CLIENT_DURATION:
+			g_config_client_params.i_duration = atoi(s_value);
+			LOG_DEBUG("client_duration: %d", g_config_client_params.i_duration);
+			break;
+
+		case GSI_PARSE_JSON_PARAM_CLIENT_LATENCY_FILE:
+			strcpy(g_config_client_params.s_latency_file ,s_value);
+			// Replace the '\n' by '\0'
+			g_config_client_params.s_latency_file[strlen(g_config_client_params.s_latency_file) - 1] = '\0';
+			LOG_DEBUG("client_latency_file: %s", g_config_client_params.s_latency_file);
+			break;
+
+		case GSI_PARSE_JSON_PARAM_CLIENT_ARRIVAL:
+			// Any value except fixed or poisson is closed loop
+			if (0 == strncmp(s_value, "fixed", sizeof("fixed") - 1))
+			{
+				strcpy(g_config_client_params.s_arrival, "fixed");
+			}
+			else if (0 == strncmp(s_value, "poisson", sizeof("poisson") - 1))
+			{
+				strcpy(g_config_client_params.s_arrival, "poisson");
+			}
+			else
+			{
+				strcpy(g_config_client_params.s_arrival, "closed");
+			}
+			LOG_DEBUG("client_arrival: %s", g_config_client_params.s_arrival);
+			break;
+
 		default:
 			LOG_ERROR("index is not match to any option");
 	}
@@ -346,9 +446,18 @@ static void gsi_parse_json_config_init_default_params()
 	g_config_server_params.ui_port2 = 65534;
 	g_config_server_params.ui_port3 = 65535;
 	g_config_server_params.i_server_timer = 0;
+	g_config_server_params.ul_cache_size = 4 * 1024 * 1024;
 
 	strcpy(g_config_server_params.s_ip, "127.0.0.1");
 	strcpy(g_config_server_params.s_server_data_file, "../src/server/test_files/server_data.txt");
+	strcpy(g_config_server_params.s_store_dir, "../store");
+
+	// Client parameters
+	strcpy(g_config_client_params.s_encoding, "json");
+	g_config_client_params.i_batch_size = 1;
+	g_config_client_params.i_connections = 1;
+	g_config_client_params.i_threads = 1;
+	strcpy(g_config_client_params.s_arrival, "closed");
 }
 
 /*###########################################################################
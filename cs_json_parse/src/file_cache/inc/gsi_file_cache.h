@@ -0,0 +1,241 @@
+/**************************************************************************
+* Name : gsi_file_cache.h
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Bounded in-memory cache of file contents.
+* 				Entries are keyed by (path, device, inode, mtime, size) and
+* 				kept in LRU order up to a limit in bytes.
+* 				A watcher thread invalidates entries on inotify events.
+* 				Concurrent misses on the same file are coalesced into a single read.
+* 				Using: 1. gsi_file_cache_create() - Must be first!
+* 					   2. gsi_file_cache_get() / gsi_file_cache_release() - pin and unpin content.
+* 					   3. gsi_file_cache_destroy() - Must be last!
+*****************************************************************************/
+#ifndef GSI_FILE_CACHE_H_
+#define GSI_FILE_CACHE_H_
+
+/* Includes */
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+/* Defines and Macros */
+#define 	GSI_FC_DEFAULT_MAX_BYTES	(4 * 1024 * 1024)	/* default size limit of the cache */
+#define 	GSI_FC_BUCKETS				256					/* number of buckets in hash table */
+
+/* Typedef */
+typedef struct gsi_file_cache gsi_file_cache_t;
+typedef struct gsi_file_cache_entry gsi_file_cache_entry_t;
+
+/* Enums */
+/***************************************************************************
+ * Name:  		gsi_file_cache_rc
+ * Description: Return Code values for GSI-FILE-CACHE functions
+ ***************************************************************************/
+enum gsi_file_cache_rc {
+	GSI_FC_RC_SUCCESS  = 0,	// Function completed Successfully
+	GSI_FC_RC_ERROR    = 1,	// Function completed with Error
+	GSI_FC_RC_INVALID  = 2,	// Function got invalid arguments
+	GSI_FC_RC_OPEN_ERR = 3	// File doesn't exist or couldn't be read
+};
+
+/***************************************************************************
+ * Name:  		gsi_file_cache_entry_state
+ * Description: Load state of a cache entry
+ ***************************************************************************/
+enum gsi_file_cache_entry_state {
+	GSI_FC_ENTRY_LOADING = 0,	// First reader is reading the file, others wait
+	GSI_FC_ENTRY_READY   = 1,	// Content is valid
+	GSI_FC_ENTRY_FAILED  = 2	// Read failed, waiters give up
+};
+
+/* Structures */
+/*****************************************************************************
+ * Name : gsi_file_cache_stats
+ * Used by: gsi_file_cache_get_stats()
+ * Members:
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_hits - Lookups served from memory
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_misses - Lookups that read the file from disk
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_coalesced - Misses that waited for another reader
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_evictions - Entries dropped by the LRU policy
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_invalidations - Entries dropped because the file changed
+ *----------------------------------------------------------------------------
+ *		size_t ul_bytes - Bytes currently cached
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_entries - Entries currently cached
+ *****************************************************************************/
+struct gsi_file_cache_stats
+{
+	unsigned long ul_hits;
+	unsigned long ul_misses;
+	unsigned long ul_coalesced;
+	unsigned long ul_evictions;
+	unsigned long ul_invalidations;
+	size_t ul_bytes;
+	unsigned int ui_entries;
+};
+
+/*****************************************************************************
+ * Name : gsi_file_cache_entry
+ * Used by: struct gsi_file_cache
+ * Members:
+ *----------------------------------------------------------------------------
+ *		char* s_path - Path of the cached file (key)
+ *----------------------------------------------------------------------------
+ *		dev_t dev, ino_t ino, struct timespec mtime, off_t size - File identity (key)
+ *----------------------------------------------------------------------------
+ *		char* p_data - File content, terminated by '\0'
+ *----------------------------------------------------------------------------
+ *		size_t ul_len - Length of p_data without the '\0'
+ *----------------------------------------------------------------------------
+ *		int i_state - One of gsi_file_cache_entry_state
+ *----------------------------------------------------------------------------
+ *		int i_refs - Number of readers that pinned the entry
+ *----------------------------------------------------------------------------
+ *		int i_stale - Entry was removed from the cache, free on last release
+ *----------------------------------------------------------------------------
+ *		int i_wd - inotify watch descriptor of the file (-1 if none)
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_hash - Hash of s_path
+ *----------------------------------------------------------------------------
+ *		p_hash_next, p_lru_prev, p_lru_next - Links in hash bucket and LRU list
+ *****************************************************************************/
+struct gsi_file_cache_entry
+{
+	char* s_path;
+	dev_t dev;
+	ino_t ino;
+	struct timespec mtime;
+	off_t size;
+	char* p_data;
+	size_t ul_len;
+	int i_state;
+	int i_refs;
+	int i_stale;
+	int i_wd;
+	unsigned int ui_hash;
+	struct gsi_file_cache_entry* p_hash_next;
+	struct gsi_file_cache_entry* p_lru_prev;
+	struct gsi_file_cache_entry* p_lru_next;
+};
+
+/*****************************************************************************
+ * Name : gsi_file_cache
+ * Used by: GSI-FILE-CACHE API functions
+ * Members:
+ *----------------------------------------------------------------------------
+ *		pthread_mutex_t lock - Mutex to lock the cache structures
+ *----------------------------------------------------------------------------
+ *		pthread_cond_t loaded - Signaled when a LOADING entry changes state
+ *----------------------------------------------------------------------------
+ *		gsi_file_cache_entry_t* p_buckets[] - Hash table of entries by path
+ *----------------------------------------------------------------------------
+ *		gsi_file_cache_entry_t *p_lru_head, *p_lru_tail - Most / least recently used
+ *----------------------------------------------------------------------------
+ *		size_t ul_max_bytes - Size limit of cached content
+ *----------------------------------------------------------------------------
+ *		int i_inotify_fd - inotify instance (-1 if not available)
+ *----------------------------------------------------------------------------
+ *		int i_wake_fds[2] - Pipe to wake up the watcher thread on destroy
+ *----------------------------------------------------------------------------
+ *		pthread_t watcher - Thread that reads inotify events
+ *----------------------------------------------------------------------------
+ *		int i_watcher_started - Indicate that watcher thread is running
+ *----------------------------------------------------------------------------
+ *		struct gsi_file_cache_stats stats - Counters
+ *****************************************************************************/
+struct gsi_file_cache
+{
+	pthread_mutex_t lock;
+	pthread_cond_t loaded;
+	gsi_file_cache_entry_t* p_buckets[GSI_FC_BUCKETS];
+	gsi_file_cache_entry_t* p_lru_head;
+	gsi_file_cache_entry_t* p_lru_tail;
+	size_t ul_max_bytes;
+	int i_inotify_fd;
+	int i_wake_fds[2];
+	pthread_t watcher;
+	int i_watcher_started;
+	struct gsi_file_cache_stats stats;
+};
+
+/*******************/
+/* API Declaration */
+/*******************/
+/*###########################################################################
+	 * Name:		gsi_file_cache_create
+	 * Description: Creates a file cache. Must use gsi_file_cache_destroy() before exit!
+	 * Parameter:   [in] size_t ul_max_bytes - size limit of cached content (0 - default)
+	 * Return:		Success - pointer to new file cache object
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_file_cache_t* gsi_file_cache_create(size_t ul_max_bytes);
+
+
+/*###########################################################################
+	 * Name:		gsi_file_cache_get
+	 * Description: Get the content of a file, from memory if it is still valid,
+	 * 				otherwise from disk. The returned entry is pinned and
+	 * 				MUST be released by gsi_file_cache_release().
+	 * 				Files bigger than the size limit are read but not kept.
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache object
+	 * Parameter:   [in] const char* s_path - file to read
+	 * Parameter:   [out] gsi_file_cache_entry_t** pp_entry - pinned entry (p_data, ul_len)
+	 * Return:		Success - GSI_FC_RC_SUCCESS
+	 * 				Failure - GSI_FC_RC_OPEN_ERR *OR* GSI_FC_RC_ERROR *OR* GSI_FC_RC_INVALID
+#############################################################################*/
+enum gsi_file_cache_rc gsi_file_cache_get(gsi_file_cache_t* p_cache,
+										  const char* s_path,
+										  gsi_file_cache_entry_t** pp_entry);
+
+
+/*###########################################################################
+	 * Name:		gsi_file_cache_release
+	 * Description: Unpin an entry returned by gsi_file_cache_get()
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache object
+	 * Parameter:   [in] gsi_file_cache_entry_t* p_entry - entry to release
+	 * Return:		Success - GSI_FC_RC_SUCCESS
+	 * 				Failure - GSI_FC_RC_INVALID
+#############################################################################*/
+enum gsi_file_cache_rc gsi_file_cache_release(gsi_file_cache_t* p_cache, gsi_file_cache_entry_t* p_entry);
+
+
+/*###########################################################################
+	 * Name:		gsi_file_cache_invalidate
+	 * Description: Drop the cached content of a file (e.g. after the server wrote to it)
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache object
+	 * Parameter:   [in] const char* s_path - file to drop
+	 * Return:		Success - GSI_FC_RC_SUCCESS
+	 * 				Failure - GSI_FC_RC_INVALID
+#############################################################################*/
+enum gsi_file_cache_rc gsi_file_cache_invalidate(gsi_file_cache_t* p_cache, const char* s_path);
+
+
+/*###########################################################################
+	 * Name:		gsi_file_cache_get_stats
+	 * Description: Take a snapshot of the cache counters
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache object
+	 * Parameter:   [out] struct gsi_file_cache_stats* p_stats - buffer to fill
+	 * Return:		Success - GSI_FC_RC_SUCCESS
+	 * 				Failure - GSI_FC_RC_INVALID
+#############################################################################*/
+enum gsi_file_cache_rc gsi_file_cache_get_stats(gsi_file_cache_t* p_cache, struct gsi_file_cache_stats* p_stats);
+
+
+/*###########################################################################
+	 * Name:		gsi_file_cache_destroy
+	 * Description: Stop the watcher thread and free all cached content
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache to destroy
+	 * Return:		Success - GSI_FC_RC_SUCCESS
+	 * 				Failure - GSI_FC_RC_ERROR *OR* GSI_FC_RC_INVALID
+#############################################################################*/
+enum gsi_file_cache_rc gsi_file_cache_destroy(gsi_file_cache_t* p_cache);
+
+
+#endif /* GSI_FILE_CACHE_H_ */
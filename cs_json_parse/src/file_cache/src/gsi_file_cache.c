@@ -0,0 +1,824 @@
+/**************************************************************************
+* Name : gsi_file_cache.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Implementation of "gsi_file_cache.h"
+* 				Every use of gsi_file_cache_create() must also use gsi_file_cache_destroy() !
+*****************************************************************************/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include "gsi_file_cache.h"
+#include "gsi_is_log_api.h"
+
+/* Defines and Macros */
+#define 	GSI_FC_TRUE				1
+#define 	GSI_FC_FALSE			0
+#define 	GSI_FC_EVENTS_BUF_SIZE	4096
+#define 	GSI_FC_WATCH_MASK		(IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF)
+
+/********************************/
+/* Static functions declaration */
+/********************************/
+static unsigned int file_cache_hash(const char* s_path);
+static gsi_file_cache_entry_t* file_cache_find(gsi_file_cache_t* p_cache, const char* s_path, unsigned int ui_hash);
+static int file_cache_key_match(gsi_file_cache_entry_t* p_entry, struct stat* p_st);
+static void file_cache_lru_push_front(gsi_file_cache_t* p_cache, gsi_file_cache_entry_t* p_entry);
+static void file_cache_lru_remove(gsi_file_cache_t* p_cache, gsi_file_cache_entry_t* p_entry);
+static void file_cache_unlink(gsi_file_cache_t* p_cache, gsi_file_cache_entry_t* p_entry);
+static void file_cache_evict(gsi_file_cache_t* p_cache);
+static void file_cache_free_entry(gsi_file_cache_entry_t* p_entry);
+static int file_cache_read_file(const char* s_path, gsi_file_cache_entry_t* p_entry);
+static void* file_cache_watch_thread(void* p_args);
+
+/**********************/
+/* API implementation */
+/**********************/
+/*###########################################################################
+	 * Name:		gsi_file_cache_create
+	 * Description: Creates a file cache. Must use gsi_file_cache_destroy() before exit!
+	 * 				If inotify is not available the cache still works, changes
+	 * 				are then detected only by the (inode, mtime, size) key.
+	 * Parameter:   [in] size_t ul_max_bytes - size limit of cached content (0 - default)
+	 * Return:		Success - pointer to new file cache object
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_file_cache_t* gsi_file_cache_create(size_t ul_max_bytes)
+{
+	gsi_file_cache_t* p_cache = NULL;
+
+	// Allocate new cache, all buckets are empty
+	p_cache = (gsi_file_cache_t*)calloc(1, sizeof(gsi_file_cache_t));
+	if (NULL == p_cache)
+	{
+		LOG_ERROR("memory allocation for file cache failed");
+		return NULL;
+	}
+
+	p_cache->ul_max_bytes = (0 == ul_max_bytes) ? GSI_FC_DEFAULT_MAX_BYTES : ul_max_bytes;
+	p_cache->i_inotify_fd = -1;
+	p_cache->i_wake_fds[0] = -1;
+	p_cache->i_wake_fds[1] = -1;
+
+	// Init the mutex
+	if (0 != pthread_mutex_init(&(p_cache->lock), NULL))
+	{
+		free(p_cache);
+		return NULL;
+	}
+
+	// Init the condition variable
+	if (0 != pthread_cond_init(&(p_cache->loaded), NULL))
+	{
+		pthread_mutex_destroy(&(p_cache->lock));
+		free(p_cache);
+		return NULL;
+	}
+
+	// Start watching for file changes
+	p_cache->i_inotify_fd = inotify_init1(IN_CLOEXEC);
+	if (0 > p_cache->i_inotify_fd)
+	{
+		LOG_WARNING("inotify is not available, cache is validated by stat only");
+		return p_cache;
+	}
+
+	if (0 != pipe(p_cache->i_wake_fds))
+	{
+		LOG_WARNING("couldn't create wake pipe, cache is validated by stat only");
+		close(p_cache->i_inotify_fd);
+		p_cache->i_inotify_fd = -1;
+		return p_cache;
+	}
+
+	if (0 != pthread_create(&(p_cache->watcher), NULL, file_cache_watch_thread, p_cache))
+	{
+		LOG_WARNING("couldn't start watcher thread, cache is validated by stat only");
+		close(p_cache->i_inotify_fd);
+		close(p_cache->i_wake_fds[0]);
+		close(p_cache->i_wake_fds[1]);
+		p_cache->i_inotify_fd = -1;
+		p_cache->i_wake_fds[0] = -1;
+		p_cache->i_wake_fds[1] = -1;
+		return p_cache;
+	}
+
+	p_cache->i_watcher_started = GSI_FC_TRUE;
+
+	LOG_INFO("file cache created with limit of %zu bytes", p_cache->ul_max_bytes);
+	return p_cache;
+}
+
+/*###########################################################################
+	 * Name:		gsi_file_cache_get
+	 * Description: Get the content of a file, from memory if it is still valid,
+	 * 				otherwise from disk. The returned entry is pinned and
+	 * 				MUST be released by gsi_file_cache_release().
+	 * 				Files bigger than the size limit are read but not kept.
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache object
+	 * Parameter:   [in] const char* s_path - file to read
+	 * Parameter:   [out] gsi_file_cache_entry_t** pp_entry - pinned entry (p_data, ul_len)
+	 * Return:		Success - GSI_FC_RC_SUCCESS
+	 * 				Failure - GSI_FC_RC_OPEN_ERR *OR* GSI_FC_RC_ERROR *OR* GSI_FC_RC_INVALID
+#############################################################################*/
+enum gsi_file_cache_rc gsi_file_cache_get(gsi_file_cache_t* p_cache,
+										  const char* s_path,
+										  gsi_file_cache_entry_t** pp_entry)
+{
+	struct stat st;
+	unsigned int ui_hash = 0;
+	gsi_file_cache_entry_t* p_entry = NULL;
+
+	// Check input validation
+	if ((NULL == p_cache) || (NULL == s_path) || (NULL == pp_entry))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_FC_RC_INVALID;
+	}
+
+	*pp_entry = NULL;
+
+	// Get the current identity of the file, outside of the lock
+	if (0 != stat(s_path, &st))
+	{
+		LOG_ERROR("couldn't stat %s", s_path);
+		return GSI_FC_RC_OPEN_ERR;
+	}
+
+	ui_hash = file_cache_hash(s_path);
+
+	pthread_mutex_lock(&(p_cache->lock));
+
+	p_entry = file_cache_find(p_cache, s_path, ui_hash);
+	if ((NULL != p_entry) && (GSI_FC_ENTRY_READY == p_entry->i_state))
+	{
+		if (file_cache_key_match(p_entry, &st))
+		{
+			// Hit - move to the front of the LRU list
+			p_entry->i_refs++;
+			p_cache->stats.ul_hits++;
+			file_cache_lru_remove(p_cache, p_entry);
+			file_cache_lru_push_front(p_cache, p_entry);
+
+			pthread_mutex_unlock(&(p_cache->lock));
+
+			*pp_entry = p_entry;
+			return GSI_FC_RC_SUCCESS;
+		}
+
+		// File changed since it was cached
+		file_cache_unlink(p_cache, p_entry);
+		p_cache->stats.ul_invalidations++;
+		p_entry = NULL;
+	}
+	else if (NULL != p_entry)
+	{
+		// Another reader is loading this file - wait for it instead of reading again
+		p_entry->i_refs++;
+		p_cache->stats.ul_coalesced++;
+
+		while (GSI_FC_ENTRY_LOADING == p_entry->i_state)
+		{
+			pthread_cond_wait(&(p_cache->loaded), &(p_cache->lock));
+		}
+
+		if (GSI_FC_ENTRY_READY == p_entry->i_state)
+		{
+			p_cache->stats.ul_hits++;
+			pthread_mutex_unlock(&(p_cache->lock));
+
+			*pp_entry = p_entry;
+			return GSI_FC_RC_SUCCESS;
+		}
+
+		// Load failed - drop our reference
+		if ((0 == --(p_entry->i_refs)) && (p_entry->i_stale))
+		{
+			file_cache_free_entry(p_entry);
+		}
+
+		pthread_mutex_unlock(&(p_cache->lock));
+
+		return GSI_FC_RC_OPEN_ERR;
+	}
+
+	// Miss - insert a LOADING entry so other readers wait for us
+	p_entry = (gsi_file_cache_entry_t*)calloc(1, sizeof(gsi_file_cache_entry_t));
+	if (NULL == p_entry)
+	{
+		pthread_mutex_unlock(&(p_cache->lock));
+		LOG_ERROR("memory allocation for cache entry failed");
+		return GSI_FC_RC_ERROR;
+	}
+
+	p_entry->s_path = strdup(s_path);
+	if (NULL == p_entry->s_path)
+	{
+		pthread_mutex_unlock(&(p_cache->lock));
+		free(p_entry);
+		LOG_ERROR("memory allocation for cache entry failed");
+		return GSI_FC_RC_ERROR;
+	}
+
+	p_entry->i_state = GSI_FC_ENTRY_LOADING;
+	p_entry->i_refs = 1;
+	p_entry->i_wd = -1;
+	p_entry->ui_hash = ui_hash;
+	p_entry->p_hash_next = p_cache->p_buckets[ui_hash % GSI_FC_BUCKETS];
+	p_cache->p_buckets[ui_hash % GSI_FC_BUCKETS] = p_entry;
+	p_cache->stats.ul_misses++;
+
+	// Watch before reading, under the lock - the watcher handles an event of this
+	// watch only after the entry has it, and drops the entry if it comes during the read
+	if (0 <= p_cache->i_inotify_fd)
+	{
+		p_entry->i_wd = inotify_add_watch(p_cache->i_inotify_fd, s_path, GSI_FC_WATCH_MASK);
+	}
+
+	pthread_mutex_unlock(&(p_cache->lock));
+
+	// Read the file without holding the lock
+	int i_rc = file_cache_read_file(s_path, p_entry);
+
+	pthread_mutex_lock(&(p_cache->lock));
+
+	if (0 != i_rc)
+	{
+		p_entry->i_state = GSI_FC_ENTRY_FAILED;
+		if (!p_entry->i_stale)
+		{
+			file_cache_unlink(p_cache, p_entry);
+		}
+
+		pthread_cond_broadcast(&(p_cache->loaded));
+
+		if (0 == --(p_entry->i_refs))
+		{
+			file_cache_free_entry(p_entry);
+		}
+
+		pthread_mutex_unlock(&(p_cache->lock));
+
+		LOG_ERROR("couldn't read %s", s_path);
+		return GSI_FC_RC_OPEN_ERR;
+	}
+
+	p_entry->i_state = GSI_FC_ENTRY_READY;
+
+	if (!p_entry->i_stale)
+	{
+		if (p_entry->ul_len > p_cache->ul_max_bytes)
+		{
+			// Too big to keep - serve it once and free it on release
+			file_cache_unlink(p_cache, p_entry);
+		}
+		else
+		{
+			file_cache_lru_push_front(p_cache, p_entry);
+			p_cache->stats.ul_bytes += p_entry->ul_len;
+			p_cache->stats.ui_entries++;
+			file_cache_evict(p_cache);
+		}
+	}
+
+	pthread_cond_broadcast(&(p_cache->loaded));
+	pthread_mutex_unlock(&(p_cache->lock));
+
+	*pp_entry = p_entry;
+	return GSI_FC_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_file_cache_release
+	 * Description: Unpin an entry returned by gsi_file_cache_get()
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache object
+	 * Parameter:   [in] gsi_file_cache_entry_t* p_entry - entry to release
+	 * Return:		Success - GSI_FC_RC_SUCCESS
+	 * 				Failure - GSI_FC_RC_INVALID
+#############################################################################*/
+enum gsi_file_cache_rc gsi_file_cache_release(gsi_file_cache_t* p_cache, gsi_file_cache_entry_t* p_entry)
+{
+	// Check input validation
+	if ((NULL == p_cache) || (NULL == p_entry))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_FC_RC_INVALID;
+	}
+
+	pthread_mutex_lock(&(p_cache->lock));
+
+	// Entries that left the cache while pinned are freed by the last reader
+	if ((0 == --(p_entry->i_refs)) && (p_entry->i_stale))
+	{
+		file_cache_free_entry(p_entry);
+	}
+
+	pthread_mutex_unlock(&(p_cache->lock));
+
+	return GSI_FC_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_file_cache_invalidate
+	 * Description: Drop the cached content of a file (e.g. after the server wrote to it)
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache object
+	 * Parameter:   [in] const char* s_path - file to drop
+	 * Return:		Success - GSI_FC_RC_SUCCESS
+	 * 				Failure - GSI_FC_RC_INVALID
+#############################################################################*/
+enum gsi_file_cache_rc gsi_file_cache_invalidate(gsi_file_cache_t* p_cache, const char* s_path)
+{
+	gsi_file_cache_entry_t* p_entry = NULL;
+
+	// Check input validation
+	if ((NULL == p_cache) || (NULL == s_path))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_FC_RC_INVALID;
+	}
+
+	pthread_mutex_lock(&(p_cache->lock));
+
+	// Loading entries are left alone, their readers asked before the change
+	p_entry = file_cache_find(p_cache, s_path, file_cache_hash(s_path));
+	if ((NULL != p_entry) && (GSI_FC_ENTRY_READY == p_entry->i_state))
+	{
+		file_cache_unlink(p_cache, p_entry);
+		p_cache->stats.ul_invalidations++;
+	}
+
+	pthread_mutex_unlock(&(p_cache->lock));
+
+	return GSI_FC_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_file_cache_get_stats
+	 * Description: Take a snapshot of the cache counters
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache object
+	 * Parameter:   [out] struct gsi_file_cache_stats* p_stats - buffer to fill
+	 * Return:		Success - GSI_FC_RC_SUCCESS
+	 * 				Failure - GSI_FC_RC_INVALID
+#############################################################################*/
+enum gsi_file_cache_rc gsi_file_cache_get_stats(gsi_file_cache_t* p_cache, struct gsi_file_cache_stats* p_stats)
+{
+	// Check input validation
+	if ((NULL == p_cache) || (NULL == p_stats))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_FC_RC_INVALID;
+	}
+
+	pthread_mutex_lock(&(p_cache->lock));
+	*p_stats = p_cache->stats;
+	pthread_mutex_unlock(&(p_cache->lock));
+
+	return GSI_FC_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_file_cache_destroy
+	 * Description: Stop the watcher thread and free all cached content.
+	 * 				All entries must be released before.
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache to destroy
+	 * Return:		Success - GSI_FC_RC_SUCCESS
+	 * 				Failure - GSI_FC_RC_ERROR *OR* GSI_FC_RC_INVALID
+#############################################################################*/
+enum gsi_file_cache_rc gsi_file_cache_destroy(gsi_file_cache_t* p_cache)
+{
+	char c_wake = 0;
+	gsi_file_cache_entry_t* p_entry = NULL;
+	gsi_file_cache_entry_t* p_next = NULL;
+
+	// Check input validation
+	if (NULL == p_cache)
+	{
+		return GSI_FC_RC_INVALID;
+	}
+
+	// Stop the watcher thread
+	if (GSI_FC_TRUE == p_cache->i_watcher_started)
+	{
+		if (1 != write(p_cache->i_wake_fds[1], &c_wake, sizeof(c_wake)))
+		{
+			LOG_ERROR("couldn't wake the watcher thread");
+			return GSI_FC_RC_ERROR;
+		}
+
+		pthread_join(p_cache->watcher, NULL);
+		p_cache->i_watcher_started = GSI_FC_FALSE;
+	}
+
+	if (0 <= p_cache->i_inotify_fd)
+	{
+		close(p_cache->i_inotify_fd);
+		close(p_cache->i_wake_fds[0]);
+		close(p_cache->i_wake_fds[1]);
+	}
+
+	// Free all the entries
+	for (int i = 0; i < GSI_FC_BUCKETS; ++i)
+	{
+		for (p_entry = p_cache->p_buckets[i]; NULL != p_entry; p_entry = p_next)
+		{
+			p_next = p_entry->p_hash_next;
+			file_cache_free_entry(p_entry);
+		}
+	}
+
+	pthread_cond_destroy(&(p_cache->loaded));
+	pthread_mutex_destroy(&(p_cache->lock));
+	free(p_cache);
+
+	return GSI_FC_RC_SUCCESS;
+}
+
+/***********************************/
+/* Static functions implementation */
+/***********************************/
+/*###########################################################################
+	 * Name:		file_cache_hash
+	 * Description: FNV-1a hash of a path
+	 * Parameter:   [in] const char* s_path - path to hash
+	 * Return:		hash value
+#############################################################################*/
+static unsigned int file_cache_hash(const char* s_path)
+{
+	unsigned int ui_hash = 2166136261u;
+
+	while ('\0' != *s_path)
+	{
+		ui_hash ^= (unsigned char)*s_path++;
+		ui_hash *= 16777619u;
+	}
+
+	return ui_hash;
+}
+
+/*###########################################################################
+	 * Name:		file_cache_find
+	 * Description: Find the live entry of a path. Must be called with the lock held.
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache object
+	 * Parameter:   [in] const char* s_path - path to search
+	 * Parameter:   [in] unsigned int ui_hash - hash of s_path
+	 * Return:		Success - entry
+	 * 				Failure - NULL (not cached)
+#############################################################################*/
+static gsi_file_cache_entry_t* file_cache_find(gsi_file_cache_t* p_cache, const char* s_path, unsigned int ui_hash)
+{
+	gsi_file_cache_entry_t* p_entry = p_cache->p_buckets[ui_hash % GSI_FC_BUCKETS];
+
+	for (; NULL != p_entry; p_entry = p_entry->p_hash_next)
+	{
+		if ((ui_hash == p_entry->ui_hash) && (0 == strcmp(s_path, p_entry->s_path)))
+		{
+			return p_entry;
+		}
+	}
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		file_cache_key_match
+	 * Description: Check if a cached entry still describes the file on disk
+	 * Parameter:   [in] gsi_file_cache_entry_t* p_entry - cached entry
+	 * Parameter:   [in] struct stat* p_st - current identity of the file
+	 * Return:		GSI_FC_TRUE if it matches, GSI_FC_FALSE otherwise
+#############################################################################*/
+static int file_cache_key_match(gsi_file_cache_entry_t* p_entry, struct stat* p_st)
+{
+	return ((p_entry->dev == p_st->st_dev) &&
+			(p_entry->ino == p_st->st_ino) &&
+			(p_entry->size == p_st->st_size) &&
+			(p_entry->mtime.tv_sec == p_st->st_mtim.tv_sec) &&
+			(p_entry->mtime.tv_nsec == p_st->st_mtim.tv_nsec)) ? GSI_FC_TRUE : GSI_FC_FALSE;
+}
+
+/*###########################################################################
+	 * Name:		file_cache_lru_push_front
+	 * Description: Insert entry as the most recently used. Must be called with the lock held.
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache object
+	 * Parameter:   [in] gsi_file_cache_entry_t* p_entry - entry to insert
+	 * Return:		None
+#############################################################################*/
+static void file_cache_lru_push_front(gsi_file_cache_t* p_cache, gsi_file_cache_entry_t* p_entry)
+{
+	p_entry->p_lru_prev = NULL;
+	p_entry->p_lru_next = p_cache->p_lru_head;
+
+	if (NULL != p_cache->p_lru_head)
+	{
+		p_cache->p_lru_head->p_lru_prev = p_entry;
+	}
+	else
+	{
+		p_cache->p_lru_tail = p_entry;
+	}
+
+	p_cache->p_lru_head = p_entry;
+}
+
+/*###########################################################################
+	 * Name:		file_cache_lru_remove
+	 * Description: Remove entry from the LRU list. Must be called with the lock held.
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache object
+	 * Parameter:   [in] gsi_file_cache_entry_t* p_entry - entry to remove
+	 * Return:		None
+#############################################################################*/
+static void file_cache_lru_remove(gsi_file_cache_t* p_cache, gsi_file_cache_entry_t* p_entry)
+{
+	if (NULL != p_entry->p_lru_prev)
+	{
+		p_entry->p_lru_prev->p_lru_next = p_entry->p_lru_next;
+	}
+	else
+	{
+		p_cache->p_lru_head = p_entry->p_lru_next;
+	}
+
+	if (NULL != p_entry->p_lru_next)
+	{
+		p_entry->p_lru_next->p_lru_prev = p_entry->p_lru_prev;
+	}
+	else
+	{
+		p_cache->p_lru_tail = p_entry->p_lru_prev;
+	}
+
+	p_entry->p_lru_prev = NULL;
+	p_entry->p_lru_next = NULL;
+}
+
+/*###########################################################################
+	 * Name:		file_cache_unlink
+	 * Description: Remove entry from the cache. Pinned entries are freed by their
+	 * 				last reader. Drops the inotify watch if no other entry uses it.
+	 * 				Must be called with the lock held.
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache object
+	 * Parameter:   [in] gsi_file_cache_entry_t* p_entry - entry to remove
+	 * Return:		None
+#############################################################################*/
+static void file_cache_unlink(gsi_file_cache_t* p_cache, gsi_file_cache_entry_t* p_entry)
+{
+	gsi_file_cache_entry_t** pp_link = &(p_cache->p_buckets[p_entry->ui_hash % GSI_FC_BUCKETS]);
+	int i_wd_in_use = GSI_FC_FALSE;
+
+	// Remove from hash bucket
+	while ((NULL != *pp_link) && (p_entry != *pp_link))
+	{
+		pp_link = &((*pp_link)->p_hash_next);
+	}
+
+	if (NULL != *pp_link)
+	{
+		*pp_link = p_entry->p_hash_next;
+	}
+
+	p_entry->p_hash_next = NULL;
+
+	// Only READY entries are accounted in the LRU list
+	if ((GSI_FC_ENTRY_READY == p_entry->i_state) &&
+		((NULL != p_entry->p_lru_prev) || (p_cache->p_lru_head == p_entry)))
+	{
+		file_cache_lru_remove(p_cache, p_entry);
+		p_cache->stats.ul_bytes -= p_entry->ul_len;
+		p_cache->stats.ui_entries--;
+	}
+
+	// inotify returns the same watch for the same inode - keep it while shared
+	if (0 <= p_entry->i_wd)
+	{
+		for (int i = 0; (i < GSI_FC_BUCKETS) && (!i_wd_in_use); ++i)
+		{
+			for (gsi_file_cache_entry_t* p_it = p_cache->p_buckets[i]; NULL != p_it; p_it = p_it->p_hash_next)
+			{
+				if (p_entry->i_wd == p_it->i_wd)
+				{
+					i_wd_in_use = GSI_FC_TRUE;
+					break;
+				}
+			}
+		}
+
+		if (!i_wd_in_use)
+		{
+			inotify_rm_watch(p_cache->i_inotify_fd, p_entry->i_wd);
+		}
+
+		p_entry->i_wd = -1;
+	}
+
+	p_entry->i_stale = GSI_FC_TRUE;
+
+	if (0 == p_entry->i_refs)
+	{
+		file_cache_free_entry(p_entry);
+	}
+}
+
+/*###########################################################################
+	 * Name:		file_cache_evict
+	 * Description: Drop least recently used entries until the cache fits its limit.
+	 * 				Must be called with the lock held.
+	 * Parameter:   [in] gsi_file_cache_t* p_cache - cache object
+	 * Return:		None
+#############################################################################*/
+static void file_cache_evict(gsi_file_cache_t* p_cache)
+{
+	while ((p_cache->stats.ul_bytes > p_cache->ul_max_bytes) && (NULL != p_cache->p_lru_tail))
+	{
+		LOG_DEBUG("evict %s from file cache", p_cache->p_lru_tail->s_path);
+
+		file_cache_unlink(p_cache, p_cache->p_lru_tail);
+		p_cache->stats.ul_evictions++;
+	}
+}
+
+/*###########################################################################
+	 * Name:		file_cache_free_entry
+	 * Description: Free entry and its content
+	 * Parameter:   [in] gsi_file_cache_entry_t* p_entry - entry to free
+	 * Return:		None
+#############################################################################*/
+static void file_cache_free_entry(gsi_file_cache_entry_t* p_entry)
+{
+	free(p_entry->p_data);
+	free(p_entry->s_path);
+	free(p_entry);
+}
+
+/*###########################################################################
+	 * Name:		file_cache_read_file
+	 * Description: Read the whole file into the entry and set its key
+	 * 				from the opened file (not from the earlier stat)
+	 * Parameter:   [in] const char* s_path - file to read
+	 * Parameter:   [out] gsi_file_cache_entry_t* p_entry - entry to fill
+	 * Return:		Success - 0
+	 * 				Failure - -1
+#############################################################################*/
+static int file_cache_read_file(const char* s_path, gsi_file_cache_entry_t* p_entry)
+{
+	struct stat st;
+	size_t ul_cap = 0;
+	size_t ul_len = 0;
+	ssize_t l_count = 0;
+	char* p_data = NULL;
+
+	int i_fd = open(s_path, O_RDONLY | O_CLOEXEC);
+	if (0 > i_fd)
+	{
+		return -1;
+	}
+
+	if (0 != fstat(i_fd, &st))
+	{
+		close(i_fd);
+		return -1;
+	}
+
+	// Size from fstat, but read until EOF in case the file is still growing
+	ul_cap = st.st_size + 1;
+	p_data = (char*)malloc(ul_cap);
+	if (NULL == p_data)
+	{
+		close(i_fd);
+		return -1;
+	}
+
+	while (1)
+	{
+		if (ul_len + 1 == ul_cap)
+		{
+			char* p_new = (char*)realloc(p_data, ul_cap * 2);
+			if (NULL == p_new)
+			{
+				free(p_data);
+				close(i_fd);
+				return -1;
+			}
+
+			p_data = p_new;
+			ul_cap *= 2;
+		}
+
+		l_count = read(i_fd, p_data + ul_len, ul_cap - ul_len - 1);
+		if (0 > l_count)
+		{
+			free(p_data);
+			close(i_fd);
+			return -1;
+		}
+
+		if (0 == l_count)
+		{
+			break;
+		}
+
+		ul_len += l_count;
+	}
+
+	close(i_fd);
+
+	p_data[ul_len] = '\0';
+
+	p_entry->p_data = p_data;
+	p_entry->ul_len = ul_len;
+	p_entry->dev = st.st_dev;
+	p_entry->ino = st.st_ino;
+	p_entry->mtime = st.st_mtim;
+	p_entry->size = st.st_size;
+
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		file_cache_watch_thread
+	 * Description: Read inotify events and invalidate the entries of changed files
+	 * Parameter:   [in] void* p_args - must be pointer to file cache object
+	 * Return:		Always NULL
+#############################################################################*/
+static void* file_cache_watch_thread(void* p_args)
+{
+	gsi_file_cache_t* p_cache = (gsi_file_cache_t*)p_args;
+	char s_events[GSI_FC_EVENTS_BUF_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+	struct pollfd pfds[2];
+	ssize_t l_len = 0;
+
+	pfds[0].fd = p_cache->i_inotify_fd;
+	pfds[0].events = POLLIN;
+	pfds[1].fd = p_cache->i_wake_fds[0];
+	pfds[1].events = POLLIN;
+
+	while (1)
+	{
+		if (0 > poll(pfds, 2, -1))
+		{
+			continue;
+		}
+
+		// Destroy was called
+		if (pfds[1].revents & POLLIN)
+		{
+			break;
+		}
+
+		if (!(pfds[0].revents & POLLIN))
+		{
+			continue;
+		}
+
+		l_len = read(p_cache->i_inotify_fd, s_events, sizeof(s_events));
+		if (0 >= l_len)
+		{
+			continue;
+		}
+
+		pthread_mutex_lock(&(p_cache->lock));
+
+		for (char* p_ptr = s_events; p_ptr < s_events + l_len; )
+		{
+			const struct inotify_event* p_event = (const struct inotify_event*)p_ptr;
+
+			// Drop every entry that uses the watch of the changed file - a loading one
+			// is served to its waiting readers once and freed (its read may be old)
+			for (int i = 0; i < GSI_FC_BUCKETS; ++i)
+			{
+				gsi_file_cache_entry_t* p_entry = p_cache->p_buckets[i];
+				gsi_file_cache_entry_t* p_next = NULL;
+
+				for (; NULL != p_entry; p_entry = p_next)
+				{
+					p_next = p_entry->p_hash_next;
+
+					if ((p_event->wd == p_entry->i_wd) && (GSI_FC_ENTRY_FAILED != p_entry->i_state))
+					{
+						// Watch is already gone, don't remove it again
+						if (p_event->mask & IN_IGNORED)
+						{
+							p_entry->i_wd = -1;
+						}
+
+						LOG_DEBUG("file %s changed, invalidate cache entry", p_entry->s_path);
+
+						file_cache_unlink(p_cache, p_entry);
+						p_cache->stats.ul_invalidations++;
+					}
+				}
+			}
+
+			p_ptr += sizeof(struct inotify_event) + p_event->len;
+		}
+
+		pthread_mutex_unlock(&(p_cache->lock));
+	}
+
+	return NULL;
+}
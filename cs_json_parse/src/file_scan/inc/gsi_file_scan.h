@@ -0,0 +1,226 @@
+/**************************************************************************
+* Name : gsi_file_scan.h
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Fast search of lines in message files ("<id> <msg>" per line).
+* 				The file is mapped to memory and scanned with vector instructions
+* 				(AVX2 or SSE2, chosen at run time, plain C on other CPUs).
+* 				Big files are split into chunks on line boundaries and the
+* 				chunks are scanned in parallel by a thread pool.
+* 				Query is a pattern (lines that contain it) or an id range
+* 				(lines that start with id in the range).
+* 				Using: 1. gsi_file_scan_create() - Must be first!
+* 					   2. gsi_file_scan_search() (or gsi_file_scan_search_buffer()) /
+* 						  gsi_file_scan_result_free() - as much as you want.
+* 					   3. gsi_file_scan_destroy() - Must be last!
+*****************************************************************************/
+#ifndef GSI_FILE_SCAN_H_
+#define GSI_FILE_SCAN_H_
+
+/* Includes */
+#include <stddef.h>
+#include "gsi_thread_pool.h"
+
+/* Defines and Macros */
+#define 	GSI_FS_DEFAULT_WORKERS		4					/* worker threads of scanner */
+#define 	GSI_FS_MIN_CHUNK_SIZE		(1024 * 1024)		/* don't split files smaller than this */
+#define 	GSI_FS_MAX_PATTERN_LEN		1024
+#define 	GSI_FS_ID_RANGE_PREFIX		"id:"				/* query "id:<from>-<to>" */
+
+/* Typedef */
+typedef struct gsi_file_scan gsi_file_scan_t;
+
+/* Enums */
+/***************************************************************************
+ * Name:  		gsi_file_scan_rc
+ * Description: Return Code values for GSI-FILE-SCAN functions
+ ***************************************************************************/
+enum gsi_file_scan_rc {
+	GSI_FS_RC_SUCCESS  = 0,	// Function completed Successfully
+	GSI_FS_RC_ERROR    = 1,	// Function completed with Error
+	GSI_FS_RC_INVALID  = 2,	// Function got invalid arguments
+	GSI_FS_RC_OPEN_ERR = 3	// File doesn't exist or couldn't be mapped
+};
+
+/***************************************************************************
+ * Name:  		gsi_file_scan_query_type
+ * Description: Kind of search
+ ***************************************************************************/
+enum gsi_file_scan_query_type {
+	GSI_FS_QUERY_PATTERN  = 0,	// Lines that contain a pattern
+	GSI_FS_QUERY_ID_RANGE = 1	// Lines that start with id in [from, to]
+};
+
+/* Structures */
+/*****************************************************************************
+ * Name : gsi_file_scan_query
+ * Used by: gsi_file_scan_search()
+ * Members:
+ *----------------------------------------------------------------------------
+ *		int i_type - One of gsi_file_scan_query_type
+ *----------------------------------------------------------------------------
+ *		char s_pattern[] - Pattern to search (GSI_FS_QUERY_PATTERN)
+ *----------------------------------------------------------------------------
+ *		size_t ul_pattern_len - Length of s_pattern
+ *----------------------------------------------------------------------------
+ *		long l_id_from, l_id_to - Range of ids (GSI_FS_QUERY_ID_RANGE)
+ *****************************************************************************/
+struct gsi_file_scan_query
+{
+	int i_type;
+	char s_pattern[GSI_FS_MAX_PATTERN_LEN + 1];
+	size_t ul_pattern_len;
+	long l_id_from;
+	long l_id_to;
+};
+
+/*****************************************************************************
+ * Name : gsi_file_scan_match
+ * Used by: struct gsi_file_scan_result
+ * Members:
+ *----------------------------------------------------------------------------
+ *		size_t ul_offset - Offset of line in file
+ *----------------------------------------------------------------------------
+ *		size_t ul_len - Length of line without the '\n'
+ *****************************************************************************/
+struct gsi_file_scan_match
+{
+	size_t ul_offset;
+	size_t ul_len;
+};
+
+/*****************************************************************************
+ * Name : gsi_file_scan_result
+ * Used by: gsi_file_scan_search()
+ * Members:
+ *----------------------------------------------------------------------------
+ *		const char* p_data - File content (mapped until gsi_file_scan_result_free())
+ *		  					 or the searched buffer
+ *----------------------------------------------------------------------------
+ *		size_t ul_size - Size of file
+ *----------------------------------------------------------------------------
+ *		struct gsi_file_scan_match* p_matches - Matched lines in file order
+ *----------------------------------------------------------------------------
+ *		size_t ul_count - Number of matched lines
+ *----------------------------------------------------------------------------
+ *		int i_chunks - Number of chunks the file was split into
+ *----------------------------------------------------------------------------
+ *		int i_mapped - p_data is a mapping of the file (unmapped by gsi_file_scan_result_free())
+ *****************************************************************************/
+struct gsi_file_scan_result
+{
+	const char* p_data;
+	size_t ul_size;
+	struct gsi_file_scan_match* p_matches;
+	size_t ul_count;
+	int i_chunks;
+	int i_mapped;
+};
+
+/*****************************************************************************
+ * Name : gsi_file_scan
+ * Used by: GSI-FILE-SCAN API functions
+ * Members:
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_t* p_pool - Worker threads for chunks
+ *----------------------------------------------------------------------------
+ *		int i_workers - Number of worker threads
+ *****************************************************************************/
+struct gsi_file_scan
+{
+	gsi_thread_pool_t* p_pool;
+	int i_workers;
+};
+
+/*******************/
+/* API Declaration */
+/*******************/
+/*###########################################################################
+	 * Name:		gsi_file_scan_create
+	 * Description: Creates a scanner with its worker threads.
+	 * 				Must use gsi_file_scan_destroy() before exit!
+	 * Parameter:   [in] int i_workers - number of worker threads (1 - GSI_IS_MAX_THREADS)
+	 * Return:		Success - pointer to new scanner object
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_file_scan_t* gsi_file_scan_create(int i_workers);
+
+
+/*###########################################################################
+	 * Name:		gsi_file_scan_parse_query
+	 * Description: Build a query from a string:
+	 * 				"id:<from>-<to>" - id range
+	 * 				anything else 	 - pattern (trailing new line is removed)
+	 * Parameter:   [in] const char* s_query - query string
+	 * Parameter:   [out] struct gsi_file_scan_query* p_query - query to fill
+	 * Return:		Success - GSI_FS_RC_SUCCESS
+	 * 				Failure - GSI_FS_RC_INVALID
+#############################################################################*/
+enum gsi_file_scan_rc gsi_file_scan_parse_query(const char* s_query, struct gsi_file_scan_query* p_query);
+
+
+/*###########################################################################
+	 * Name:		gsi_file_scan_search
+	 * Description: Find all lines of a file that match a query.
+	 * 				The result MUST be freed by gsi_file_scan_result_free().
+	 * Parameter:   [in] gsi_file_scan_t* p_scan - scanner object
+	 * Parameter:   [in] const char* s_path - file to search
+	 * Parameter:   [in] const struct gsi_file_scan_query* p_query - what to search
+	 * Parameter:   [out] struct gsi_file_scan_result* p_result - matched lines
+	 * Return:		Success - GSI_FS_RC_SUCCESS
+	 * 				Failure - GSI_FS_RC_OPEN_ERR *OR* GSI_FS_RC_ERROR *OR* GSI_FS_RC_INVALID
+#############################################################################*/
+enum gsi_file_scan_rc gsi_file_scan_search(gsi_file_scan_t* p_scan,
+										   const char* s_path,
+										   const struct gsi_file_scan_query* p_query,
+										   struct gsi_file_scan_result* p_result);
+
+
+/*###########################################################################
+	 * Name:		gsi_file_scan_search_buffer
+	 * Description: Find all lines of a buffer that match a query (as gsi_file_scan_search()).
+	 * 				The buffer must stay valid while the result is used.
+	 * 				The result MUST be freed by gsi_file_scan_result_free().
+	 * Parameter:   [in] gsi_file_scan_t* p_scan - scanner object
+	 * Parameter:   [in] const char* p_data - lines to search
+	 * Parameter:   [in] size_t ul_size - size of p_data
+	 * Parameter:   [in] const struct gsi_file_scan_query* p_query - what to search
+	 * Parameter:   [out] struct gsi_file_scan_result* p_result - matched lines
+	 * Return:		Success - GSI_FS_RC_SUCCESS
+	 * 				Failure - GSI_FS_RC_ERROR *OR* GSI_FS_RC_INVALID
+#############################################################################*/
+enum gsi_file_scan_rc gsi_file_scan_search_buffer(gsi_file_scan_t* p_scan,
+												  const char* p_data,
+												  size_t ul_size,
+												  const struct gsi_file_scan_query* p_query,
+												  struct gsi_file_scan_result* p_result);
+
+
+/*###########################################################################
+	 * Name:		gsi_file_scan_result_free
+	 * Description: Unmap the file (not a searched buffer) and free the matches of a result
+	 * Parameter:   [in] struct gsi_file_scan_result* p_result - result to free
+	 * Return:		None
+#############################################################################*/
+void gsi_file_scan_result_free(struct gsi_file_scan_result* p_result);
+
+
+/*###########################################################################
+	 * Name:		gsi_file_scan_get_isa
+	 * Description: Name of the instruction set used by the scanner
+	 * Return:		"avx2", "sse2" or "scalar"
+#############################################################################*/
+const char* gsi_file_scan_get_isa();
+
+
+/*###########################################################################
+	 * Name:		gsi_file_scan_destroy
+	 * Description: Stop the worker threads and free the scanner
+	 * Parameter:   [in] gsi_file_scan_t* p_scan - scanner to destroy
+	 * Return:		Success - GSI_FS_RC_SUCCESS
+	 * 				Failure - GSI_FS_RC_ERROR *OR* GSI_FS_RC_INVALID
+#############################################################################*/
+enum gsi_file_scan_rc gsi_file_scan_destroy(gsi_file_scan_t* p_scan);
+
+
+#endif /* GSI_FILE_SCAN_H_ */
@@ -0,0 +1,830 @@
+/**************************************************************************
+* Name : gsi_file_scan.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Implementation of "gsi_file_scan.h"
+* 				Every use of gsi_file_scan_create() must also use gsi_file_scan_destroy() !
+*****************************************************************************/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define 	GSI_FS_HAVE_X86		1
+#endif
+#include "gsi_file_scan.h"
+#include "gsi_is_log_api.h"
+
+/* Defines and Macros */
+#define 	GSI_FS_TRUE				1
+#define 	GSI_FS_FALSE			0
+#define 	GSI_FS_QUEUE_SIZE		64
+#define 	GSI_FS_MATCHES_INIT_CAP	64
+
+/* Typedef */
+
+// vectorized primitives, chosen once at run time
+typedef const char* (*scan_memchr_func_t)(const char* p_buf, char c, size_t ul_len);
+typedef const char* (*scan_find_func_t)(const char* p_buf, size_t ul_len, const char* p_pat, size_t ul_pat_len);
+
+/* Structures */
+/*****************************************************************************
+ * Name : scan_chunk
+ * Used by: worker threads
+ * Members:
+ *		const char* p_begin, p_end - Part of the file, starts at a line start
+ *		const char* p_base - Start of file (for offsets)
+ *		const struct gsi_file_scan_query* p_query - What to search
+ *		struct gsi_file_scan_match* p_matches, ul_count, ul_cap - Matches of chunk
+ *		int i_failed - Memory allocation failed
+ *		gsi_thread_pool_future_t* p_future - Future of chunk task (NULL if run by caller)
+ *****************************************************************************/
+struct scan_chunk
+{
+	const char* p_begin;
+	const char* p_end;
+	const char* p_base;
+	const struct gsi_file_scan_query* p_query;
+	struct gsi_file_scan_match* p_matches;
+	size_t ul_count;
+	size_t ul_cap;
+	int i_failed;
+	gsi_thread_pool_future_t* p_future;
+};
+
+/********************************/
+/* Static functions declaration */
+/********************************/
+static enum gsi_file_scan_rc file_scan_search_chunks(gsi_file_scan_t* p_scan,
+													 const struct gsi_file_scan_query* p_query,
+													 struct gsi_file_scan_result* p_result);
+static void file_scan_init_isa();
+static const char* file_scan_memchr_scalar(const char* p_buf, char c, size_t ul_len);
+static const char* file_scan_find_scalar(const char* p_buf, size_t ul_len, const char* p_pat, size_t ul_pat_len);
+#ifdef GSI_FS_HAVE_X86
+static const char* file_scan_memchr_sse2(const char* p_buf, char c, size_t ul_len);
+static const char* file_scan_find_sse2(const char* p_buf, size_t ul_len, const char* p_pat, size_t ul_pat_len);
+static const char* file_scan_memchr_avx2(const char* p_buf, char c, size_t ul_len);
+static const char* file_scan_find_avx2(const char* p_buf, size_t ul_len, const char* p_pat, size_t ul_pat_len);
+#endif
+static int file_scan_add_match(struct scan_chunk* p_chunk, const char* p_line, const char* p_line_end);
+static void file_scan_chunk_pattern(struct scan_chunk* p_chunk);
+static void file_scan_chunk_id_range(struct scan_chunk* p_chunk);
+static void* file_scan_chunk_task(void* p_args);
+
+/* Global variables */
+static pthread_once_t g_isa_once = PTHREAD_ONCE_INIT;
+static scan_memchr_func_t g_scan_memchr = file_scan_memchr_scalar;
+static scan_find_func_t g_scan_find = file_scan_find_scalar;
+static const char* g_s_isa = "scalar";
+
+/**********************/
+/* API implementation */
+/**********************/
+/*###########################################################################
+	 * Name:		gsi_file_scan_create
+	 * Description: Creates a scanner with its worker threads.
+	 * 				Must use gsi_file_scan_destroy() before exit!
+	 * Parameter:   [in] int i_workers - number of worker threads (1 - GSI_IS_MAX_THREADS)
+	 * Return:		Success - pointer to new scanner object
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_file_scan_t* gsi_file_scan_create(int i_workers)
+{
+	gsi_file_scan_t* p_scan = NULL;
+
+	// Check input validation
+	if ((0 >= i_workers) || (GSI_IS_MAX_THREADS < i_workers))
+	{
+		LOG_ERROR("invalid number of workers: %d", i_workers);
+		return NULL;
+	}
+
+	// Choose the instruction set
+	pthread_once(&g_isa_once, file_scan_init_isa);
+
+	p_scan = (gsi_file_scan_t*)calloc(1, sizeof(gsi_file_scan_t));
+	if (NULL == p_scan)
+	{
+		LOG_ERROR("memory allocation for scanner failed");
+		return NULL;
+	}
+
+	p_scan->i_workers = i_workers;
+	p_scan->p_pool = gsi_is_thread_pool_create(i_workers, GSI_FS_QUEUE_SIZE);
+	if (NULL == p_scan->p_pool)
+	{
+		LOG_ERROR("couldn't create thread pool of scanner");
+		free(p_scan);
+		return NULL;
+	}
+
+	LOG_INFO("file scanner created with %d workers (%s)", i_workers, g_s_isa);
+	return p_scan;
+}
+
+/*###########################################################################
+	 * Name:		gsi_file_scan_parse_query
+	 * Description: Build a query from a string:
+	 * 				"id:<from>-<to>" - id range
+	 * 				anything else 	 - pattern (trailing new line is removed)
+	 * Parameter:   [in] const char* s_query - query string
+	 * Parameter:   [out] struct gsi_file_scan_query* p_query - query to fill
+	 * Return:		Success - GSI_FS_RC_SUCCESS
+	 * 				Failure - GSI_FS_RC_INVALID
+#############################################################################*/
+enum gsi_file_scan_rc gsi_file_scan_parse_query(const char* s_query, struct gsi_file_scan_query* p_query)
+{
+	char* s_res = NULL;
+	size_t ul_len = 0;
+
+	// Check input validation
+	if ((NULL == s_query) || (NULL == p_query))
+	{
+		return GSI_FS_RC_INVALID;
+	}
+
+	memset(p_query, 0, sizeof(struct gsi_file_scan_query));
+
+	// Id range
+	if (0 == strncmp(s_query, GSI_FS_ID_RANGE_PREFIX, strlen(GSI_FS_ID_RANGE_PREFIX)))
+	{
+		p_query->i_type = GSI_FS_QUERY_ID_RANGE;
+		p_query->l_id_from = strtol(s_query + strlen(GSI_FS_ID_RANGE_PREFIX), &s_res, 10);
+		if ('-' != *s_res)
+		{
+			return GSI_FS_RC_INVALID;
+		}
+		p_query->l_id_to = strtol(s_res + 1, &s_res, 10);
+		if (p_query->l_id_from > p_query->l_id_to)
+		{
+			return GSI_FS_RC_INVALID;
+		}
+		return GSI_FS_RC_SUCCESS;
+	}
+
+	// Pattern - a line never contains the new line
+	ul_len = strcspn(s_query, "\r\n");
+	if ((0 == ul_len) || (GSI_FS_MAX_PATTERN_LEN < ul_len))
+	{
+		return GSI_FS_RC_INVALID;
+	}
+
+	p_query->i_type = GSI_FS_QUERY_PATTERN;
+	memcpy(p_query->s_pattern, s_query, ul_len);
+	p_query->s_pattern[ul_len] = '\0';
+	p_query->ul_pattern_len = ul_len;
+
+	return GSI_FS_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_file_scan_search
+	 * Description: Find all lines of a file that match a query.
+	 * 				The file is split into one chunk per worker plus one for the
+	 * 				calling thread, each chunk starts at a line start.
+	 * 				The result MUST be freed by gsi_file_scan_result_free().
+	 * Parameter:   [in] gsi_file_scan_t* p_scan - scanner object
+	 * Parameter:   [in] const char* s_path - file to search
+	 * Parameter:   [in] const struct gsi_file_scan_query* p_query - what to search
+	 * Parameter:   [out] struct gsi_file_scan_result* p_result - matched lines
+	 * Return:		Success - GSI_FS_RC_SUCCESS
+	 * 				Failure - GSI_FS_RC_OPEN_ERR *OR* GSI_FS_RC_ERROR *OR* GSI_FS_RC_INVALID
+#############################################################################*/
+enum gsi_file_scan_rc gsi_file_scan_search(gsi_file_scan_t* p_scan,
+										   const char* s_path,
+										   const struct gsi_file_scan_query* p_query,
+										   struct gsi_file_scan_result* p_result)
+{
+	int i_fd = -1;
+	struct stat st;
+	char* p_data = NULL;
+
+	// Check input validation
+	if ((NULL == p_scan) || (NULL == s_path) || (NULL == p_query) || (NULL == p_result) ||
+		((GSI_FS_QUERY_PATTERN == p_query->i_type) && (0 == p_query->ul_pattern_len)))
+	{
+		return GSI_FS_RC_INVALID;
+	}
+
+	memset(p_result, 0, sizeof(struct gsi_file_scan_result));
+
+	// Map the file
+	i_fd = open(s_path, O_RDONLY | O_CLOEXEC);
+	if ((0 > i_fd) || (0 != fstat(i_fd, &st)))
+	{
+		LOG_ERROR("failed to open %s", s_path);
+		if (0 <= i_fd)
+		{
+			close(i_fd);
+		}
+		return GSI_FS_RC_OPEN_ERR;
+	}
+
+	if (0 == st.st_size)
+	{
+		close(i_fd);
+		return GSI_FS_RC_SUCCESS;
+	}
+
+	p_data = (char*)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, i_fd, 0);
+	close(i_fd);
+	if (MAP_FAILED == p_data)
+	{
+		LOG_ERROR("failed to map %s (errno %d)", s_path, errno);
+		return GSI_FS_RC_OPEN_ERR;
+	}
+	madvise(p_data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+	p_result->p_data = p_data;
+	p_result->ul_size = (size_t)st.st_size;
+	p_result->i_mapped = GSI_FS_TRUE;
+
+	return file_scan_search_chunks(p_scan, p_query, p_result);
+}
+
+/*###########################################################################
+	 * Name:		gsi_file_scan_search_buffer
+	 * Description: Find all lines of a buffer that match a query (as gsi_file_scan_search()).
+	 * 				The buffer must stay valid while the result is used.
+	 * 				The result MUST be freed by gsi_file_scan_result_free().
+	 * Parameter:   [in] gsi_file_scan_t* p_scan - scanner object
+	 * Parameter:   [in] const char* p_data - lines to search
+	 * Parameter:   [in] size_t ul_size - size of p_data
+	 * Parameter:   [in] const struct gsi_file_scan_query* p_query - what to search
+	 * Parameter:   [out] struct gsi_file_scan_result* p_result - matched lines
+	 * Return:		Success - GSI_FS_RC_SUCCESS
+	 * 				Failure - GSI_FS_RC_ERROR *OR* GSI_FS_RC_INVALID
+#############################################################################*/
+enum gsi_file_scan_rc gsi_file_scan_search_buffer(gsi_file_scan_t* p_scan,
+												  const char* p_data,
+												  size_t ul_size,
+												  const struct gsi_file_scan_query* p_query,
+												  struct gsi_file_scan_result* p_result)
+{
+	// Check input validation
+	if ((NULL == p_scan) || ((NULL == p_data) && (0 != ul_size)) || (NULL == p_query) || (NULL == p_result) ||
+		((GSI_FS_QUERY_PATTERN == p_query->i_type) && (0 == p_query->ul_pattern_len)))
+	{
+		return GSI_FS_RC_INVALID;
+	}
+
+	memset(p_result, 0, sizeof(struct gsi_file_scan_result));
+
+	if (0 == ul_size)
+	{
+		return GSI_FS_RC_SUCCESS;
+	}
+
+	p_result->p_data = p_data;
+	p_result->ul_size = ul_size;
+
+	return file_scan_search_chunks(p_scan, p_query, p_result);
+}
+
+/*###########################################################################
+	 * Name:		gsi_file_scan_result_free
+	 * Description: Unmap the file (not a searched buffer) and free the matches of a result
+	 * Parameter:   [in] struct gsi_file_scan_result* p_result - result to free
+	 * Return:		None
+#############################################################################*/
+void gsi_file_scan_result_free(struct gsi_file_scan_result* p_result)
+{
+	if (NULL == p_result)
+	{
+		return;
+	}
+
+	if ((NULL != p_result->p_data) && (GSI_FS_TRUE == p_result->i_mapped))
+	{
+		munmap((void*)p_result->p_data, p_result->ul_size);
+	}
+
+	free(p_result->p_matches);
+	memset(p_result, 0, sizeof(struct gsi_file_scan_result));
+}
+
+/*###########################################################################
+	 * Name:		gsi_file_scan_get_isa
+	 * Description: Name of the instruction set used by the scanner
+	 * Return:		"avx2", "sse2" or "scalar"
+#############################################################################*/
+const char* gsi_file_scan_get_isa()
+{
+	pthread_once(&g_isa_once, file_scan_init_isa);
+
+	return g_s_isa;
+}
+
+/*###########################################################################
+	 * Name:		gsi_file_scan_destroy
+	 * Description: Stop the worker threads and free the scanner
+	 * Parameter:   [in] gsi_file_scan_t* p_scan - scanner to destroy
+	 * Return:		Success - GSI_FS_RC_SUCCESS
+	 * 				Failure - GSI_FS_RC_ERROR *OR* GSI_FS_RC_INVALID
+#############################################################################*/
+enum gsi_file_scan_rc gsi_file_scan_destroy(gsi_file_scan_t* p_scan)
+{
+	enum gsi_file_scan_rc e_rc = GSI_FS_RC_SUCCESS;
+
+	// Check input validation
+	if (NULL == p_scan)
+	{
+		return GSI_FS_RC_INVALID;
+	}
+
+	if (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_destroy(p_scan->p_pool, GSI_TP_DESTROY_GRACEFUL))
+	{
+		LOG_ERROR("couldn't destroy thread pool of scanner");
+		e_rc = GSI_FS_RC_ERROR;
+	}
+
+	free(p_scan);
+
+	return e_rc;
+}
+
+/************************************/
+/* Static functions implementation  */
+/************************************/
+/*###########################################################################
+	 * Name:		file_scan_search_chunks
+	 * Description: Split the data of a result into one chunk per worker plus one
+	 * 				for the calling thread (each chunk starts at a line start), scan
+	 * 				them and merge the matches. Frees the result on failure.
+	 * Parameter:   [in] gsi_file_scan_t* p_scan - scanner object
+	 * Parameter:   [in] const struct gsi_file_scan_query* p_query - what to search
+	 * Parameter:   [in,out] struct gsi_file_scan_result* p_result - data to scan, matched lines
+	 * Return:		Success - GSI_FS_RC_SUCCESS
+	 * 				Failure - GSI_FS_RC_ERROR
+#############################################################################*/
+static enum gsi_file_scan_rc file_scan_search_chunks(gsi_file_scan_t* p_scan,
+													 const struct gsi_file_scan_query* p_query,
+													 struct gsi_file_scan_result* p_result)
+{
+	int i = 0;
+	int i_chunks = 1;
+	int i_failed = GSI_FS_FALSE;
+	const char* p_data = p_result->p_data;
+	const char* p_nl = NULL;
+	size_t ul_total = 0;
+	struct scan_chunk* p_chunks = NULL;
+
+	// One chunk per worker plus the caller, only for big files
+	if (GSI_FS_MIN_CHUNK_SIZE <= p_result->ul_size)
+	{
+		i_chunks = p_scan->i_workers + 1;
+	}
+
+	p_chunks = (struct scan_chunk*)calloc(i_chunks, sizeof(struct scan_chunk));
+	if (NULL == p_chunks)
+	{
+		gsi_file_scan_result_free(p_result);
+		return GSI_FS_RC_ERROR;
+	}
+
+	// Split on line boundaries - a line belongs to the chunk of its first byte
+	for (i = 0; i < i_chunks; ++i)
+	{
+		p_chunks[i].p_base = p_data;
+		p_chunks[i].p_query = p_query;
+		p_chunks[i].p_begin = p_data + (p_result->ul_size / i_chunks) * i;
+		if ((0 < i) && ('\n' != p_chunks[i].p_begin[-1]))
+		{
+			p_nl = g_scan_memchr(p_chunks[i].p_begin, '\n', p_data + p_result->ul_size - p_chunks[i].p_begin);
+			p_chunks[i].p_begin = (NULL == p_nl) ? p_data + p_result->ul_size : p_nl + 1;
+		}
+		if (0 < i)
+		{
+			p_chunks[i - 1].p_end = p_chunks[i].p_begin;
+		}
+	}
+	p_chunks[i_chunks - 1].p_end = p_data + p_result->ul_size;
+
+	// Chunks 1..n to the workers, chunk 0 by this thread
+	for (i = 1; i < i_chunks; ++i)
+	{
+		p_chunks[i].p_future = gsi_is_thread_pool_add_future(p_scan->p_pool, file_scan_chunk_task, &(p_chunks[i]), 0);
+		if (NULL == p_chunks[i].p_future)
+		{
+			// Queue is full - do it here
+			file_scan_chunk_task(&(p_chunks[i]));
+		}
+	}
+
+	file_scan_chunk_task(&(p_chunks[0]));
+
+	// Wait for the workers
+	for (i = 1; i < i_chunks; ++i)
+	{
+		if (NULL != p_chunks[i].p_future)
+		{
+			gsi_is_thread_pool_future_wait(p_chunks[i].p_future, GSI_TP_WAIT_FOREVER, NULL);
+			gsi_is_thread_pool_future_release(p_chunks[i].p_future);
+		}
+	}
+
+	// Merge the matches in file order
+	for (i = 0; i < i_chunks; ++i)
+	{
+		ul_total += p_chunks[i].ul_count;
+		i_failed |= p_chunks[i].i_failed;
+	}
+
+	if ((GSI_FS_FALSE == i_failed) && (0 < ul_total))
+	{
+		p_result->p_matches = (struct gsi_file_scan_match*)malloc(ul_total * sizeof(struct gsi_file_scan_match));
+		i_failed = (NULL == p_result->p_matches) ? GSI_FS_TRUE : GSI_FS_FALSE;
+	}
+
+	for (i = 0; i < i_chunks; ++i)
+	{
+		if ((GSI_FS_FALSE == i_failed) && (0 < p_chunks[i].ul_count))
+		{
+			memcpy(p_result->p_matches + p_result->ul_count, p_chunks[i].p_matches,
+				   p_chunks[i].ul_count * sizeof(struct gsi_file_scan_match));
+			p_result->ul_count += p_chunks[i].ul_count;
+		}
+		free(p_chunks[i].p_matches);
+	}
+	free(p_chunks);
+
+	p_result->i_chunks = i_chunks;
+
+	if (GSI_FS_TRUE == i_failed)
+	{
+		LOG_ERROR("memory allocation for matches failed");
+		gsi_file_scan_result_free(p_result);
+		return GSI_FS_RC_ERROR;
+	}
+
+	return GSI_FS_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		file_scan_init_isa
+	 * Description: Choose the best primitives for this CPU (called once)
+#############################################################################*/
+static void file_scan_init_isa()
+{
+#ifdef GSI_FS_HAVE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		g_scan_memchr = file_scan_memchr_avx2;
+		g_scan_find = file_scan_find_avx2;
+		g_s_isa = "avx2";
+	}
+	else if (__builtin_cpu_supports("sse2"))
+	{
+		g_scan_memchr = file_scan_memchr_sse2;
+		g_scan_find = file_scan_find_sse2;
+		g_s_isa = "sse2";
+	}
+#endif
+}
+
+/*###########################################################################
+	 * Name:		file_scan_memchr_scalar
+	 * Description: Find first byte c in buffer, byte by byte
+	 * Return:		pointer to byte, NULL if not found
+#############################################################################*/
+static const char* file_scan_memchr_scalar(const char* p_buf, char c, size_t ul_len)
+{
+	const char* p_end = p_buf + ul_len;
+
+	for (; p_buf < p_end; ++p_buf)
+	{
+		if (c == *p_buf)
+		{
+			return p_buf;
+		}
+	}
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		file_scan_find_scalar
+	 * Description: Find first occurrence of pattern in buffer, byte by byte
+	 * Return:		pointer to occurrence, NULL if not found
+#############################################################################*/
+static const char* file_scan_find_scalar(const char* p_buf, size_t ul_len, const char* p_pat, size_t ul_pat_len)
+{
+	const char* p_last = NULL;
+
+	if (ul_len < ul_pat_len)
+	{
+		return NULL;
+	}
+
+	p_last = p_buf + ul_len - ul_pat_len;
+	for (; p_buf <= p_last; ++p_buf)
+	{
+		if ((p_pat[0] == *p_buf) && (0 == memcmp(p_buf, p_pat, ul_pat_len)))
+		{
+			return p_buf;
+		}
+	}
+
+	return NULL;
+}
+
+#ifdef GSI_FS_HAVE_X86
+/*###########################################################################
+	 * Name:		file_scan_memchr_sse2
+	 * Description: Find first byte c in buffer, 16 bytes per step
+	 * Return:		pointer to byte, NULL if not found
+#############################################################################*/
+__attribute__((target("sse2")))
+static const char* file_scan_memchr_sse2(const char* p_buf, char c, size_t ul_len)
+{
+	size_t ul = 0;
+	unsigned int ui_mask = 0;
+	__m128i needle = _mm_set1_epi8(c);
+
+	for (; ul + 16 <= ul_len; ul += 16)
+	{
+		ui_mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(needle, _mm_loadu_si128((const __m128i*)(p_buf + ul))));
+		if (0 != ui_mask)
+		{
+			return p_buf + ul + __builtin_ctz(ui_mask);
+		}
+	}
+
+	return file_scan_memchr_scalar(p_buf + ul, c, ul_len - ul);
+}
+
+/*###########################################################################
+	 * Name:		file_scan_find_sse2
+	 * Description: Find first occurrence of pattern in buffer, 16 positions per step.
+	 * 				Positions where both the first and the last byte of the pattern
+	 * 				match are candidates, only those are compared.
+	 * Return:		pointer to occurrence, NULL if not found
+#############################################################################*/
+__attribute__((target("sse2")))
+static const char* file_scan_find_sse2(const char* p_buf, size_t ul_len, const char* p_pat, size_t ul_pat_len)
+{
+	size_t ul = 0;
+	unsigned int ui_mask = 0;
+	unsigned int ui_bit = 0;
+	__m128i first;
+	__m128i last;
+
+	if (1 == ul_pat_len)
+	{
+		return file_scan_memchr_sse2(p_buf, p_pat[0], ul_len);
+	}
+
+	if (ul_len < ul_pat_len)
+	{
+		return NULL;
+	}
+
+	first = _mm_set1_epi8(p_pat[0]);
+	last = _mm_set1_epi8(p_pat[ul_pat_len - 1]);
+
+	for (; ul + ul_pat_len - 1 + 16 <= ul_len; ul += 16)
+	{
+		ui_mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(
+					_mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)(p_buf + ul))),
+					_mm_cmpeq_epi8(last, _mm_loadu_si128((const __m128i*)(p_buf + ul + ul_pat_len - 1)))));
+		while (0 != ui_mask)
+		{
+			ui_bit = (unsigned int)__builtin_ctz(ui_mask);
+			if (0 == memcmp(p_buf + ul + ui_bit + 1, p_pat + 1, ul_pat_len - 2))
+			{
+				return p_buf + ul + ui_bit;
+			}
+			ui_mask &= ui_mask - 1;
+		}
+	}
+
+	return file_scan_find_scalar(p_buf + ul, ul_len - ul, p_pat, ul_pat_len);
+}
+
+/*###########################################################################
+	 * Name:		file_scan_memchr_avx2
+	 * Description: Find first byte c in buffer, 32 bytes per step
+	 * Return:		pointer to byte, NULL if not found
+#############################################################################*/
+__attribute__((target("avx2")))
+static const char* file_scan_memchr_avx2(const char* p_buf, char c, size_t ul_len)
+{
+	size_t ul = 0;
+	unsigned int ui_mask = 0;
+	__m256i needle = _mm256_set1_epi8(c);
+
+	for (; ul + 32 <= ul_len; ul += 32)
+	{
+		ui_mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(needle, _mm256_loadu_si256((const __m256i*)(p_buf + ul))));
+		if (0 != ui_mask)
+		{
+			return p_buf + ul + __builtin_ctz(ui_mask);
+		}
+	}
+
+	return file_scan_memchr_sse2(p_buf + ul, c, ul_len - ul);
+}
+
+/*###########################################################################
+	 * Name:		file_scan_find_avx2
+	 * Description: Find first occurrence of pattern in buffer, 32 positions per step
+	 * 				(same first/last byte filter as file_scan_find_sse2())
+	 * Return:		pointer to occurrence, NULL if not found
+#############################################################################*/
+__attribute__((target("avx2")))
+static const char* file_scan_find_avx2(const char* p_buf, size_t ul_len, const char* p_pat, size_t ul_pat_len)
+{
+	size_t ul = 0;
+	unsigned int ui_mask = 0;
+	unsigned int ui_bit = 0;
+	__m256i first;
+	__m256i last;
+
+	if (1 == ul_pat_len)
+	{
+		return file_scan_memchr_avx2(p_buf, p_pat[0], ul_len);
+	}
+
+	if (ul_len < ul_pat_len)
+	{
+		return NULL;
+	}
+
+	first = _mm256_set1_epi8(p_pat[0]);
+	last = _mm256_set1_epi8(p_pat[ul_pat_len - 1]);
+
+	for (; ul + ul_pat_len - 1 + 32 <= ul_len; ul += 32)
+	{
+		ui_mask = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(
+					_mm256_cmpeq_epi8(first, _mm256_loadu_si256((const __m256i*)(p_buf + ul))),
+					_mm256_cmpeq_epi8(last, _mm256_loadu_si256((const __m256i*)(p_buf + ul + ul_pat_len - 1)))));
+		while (0 != ui_mask)
+		{
+			ui_bit = (unsigned int)__builtin_ctz(ui_mask);
+			if (0 == memcmp(p_buf + ul + ui_bit + 1, p_pat + 1, ul_pat_len - 2))
+			{
+				return p_buf + ul + ui_bit;
+			}
+			ui_mask &= ui_mask - 1;
+		}
+	}
+
+	return file_scan_find_sse2(p_buf + ul, ul_len - ul, p_pat, ul_pat_len);
+}
+#endif /* GSI_FS_HAVE_X86 */
+
+/*###########################################################################
+	 * Name:		file_scan_add_match
+	 * Description: Add a line to the matches of a chunk
+	 * Parameter:   [in] struct scan_chunk* p_chunk - chunk
+	 * Parameter:   [in] const char* p_line, p_line_end - line without the '\n'
+	 * Return:		GSI_FS_TRUE on success, GSI_FS_FALSE on memory failure
+#############################################################################*/
+static int file_scan_add_match(struct scan_chunk* p_chunk, const char* p_line, const char* p_line_end)
+{
+	struct gsi_file_scan_match* p_new = NULL;
+	size_t ul_new_cap = 0;
+
+	if (p_chunk->ul_count == p_chunk->ul_cap)
+	{
+		ul_new_cap = (0 == p_chunk->ul_cap) ? GSI_FS_MATCHES_INIT_CAP : p_chunk->ul_cap * 2;
+		p_new = (struct gsi_file_scan_match*)realloc(p_chunk->p_matches, ul_new_cap * sizeof(struct gsi_file_scan_match));
+		if (NULL == p_new)
+		{
+			p_chunk->i_failed = GSI_FS_TRUE;
+			return GSI_FS_FALSE;
+		}
+		p_chunk->p_matches = p_new;
+		p_chunk->ul_cap = ul_new_cap;
+	}
+
+	p_chunk->p_matches[p_chunk->ul_count].ul_offset = (size_t)(p_line - p_chunk->p_base);
+	p_chunk->p_matches[p_chunk->ul_count].ul_len = (size_t)(p_line_end - p_line);
+	p_chunk->ul_count++;
+
+	return GSI_FS_TRUE;
+}
+
+/*###########################################################################
+	 * Name:		file_scan_chunk_pattern
+	 * Description: Find lines that contain the pattern. Jumps from match to match,
+	 * 				lines without a match are never looked at one by one.
+	 * Parameter:   [in] struct scan_chunk* p_chunk - chunk
+#############################################################################*/
+static void file_scan_chunk_pattern(struct scan_chunk* p_chunk)
+{
+	const struct gsi_file_scan_query* p_query = p_chunk->p_query;
+	const char* p_pos = p_chunk->p_begin;
+	const char* p_hit = NULL;
+	const char* p_line = NULL;
+	const char* p_line_end = NULL;
+
+	while (p_pos < p_chunk->p_end)
+	{
+		p_hit = g_scan_find(p_pos, p_chunk->p_end - p_pos, p_query->s_pattern, p_query->ul_pattern_len);
+		if (NULL == p_hit)
+		{
+			break;
+		}
+
+		// Go back to the start of the line
+		for (p_line = p_hit; (p_line > p_chunk->p_begin) && ('\n' != p_line[-1]); --p_line);
+
+		// And forward to its end
+		p_line_end = g_scan_memchr(p_hit, '\n', p_chunk->p_end - p_hit);
+		if (NULL == p_line_end)
+		{
+			p_line_end = p_chunk->p_end;
+		}
+
+		if (GSI_FS_TRUE != file_scan_add_match(p_chunk, p_line, p_line_end))
+		{
+			return;
+		}
+
+		p_pos = p_line_end + 1;
+	}
+}
+
+/*###########################################################################
+	 * Name:		file_scan_chunk_id_range
+	 * Description: Find lines that start with id in range (the same way
+	 * 				strtol() reads the id in READ_FILE_BY_ID)
+	 * Parameter:   [in] struct scan_chunk* p_chunk - chunk
+#############################################################################*/
+static void file_scan_chunk_id_range(struct scan_chunk* p_chunk)
+{
+	const struct gsi_file_scan_query* p_query = p_chunk->p_query;
+	const char* p_line = p_chunk->p_begin;
+	const char* p_line_end = NULL;
+	const char* p_c = NULL;
+	long l_id = 0;
+	int i_neg = GSI_FS_FALSE;
+	int i_digits = 0;
+
+	while (p_line < p_chunk->p_end)
+	{
+		p_line_end = g_scan_memchr(p_line, '\n', p_chunk->p_end - p_line);
+		if (NULL == p_line_end)
+		{
+			p_line_end = p_chunk->p_end;
+		}
+
+		// Parse the id at the beginning of the line
+		for (p_c = p_line; (p_c < p_line_end) && isspace((unsigned char)*p_c); ++p_c);
+		i_neg = GSI_FS_FALSE;
+		if ((p_c < p_line_end) && (('-' == *p_c) || ('+' == *p_c)))
+		{
+			i_neg = ('-' == *p_c) ? GSI_FS_TRUE : GSI_FS_FALSE;
+			++p_c;
+		}
+		for (l_id = 0, i_digits = 0; (p_c < p_line_end) && isdigit((unsigned char)*p_c) && (18 > i_digits); ++p_c, ++i_digits)
+		{
+			l_id = l_id * 10 + (*p_c - '0');
+		}
+		l_id = (GSI_FS_TRUE == i_neg) ? -l_id : l_id;
+
+		if ((0 < i_digits) && (p_query->l_id_from <= l_id) && (p_query->l_id_to >= l_id))
+		{
+			if (GSI_FS_TRUE != file_scan_add_match(p_chunk, p_line, p_line_end))
+			{
+				return;
+			}
+		}
+
+		p_line = p_line_end + 1;
+	}
+}
+
+/*###########################################################################
+	 * Name:		file_scan_chunk_task
+	 * Description: Scan one chunk (thread pool task - the search waits for its future)
+	 * Parameter:   [in] void* p_args - struct scan_chunk*
+	 * Return:		NULL
+#############################################################################*/
+static void* file_scan_chunk_task(void* p_args)
+{
+	struct scan_chunk* p_chunk = (struct scan_chunk*)p_args;
+
+	if (GSI_FS_QUERY_ID_RANGE == p_chunk->p_query->i_type)
+	{
+		file_scan_chunk_id_range(p_chunk);
+	}
+	else
+	{
+		file_scan_chunk_pattern(p_chunk);
+	}
+
+	return NULL;
+}
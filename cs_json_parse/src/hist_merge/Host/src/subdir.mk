@@ -4,13 +4,13 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
-../src/gsi_parse_json_client_1.c
+../src/gsi_hist_merge.c
 
 C_OBJS += \
-./src/gsi_parse_json_client_1.o
+./src/gsi_hist_merge.o
 
 C_DEPS += \
-./src/gsi_parse_json_client_1.d
+./src/gsi_hist_merge.d
 
 # Each subdirectory must supply rules for building sources it contributes
 src/%.o: ../src/%.c
@@ -0,0 +1,147 @@
+/**************************************************************************
+* Name : gsi_hist_merge.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Offline tool - merge latency histograms of runs (client_latency_file
+* 				of load client, see "gsi_latency_hist.h"). Histograms of the same
+* 				name are summed, the percentiles of each one are printed on screen
+* 				and optionally written as one merged histograms file.
+* 				Usage : ./<a.out> [--out=<merged file>] <histograms file> [...]
+*****************************************************************************/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gsi_latency_hist.h"
+
+/* Defines and Macros */
+#define 	GSI_RC_FAIL				-1
+#define 	GSI_HM_MAX_HISTS		32				/* different names of histograms */
+#define 	GSI_HM_OUT_OPT			"--out="
+
+/*###########################################################################
+ 	 * Name:        main.
+ 	 * Description: Entry point of the program
+ 	 * Parameter:   char** argv - [1] optional --out=<merged file>, then histograms files
+ 	 * Return: 	    Success - 0
+ 	 * 				Failure - GSI_RC_FAIL
+#############################################################################*/
+int main(int argc, char **argv)
+{
+	gsi_lat_hist_t* p_hists = NULL;
+	gsi_lat_hist_t hist;
+	char a_names[GSI_HM_MAX_HISTS][GSI_LH_MAX_NAME];
+	char s_name[GSI_LH_MAX_NAME];
+	const char* s_out = NULL;
+	FILE* f_file = NULL;
+	enum gsi_lat_hist_rc e_rc = GSI_LH_RC_SUCCESS;
+	int i_hists = 0;
+	int i_hist = 0;
+	int i_arg = 1;
+	int i_rc = 0;
+
+	if ((1 < argc) && (0 == strncmp(argv[1], GSI_HM_OUT_OPT, sizeof(GSI_HM_OUT_OPT) - 1)))
+	{
+		s_out = argv[1] + sizeof(GSI_HM_OUT_OPT) - 1;
+		++i_arg;
+	}
+
+	if (i_arg >= argc)
+	{
+		printf("usage error: <a.out> [--out=<merged file>] <histograms file> [...]\n");
+		return GSI_RC_FAIL;
+	}
+
+	p_hists = (gsi_lat_hist_t *)malloc(GSI_HM_MAX_HISTS * sizeof(gsi_lat_hist_t));
+	if (NULL == p_hists)
+	{
+		printf("memory allocation failed\n");
+		return GSI_RC_FAIL;
+	}
+
+	for (; (i_arg < argc) && (0 == i_rc); ++i_arg)
+	{
+		f_file = fopen(argv[i_arg], "r");
+		if (NULL == f_file)
+		{
+			printf("couldn't open %s\n", argv[i_arg]);
+			i_rc = GSI_RC_FAIL;
+			break;
+		}
+
+		// Histograms of file one by one, each into the one of its name
+		while (1)
+		{
+			gsi_lat_hist_init(&hist);
+			e_rc = gsi_lat_hist_import(&hist, s_name, f_file);
+			if (GSI_LH_RC_SUCCESS != e_rc)
+			{
+				break;
+			}
+
+			for (i_hist = 0; (i_hist < i_hists) && (0 != strcmp(a_names[i_hist], s_name)); ++i_hist);
+
+			if (i_hist == i_hists)
+			{
+				if (GSI_HM_MAX_HISTS == i_hists)
+				{
+					printf("more than %d names of histograms\n", GSI_HM_MAX_HISTS);
+					e_rc = GSI_LH_RC_ERROR;
+					break;
+				}
+
+				strcpy(a_names[i_hists], s_name);
+				gsi_lat_hist_init(&p_hists[i_hists++]);
+			}
+
+			gsi_lat_hist_merge(&p_hists[i_hist], &hist);
+		}
+
+		if (GSI_LH_RC_END != e_rc)
+		{
+			printf("bad histograms file %s\n", argv[i_arg]);
+			i_rc = GSI_RC_FAIL;
+		}
+
+		fclose(f_file);
+	}
+
+	if (0 == i_rc)
+	{
+		gsi_lat_hist_print_title(stdout);
+		for (i_hist = 0; i_hist < i_hists; ++i_hist)
+		{
+			gsi_lat_hist_print(&p_hists[i_hist], a_names[i_hist], 0, stdout);
+		}
+	}
+
+	if ((0 == i_rc) && (NULL != s_out))
+	{
+		f_file = fopen(s_out, "w");
+		if (NULL == f_file)
+		{
+			printf("couldn't open %s\n", s_out);
+			i_rc = GSI_RC_FAIL;
+		}
+
+		for (i_hist = 0; (i_hist < i_hists) && (0 == i_rc); ++i_hist)
+		{
+			if (GSI_LH_RC_SUCCESS != gsi_lat_hist_export(&p_hists[i_hist], a_names[i_hist], f_file))
+			{
+				printf("couldn't write %s\n", s_out);
+				i_rc = GSI_RC_FAIL;
+			}
+		}
+
+		if ((NULL != f_file) && (0 != fclose(f_file)))
+		{
+			printf("couldn't close %s\n", s_out);
+			i_rc = GSI_RC_FAIL;
+		}
+	}
+
+	free(p_hists);
+
+	return i_rc;
+}
@@ -0,0 +1,8 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+USER_OBJS :=
+
+LIBS := -lgsi-build-parse -lgsi-json-index -lgsi-network-tcp -ljson-c -lgsi-logger -lgsi-thread-pool -pthread
+
@@ -4,13 +4,13 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
-../src/gsi_parse_json_client_3.c
+../src/gsi_json_bench.c
 
 C_OBJS += \
-./src/gsi_parse_json_client_3.o
+./src/gsi_json_bench.o
 
 C_DEPS += \
-./src/gsi_parse_json_client_3.d
+./src/gsi_json_bench.d
 
 # Each subdirectory must supply rules for building sources it contributes
 src/%.o: ../src/%.c
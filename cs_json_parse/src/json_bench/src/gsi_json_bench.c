@@ -0,0 +1,568 @@
+/**************************************************************************
+* Name : gsi_json_bench.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Benchmark of parsing messages on the server side.
+* 				Each test file is sent as the data of one WRITE_STR message
+* 				(as a client does with a long message) and each line of it as
+* 				a message of its own. The messages are parsed by:
+* 				json-c 		- json_tokener_parse() and get of the fields
+* 				gsi-parse 	- gsi_is_parse_json_msg() (one pass / structural index)
+* 				gsi-index 	- gsi_json_index_build() only (structural index + UTF-8)
+* 				Then the parsed messages are encoded and decoded again in each
+* 				wire encoding (json / binary) - bytes on wire and ns per message.
+* 				Usage : ./<a.out> [file...] (default - test files of the project)
+*****************************************************************************/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <json-c/json.h>
+#include "gsi_is_log_api.h"
+#include "gsi_json_index.h"
+#include "gsi_build_parse_data.h"
+
+/* Defines and Macros */
+#define 	GSI_JB_MIN_TIME_NS		300000000.0		/* run each test at least 0.3 sec */
+#define 	GSI_JB_FAIL				-1
+#define 	GSI_JB_MAX_MSGS			4096			/* max lines of file as messages */
+
+/* Global variables */
+
+// test files of the project (from bin directory)
+static const char* g_s_default_files[] = {
+	"../src/server/test_files/server_data.txt",
+	"../src/load_client/test_files/client1.txt",
+	"../src/load_client/test_files/client2.txt",
+	"../src/load_client/test_files/client3.txt"
+};
+
+/*****************************************************************************
+ * Name : gsi_jb_msgs
+ * Used by: benchmark functions
+ * Members:
+ *		char* a_msgs[] - encoded messages
+ *		size_t a_lens[] - length of each message
+ *		int i_count - number of messages
+ *		size_t ul_bytes - total length of messages
+ *****************************************************************************/
+struct gsi_jb_msgs
+{
+	char* a_msgs[GSI_JB_MAX_MSGS];
+	size_t a_lens[GSI_JB_MAX_MSGS];
+	int i_count;
+	size_t ul_bytes;
+};
+
+/* Typedef */
+typedef int (*gsi_jb_parse_func_t)(const char* s_json, size_t ul_len);
+
+/********************************/
+/* Static functions declaration */
+/********************************/
+static char* gsi_jb_read_file(const char* s_path, size_t* p_len);
+static int gsi_jb_add_msg(struct gsi_jb_msgs* p_msgs, const char* p_data, size_t ul_len, int i_index);
+static void gsi_jb_free_msgs(struct gsi_jb_msgs* p_msgs);
+static double gsi_jb_now_ns();
+static double gsi_jb_run(gsi_jb_parse_func_t f_parse, const struct gsi_jb_msgs* p_msgs);
+static void gsi_jb_report(const char* s_name, const struct gsi_jb_msgs* p_msgs);
+static int gsi_jb_parse_json_c(const char* s_json, size_t ul_len);
+static int gsi_jb_parse_gsi(const char* s_json, size_t ul_len);
+static int gsi_jb_index_only(const char* s_json, size_t ul_len);
+static void gsi_jb_report_encoding(const struct gsi_jb_msgs* p_msgs);
+static double gsi_jb_run_encoding(const struct gsi_json_msg* a_json_msgs, int i_count, unsigned int ui_encoding,
+								  char* p_scratch, char** a_encoded, size_t* a_lens, int i_decode);
+
+/*###########################################################################
+ 	 * Name:        main.
+ 	 * Description: Entry point of the benchmark
+ 	 * Parameter:   char** argv - files to test (optional)
+ 	 * Return: 	    Success - 0
+ 	 * 				Failure - GSI_JB_FAIL
+#############################################################################*/
+int main(int argc, char **argv)
+{
+	struct gsi_jb_msgs* p_whole = NULL;
+	struct gsi_jb_msgs* p_lines = NULL;
+	const char** a_files = g_s_default_files;
+	int i_files = sizeof(g_s_default_files) / sizeof(g_s_default_files[0]);
+	char* p_data = NULL;
+	char* p_line = NULL;
+	char* p_eol = NULL;
+	size_t ul_len = 0;
+	FILE* f_log = NULL;
+	int i = 0;
+
+	if (1 < argc)
+	{
+		a_files = (const char**)(argv + 1);
+		i_files = argc - 1;
+	}
+
+	// Create log file
+	f_log = gsi_is_create_log_file("gsi-log-json-bench", NULL);
+	if (NULL == f_log)
+	{
+		return GSI_JB_FAIL;
+	}
+
+	p_whole = (struct gsi_jb_msgs*)calloc(1, sizeof(struct gsi_jb_msgs));
+	p_lines = (struct gsi_jb_msgs*)calloc(1, sizeof(struct gsi_jb_msgs));
+	if ((NULL == p_whole) || (NULL == p_lines))
+	{
+		printf("memory allocation failed\n");
+		free(p_whole);
+		free(p_lines);
+		return GSI_JB_FAIL;
+	}
+
+	printf("structural index: %s\n\n", gsi_json_index_get_isa());
+	printf("%-44s %-10s %6s %9s %12s %10s\n", "file", "parser", "msgs", "bytes", "ns/msg", "MB/s");
+
+	for (i = 0; i < i_files; ++i)
+	{
+		p_data = gsi_jb_read_file(a_files[i], &ul_len);
+		if (NULL == p_data)
+		{
+			printf("couldn't read %s\n", a_files[i]);
+			continue;
+		}
+
+		// Whole file as one message
+		if (GSI_JSON_SUCCESS == gsi_jb_add_msg(p_whole, p_data, ul_len, 0))
+		{
+			gsi_jb_report(a_files[i], p_whole);
+		}
+
+		// Each line as message
+		for (p_line = p_data; (p_line < p_data + ul_len) && (GSI_JB_MAX_MSGS > p_lines->i_count); p_line = p_eol + 1)
+		{
+			p_eol = (char*)memchr(p_line, '\n', p_data + ul_len - p_line);
+			if (NULL == p_eol)
+			{
+				p_eol = p_data + ul_len;
+			}
+
+			if (GSI_JSON_SUCCESS != gsi_jb_add_msg(p_lines, p_line, p_eol - p_line + 1, p_lines->i_count))
+			{
+				break;
+			}
+		}
+
+		gsi_jb_report("  (each line)", p_lines);
+
+		gsi_jb_free_msgs(p_whole);
+		gsi_jb_free_msgs(p_lines);
+		free(p_data);
+	}
+
+	free(p_whole);
+	free(p_lines);
+
+	// Close log file to free resources
+	if (GSI_LOG_RC_SUCCESS != gsi_is_close_log(f_log))
+	{
+		printf("couldn't close log file");
+	}
+
+	return 0;
+}
+
+/***********************************/
+/* Static functions implementation */
+/***********************************/
+/*###########################################################################
+	 * Name:		gsi_jb_read_file
+	 * Description: Read whole file to new allocated buffer ('\0' terminated)
+	 * Parameter:   [in] const char* s_path - file to read
+	 * Parameter:   [out] size_t* p_len - length of file
+	 * Return:		Success - buffer (MUST be freed)
+	 * 				Failure - NULL
+#############################################################################*/
+static char* gsi_jb_read_file(const char* s_path, size_t* p_len)
+{
+	FILE* f_file = NULL;
+	char* p_data = NULL;
+	long l_size = 0;
+
+	f_file = fopen(s_path, "rb");
+	if (NULL == f_file)
+	{
+		return NULL;
+	}
+
+	if ((0 != fseek(f_file, 0, SEEK_END)) || (0 > (l_size = ftell(f_file))) || (0 != fseek(f_file, 0, SEEK_SET)))
+	{
+		fclose(f_file);
+		return NULL;
+	}
+
+	p_data = (char*)malloc(l_size + 1);
+	if ((NULL == p_data) || ((size_t)l_size != fread(p_data, 1, l_size, f_file)))
+	{
+		free(p_data);
+		fclose(f_file);
+		return NULL;
+	}
+
+	p_data[l_size] = '\0';
+	*p_len = l_size;
+
+	fclose(f_file);
+
+	return p_data;
+}
+
+/*###########################################################################
+	 * Name:		gsi_jb_add_msg
+	 * Description: Encode WRITE_STR message with data (same keys as a client) by json-c
+	 * Parameter:   [in-out] struct gsi_jb_msgs* p_msgs - messages to add to
+	 * Parameter:   [in] const char* p_data - data of message
+	 * Parameter:   [in] size_t ul_len - length of data
+	 * Parameter:   [in] int i_index - index of message
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_jb_add_msg(struct gsi_jb_msgs* p_msgs, const char* p_data, size_t ul_len, int i_index)
+{
+	struct json_object* p_json = NULL;
+	const char* s_json = NULL;
+	char* s_msg = NULL;
+
+	p_json = json_object_new_object();
+	if (NULL == p_json)
+	{
+		return GSI_JSON_ERROR;
+	}
+
+	json_object_object_add(p_json, "Message Type", json_object_new_int(1));
+	json_object_object_add(p_json, "Op-Code", 	   json_object_new_int(GSI_WRITE_STR));
+	json_object_object_add(p_json, "Op-Str", 	   json_object_new_string("WRITE_STR"));
+	json_object_object_add(p_json, "Port", 		   json_object_new_int(65533));
+	json_object_object_add(p_json, "Index", 	   json_object_new_int(i_index));
+	json_object_object_add(p_json, "Data Length",  json_object_new_int(ul_len));
+	json_object_object_add(p_json, "File Length",  json_object_new_int(0));
+	json_object_object_add(p_json, "File Name",    NULL);
+	json_object_object_add(p_json, "Data", 		   json_object_new_string_len(p_data, ul_len));
+
+	s_json = json_object_to_json_string_ext(p_json, JSON_C_TO_STRING_PLAIN);
+	if (NULL != s_json)
+	{
+		s_msg = strdup(s_json);
+	}
+
+	json_object_put(p_json);
+
+	if (NULL == s_msg)
+	{
+		return GSI_JSON_ERROR;
+	}
+
+	p_msgs->a_msgs[p_msgs->i_count] = s_msg;
+	p_msgs->a_lens[p_msgs->i_count] = strlen(s_msg);
+	p_msgs->ul_bytes += p_msgs->a_lens[p_msgs->i_count];
+	++p_msgs->i_count;
+
+	return GSI_JSON_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_jb_free_msgs
+	 * Description: Free all messages
+#############################################################################*/
+static void gsi_jb_free_msgs(struct gsi_jb_msgs* p_msgs)
+{
+	int i = 0;
+
+	for (i = 0; i < p_msgs->i_count; ++i)
+	{
+		free(p_msgs->a_msgs[i]);
+	}
+
+	memset(p_msgs, 0, sizeof(struct gsi_jb_msgs));
+}
+
+/*###########################################################################
+	 * Name:		gsi_jb_now_ns
+	 * Description: Monotonic time in nano seconds
+#############################################################################*/
+static double gsi_jb_now_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+/*###########################################################################
+	 * Name:		gsi_jb_run
+	 * Description: Parse all messages again and again for GSI_JB_MIN_TIME_NS
+	 * Parameter:   [in] gsi_jb_parse_func_t f_parse - parser to test
+	 * Parameter:   [in] const struct gsi_jb_msgs* p_msgs - messages
+	 * Return:		Nano seconds per one pass on all messages, negative on parse error
+#############################################################################*/
+static double gsi_jb_run(gsi_jb_parse_func_t f_parse, const struct gsi_jb_msgs* p_msgs)
+{
+	double d_start = gsi_jb_now_ns();
+	double d_elapsed = 0;
+	long l_rounds = 0;
+	int i = 0;
+
+	do
+	{
+		for (i = 0; i < p_msgs->i_count; ++i)
+		{
+			if (GSI_JSON_SUCCESS != f_parse(p_msgs->a_msgs[i], p_msgs->a_lens[i]))
+			{
+				return -1;
+			}
+		}
+
+		++l_rounds;
+		d_elapsed = gsi_jb_now_ns() - d_start;
+	}
+	while (GSI_JB_MIN_TIME_NS > d_elapsed);
+
+	return d_elapsed / l_rounds;
+}
+
+/*###########################################################################
+	 * Name:		gsi_jb_report
+	 * Description: Run all parsers on messages and print the results
+#############################################################################*/
+static void gsi_jb_report(const char* s_name, const struct gsi_jb_msgs* p_msgs)
+{
+	const char* a_names[] = { "json-c", "gsi-parse", "gsi-index" };
+	gsi_jb_parse_func_t a_funcs[] = { gsi_jb_parse_json_c, gsi_jb_parse_gsi, gsi_jb_index_only };
+	double d_ns = 0;
+	int i = 0;
+
+	if (0 == p_msgs->i_count)
+	{
+		return;
+	}
+
+	for (i = 0; i < sizeof(a_funcs) / sizeof(a_funcs[0]); ++i)
+	{
+		d_ns = gsi_jb_run(a_funcs[i], p_msgs);
+		if (0 > d_ns)
+		{
+			printf("%-44s %-10s parse failed\n", s_name, a_names[i]);
+			continue;
+		}
+
+		printf("%-44s %-10s %6d %9zu %12.0f %10.1f\n", (0 == i) ? s_name : "", a_names[i], p_msgs->i_count,
+			   p_msgs->ul_bytes, d_ns / p_msgs->i_count, (p_msgs->ul_bytes * 1e3) / d_ns);
+	}
+
+	gsi_jb_report_encoding(p_msgs);
+}
+
+/*###########################################################################
+	 * Name:		gsi_jb_report_encoding
+	 * Description: Encode and decode the parsed messages in each wire encoding
+	 * 				and print bytes on wire, encode and decode ns per message
+#############################################################################*/
+static void gsi_jb_report_encoding(const struct gsi_jb_msgs* p_msgs)
+{
+	const char* a_names[] = { "json", "binary" };
+	unsigned int a_encodings[] = { GSI_ENC_JSON, GSI_ENC_BINARY };
+	struct gsi_json_msg* a_json_msgs = NULL;
+	char** a_encoded = NULL;
+	size_t* a_lens = NULL;
+	char* p_scratch = NULL;
+	size_t ul_bytes = 0;
+	size_t ul_max = 0;
+	double d_encode_ns = 0;
+	double d_decode_ns = 0;
+	int i = 0;
+	int j = 0;
+
+	a_json_msgs = (struct gsi_json_msg*)calloc(p_msgs->i_count, sizeof(struct gsi_json_msg));
+	a_encoded = (char**)calloc(p_msgs->i_count, sizeof(char*));
+	a_lens = (size_t*)calloc(p_msgs->i_count, sizeof(size_t));
+	if ((NULL == a_json_msgs) || (NULL == a_encoded) || (NULL == a_lens))
+	{
+		printf("memory allocation failed\n");
+		goto cleanup;
+	}
+
+	// Messages as the server gets them
+	for (i = 0; i < p_msgs->i_count; ++i)
+	{
+		if (GSI_JSON_SUCCESS != gsi_is_parse_json_msg(p_msgs->a_msgs[i], p_msgs->a_lens[i], &a_json_msgs[i]))
+		{
+			printf("parse failed\n");
+			goto cleanup;
+		}
+
+		if (ul_max < gsi_is_encode_bound(&a_json_msgs[i], GSI_ENC_JSON))
+		{
+			ul_max = gsi_is_encode_bound(&a_json_msgs[i], GSI_ENC_JSON);
+		}
+
+		if (ul_max < gsi_is_encode_bound(&a_json_msgs[i], GSI_ENC_BINARY))
+		{
+			ul_max = gsi_is_encode_bound(&a_json_msgs[i], GSI_ENC_BINARY);
+		}
+	}
+
+	p_scratch = (char*)malloc(ul_max);
+	if (NULL == p_scratch)
+	{
+		printf("memory allocation failed\n");
+		goto cleanup;
+	}
+
+	for (j = 0; j < sizeof(a_encodings) / sizeof(a_encodings[0]); ++j)
+	{
+		// Keep encoded messages for the decode run
+		ul_bytes = 0;
+		for (i = 0; i < p_msgs->i_count; ++i)
+		{
+			free(a_encoded[i]);
+			a_encoded[i] = (char*)malloc(gsi_is_encode_bound(&a_json_msgs[i], a_encodings[j]));
+			if (NULL == a_encoded[i])
+			{
+				printf("memory allocation failed\n");
+				goto cleanup;
+			}
+
+			a_lens[i] = gsi_is_encode_msg(a_encoded[i], &a_json_msgs[i], a_encodings[j]);
+			ul_bytes += a_lens[i];
+		}
+
+		d_encode_ns = gsi_jb_run_encoding(a_json_msgs, p_msgs->i_count, a_encodings[j], p_scratch, a_encoded, a_lens, 0);
+		d_decode_ns = gsi_jb_run_encoding(a_json_msgs, p_msgs->i_count, a_encodings[j], p_scratch, a_encoded, a_lens, 1);
+		if (0 > d_decode_ns)
+		{
+			printf("%-44s %-10s decode failed\n", "", a_names[j]);
+			continue;
+		}
+
+		printf("%-44s %-10s %6d %9zu %12.0f %10.1f  (decode, encode %.0f ns/msg)\n", "", a_names[j], p_msgs->i_count,
+			   ul_bytes, d_decode_ns / p_msgs->i_count, (ul_bytes * 1e3) / d_decode_ns, d_encode_ns / p_msgs->i_count);
+	}
+
+cleanup:
+	for (i = 0; (NULL != a_json_msgs) && (i < p_msgs->i_count); ++i)
+	{
+		gsi_build_parse_reset_object(&a_json_msgs[i]);
+
+		if (NULL != a_encoded)
+		{
+			free(a_encoded[i]);
+		}
+	}
+
+	free(a_json_msgs);
+	free(a_encoded);
+	free(a_lens);
+	free(p_scratch);
+}
+
+/*###########################################################################
+	 * Name:		gsi_jb_run_encoding
+	 * Description: Encode messages into scratch *OR* decode them (copy of encoded
+	 * 				message into scratch, as it is read from socket, then decode
+	 * 				in place) again and again for GSI_JB_MIN_TIME_NS
+	 * Return:		Nano seconds per one pass on all messages, negative on decode error
+#############################################################################*/
+static double gsi_jb_run_encoding(const struct gsi_json_msg* a_json_msgs, int i_count, unsigned int ui_encoding,
+								  char* p_scratch, char** a_encoded, size_t* a_lens, int i_decode)
+{
+	struct gsi_json_msg json_msg;
+	double d_start = gsi_jb_now_ns();
+	double d_elapsed = 0;
+	long l_rounds = 0;
+	int i = 0;
+
+	do
+	{
+		for (i = 0; i < i_count; ++i)
+		{
+			if (!i_decode)
+			{
+				gsi_is_encode_msg(p_scratch, &a_json_msgs[i], ui_encoding);
+				continue;
+			}
+
+			memcpy(p_scratch, a_encoded[i], a_lens[i]);
+			memset(&json_msg, 0, sizeof(json_msg));
+
+			// Strings are views into scratch - nothing to free
+			if (GSI_JSON_SUCCESS != gsi_is_decode_msg(p_scratch, a_lens[i], ui_encoding, &json_msg))
+			{
+				return -1;
+			}
+		}
+
+		++l_rounds;
+		d_elapsed = gsi_jb_now_ns() - d_start;
+	}
+	while (GSI_JB_MIN_TIME_NS > d_elapsed);
+
+	return d_elapsed / l_rounds;
+}
+
+/*###########################################################################
+	 * Name:		gsi_jb_parse_json_c
+	 * Description: Parse message by json-c and get the fields of WRITE_STR
+	 * 				(as the server did before the one pass parser)
+#############################################################################*/
+static int gsi_jb_parse_json_c(const char* s_json, size_t ul_len)
+{
+	struct gsi_json_msg json_msg;
+	struct json_object* p_json = NULL;
+
+	memset(&json_msg, 0, sizeof(json_msg));
+
+	p_json = json_tokener_parse(s_json);
+	if (NULL == p_json)
+	{
+		return GSI_JSON_ERROR;
+	}
+
+	json_msg.i_msg_type = json_object_get_int(json_object_object_get(p_json, "Message Type"));
+	json_msg.i_op_code  = json_object_get_int(json_object_object_get(p_json, "Op-Code"));
+	json_msg.ui_port    = json_object_get_int(json_object_object_get(p_json, "Port"));
+	json_msg.i_index    = json_object_get_int(json_object_object_get(p_json, "Index"));
+	json_msg.i_data_len = json_object_get_int(json_object_object_get(p_json, "Data Length"));
+	json_msg.s_data     = strdup(json_object_get_string(json_object_object_get(p_json, "Data")));
+
+	json_object_put(p_json);
+
+	return gsi_build_parse_reset_object(&json_msg);
+}
+
+/*###########################################################################
+	 * Name:		gsi_jb_parse_gsi
+	 * Description: Parse message by gsi_is_parse_json_msg()
+#############################################################################*/
+static int gsi_jb_parse_gsi(const char* s_json, size_t ul_len)
+{
+	struct gsi_json_msg json_msg;
+
+	memset(&json_msg, 0, sizeof(json_msg));
+
+	if (GSI_JSON_SUCCESS != gsi_is_parse_json_msg(s_json, ul_len, &json_msg))
+	{
+		return GSI_JSON_ERROR;
+	}
+
+	return gsi_build_parse_reset_object(&json_msg);
+}
+
+/*###########################################################################
+	 * Name:		gsi_jb_index_only
+	 * Description: Build structural index of message only
+#############################################################################*/
+static int gsi_jb_index_only(const char* s_json, size_t ul_len)
+{
+	static struct gsi_json_index index;
+
+	return (GSI_JI_RC_SUCCESS == gsi_json_index_build(&index, s_json, ul_len)) ? GSI_JSON_SUCCESS : GSI_JSON_ERROR;
+}
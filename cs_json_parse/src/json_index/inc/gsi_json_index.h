@@ -0,0 +1,103 @@
+/**************************************************************************
+* Name : gsi_json_index.h
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Structural index of JSON text (first stage of parsing).
+* 				Finds the quotes, escapes and structural chars ({ } [ ] : ,)
+* 				of the whole text 64 bytes per step and validates UTF-8 in the
+* 				same pass (AVX2 chosen at run time, plain C on other CPUs).
+* 				The index holds the offsets of the structural chars outside
+* 				of strings and of the quotes that open / close strings, so a
+* 				parser can jump over long strings instead of reading them.
+* 				Using: 1. memset() the index to 0 - Must be first!
+* 					   2. gsi_json_index_build() - as much as you want (buffer is reused).
+* 					   3. gsi_json_index_free() - Must be last!
+*****************************************************************************/
+#ifndef GSI_JSON_INDEX_H_
+#define GSI_JSON_INDEX_H_
+
+/* Includes */
+#include <stddef.h>
+
+/* Defines and Macros */
+#define 	GSI_JI_BLOCK_SIZE		64		/* bytes scanned per step */
+
+/* Enums */
+/***************************************************************************
+ * Name:  		gsi_json_index_rc
+ * Description: Return Code values for GSI-JSON-INDEX functions
+ ***************************************************************************/
+enum gsi_json_index_rc {
+	GSI_JI_RC_SUCCESS    = 0,	// Function completed Successfully
+	GSI_JI_RC_ERROR      = 1,	// Function completed with Error
+	GSI_JI_RC_INVALID    = 2,	// Function got invalid arguments
+	GSI_JI_RC_BAD_UTF8   = 3,	// Text is not valid UTF-8
+	GSI_JI_RC_BAD_STRING = 4	// String is not closed or has raw control char
+};
+
+/* Structures */
+/*****************************************************************************
+ * Name : gsi_json_index
+ * Used by: gsi_json_index_build()
+ * Members:
+ *----------------------------------------------------------------------------
+ *		unsigned int* p_positions - Offsets of structural chars and quotes, in order
+ *----------------------------------------------------------------------------
+ *		size_t ul_count - Number of offsets
+ *----------------------------------------------------------------------------
+ *		size_t ul_cap - Allocated number of offsets
+ *****************************************************************************/
+struct gsi_json_index
+{
+	unsigned int* p_positions;
+	size_t ul_count;
+	size_t ul_cap;
+};
+
+/*******************/
+/* API Declaration */
+/*******************/
+/*###########################################################################
+	 * Name:		gsi_json_index_build
+	 * Description: Build structural index of JSON text and validate its UTF-8.
+	 * 				Strings of the text must be closed and without raw control chars.
+	 * Parameter:   [in-out] struct gsi_json_index* p_index - index to fill
+	 * Parameter:   [in] const char* p_buf - JSON text
+	 * Parameter:   [in] size_t ul_len - length of text (at most UINT_MAX)
+	 * Return:		Success - GSI_JI_RC_SUCCESS
+	 * 				Failure - GSI_JI_RC_BAD_UTF8 *OR* GSI_JI_RC_BAD_STRING *OR*
+	 * 						  GSI_JI_RC_ERROR *OR* GSI_JI_RC_INVALID
+#############################################################################*/
+enum gsi_json_index_rc gsi_json_index_build(struct gsi_json_index* p_index, const char* p_buf, size_t ul_len);
+
+
+/*###########################################################################
+	 * Name:		gsi_json_index_validate_utf8
+	 * Description: Check that text is valid UTF-8 (no overlong, surrogate or
+	 * 				too large code points)
+	 * Parameter:   [in] const char* p_buf - text
+	 * Parameter:   [in] size_t ul_len - length of text
+	 * Return:		Success - GSI_JI_RC_SUCCESS
+	 * 				Failure - GSI_JI_RC_BAD_UTF8 *OR* GSI_JI_RC_INVALID
+#############################################################################*/
+enum gsi_json_index_rc gsi_json_index_validate_utf8(const char* p_buf, size_t ul_len);
+
+
+/*###########################################################################
+	 * Name:		gsi_json_index_free
+	 * Description: Free the offsets of index
+	 * Parameter:   [in] struct gsi_json_index* p_index - index to free
+	 * Return:		None
+#############################################################################*/
+void gsi_json_index_free(struct gsi_json_index* p_index);
+
+
+/*###########################################################################
+	 * Name:		gsi_json_index_get_isa
+	 * Description: Name of the instruction set used to build the index
+	 * Return:		"avx2" or "scalar"
+#############################################################################*/
+const char* gsi_json_index_get_isa();
+
+
+#endif /* GSI_JSON_INDEX_H_ */
@@ -0,0 +1,596 @@
+/**************************************************************************
+* Name : gsi_json_index.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Implementation of "gsi_json_index.h"
+* 				Each block of 64 bytes is turned into bit masks (bit i is byte i):
+* 				quotes, backslashes, structural chars and control chars.
+* 				The masks are combined with plain 64 bit math:
+* 				escaped chars  - odd runs of backslashes (carry to next block)
+* 				in string mask - prefix XOR of the unescaped quotes
+* 				and the set bits of the result are written as offsets.
+* 				UTF-8 is checked with the lookup algorithm of Keiser & Lemire
+* 				("Validating UTF-8 In Less Than One Instruction Per Byte").
+*****************************************************************************/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define 	GSI_JI_HAVE_X86		1
+#endif
+#include "gsi_json_index.h"
+#include "gsi_is_log_api.h"
+
+/* Defines and Macros */
+#define 	GSI_JI_INIT_CAP			256
+#define 	GSI_JI_EVEN_BITS		0x5555555555555555ULL
+
+// UTF-8 errors of the lookup tables (bit per error kind)
+#define 	GSI_JI_TOO_SHORT		(1 << 0)	// lead byte followed by lead byte / ASCII
+#define 	GSI_JI_TOO_LONG			(1 << 1)	// ASCII followed by continuation
+#define 	GSI_JI_OVERLONG_3		(1 << 2)
+#define 	GSI_JI_TOO_LARGE		(1 << 3)
+#define 	GSI_JI_SURROGATE		(1 << 4)
+#define 	GSI_JI_OVERLONG_2		(1 << 5)
+#define 	GSI_JI_TOO_LARGE_1000	(1 << 6)
+#define 	GSI_JI_OVERLONG_4		(1 << 6)
+#define 	GSI_JI_TWO_CONTS		(1 << 7)	// two continuations, checked again by 2/3 continuation check
+#define 	GSI_JI_CARRY			(GSI_JI_TOO_SHORT | GSI_JI_TOO_LONG | GSI_JI_TWO_CONTS)
+
+/* Typedef */
+typedef enum gsi_json_index_rc (*json_index_build_func_t)(struct gsi_json_index* p_index, const char* p_buf, size_t ul_len);
+
+/* Structures */
+/*****************************************************************************
+ * Name : json_index_state
+ * Used by: json_index_add_block() to carry state between blocks
+ * Members:
+ *		uint64_t ull_prev_escaped - 1 if first byte of next block is escaped
+ *		uint64_t ull_prev_in_string - all ones if block ended inside string
+ *		uint64_t ull_bad_ctrl - raw control chars found inside strings
+ *****************************************************************************/
+struct json_index_state
+{
+	uint64_t ull_prev_escaped;
+	uint64_t ull_prev_in_string;
+	uint64_t ull_bad_ctrl;
+};
+
+/********************************/
+/* Static functions declaration */
+/********************************/
+static void json_index_init_isa();
+static int json_index_add_block(struct gsi_json_index* p_index, struct json_index_state* p_state,
+								uint64_t ull_quote, uint64_t ull_backslash, uint64_t ull_op,
+								uint64_t ull_ctrl, unsigned int ui_base);
+static enum gsi_json_index_rc json_index_finish(struct gsi_json_index* p_index, const struct json_index_state* p_state);
+static enum gsi_json_index_rc json_index_build_scalar(struct gsi_json_index* p_index, const char* p_buf, size_t ul_len);
+static int json_index_utf8_scalar(const unsigned char* p_buf, size_t ul_len);
+#ifdef GSI_JI_HAVE_X86
+static enum gsi_json_index_rc json_index_build_avx2(struct gsi_json_index* p_index, const char* p_buf, size_t ul_len);
+#endif
+
+/* Global variables */
+static pthread_once_t g_isa_once = PTHREAD_ONCE_INIT;
+static json_index_build_func_t g_index_build = json_index_build_scalar;
+static const char* g_s_isa = "scalar";
+
+/**********************/
+/* API implementation */
+/**********************/
+/*###########################################################################
+	 * Name:		gsi_json_index_build
+	 * Description: Build structural index of JSON text and validate its UTF-8.
+	 * 				Strings of the text must be closed and without raw control chars.
+	 * Parameter:   [in-out] struct gsi_json_index* p_index - index to fill
+	 * Parameter:   [in] const char* p_buf - JSON text
+	 * Parameter:   [in] size_t ul_len - length of text (at most UINT_MAX)
+	 * Return:		Success - GSI_JI_RC_SUCCESS
+	 * 				Failure - GSI_JI_RC_BAD_UTF8 *OR* GSI_JI_RC_BAD_STRING *OR*
+	 * 						  GSI_JI_RC_ERROR *OR* GSI_JI_RC_INVALID
+#############################################################################*/
+enum gsi_json_index_rc gsi_json_index_build(struct gsi_json_index* p_index, const char* p_buf, size_t ul_len)
+{
+	// Check input validation
+	if ((NULL == p_index) || (NULL == p_buf) || (UINT_MAX < ul_len))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_JI_RC_INVALID;
+	}
+
+	// Choose the instruction set
+	pthread_once(&g_isa_once, json_index_init_isa);
+
+	p_index->ul_count = 0;
+
+	return g_index_build(p_index, p_buf, ul_len);
+}
+
+/*###########################################################################
+	 * Name:		gsi_json_index_validate_utf8
+	 * Description: Check that text is valid UTF-8 (no overlong, surrogate or
+	 * 				too large code points)
+	 * Parameter:   [in] const char* p_buf - text
+	 * Parameter:   [in] size_t ul_len - length of text
+	 * Return:		Success - GSI_JI_RC_SUCCESS
+	 * 				Failure - GSI_JI_RC_BAD_UTF8 *OR* GSI_JI_RC_INVALID
+#############################################################################*/
+enum gsi_json_index_rc gsi_json_index_validate_utf8(const char* p_buf, size_t ul_len)
+{
+	// Check input validation
+	if (NULL == p_buf)
+	{
+		return GSI_JI_RC_INVALID;
+	}
+
+	return json_index_utf8_scalar((const unsigned char*)p_buf, ul_len) ? GSI_JI_RC_SUCCESS : GSI_JI_RC_BAD_UTF8;
+}
+
+/*###########################################################################
+	 * Name:		gsi_json_index_free
+	 * Description: Free the offsets of index
+	 * Parameter:   [in] struct gsi_json_index* p_index - index to free
+	 * Return:		None
+#############################################################################*/
+void gsi_json_index_free(struct gsi_json_index* p_index)
+{
+	if (NULL == p_index)
+	{
+		return;
+	}
+
+	free(p_index->p_positions);
+	memset(p_index, 0, sizeof(struct gsi_json_index));
+}
+
+/*###########################################################################
+	 * Name:		gsi_json_index_get_isa
+	 * Description: Name of the instruction set used to build the index
+	 * Return:		"avx2" or "scalar"
+#############################################################################*/
+const char* gsi_json_index_get_isa()
+{
+	pthread_once(&g_isa_once, json_index_init_isa);
+
+	return g_s_isa;
+}
+
+/************************************/
+/* Static functions implementation  */
+/************************************/
+/*###########################################################################
+	 * Name:		json_index_init_isa
+	 * Description: Choose the best implementation for this CPU (called once)
+#############################################################################*/
+static void json_index_init_isa()
+{
+#ifdef GSI_JI_HAVE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		g_index_build = json_index_build_avx2;
+		g_s_isa = "avx2";
+	}
+#endif
+}
+
+/*###########################################################################
+	 * Name:		json_index_add_block
+	 * Description: Find strings of one block by its masks and add the offsets
+	 * 				of its structural chars and quotes to the index
+	 * Parameter:   [in-out] struct gsi_json_index* p_index - index to fill
+	 * Parameter:   [in-out] struct json_index_state* p_state - state from previous block
+	 * Parameter:   [in] uint64_t ull_quote, ull_backslash, ull_op, ull_ctrl - masks of block
+	 * Parameter:   [in] unsigned int ui_base - offset of block in text
+	 * Return:		Success - GSI_JI_RC_SUCCESS
+	 * 				Failure - GSI_JI_RC_ERROR
+#############################################################################*/
+static int json_index_add_block(struct gsi_json_index* p_index, struct json_index_state* p_state,
+								uint64_t ull_quote, uint64_t ull_backslash, uint64_t ull_op,
+								uint64_t ull_ctrl, unsigned int ui_base)
+{
+	uint64_t ull_follows_escape = 0;
+	uint64_t ull_odd_starts = 0;
+	uint64_t ull_even_starts = 0;
+	uint64_t ull_escaped = 0;
+	uint64_t ull_in_string = 0;
+	uint64_t ull_structural = 0;
+	unsigned int* p_new = NULL;
+	size_t ul_new_cap = 0;
+
+	// Escaped chars: a backslash run that starts on odd bit escapes the char after
+	// an odd-length run. Adding the run starts to the backslashes carries past each run.
+	ull_backslash &= ~p_state->ull_prev_escaped;
+	ull_follows_escape = (ull_backslash << 1) | p_state->ull_prev_escaped;
+	ull_odd_starts = ull_backslash & ~GSI_JI_EVEN_BITS & ~ull_follows_escape;
+	ull_even_starts = ull_odd_starts + ull_backslash;
+	p_state->ull_prev_escaped = (ull_even_starts < ull_odd_starts) ? 1 : 0;
+	ull_escaped = (GSI_JI_EVEN_BITS ^ (ull_even_starts << 1)) & ull_follows_escape;
+
+	// In string: between an opening quote (included) and closing quote (excluded)
+	ull_quote &= ~ull_escaped;
+	ull_in_string = ull_quote;
+	ull_in_string ^= ull_in_string << 1;
+	ull_in_string ^= ull_in_string << 2;
+	ull_in_string ^= ull_in_string << 4;
+	ull_in_string ^= ull_in_string << 8;
+	ull_in_string ^= ull_in_string << 16;
+	ull_in_string ^= ull_in_string << 32;
+	ull_in_string ^= p_state->ull_prev_in_string;
+	p_state->ull_prev_in_string = (uint64_t)((int64_t)ull_in_string >> 63);
+
+	p_state->ull_bad_ctrl |= ull_ctrl & ull_in_string;
+
+	ull_structural = (ull_op & ~ull_in_string) | ull_quote;
+
+	// Room for whole block
+	if (p_index->ul_cap < p_index->ul_count + GSI_JI_BLOCK_SIZE)
+	{
+		ul_new_cap = (0 == p_index->ul_cap) ? GSI_JI_INIT_CAP : (p_index->ul_cap * 2);
+		p_new = (unsigned int*)realloc(p_index->p_positions, ul_new_cap * sizeof(unsigned int));
+		if (NULL == p_new)
+		{
+			LOG_ERROR("memory allocation for index failed");
+			return GSI_JI_RC_ERROR;
+		}
+
+		p_index->p_positions = p_new;
+		p_index->ul_cap = ul_new_cap;
+	}
+
+	// Offset of each set bit
+	while (0 != ull_structural)
+	{
+		p_index->p_positions[p_index->ul_count++] = ui_base + __builtin_ctzll(ull_structural);
+		ull_structural &= ull_structural - 1;
+	}
+
+	return GSI_JI_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		json_index_finish
+	 * Description: Check the strings state after the last block
+	 * Return:		Success - GSI_JI_RC_SUCCESS
+	 * 				Failure - GSI_JI_RC_BAD_STRING
+#############################################################################*/
+static enum gsi_json_index_rc json_index_finish(struct gsi_json_index* p_index, const struct json_index_state* p_state)
+{
+	if ((0 != p_state->ull_prev_in_string) || (0 != p_state->ull_bad_ctrl))
+	{
+		return GSI_JI_RC_BAD_STRING;
+	}
+
+	return GSI_JI_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		json_index_build_scalar
+	 * Description: Build the index byte by byte (same masks as the vector code)
+	 * Return:		Same as gsi_json_index_build()
+#############################################################################*/
+static enum gsi_json_index_rc json_index_build_scalar(struct gsi_json_index* p_index, const char* p_buf, size_t ul_len)
+{
+	struct json_index_state state;
+	uint64_t ull_quote = 0;
+	uint64_t ull_backslash = 0;
+	uint64_t ull_op = 0;
+	uint64_t ull_ctrl = 0;
+	uint64_t ull_bit = 0;
+	size_t ul_block = 0;
+	size_t ul = 0;
+	unsigned char c = 0;
+
+	if (!json_index_utf8_scalar((const unsigned char*)p_buf, ul_len))
+	{
+		return GSI_JI_RC_BAD_UTF8;
+	}
+
+	memset(&state, 0, sizeof(state));
+
+	for (ul_block = 0; ul_block < ul_len; ul_block += GSI_JI_BLOCK_SIZE)
+	{
+		ull_quote = ull_backslash = ull_op = ull_ctrl = 0;
+
+		for (ul = 0; (ul < GSI_JI_BLOCK_SIZE) && (ul_block + ul < ul_len); ++ul)
+		{
+			c = (unsigned char)p_buf[ul_block + ul];
+			ull_bit = 1ULL << ul;
+
+			switch (c)
+			{
+				case '"':
+					ull_quote |= ull_bit;
+					break;
+
+				case '\\':
+					ull_backslash |= ull_bit;
+					break;
+
+				case '{':
+				case '}':
+				case '[':
+				case ']':
+				case ':':
+				case ',':
+					ull_op |= ull_bit;
+					break;
+
+				default:
+					if (0x20 > c)
+					{
+						ull_ctrl |= ull_bit;
+					}
+					break;
+			}
+		}
+
+		if (GSI_JI_RC_SUCCESS != json_index_add_block(p_index, &state, ull_quote, ull_backslash,
+													  ull_op, ull_ctrl, (unsigned int)ul_block))
+		{
+			return GSI_JI_RC_ERROR;
+		}
+	}
+
+	return json_index_finish(p_index, &state);
+}
+
+/*###########################################################################
+	 * Name:		json_index_utf8_scalar
+	 * Description: Validate UTF-8 byte by byte
+	 * Return:		1 if valid, 0 if not
+#############################################################################*/
+static int json_index_utf8_scalar(const unsigned char* p_buf, size_t ul_len)
+{
+	size_t ul = 0;
+	size_t ul_need = 0;
+	unsigned int ui_code = 0;
+	unsigned char c = 0;
+
+	while (ul < ul_len)
+	{
+		c = p_buf[ul];
+
+		// ASCII
+		if (0x80 > c)
+		{
+			++ul;
+			continue;
+		}
+
+		// Lead byte - number of continuation bytes and first bits of code point
+		if (0xC2 > c)
+		{
+			return 0;
+		}
+		else if (0xE0 > c)
+		{
+			ul_need = 1;
+			ui_code = c & 0x1F;
+		}
+		else if (0xF0 > c)
+		{
+			ul_need = 2;
+			ui_code = c & 0x0F;
+		}
+		else if (0xF5 > c)
+		{
+			ul_need = 3;
+			ui_code = c & 0x07;
+		}
+		else
+		{
+			return 0;
+		}
+
+		if (ul_len - ul <= ul_need)
+		{
+			return 0;
+		}
+
+		for (++ul; 0 < ul_need; --ul_need, ++ul)
+		{
+			if (0x80 != (p_buf[ul] & 0xC0))
+			{
+				return 0;
+			}
+
+			ui_code = (ui_code << 6) | (p_buf[ul] & 0x3F);
+		}
+
+		// Overlong 3 / 4 bytes, surrogates and above U+10FFFF
+		if (((0xE0 == c) && (0x800 > ui_code)) ||
+			((0xF0 == c) && (0x10000 > ui_code)) ||
+			((0xD800 <= ui_code) && (0xDFFF >= ui_code)) ||
+			(0x10FFFF < ui_code))
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+#ifdef GSI_JI_HAVE_X86
+/*###########################################################################
+	 * Name:		json_index_utf8_check_avx2
+	 * Description: UTF-8 errors of 32 bytes given the 32 bytes before them.
+	 * 				Looks at every pair of bytes (3 lookup tables on the nibbles)
+	 * 				and checks that 3rd / 4th bytes of sequences are continuations.
+	 * Return:		Non zero bytes on error
+#############################################################################*/
+__attribute__((target("avx2")))
+static __m256i json_index_utf8_check_avx2(__m256i input, __m256i prev_input)
+{
+	const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+	const __m256i byte_1_high_table = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+		// 0_______ ________ <ASCII in byte 1>
+		GSI_JI_TOO_LONG, GSI_JI_TOO_LONG, GSI_JI_TOO_LONG, GSI_JI_TOO_LONG,
+		GSI_JI_TOO_LONG, GSI_JI_TOO_LONG, GSI_JI_TOO_LONG, GSI_JI_TOO_LONG,
+		// 10______ ________ <continuation in byte 1>
+		GSI_JI_TWO_CONTS, GSI_JI_TWO_CONTS, GSI_JI_TWO_CONTS, GSI_JI_TWO_CONTS,
+		// 1100____ ________ <two byte lead in byte 1>
+		GSI_JI_TOO_SHORT | GSI_JI_OVERLONG_2,
+		// 1101____ ________ <two byte lead in byte 1>
+		GSI_JI_TOO_SHORT,
+		// 1110____ ________ <three byte lead in byte 1>
+		GSI_JI_TOO_SHORT | GSI_JI_OVERLONG_3 | GSI_JI_SURROGATE,
+		// 1111____ ________ <four+ byte lead in byte 1>
+		GSI_JI_TOO_SHORT | GSI_JI_TOO_LARGE | GSI_JI_TOO_LARGE_1000 | GSI_JI_OVERLONG_4));
+	const __m256i byte_1_low_table = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+		// ____0000 ________
+		GSI_JI_CARRY | GSI_JI_OVERLONG_3 | GSI_JI_OVERLONG_2 | GSI_JI_OVERLONG_4,
+		// ____0001 ________
+		GSI_JI_CARRY | GSI_JI_OVERLONG_2,
+		// ____001_ ________
+		GSI_JI_CARRY,
+		GSI_JI_CARRY,
+		// ____0100 ________
+		GSI_JI_CARRY | GSI_JI_TOO_LARGE,
+		// ____0101 ________ and above
+		GSI_JI_CARRY | GSI_JI_TOO_LARGE | GSI_JI_TOO_LARGE_1000,
+		GSI_JI_CARRY | GSI_JI_TOO_LARGE | GSI_JI_TOO_LARGE_1000,
+		GSI_JI_CARRY | GSI_JI_TOO_LARGE | GSI_JI_TOO_LARGE_1000,
+		GSI_JI_CARRY | GSI_JI_TOO_LARGE | GSI_JI_TOO_LARGE_1000,
+		GSI_JI_CARRY | GSI_JI_TOO_LARGE | GSI_JI_TOO_LARGE_1000,
+		GSI_JI_CARRY | GSI_JI_TOO_LARGE | GSI_JI_TOO_LARGE_1000,
+		GSI_JI_CARRY | GSI_JI_TOO_LARGE | GSI_JI_TOO_LARGE_1000,
+		GSI_JI_CARRY | GSI_JI_TOO_LARGE | GSI_JI_TOO_LARGE_1000,
+		// ____1101 ________
+		GSI_JI_CARRY | GSI_JI_TOO_LARGE | GSI_JI_TOO_LARGE_1000 | GSI_JI_SURROGATE,
+		GSI_JI_CARRY | GSI_JI_TOO_LARGE | GSI_JI_TOO_LARGE_1000,
+		GSI_JI_CARRY | GSI_JI_TOO_LARGE | GSI_JI_TOO_LARGE_1000));
+	const __m256i byte_2_high_table = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+		// ________ 0_______ <ASCII in byte 2>
+		GSI_JI_TOO_SHORT, GSI_JI_TOO_SHORT, GSI_JI_TOO_SHORT, GSI_JI_TOO_SHORT,
+		GSI_JI_TOO_SHORT, GSI_JI_TOO_SHORT, GSI_JI_TOO_SHORT, GSI_JI_TOO_SHORT,
+		// ________ 1000____
+		GSI_JI_TOO_LONG | GSI_JI_OVERLONG_2 | GSI_JI_TWO_CONTS | GSI_JI_OVERLONG_3 | GSI_JI_TOO_LARGE_1000 | GSI_JI_OVERLONG_4,
+		// ________ 1001____
+		GSI_JI_TOO_LONG | GSI_JI_OVERLONG_2 | GSI_JI_TWO_CONTS | GSI_JI_OVERLONG_3 | GSI_JI_TOO_LARGE,
+		// ________ 101_____
+		GSI_JI_TOO_LONG | GSI_JI_OVERLONG_2 | GSI_JI_TWO_CONTS | GSI_JI_SURROGATE | GSI_JI_TOO_LARGE,
+		GSI_JI_TOO_LONG | GSI_JI_OVERLONG_2 | GSI_JI_TWO_CONTS | GSI_JI_SURROGATE | GSI_JI_TOO_LARGE,
+		// ________ 11______
+		GSI_JI_TOO_SHORT, GSI_JI_TOO_SHORT, GSI_JI_TOO_SHORT, GSI_JI_TOO_SHORT));
+	__m256i prev_shift = _mm256_permute2x128_si256(prev_input, input, 0x21);
+	__m256i prev1 = _mm256_alignr_epi8(input, prev_shift, 15);
+	__m256i prev2 = _mm256_alignr_epi8(input, prev_shift, 14);
+	__m256i prev3 = _mm256_alignr_epi8(input, prev_shift, 13);
+	__m256i special = _mm256_setzero_si256();
+	__m256i must23 = _mm256_setzero_si256();
+
+	// Errors seen in 2 bytes
+	special = _mm256_and_si256(
+				_mm256_and_si256(
+					_mm256_shuffle_epi8(byte_1_high_table, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble)),
+					_mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, low_nibble))),
+				_mm256_shuffle_epi8(byte_2_high_table, _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble)));
+
+	// 3rd byte of 3/4 byte sequence and 4th byte of 4 byte sequence must be continuation
+	must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80)),
+							 _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80))));
+
+	return _mm256_xor_si256(_mm256_and_si256(must23, _mm256_set1_epi8((char)0x80)), special);
+}
+
+/*###########################################################################
+	 * Name:		json_index_build_avx2
+	 * Description: Build the index 64 bytes per step and validate UTF-8
+	 * 				in the same loop (ASCII blocks skip the UTF-8 check)
+	 * Return:		Same as gsi_json_index_build()
+#############################################################################*/
+__attribute__((target("avx2")))
+static enum gsi_json_index_rc json_index_build_avx2(struct gsi_json_index* p_index, const char* p_buf, size_t ul_len)
+{
+	struct json_index_state state;
+	unsigned char a_tail[GSI_JI_BLOCK_SIZE];
+	const unsigned char* p_block = NULL;
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i ctrl_max = _mm256_set1_epi8(0x1F);
+	const __m256i incomplete_max = _mm256_setr_epi8(
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		(char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+	__m256i utf8_error = _mm256_setzero_si256();
+	__m256i prev_input = _mm256_setzero_si256();
+	__m256i prev_incomplete = _mm256_setzero_si256();
+	__m256i lo, hi, op_lo, op_hi;
+	uint64_t ull_quote = 0;
+	uint64_t ull_backslash = 0;
+	uint64_t ull_op = 0;
+	uint64_t ull_ctrl = 0;
+	size_t ul_block = 0;
+
+	memset(&state, 0, sizeof(state));
+
+	for (ul_block = 0; ul_block < ul_len; ul_block += GSI_JI_BLOCK_SIZE)
+	{
+		// Last partial block - pad with spaces (not structural, valid UTF-8)
+		p_block = (const unsigned char*)p_buf + ul_block;
+		if (GSI_JI_BLOCK_SIZE > ul_len - ul_block)
+		{
+			memset(a_tail, ' ', sizeof(a_tail));
+			memcpy(a_tail, p_block, ul_len - ul_block);
+			p_block = a_tail;
+		}
+
+		lo = _mm256_loadu_si256((const __m256i*)p_block);
+		hi = _mm256_loadu_si256((const __m256i*)(p_block + 32));
+
+		// UTF-8 - only blocks with non ASCII bytes
+		if (0 == _mm256_movemask_epi8(_mm256_or_si256(lo, hi)))
+		{
+			utf8_error = _mm256_or_si256(utf8_error, prev_incomplete);
+		}
+		else
+		{
+			utf8_error = _mm256_or_si256(utf8_error, json_index_utf8_check_avx2(lo, prev_input));
+			utf8_error = _mm256_or_si256(utf8_error, json_index_utf8_check_avx2(hi, lo));
+			prev_incomplete = _mm256_subs_epu8(hi, incomplete_max);
+			prev_input = hi;
+		}
+
+		// Masks of block
+		ull_quote = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, quote)) |
+					((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, quote)) << 32);
+		ull_backslash = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, backslash)) |
+						((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, backslash)) << 32);
+		ull_ctrl = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(lo, ctrl_max), lo)) |
+				   ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(hi, ctrl_max), hi)) << 32);
+
+		op_lo = _mm256_or_si256(
+					_mm256_or_si256(_mm256_cmpeq_epi8(lo, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(lo, _mm256_set1_epi8('}'))),
+					_mm256_or_si256(
+						_mm256_or_si256(_mm256_cmpeq_epi8(lo, _mm256_set1_epi8('[')), _mm256_cmpeq_epi8(lo, _mm256_set1_epi8(']'))),
+						_mm256_or_si256(_mm256_cmpeq_epi8(lo, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(lo, _mm256_set1_epi8(',')))));
+		op_hi = _mm256_or_si256(
+					_mm256_or_si256(_mm256_cmpeq_epi8(hi, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(hi, _mm256_set1_epi8('}'))),
+					_mm256_or_si256(
+						_mm256_or_si256(_mm256_cmpeq_epi8(hi, _mm256_set1_epi8('[')), _mm256_cmpeq_epi8(hi, _mm256_set1_epi8(']'))),
+						_mm256_or_si256(_mm256_cmpeq_epi8(hi, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(hi, _mm256_set1_epi8(',')))));
+		ull_op = (uint32_t)_mm256_movemask_epi8(op_lo) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(op_hi) << 32);
+
+		if (GSI_JI_RC_SUCCESS != json_index_add_block(p_index, &state, ull_quote, ull_backslash,
+													  ull_op, ull_ctrl, (unsigned int)ul_block))
+		{
+			return GSI_JI_RC_ERROR;
+		}
+	}
+
+	// Text can't end in the middle of sequence
+	utf8_error = _mm256_or_si256(utf8_error, prev_incomplete);
+	if (!_mm256_testz_si256(utf8_error, utf8_error))
+	{
+		return GSI_JI_RC_BAD_UTF8;
+	}
+
+	return json_index_finish(p_index, &state);
+}
+#endif
@@ -0,0 +1,167 @@
+/**************************************************************************
+* Name : gsi_latency_hist.h
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Log-bucketed histogram of latencies (HDR style).
+* 				Values are counted in buckets of powers of 2, each bucket is split
+* 				into GSI_LH_SUB_BUCKETS / 2 linear sub buckets - so a value is kept
+* 				with relative error of 1 / (GSI_LH_SUB_BUCKETS / 2) at most, from
+* 				1 up to GSI_LH_MAX_VALUE, in a fixed array (no allocation on record).
+* 				Histograms of threads (or of runs) are summed by gsi_lat_hist_merge().
+* 				Using: 1. gsi_lat_hist_init() - before the first record
+* 					   2. gsi_lat_hist_record() - per value
+* 					   3. gsi_lat_hist_percentile() / gsi_lat_hist_print() / gsi_lat_hist_export()
+* 				Export is text, one histogram after the other - a run can be merged
+* 				with other runs by gsi_lat_hist_import() (see gsi_hist_merge tool).
+*****************************************************************************/
+#ifndef GSI_LATENCY_HIST_H_
+#define GSI_LATENCY_HIST_H_
+
+/* Includes */
+#include <stdio.h>
+
+/* Defines and Macros */
+#define 	GSI_LH_SUB_BITS			8						/* sub buckets of bucket - 2 digits precision */
+#define 	GSI_LH_SUB_BUCKETS		(1 << GSI_LH_SUB_BITS)
+#define 	GSI_LH_MAX_BITS			40						/* values up to 2^40 (ns - about 18 minutes) */
+#define 	GSI_LH_MAX_VALUE		((1UL << GSI_LH_MAX_BITS) - 1)
+#define 	GSI_LH_COUNTS			((GSI_LH_MAX_BITS - GSI_LH_SUB_BITS + 2) << (GSI_LH_SUB_BITS - 1))
+#define 	GSI_LH_MAX_NAME			64						/* name of histogram in export */
+
+/* Typedef */
+typedef struct gsi_lat_hist gsi_lat_hist_t;
+
+/* Enums */
+/***************************************************************************
+ * Name:  		gsi_lat_hist_rc
+ * Description: Return Code values for GSI-LATENCY-HIST functions
+ ***************************************************************************/
+enum gsi_lat_hist_rc {
+	GSI_LH_RC_SUCCESS   = 0,	// Function completed Successfully
+	GSI_LH_RC_ERROR     = 1,	// Function completed with Error
+	GSI_LH_RC_INVALID   = 2,	// Function got invalid arguments
+	GSI_LH_RC_END       = 3		// No more histograms to import
+};
+
+/* Structures */
+/*****************************************************************************
+ * Name : gsi_lat_hist
+ * Used by: GSI-LATENCY-HIST API functions (embedded by its user - no allocation)
+ * Members:
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_count - values recorded
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_min, ul_max - exact smallest and largest value
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_sum - sum of values (for mean)
+ *----------------------------------------------------------------------------
+ *		unsigned long a_counts[] - count of each sub bucket
+ *****************************************************************************/
+struct gsi_lat_hist
+{
+	unsigned long ul_count;
+	unsigned long ul_min;
+	unsigned long ul_max;
+	unsigned long ul_sum;
+	unsigned long a_counts[GSI_LH_COUNTS];
+};
+
+/*******************/
+/* API Declaration */
+/*******************/
+/*###########################################################################
+	 * Name:		gsi_lat_hist_init
+	 * Description: Reset histogram to no values
+	 * Parameter:   [in] gsi_lat_hist_t* p_hist - histogram to reset
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_init(gsi_lat_hist_t* p_hist);
+
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_record
+	 * Description: Count one value (values above GSI_LH_MAX_VALUE are counted in
+	 * 				the last bucket, the max keeps the exact value)
+	 * Parameter:   [in] gsi_lat_hist_t* p_hist - histogram
+	 * Parameter:   [in] unsigned long ul_value - value to count (e.g. nanoseconds)
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_record(gsi_lat_hist_t* p_hist, unsigned long ul_value);
+
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_merge
+	 * Description: Add all values of one histogram into another
+	 * Parameter:   [in] gsi_lat_hist_t* p_dst - histogram to add into
+	 * Parameter:   [in] const gsi_lat_hist_t* p_src - histogram to add
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_merge(gsi_lat_hist_t* p_dst, const gsi_lat_hist_t* p_src);
+
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_percentile
+	 * Description: Value that d_percentile percents of the values are at or below
+	 * 				(highest value of its sub bucket, the max at most)
+	 * Parameter:   [in] const gsi_lat_hist_t* p_hist - histogram
+	 * Parameter:   [in] double d_percentile - 0 to 100 (e.g. 99.9)
+	 * Return:		The value, 0 if histogram has no values
+#############################################################################*/
+unsigned long gsi_lat_hist_percentile(const gsi_lat_hist_t* p_hist, double d_percentile);
+
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_export
+	 * Description: Write histogram as text: "hist <name> <count> <min> <max> <sum>",
+	 * 				then "<value> <count>" of each sub bucket with values, then "end"
+	 * Parameter:   [in] const gsi_lat_hist_t* p_hist - histogram
+	 * Parameter:   [in] const char* s_name - name of histogram (no white spaces)
+	 * Parameter:   [in] FILE* f_out - opened file to write into
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_ERROR *OR* GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_export(const gsi_lat_hist_t* p_hist, const char* s_name, FILE* f_out);
+
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_import
+	 * Description: Read the next histogram written by gsi_lat_hist_export() and
+	 * 				add its values into histogram (lines of '#' are skipped)
+	 * Parameter:   [in] gsi_lat_hist_t* p_hist - histogram to add into
+	 * Parameter:   [out] char* s_name - name of histogram (GSI_LH_MAX_NAME bytes)
+	 * Parameter:   [in] FILE* f_in - opened file to read from
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_END (no more histograms) *OR* GSI_LH_RC_ERROR
+	 * 						  *OR* GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_import(gsi_lat_hist_t* p_hist, char* s_name, FILE* f_in);
+
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_print_title
+	 * Description: Write the title of the rows of gsi_lat_hist_print()
+	 * Parameter:   [in] FILE* f_out - opened file to write into (e.g. stdout)
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_print_title(FILE* f_out);
+
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_print
+	 * Description: Write one row of histogram of nanoseconds: count, mean, p50, p90,
+	 * 				p99, p99.9 and max in microseconds, and values per second
+	 * Parameter:   [in] const gsi_lat_hist_t* p_hist - histogram
+	 * Parameter:   [in] const char* s_name - name of row
+	 * Parameter:   [in] double d_secs - seconds the values were recorded in (0 - unknown)
+	 * Parameter:   [in] FILE* f_out - opened file to write into (e.g. stdout)
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_print(const gsi_lat_hist_t* p_hist, const char* s_name, double d_secs, FILE* f_out);
+
+
+#endif /* GSI_LATENCY_HIST_H_ */
@@ -0,0 +1,428 @@
+/**************************************************************************
+* Name : gsi_latency_hist.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Log-bucketed histogram of latencies (see "gsi_latency_hist.h")
+*****************************************************************************/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "gsi_latency_hist.h"
+
+/* Defines and Macros */
+#define 	GSI_LH_HALF_BITS		(GSI_LH_SUB_BITS - 1)
+#define 	GSI_LH_HALF				(1UL << GSI_LH_HALF_BITS)
+#define 	GSI_LH_SUB_MASK			((unsigned long)GSI_LH_SUB_BUCKETS - 1)
+#define 	GSI_LH_MAX_LINE			256
+
+/********************************/
+/* Static functions declaration */
+/********************************/
+static unsigned int gsi_lat_hist_index(unsigned long ul_value);
+static unsigned long gsi_lat_hist_lowest(unsigned int ui_index);
+static unsigned long gsi_lat_hist_highest(unsigned int ui_index);
+static int gsi_lat_hist_read_line(FILE* f_in, char* s_line);
+
+/**********************/
+/* API implementation */
+/**********************/
+/*###########################################################################
+	 * Name:		gsi_lat_hist_init
+	 * Description: Reset histogram to no values
+	 * Parameter:   [in] gsi_lat_hist_t* p_hist - histogram to reset
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_init(gsi_lat_hist_t* p_hist)
+{
+	// Check input validation
+	if (NULL == p_hist)
+	{
+		return GSI_LH_RC_INVALID;
+	}
+
+	memset(p_hist, 0, sizeof(gsi_lat_hist_t));
+	p_hist->ul_min = ULONG_MAX;
+
+	return GSI_LH_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_record
+	 * Description: Count one value (values above GSI_LH_MAX_VALUE are counted in
+	 * 				the last bucket, the max keeps the exact value)
+	 * Parameter:   [in] gsi_lat_hist_t* p_hist - histogram
+	 * Parameter:   [in] unsigned long ul_value - value to count (e.g. nanoseconds)
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_record(gsi_lat_hist_t* p_hist, unsigned long ul_value)
+{
+	// Check input validation
+	if (NULL == p_hist)
+	{
+		return GSI_LH_RC_INVALID;
+	}
+
+	p_hist->a_counts[gsi_lat_hist_index((GSI_LH_MAX_VALUE < ul_value) ? GSI_LH_MAX_VALUE : ul_value)]++;
+	p_hist->ul_count++;
+	p_hist->ul_sum += ul_value;
+
+	if (ul_value < p_hist->ul_min)
+	{
+		p_hist->ul_min = ul_value;
+	}
+
+	if (ul_value > p_hist->ul_max)
+	{
+		p_hist->ul_max = ul_value;
+	}
+
+	return GSI_LH_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_merge
+	 * Description: Add all values of one histogram into another
+	 * Parameter:   [in] gsi_lat_hist_t* p_dst - histogram to add into
+	 * Parameter:   [in] const gsi_lat_hist_t* p_src - histogram to add
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_merge(gsi_lat_hist_t* p_dst, const gsi_lat_hist_t* p_src)
+{
+	unsigned int ui_index = 0;
+
+	// Check input validation
+	if ((NULL == p_dst) || (NULL == p_src))
+	{
+		return GSI_LH_RC_INVALID;
+	}
+
+	if (0 == p_src->ul_count)
+	{
+		return GSI_LH_RC_SUCCESS;
+	}
+
+	for (ui_index = 0; ui_index < GSI_LH_COUNTS; ++ui_index)
+	{
+		p_dst->a_counts[ui_index] += p_src->a_counts[ui_index];
+	}
+
+	p_dst->ul_count += p_src->ul_count;
+	p_dst->ul_sum += p_src->ul_sum;
+
+	if (p_src->ul_min < p_dst->ul_min)
+	{
+		p_dst->ul_min = p_src->ul_min;
+	}
+
+	if (p_src->ul_max > p_dst->ul_max)
+	{
+		p_dst->ul_max = p_src->ul_max;
+	}
+
+	return GSI_LH_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_percentile
+	 * Description: Value that d_percentile percents of the values are at or below
+	 * 				(highest value of its sub bucket, the max at most)
+	 * Parameter:   [in] const gsi_lat_hist_t* p_hist - histogram
+	 * Parameter:   [in] double d_percentile - 0 to 100 (e.g. 99.9)
+	 * Return:		The value, 0 if histogram has no values
+#############################################################################*/
+unsigned long gsi_lat_hist_percentile(const gsi_lat_hist_t* p_hist, double d_percentile)
+{
+	unsigned long ul_rank = 0;
+	unsigned long ul_seen = 0;
+	unsigned long ul_value = 0;
+	unsigned int ui_index = 0;
+
+	if ((NULL == p_hist) || (0 == p_hist->ul_count))
+	{
+		return 0;
+	}
+
+	if (100.0 <= d_percentile)
+	{
+		return p_hist->ul_max;
+	}
+
+	// Rank of the value in sorted values (1 is the smallest)
+	ul_rank = (unsigned long)(d_percentile / 100.0 * p_hist->ul_count + 0.5);
+	if (1 > ul_rank)
+	{
+		ul_rank = 1;
+	}
+
+	for (ui_index = 0; ui_index < GSI_LH_COUNTS; ++ui_index)
+	{
+		ul_seen += p_hist->a_counts[ui_index];
+		if (ul_seen >= ul_rank)
+		{
+			break;
+		}
+	}
+
+	ul_value = gsi_lat_hist_highest(ui_index);
+
+	return (ul_value > p_hist->ul_max) ? p_hist->ul_max : ul_value;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_export
+	 * Description: Write histogram as text: "hist <name> <count> <min> <max> <sum>",
+	 * 				then "<value> <count>" of each sub bucket with values, then "end"
+	 * Parameter:   [in] const gsi_lat_hist_t* p_hist - histogram
+	 * Parameter:   [in] const char* s_name - name of histogram (no white spaces)
+	 * Parameter:   [in] FILE* f_out - opened file to write into
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_ERROR *OR* GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_export(const gsi_lat_hist_t* p_hist, const char* s_name, FILE* f_out)
+{
+	unsigned int ui_index = 0;
+
+	// Check input validation
+	if ((NULL == p_hist) || (NULL == s_name) || (NULL == f_out) ||
+		('\0' == s_name[0]) || (GSI_LH_MAX_NAME <= strlen(s_name)))
+	{
+		return GSI_LH_RC_INVALID;
+	}
+
+	fprintf(f_out, "hist %s %lu %lu %lu %lu\n", s_name, p_hist->ul_count,
+			(0 == p_hist->ul_count) ? 0 : p_hist->ul_min, p_hist->ul_max, p_hist->ul_sum);
+
+	// Lowest value of sub bucket - its index again on import
+	for (ui_index = 0; ui_index < GSI_LH_COUNTS; ++ui_index)
+	{
+		if (0 != p_hist->a_counts[ui_index])
+		{
+			fprintf(f_out, "%lu %lu\n", gsi_lat_hist_lowest(ui_index), p_hist->a_counts[ui_index]);
+		}
+	}
+
+	fprintf(f_out, "end\n");
+
+	return (0 == ferror(f_out)) ? GSI_LH_RC_SUCCESS : GSI_LH_RC_ERROR;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_import
+	 * Description: Read the next histogram written by gsi_lat_hist_export() and
+	 * 				add its values into histogram (lines of '#' are skipped)
+	 * Parameter:   [in] gsi_lat_hist_t* p_hist - histogram to add into
+	 * Parameter:   [out] char* s_name - name of histogram (GSI_LH_MAX_NAME bytes)
+	 * Parameter:   [in] FILE* f_in - opened file to read from
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_END (no more histograms) *OR* GSI_LH_RC_ERROR
+	 * 						  *OR* GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_import(gsi_lat_hist_t* p_hist, char* s_name, FILE* f_in)
+{
+	gsi_lat_hist_t* p_read = NULL;
+	char s_line[GSI_LH_MAX_LINE];
+	char s_format[32];
+	unsigned long ul_value = 0;
+	unsigned long ul_count = 0;
+	unsigned long ul_counted = 0;
+	enum gsi_lat_hist_rc e_rc = GSI_LH_RC_ERROR;
+
+	// Check input validation
+	if ((NULL == p_hist) || (NULL == s_name) || (NULL == f_in))
+	{
+		return GSI_LH_RC_INVALID;
+	}
+
+	if (0 != gsi_lat_hist_read_line(f_in, s_line))
+	{
+		return GSI_LH_RC_END;
+	}
+
+	// Values are read into a histogram of their own - nothing is added on error
+	p_read = (gsi_lat_hist_t *)malloc(sizeof(gsi_lat_hist_t));
+	if (NULL == p_read)
+	{
+		return GSI_LH_RC_ERROR;
+	}
+
+	gsi_lat_hist_init(p_read);
+
+	snprintf(s_format, sizeof(s_format), "hist %%%ds %%lu %%lu %%lu %%lu", GSI_LH_MAX_NAME - 1);
+	if (5 != sscanf(s_line, s_format, s_name, &p_read->ul_count, &p_read->ul_min, &p_read->ul_max, &p_read->ul_sum))
+	{
+		free(p_read);
+		return GSI_LH_RC_ERROR;
+	}
+
+	while (0 == gsi_lat_hist_read_line(f_in, s_line))
+	{
+		if (0 == strncmp(s_line, "end", sizeof("end") - 1))
+		{
+			e_rc = GSI_LH_RC_SUCCESS;
+			break;
+		}
+
+		if ((2 != sscanf(s_line, "%lu %lu", &ul_value, &ul_count)) || (GSI_LH_MAX_VALUE < ul_value))
+		{
+			break;
+		}
+
+		p_read->a_counts[gsi_lat_hist_index(ul_value)] += ul_count;
+		ul_counted += ul_count;
+	}
+
+	// Buckets must hold all the values of header
+	if ((GSI_LH_RC_SUCCESS == e_rc) && (ul_counted == p_read->ul_count))
+	{
+		if (0 == p_read->ul_count)
+		{
+			p_read->ul_min = ULONG_MAX;
+		}
+
+		gsi_lat_hist_merge(p_hist, p_read);
+	}
+	else
+	{
+		e_rc = GSI_LH_RC_ERROR;
+	}
+
+	free(p_read);
+
+	return e_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_print_title
+	 * Description: Write the title of the rows of gsi_lat_hist_print()
+	 * Parameter:   [in] FILE* f_out - opened file to write into (e.g. stdout)
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_print_title(FILE* f_out)
+{
+	// Check input validation
+	if (NULL == f_out)
+	{
+		return GSI_LH_RC_INVALID;
+	}
+
+	fprintf(f_out, "%-16s %10s %10s %10s %10s %10s %10s %10s %10s\n", "latency (us)",
+			"count", "mean", "p50", "p90", "p99", "p99.9", "max", "per sec");
+
+	return GSI_LH_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_print
+	 * Description: Write one row of histogram of nanoseconds: count, mean, p50, p90,
+	 * 				p99, p99.9 and max in microseconds, and values per second
+	 * Parameter:   [in] const gsi_lat_hist_t* p_hist - histogram
+	 * Parameter:   [in] const char* s_name - name of row
+	 * Parameter:   [in] double d_secs - seconds the values were recorded in (0 - unknown)
+	 * Parameter:   [in] FILE* f_out - opened file to write into (e.g. stdout)
+	 * Return:		Success - GSI_LH_RC_SUCCESS
+	 * 				Failure - GSI_LH_RC_INVALID
+#############################################################################*/
+enum gsi_lat_hist_rc gsi_lat_hist_print(const gsi_lat_hist_t* p_hist, const char* s_name, double d_secs, FILE* f_out)
+{
+	// Check input validation
+	if ((NULL == p_hist) || (NULL == s_name) || (NULL == f_out))
+	{
+		return GSI_LH_RC_INVALID;
+	}
+
+	fprintf(f_out, "%-16s %10lu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f ", s_name, p_hist->ul_count,
+			(0 == p_hist->ul_count) ? 0.0 : (double)p_hist->ul_sum / p_hist->ul_count / 1000,
+			gsi_lat_hist_percentile(p_hist, 50) / 1000.0, gsi_lat_hist_percentile(p_hist, 90) / 1000.0,
+			gsi_lat_hist_percentile(p_hist, 99) / 1000.0, gsi_lat_hist_percentile(p_hist, 99.9) / 1000.0,
+			p_hist->ul_max / 1000.0);
+
+	if (0 < d_secs)
+	{
+		fprintf(f_out, "%10.0f\n", p_hist->ul_count / d_secs);
+	}
+	else
+	{
+		fprintf(f_out, "%10s\n", "-");
+	}
+
+	return GSI_LH_RC_SUCCESS;
+}
+
+/***********************************/
+/* Static functions implementation */
+/***********************************/
+/*###########################################################################
+	 * Name:		gsi_lat_hist_index
+	 * Description: Sub bucket of value: bucket is the power of 2 above the first
+	 * 				GSI_LH_SUB_BUCKETS values, sub bucket is the top bits of value
+	 * Parameter:   [in] unsigned long ul_value - value (GSI_LH_MAX_VALUE at most)
+	 * Return:		Index in a_counts
+#############################################################################*/
+static unsigned int gsi_lat_hist_index(unsigned long ul_value)
+{
+	unsigned int ui_bucket = (63 - __builtin_clzl(ul_value | GSI_LH_SUB_MASK)) - GSI_LH_HALF_BITS;
+	unsigned long ul_sub = ul_value >> ui_bucket;
+
+	return ((ui_bucket + 1) << GSI_LH_HALF_BITS) + (unsigned int)(ul_sub - GSI_LH_HALF);
+}
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_lowest
+	 * Description: Lowest value counted in sub bucket
+	 * Parameter:   [in] unsigned int ui_index - index in a_counts
+	 * Return:		The value
+#############################################################################*/
+static unsigned long gsi_lat_hist_lowest(unsigned int ui_index)
+{
+	int i_bucket = (int)(ui_index >> GSI_LH_HALF_BITS) - 1;
+	unsigned long ul_sub = (ui_index & (GSI_LH_HALF - 1)) + GSI_LH_HALF;
+
+	// First bucket holds all the values below GSI_LH_SUB_BUCKETS
+	if (0 > i_bucket)
+	{
+		ul_sub -= GSI_LH_HALF;
+		i_bucket = 0;
+	}
+
+	return ul_sub << i_bucket;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_highest
+	 * Description: Highest value counted in sub bucket
+	 * Parameter:   [in] unsigned int ui_index - index in a_counts
+	 * Return:		The value
+#############################################################################*/
+static unsigned long gsi_lat_hist_highest(unsigned int ui_index)
+{
+	int i_bucket = (int)(ui_index >> GSI_LH_HALF_BITS) - 1;
+
+	return gsi_lat_hist_lowest(ui_index) + ((0 < i_bucket) ? (1UL << i_bucket) : 1) - 1;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lat_hist_read_line
+	 * Description: Read the next line that is not empty or comment ('#')
+	 * Parameter:   [in] FILE* f_in - opened file
+	 * Parameter:   [out] char* s_line - the line (GSI_LH_MAX_LINE bytes)
+	 * Return:		Success - 0
+	 * 				Failure - -1 (end of file)
+#############################################################################*/
+static int gsi_lat_hist_read_line(FILE* f_in, char* s_line)
+{
+	while (NULL != fgets(s_line, GSI_LH_MAX_LINE, f_in))
+	{
+		if (('#' != s_line[0]) && ('\n' != s_line[0]))
+		{
+			return 0;
+		}
+	}
+
+	return -1;
+}
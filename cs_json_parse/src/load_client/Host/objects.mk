@@ -0,0 +1,8 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+USER_OBJS :=
+
+LIBS := -lgsi-replay -lgsi-latency-hist -lgsi-build-parse -lgsi-json-index -lgsi-network-tcp -ljson-c -lgsi-logger -lgsi-parse-json-config -lgsi-thread-pool -lm -pthread
+
@@ -4,13 +4,13 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
-../src/gsi_parse_json_client_2.c
+../src/gsi_load_client.c
 
 C_OBJS += \
-./src/gsi_parse_json_client_2.o
+./src/gsi_load_client.o
 
 C_DEPS += \
-./src/gsi_parse_json_client_2.d
+./src/gsi_load_client.d
 
 # Each subdirectory must supply rules for building sources it contributes
 src/%.o: ../src/%.c
@@ -0,0 +1,1973 @@
+/**************************************************************************
+* Name : gsi_load_client.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Load generator client using Networking.
+* 				Read configuration from file supplied on command line
+* 				Usage : ./<a.out> --cfg=<config_file>
+* 				Opens client_connections connections to the server, split on
+* 				client_threads threads - each thread is one epoll event loop of
+* 				non-blocking connections, so thousands of connections are driven
+* 				from one process.
+* 				The messages file (or replay file) is read and encoded once into
+* 				ready frames (see gsi_is_encode_frame()), the connections only write them:
+* 				- client_mix - weight per op code tag ("RS=50,WS=30"), the messages of each
+* 							   op code are picked by weight (empty - order of the file)
+* 				- client_rate - messages per second of all connections (0 - no limit)
+* 				- client_duration - seconds to send (0 - each connection sends the messages once)
+* 				- client_arrival - closed loop (default): a connection sends its next frame
+* 								   after the results of the one before, as fast as client_rate lets.
+* 								   fixed / poisson - open loop: frames are due at client_rate
+* 								   (fixed or exponential gaps) whether the server answers or not,
+* 								   a free connection sends the oldest due frame, and its latency
+* 								   is from the time it was due - a stall of server is in the
+* 								   latency of every frame that waited for it.
+* 				A connection that waits in ready queue (rate limit or open loop) for
+* 				GSI_IS_HEARTBEAT_MSECS sends a heart beat, otherwise the server closes it
+* 				after GSI_IS_LIVENESS_MSECS - the frames are liveness too.
+* 				Each connection has one deadline in the timer wheel of its thread (see
+* 				"gsi_is_timer_wheel.h"): its heart beat while it is ready, else its
+* 				connect / hello / reply - GSI_IS_BATCH_REPLY_MSECS without it is broken.
+* 				The event loop waits until the next deadline (or frame), no polling.
+* 				Every frame is a batch frame (of client_batch_size messages, one message too) and
+* 				waits for its results before the next frame of the connection - the time from
+* 				its send to its results is the latency of each of its messages, kept in
+* 				histogram per op code (see "gsi_latency_hist.h").
+* 				At the end the load and its latency percentiles are reported on screen and in
+* 				log file, the histograms are exported into client_latency_file (if set).
+*****************************************************************************/
+
+/* Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include "gsi_parse_json_config.h"
+#include "gsi_is_log_api.h"
+#include "gsi_is_network_tcp.h"
+#include "gsi_build_parse_data.h"
+#include "gsi_replay.h"
+#include "gsi_latency_hist.h"
+
+/* Defines and Macros */
+#define 	GSI_IS_FAIL				-1
+#define 	GSI_LC_NSECS			1000000000LL	/* nanoseconds in second */
+#define 	GSI_LC_TICK_MSECS		10				/* precision of deadlines of connections */
+#define 	GSI_LC_MAX_EVENTS		256				/* events of one epoll_wait() */
+#define 	GSI_LC_MAX_REPLY		(4 * GSI_IS_MAX_BATCH)	/* max content of answer (hello / batch reply) */
+#define 	GSI_LC_BURST_MSECS		10				/* rate limit lets send messages of up to 10 ms at once */
+#define 	GSI_LC_EXTRA_FDS		64				/* fds other than connections (log, files, epoll) */
+#define 	GSI_LC_DEFAULT_IP		"127.0.0.1"
+
+// Packed tag of each op code, by op code (see GSI_IS_OP_CODES)
+#define 	GSI_LC_OP_TAG(op, c0, c1, c2, c3, s_op, ui_fields) GSI_IS_TAG(c0, c1, c2, c3),
+
+// Op string of each op code - name of its latency histogram
+#define 	GSI_LC_OP_NAME(op, c0, c1, c2, c3, s_op, ui_fields) s_op,
+
+// Number of op codes - max lanes of mix
+#define 	GSI_LC_OP_ONE(op, c0, c1, c2, c3, s_op, ui_fields) + 1
+#define 	GSI_LC_MAX_LANES		(0 GSI_IS_OP_CODES(GSI_LC_OP_ONE))
+
+// Latency histograms - one per op code and one of all messages after them
+#define 	GSI_LC_HIST_ALL			GSI_LC_MAX_LANES
+#define 	GSI_LC_HISTS			(GSI_LC_MAX_LANES + 1)
+
+/* Enums */
+/***************************************************************************
+ * Name:  		gsi_lc_arrival
+ * Description: When frames are sent (client_arrival)
+ ***************************************************************************/
+enum gsi_lc_arrival
+{
+	GSI_LC_ARRIVAL_CLOSED = 0,	// After the results of the frame before (rate is a limit)
+	GSI_LC_ARRIVAL_FIXED,		// Open loop - due every i_msgs / rate seconds
+	GSI_LC_ARRIVAL_POISSON		// Open loop - exponential gaps of mean i_msgs / rate seconds
+};
+
+/***************************************************************************
+ * Name:  		gsi_lc_conn_state
+ * Description: States of connection in event loop
+ ***************************************************************************/
+enum gsi_lc_conn_state
+{
+	GSI_LC_CONNECTING = 0,	// Non-blocking connect in progress
+	GSI_LC_HELLO,			// Hello sent, waits for the chosen encoding
+	GSI_LC_READY,			// Waits in ready queue for its next frame (heart beat may be written)
+	GSI_LC_SENDING,			// Frame is written
+	GSI_LC_WAIT_REPLY,		// Batch was sent, waits for its results
+	GSI_LC_DONE				// Closed
+};
+
+/* Structures */
+/*****************************************************************************
+ * Name : gsi_lc_unit
+ * Used by: lanes of messages - one ready to send frame
+ * Members:
+ *----------------------------------------------------------------------------
+ *		const char* p_frame - header and content of frame
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_len - length of frame
+ *----------------------------------------------------------------------------
+ *		int i_type - GSI_REGULAR_MSG *OR* GSI_BATCH_MSG (waits for reply)
+ *----------------------------------------------------------------------------
+ *		int i_msgs - messages in frame
+ *----------------------------------------------------------------------------
+ *		const unsigned char* p_ops - op code of each message (NULL for replay)
+ *****************************************************************************/
+struct gsi_lc_unit
+{
+	const char* p_frame;
+	unsigned int ui_len;
+	int i_type;
+	int i_msgs;
+	const unsigned char* p_ops;
+};
+
+/*****************************************************************************
+ * Name : gsi_lc_lane
+ * Used by: pool of messages - frames of one op code (or of all the file, without mix)
+ * Members:
+ *----------------------------------------------------------------------------
+ *		struct gsi_lc_unit* p_units - frames of lane
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_units - number of frames
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_weight - weight of lane in mix
+ *----------------------------------------------------------------------------
+ *		char* p_buf - encoded frames the units point into (NULL for replay)
+ *----------------------------------------------------------------------------
+ *		unsigned char* p_ops - op codes of messages the units point into (NULL for replay)
+ *****************************************************************************/
+struct gsi_lc_lane
+{
+	struct gsi_lc_unit* p_units;
+	unsigned int ui_units;
+	unsigned int ui_weight;
+	char* p_buf;
+	unsigned char* p_ops;
+};
+
+/*****************************************************************************
+ * Name : gsi_lc_pool
+ * Used by: main and threads of load - read only after it is built
+ * Members:
+ *----------------------------------------------------------------------------
+ *		struct gsi_json_msg* p_msgs - messages of file (owned by pool)
+ *----------------------------------------------------------------------------
+ *		int i_msgs, i_msgs_cap - number of messages / size of p_msgs
+ *----------------------------------------------------------------------------
+ *		struct gsi_lc_lane a_lanes[] - lanes, one per op code at most
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_lanes - number of lanes
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_weights - sum of weights of lanes
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_units - frames of all lanes (sent once by connection without duration)
+ *----------------------------------------------------------------------------
+ *		gsi_replay_t* p_replay - replay file the units point into (or NULL)
+ *****************************************************************************/
+struct gsi_lc_pool
+{
+	struct gsi_json_msg* p_msgs;
+	int i_msgs;
+	int i_msgs_cap;
+	struct gsi_lc_lane a_lanes[GSI_LC_MAX_LANES];
+	unsigned int ui_lanes;
+	unsigned int ui_weights;
+	unsigned long ul_units;
+	gsi_replay_t* p_replay;
+};
+
+/*****************************************************************************
+ * Name : gsi_lc_conn
+ * Used by: event loop of thread
+ * Members:
+ *----------------------------------------------------------------------------
+ *		int i_fd - socket of connection
+ *----------------------------------------------------------------------------
+ *		enum gsi_lc_conn_state e_state - state in event loop
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_events - events registered in epoll
+ *----------------------------------------------------------------------------
+ *		int i_connected - connect completed (failure is broken, not connect failure)
+ *----------------------------------------------------------------------------
+ *		const struct gsi_lc_unit* p_unit - frame that is sent / waits for reply
+ *----------------------------------------------------------------------------
+ *		const char* p_out - write in progress (hello, heart beat or frame)
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_out_len, ui_out_off - length of write / bytes written
+ *----------------------------------------------------------------------------
+ *		int i_heartbeat - the write is heart beat (connection stays ready in its place)
+ *----------------------------------------------------------------------------
+ *		long long ll_written_ns - time a write to server (hello, frame, heart beat) ended last
+ *----------------------------------------------------------------------------
+ *		struct gsi_tw_timer timer - deadline of connection (heart beat, or connect / reply)
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_units - frames sent
+ *----------------------------------------------------------------------------
+ *		long long ll_sent_ns - time the send of frame started (latency of its results)
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_rx_len - bytes of answer in a_rx
+ *----------------------------------------------------------------------------
+ *		char a_rx[] - answer of server (header and content, '\0' after it)
+ *****************************************************************************/
+struct gsi_lc_conn
+{
+	int i_fd;
+	enum gsi_lc_conn_state e_state;
+	unsigned int ui_events;
+	int i_connected;
+	const struct gsi_lc_unit* p_unit;
+	const char* p_out;
+	unsigned int ui_out_len;
+	unsigned int ui_out_off;
+	int i_heartbeat;
+	long long ll_written_ns;
+	struct gsi_tw_timer timer;
+	unsigned long ul_units;
+	long long ll_sent_ns;
+	unsigned int ui_rx_len;
+	char a_rx[GSI_IS_FRAME_HEADER_LEN + GSI_LC_MAX_REPLY + 1];
+};
+
+/*****************************************************************************
+ * Name : gsi_lc_stats
+ * Used by: threads of load - summed by main for the report
+ * Members:
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_connected - connections that were opened
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_conn_failed - connections that failed to open
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_broken - connections that failed after open (closed, bad reply, no reply)
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_msgs, ul_frames, ul_batches - sent
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_failed - messages that failed on server (results of batches)
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_bytes - bytes written (heart beats included)
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_max_lag_ns - open loop: most a frame was sent after it was due
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_behind_ns - open loop: due time of frames not sent at end of duration
+ *****************************************************************************/
+struct gsi_lc_stats
+{
+	unsigned long ul_connected;
+	unsigned long ul_conn_failed;
+	unsigned long ul_broken;
+	unsigned long ul_msgs;
+	unsigned long ul_frames;
+	unsigned long ul_batches;
+	unsigned long ul_failed;
+	unsigned long ul_bytes;
+	unsigned long ul_max_lag_ns;
+	unsigned long ul_behind_ns;
+};
+
+/*****************************************************************************
+ * Name : gsi_lc_thread
+ * Used by: event loop of thread
+ * Members:
+ *----------------------------------------------------------------------------
+ *		pthread_t thread - the thread
+ *----------------------------------------------------------------------------
+ *		int i_epoll_fd - epoll of its connections
+ *----------------------------------------------------------------------------
+ *		struct gsi_lc_conn* p_conns - its connections
+ *----------------------------------------------------------------------------
+ *		int i_conns, i_open - number of connections / not closed yet
+ *----------------------------------------------------------------------------
+ *		int* p_ready - ready queue (ring of connection index)
+ *----------------------------------------------------------------------------
+ *		int i_ready_head, i_ready_count - first in ready queue / length
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_seed - seed of rand_r() for the mix
+ *----------------------------------------------------------------------------
+ *		double d_rate, d_tokens, d_burst - rate limit: messages per second of thread,
+ *										   messages that may be sent, max of tokens
+ *----------------------------------------------------------------------------
+ *		long long ll_tokens_ns - time tokens were added last
+ *----------------------------------------------------------------------------
+ *		long long ll_next_ns - open loop: time the next frame is due
+ *----------------------------------------------------------------------------
+ *		struct gsi_timer_wheel wheel - deadlines of its connections
+ *----------------------------------------------------------------------------
+ *		int i_stopping - duration ended, frames are not sent anymore
+ *----------------------------------------------------------------------------
+ *		struct gsi_lc_stats stats - counters of thread
+ *----------------------------------------------------------------------------
+ *		gsi_lat_hist_t a_hists[] - latency of messages by op code, of all at GSI_LC_HIST_ALL
+ *****************************************************************************/
+struct gsi_lc_thread
+{
+	pthread_t thread;
+	int i_epoll_fd;
+	struct gsi_lc_conn* p_conns;
+	int i_conns;
+	int i_open;
+	int* p_ready;
+	int i_ready_head;
+	int i_ready_count;
+	unsigned int ui_seed;
+	double d_rate;
+	double d_tokens;
+	double d_burst;
+	long long ll_tokens_ns;
+	long long ll_next_ns;
+	struct gsi_timer_wheel wheel;
+	int i_stopping;
+	struct gsi_lc_stats stats;
+	gsi_lat_hist_t a_hists[GSI_LC_HISTS];
+};
+
+/* Global variables */
+
+// instance of client structure contains all its config parameters
+extern struct gsi_prase_json_config_client_params g_config_client_params;
+
+// Packed tag of each op code, by op code
+static const unsigned int g_a_op_tags[GSI_LC_MAX_LANES] = { GSI_IS_OP_CODES(GSI_LC_OP_TAG) };
+
+// Name of each latency histogram, by op code
+static const char* g_a_hist_names[GSI_LC_HISTS] = { GSI_IS_OP_CODES(GSI_LC_OP_NAME) "ALL" };
+
+// Messages to send, read only after main built it
+static struct gsi_lc_pool g_pool;
+
+// Address of server
+static struct sockaddr_in g_server_addr;
+
+// Encoding asked from server (frames of pool are in it)
+static unsigned int g_ui_encoding = GSI_ENC_JSON;
+
+// Ready to send heart beat and hello frames
+static char g_a_heartbeat[GSI_IS_FRAME_HEADER_LEN];
+static char g_a_hello[GSI_IS_FRAME_HEADER_LEN + sizeof(unsigned int)];
+
+// End of load (0 - no duration)
+static long long g_ll_end_ns = 0;
+
+// When frames are sent
+static enum gsi_lc_arrival g_e_arrival = GSI_LC_ARRIVAL_CLOSED;
+
+/********************************/
+/* Static functions declaration */
+/********************************/
+static long long gsi_lc_now_ns();
+static void gsi_lc_raise_fd_limit(int i_connections);
+static int gsi_lc_pool_load_messages(const char* s_file, const char* s_mix, int i_batch_size);
+static int gsi_lc_pool_take_msg(struct gsi_json_msg* p_json_msgs, int i_count, void* p_arg);
+static int gsi_lc_pool_parse_mix(const char* s_mix, unsigned int* p_weights);
+static int gsi_lc_pool_encode_lane(struct gsi_lc_lane* p_lane, int i_op_code, int i_batch_size);
+static int gsi_lc_pool_load_replay(const char* s_file);
+static void gsi_lc_pool_free();
+static void gsi_lc_report_latency(const gsi_lat_hist_t* p_hists, double d_secs);
+static int gsi_lc_export_latency(const gsi_lat_hist_t* p_hists, const char* s_file);
+static void* gsi_lc_thread_run(void* p_args);
+static void gsi_lc_thread_tokens(struct gsi_lc_thread* p_thread, long long ll_now_ns);
+static long long gsi_lc_thread_serve_ready(struct gsi_lc_thread* p_thread, long long ll_now_ns);
+static long long gsi_lc_thread_gap(struct gsi_lc_thread* p_thread, int i_msgs);
+static void gsi_lc_thread_stop(struct gsi_lc_thread* p_thread);
+static const struct gsi_lc_unit* gsi_lc_next_unit(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn);
+static void gsi_lc_conn_open(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn);
+static void gsi_lc_conn_expire(struct gsi_tw_timer* p_timer, void* p_arg);
+static void gsi_lc_conn_event(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn, unsigned int ui_events);
+static void gsi_lc_conn_connected(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn);
+static void gsi_lc_conn_send(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn);
+static void gsi_lc_conn_write(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn);
+static int gsi_lc_conn_read(struct gsi_lc_conn* p_conn);
+static void gsi_lc_conn_answer(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn);
+static void gsi_lc_conn_idle(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn);
+static void gsi_lc_conn_arm(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn, unsigned int ui_events);
+static void gsi_lc_conn_close(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn, int i_failed);
+
+/*###########################################################################
+ 	 * Name:        main.
+ 	 * Description: Entry point of the program, this is load generator client
+	 * 				messages file must contain messages in the form of:
+ 	 * 				M: <message> - Regular message (Note for the white space after ':')
+ 	 * 				H:			 - Heart Beat message (ignored - heart beats are sent by the load)
+ 	 * 				# <comment>  - Ignore this line
+ 	 * 				for more details see "gsi_build_parse_data.h" file
+ 	 * Parameter:   char** argv - [1] config file name
+ 	 * Return: 	    Success - 0
+ 	 * 				Failure - GSI_IS_FAIL
+#############################################################################*/
+int main(int argc, char **argv)
+{
+	struct gsi_lc_thread* p_threads = NULL;
+	struct gsi_lc_stats total;
+	gsi_lat_hist_t* p_hists = NULL;
+	struct gsi_json_msg heartbeat;
+	struct gsi_cs_tcp_message hello;
+	unsigned int ui_offer = GSI_ENC_JSON | GSI_ENC_BINARY;
+	FILE* f_log = NULL;
+	long long ll_start_ns = 0;
+	double d_secs = 0;
+	int i_connections = 0;
+	int i_threads = 0;
+	int i_index = 0;
+	int i_hist = 0;
+	int i_rc = 0;
+
+	if (2 != argc)
+	{
+		printf("usage error: <a.out> --config=<config_file>\n");
+		return GSI_IS_FAIL;
+	}
+
+	// Create log file
+	f_log = gsi_is_create_log_file("gsi-log-load-client", NULL);
+	if (NULL == f_log)
+	{
+		return GSI_IS_FAIL;
+	}
+
+	// Set configuration parameters for client program read it from config file given by argv
+	if (GSI_PARSE_JSON_CONFIG_SUCCESS != gsi_parse_json_config_get_config(argc, argv))
+	{
+		printf("cannot load configuration parameters\n");
+		gsi_is_close_log(f_log);
+		return GSI_IS_FAIL;
+	}
+
+	// Connections and threads - at least one, no thread without connection
+	i_connections = (0 < g_config_client_params.i_connections) ? g_config_client_params.i_connections : 1;
+	i_threads = (0 < g_config_client_params.i_threads) ? g_config_client_params.i_threads : 1;
+	if (i_threads > i_connections)
+	{
+		i_threads = i_connections;
+	}
+
+	if (0 == strcmp(g_config_client_params.s_encoding, "binary"))
+	{
+		g_ui_encoding = GSI_ENC_BINARY;
+	}
+
+	if (0 == strcmp(g_config_client_params.s_arrival, "fixed"))
+	{
+		g_e_arrival = GSI_LC_ARRIVAL_FIXED;
+	}
+	else if (0 == strcmp(g_config_client_params.s_arrival, "poisson"))
+	{
+		g_e_arrival = GSI_LC_ARRIVAL_POISSON;
+	}
+
+	// Open loop is a schedule of the rate
+	if ((GSI_LC_ARRIVAL_CLOSED != g_e_arrival) && (0 == g_config_client_params.ul_rate))
+	{
+		printf("client_arrival %s needs client_rate\n", g_config_client_params.s_arrival);
+		gsi_is_close_log(f_log);
+		return GSI_IS_FAIL;
+	}
+
+	gsi_lc_raise_fd_limit(i_connections);
+
+	// Read and encode messages once - connections only write ready frames
+	memset(&g_pool, 0, sizeof(g_pool));
+	if ('\0' != g_config_client_params.s_replay_file[0])
+	{
+		i_rc = gsi_lc_pool_load_replay(g_config_client_params.s_replay_file);
+	}
+	else
+	{
+		i_rc = gsi_lc_pool_load_messages(g_config_client_params.s_messages_file, g_config_client_params.s_mix,
+										 g_config_client_params.i_batch_size);
+	}
+
+	if (0 != i_rc)
+	{
+		printf("cannot load messages (see log)\n");
+		gsi_lc_pool_free();
+		gsi_is_close_log(f_log);
+		return GSI_IS_FAIL;
+	}
+
+	memset(&g_server_addr, 0, sizeof(g_server_addr));
+	if (GSI_NET_RC_SUCCESS != gsi_is_network_tcp_set_sockaddr(&g_server_addr,
+			('\0' != g_config_client_params.s_ip[0]) ? g_config_client_params.s_ip : GSI_LC_DEFAULT_IP,
+			g_config_client_params.ui_port))
+	{
+		printf("bad address of server\n");
+		gsi_lc_pool_free();
+		gsi_is_close_log(f_log);
+		return GSI_IS_FAIL;
+	}
+
+	// Heart beat is header only, hello is header and the offered encodings
+	memset(&heartbeat, 0, sizeof(heartbeat));
+	heartbeat.i_msg_type = GSI_HEARTBEAT_MSG;
+	gsi_is_encode_frame(g_a_heartbeat, &heartbeat, 1, g_config_client_params.ui_port, g_ui_encoding);
+
+	memset(&hello, 0, sizeof(hello));
+	hello.ui_port = g_config_client_params.ui_port;
+	hello.e_type_msg = GSI_HELLO_MSG;
+	hello.ui_len = sizeof(ui_offer);
+	memcpy(g_a_hello, &hello, GSI_IS_FRAME_HEADER_LEN);
+	memcpy(g_a_hello + GSI_IS_FRAME_HEADER_LEN, &ui_offer, sizeof(ui_offer));
+
+	p_threads = (struct gsi_lc_thread *)calloc(i_threads, sizeof(struct gsi_lc_thread));
+	p_hists = (gsi_lat_hist_t *)malloc(GSI_LC_HISTS * sizeof(gsi_lat_hist_t));
+	if ((NULL == p_threads) || (NULL == p_hists))
+	{
+		LOG_ERROR("memory allocation for threads failed");
+		free(p_threads);
+		free(p_hists);
+		gsi_lc_pool_free();
+		gsi_is_close_log(f_log);
+		return GSI_IS_FAIL;
+	}
+
+	LOG_INFO("load of %d connections on %d threads to port %u (%lu frames in pool)",
+			 i_connections, i_threads, g_config_client_params.ui_port, g_pool.ul_units);
+
+	ll_start_ns = gsi_lc_now_ns();
+	if (0 < g_config_client_params.i_duration)
+	{
+		g_ll_end_ns = ll_start_ns + g_config_client_params.i_duration * GSI_LC_NSECS;
+	}
+
+	// Connection i is of thread i % threads
+	for (i_index = 0; i_index < i_threads; ++i_index)
+	{
+		p_threads[i_index].i_conns = i_connections / i_threads + ((i_index < i_connections % i_threads) ? 1 : 0);
+		p_threads[i_index].ui_seed = (unsigned int)(ll_start_ns + i_index);
+		p_threads[i_index].d_rate = (double)g_config_client_params.ul_rate / i_threads;
+
+		// Schedules of threads are shifted - fixed arrivals of all threads are evenly spread
+		p_threads[i_index].ll_next_ns = ll_start_ns +
+			((0 < g_config_client_params.ul_rate) ? i_index * GSI_LC_NSECS / (long long)g_config_client_params.ul_rate : 0);
+
+		if (0 != pthread_create(&p_threads[i_index].thread, NULL, gsi_lc_thread_run, &p_threads[i_index]))
+		{
+			LOG_ERROR("create thread %d failed", i_index);
+			p_threads[i_index].stats.ul_conn_failed = p_threads[i_index].i_conns;
+			p_threads[i_index].i_conns = 0;
+		}
+	}
+
+	// Sum the counters and latency of threads
+	memset(&total, 0, sizeof(total));
+	for (i_hist = 0; i_hist < GSI_LC_HISTS; ++i_hist)
+	{
+		gsi_lat_hist_init(&p_hists[i_hist]);
+	}
+
+	for (i_index = 0; i_index < i_threads; ++i_index)
+	{
+		if (0 < p_threads[i_index].i_conns)
+		{
+			pthread_join(p_threads[i_index].thread, NULL);
+		}
+
+		total.ul_connected += p_threads[i_index].stats.ul_connected;
+		total.ul_conn_failed += p_threads[i_index].stats.ul_conn_failed;
+		total.ul_broken += p_threads[i_index].stats.ul_broken;
+		total.ul_msgs += p_threads[i_index].stats.ul_msgs;
+		total.ul_frames += p_threads[i_index].stats.ul_frames;
+		total.ul_batches += p_threads[i_index].stats.ul_batches;
+		total.ul_failed += p_threads[i_index].stats.ul_failed;
+		total.ul_bytes += p_threads[i_index].stats.ul_bytes;
+
+		if (p_threads[i_index].stats.ul_max_lag_ns > total.ul_max_lag_ns)
+		{
+			total.ul_max_lag_ns = p_threads[i_index].stats.ul_max_lag_ns;
+		}
+
+		if (p_threads[i_index].stats.ul_behind_ns > total.ul_behind_ns)
+		{
+			total.ul_behind_ns = p_threads[i_index].stats.ul_behind_ns;
+		}
+
+		for (i_hist = 0; i_hist < GSI_LC_HISTS; ++i_hist)
+		{
+			gsi_lat_hist_merge(&p_hists[i_hist], &p_threads[i_index].a_hists[i_hist]);
+		}
+	}
+
+	d_secs = (double)(gsi_lc_now_ns() - ll_start_ns) / GSI_LC_NSECS;
+
+	// Report of load
+	printf("connections: %lu opened, %lu failed, %lu broken\n",
+		   total.ul_connected, total.ul_conn_failed, total.ul_broken);
+	printf("messages:    %lu in %lu frames (%lu batches, %lu messages failed on server)\n",
+		   total.ul_msgs, total.ul_frames, total.ul_batches, total.ul_failed);
+	printf("load:        %.3f sec, %.0f msgs/s, %.2f MB/s\n",
+		   d_secs, total.ul_msgs / d_secs, total.ul_bytes / d_secs / (1024 * 1024));
+
+	LOG_INFO("connections: %lu opened, %lu failed, %lu broken",
+			 total.ul_connected, total.ul_conn_failed, total.ul_broken);
+	LOG_INFO("messages: %lu in %lu frames (%lu batches, %lu messages failed on server)",
+			 total.ul_msgs, total.ul_frames, total.ul_batches, total.ul_failed);
+	LOG_INFO("load: %.3f sec, %.0f msgs/s, %.2f MB/s",
+			 d_secs, total.ul_msgs / d_secs, total.ul_bytes / d_secs / (1024 * 1024));
+
+	// Open loop that could not keep its schedule - more connections are needed (or the server is slow)
+	if (GSI_LC_ARRIVAL_CLOSED != g_e_arrival)
+	{
+		printf("arrivals:    %s at %lu msgs/s, most lag %.3f ms, %.3f ms behind at end\n",
+			   g_config_client_params.s_arrival, g_config_client_params.ul_rate,
+			   total.ul_max_lag_ns / 1000000.0, total.ul_behind_ns / 1000000.0);
+		LOG_INFO("arrivals: %s at %lu msgs/s, most lag %.3f ms, %.3f ms behind at end",
+				 g_config_client_params.s_arrival, g_config_client_params.ul_rate,
+				 total.ul_max_lag_ns / 1000000.0, total.ul_behind_ns / 1000000.0);
+	}
+
+	gsi_lc_report_latency(p_hists, d_secs);
+
+	if (('\0' != g_config_client_params.s_latency_file[0]) &&
+		(0 != gsi_lc_export_latency(p_hists, g_config_client_params.s_latency_file)))
+	{
+		printf("couldn't export latency into %s\n", g_config_client_params.s_latency_file);
+	}
+
+	free(p_hists);
+	free(p_threads);
+	gsi_lc_pool_free();
+
+	// Close log file to free resources
+	if (GSI_LOG_RC_SUCCESS != gsi_is_close_log(f_log))
+	{
+		printf("couldn't close log file");
+	}
+
+	return ((0 == total.ul_conn_failed) && (0 == total.ul_broken)) ? 0 : GSI_IS_FAIL;
+}
+
+/***********************************/
+/* Static functions implementation */
+/***********************************/
+/*###########################################################################
+	 * Name:		gsi_lc_now_ns
+	 * Description: Monotonic time in nanoseconds
+	 * Parameter:   None
+	 * Return:		Nanoseconds
+#############################################################################*/
+static long long gsi_lc_now_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * GSI_LC_NSECS + ts.tv_nsec;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_raise_fd_limit
+	 * Description: Raise limit of open files up to its hard limit for the connections
+	 * Parameter:   [in] int i_connections - connections to open
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_raise_fd_limit(int i_connections)
+{
+	struct rlimit limit;
+	rlim_t ul_need = (rlim_t)i_connections + GSI_LC_EXTRA_FDS;
+
+	if ((0 != getrlimit(RLIMIT_NOFILE, &limit)) || (limit.rlim_cur >= ul_need))
+	{
+		return;
+	}
+
+	limit.rlim_cur = (limit.rlim_max < ul_need) ? limit.rlim_max : ul_need;
+	if (0 != setrlimit(RLIMIT_NOFILE, &limit))
+	{
+		LOG_WARNING("couldn't raise limit of open files");
+	}
+
+	if (limit.rlim_cur < ul_need)
+	{
+		LOG_WARNING("limit of open files is %lu, some of %d connections will fail",
+					(unsigned long)limit.rlim_cur, i_connections);
+	}
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_pool_load_messages
+	 * Description: Read all regular messages of file into pool and encode them
+	 * 				into lanes of frames (i_batch_size messages in frame):
+	 * 				no mix - one lane in the order of file, mix - lane per op code with weight
+	 * Parameter:   [in] const char* s_file - messages file
+	 * Parameter:   [in] const char* s_mix - weight per op code tag (empty - no mix)
+	 * Parameter:   [in] int i_batch_size - max messages in one frame (1 - no batches)
+	 * Return:		Success - 0
+	 * 				Failure - GSI_IS_FAIL
+#############################################################################*/
+static int gsi_lc_pool_load_messages(const char* s_file, const char* s_mix, int i_batch_size)
+{
+	unsigned int a_weights[GSI_LC_MAX_LANES];
+	FILE* f_messages = NULL;
+	int i_op_code = 0;
+	int i_rc = GSI_JSON_SUCCESS;
+
+	// Batch size in range
+	if (1 > i_batch_size)
+	{
+		i_batch_size = 1;
+	}
+	else if (GSI_IS_MAX_BATCH < i_batch_size)
+	{
+		i_batch_size = GSI_IS_MAX_BATCH;
+	}
+
+	// Weights of op codes before reading all the file
+	memset(a_weights, 0, sizeof(a_weights));
+	if (('\0' != s_mix[0]) && (0 != gsi_lc_pool_parse_mix(s_mix, a_weights)))
+	{
+		return GSI_IS_FAIL;
+	}
+
+	// Open the Messages file and take its messages one by one
+	f_messages = gsi_is_open_msg_file(s_file);
+	if (NULL == f_messages)
+	{
+		LOG_ERROR("couldn't open messages file");
+		return GSI_IS_FAIL;
+	}
+
+	i_rc = gsi_is_read_all_frames(f_messages, 1, gsi_lc_pool_take_msg, &g_pool);
+
+	if (GSI_JSON_SUCCESS != gsi_is_close_msg_file(f_messages))
+	{
+		LOG_ERROR("couldn't close messages file");
+	}
+
+	if ((GSI_JSON_SUCCESS != i_rc) || (0 == g_pool.i_msgs))
+	{
+		LOG_ERROR("no messages in %s", s_file);
+		return GSI_IS_FAIL;
+	}
+
+	// No mix - one lane of all messages (op code -1)
+	if ('\0' == s_mix[0])
+	{
+		g_pool.a_lanes[0].ui_weight = 1;
+		g_pool.ui_weights = 1;
+		g_pool.ui_lanes = 1;
+
+		return gsi_lc_pool_encode_lane(&g_pool.a_lanes[0], -1, i_batch_size);
+	}
+
+	for (i_op_code = 0; i_op_code < GSI_LC_MAX_LANES; ++i_op_code)
+	{
+		if (0 == a_weights[i_op_code])
+		{
+			continue;
+		}
+
+		if (0 != gsi_lc_pool_encode_lane(&g_pool.a_lanes[g_pool.ui_lanes], i_op_code, i_batch_size))
+		{
+			return GSI_IS_FAIL;
+		}
+
+		// Op code without messages in file is not in mix
+		if (0 == g_pool.a_lanes[g_pool.ui_lanes].ui_units)
+		{
+			LOG_WARNING("no messages of op code %d in file - not in mix", i_op_code);
+			continue;
+		}
+
+		g_pool.a_lanes[g_pool.ui_lanes].ui_weight = a_weights[i_op_code];
+		g_pool.ui_weights += a_weights[i_op_code];
+		++g_pool.ui_lanes;
+	}
+
+	if (0 == g_pool.ui_lanes)
+	{
+		LOG_ERROR("no messages of mix %s in file", s_mix);
+		return GSI_IS_FAIL;
+	}
+
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_pool_take_msg
+	 * Description: Frame function of gsi_is_read_all_frames() - the pool takes
+	 * 				the regular message (and its strings), heart beats are dropped
+	 * Parameter:   [in] struct gsi_json_msg* p_json_msgs - message (reset after the call)
+	 * Parameter:   [in] int i_count - number of messages (1)
+	 * Parameter:   [in] void* p_arg - struct gsi_lc_pool*
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR
+#############################################################################*/
+static int gsi_lc_pool_take_msg(struct gsi_json_msg* p_json_msgs, int i_count, void* p_arg)
+{
+	struct gsi_lc_pool* p_pool = (struct gsi_lc_pool *)p_arg;
+	struct gsi_json_msg* p_msgs = NULL;
+	int i_cap = 0;
+
+	if ((1 != i_count) || (GSI_REGULAR_MSG != p_json_msgs->i_msg_type))
+	{
+		return GSI_JSON_SUCCESS;
+	}
+
+	if (p_pool->i_msgs == p_pool->i_msgs_cap)
+	{
+		i_cap = (0 == p_pool->i_msgs_cap) ? GSI_IS_MAX_BATCH : 2 * p_pool->i_msgs_cap;
+		p_msgs = (struct gsi_json_msg *)realloc(p_pool->p_msgs, i_cap * sizeof(struct gsi_json_msg));
+		if (NULL == p_msgs)
+		{
+			LOG_ERROR("memory allocation for messages failed");
+			return GSI_JSON_ERROR;
+		}
+
+		p_pool->p_msgs = p_msgs;
+		p_pool->i_msgs_cap = i_cap;
+	}
+
+	// Take the message - the reset after the call frees nothing
+	memcpy(&p_pool->p_msgs[p_pool->i_msgs++], p_json_msgs, sizeof(struct gsi_json_msg));
+	memset(p_json_msgs, 0, sizeof(struct gsi_json_msg));
+
+	return GSI_JSON_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_pool_parse_mix
+	 * Description: Parse weight per op code tag: "<tag>=<weight>,..." e.g. "RS=50,WS=30"
+	 * Parameter:   [in] const char* s_mix - mix of config
+	 * Parameter:   [out] unsigned int* p_weights - weight by op code
+	 * Return:		Success - 0
+	 * 				Failure - GSI_IS_FAIL (unknown tag or bad weight)
+#############################################################################*/
+static int gsi_lc_pool_parse_mix(const char* s_mix, unsigned int* p_weights)
+{
+	char s_copy[GSI_PARSE_JSON_CONFIG_MAX_FILE_NAME];
+	char a_tag[4];
+	char* s_save = NULL;
+	char* s_entry = NULL;
+	char* s_weight = NULL;
+	char* s_end = NULL;
+	unsigned long ul_weight = 0;
+	unsigned int ui_tag = 0;
+	unsigned int ui_op = 0;
+	unsigned int ui_sum = 0;
+
+	strncpy(s_copy, s_mix, sizeof(s_copy) - 1);
+	s_copy[sizeof(s_copy) - 1] = '\0';
+
+	for (s_entry = strtok_r(s_copy, ",", &s_save); NULL != s_entry; s_entry = strtok_r(NULL, ",", &s_save))
+	{
+		s_weight = strchr(s_entry, '=');
+		if ((NULL == s_weight) || (s_weight == s_entry) || ((size_t)(s_weight - s_entry) > sizeof(a_tag)))
+		{
+			LOG_ERROR("bad entry of mix: %s", s_entry);
+			return GSI_IS_FAIL;
+		}
+
+		// Tag as in messages file, packed as in GSI_IS_OP_CODES
+		memset(a_tag, 0, sizeof(a_tag));
+		memcpy(a_tag, s_entry, s_weight - s_entry);
+		ui_tag = GSI_IS_TAG(a_tag[0], a_tag[1], a_tag[2], a_tag[3]);
+
+		for (ui_op = 0; (ui_op < GSI_LC_MAX_LANES) && (g_a_op_tags[ui_op] != ui_tag); ++ui_op);
+
+		ul_weight = strtoul(s_weight + 1, &s_end, 10);
+		if ((GSI_LC_MAX_LANES == ui_op) || (s_end == s_weight + 1) ||
+			(('\0' != *s_end) && ('\n' != *s_end)) || (UINT_MAX / 2 < ul_weight))
+		{
+			LOG_ERROR("bad entry of mix: %s", s_entry);
+			return GSI_IS_FAIL;
+		}
+
+		p_weights[ui_op] = (unsigned int)ul_weight;
+		ui_sum += (unsigned int)ul_weight;
+	}
+
+	if (0 == ui_sum)
+	{
+		LOG_ERROR("mix %s has no weight", s_mix);
+		return GSI_IS_FAIL;
+	}
+
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_pool_encode_lane
+	 * Description: Encode the messages of op code (all messages for -1) in the order
+	 * 				of file into ready frames of up to i_batch_size messages
+	 * Parameter:   [out] struct gsi_lc_lane* p_lane - lane to fill (no units if no messages)
+	 * Parameter:   [in] int i_op_code - op code of lane (-1 - all messages)
+	 * Parameter:   [in] int i_batch_size - max messages in one frame
+	 * Return:		Success - 0
+	 * 				Failure - GSI_IS_FAIL
+#############################################################################*/
+static int gsi_lc_pool_encode_lane(struct gsi_lc_lane* p_lane, int i_op_code, int i_batch_size)
+{
+	struct gsi_json_msg* p_msgs = NULL;
+	struct gsi_lc_unit* p_unit = NULL;
+	size_t ul_bound = 0;
+	size_t ul_pos = 0;
+	int i_count = 0;
+	int i_index = 0;
+	int i_msgs = 0;
+
+	// Messages of lane one after the other (shallow copies - strings stay of pool)
+	p_msgs = (struct gsi_json_msg *)malloc(g_pool.i_msgs * sizeof(struct gsi_json_msg));
+	if (NULL == p_msgs)
+	{
+		LOG_ERROR("memory allocation for lane failed");
+		return GSI_IS_FAIL;
+	}
+
+	for (i_index = 0; i_index < g_pool.i_msgs; ++i_index)
+	{
+		if ((-1 == i_op_code) || (i_op_code == g_pool.p_msgs[i_index].i_op_code))
+		{
+			p_msgs[i_count++] = g_pool.p_msgs[i_index];
+		}
+	}
+
+	if (0 == i_count)
+	{
+		free(p_msgs);
+		return 0;
+	}
+
+	p_lane->ui_units = (i_count + i_batch_size - 1) / i_batch_size;
+	p_lane->p_units = (struct gsi_lc_unit *)calloc(p_lane->ui_units, sizeof(struct gsi_lc_unit));
+	p_lane->p_ops = (unsigned char *)malloc(i_count);
+
+	for (i_index = 0; i_index < i_count; i_index += i_batch_size)
+	{
+		i_msgs = (i_count - i_index < i_batch_size) ? i_count - i_index : i_batch_size;
+		ul_bound += gsi_is_batch_frame_bound(&p_msgs[i_index], i_msgs, g_ui_encoding);
+	}
+
+	p_lane->p_buf = (char *)malloc(ul_bound);
+	if ((NULL == p_lane->p_units) || (NULL == p_lane->p_ops) || (NULL == p_lane->p_buf))
+	{
+		LOG_ERROR("memory allocation for frames failed");
+		free(p_msgs);
+		return GSI_IS_FAIL;
+	}
+
+	for (i_index = 0; i_index < i_count; ++i_index)
+	{
+		p_lane->p_ops[i_index] = (unsigned char)p_msgs[i_index].i_op_code;
+	}
+
+	// Batch frames one after the other (one message too - its reply is timed), units point to them
+	for (i_index = 0; i_index < i_count; i_index += i_batch_size)
+	{
+		p_unit = &p_lane->p_units[i_index / i_batch_size];
+
+		i_msgs = (i_count - i_index < i_batch_size) ? i_count - i_index : i_batch_size;
+
+		p_unit->p_frame = p_lane->p_buf + ul_pos;
+		p_unit->ui_len = (unsigned int)gsi_is_encode_batch_frame(p_lane->p_buf + ul_pos, &p_msgs[i_index], i_msgs,
+																 g_config_client_params.ui_port, g_ui_encoding);
+		p_unit->i_type = GSI_BATCH_MSG;
+		p_unit->i_msgs = i_msgs;
+		p_unit->p_ops = p_lane->p_ops + i_index;
+
+		ul_pos += p_unit->ui_len;
+	}
+
+	g_pool.ul_units += p_lane->ui_units;
+
+	free(p_msgs);
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_pool_load_replay
+	 * Description: Map replay file - its frames are one lane as they are in file
+	 * 				(heart beats of file are dropped, the load sends its own).
+	 * 				Op codes are not known - only latency of all messages of its batches is kept
+	 * Parameter:   [in] const char* s_file - replay file (see gsi_replay_compile tool)
+	 * Return:		Success - 0
+	 * 				Failure - GSI_IS_FAIL
+#############################################################################*/
+static int gsi_lc_pool_load_replay(const char* s_file)
+{
+	const struct gsi_replay_frame* p_frames = NULL;
+	struct gsi_lc_lane* p_lane = &g_pool.a_lanes[0];
+	const char* p_map = NULL;
+	unsigned int ui_frames = 0;
+	unsigned int ui_index = 0;
+
+	g_pool.p_replay = gsi_replay_open(s_file);
+	if (NULL == g_pool.p_replay)
+	{
+		LOG_ERROR("couldn't open replay file");
+		return GSI_IS_FAIL;
+	}
+
+	// Frames are ready - they must be of the port and encoding of client
+	if ((g_pool.p_replay->hdr.ui_port != g_config_client_params.ui_port) ||
+		(g_pool.p_replay->hdr.ui_encoding != g_ui_encoding))
+	{
+		LOG_ERROR("replay of port %u encoding %u, client of port %u encoding %u",
+				  g_pool.p_replay->hdr.ui_port, g_pool.p_replay->hdr.ui_encoding,
+				  g_config_client_params.ui_port, g_ui_encoding);
+		return GSI_IS_FAIL;
+	}
+
+	p_frames = gsi_replay_get_frames(g_pool.p_replay, &p_map, &ui_frames);
+	if (NULL == p_frames)
+	{
+		return GSI_IS_FAIL;
+	}
+
+	p_lane->p_units = (struct gsi_lc_unit *)calloc((0 < ui_frames) ? ui_frames : 1, sizeof(struct gsi_lc_unit));
+	if (NULL == p_lane->p_units)
+	{
+		LOG_ERROR("memory allocation for frames failed");
+		return GSI_IS_FAIL;
+	}
+
+	for (ui_index = 0; ui_index < ui_frames; ++ui_index)
+	{
+		if (GSI_HEARTBEAT_MSG == p_frames[ui_index].us_type)
+		{
+			continue;
+		}
+
+		p_lane->p_units[p_lane->ui_units].p_frame = p_map + p_frames[ui_index].ul_offset;
+		p_lane->p_units[p_lane->ui_units].ui_len = p_frames[ui_index].ui_len;
+		p_lane->p_units[p_lane->ui_units].i_type = p_frames[ui_index].us_type;
+		p_lane->p_units[p_lane->ui_units].i_msgs = p_frames[ui_index].us_msgs;
+		++p_lane->ui_units;
+	}
+
+	if (0 == p_lane->ui_units)
+	{
+		LOG_ERROR("no messages in %s", s_file);
+		return GSI_IS_FAIL;
+	}
+
+	p_lane->ui_weight = 1;
+	g_pool.ui_weights = 1;
+	g_pool.ui_lanes = 1;
+	g_pool.ul_units = p_lane->ui_units;
+
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_pool_free
+	 * Description: Free frames and messages of pool, close replay file
+	 * Parameter:   None
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_pool_free()
+{
+	unsigned int ui_index = 0;
+	int i_index = 0;
+
+	for (ui_index = 0; ui_index < GSI_LC_MAX_LANES; ++ui_index)
+	{
+		free(g_pool.a_lanes[ui_index].p_units);
+		free(g_pool.a_lanes[ui_index].p_buf);
+		free(g_pool.a_lanes[ui_index].p_ops);
+	}
+
+	for (i_index = 0; i_index < g_pool.i_msgs; ++i_index)
+	{
+		gsi_build_parse_reset_object(&g_pool.p_msgs[i_index]);
+	}
+
+	free(g_pool.p_msgs);
+
+	if ((NULL != g_pool.p_replay) && (GSI_RP_RC_SUCCESS != gsi_replay_close(g_pool.p_replay)))
+	{
+		LOG_ERROR("couldn't close replay file");
+	}
+
+	memset(&g_pool, 0, sizeof(g_pool));
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_report_latency
+	 * Description: Report latency percentiles of each op code (that was sent) and of
+	 * 				all messages, on screen and in log file
+	 * Parameter:   [in] const gsi_lat_hist_t* p_hists - histograms of all threads
+	 * Parameter:   [in] double d_secs - seconds of load
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_report_latency(const gsi_lat_hist_t* p_hists, double d_secs)
+{
+	const gsi_lat_hist_t* p_hist = NULL;
+	int i_hist = 0;
+
+	if (0 == p_hists[GSI_LC_HIST_ALL].ul_count)
+	{
+		printf("latency:     no replies\n");
+		return;
+	}
+
+	gsi_lat_hist_print_title(stdout);
+
+	for (i_hist = 0; i_hist < GSI_LC_HISTS; ++i_hist)
+	{
+		p_hist = &p_hists[i_hist];
+		if (0 == p_hist->ul_count)
+		{
+			continue;
+		}
+
+		gsi_lat_hist_print(p_hist, g_a_hist_names[i_hist], d_secs, stdout);
+
+		LOG_INFO("latency of %s: %lu msgs, p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f max %.1f us",
+				 g_a_hist_names[i_hist], p_hist->ul_count,
+				 gsi_lat_hist_percentile(p_hist, 50) / 1000.0, gsi_lat_hist_percentile(p_hist, 90) / 1000.0,
+				 gsi_lat_hist_percentile(p_hist, 99) / 1000.0, gsi_lat_hist_percentile(p_hist, 99.9) / 1000.0,
+				 p_hist->ul_max / 1000.0);
+	}
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_export_latency
+	 * Description: Export the histograms with values (nanoseconds) into file,
+	 * 				to be merged with other runs (see gsi_hist_merge tool)
+	 * Parameter:   [in] const gsi_lat_hist_t* p_hists - histograms of all threads
+	 * Parameter:   [in] const char* s_file - file to write (replaced if exists)
+	 * Return:		Success - 0
+	 * 				Failure - GSI_IS_FAIL
+#############################################################################*/
+static int gsi_lc_export_latency(const gsi_lat_hist_t* p_hists, const char* s_file)
+{
+	FILE* f_out = NULL;
+	int i_hist = 0;
+	int i_rc = 0;
+
+	f_out = fopen(s_file, "w");
+	if (NULL == f_out)
+	{
+		LOG_ERROR("couldn't open latency file %s", s_file);
+		return GSI_IS_FAIL;
+	}
+
+	fprintf(f_out, "# latency (ns) of gsi_load_client to port %u, %s encoding, batch size %d\n",
+			g_config_client_params.ui_port, (GSI_ENC_BINARY == g_ui_encoding) ? "binary" : "json",
+			g_config_client_params.i_batch_size);
+
+	for (i_hist = 0; (i_hist < GSI_LC_HISTS) && (0 == i_rc); ++i_hist)
+	{
+		if ((0 != p_hists[i_hist].ul_count) &&
+			(GSI_LH_RC_SUCCESS != gsi_lat_hist_export(&p_hists[i_hist], g_a_hist_names[i_hist], f_out)))
+		{
+			LOG_ERROR("couldn't write latency file %s", s_file);
+			i_rc = GSI_IS_FAIL;
+		}
+	}
+
+	if (0 != fclose(f_out))
+	{
+		LOG_ERROR("couldn't close latency file %s", s_file);
+		i_rc = GSI_IS_FAIL;
+	}
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_thread_run
+	 * Description: Event loop of thread - open its connections and send frames on
+	 * 				them until each one is done (duration ended or pool was sent).
+	 * 				Connections that wait for their next frame are in ready queue,
+	 * 				it is served as the rate limit lets, then epoll is waited for
+	 * 				connects, answers and writable sockets.
+	 * Parameter:   [in] void* p_args - struct gsi_lc_thread*
+	 * Return:		Always NULL
+#############################################################################*/
+static void* gsi_lc_thread_run(void* p_args)
+{
+	struct gsi_lc_thread* p_thread = (struct gsi_lc_thread *)p_args;
+	struct epoll_event a_events[GSI_LC_MAX_EVENTS];
+	long long ll_now_ns = 0;
+	long long ll_wait_ns = 0;
+	long long ll_next_ms = 0;
+	int i_events = 0;
+	int i_index = 0;
+
+	p_thread->p_conns = (struct gsi_lc_conn *)calloc(p_thread->i_conns, sizeof(struct gsi_lc_conn));
+	p_thread->p_ready = (int *)malloc(p_thread->i_conns * sizeof(int));
+	p_thread->i_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+	if ((NULL == p_thread->p_conns) || (NULL == p_thread->p_ready) || (0 > p_thread->i_epoll_fd))
+	{
+		LOG_ERROR("thread init failed");
+		p_thread->stats.ul_conn_failed += p_thread->i_conns;
+		free(p_thread->p_conns);
+		free(p_thread->p_ready);
+		if (0 <= p_thread->i_epoll_fd)
+		{
+			close(p_thread->i_epoll_fd);
+		}
+
+		return NULL;
+	}
+
+	for (i_index = 0; i_index < GSI_LC_HISTS; ++i_index)
+	{
+		gsi_lat_hist_init(&p_thread->a_hists[i_index]);
+	}
+
+	p_thread->ll_tokens_ns = gsi_lc_now_ns();
+	gsi_tw_init(&p_thread->wheel, GSI_LC_TICK_MSECS, p_thread->ll_tokens_ns / 1000000);
+	p_thread->d_burst = p_thread->d_rate * GSI_LC_BURST_MSECS / 1000;
+	if (GSI_IS_MAX_BATCH > p_thread->d_burst)
+	{
+		p_thread->d_burst = GSI_IS_MAX_BATCH;
+	}
+
+	// Open all connections at once (non-blocking connect)
+	p_thread->i_open = p_thread->i_conns;
+	for (i_index = 0; i_index < p_thread->i_conns; ++i_index)
+	{
+		gsi_lc_conn_open(p_thread, &p_thread->p_conns[i_index]);
+	}
+
+	while (0 < p_thread->i_open)
+	{
+		ll_now_ns = gsi_lc_now_ns();
+
+		// Duration ended - no more frames, wait for the replies
+		if ((0 != g_ll_end_ns) && (ll_now_ns >= g_ll_end_ns) && (!p_thread->i_stopping))
+		{
+			gsi_lc_thread_stop(p_thread);
+			continue;
+		}
+
+		// Deadlines that passed - heart beats of ready connections, broken ones are closed
+		gsi_tw_expire(&p_thread->wheel, ll_now_ns / 1000000, gsi_lc_conn_expire, p_thread);
+
+		gsi_lc_thread_tokens(p_thread, ll_now_ns);
+
+		// Time to wait - 0 while frames can be sent, else until the next is allowed (or due),
+		// the next deadline or the end
+		ll_wait_ns = gsi_lc_thread_serve_ready(p_thread, ll_now_ns);
+
+		ll_next_ms = gsi_tw_next_ms(&p_thread->wheel, ll_now_ns / 1000000);
+		if ((0 <= ll_next_ms) && ((0 > ll_wait_ns) || (ll_next_ms * 1000000LL < ll_wait_ns)))
+		{
+			ll_wait_ns = ll_next_ms * 1000000LL;
+		}
+
+		if ((0 != g_ll_end_ns) && (!p_thread->i_stopping) &&
+			((0 > ll_wait_ns) || (g_ll_end_ns - ll_now_ns < ll_wait_ns)))
+		{
+			ll_wait_ns = g_ll_end_ns - ll_now_ns;
+		}
+
+		i_events = epoll_wait(p_thread->i_epoll_fd, a_events, GSI_LC_MAX_EVENTS,
+							  (0 > ll_wait_ns) ? -1 : (int)((ll_wait_ns + 999999) / 1000000));
+		if ((0 > i_events) && (EINTR != errno))
+		{
+			LOG_ERROR("epoll wait failed (errno %d)", errno);
+			break;
+		}
+
+		for (i_index = 0; i_index < i_events; ++i_index)
+		{
+			gsi_lc_conn_event(p_thread, (struct gsi_lc_conn *)a_events[i_index].data.ptr, a_events[i_index].events);
+		}
+	}
+
+	// Close what is left (error of epoll)
+	for (i_index = 0; i_index < p_thread->i_conns; ++i_index)
+	{
+		if (GSI_LC_DONE != p_thread->p_conns[i_index].e_state)
+		{
+			gsi_lc_conn_close(p_thread, &p_thread->p_conns[i_index], 1);
+		}
+	}
+
+	close(p_thread->i_epoll_fd);
+	free(p_thread->p_conns);
+	free(p_thread->p_ready);
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_thread_tokens
+	 * Description: Add tokens of rate limit for the time passed (up to burst)
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread
+	 * Parameter:   [in] long long ll_now_ns - time now
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_thread_tokens(struct gsi_lc_thread* p_thread, long long ll_now_ns)
+{
+	if ((0 >= p_thread->d_rate) || (GSI_LC_ARRIVAL_CLOSED != g_e_arrival))
+	{
+		return;
+	}
+
+	p_thread->d_tokens += p_thread->d_rate * (ll_now_ns - p_thread->ll_tokens_ns) / GSI_LC_NSECS;
+	if (p_thread->d_tokens > p_thread->d_burst)
+	{
+		p_thread->d_tokens = p_thread->d_burst;
+	}
+
+	p_thread->ll_tokens_ns = ll_now_ns;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_thread_serve_ready
+	 * Description: Start the next frame of connections in ready queue (each one once),
+	 * 				while tokens of rate limit are enough (closed loop), or while
+	 * 				frames are due (open loop - the frame is timed from when it was due).
+	 * 				A connection that is writing its heart beat goes to the end of the queue.
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread
+	 * Parameter:   [in] long long ll_now_ns - time now
+	 * Return:		Nanoseconds to wait for events: 0 - ready queue can be served,
+	 * 				until tokens are enough or the next frame is due, -1 - nothing to serve
+#############################################################################*/
+static long long gsi_lc_thread_serve_ready(struct gsi_lc_thread* p_thread, long long ll_now_ns)
+{
+	struct gsi_lc_conn* p_conn = NULL;
+	int i_serve = p_thread->i_ready_count;
+	int i_beating = 0;
+
+	while (0 < i_serve--)
+	{
+		p_conn = &p_thread->p_conns[p_thread->p_ready[p_thread->i_ready_head]];
+
+		// Closed while it waited
+		if (GSI_LC_READY != p_conn->e_state)
+		{
+			p_thread->i_ready_head = (p_thread->i_ready_head + 1) % p_thread->i_conns;
+			--p_thread->i_ready_count;
+			continue;
+		}
+
+		// Heart beat is not written yet (socket is full) - after the others
+		if (p_conn->i_heartbeat)
+		{
+			p_thread->p_ready[(p_thread->i_ready_head + p_thread->i_ready_count) % p_thread->i_conns] =
+				p_thread->p_ready[p_thread->i_ready_head];
+			p_thread->i_ready_head = (p_thread->i_ready_head + 1) % p_thread->i_conns;
+			++i_beating;
+			continue;
+		}
+
+		if (NULL == p_conn->p_unit)
+		{
+			p_conn->p_unit = gsi_lc_next_unit(p_thread, p_conn);
+		}
+
+		// Open loop - the connection stays first until the next frame is due
+		if (GSI_LC_ARRIVAL_CLOSED != g_e_arrival)
+		{
+			if (ll_now_ns < p_thread->ll_next_ns)
+			{
+				return p_thread->ll_next_ns - ll_now_ns;
+			}
+
+			if ((unsigned long)(ll_now_ns - p_thread->ll_next_ns) > p_thread->stats.ul_max_lag_ns)
+			{
+				p_thread->stats.ul_max_lag_ns = (unsigned long)(ll_now_ns - p_thread->ll_next_ns);
+			}
+
+			p_conn->ll_sent_ns = p_thread->ll_next_ns;
+			p_thread->ll_next_ns += gsi_lc_thread_gap(p_thread, p_conn->p_unit->i_msgs);
+		}
+		// Rate limit - the connection stays first until the tokens are enough
+		else if (0 < p_thread->d_rate)
+		{
+			if (p_thread->d_tokens < p_conn->p_unit->i_msgs)
+			{
+				return (long long)((p_conn->p_unit->i_msgs - p_thread->d_tokens) * GSI_LC_NSECS / p_thread->d_rate) + 1;
+			}
+
+			p_thread->d_tokens -= p_conn->p_unit->i_msgs;
+			p_conn->ll_sent_ns = gsi_lc_now_ns();
+		}
+		else
+		{
+			p_conn->ll_sent_ns = gsi_lc_now_ns();
+		}
+
+		p_thread->i_ready_head = (p_thread->i_ready_head + 1) % p_thread->i_conns;
+		--p_thread->i_ready_count;
+
+		gsi_lc_conn_send(p_thread, p_conn);
+	}
+
+	return (i_beating < p_thread->i_ready_count) ? 0 : -1;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_thread_gap
+	 * Description: Open loop - time from a due frame to the next one: i_msgs / rate
+	 * 				seconds (fixed), or exponential of that mean (poisson)
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread (rate and seed)
+	 * Parameter:   [in] int i_msgs - messages of the due frame
+	 * Return:		Nanoseconds
+#############################################################################*/
+static long long gsi_lc_thread_gap(struct gsi_lc_thread* p_thread, int i_msgs)
+{
+	double d_gap_ns = i_msgs * GSI_LC_NSECS / p_thread->d_rate;
+	double d_uniform = 0;
+
+	if (GSI_LC_ARRIVAL_POISSON == g_e_arrival)
+	{
+		// Uniform in (0, 1] - log of it is finite
+		d_uniform = ((double)rand_r(&p_thread->ui_seed) + 1) / ((double)RAND_MAX + 1);
+		d_gap_ns *= -log(d_uniform);
+	}
+
+	return (long long)d_gap_ns;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_thread_stop
+	 * Description: Duration ended - close the connections that wait in ready queue,
+	 * 				the others are closed after their frame (and its reply).
+	 * 				Open loop keeps how far behind its schedule it ended.
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_thread_stop(struct gsi_lc_thread* p_thread)
+{
+	int i_index = 0;
+
+	p_thread->i_stopping = 1;
+
+	if ((GSI_LC_ARRIVAL_CLOSED != g_e_arrival) && (p_thread->ll_next_ns < g_ll_end_ns))
+	{
+		p_thread->stats.ul_behind_ns = (unsigned long)(g_ll_end_ns - p_thread->ll_next_ns);
+	}
+
+	for (i_index = 0; i_index < p_thread->i_conns; ++i_index)
+	{
+		if (GSI_LC_READY == p_thread->p_conns[i_index].e_state)
+		{
+			gsi_lc_conn_close(p_thread, &p_thread->p_conns[i_index], 0);
+		}
+	}
+
+	p_thread->i_ready_count = 0;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_next_unit
+	 * Description: Next frame of connection - without mix the frames in order,
+	 * 				with mix a lane by weight (rand_r()) and a frame of it
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread (seed)
+	 * Parameter:   [in] struct gsi_lc_conn* p_conn - connection
+	 * Return:		Frame to send
+#############################################################################*/
+static const struct gsi_lc_unit* gsi_lc_next_unit(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn)
+{
+	const struct gsi_lc_lane* p_lane = &g_pool.a_lanes[0];
+	unsigned int ui_pick = 0;
+
+	if (1 == g_pool.ui_lanes)
+	{
+		return &p_lane->p_units[p_conn->ul_units % p_lane->ui_units];
+	}
+
+	ui_pick = (unsigned int)rand_r(&p_thread->ui_seed) % g_pool.ui_weights;
+	while (ui_pick >= p_lane->ui_weight)
+	{
+		ui_pick -= p_lane->ui_weight;
+		++p_lane;
+	}
+
+	return &p_lane->p_units[(unsigned int)rand_r(&p_thread->ui_seed) % p_lane->ui_units];
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_conn_open
+	 * Description: Start non-blocking connect of connection to server
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread of connection
+	 * Parameter:   [in] struct gsi_lc_conn* p_conn - connection
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_conn_open(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn)
+{
+	struct epoll_event event;
+	int i_one = 1;
+
+	p_conn->e_state = GSI_LC_CONNECTING;
+	p_conn->timer.p_data = p_conn;
+	gsi_tw_set(&p_thread->wheel, &p_conn->timer, gsi_tw_now_ms() + GSI_IS_BATCH_REPLY_MSECS);
+
+	p_conn->i_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (0 > p_conn->i_fd)
+	{
+		LOG_ERROR("socket failed (errno %d)", errno);
+		gsi_lc_conn_close(p_thread, p_conn, 1);
+		return;
+	}
+
+	// Frames are small and each batch waits for its reply - no delay of writes
+	setsockopt(p_conn->i_fd, IPPROTO_TCP, TCP_NODELAY, &i_one, sizeof(i_one));
+
+	event.events = EPOLLOUT;
+	event.data.ptr = p_conn;
+	if (0 > epoll_ctl(p_thread->i_epoll_fd, EPOLL_CTL_ADD, p_conn->i_fd, &event))
+	{
+		LOG_ERROR("epoll add failed (errno %d)", errno);
+		close(p_conn->i_fd);
+		p_conn->i_fd = -1;
+		gsi_lc_conn_close(p_thread, p_conn, 1);
+		return;
+	}
+
+	p_conn->ui_events = EPOLLOUT;
+
+	if (0 == connect(p_conn->i_fd, (struct sockaddr *)&g_server_addr, sizeof(g_server_addr)))
+	{
+		gsi_lc_conn_connected(p_thread, p_conn);
+	}
+	else if (EINPROGRESS != errno)
+	{
+		LOG_ERROR("connect failed (errno %d)", errno);
+		gsi_lc_conn_close(p_thread, p_conn, 1);
+	}
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_conn_expire
+	 * Description: Deadline of connection passed (gsi_tw_expire() of its thread):
+	 * 				ready - heart beat is written in its place in ready queue,
+	 * 				else (connect, hello, frame or heart beat is not answered / written) - broken
+	 * Parameter:   [in] struct gsi_tw_timer* p_timer - timer of connection
+	 * Parameter:   [in] void* p_arg - struct gsi_lc_thread* of connection
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_conn_expire(struct gsi_tw_timer* p_timer, void* p_arg)
+{
+	struct gsi_lc_thread* p_thread = (struct gsi_lc_thread *)p_arg;
+	struct gsi_lc_conn* p_conn = (struct gsi_lc_conn *)p_timer->p_data;
+
+	if ((GSI_LC_READY == p_conn->e_state) && (!p_conn->i_heartbeat))
+	{
+		gsi_tw_set(&p_thread->wheel, p_timer, gsi_tw_now_ms() + GSI_IS_BATCH_REPLY_MSECS);
+		p_conn->i_heartbeat = 1;
+		p_conn->p_out = g_a_heartbeat;
+		p_conn->ui_out_len = sizeof(g_a_heartbeat);
+		p_conn->ui_out_off = 0;
+
+		gsi_lc_conn_write(p_thread, p_conn);
+		return;
+	}
+
+	LOG_ERROR("no progress of connection for %d msecs", GSI_IS_BATCH_REPLY_MSECS);
+	gsi_lc_conn_close(p_thread, p_conn, 1);
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_conn_event
+	 * Description: Handle events of connection by its state
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread of connection
+	 * Parameter:   [in] struct gsi_lc_conn* p_conn - connection
+	 * Parameter:   [in] unsigned int ui_events - events of epoll
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_conn_event(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn, unsigned int ui_events)
+{
+	int i_error = 0;
+	socklen_t ui_len = sizeof(i_error);
+
+	switch (p_conn->e_state)
+	{
+	case GSI_LC_CONNECTING:
+		if ((0 != getsockopt(p_conn->i_fd, SOL_SOCKET, SO_ERROR, &i_error, &ui_len)) || (0 != i_error))
+		{
+			LOG_ERROR("connect failed (errno %d)", i_error);
+			gsi_lc_conn_close(p_thread, p_conn, 1);
+			return;
+		}
+
+		gsi_lc_conn_connected(p_thread, p_conn);
+		break;
+
+	case GSI_LC_HELLO:
+	case GSI_LC_WAIT_REPLY:
+		if (EPOLLOUT & ui_events)
+		{
+			gsi_lc_conn_write(p_thread, p_conn);
+		}
+		else if (EPOLLIN & ui_events)
+		{
+			gsi_lc_conn_answer(p_thread, p_conn);
+		}
+		else
+		{
+			gsi_lc_conn_close(p_thread, p_conn, 1);
+		}
+		break;
+
+	case GSI_LC_SENDING:
+	case GSI_LC_READY:
+		// Server doesn't send without a batch - only close (or error) is expected
+		if ((EPOLLIN | EPOLLERR | EPOLLHUP) & ui_events)
+		{
+			LOG_ERROR("server closed connection");
+			gsi_lc_conn_close(p_thread, p_conn, 1);
+		}
+		else if (EPOLLOUT & ui_events)
+		{
+			gsi_lc_conn_write(p_thread, p_conn);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_conn_connected
+	 * Description: Connect completed - send hello (binary) or start sending frames (JSON)
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread of connection
+	 * Parameter:   [in] struct gsi_lc_conn* p_conn - connection
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_conn_connected(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn)
+{
+	p_conn->i_connected = 1;
+	++p_thread->stats.ul_connected;
+
+	// Server counts liveness from accept
+	p_conn->ll_written_ns = gsi_lc_now_ns();
+
+	// Writable is waited for only while a write is not done
+	gsi_lc_conn_arm(p_thread, p_conn, EPOLLIN);
+
+	if (GSI_ENC_BINARY == g_ui_encoding)
+	{
+		gsi_tw_set(&p_thread->wheel, &p_conn->timer, p_conn->ll_written_ns / 1000000 + GSI_IS_BATCH_REPLY_MSECS);
+		p_conn->e_state = GSI_LC_HELLO;
+		p_conn->p_out = g_a_hello;
+		p_conn->ui_out_len = sizeof(g_a_hello);
+		p_conn->ui_out_off = 0;
+
+		gsi_lc_conn_write(p_thread, p_conn);
+		return;
+	}
+
+	gsi_lc_conn_idle(p_thread, p_conn);
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_conn_send
+	 * Description: Start write of the chosen frame (and its reply) - deadline is
+	 * 				GSI_IS_BATCH_REPLY_MSECS from now
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread of connection
+	 * Parameter:   [in] struct gsi_lc_conn* p_conn - connection (p_unit is set)
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_conn_send(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn)
+{
+	gsi_tw_set(&p_thread->wheel, &p_conn->timer, gsi_tw_now_ms() + GSI_IS_BATCH_REPLY_MSECS);
+	p_conn->e_state = GSI_LC_SENDING;
+	p_conn->ui_out_off = 0;
+	p_conn->p_out = p_conn->p_unit->p_frame;
+	p_conn->ui_out_len = p_conn->p_unit->ui_len;
+
+	gsi_lc_conn_write(p_thread, p_conn);
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_conn_write
+	 * Description: Write as much as the socket takes. A full socket waits for
+	 * 				EPOLLOUT, a written frame moves the connection on:
+	 * 				hello - wait for answer, batch - wait for reply, heart beat - stays ready
+	 * 				(its next heart beat is set), else - ready again
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread of connection
+	 * Parameter:   [in] struct gsi_lc_conn* p_conn - connection
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_conn_write(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn)
+{
+	ssize_t l_count = 0;
+
+	while (1)
+	{
+		l_count = send(p_conn->i_fd, p_conn->p_out + p_conn->ui_out_off,
+					   p_conn->ui_out_len - p_conn->ui_out_off, MSG_NOSIGNAL);
+		if (0 > l_count)
+		{
+			if (EINTR == errno)
+			{
+				continue;
+			}
+
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+			{
+				gsi_lc_conn_arm(p_thread, p_conn, EPOLLIN | EPOLLOUT);
+				return;
+			}
+
+			LOG_ERROR("send failed (errno %d)", errno);
+			gsi_lc_conn_close(p_thread, p_conn, 1);
+			return;
+		}
+
+		p_thread->stats.ul_bytes += l_count;
+		p_conn->ui_out_off += l_count;
+		if (p_conn->ui_out_off < p_conn->ui_out_len)
+		{
+			continue;
+		}
+
+		break;
+	}
+
+	gsi_lc_conn_arm(p_thread, p_conn, EPOLLIN);
+	p_conn->ll_written_ns = gsi_lc_now_ns();
+
+	if (GSI_LC_HELLO == p_conn->e_state)
+	{
+		return;
+	}
+
+	// Heart beat was written - still in ready queue (p_unit is kept if it was chosen)
+	if (p_conn->i_heartbeat)
+	{
+		p_conn->i_heartbeat = 0;
+		gsi_tw_set(&p_thread->wheel, &p_conn->timer, p_conn->ll_written_ns / 1000000 + GSI_IS_HEARTBEAT_MSECS);
+		return;
+	}
+
+	++p_conn->ul_units;
+	++p_thread->stats.ul_frames;
+	p_thread->stats.ul_msgs += p_conn->p_unit->i_msgs;
+
+	if (GSI_BATCH_MSG == p_conn->p_unit->i_type)
+	{
+		++p_thread->stats.ul_batches;
+		p_conn->e_state = GSI_LC_WAIT_REPLY;
+		p_conn->ui_rx_len = 0;
+		return;
+	}
+
+	p_conn->p_unit = NULL;
+	gsi_lc_conn_idle(p_thread, p_conn);
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_conn_read
+	 * Description: Read answer of server (header, then its content) without blocking
+	 * Parameter:   [in] struct gsi_lc_conn* p_conn - connection
+	 * Return:		1 - answer is in a_rx ('\0' after it), 0 - not all of it yet,
+	 * 				GSI_IS_FAIL - closed or bad answer
+#############################################################################*/
+static int gsi_lc_conn_read(struct gsi_lc_conn* p_conn)
+{
+	struct gsi_cs_tcp_message msg;
+	unsigned int ui_need = GSI_IS_FRAME_HEADER_LEN;
+	ssize_t l_count = 0;
+
+	while (1)
+	{
+		if (GSI_IS_FRAME_HEADER_LEN <= p_conn->ui_rx_len)
+		{
+			memcpy(&msg, p_conn->a_rx, GSI_IS_FRAME_HEADER_LEN);
+			if (GSI_LC_MAX_REPLY < msg.ui_len)
+			{
+				LOG_ERROR("answer of %u bytes is too long", msg.ui_len);
+				return GSI_IS_FAIL;
+			}
+
+			ui_need = GSI_IS_FRAME_HEADER_LEN + msg.ui_len;
+			if (ui_need == p_conn->ui_rx_len)
+			{
+				p_conn->a_rx[ui_need] = '\0';
+				return 1;
+			}
+		}
+
+		l_count = read(p_conn->i_fd, p_conn->a_rx + p_conn->ui_rx_len, ui_need - p_conn->ui_rx_len);
+		if (0 < l_count)
+		{
+			p_conn->ui_rx_len += l_count;
+			continue;
+		}
+
+		if ((0 > l_count) && ((EAGAIN == errno) || (EWOULDBLOCK == errno)))
+		{
+			return 0;
+		}
+
+		if ((0 > l_count) && (EINTR == errno))
+		{
+			continue;
+		}
+
+		LOG_ERROR("server closed connection");
+		return GSI_IS_FAIL;
+	}
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_conn_answer
+	 * Description: Handle answer of server: chosen encoding of hello, or results of batch
+	 * 				(latency of its messages is from its send - or from when it was due, open loop)
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread of connection
+	 * Parameter:   [in] struct gsi_lc_conn* p_conn - connection
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_conn_answer(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn)
+{
+	struct gsi_cs_tcp_message msg;
+	unsigned char a_results[GSI_IS_MAX_BATCH];
+	long long ll_now_ns = 0;
+	unsigned long ul_latency_ns = 0;
+	unsigned int ui_chosen = 0;
+	unsigned int ui_count = 0;
+	unsigned int ui_index = 0;
+	int i_rc = gsi_lc_conn_read(p_conn);
+
+	if (0 == i_rc)
+	{
+		return;
+	}
+
+	if (GSI_IS_FAIL == i_rc)
+	{
+		gsi_lc_conn_close(p_thread, p_conn, 1);
+		return;
+	}
+
+	memcpy(&msg, p_conn->a_rx, GSI_IS_FRAME_HEADER_LEN);
+	p_conn->ui_rx_len = 0;
+	ll_now_ns = gsi_lc_now_ns();
+	ul_latency_ns = (unsigned long)(ll_now_ns - p_conn->ll_sent_ns);
+
+	if (GSI_LC_HELLO == p_conn->e_state)
+	{
+		// Frames of pool are encoded in the asked encoding - server must choose it
+		if ((GSI_HELLO_MSG == msg.e_type_msg) && (sizeof(ui_chosen) == msg.ui_len))
+		{
+			memcpy(&ui_chosen, p_conn->a_rx + GSI_IS_FRAME_HEADER_LEN, sizeof(ui_chosen));
+		}
+
+		if (g_ui_encoding != ui_chosen)
+		{
+			LOG_ERROR("server chose encoding %u instead of %u", ui_chosen, g_ui_encoding);
+			gsi_lc_conn_close(p_thread, p_conn, 1);
+			return;
+		}
+
+		gsi_lc_conn_idle(p_thread, p_conn);
+		return;
+	}
+
+	if ((GSI_BATCH_REPLY_MSG != msg.e_type_msg) ||
+		(GSI_JSON_SUCCESS != gsi_is_decode_batch_reply(p_conn->a_rx + GSI_IS_FRAME_HEADER_LEN, msg.ui_len,
+													   g_ui_encoding, a_results, &ui_count)) ||
+		((unsigned int)p_conn->p_unit->i_msgs != ui_count))
+	{
+		LOG_ERROR("bad reply to batch of %d messages", p_conn->p_unit->i_msgs);
+		gsi_lc_conn_close(p_thread, p_conn, 1);
+		return;
+	}
+
+	// Each message of batch waited for the same reply
+	for (ui_index = 0; ui_index < ui_count; ++ui_index)
+	{
+		p_thread->stats.ul_failed += a_results[ui_index];
+
+		gsi_lat_hist_record(&p_thread->a_hists[GSI_LC_HIST_ALL], ul_latency_ns);
+		if ((NULL != p_conn->p_unit->p_ops) && (GSI_LC_MAX_LANES > p_conn->p_unit->p_ops[ui_index]))
+		{
+			gsi_lat_hist_record(&p_thread->a_hists[p_conn->p_unit->p_ops[ui_index]], ul_latency_ns);
+		}
+	}
+
+	p_conn->p_unit = NULL;
+	gsi_lc_conn_idle(p_thread, p_conn);
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_conn_idle
+	 * Description: Frame of connection is done - close it if the load ended for it,
+	 * 				else put it in ready queue for its next frame (deadline - its heart beat)
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread of connection
+	 * Parameter:   [in] struct gsi_lc_conn* p_conn - connection
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_conn_idle(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn)
+{
+	if ((p_thread->i_stopping) || ((0 == g_ll_end_ns) && (p_conn->ul_units >= g_pool.ul_units)))
+	{
+		gsi_lc_conn_close(p_thread, p_conn, 0);
+		return;
+	}
+
+	p_conn->e_state = GSI_LC_READY;
+	gsi_tw_set(&p_thread->wheel, &p_conn->timer, p_conn->ll_written_ns / 1000000 + GSI_IS_HEARTBEAT_MSECS);
+	p_thread->p_ready[(p_thread->i_ready_head + p_thread->i_ready_count) % p_thread->i_conns] =
+		(int)(p_conn - p_thread->p_conns);
+	++p_thread->i_ready_count;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_conn_arm
+	 * Description: Set events of connection in epoll (only if they changed)
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread of connection
+	 * Parameter:   [in] struct gsi_lc_conn* p_conn - connection
+	 * Parameter:   [in] unsigned int ui_events - EPOLLIN and / or EPOLLOUT
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_conn_arm(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn, unsigned int ui_events)
+{
+	struct epoll_event event;
+
+	if (ui_events == p_conn->ui_events)
+	{
+		return;
+	}
+
+	event.events = ui_events;
+	event.data.ptr = p_conn;
+	if (0 > epoll_ctl(p_thread->i_epoll_fd, EPOLL_CTL_MOD, p_conn->i_fd, &event))
+	{
+		LOG_ERROR("epoll mod failed (errno %d)", errno);
+	}
+
+	p_conn->ui_events = ui_events;
+}
+
+/*###########################################################################
+	 * Name:		gsi_lc_conn_close
+	 * Description: Close connection and count how it ended
+	 * Parameter:   [in] struct gsi_lc_thread* p_thread - thread of connection
+	 * Parameter:   [in] struct gsi_lc_conn* p_conn - connection
+	 * Parameter:   [in] int i_failed - 0 - load of connection is done, else - failure
+	 * Return:		None
+#############################################################################*/
+static void gsi_lc_conn_close(struct gsi_lc_thread* p_thread, struct gsi_lc_conn* p_conn, int i_failed)
+{
+	gsi_tw_cancel(&p_thread->wheel, &p_conn->timer);
+
+	if (0 <= p_conn->i_fd)
+	{
+		// Closing fd removes it from epoll
+		close(p_conn->i_fd);
+		p_conn->i_fd = -1;
+	}
+
+	if (i_failed)
+	{
+		if (p_conn->i_connected)
+		{
+			++p_thread->stats.ul_broken;
+		}
+		else
+		{
+			++p_thread->stats.ul_conn_failed;
+		}
+	}
+
+	p_conn->e_state = GSI_LC_DONE;
+	--p_thread->i_open;
+}
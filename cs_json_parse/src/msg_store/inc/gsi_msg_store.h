@@ -0,0 +1,340 @@
+/**************************************************************************
+* Name : gsi_msg_store.h
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Log-structured store of messages with id.
+* 				Messages are appended to segment files in a store directory:
+* 					<dir>/segment-<NNNNNNNN>.log
+* 				Each record is: header | target file name | message data.
+* 				An in-memory hash index maps (target file, id) to the location
+* 				of the latest record, so a lookup is a single read.
+* 				The messages of each target file are linked in append order, so
+* 				an export reads only the records of that file.
+* 				A background thread flushes the write buffer and compacts
+* 				segments that are mostly overwritten records.
+* 				Using: 1. gsi_msg_store_open() - Must be first! (recovers the index from disk)
+* 					   2. gsi_msg_store_append() / gsi_msg_store_get() - as much as you want.
+* 					   3. gsi_msg_store_export() - text view of one target file.
+* 					   4. gsi_msg_store_close() - Must be last!
+*****************************************************************************/
+#ifndef GSI_MSG_STORE_H_
+#define GSI_MSG_STORE_H_
+
+/* Includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* Defines and Macros */
+#define 	GSI_MS_MAX_PATH				256
+#define 	GSI_MS_SEGMENT_MAX_BYTES	(64 * 1024 * 1024)	/* roll to a new segment above this size */
+#define 	GSI_MS_WRITE_BUF_SIZE		(256 * 1024)		/* appends are buffered up to this size */
+#define 	GSI_MS_COMPACT_PERCENT		50					/* compact a segment with this % of dead bytes */
+#define 	GSI_MS_FLUSH_MSECS			200					/* max time an append stays in memory only */
+#define 	GSI_MS_RECORD_MAGIC			0x314D5347			/* "GSM1" */
+
+/* Typedef */
+typedef struct gsi_msg_store gsi_msg_store_t;
+
+/* Enums */
+/***************************************************************************
+ * Name:  		gsi_msg_store_rc
+ * Description: Return Code values for GSI-MSG-STORE functions
+ ***************************************************************************/
+enum gsi_msg_store_rc {
+	GSI_MS_RC_SUCCESS   = 0,	// Function completed Successfully
+	GSI_MS_RC_ERROR     = 1,	// Function completed with Error
+	GSI_MS_RC_INVALID   = 2,	// Function got invalid arguments
+	GSI_MS_RC_NOT_FOUND = 3		// No message with this id
+};
+
+/* Structures */
+/*****************************************************************************
+ * Name : gsi_msg_store_record_hdr
+ * Used by: segment files
+ * Warning: On-disk format - DONT change the order or size of the members!
+ * Members:
+ *----------------------------------------------------------------------------
+ *		uint32_t ui_magic - GSI_MS_RECORD_MAGIC
+ *----------------------------------------------------------------------------
+ *		uint32_t ui_crc - CRC32 of the rest of the header and the payload
+ *----------------------------------------------------------------------------
+ *		uint32_t ui_id - message id
+ *----------------------------------------------------------------------------
+ *		uint16_t us_name_len - length of target file name that follows the header
+ *----------------------------------------------------------------------------
+ *		uint16_t us_flags - reserved (0)
+ *----------------------------------------------------------------------------
+ *		uint32_t ui_data_len - length of message data that follows the name
+ *****************************************************************************/
+struct gsi_msg_store_record_hdr
+{
+	uint32_t ui_magic;
+	uint32_t ui_crc;
+	uint32_t ui_id;
+	uint16_t us_name_len;
+	uint16_t us_flags;
+	uint32_t ui_data_len;
+};
+
+/*****************************************************************************
+ * Name : gsi_msg_store_segment
+ * Used by: struct gsi_msg_store
+ * Members:
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_number - number in the segment file name
+ *----------------------------------------------------------------------------
+ *		int i_fd - open file descriptor
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_size - bytes in segment (including unflushed buffer)
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_dead - bytes of records that were overwritten
+ *****************************************************************************/
+struct gsi_msg_store_segment
+{
+	unsigned int ui_number;
+	int i_fd;
+	unsigned long ul_size;
+	unsigned long ul_dead;
+};
+
+/*****************************************************************************
+ * Name : gsi_msg_store_slot
+ * Used by: struct gsi_msg_store, one slot per live (file, id)
+ * Members:
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_file - index of target file name
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_id - message id
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_segment - segment number of the latest record
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_data_len - length of message data
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_offset - offset of the record in the segment
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_prev, ui_next - Slots of the same file appended before /
+ *										after this one (+1, 0 means none)
+ *****************************************************************************/
+struct gsi_msg_store_slot
+{
+	unsigned int ui_file;
+	unsigned int ui_id;
+	unsigned int ui_segment;
+	unsigned int ui_data_len;
+	unsigned long ul_offset;
+	unsigned int ui_prev;
+	unsigned int ui_next;
+};
+
+/*****************************************************************************
+ * Name : gsi_msg_store_stats
+ * Used by: gsi_msg_store_get_stats()
+ * Members:
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_appends - records appended by the user
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_lookups, ul_hits - lookups and lookups that found a message
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_compactions - segments compacted and removed
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_records - live messages in index
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_segments - segment files
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_bytes, ul_dead_bytes - bytes in all segments, and overwritten bytes
+ *****************************************************************************/
+struct gsi_msg_store_stats
+{
+	unsigned long ul_appends;
+	unsigned long ul_lookups;
+	unsigned long ul_hits;
+	unsigned long ul_compactions;
+	unsigned long ul_records;
+	unsigned long ul_segments;
+	unsigned long ul_bytes;
+	unsigned long ul_dead_bytes;
+};
+
+/*****************************************************************************
+ * Name : gsi_msg_store
+ * Used by: GSI-MSG-STORE API functions
+ * Members:
+ *----------------------------------------------------------------------------
+ *		pthread_mutex_t lock - Mutex to lock the store
+ *----------------------------------------------------------------------------
+ *		pthread_cond_t wake - Wakes the background thread
+ *----------------------------------------------------------------------------
+ *		pthread_t compactor - Background thread (flush + compaction)
+ *----------------------------------------------------------------------------
+ *		int i_running - Background thread should keep running
+ *----------------------------------------------------------------------------
+ *		char s_dir[] - Store directory
+ *----------------------------------------------------------------------------
+ *		struct gsi_msg_store_segment* p_segments - Segments sorted by number,
+ *												   the last one is active
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_seg_count, ui_seg_cap - Used / allocated segments
+ *----------------------------------------------------------------------------
+ *		char* p_write_buf - Appends not yet written to the active segment
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_buf_len - Bytes in p_write_buf
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_buf_base - Offset in active segment of p_write_buf[0]
+ *----------------------------------------------------------------------------
+ *		struct gsi_msg_store_slot* p_slots - Live messages (count is stats.ul_records)
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_slots_cap - Allocated slots
+ *----------------------------------------------------------------------------
+ *		unsigned int* p_index - Hash table (file, id) -> slot (+1, 0 means empty)
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_index_cap - Entries in p_index (power of 2)
+ *----------------------------------------------------------------------------
+ *		char** pp_names, unsigned int* p_name_lens - Interned target file names
+ *----------------------------------------------------------------------------
+ *		unsigned int* p_first_slots, p_last_slots - Oldest / newest slot of each name (+1)
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_name_count, ui_name_cap - Used / allocated names
+ *----------------------------------------------------------------------------
+ *		unsigned int* p_name_table, ui_name_table_cap - Hash table name -> index (+1)
+ *----------------------------------------------------------------------------
+ *		struct gsi_msg_store_stats stats - Counters
+ *****************************************************************************/
+struct gsi_msg_store
+{
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_t compactor;
+	int i_running;
+	char s_dir[GSI_MS_MAX_PATH];
+
+	struct gsi_msg_store_segment* p_segments;
+	unsigned int ui_seg_count;
+	unsigned int ui_seg_cap;
+
+	char* p_write_buf;
+	unsigned long ul_buf_len;
+	unsigned long ul_buf_base;
+
+	struct gsi_msg_store_slot* p_slots;
+	unsigned long ul_slots_cap;
+	unsigned int* p_index;
+	unsigned long ul_index_cap;
+
+	char** pp_names;
+	unsigned int* p_name_lens;
+	unsigned int* p_first_slots;
+	unsigned int* p_last_slots;
+	unsigned int ui_name_count;
+	unsigned int ui_name_cap;
+	unsigned int* p_name_table;
+	unsigned int ui_name_table_cap;
+
+	struct gsi_msg_store_stats stats;
+};
+
+/*******************/
+/* API Declaration */
+/*******************/
+/*###########################################################################
+	 * Name:		gsi_msg_store_open
+	 * Description: Open (or create) a store in a directory, rebuild the index from
+	 * 				its segments and start the background thread.
+	 * 				A torn record at the end of the last segment is truncated.
+	 * 				Must use gsi_msg_store_close() before exit!
+	 * Parameter:   [in] const char* s_dir - store directory (created if missing)
+	 * Return:		Success - pointer to new store object
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_msg_store_t* gsi_msg_store_open(const char* s_dir);
+
+
+/*###########################################################################
+	 * Name:		gsi_msg_store_append
+	 * Description: Append a message. A later message with the same (file, id)
+	 * 				replaces the earlier one.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] const char* s_file_name - target file of the message
+	 * Parameter:   [in] unsigned int ui_id - message id
+	 * Parameter:   [in] const char* s_data - message data
+	 * Parameter:   [in] unsigned int ui_len - length of s_data
+	 * Return:		Success - GSI_MS_RC_SUCCESS
+	 * 				Failure - GSI_MS_RC_ERROR *OR* GSI_MS_RC_INVALID
+#############################################################################*/
+enum gsi_msg_store_rc gsi_msg_store_append(gsi_msg_store_t* p_store,
+										   const char* s_file_name,
+										   unsigned int ui_id,
+										   const char* s_data,
+										   unsigned int ui_len);
+
+
+/*###########################################################################
+	 * Name:		gsi_msg_store_get
+	 * Description: Get the latest message with id of a target file.
+	 * 				Note! this function will allocate memory for the data (terminated by '\0')
+	 * 				The user is responsible to free it after use.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] const char* s_file_name - target file of the message
+	 * Parameter:   [in] unsigned int ui_id - message id
+	 * Parameter:   [out] char** ps_data - message data
+	 * Parameter:   [out] unsigned int* pui_len - length of message data
+	 * Return:		Success - GSI_MS_RC_SUCCESS
+	 * 				Failure - GSI_MS_RC_NOT_FOUND *OR* GSI_MS_RC_ERROR *OR* GSI_MS_RC_INVALID
+#############################################################################*/
+enum gsi_msg_store_rc gsi_msg_store_get(gsi_msg_store_t* p_store,
+										const char* s_file_name,
+										unsigned int ui_id,
+										char** ps_data,
+										unsigned int* pui_len);
+
+
+/*###########################################################################
+	 * Name:		gsi_msg_store_export
+	 * Description: Write the live messages of a target file as text lines
+	 * 				"<id> <data>", in the order they were appended.
+	 * 				Only the records of this file are read, up to ul_max_msgs of them.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] const char* s_file_name - target file to export
+	 * Parameter:   [in] unsigned long ul_max_msgs - max messages to write (0 - all)
+	 * Parameter:   [in] FILE* f_out - opened file to write into
+	 * Return:		Success - GSI_MS_RC_SUCCESS
+	 * 				Failure - GSI_MS_RC_ERROR *OR* GSI_MS_RC_INVALID
+#############################################################################*/
+enum gsi_msg_store_rc gsi_msg_store_export(gsi_msg_store_t* p_store, const char* s_file_name,
+										   unsigned long ul_max_msgs, FILE* f_out);
+
+
+/*###########################################################################
+	 * Name:		gsi_msg_store_export_all
+	 * Description: Export every target file into the store directory as
+	 * 				"<dir>/export-<target file with '/' replaced by '_'>"
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Return:		Success - GSI_MS_RC_SUCCESS
+	 * 				Failure - GSI_MS_RC_ERROR *OR* GSI_MS_RC_INVALID
+#############################################################################*/
+enum gsi_msg_store_rc gsi_msg_store_export_all(gsi_msg_store_t* p_store);
+
+
+/*###########################################################################
+	 * Name:		gsi_msg_store_get_stats
+	 * Description: Take a snapshot of the store counters
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [out] struct gsi_msg_store_stats* p_stats - buffer to fill
+	 * Return:		Success - GSI_MS_RC_SUCCESS
+	 * 				Failure - GSI_MS_RC_INVALID
+#############################################################################*/
+enum gsi_msg_store_rc gsi_msg_store_get_stats(gsi_msg_store_t* p_store, struct gsi_msg_store_stats* p_stats);
+
+
+/*###########################################################################
+	 * Name:		gsi_msg_store_close
+	 * Description: Stop the background thread, flush and sync the active segment
+	 * 				and free the store.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store to close
+	 * Return:		Success - GSI_MS_RC_SUCCESS
+	 * 				Failure - GSI_MS_RC_ERROR *OR* GSI_MS_RC_INVALID
+#############################################################################*/
+enum gsi_msg_store_rc gsi_msg_store_close(gsi_msg_store_t* p_store);
+
+
+#endif /* GSI_MSG_STORE_H_ */
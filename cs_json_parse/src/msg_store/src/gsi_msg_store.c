@@ -0,0 +1,1552 @@
+/**************************************************************************
+* Name : gsi_msg_store.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Implementation of "gsi_msg_store.h"
+* 				Every use of gsi_msg_store_open() must also use gsi_msg_store_close() !
+*****************************************************************************/
+
+/* Includes */
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "gsi_msg_store.h"
+#include "gsi_is_log_api.h"
+
+/* Defines and Macros */
+#define 	GSI_MS_TRUE					1
+#define 	GSI_MS_FALSE				0
+#define 	GSI_MS_HDR_SIZE				(sizeof(struct gsi_msg_store_record_hdr))
+#define 	GSI_MS_SEGMENT_FMT			"segment-%08u.log"
+#define 	GSI_MS_INDEX_INIT_CAP		1024				/* power of 2 */
+#define 	GSI_MS_NAMES_INIT_CAP		16					/* power of 2 */
+#define 	GSI_MS_SEGMENTS_INIT_CAP	8
+#define 	GSI_MS_MAX_NAME_LEN			0xFFFF
+
+/********************************/
+/* Static functions declaration */
+/********************************/
+static uint32_t msg_store_crc32(uint32_t ui_crc, const void* p_buf, size_t ul_len);
+static uint32_t msg_store_record_crc(const struct gsi_msg_store_record_hdr* p_hdr, const char* p_name, const char* p_data);
+static unsigned int msg_store_name_hash(const char* s_name, unsigned int ui_len);
+static inline unsigned long msg_store_index_hash(gsi_msg_store_t* p_store, unsigned int ui_file, unsigned int ui_id);
+static int msg_store_name_find(gsi_msg_store_t* p_store, const char* s_name, unsigned int ui_len);
+static int msg_store_name_intern(gsi_msg_store_t* p_store, const char* s_name, unsigned int ui_len);
+static struct gsi_msg_store_slot* msg_store_index_find(gsi_msg_store_t* p_store, unsigned int ui_file, unsigned int ui_id);
+static int msg_store_index_put(gsi_msg_store_t* p_store, unsigned int ui_file, unsigned int ui_id,
+							   unsigned int ui_segment, unsigned long ul_offset, unsigned int ui_data_len);
+static void msg_store_slot_unlink(gsi_msg_store_t* p_store, struct gsi_msg_store_slot* p_slot);
+static void msg_store_slot_link_last(gsi_msg_store_t* p_store, struct gsi_msg_store_slot* p_slot);
+static struct gsi_msg_store_segment* msg_store_segment_find(gsi_msg_store_t* p_store, unsigned int ui_number);
+static struct gsi_msg_store_segment* msg_store_segment_add(gsi_msg_store_t* p_store, unsigned int ui_number);
+static void msg_store_segment_path(gsi_msg_store_t* p_store, unsigned int ui_number, char* s_path);
+static int msg_store_flush(gsi_msg_store_t* p_store);
+static int msg_store_append_locked(gsi_msg_store_t* p_store, int i_file, unsigned int ui_id,
+								   const char* s_data, unsigned int ui_len);
+static int msg_store_recover(gsi_msg_store_t* p_store);
+static int msg_store_recover_segment(gsi_msg_store_t* p_store, struct gsi_msg_store_segment* p_segment, int i_is_last);
+static void msg_store_compact_segment(gsi_msg_store_t* p_store, unsigned int ui_number);
+static void* msg_store_background_thread(void* p_args);
+static int msg_store_cmp_uint(const void* p_a, const void* p_b);
+static void msg_store_free(gsi_msg_store_t* p_store);
+
+/**********************/
+/* API implementation */
+/**********************/
+/*###########################################################################
+	 * Name:		gsi_msg_store_open
+	 * Description: Open (or create) a store in a directory, rebuild the index from
+	 * 				its segments and start the background thread.
+	 * 				A torn record at the end of the last segment is truncated.
+	 * 				Must use gsi_msg_store_close() before exit!
+	 * Parameter:   [in] const char* s_dir - store directory (created if missing)
+	 * Return:		Success - pointer to new store object
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_msg_store_t* gsi_msg_store_open(const char* s_dir)
+{
+	gsi_msg_store_t* p_store = NULL;
+
+	// Check input validation
+	if ((NULL == s_dir) || ('\0' == *s_dir) || (GSI_MS_MAX_PATH - 32 <= strlen(s_dir)))
+	{
+		LOG_ERROR("invalid store directory");
+		return NULL;
+	}
+
+	// Create the directory if needed
+	if ((0 != mkdir(s_dir, 0755)) && (EEXIST != errno))
+	{
+		LOG_ERROR("couldn't create store directory %s (errno %d)", s_dir, errno);
+		return NULL;
+	}
+
+	// Allocate new store
+	p_store = (gsi_msg_store_t*)calloc(1, sizeof(gsi_msg_store_t));
+	if (NULL == p_store)
+	{
+		LOG_ERROR("memory allocation for message store failed");
+		return NULL;
+	}
+
+	strcpy(p_store->s_dir, s_dir);
+
+	p_store->p_write_buf = (char*)malloc(GSI_MS_WRITE_BUF_SIZE);
+	p_store->ul_index_cap = GSI_MS_INDEX_INIT_CAP;
+	p_store->p_index = (unsigned int*)calloc(p_store->ul_index_cap, sizeof(unsigned int));
+	p_store->ui_name_table_cap = GSI_MS_NAMES_INIT_CAP;
+	p_store->p_name_table = (unsigned int*)calloc(p_store->ui_name_table_cap, sizeof(unsigned int));
+	if ((NULL == p_store->p_write_buf) || (NULL == p_store->p_index) || (NULL == p_store->p_name_table))
+	{
+		LOG_ERROR("memory allocation for message store failed");
+		msg_store_free(p_store);
+		return NULL;
+	}
+
+	// Init the mutex
+	if (0 != pthread_mutex_init(&(p_store->lock), NULL))
+	{
+		msg_store_free(p_store);
+		return NULL;
+	}
+
+	// Init the condition variable
+	if (0 != pthread_cond_init(&(p_store->wake), NULL))
+	{
+		pthread_mutex_destroy(&(p_store->lock));
+		msg_store_free(p_store);
+		return NULL;
+	}
+
+	// Rebuild the index from the segments on disk
+	if (GSI_MS_TRUE != msg_store_recover(p_store))
+	{
+		pthread_cond_destroy(&(p_store->wake));
+		pthread_mutex_destroy(&(p_store->lock));
+		msg_store_free(p_store);
+		return NULL;
+	}
+
+	// Start background flush and compaction
+	p_store->i_running = GSI_MS_TRUE;
+	if (0 != pthread_create(&(p_store->compactor), NULL, msg_store_background_thread, p_store))
+	{
+		LOG_ERROR("couldn't start message store thread");
+		pthread_cond_destroy(&(p_store->wake));
+		pthread_mutex_destroy(&(p_store->lock));
+		msg_store_free(p_store);
+		return NULL;
+	}
+
+	LOG_INFO("message store %s opened: %lu records in %lu segments",
+			 s_dir, p_store->stats.ul_records, p_store->stats.ul_segments);
+	return p_store;
+}
+
+/*###########################################################################
+	 * Name:		gsi_msg_store_append
+	 * Description: Append a message. A later message with the same (file, id)
+	 * 				replaces the earlier one.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] const char* s_file_name - target file of the message
+	 * Parameter:   [in] unsigned int ui_id - message id
+	 * Parameter:   [in] const char* s_data - message data
+	 * Parameter:   [in] unsigned int ui_len - length of s_data
+	 * Return:		Success - GSI_MS_RC_SUCCESS
+	 * 				Failure - GSI_MS_RC_ERROR *OR* GSI_MS_RC_INVALID
+#############################################################################*/
+enum gsi_msg_store_rc gsi_msg_store_append(gsi_msg_store_t* p_store,
+										   const char* s_file_name,
+										   unsigned int ui_id,
+										   const char* s_data,
+										   unsigned int ui_len)
+{
+	int i_file = -1;
+	int i_rc = GSI_MS_FALSE;
+	size_t ul_name_len = 0;
+
+	// Check input validation
+	if ((NULL == p_store) || (NULL == s_file_name) || ((NULL == s_data) && (0 != ui_len)))
+	{
+		return GSI_MS_RC_INVALID;
+	}
+
+	ul_name_len = strlen(s_file_name);
+	if ((0 == ul_name_len) || (GSI_MS_MAX_NAME_LEN < ul_name_len) ||
+		(GSI_MS_SEGMENT_MAX_BYTES < GSI_MS_HDR_SIZE + ul_name_len + ui_len))
+	{
+		return GSI_MS_RC_INVALID;
+	}
+
+	pthread_mutex_lock(&(p_store->lock));
+
+	i_file = msg_store_name_intern(p_store, s_file_name, (unsigned int)ul_name_len);
+	if (0 <= i_file)
+	{
+		i_rc = msg_store_append_locked(p_store, i_file, ui_id, s_data, ui_len);
+	}
+
+	if (GSI_MS_TRUE == i_rc)
+	{
+		p_store->stats.ul_appends++;
+	}
+
+	pthread_mutex_unlock(&(p_store->lock));
+
+	return (GSI_MS_TRUE == i_rc) ? GSI_MS_RC_SUCCESS : GSI_MS_RC_ERROR;
+}
+
+/*###########################################################################
+	 * Name:		gsi_msg_store_get
+	 * Description: Get the latest message with id of a target file.
+	 * 				The data is copied from the write buffer if it was not flushed yet,
+	 * 				otherwise it is read by one pread() from its segment.
+	 * 				Note! this function will allocate memory for the data (terminated by '\0')
+	 * 				The user is responsible to free it after use.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] const char* s_file_name - target file of the message
+	 * Parameter:   [in] unsigned int ui_id - message id
+	 * Parameter:   [out] char** ps_data - message data
+	 * Parameter:   [out] unsigned int* pui_len - length of message data
+	 * Return:		Success - GSI_MS_RC_SUCCESS
+	 * 				Failure - GSI_MS_RC_NOT_FOUND *OR* GSI_MS_RC_ERROR *OR* GSI_MS_RC_INVALID
+#############################################################################*/
+enum gsi_msg_store_rc gsi_msg_store_get(gsi_msg_store_t* p_store,
+										const char* s_file_name,
+										unsigned int ui_id,
+										char** ps_data,
+										unsigned int* pui_len)
+{
+	int i_file = -1;
+	char* p_data = NULL;
+	unsigned long ul_data_off = 0;
+	struct gsi_msg_store_slot* p_slot = NULL;
+	struct gsi_msg_store_segment* p_segment = NULL;
+	struct gsi_msg_store_segment* p_active = NULL;
+	enum gsi_msg_store_rc e_rc = GSI_MS_RC_SUCCESS;
+
+	// Check input validation
+	if ((NULL == p_store) || (NULL == s_file_name) || (NULL == ps_data) || (NULL == pui_len))
+	{
+		return GSI_MS_RC_INVALID;
+	}
+
+	pthread_mutex_lock(&(p_store->lock));
+
+	p_store->stats.ul_lookups++;
+
+	// Find the location of the latest record
+	i_file = msg_store_name_find(p_store, s_file_name, (unsigned int)strlen(s_file_name));
+	p_slot = (0 > i_file) ? NULL : msg_store_index_find(p_store, (unsigned int)i_file, ui_id);
+	p_segment = (NULL == p_slot) ? NULL : msg_store_segment_find(p_store, p_slot->ui_segment);
+	if (NULL == p_segment)
+	{
+		pthread_mutex_unlock(&(p_store->lock));
+		return GSI_MS_RC_NOT_FOUND;
+	}
+
+	p_data = (char*)malloc(p_slot->ui_data_len + 1);
+	if (NULL == p_data)
+	{
+		pthread_mutex_unlock(&(p_store->lock));
+		return GSI_MS_RC_ERROR;
+	}
+
+	ul_data_off = p_slot->ul_offset + GSI_MS_HDR_SIZE + p_store->p_name_lens[i_file];
+	p_active = &(p_store->p_segments[p_store->ui_seg_count - 1]);
+
+	// Read from the write buffer or from the segment file
+	if ((p_segment == p_active) && (ul_data_off >= p_store->ul_buf_base))
+	{
+		memcpy(p_data, p_store->p_write_buf + (ul_data_off - p_store->ul_buf_base), p_slot->ui_data_len);
+	}
+	else if ((ssize_t)p_slot->ui_data_len != pread(p_segment->i_fd, p_data, p_slot->ui_data_len, (off_t)ul_data_off))
+	{
+		LOG_ERROR("couldn't read record of id %u from segment %u", ui_id, p_segment->ui_number);
+		e_rc = GSI_MS_RC_ERROR;
+	}
+
+	if (GSI_MS_RC_SUCCESS == e_rc)
+	{
+		p_data[p_slot->ui_data_len] = '\0';
+		*pui_len = p_slot->ui_data_len;
+		*ps_data = p_data;
+		p_store->stats.ul_hits++;
+	}
+	else
+	{
+		free(p_data);
+	}
+
+	pthread_mutex_unlock(&(p_store->lock));
+
+	return e_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_msg_store_export
+	 * Description: Write the live messages of a target file as text lines
+	 * 				"<id> <data>", in the order they were appended.
+	 * 				The slots list of the file is followed, so only its own records
+	 * 				are read (from the write buffer, or by pread() from the segment).
+	 * 				The store is locked for the whole export.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] const char* s_file_name - target file to export
+	 * Parameter:   [in] unsigned long ul_max_msgs - max messages to write (0 - all)
+	 * Parameter:   [in] FILE* f_out - opened file to write into
+	 * Return:		Success - GSI_MS_RC_SUCCESS
+	 * 				Failure - GSI_MS_RC_ERROR *OR* GSI_MS_RC_INVALID
+#############################################################################*/
+enum gsi_msg_store_rc gsi_msg_store_export(gsi_msg_store_t* p_store, const char* s_file_name,
+										   unsigned long ul_max_msgs, FILE* f_out)
+{
+	int i_file = -1;
+	unsigned int ui_slot = 0;
+	unsigned int ui_buf_cap = 0;
+	unsigned long ul_count = 0;
+	unsigned long ul_data_off = 0;
+	char* p_buf = NULL;
+	char* p_new = NULL;
+	const char* p_data = NULL;
+	struct gsi_msg_store_slot* p_slot = NULL;
+	struct gsi_msg_store_segment* p_segment = NULL;
+	struct gsi_msg_store_segment* p_active = NULL;
+	enum gsi_msg_store_rc e_rc = GSI_MS_RC_SUCCESS;
+
+	// Check input validation
+	if ((NULL == p_store) || (NULL == s_file_name) || (NULL == f_out))
+	{
+		return GSI_MS_RC_INVALID;
+	}
+
+	pthread_mutex_lock(&(p_store->lock));
+
+	// No message of this file - nothing to read
+	i_file = msg_store_name_find(p_store, s_file_name, (unsigned int)strlen(s_file_name));
+	ui_slot = (0 > i_file) ? 0 : p_store->p_first_slots[i_file];
+	p_active = &(p_store->p_segments[p_store->ui_seg_count - 1]);
+
+	// Walk the slots of the file from the oldest one
+	for ( ; (0 != ui_slot) && ((0 == ul_max_msgs) || (ul_count < ul_max_msgs)); ui_slot = p_slot->ui_next)
+	{
+		p_slot = &(p_store->p_slots[ui_slot - 1]);
+		p_segment = msg_store_segment_find(p_store, p_slot->ui_segment);
+		if (NULL == p_segment)
+		{
+			e_rc = GSI_MS_RC_ERROR;
+			break;
+		}
+
+		ul_data_off = p_slot->ul_offset + GSI_MS_HDR_SIZE + p_store->p_name_lens[i_file];
+
+		// Read from the write buffer or from the segment file
+		if ((p_segment == p_active) && (ul_data_off >= p_store->ul_buf_base))
+		{
+			p_data = p_store->p_write_buf + (ul_data_off - p_store->ul_buf_base);
+		}
+		else
+		{
+			if (ui_buf_cap < p_slot->ui_data_len)
+			{
+				p_new = (char*)realloc(p_buf, p_slot->ui_data_len);
+				if (NULL == p_new)
+				{
+					e_rc = GSI_MS_RC_ERROR;
+					break;
+				}
+				p_buf = p_new;
+				ui_buf_cap = p_slot->ui_data_len;
+			}
+
+			if ((ssize_t)p_slot->ui_data_len != pread(p_segment->i_fd, p_buf, p_slot->ui_data_len, (off_t)ul_data_off))
+			{
+				LOG_ERROR("couldn't read record of id %u from segment %u for export", p_slot->ui_id, p_segment->ui_number);
+				e_rc = GSI_MS_RC_ERROR;
+				break;
+			}
+			p_data = p_buf;
+		}
+
+		fprintf(f_out, "%u %.*s", p_slot->ui_id, (int)p_slot->ui_data_len, p_data);
+		ul_count++;
+	}
+
+	pthread_mutex_unlock(&(p_store->lock));
+
+	free(p_buf);
+
+	return e_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_msg_store_export_all
+	 * Description: Export every target file into the store directory as
+	 * 				"<dir>/export-<target file with '/' replaced by '_'>"
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Return:		Success - GSI_MS_RC_SUCCESS
+	 * 				Failure - GSI_MS_RC_ERROR *OR* GSI_MS_RC_INVALID
+#############################################################################*/
+enum gsi_msg_store_rc gsi_msg_store_export_all(gsi_msg_store_t* p_store)
+{
+	unsigned int ui = 0;
+	unsigned int ui_count = 0;
+	char* p_c = NULL;
+	char* s_name = NULL;
+	FILE* f_out = NULL;
+	char s_path[GSI_MS_MAX_PATH * 2] = {0};
+	enum gsi_msg_store_rc e_rc = GSI_MS_RC_SUCCESS;
+
+	// Check input validation
+	if (NULL == p_store)
+	{
+		return GSI_MS_RC_INVALID;
+	}
+
+	// Names are only added, never removed - the count is enough to iterate safely
+	pthread_mutex_lock(&(p_store->lock));
+	ui_count = p_store->ui_name_count;
+	pthread_mutex_unlock(&(p_store->lock));
+
+	for (ui = 0; ui < ui_count; ++ui)
+	{
+		pthread_mutex_lock(&(p_store->lock));
+		s_name = p_store->pp_names[ui];
+		pthread_mutex_unlock(&(p_store->lock));
+
+		snprintf(s_path, sizeof(s_path), "%s/export-%s", p_store->s_dir, s_name);
+		for (p_c = s_path + strlen(p_store->s_dir) + 1; '\0' != *p_c; ++p_c)
+		{
+			if ('/' == *p_c)
+			{
+				*p_c = '_';
+			}
+		}
+
+		f_out = fopen(s_path, "w");
+		if (NULL == f_out)
+		{
+			LOG_ERROR("couldn't open export file %s", s_path);
+			e_rc = GSI_MS_RC_ERROR;
+			continue;
+		}
+
+		if (GSI_MS_RC_SUCCESS != gsi_msg_store_export(p_store, s_name, 0, f_out))
+		{
+			e_rc = GSI_MS_RC_ERROR;
+		}
+
+		fclose(f_out);
+	}
+
+	return e_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_msg_store_get_stats
+	 * Description: Take a snapshot of the store counters
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [out] struct gsi_msg_store_stats* p_stats - buffer to fill
+	 * Return:		Success - GSI_MS_RC_SUCCESS
+	 * 				Failure - GSI_MS_RC_INVALID
+#############################################################################*/
+enum gsi_msg_store_rc gsi_msg_store_get_stats(gsi_msg_store_t* p_store, struct gsi_msg_store_stats* p_stats)
+{
+	unsigned int ui = 0;
+
+	// Check input validation
+	if ((NULL == p_store) || (NULL == p_stats))
+	{
+		return GSI_MS_RC_INVALID;
+	}
+
+	pthread_mutex_lock(&(p_store->lock));
+
+	p_store->stats.ul_segments = p_store->ui_seg_count;
+	p_store->stats.ul_bytes = 0;
+	p_store->stats.ul_dead_bytes = 0;
+	for (ui = 0; ui < p_store->ui_seg_count; ++ui)
+	{
+		p_store->stats.ul_bytes += p_store->p_segments[ui].ul_size;
+		p_store->stats.ul_dead_bytes += p_store->p_segments[ui].ul_dead;
+	}
+	*p_stats = p_store->stats;
+
+	pthread_mutex_unlock(&(p_store->lock));
+
+	return GSI_MS_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_msg_store_close
+	 * Description: Stop the background thread, flush and sync the active segment
+	 * 				and free the store.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store to close
+	 * Return:		Success - GSI_MS_RC_SUCCESS
+	 * 				Failure - GSI_MS_RC_ERROR *OR* GSI_MS_RC_INVALID
+#############################################################################*/
+enum gsi_msg_store_rc gsi_msg_store_close(gsi_msg_store_t* p_store)
+{
+	enum gsi_msg_store_rc e_rc = GSI_MS_RC_SUCCESS;
+
+	// Check input validation
+	if (NULL == p_store)
+	{
+		return GSI_MS_RC_INVALID;
+	}
+
+	// Stop the background thread
+	pthread_mutex_lock(&(p_store->lock));
+	p_store->i_running = GSI_MS_FALSE;
+	pthread_cond_signal(&(p_store->wake));
+	pthread_mutex_unlock(&(p_store->lock));
+
+	pthread_join(p_store->compactor, NULL);
+
+	// Write what's left and make it durable
+	if (GSI_MS_TRUE != msg_store_flush(p_store))
+	{
+		e_rc = GSI_MS_RC_ERROR;
+	}
+	else if ((0 < p_store->ui_seg_count) && (0 != fdatasync(p_store->p_segments[p_store->ui_seg_count - 1].i_fd)))
+	{
+		LOG_ERROR("couldn't sync active segment");
+		e_rc = GSI_MS_RC_ERROR;
+	}
+
+	pthread_cond_destroy(&(p_store->wake));
+	pthread_mutex_destroy(&(p_store->lock));
+	msg_store_free(p_store);
+
+	return e_rc;
+}
+
+/************************************/
+/* Static functions implementation  */
+/************************************/
+/*###########################################################################
+	 * Name:		msg_store_crc32
+	 * Description: CRC-32 (IEEE, reflected) of a buffer, bitwise with a nibble table
+	 * Parameter:   [in] uint32_t ui_crc - CRC of previous buffers (0 at start)
+	 * Parameter:   [in] const void* p_buf - buffer
+	 * Parameter:   [in] size_t ul_len - length of buffer
+	 * Return:		CRC value
+#############################################################################*/
+static uint32_t msg_store_crc32(uint32_t ui_crc, const void* p_buf, size_t ul_len)
+{
+	static const uint32_t a_table[16] = {
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+	};
+	const unsigned char* p_byte = (const unsigned char*)p_buf;
+
+	ui_crc = ~ui_crc;
+	while (0 < ul_len--)
+	{
+		ui_crc ^= *p_byte++;
+		ui_crc = (ui_crc >> 4) ^ a_table[ui_crc & 0x0F];
+		ui_crc = (ui_crc >> 4) ^ a_table[ui_crc & 0x0F];
+	}
+
+	return ~ui_crc;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_record_crc
+	 * Description: CRC of a record - header after the crc member, name and data
+	 * Parameter:   [in] const struct gsi_msg_store_record_hdr* p_hdr - record header
+	 * Parameter:   [in] const char* p_name - target file name (us_name_len bytes)
+	 * Parameter:   [in] const char* p_data - message data (ui_data_len bytes)
+	 * Return:		CRC value
+#############################################################################*/
+static uint32_t msg_store_record_crc(const struct gsi_msg_store_record_hdr* p_hdr, const char* p_name, const char* p_data)
+{
+	uint32_t ui_crc = 0;
+
+	ui_crc = msg_store_crc32(ui_crc, &(p_hdr->ui_id), GSI_MS_HDR_SIZE - offsetof(struct gsi_msg_store_record_hdr, ui_id));
+	ui_crc = msg_store_crc32(ui_crc, p_name, p_hdr->us_name_len);
+	ui_crc = msg_store_crc32(ui_crc, p_data, p_hdr->ui_data_len);
+
+	return ui_crc;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_name_hash
+	 * Description: FNV-1a hash of a target file name
+	 * Parameter:   [in] const char* s_name - name
+	 * Parameter:   [in] unsigned int ui_len - length of name
+	 * Return:		hash value
+#############################################################################*/
+static unsigned int msg_store_name_hash(const char* s_name, unsigned int ui_len)
+{
+	unsigned int ui_hash = 2166136261u;
+	unsigned int ui = 0;
+
+	for (ui = 0; ui < ui_len; ++ui)
+	{
+		ui_hash ^= (unsigned char)s_name[ui];
+		ui_hash *= 16777619u;
+	}
+
+	return ui_hash;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_name_find
+	 * Description: Find index of an interned name. Store must be locked.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] const char* s_name - name
+	 * Parameter:   [in] unsigned int ui_len - length of name
+	 * Return:		index of name, -1 if not found
+#############################################################################*/
+static int msg_store_name_find(gsi_msg_store_t* p_store, const char* s_name, unsigned int ui_len)
+{
+	unsigned int ui_mask = p_store->ui_name_table_cap - 1;
+	unsigned int ui_pos = msg_store_name_hash(s_name, ui_len) & ui_mask;
+	unsigned int ui_name = 0;
+
+	// Linear probing until an empty slot
+	while (0 != (ui_name = p_store->p_name_table[ui_pos]))
+	{
+		if ((p_store->p_name_lens[ui_name - 1] == ui_len) &&
+			(0 == memcmp(p_store->pp_names[ui_name - 1], s_name, ui_len)))
+		{
+			return (int)(ui_name - 1);
+		}
+		ui_pos = (ui_pos + 1) & ui_mask;
+	}
+
+	return -1;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_name_intern
+	 * Description: Find index of a name, add it if it is new. Store must be locked.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] const char* s_name - name
+	 * Parameter:   [in] unsigned int ui_len - length of name
+	 * Return:		index of name, -1 on memory failure
+#############################################################################*/
+static int msg_store_name_intern(gsi_msg_store_t* p_store, const char* s_name, unsigned int ui_len)
+{
+	int i_name = msg_store_name_find(p_store, s_name, ui_len);
+	unsigned int ui = 0;
+	unsigned int ui_pos = 0;
+	unsigned int ui_new_cap = 0;
+	unsigned int* p_table = NULL;
+	char* s_copy = NULL;
+	void* p_new = NULL;
+
+	if (0 <= i_name)
+	{
+		return i_name;
+	}
+
+	// Grow the names array
+	if (p_store->ui_name_count == p_store->ui_name_cap)
+	{
+		ui_new_cap = (0 == p_store->ui_name_cap) ? GSI_MS_NAMES_INIT_CAP : p_store->ui_name_cap * 2;
+		p_new = realloc(p_store->pp_names, ui_new_cap * sizeof(char*));
+		if (NULL == p_new)
+		{
+			return -1;
+		}
+		p_store->pp_names = (char**)p_new;
+
+		p_new = realloc(p_store->p_name_lens, ui_new_cap * sizeof(unsigned int));
+		if (NULL == p_new)
+		{
+			return -1;
+		}
+		p_store->p_name_lens = (unsigned int*)p_new;
+
+		p_new = realloc(p_store->p_first_slots, ui_new_cap * sizeof(unsigned int));
+		if (NULL == p_new)
+		{
+			return -1;
+		}
+		p_store->p_first_slots = (unsigned int*)p_new;
+
+		p_new = realloc(p_store->p_last_slots, ui_new_cap * sizeof(unsigned int));
+		if (NULL == p_new)
+		{
+			return -1;
+		}
+		p_store->p_last_slots = (unsigned int*)p_new;
+		p_store->ui_name_cap = ui_new_cap;
+	}
+
+	// Keep the hash table at most half full
+	if (p_store->ui_name_table_cap <= (p_store->ui_name_count + 1) * 2)
+	{
+		ui_new_cap = p_store->ui_name_table_cap * 2;
+		p_table = (unsigned int*)calloc(ui_new_cap, sizeof(unsigned int));
+		if (NULL == p_table)
+		{
+			return -1;
+		}
+
+		for (ui = 0; ui < p_store->ui_name_count; ++ui)
+		{
+			ui_pos = msg_store_name_hash(p_store->pp_names[ui], p_store->p_name_lens[ui]) & (ui_new_cap - 1);
+			while (0 != p_table[ui_pos])
+			{
+				ui_pos = (ui_pos + 1) & (ui_new_cap - 1);
+			}
+			p_table[ui_pos] = ui + 1;
+		}
+
+		free(p_store->p_name_table);
+		p_store->p_name_table = p_table;
+		p_store->ui_name_table_cap = ui_new_cap;
+	}
+
+	s_copy = (char*)malloc(ui_len + 1);
+	if (NULL == s_copy)
+	{
+		return -1;
+	}
+	memcpy(s_copy, s_name, ui_len);
+	s_copy[ui_len] = '\0';
+
+	// Add the new name
+	i_name = (int)p_store->ui_name_count++;
+	p_store->pp_names[i_name] = s_copy;
+	p_store->p_name_lens[i_name] = ui_len;
+	p_store->p_first_slots[i_name] = 0;
+	p_store->p_last_slots[i_name] = 0;
+
+	ui_pos = msg_store_name_hash(s_name, ui_len) & (p_store->ui_name_table_cap - 1);
+	while (0 != p_store->p_name_table[ui_pos])
+	{
+		ui_pos = (ui_pos + 1) & (p_store->ui_name_table_cap - 1);
+	}
+	p_store->p_name_table[ui_pos] = (unsigned int)i_name + 1;
+
+	return i_name;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_index_hash
+	 * Description: Position of (file, id) in the index. Store must be locked.
+#############################################################################*/
+static inline unsigned long msg_store_index_hash(gsi_msg_store_t* p_store, unsigned int ui_file, unsigned int ui_id)
+{
+	uint64_t ul_key = ((uint64_t)ui_file << 32) | ui_id;
+
+	ul_key *= 0x9E3779B97F4A7C15ull;
+	return (unsigned long)(ul_key >> 32) & (p_store->ul_index_cap - 1);
+}
+
+/*###########################################################################
+	 * Name:		msg_store_index_find
+	 * Description: Find the slot of (file, id). Store must be locked.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] unsigned int ui_file - index of target file name
+	 * Parameter:   [in] unsigned int ui_id - message id
+	 * Return:		slot, NULL if not found
+#############################################################################*/
+static struct gsi_msg_store_slot* msg_store_index_find(gsi_msg_store_t* p_store, unsigned int ui_file, unsigned int ui_id)
+{
+	unsigned long ul_pos = msg_store_index_hash(p_store, ui_file, ui_id);
+	struct gsi_msg_store_slot* p_slot = NULL;
+
+	// Linear probing until an empty entry
+	for ( ; 0 != p_store->p_index[ul_pos]; ul_pos = (ul_pos + 1) & (p_store->ul_index_cap - 1))
+	{
+		p_slot = &(p_store->p_slots[p_store->p_index[ul_pos] - 1]);
+		if ((p_slot->ui_file == ui_file) && (p_slot->ui_id == ui_id))
+		{
+			return p_slot;
+		}
+	}
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_index_put
+	 * Description: Point (file, id) to a new record and move its slot to the end of
+	 * 				the file's list. The previous record of the same (file, id), if
+	 * 				any, is counted as dead in its segment. Store must be locked.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] unsigned int ui_file - index of target file name
+	 * Parameter:   [in] unsigned int ui_id - message id
+	 * Parameter:   [in] unsigned int ui_segment - segment number of the record
+	 * Parameter:   [in] unsigned long ul_offset - offset of the record in segment
+	 * Parameter:   [in] unsigned int ui_data_len - length of message data
+	 * Return:		GSI_MS_TRUE on success, GSI_MS_FALSE on memory failure
+#############################################################################*/
+static int msg_store_index_put(gsi_msg_store_t* p_store, unsigned int ui_file, unsigned int ui_id,
+							   unsigned int ui_segment, unsigned long ul_offset, unsigned int ui_data_len)
+{
+	unsigned long ul = 0;
+	unsigned long ul_pos = 0;
+	unsigned long ul_new_cap = 0;
+	unsigned int* p_table = NULL;
+	struct gsi_msg_store_slot* p_new = NULL;
+	struct gsi_msg_store_slot* p_slot = msg_store_index_find(p_store, ui_file, ui_id);
+	struct gsi_msg_store_segment* p_segment = NULL;
+
+	// Replace - the old record is now dead
+	if (NULL != p_slot)
+	{
+		p_segment = msg_store_segment_find(p_store, p_slot->ui_segment);
+		if (NULL != p_segment)
+		{
+			p_segment->ul_dead += GSI_MS_HDR_SIZE + p_store->p_name_lens[ui_file] + p_slot->ui_data_len;
+		}
+		p_slot->ui_segment = ui_segment;
+		p_slot->ul_offset = ul_offset;
+		p_slot->ui_data_len = ui_data_len;
+
+		// The latest record is the newest one of the file
+		msg_store_slot_unlink(p_store, p_slot);
+		msg_store_slot_link_last(p_store, p_slot);
+		return GSI_MS_TRUE;
+	}
+
+	// Grow the slots array
+	if (p_store->stats.ul_records == p_store->ul_slots_cap)
+	{
+		ul_new_cap = (0 == p_store->ul_slots_cap) ? GSI_MS_INDEX_INIT_CAP : p_store->ul_slots_cap * 2;
+		p_new = (struct gsi_msg_store_slot*)realloc(p_store->p_slots, ul_new_cap * sizeof(struct gsi_msg_store_slot));
+		if (NULL == p_new)
+		{
+			return GSI_MS_FALSE;
+		}
+		p_store->p_slots = p_new;
+		p_store->ul_slots_cap = ul_new_cap;
+	}
+
+	// Keep the index at most 70% full
+	if (p_store->ul_index_cap * 7 <= (p_store->stats.ul_records + 1) * 10)
+	{
+		ul_new_cap = p_store->ul_index_cap * 2;
+		p_table = (unsigned int*)calloc(ul_new_cap, sizeof(unsigned int));
+		if (NULL == p_table)
+		{
+			return GSI_MS_FALSE;
+		}
+
+		free(p_store->p_index);
+		p_store->p_index = p_table;
+		p_store->ul_index_cap = ul_new_cap;
+
+		for (ul = 0; ul < p_store->stats.ul_records; ++ul)
+		{
+			ul_pos = msg_store_index_hash(p_store, p_store->p_slots[ul].ui_file, p_store->p_slots[ul].ui_id);
+			while (0 != p_store->p_index[ul_pos])
+			{
+				ul_pos = (ul_pos + 1) & (p_store->ul_index_cap - 1);
+			}
+			p_store->p_index[ul_pos] = (unsigned int)ul + 1;
+		}
+	}
+
+	// Insert into the first empty entry
+	ul_pos = msg_store_index_hash(p_store, ui_file, ui_id);
+	while (0 != p_store->p_index[ul_pos])
+	{
+		ul_pos = (ul_pos + 1) & (p_store->ul_index_cap - 1);
+	}
+
+	p_slot = &(p_store->p_slots[p_store->stats.ul_records]);
+	p_slot->ui_file = ui_file;
+	p_slot->ui_id = ui_id;
+	p_slot->ui_segment = ui_segment;
+	p_slot->ul_offset = ul_offset;
+	p_slot->ui_data_len = ui_data_len;
+	p_slot->ui_prev = 0;
+	p_slot->ui_next = 0;
+	p_store->stats.ul_records++;
+	p_store->p_index[ul_pos] = (unsigned int)p_store->stats.ul_records;
+
+	msg_store_slot_link_last(p_store, p_slot);
+
+	return GSI_MS_TRUE;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_slot_unlink
+	 * Description: Remove a slot from the list of its file. Store must be locked.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] struct gsi_msg_store_slot* p_slot - slot to remove
+#############################################################################*/
+static void msg_store_slot_unlink(gsi_msg_store_t* p_store, struct gsi_msg_store_slot* p_slot)
+{
+	if (0 == p_slot->ui_prev)
+	{
+		p_store->p_first_slots[p_slot->ui_file] = p_slot->ui_next;
+	}
+	else
+	{
+		p_store->p_slots[p_slot->ui_prev - 1].ui_next = p_slot->ui_next;
+	}
+
+	if (0 == p_slot->ui_next)
+	{
+		p_store->p_last_slots[p_slot->ui_file] = p_slot->ui_prev;
+	}
+	else
+	{
+		p_store->p_slots[p_slot->ui_next - 1].ui_prev = p_slot->ui_prev;
+	}
+
+	p_slot->ui_prev = 0;
+	p_slot->ui_next = 0;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_slot_link_last
+	 * Description: Add a slot (not in any list) at the end of the list of its file.
+	 * 				Store must be locked.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] struct gsi_msg_store_slot* p_slot - slot to add
+#############################################################################*/
+static void msg_store_slot_link_last(gsi_msg_store_t* p_store, struct gsi_msg_store_slot* p_slot)
+{
+	unsigned int ui_self = (unsigned int)(p_slot - p_store->p_slots) + 1;
+	unsigned int ui_last = p_store->p_last_slots[p_slot->ui_file];
+
+	p_slot->ui_prev = ui_last;
+	p_slot->ui_next = 0;
+
+	if (0 == ui_last)
+	{
+		p_store->p_first_slots[p_slot->ui_file] = ui_self;
+	}
+	else
+	{
+		p_store->p_slots[ui_last - 1].ui_next = ui_self;
+	}
+	p_store->p_last_slots[p_slot->ui_file] = ui_self;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_segment_find
+	 * Description: Binary search of a segment by number. Store must be locked.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] unsigned int ui_number - segment number
+	 * Return:		segment, NULL if not found
+#############################################################################*/
+static struct gsi_msg_store_segment* msg_store_segment_find(gsi_msg_store_t* p_store, unsigned int ui_number)
+{
+	unsigned int ui_low = 0;
+	unsigned int ui_high = p_store->ui_seg_count;
+	unsigned int ui_mid = 0;
+
+	while (ui_low < ui_high)
+	{
+		ui_mid = ui_low + (ui_high - ui_low) / 2;
+		if (p_store->p_segments[ui_mid].ui_number == ui_number)
+		{
+			return &(p_store->p_segments[ui_mid]);
+		}
+		else if (p_store->p_segments[ui_mid].ui_number < ui_number)
+		{
+			ui_low = ui_mid + 1;
+		}
+		else
+		{
+			ui_high = ui_mid;
+		}
+	}
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_segment_path
+	 * Description: Build the path of a segment file
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] unsigned int ui_number - segment number
+	 * Parameter:   [out] char* s_path - buffer of GSI_MS_MAX_PATH bytes
+#############################################################################*/
+static void msg_store_segment_path(gsi_msg_store_t* p_store, unsigned int ui_number, char* s_path)
+{
+	int i_len = snprintf(s_path, GSI_MS_MAX_PATH, "%s/", p_store->s_dir);
+
+	snprintf(s_path + i_len, GSI_MS_MAX_PATH - i_len, GSI_MS_SEGMENT_FMT, ui_number);
+}
+
+/*###########################################################################
+	 * Name:		msg_store_segment_add
+	 * Description: Open (create if missing) a segment file and add it at the end
+	 * 				of the segments array. Store must be locked.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] unsigned int ui_number - segment number, bigger than all others
+	 * Return:		the new segment, NULL on failure
+#############################################################################*/
+static struct gsi_msg_store_segment* msg_store_segment_add(gsi_msg_store_t* p_store, unsigned int ui_number)
+{
+	int i_fd = -1;
+	unsigned int ui_new_cap = 0;
+	char s_path[GSI_MS_MAX_PATH] = {0};
+	struct stat st;
+	struct gsi_msg_store_segment* p_new = NULL;
+
+	// Grow the segments array
+	if (p_store->ui_seg_count == p_store->ui_seg_cap)
+	{
+		ui_new_cap = (0 == p_store->ui_seg_cap) ? GSI_MS_SEGMENTS_INIT_CAP : p_store->ui_seg_cap * 2;
+		p_new = (struct gsi_msg_store_segment*)realloc(p_store->p_segments,
+													   ui_new_cap * sizeof(struct gsi_msg_store_segment));
+		if (NULL == p_new)
+		{
+			return NULL;
+		}
+		p_store->p_segments = p_new;
+		p_store->ui_seg_cap = ui_new_cap;
+	}
+
+	msg_store_segment_path(p_store, ui_number, s_path);
+
+	i_fd = open(s_path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if ((0 > i_fd) || (0 != fstat(i_fd, &st)))
+	{
+		LOG_ERROR("couldn't open segment %s (errno %d)", s_path, errno);
+		if (0 <= i_fd)
+		{
+			close(i_fd);
+		}
+		return NULL;
+	}
+
+	p_new = &(p_store->p_segments[p_store->ui_seg_count++]);
+	p_new->ui_number = ui_number;
+	p_new->i_fd = i_fd;
+	p_new->ul_size = (unsigned long)st.st_size;
+	p_new->ul_dead = 0;
+
+	return p_new;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_flush
+	 * Description: Write the write buffer to the active segment. Store must be
+	 * 				locked (or the background thread stopped).
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Return:		GSI_MS_TRUE on success, GSI_MS_FALSE on failure
+#############################################################################*/
+static int msg_store_flush(gsi_msg_store_t* p_store)
+{
+	ssize_t l_written = 0;
+	unsigned long ul_done = 0;
+	int i_fd = -1;
+
+	if (0 == p_store->ul_buf_len)
+	{
+		return GSI_MS_TRUE;
+	}
+
+	i_fd = p_store->p_segments[p_store->ui_seg_count - 1].i_fd;
+
+	// Write everything, retry on partial writes
+	while (ul_done < p_store->ul_buf_len)
+	{
+		l_written = write(i_fd, p_store->p_write_buf + ul_done, p_store->ul_buf_len - ul_done);
+		if (0 > l_written)
+		{
+			if (EINTR == errno)
+			{
+				continue;
+			}
+			LOG_ERROR("couldn't write to active segment (errno %d)", errno);
+
+			// Keep the unwritten part in the buffer
+			memmove(p_store->p_write_buf, p_store->p_write_buf + ul_done, p_store->ul_buf_len - ul_done);
+			p_store->ul_buf_len -= ul_done;
+			p_store->ul_buf_base += ul_done;
+			return GSI_MS_FALSE;
+		}
+		ul_done += (unsigned long)l_written;
+	}
+
+	p_store->ul_buf_base += p_store->ul_buf_len;
+	p_store->ul_buf_len = 0;
+
+	return GSI_MS_TRUE;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_append_locked
+	 * Description: Append a record to the active segment (through the write buffer)
+	 * 				and point the index to it. Rolls to a new segment when the active
+	 * 				one is full. Store must be locked.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] int i_file - index of target file name
+	 * Parameter:   [in] unsigned int ui_id - message id
+	 * Parameter:   [in] const char* s_data - message data
+	 * Parameter:   [in] unsigned int ui_len - length of s_data
+	 * Return:		GSI_MS_TRUE on success, GSI_MS_FALSE on failure
+#############################################################################*/
+static int msg_store_append_locked(gsi_msg_store_t* p_store, int i_file, unsigned int ui_id,
+								   const char* s_data, unsigned int ui_len)
+{
+	struct gsi_msg_store_record_hdr hdr;
+	struct gsi_msg_store_segment* p_active = &(p_store->p_segments[p_store->ui_seg_count - 1]);
+	const char* s_name = p_store->pp_names[i_file];
+	unsigned long ul_rec_len = GSI_MS_HDR_SIZE + p_store->p_name_lens[i_file] + ui_len;
+	unsigned long ul_offset = 0;
+	char* p_dst = NULL;
+
+	// Roll to a new segment, the current one becomes sealed (immutable)
+	if ((0 < p_active->ul_size) && (GSI_MS_SEGMENT_MAX_BYTES < p_active->ul_size + ul_rec_len))
+	{
+		if (GSI_MS_TRUE != msg_store_flush(p_store))
+		{
+			return GSI_MS_FALSE;
+		}
+		p_active = msg_store_segment_add(p_store, p_active->ui_number + 1);
+		if (NULL == p_active)
+		{
+			return GSI_MS_FALSE;
+		}
+		p_store->ul_buf_base = p_active->ul_size;
+	}
+
+	// Make room in the write buffer
+	if ((GSI_MS_WRITE_BUF_SIZE < p_store->ul_buf_len + ul_rec_len) && (GSI_MS_TRUE != msg_store_flush(p_store)))
+	{
+		return GSI_MS_FALSE;
+	}
+
+	// Build the record header
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.ui_magic = GSI_MS_RECORD_MAGIC;
+	hdr.ui_id = ui_id;
+	hdr.us_name_len = (uint16_t)p_store->p_name_lens[i_file];
+	hdr.ui_data_len = ui_len;
+	hdr.ui_crc = msg_store_record_crc(&hdr, s_name, s_data);
+
+	ul_offset = p_active->ul_size;
+
+	if (GSI_MS_WRITE_BUF_SIZE < ul_rec_len)
+	{
+		// Too big for the buffer (which is empty now) - write it directly
+		p_dst = (char*)malloc(ul_rec_len);
+		if (NULL == p_dst)
+		{
+			return GSI_MS_FALSE;
+		}
+		memcpy(p_dst, &hdr, GSI_MS_HDR_SIZE);
+		memcpy(p_dst + GSI_MS_HDR_SIZE, s_name, hdr.us_name_len);
+		memcpy(p_dst + GSI_MS_HDR_SIZE + hdr.us_name_len, s_data, ui_len);
+
+		if ((ssize_t)ul_rec_len != pwrite(p_active->i_fd, p_dst, ul_rec_len, (off_t)ul_offset))
+		{
+			LOG_ERROR("couldn't write record of id %u (errno %d)", ui_id, errno);
+			free(p_dst);
+			return GSI_MS_FALSE;
+		}
+		free(p_dst);
+		p_store->ul_buf_base += ul_rec_len;
+	}
+	else
+	{
+		p_dst = p_store->p_write_buf + p_store->ul_buf_len;
+		memcpy(p_dst, &hdr, GSI_MS_HDR_SIZE);
+		memcpy(p_dst + GSI_MS_HDR_SIZE, s_name, hdr.us_name_len);
+		memcpy(p_dst + GSI_MS_HDR_SIZE + hdr.us_name_len, s_data, ui_len);
+		p_store->ul_buf_len += ul_rec_len;
+	}
+
+	p_active->ul_size += ul_rec_len;
+
+	return msg_store_index_put(p_store, (unsigned int)i_file, ui_id, p_active->ui_number, ul_offset, ui_len);
+}
+
+/*###########################################################################
+	 * Name:		msg_store_cmp_uint
+	 * Description: qsort() compare of unsigned int
+#############################################################################*/
+static int msg_store_cmp_uint(const void* p_a, const void* p_b)
+{
+	unsigned int ui_a = *(const unsigned int*)p_a;
+	unsigned int ui_b = *(const unsigned int*)p_b;
+
+	return (ui_a > ui_b) - (ui_a < ui_b);
+}
+
+/*###########################################################################
+	 * Name:		msg_store_recover
+	 * Description: Open all segments of the store directory in order and rebuild
+	 * 				the index. Creates the first segment of an empty store.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Return:		GSI_MS_TRUE on success, GSI_MS_FALSE on failure
+#############################################################################*/
+static int msg_store_recover(gsi_msg_store_t* p_store)
+{
+	DIR* p_dir = NULL;
+	struct dirent* p_ent = NULL;
+	unsigned int* p_numbers = NULL;
+	unsigned int ui_count = 0;
+	unsigned int ui_cap = 0;
+	unsigned int ui_number = 0;
+	unsigned int ui = 0;
+	char c_extra = 0;
+	void* p_new = NULL;
+	struct gsi_msg_store_segment* p_segment = NULL;
+	int i_rc = GSI_MS_TRUE;
+
+	p_dir = opendir(p_store->s_dir);
+	if (NULL == p_dir)
+	{
+		LOG_ERROR("couldn't open store directory %s", p_store->s_dir);
+		return GSI_MS_FALSE;
+	}
+
+	// Collect the segment numbers
+	while (NULL != (p_ent = readdir(p_dir)))
+	{
+		if (2 != sscanf(p_ent->d_name, "segment-%8u.lo%c", &ui_number, &c_extra) || ('g' != c_extra))
+		{
+			continue;
+		}
+
+		if (ui_count == ui_cap)
+		{
+			ui_cap = (0 == ui_cap) ? GSI_MS_SEGMENTS_INIT_CAP : ui_cap * 2;
+			p_new = realloc(p_numbers, ui_cap * sizeof(unsigned int));
+			if (NULL == p_new)
+			{
+				free(p_numbers);
+				closedir(p_dir);
+				return GSI_MS_FALSE;
+			}
+			p_numbers = (unsigned int*)p_new;
+		}
+		p_numbers[ui_count++] = ui_number;
+	}
+	closedir(p_dir);
+
+	if (0 < ui_count)
+	{
+		qsort(p_numbers, ui_count, sizeof(unsigned int), msg_store_cmp_uint);
+	}
+
+	// Replay the segments, older records are replaced by newer ones
+	for (ui = 0; (ui < ui_count) && (GSI_MS_TRUE == i_rc); ++ui)
+	{
+		p_segment = msg_store_segment_add(p_store, p_numbers[ui]);
+		i_rc = (NULL == p_segment) ? GSI_MS_FALSE :
+				msg_store_recover_segment(p_store, p_segment, (ui + 1 == ui_count) ? GSI_MS_TRUE : GSI_MS_FALSE);
+	}
+	free(p_numbers);
+
+	if (GSI_MS_TRUE != i_rc)
+	{
+		return GSI_MS_FALSE;
+	}
+
+	// The active segment - last one, or a new one if it is full
+	if ((0 == p_store->ui_seg_count) ||
+		(GSI_MS_SEGMENT_MAX_BYTES <= p_store->p_segments[p_store->ui_seg_count - 1].ul_size))
+	{
+		ui_number = (0 == p_store->ui_seg_count) ? 0 : p_store->p_segments[p_store->ui_seg_count - 1].ui_number + 1;
+		if (NULL == msg_store_segment_add(p_store, ui_number))
+		{
+			return GSI_MS_FALSE;
+		}
+	}
+
+	p_store->ul_buf_base = p_store->p_segments[p_store->ui_seg_count - 1].ul_size;
+	p_store->ul_buf_len = 0;
+
+	return GSI_MS_TRUE;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_recover_segment
+	 * Description: Add the records of one segment to the index.
+	 * 				A broken record ends the scan: in the last segment it is a torn
+	 * 				write and the file is truncated, in other segments the rest is
+	 * 				counted as dead and will be dropped by compaction.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+	 * Parameter:   [in] struct gsi_msg_store_segment* p_segment - segment to scan
+	 * Parameter:   [in] int i_is_last - segment is the newest one
+	 * Return:		GSI_MS_TRUE on success, GSI_MS_FALSE on failure
+#############################################################################*/
+static int msg_store_recover_segment(gsi_msg_store_t* p_store, struct gsi_msg_store_segment* p_segment, int i_is_last)
+{
+	char* p_map = NULL;
+	const char* p_name = NULL;
+	const char* p_data = NULL;
+	struct gsi_msg_store_record_hdr hdr;
+	unsigned long ul_off = 0;
+	unsigned long ul_rec_len = 0;
+	int i_file = -1;
+
+	if (0 == p_segment->ul_size)
+	{
+		return GSI_MS_TRUE;
+	}
+
+	p_map = (char*)mmap(NULL, p_segment->ul_size, PROT_READ, MAP_PRIVATE, p_segment->i_fd, 0);
+	if (MAP_FAILED == p_map)
+	{
+		LOG_ERROR("couldn't map segment %u", p_segment->ui_number);
+		return GSI_MS_FALSE;
+	}
+
+	while (ul_off + GSI_MS_HDR_SIZE <= p_segment->ul_size)
+	{
+		memcpy(&hdr, p_map + ul_off, GSI_MS_HDR_SIZE);
+		ul_rec_len = GSI_MS_HDR_SIZE + hdr.us_name_len + (unsigned long)hdr.ui_data_len;
+
+		// Validate the record
+		if ((GSI_MS_RECORD_MAGIC != hdr.ui_magic) || (0 == hdr.us_name_len) ||
+			(p_segment->ul_size - ul_off < ul_rec_len))
+		{
+			break;
+		}
+		p_name = p_map + ul_off + GSI_MS_HDR_SIZE;
+		p_data = p_name + hdr.us_name_len;
+		if (hdr.ui_crc != msg_store_record_crc(&hdr, p_name, p_data))
+		{
+			break;
+		}
+
+		i_file = msg_store_name_intern(p_store, p_name, hdr.us_name_len);
+		if ((0 > i_file) ||
+			(GSI_MS_TRUE != msg_store_index_put(p_store, (unsigned int)i_file, hdr.ui_id,
+												p_segment->ui_number, ul_off, hdr.ui_data_len)))
+		{
+			munmap(p_map, p_segment->ul_size);
+			return GSI_MS_FALSE;
+		}
+
+		ul_off += ul_rec_len;
+	}
+
+	munmap(p_map, p_segment->ul_size);
+
+	// Handle a broken tail
+	if (ul_off < p_segment->ul_size)
+	{
+		if (GSI_MS_TRUE == i_is_last)
+		{
+			LOG_WARNING("segment %u: truncating %lu bytes of torn write",
+						p_segment->ui_number, p_segment->ul_size - ul_off);
+			if (0 != ftruncate(p_segment->i_fd, (off_t)ul_off))
+			{
+				LOG_ERROR("couldn't truncate segment %u", p_segment->ui_number);
+				return GSI_MS_FALSE;
+			}
+			p_segment->ul_size = ul_off;
+		}
+		else
+		{
+			LOG_WARNING("segment %u: %lu corrupted bytes ignored",
+						p_segment->ui_number, p_segment->ul_size - ul_off);
+			p_segment->ul_dead += p_segment->ul_size - ul_off;
+		}
+	}
+
+	return GSI_MS_TRUE;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_compact_segment
+	 * Description: Copy the live records of a sealed segment to the active one,
+	 * 				then delete the segment.
+	 * 				The lock is taken per record, so appends and lookups go on
+	 * 				while compacting. A sealed segment never changes, so it's safe
+	 * 				to read it without the lock.
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object (NOT locked)
+	 * Parameter:   [in] unsigned int ui_number - segment number
+#############################################################################*/
+static void msg_store_compact_segment(gsi_msg_store_t* p_store, unsigned int ui_number)
+{
+	int i_fd = -1;
+	int i_file = -1;
+	int i_ok = GSI_MS_TRUE;
+	char* p_map = NULL;
+	unsigned long ul_size = 0;
+	unsigned long ul_off = 0;
+	unsigned long ul_live = 0;
+	unsigned int ui_index = 0;
+	char s_path[GSI_MS_MAX_PATH] = {0};
+	struct gsi_msg_store_record_hdr hdr;
+	struct gsi_msg_store_slot* p_slot = NULL;
+	struct gsi_msg_store_segment* p_segment = NULL;
+
+	pthread_mutex_lock(&(p_store->lock));
+	p_segment = msg_store_segment_find(p_store, ui_number);
+	ul_size = (NULL == p_segment) ? 0 : p_segment->ul_size;
+	pthread_mutex_unlock(&(p_store->lock));
+
+	msg_store_segment_path(p_store, ui_number, s_path);
+
+	i_fd = open(s_path, O_RDONLY | O_CLOEXEC);
+	if (0 > i_fd)
+	{
+		return;
+	}
+
+	p_map = (0 == ul_size) ? NULL : (char*)mmap(NULL, ul_size, PROT_READ, MAP_PRIVATE, i_fd, 0);
+	close(i_fd);
+	if (MAP_FAILED == p_map)
+	{
+		LOG_ERROR("couldn't map segment %u for compaction", ui_number);
+		return;
+	}
+
+	// Move live records - those that the index still points to
+	while ((GSI_MS_TRUE == i_ok) && (ul_off + GSI_MS_HDR_SIZE <= ul_size))
+	{
+		memcpy(&hdr, p_map + ul_off, GSI_MS_HDR_SIZE);
+		if ((GSI_MS_RECORD_MAGIC != hdr.ui_magic) ||
+			(ul_size - ul_off < GSI_MS_HDR_SIZE + hdr.us_name_len + (unsigned long)hdr.ui_data_len))
+		{
+			// Corrupted tail, it was never in the index
+			break;
+		}
+
+		pthread_mutex_lock(&(p_store->lock));
+		i_file = msg_store_name_find(p_store, p_map + ul_off + GSI_MS_HDR_SIZE, hdr.us_name_len);
+		p_slot = (0 > i_file) ? NULL : msg_store_index_find(p_store, (unsigned int)i_file, hdr.ui_id);
+		if ((NULL != p_slot) && (p_slot->ui_segment == ui_number) && (p_slot->ul_offset == ul_off))
+		{
+			i_ok = msg_store_append_locked(p_store, i_file, hdr.ui_id,
+										   p_map + ul_off + GSI_MS_HDR_SIZE + hdr.us_name_len, hdr.ui_data_len);
+			ul_live++;
+		}
+		pthread_mutex_unlock(&(p_store->lock));
+
+		ul_off += GSI_MS_HDR_SIZE + hdr.us_name_len + hdr.ui_data_len;
+	}
+
+	if (NULL != p_map)
+	{
+		munmap(p_map, ul_size);
+	}
+
+	if (GSI_MS_TRUE != i_ok)
+	{
+		LOG_ERROR("compaction of segment %u failed, segment is kept", ui_number);
+		return;
+	}
+
+	pthread_mutex_lock(&(p_store->lock));
+
+	// Moved records must be on disk before the old copy is deleted
+	if ((GSI_MS_TRUE != msg_store_flush(p_store)) ||
+		(0 != fdatasync(p_store->p_segments[p_store->ui_seg_count - 1].i_fd)))
+	{
+		pthread_mutex_unlock(&(p_store->lock));
+		LOG_ERROR("couldn't sync compacted records, segment %u is kept", ui_number);
+		return;
+	}
+
+	// Remove the segment from the array, keep it sorted
+	p_segment = msg_store_segment_find(p_store, ui_number);
+	ui_index = (unsigned int)(p_segment - p_store->p_segments);
+	close(p_segment->i_fd);
+	memmove(p_segment, p_segment + 1, (p_store->ui_seg_count - ui_index - 1) * sizeof(struct gsi_msg_store_segment));
+	p_store->ui_seg_count--;
+	p_store->stats.ul_compactions++;
+
+	pthread_mutex_unlock(&(p_store->lock));
+
+	unlink(s_path);
+
+	LOG_INFO("segment %u compacted: %lu live records moved", ui_number, ul_live);
+}
+
+/*###########################################################################
+	 * Name:		msg_store_background_thread
+	 * Description: Flush the write buffer every GSI_MS_FLUSH_MSECS, and compact
+	 * 				sealed segments with at least GSI_MS_COMPACT_PERCENT dead bytes.
+	 * Parameter:   [in] void* p_args - store object
+	 * Return:		NULL
+#############################################################################*/
+static void* msg_store_background_thread(void* p_args)
+{
+	gsi_msg_store_t* p_store = (gsi_msg_store_t*)p_args;
+	struct timespec deadline;
+	struct gsi_msg_store_segment* p_segment = NULL;
+	unsigned int ui = 0;
+	unsigned int ui_candidate = 0;
+	int i_found = GSI_MS_FALSE;
+
+	pthread_mutex_lock(&(p_store->lock));
+
+	while (GSI_MS_TRUE == p_store->i_running)
+	{
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += GSI_MS_FLUSH_MSECS * 1000000L;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+		pthread_cond_timedwait(&(p_store->wake), &(p_store->lock), &deadline);
+
+		if (GSI_MS_TRUE != p_store->i_running)
+		{
+			break;
+		}
+
+		msg_store_flush(p_store);
+
+		// Find a sealed segment worth compacting (never the active one)
+		i_found = GSI_MS_FALSE;
+		for (ui = 0; (ui + 1 < p_store->ui_seg_count) && (GSI_MS_FALSE == i_found); ++ui)
+		{
+			p_segment = &(p_store->p_segments[ui]);
+			if (p_segment->ul_dead * 100 >= p_segment->ul_size * GSI_MS_COMPACT_PERCENT)
+			{
+				ui_candidate = p_segment->ui_number;
+				i_found = GSI_MS_TRUE;
+			}
+		}
+
+		if (GSI_MS_TRUE == i_found)
+		{
+			pthread_mutex_unlock(&(p_store->lock));
+			msg_store_compact_segment(p_store, ui_candidate);
+			pthread_mutex_lock(&(p_store->lock));
+		}
+	}
+
+	pthread_mutex_unlock(&(p_store->lock));
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		msg_store_free
+	 * Description: Close segment files and free all memory of the store
+	 * Parameter:   [in] gsi_msg_store_t* p_store - store object
+#############################################################################*/
+static void msg_store_free(gsi_msg_store_t* p_store)
+{
+	unsigned int ui = 0;
+
+	for (ui = 0; ui < p_store->ui_seg_count; ++ui)
+	{
+		close(p_store->p_segments[ui].i_fd);
+	}
+
+	for (ui = 0; ui < p_store->ui_name_count; ++ui)
+	{
+		free(p_store->pp_names[ui]);
+	}
+
+	free(p_store->p_segments);
+	free(p_store->pp_names);
+	free(p_store->p_name_lens);
+	free(p_store->p_name_table);
+	free(p_store->p_first_slots);
+	free(p_store->p_last_slots);
+	free(p_store->p_slots);
+	free(p_store->p_index);
+	free(p_store->p_write_buf);
+	free(p_store);
+}
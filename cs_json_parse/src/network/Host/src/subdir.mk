@@ -4,13 +4,16 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
-../src/gsi_is_network_tcp.c 
+../src/gsi_is_network_tcp.c \
+../src/gsi_is_timer_wheel.c 
 
 OBJS += \
-./src/gsi_is_network_tcp.o 
+./src/gsi_is_network_tcp.o \
+./src/gsi_is_timer_wheel.o 
 
 C_DEPS += \
-./src/gsi_is_network_tcp.d
+./src/gsi_is_network_tcp.d \
+./src/gsi_is_timer_wheel.d
 
 # Each subdirectory must supply rules for building sources it contributes
 src/%.o: ../src/%.c
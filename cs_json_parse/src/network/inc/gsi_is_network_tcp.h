@@ -19,9 +19,18 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/epoll.h>
+#include "gsi_is_timer_wheel.h"
 
 /* Defines and Macros */
 #define 	GSI_IS_MAX_CONN		2
+#define 	GSI_IS_SEND_BUF_MIN	4096	/* first allocation of send buffer */
+#define 	GSI_IS_HELLO_TIMEOUT_MSECS 1000 /* client waits for the encoding chosen by server */
+#define 	GSI_IS_HEARTBEAT_MSECS 1000	/* client sends heart beat after this long without a frame */
+#define 	GSI_IS_LIVENESS_MSECS 5000	/* server closes connection it heard nothing from this long */
+#define 	GSI_IS_LIVENESS_TICK_MSECS 100 /* precision of liveness deadlines */
+#define 	GSI_IS_MAX_EVENTS	64		/* ready connections taken by one epoll_wait() */
+#define 	GSI_IS_MAX_OUT		(1 << 22) /* answers a connection of server holds for a slow reader */
 
 /* Enums */
 /***************************************************************************
@@ -34,6 +43,7 @@ enum gsi_is_network_return_code {
 	GSI_NET_RC_ABORT 	  = 2,		// Function requires abort (unrecoverable error)
 	GSI_NET_RC_CONNECTERR = 4,		// Connection Error
 	GSI_NET_RC_EOF 		  = 16,		// End of File Reached
+	GSI_NET_RC_ENCODING   = 32,		// Reconnected with other encoding - nothing was sent, encode again
 	GSI_NET_RC_HASDATA    = 128		// Data is Available
 };
 
@@ -44,10 +54,46 @@ enum gsi_is_network_return_code {
 enum gsi_is_type_message {
     GSI_REGULAR_MSG   = 1,	// Message that contains data
 	GSI_HEARTBEAT_MSG = 2,	// Message that contains heart beat alert
-	GSI_COMMENT 	  = 3   // Line is comment
+	GSI_COMMENT 	  = 3,  // Line is comment
+	GSI_HELLO_MSG	  = 4,	// Negotiation of encoding (unsigned int of gsi_is_encoding flags)
+	GSI_BATCH_MSG	  = 5,	// Many regular messages in one frame (see gsi_build_parse_data.h)
+	GSI_BATCH_REPLY_MSG = 6	// Results of the messages of a batch, server to client
+};
+
+/***************************************************************************
+ * Name:		gsi_is_encoding
+ * Description: Encodings of regular message content. Client offers a set of
+ * 				them in GSI_HELLO_MSG and server answers with the chosen one.
+ * 				Without negotiation the connection uses JSON.
+ ***************************************************************************/
+enum gsi_is_encoding {
+	GSI_ENC_JSON   = 0x1,	// JSON text ('\0' terminated)
+	GSI_ENC_BINARY = 0x2	// Compact binary (see gsi_build_parse_data.h)
 };
 
 /* Structures */
+/*****************************************************************************
+ * Name : gsi_cs_tcp_message
+ * Used by:	TCP Server and TCP Client for communication
+ * Warning: The order of the members is important - DONT change this!
+ * Members:
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_port - Port number
+ *----------------------------------------------------------------------------
+ *		enum gsi_is_type_message e_type_msg - Message Type: Regular / Heart Beat
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_len - message length
+ *----------------------------------------------------------------------------
+ *		char *s_message		- message content
+ *****************************************************************************/
+struct gsi_cs_tcp_message
+{
+	unsigned int ui_port;
+	enum gsi_is_type_message e_type_msg;
+	unsigned int ui_len;
+	char *s_message;
+};
+
 /*****************************************************************************
  * Name : gsi_net_tcp
  * Used by:	TCP Server and TCP Client Interfaces
@@ -67,9 +113,54 @@ enum gsi_is_type_message {
  *		int  i_connection_fd	- Socket used to connect with Partner
  *								  Client / Server
  *----------------------------------------------------------------------------
- *		int i_heartbeat			- Indicate that heart beat was sent
+ *		long long ll_sent_ms	- Client: time a frame was sent last (heart beat after
+ *								  GSI_IS_HEARTBEAT_MSECS without one)
+ *----------------------------------------------------------------------------
+ *		struct gsi_tw_timer live_timer - Connection of server wait: closes it after
+ *								  GSI_IS_LIVENESS_MSECS without a frame (any frame is liveness)
+ *----------------------------------------------------------------------------
+ *		char* p_send_buf		- Reusable buffer of outgoing message (header + data)
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_send_buf_size - Allocated size of p_send_buf
  *----------------------------------------------------------------------------
- *		int i_msg_count		- Counting the number of message until heart beat
+ *		unsigned int ui_last_len - Length of last message (content may be binary)
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_encoding - Encoding of regular messages (gsi_is_encoding)
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_offered - Client: encodings of last hello, offered again on reconnect (0 - none)
+ *----------------------------------------------------------------------------
+ *		enum gsi_is_type_message e_last_type - Type of last message: regular *OR* batch
+ *----------------------------------------------------------------------------
+ *		struct gsi_cs_tcp_message in_header - Server: header of the frame being read
+ *								  (the socket is non blocking - a frame may come in parts)
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_in_header - Server: bytes of in_header read so far
+ *----------------------------------------------------------------------------
+ *		char* p_in_body			- Server: content of the frame being read (NULL - header first)
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_in_body - Server: bytes of p_in_body read so far
+ *----------------------------------------------------------------------------
+ *		char* p_out				- Server: answers the socket didn't take yet, written on EPOLLOUT
+ *								  (new answers go after them)
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_out_size, ui_out_off, ui_out_len - Server: size of p_out /
+ *								  bytes of it written / bytes in it
+ *----------------------------------------------------------------------------
+ *		int i_epoll_fd			- Listening server: epoll of listen socket and connections
+ *								  (connection: epoll of its server)
+ *----------------------------------------------------------------------------
+ *		struct gsi_net_tcp** pp_conns - Listening server: accepted connections by fd
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_conns_cap, ui_conns - Listening server: size of pp_conns / open connections
+ *----------------------------------------------------------------------------
+ *		struct epoll_event a_events[] - Listening server: events of last epoll_wait()
+ *----------------------------------------------------------------------------
+ *		int i_events, i_next_event - Listening server: events in a_events / next one to handle
+ *----------------------------------------------------------------------------
+ *		struct gsi_timer_wheel* p_wheel - Listening server: liveness timers of connections
+ *----------------------------------------------------------------------------
+ *		struct gsi_net_tcp* p_busy - Listening server: connection of last frame returned by
+ *								  server wait (its client waits for the server, not dead)
  *----------------------------------------------------------------------------
  * 		struct sockaddr_in serv_addr - SockAddr_In structure.
  *								  	   Describer connection address for
@@ -84,36 +175,41 @@ struct gsi_net_tcp {
 
 	int	i_listen_fd;
 	int i_connection_fd;
-	int i_heartbeat;
-	int i_msg_count;
 	unsigned int ui_port;
+	long long ll_sent_ms;
+	struct gsi_tw_timer live_timer;
+
+	char* p_send_buf;
+	unsigned int ui_send_buf_size;
+	unsigned int ui_last_len;
+	unsigned int ui_encoding;
+	unsigned int ui_offered;
+	enum gsi_is_type_message e_last_type;
+
+	struct gsi_cs_tcp_message in_header;
+	unsigned int ui_in_header;
+	char* p_in_body;
+	unsigned int ui_in_body;
+
+	char* p_out;
+	unsigned int ui_out_size;
+	unsigned int ui_out_off;
+	unsigned int ui_out_len;
+
+	int i_epoll_fd;
+	struct gsi_net_tcp** pp_conns;
+	unsigned int ui_conns_cap;
+	unsigned int ui_conns;
+	struct epoll_event a_events[GSI_IS_MAX_EVENTS];
+	int i_events;
+	int i_next_event;
+	struct gsi_timer_wheel* p_wheel;
+	struct gsi_net_tcp* p_busy;
 
 	struct sockaddr_in serv_addr;
 	struct pollfd pfds[GSI_IS_MAX_CONN];
 };
 
-/*****************************************************************************
- * Name : gsi_cs_tcp_message
- * Used by:	TCP Server and TCP Client for communication
- * Warning: The order of the members is important - DONT change this!
- * Members:
- *----------------------------------------------------------------------------
- *		unsigned int ui_port - Port number
- *----------------------------------------------------------------------------
- *		enum gsi_is_type_message e_type_msg - Message Type: Regular / Heart Beat
- *----------------------------------------------------------------------------
- *		unsigned int ui_len - message length
- *----------------------------------------------------------------------------
- *		char *s_message		- message content
- *****************************************************************************/
-struct gsi_cs_tcp_message
-{
-	unsigned int ui_port;
-	enum gsi_is_type_message e_type_msg;
-	unsigned int ui_len;
-	char *s_message;
-};
-
 /*******************/
 /* API Declaration */
 /*******************/
@@ -184,6 +280,113 @@ enum gsi_is_network_return_code gsi_is_network_tcp_send(struct gsi_net_tcp *p_th
 														char *s_msg);
 
 
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_get_send_buf
+	 * Description: Get the send buffer of the connection, with room for at least
+	 * 				ui_size bytes. The buffer is kept for the next messages.
+	 * 				Content is NOT kept when the buffer grows.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP
+	 * Parameter:   [in] unsigned int ui_size - bytes needed
+	 * Return:		Success - pointer to send buffer
+	 * 				Failure - NULL
+#############################################################################*/
+char* gsi_is_network_tcp_get_send_buf(struct gsi_net_tcp *p_this, unsigned int ui_size);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_send_buf
+	 * Description: Send the first ui_len bytes of the send buffer with one write()
+	 * 				(more only on partial write). The buffer must start with the
+	 * 				header of struct gsi_cs_tcp_message.
+	 * 				Client reconnects if nothing was sent, server (answer) doesn't.
+	 * 				A connection of server wait doesn't block - what its socket doesn't take
+	 * 				is queued and sent by gsi_is_network_tcp_server_wait().
+	 * 				The new connection says hello again (a new connection of server is
+	 * 				JSON until hello) - a message with content is not sent if the server
+	 * 				chose other encoding.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP
+	 * Parameter:   [in] unsigned int ui_len - bytes to send
+	 * Return:		Success - GSI_NET_RC_SUCCESS
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR *OR* GSI_NET_RC_ENCODING
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_send_buf(struct gsi_net_tcp *p_this, unsigned int ui_len);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_send_frames
+	 * Description: Send ui_len bytes of ready frames (header of struct gsi_cs_tcp_message
+	 * 				and content, one after the other) from any buffer, e.g. a mapped file,
+	 * 				with one write() (more only on partial write).
+	 * 				Client reconnects if nothing was sent, server (answer) doesn't.
+	 * 				A connection of server wait doesn't block - what its socket doesn't take
+	 * 				is queued and sent by gsi_is_network_tcp_server_wait().
+	 * 				The new connection says hello again - frames with content are not
+	 * 				sent if the server chose other encoding.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP
+	 * Parameter:   [in] const char* p_frames - frames to send
+	 * Parameter:   [in] unsigned int ui_len - bytes to send
+	 * Return:		Success - GSI_NET_RC_SUCCESS
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR *OR* GSI_NET_RC_ENCODING
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_send_frames(struct gsi_net_tcp *p_this,
+															   const char* p_frames, unsigned int ui_len);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_client_hello
+	 * Description: Offer encodings to the server (GSI_HELLO_MSG) and wait up to
+	 * 				GSI_IS_HELLO_TIMEOUT_MSECS for the one it chose.
+	 * 				Without answer the connection stays with JSON.
+	 * 				Call it right after connect, before any regular message.
+	 * 				The encodings are offered again on every reconnect.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Client
+	 * Parameter:   [in] unsigned int ui_encodings - offered gsi_is_encoding flags
+	 * Return:		Success - GSI_NET_RC_SUCCESS (p_this->ui_encoding is set)
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_client_hello(struct gsi_net_tcp *p_this, unsigned int ui_encodings);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_client_read
+	 * Description: Read one message the server sent to the client (e.g. GSI_BATCH_REPLY_MSG).
+	 * 				Heart beats are sent on time while it waits.
+	 * 				Note! the content is allocated (with '\0' after it) and moved to s_message,
+	 * 				the user is responsible to free it after use.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Client
+	 * Parameter:   [out] char *s_msg - struct gsi_cs_tcp_message to fill
+	 * Parameter:   [in] int i_timeout_msecs - max wait for the message (-1 - no limit)
+	 * Return:		Success - GSI_NET_RC_SUCCESS
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_client_read(struct gsi_net_tcp *p_this,
+															   char *s_msg,
+															   int i_timeout_msecs);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_client_heartbeat
+	 * Description: Send heart beat if the client sent nothing for GSI_IS_HEARTBEAT_MSECS
+	 * 				(every frame is liveness for the server - a busy client doesn't need it).
+	 * 				Call it while the client is idle, the wait of
+	 * 				gsi_is_network_tcp_client_read() sends them by itself.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Client
+	 * Return:		Success - GSI_NET_RC_SUCCESS (sent, or not needed yet)
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_client_heartbeat(struct gsi_net_tcp *p_this);
+
+
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_client_cleanup
+	 * Description: Cleans up the TCP Client - close connection and free send buffer.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Client
+	 * Return:		Success - GSI_NET_RC_SUCCESS
+	 * 				Failure - GSI_NET_RC_ERROR
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_client_cleanup(struct gsi_net_tcp *p_this);
+
+
 /********************/
 /* Server Functions */
 /********************/
@@ -203,7 +406,7 @@ enum gsi_is_network_return_code gsi_is_network_tcp_server_init(struct gsi_net_tc
 	 * Description:	Polls if TCP Server has available pending
 	 * 			    connections or Data on an established connection,
 	 * 			    If pending connections are available, they 1st connection is
-	 * 			    accepted.
+	 * 			    accepted (with JSON encoding until it sends GSI_HELLO_MSG).
 	 * 			    If data is available on an established connection,
 	 * 			    returns GSI_NET_RC_HASDATA.
 	 *				POLL allows the TCP server to work in a non-blocking mode
@@ -216,9 +419,40 @@ enum gsi_is_network_return_code gsi_is_network_tcp_server_init(struct gsi_net_tc
 enum gsi_is_network_return_code gsi_is_network_tcp_server_poll(struct gsi_net_tcp *p_this);
 
 
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_server_wait
+	 * Description:	Wait (epoll) for many clients on the listening port.
+	 * 				New connections are accepted, each one gets its own struct gsi_net_tcp
+	 * 				(encoding, liveness timer, last message, send buffer).
+	 * 				A connection that sent nothing (data or heart beat) for GSI_IS_LIVENESS_MSECS
+	 * 				is closed - the time the caller spends on its frame is not counted.
+	 * 				Connections are non blocking: a frame that came in parts is kept in its
+	 * 				connection and read on, and answers the socket didn't take are sent
+	 * 				when it is writable again - a slow client doesn't hold the others.
+	 * 				Heart beat and hello are handled here, a frame with data is read and
+	 * 				its connection is returned - use it with gsi_is_network_tcp_server_read()
+	 * 				(or gsi_is_recv_batch_msg()) and the send functions.
+	 * 				A connection that closed (or broke the protocol) is closed and freed.
+	 * 				Events of one epoll_wait() are taken one by one in the next calls.
+	 * 				The wait wakes up for the next deadline of the liveness timers only
+	 * 				(gsi_tw_next_ms()) - no polling with a short timeout is needed.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Server
+	 * Parameter:   [out] struct gsi_net_tcp **pp_conn - connection with data (HASDATA only)
+	 * Parameter:   [in] int i_timeout_msecs - max wait for events (-1 - no limit)
+	 * Return:		Success - GSI_NET_RC_HASDATA *OR* GSI_NET_RC_SUCCESS (nothing to read)
+	 * 						  *OR* GSI_NET_RC_CONNECTERR (a connection was closed)
+	 * 				Failure - GSI_NET_RC_ERROR
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_server_wait(struct gsi_net_tcp *p_this,
+															   struct gsi_net_tcp **pp_conn,
+															   int i_timeout_msecs);
+
+
 /*###########################################################################
 	 * Name:		gsi_is_network_tcp_server_read
 	 * Description: Read one message from the TCP Server (Connection FD).
+	 * 				e_type_msg is GSI_REGULAR_MSG *OR* GSI_BATCH_MSG.
+	 * 				ui_len is the content length: with the '\0' for JSON, as sent for binary.
 	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Server
 	 * Parameter:   [out] char *s_msg - buffer to fill with the read message.
 	 * Return:		Success 		- GSI_NET_RC_SUCCESS
@@ -230,7 +464,7 @@ enum gsi_is_network_return_code gsi_is_network_tcp_server_read(struct gsi_net_tc
 
 /*###########################################################################
 	 * Name:		gsi_is_network_tcp_server_cleanup
-	 * Description: Cleans up the TCP Server.
+	 * Description: Cleans up the TCP Server (and the connections of gsi_is_network_tcp_server_wait()).
 	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Server
 	 * Return:		Success - GSI_NET_RC_SUCCESS
 	 * 				Failure - GSI_NET_RC_ERROR
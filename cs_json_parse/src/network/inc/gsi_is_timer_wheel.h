@@ -0,0 +1,168 @@
+/**************************************************************************
+* Name : gsi_is_timer_wheel.h
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Hierarchical timer wheel of deadlines (milliseconds of CLOCK_MONOTONIC).
+* 				GSI_TW_LEVELS wheels of GSI_TW_LEVEL_SLOTS slots: level 0 has a slot per
+* 				tick, a slot of level n holds GSI_TW_LEVEL_SLOTS slots of level n - 1,
+* 				and is moved down into them (cascade) when the ticks reach it.
+* 				Set, move and cancel of a timer are O(1), whatever the number of timers,
+* 				and a tick takes only its own slot - no scan of all the timers.
+* 				Deadlines further than GSI_TW_LEVEL_SLOTS^GSI_TW_LEVELS ticks wait in the
+* 				last slot and are set again when they reach it.
+* 				A timer is embedded in its owner (no allocation).
+* 				Using: 1. gsi_tw_init() - before the first timer
+* 					   2. gsi_tw_set() / gsi_tw_cancel() - as deadlines change
+* 					   3. gsi_tw_next_ms() - timeout of the wait of the owner (e.g. epoll_wait())
+* 					   4. gsi_tw_expire() - after the wait, calls a function for each
+* 										   timer its deadline passed
+*****************************************************************************/
+#ifndef GSI_IS_TIMER_WHEEL_H_
+#define GSI_IS_TIMER_WHEEL_H_
+
+/* Defines and Macros */
+#define 	GSI_TW_LEVEL_BITS		6						/* slots of level - 64 */
+#define 	GSI_TW_LEVEL_SLOTS		(1 << GSI_TW_LEVEL_BITS)
+#define 	GSI_TW_LEVEL_MASK		(GSI_TW_LEVEL_SLOTS - 1)
+#define 	GSI_TW_LEVELS			4						/* 2^24 ticks - 4.6 hours of 1 ms ticks */
+
+/* Enums */
+/***************************************************************************
+ * Name:  		gsi_tw_rc
+ * Description: Return Code values for GSI-TIMER-WHEEL functions
+ ***************************************************************************/
+enum gsi_tw_rc {
+	GSI_TW_RC_SUCCESS   = 0,	// Function completed Successfully
+	GSI_TW_RC_INVALID   = 2		// Function got invalid arguments
+};
+
+/* Structures */
+/*****************************************************************************
+ * Name : gsi_tw_timer
+ * Used by: GSI-TIMER-WHEEL API functions (embedded by its owner)
+ * Members:
+ *----------------------------------------------------------------------------
+ *		struct gsi_tw_timer* p_next, p_prev - list of slot (NULL - timer is not set)
+ *----------------------------------------------------------------------------
+ *		long long ll_expire_ms - deadline
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_level - level of its slot
+ *----------------------------------------------------------------------------
+ *		void* p_data - owner of timer (for the expire function)
+ *****************************************************************************/
+struct gsi_tw_timer
+{
+	struct gsi_tw_timer* p_next;
+	struct gsi_tw_timer* p_prev;
+	long long ll_expire_ms;
+	unsigned int ui_level;
+	void* p_data;
+};
+
+/*****************************************************************************
+ * Name : gsi_timer_wheel
+ * Used by: GSI-TIMER-WHEEL API functions
+ * Members:
+ *----------------------------------------------------------------------------
+ *		struct gsi_tw_timer a_slots[][] - head of list of each slot of each level
+ *----------------------------------------------------------------------------
+ *		long long ll_tick - last tick that was expired
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_tick_msecs - milliseconds of tick (precision of deadlines)
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_timers - timers that are set
+ *----------------------------------------------------------------------------
+ *		unsigned int a_level_timers[] - timers that are set in each level
+ *****************************************************************************/
+struct gsi_timer_wheel
+{
+	struct gsi_tw_timer a_slots[GSI_TW_LEVELS][GSI_TW_LEVEL_SLOTS];
+	long long ll_tick;
+	unsigned int ui_tick_msecs;
+	unsigned int ui_timers;
+	unsigned int a_level_timers[GSI_TW_LEVELS];
+};
+
+/* Typedef */
+/***************************************************************************
+ * Name:		gsi_tw_func
+ * Description: Called by gsi_tw_expire() for a timer its deadline passed
+ * 				(the timer is not set anymore - it may be set again, or its owner freed)
+ ***************************************************************************/
+typedef void (*gsi_tw_func)(struct gsi_tw_timer* p_timer, void* p_arg);
+
+/*******************/
+/* API Declaration */
+/*******************/
+/*###########################################################################
+	 * Name:		gsi_tw_now_ms
+	 * Description: Time now for deadlines of timers (CLOCK_MONOTONIC)
+	 * Return:		Milliseconds
+#############################################################################*/
+long long gsi_tw_now_ms();
+
+
+/*###########################################################################
+	 * Name:		gsi_tw_init
+	 * Description: Reset wheel to no timers
+	 * Parameter:   [in] struct gsi_timer_wheel* p_wheel - wheel to reset
+	 * Parameter:   [in] unsigned int ui_tick_msecs - milliseconds of tick
+	 * Parameter:   [in] long long ll_now_ms - time now (gsi_tw_now_ms())
+	 * Return:		Success - GSI_TW_RC_SUCCESS
+	 * 				Failure - GSI_TW_RC_INVALID
+#############################################################################*/
+enum gsi_tw_rc gsi_tw_init(struct gsi_timer_wheel* p_wheel, unsigned int ui_tick_msecs, long long ll_now_ms);
+
+
+/*###########################################################################
+	 * Name:		gsi_tw_set
+	 * Description: Set timer to expire at ll_expire_ms (moved if it is set already),
+	 * 				in the first tick that starts at it or after it (at most a tick late).
+	 * 				Deadline that passed expires in the next tick.
+	 * Parameter:   [in] struct gsi_timer_wheel* p_wheel - wheel
+	 * Parameter:   [in] struct gsi_tw_timer* p_timer - timer (p_data is kept)
+	 * Parameter:   [in] long long ll_expire_ms - deadline
+	 * Return:		Success - GSI_TW_RC_SUCCESS
+	 * 				Failure - GSI_TW_RC_INVALID
+#############################################################################*/
+enum gsi_tw_rc gsi_tw_set(struct gsi_timer_wheel* p_wheel, struct gsi_tw_timer* p_timer, long long ll_expire_ms);
+
+
+/*###########################################################################
+	 * Name:		gsi_tw_cancel
+	 * Description: Remove timer from wheel (nothing if it is not set)
+	 * Parameter:   [in] struct gsi_timer_wheel* p_wheel - wheel
+	 * Parameter:   [in] struct gsi_tw_timer* p_timer - timer
+	 * Return:		Success - GSI_TW_RC_SUCCESS
+	 * 				Failure - GSI_TW_RC_INVALID
+#############################################################################*/
+enum gsi_tw_rc gsi_tw_cancel(struct gsi_timer_wheel* p_wheel, struct gsi_tw_timer* p_timer);
+
+
+/*###########################################################################
+	 * Name:		gsi_tw_next_ms
+	 * Description: Time until the wheel must be expired again: the next tick with
+	 * 				timers in level 0, or the next cascade of the upper levels
+	 * 				(at most GSI_TW_LEVEL_SLOTS slots are looked at)
+	 * Parameter:   [in] const struct gsi_timer_wheel* p_wheel - wheel
+	 * Parameter:   [in] long long ll_now_ms - time now (gsi_tw_now_ms())
+	 * Return:		Milliseconds (0 - a deadline passed), -1 - no timers
+#############################################################################*/
+long long gsi_tw_next_ms(const struct gsi_timer_wheel* p_wheel, long long ll_now_ms);
+
+
+/*###########################################################################
+	 * Name:		gsi_tw_expire
+	 * Description: Take the ticks passed since the last call (cascade of upper levels
+	 * 				when their slot is reached), and call p_func for each timer its
+	 * 				deadline passed
+	 * Parameter:   [in] struct gsi_timer_wheel* p_wheel - wheel
+	 * Parameter:   [in] long long ll_now_ms - time now (gsi_tw_now_ms())
+	 * Parameter:   [in] gsi_tw_func p_func - called for each expired timer
+	 * Parameter:   [in] void* p_arg - passed to p_func
+	 * Return:		Number of expired timers
+#############################################################################*/
+unsigned int gsi_tw_expire(struct gsi_timer_wheel* p_wheel, long long ll_now_ms, gsi_tw_func p_func, void* p_arg);
+
+
+#endif /* GSI_IS_TIMER_WHEEL_H_ */
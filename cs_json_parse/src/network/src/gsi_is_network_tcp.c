@@ -6,25 +6,38 @@
 *****************************************************************************/
 
 /* Includes */
+#define _GNU_SOURCE		/* accept4() */
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
 #include "gsi_is_network_tcp.h"
 #include "gsi_is_log_api.h"
 
 /* Defines and Macros */
 #define 	GSI_IS_TRUE				  	  1
 #define 	GSI_IS_FALSE				  0
-#define 	GSI_IS_MAX_LISTEN			  10 	/* max of queue length in listen() */
+#define 	GSI_IS_MAX_LISTEN			  SOMAXCONN	/* max of queue length in listen() */
 #define 	GSI_IS_POLL_SOCKET_LISTEN 	  0		/* index in fd array */
 #define 	GSI_IS_POLL_SOCKET_CONNECT    1		/* index in fd array */
 #define 	GSI_IS_POLL_DELAY_MSECS	      10000 /* timeout for poll() */
-#define 	GSI_IS_MAX_MSG_COUNT		  5		/* max messages without heart beat */
+#define 	GSI_IS_CONNS_INIT_CAP		  64	/* first size of connections array (by fd) */
 
 /********************************/
 /* Static functions declaration */
 /********************************/
 static char* set_address_parameters(struct gsi_net_tcp *p_this, char* s_tcp_addr);
 static enum gsi_is_network_return_code read_check_heartbeat(struct gsi_net_tcp *p_this);
+static enum gsi_is_network_return_code read_all(int i_fd, void* p_buf, unsigned int ui_len);
+static enum gsi_is_network_return_code read_resume(int i_fd, char* p_buf, unsigned int ui_len, unsigned int* p_done);
+static enum gsi_is_network_return_code write_resume(int i_fd, const char* p_buf, unsigned int ui_len, unsigned int* p_done);
+static enum gsi_is_network_return_code client_reconnect(struct gsi_net_tcp *p_this);
+static enum gsi_is_network_return_code client_hello_exchange(struct gsi_net_tcp *p_this);
+static enum gsi_is_network_return_code server_accept(struct gsi_net_tcp *p_this);
+static void server_close_conn(struct gsi_net_tcp *p_this, struct gsi_net_tcp *p_conn);
+static enum gsi_is_network_return_code server_send(struct gsi_net_tcp *p_this, const char* p_frames, unsigned int ui_len);
+static enum gsi_is_network_return_code server_flush_out(struct gsi_net_tcp *p_this);
+static void server_expire_conn(struct gsi_tw_timer* p_timer, void* p_arg);
 
 /********************/
 /* Common Functions */
@@ -48,6 +61,9 @@ enum gsi_is_network_return_code gsi_is_network_tcp_reset(struct gsi_net_tcp* p_t
 	// Set all fields to 0/NULL according to their type
 	memset(p_this, 0, sizeof(struct gsi_net_tcp));
 
+	// Until other encoding is negotiated
+	p_this->ui_encoding = GSI_ENC_JSON;
+
 	return GSI_NET_RC_SUCCESS;
 }
 
@@ -165,7 +181,7 @@ enum gsi_is_network_return_code gsi_is_network_tcp_send(struct gsi_net_tcp *p_th
 	{
 		LOG_INFO("try to reconnect...");
 
-		if (GSI_NET_RC_SUCCESS != gsi_is_network_tcp_connect(&p_this->serv_addr, &p_this->i_connection_fd))
+		if (GSI_NET_RC_SUCCESS != client_reconnect(p_this))
 		{
 			LOG_ERROR("connection failed!");
 			return GSI_NET_RC_CONNECTERR;
@@ -187,10 +203,373 @@ enum gsi_is_network_return_code gsi_is_network_tcp_send(struct gsi_net_tcp *p_th
 		return GSI_NET_RC_ERROR;
 	}
 
+	p_this->ll_sent_ms = gsi_tw_now_ms();
+
+	LOG_INFO("message sent successfully");
+	return GSI_NET_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_get_send_buf
+	 * Description: Get the send buffer of the connection, with room for at least
+	 * 				ui_size bytes. The buffer is kept for the next messages.
+	 * 				Content is NOT kept when the buffer grows.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP
+	 * Parameter:   [in] unsigned int ui_size - bytes needed
+	 * Return:		Success - pointer to send buffer
+	 * 				Failure - NULL
+#############################################################################*/
+char* gsi_is_network_tcp_get_send_buf(struct gsi_net_tcp *p_this, unsigned int ui_size)
+{
+	unsigned int ui_new_size = 0;
+
+	// Check input validation
+	if (NULL == p_this)
+	{
+		LOG_ERROR("invalid argument!");
+		return NULL;
+	}
+
+	// Big enough - reuse it
+	if (ui_size <= p_this->ui_send_buf_size)
+	{
+		return p_this->p_send_buf;
+	}
+
+	// Grow by doubling, old content is not needed
+	ui_new_size = (0 == p_this->ui_send_buf_size) ? GSI_IS_SEND_BUF_MIN : p_this->ui_send_buf_size;
+	while (ui_new_size < ui_size)
+	{
+		ui_new_size *= 2;
+	}
+
+	free(p_this->p_send_buf);
+	p_this->p_send_buf = (char *)malloc(ui_new_size);
+	if (NULL == p_this->p_send_buf)
+	{
+		LOG_ERROR("memory allocation for send buffer failed");
+		p_this->ui_send_buf_size = 0;
+		return NULL;
+	}
+
+	p_this->ui_send_buf_size = ui_new_size;
+
+	return p_this->p_send_buf;
+}
+
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_send_buf
+	 * Description: Send the first ui_len bytes of the send buffer with one write()
+	 * 				(more only on partial write). The buffer must start with the
+	 * 				header of struct gsi_cs_tcp_message.
+	 * 				Client reconnects if nothing was sent, server (answer) doesn't.
+	 * 				A connection of server wait doesn't block - what its socket doesn't take
+	 * 				is queued and sent by gsi_is_network_tcp_server_wait().
+	 * 				The new connection says hello again (a new connection of server is
+	 * 				JSON until hello) - a message with content is not sent if the server
+	 * 				chose other encoding.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP
+	 * Parameter:   [in] unsigned int ui_len - bytes to send
+	 * Return:		Success - GSI_NET_RC_SUCCESS
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR *OR* GSI_NET_RC_ENCODING
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_send_buf(struct gsi_net_tcp *p_this, unsigned int ui_len)
+{
+	// Check input validation
+	if ((NULL == p_this) || (NULL == p_this->p_send_buf) || (ui_len > p_this->ui_send_buf_size))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_NET_RC_ERROR;
+	}
+
+	return gsi_is_network_tcp_send_frames(p_this, p_this->p_send_buf, ui_len);
+}
+
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_send_frames
+	 * Description: Send ui_len bytes of ready frames (header of struct gsi_cs_tcp_message
+	 * 				and content, one after the other) from any buffer, e.g. a mapped file,
+	 * 				with one write() (more only on partial write).
+	 * 				Client reconnects if nothing was sent, server (answer) doesn't.
+	 * 				A connection of server wait doesn't block - what its socket doesn't take
+	 * 				is queued and sent by gsi_is_network_tcp_server_wait().
+	 * 				The new connection says hello again - frames with content are not
+	 * 				sent if the server chose other encoding.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP
+	 * Parameter:   [in] const char* p_frames - frames to send
+	 * Parameter:   [in] unsigned int ui_len - bytes to send
+	 * Return:		Success - GSI_NET_RC_SUCCESS
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR *OR* GSI_NET_RC_ENCODING
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_send_frames(struct gsi_net_tcp *p_this,
+															   const char* p_frames, unsigned int ui_len)
+{
+	ssize_t l_count = 0;
+	unsigned int ui_sent = 0;
+	unsigned int ui_encoding = 0;
+
+	// Check input validation
+	if ((NULL == p_this) || (NULL == p_frames))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_NET_RC_ERROR;
+	}
+
+	// Server can't reconnect to its client, and doesn't wait for it
+	if (0 != p_this->i_listen_fd)
+	{
+		return server_send(p_this, p_frames, ui_len);
+	}
+
+	// Encoding the frames were encoded with
+	ui_encoding = p_this->ui_encoding;
+
+	// Nothing was sent yet - on error try to reconnect
+	while ((l_count = write(p_this->i_connection_fd, p_frames, ui_len)) < 0)
+	{
+		LOG_INFO("try to reconnect...");
+
+		if (GSI_NET_RC_SUCCESS != client_reconnect(p_this))
+		{
+			LOG_ERROR("connection failed!");
+			return GSI_NET_RC_CONNECTERR;
+		}
+
+		// Header only message (heart beat) is the same in every encoding
+		if ((ui_encoding != p_this->ui_encoding) && (sizeof(struct gsi_cs_tcp_message) - sizeof(char *) < ui_len))
+		{
+			LOG_WARNING("port %d reconnected with encoding %u instead of %u", p_this->ui_port,
+						p_this->ui_encoding, ui_encoding);
+			return GSI_NET_RC_ENCODING;
+		}
+	}
+
+	// Complete a partial write, the message was already started so don't reconnect
+	for (ui_sent = (unsigned int)l_count; ui_sent < ui_len; ui_sent += (unsigned int)l_count)
+	{
+		l_count = write(p_this->i_connection_fd, p_frames + ui_sent, ui_len - ui_sent);
+		if (0 > l_count)
+		{
+			LOG_ERROR("partial write");
+			return GSI_NET_RC_ERROR;
+		}
+	}
+
+	// Any frame is liveness - heart beat is needed only after GSI_IS_HEARTBEAT_MSECS without one
+	p_this->ll_sent_ms = gsi_tw_now_ms();
+
 	LOG_INFO("message sent successfully");
 	return GSI_NET_RC_SUCCESS;
 }
 
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_client_hello
+	 * Description: Offer encodings to the server (GSI_HELLO_MSG) and wait up to
+	 * 				GSI_IS_HELLO_TIMEOUT_MSECS for the one it chose.
+	 * 				Without answer the connection stays with JSON.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Client
+	 * Parameter:   [in] unsigned int ui_encodings - offered gsi_is_encoding flags
+	 * Return:		Success - GSI_NET_RC_SUCCESS (p_this->ui_encoding is set)
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_client_hello(struct gsi_net_tcp *p_this, unsigned int ui_encodings)
+{
+	enum gsi_is_network_return_code e_rc = GSI_NET_RC_SUCCESS;
+
+	// Check input validation
+	if ((NULL == p_this) || (0 == (GSI_ENC_JSON & ui_encodings)))
+	{
+		LOG_ERROR("invalid arguments! (JSON must be offered)");
+		return GSI_NET_RC_ERROR;
+	}
+
+	// Offered again by every reconnect
+	p_this->ui_offered = ui_encodings;
+
+	e_rc = client_hello_exchange(p_this);
+
+	// Connection is broken - the new one says hello by itself
+	if (GSI_NET_RC_CONNECTERR == e_rc)
+	{
+		LOG_INFO("try to reconnect...");
+		e_rc = client_reconnect(p_this);
+	}
+
+	return e_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_client_read
+	 * Description: Read one message the server sent to the client (e.g. GSI_BATCH_REPLY_MSG).
+	 * 				Heart beats are sent on time while it waits.
+	 * 				Note! the content is allocated (with '\0' after it) and moved to s_message,
+	 * 				the user is responsible to free it after use.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Client
+	 * Parameter:   [out] char *s_msg - struct gsi_cs_tcp_message to fill
+	 * Parameter:   [in] int i_timeout_msecs - max wait for the message (-1 - no limit)
+	 * Return:		Success - GSI_NET_RC_SUCCESS
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_client_read(struct gsi_net_tcp *p_this,
+															   char *s_msg,
+															   int i_timeout_msecs)
+{
+	struct gsi_cs_tcp_message *p_msg = (struct gsi_cs_tcp_message *)s_msg;
+	unsigned int ui_header_len = sizeof(struct gsi_cs_tcp_message) - sizeof(char *);
+	struct pollfd pfd;
+	long long ll_now_ms = gsi_tw_now_ms();
+	long long ll_end_ms = ll_now_ms + i_timeout_msecs;
+	long long ll_wait_ms = 0;
+	int i_rc = GSI_NET_RC_SUCCESS;
+
+	// Check input validation
+	if ((NULL == p_this) || (NULL == p_msg))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_NET_RC_ERROR;
+	}
+
+	// Reset p_msg buffer
+	memset(p_msg, 0, sizeof(struct gsi_cs_tcp_message));
+
+	// Wait for the message - until the next heart beat is due each time
+	pfd.fd = p_this->i_connection_fd;
+	pfd.events = POLLIN;
+
+	while (1)
+	{
+		ll_wait_ms = p_this->ll_sent_ms + GSI_IS_HEARTBEAT_MSECS - ll_now_ms;
+		if ((0 <= i_timeout_msecs) && (ll_end_ms - ll_now_ms < ll_wait_ms))
+		{
+			ll_wait_ms = ll_end_ms - ll_now_ms;
+		}
+
+		pfd.revents = 0;
+		i_rc = poll(&pfd, 1, (0 < ll_wait_ms) ? (int)ll_wait_ms : 0);
+		if (0 < i_rc)
+		{
+			break;
+		}
+
+		if ((0 > i_rc) && (EINTR != errno))
+		{
+			LOG_ERROR("poll failed (errno %d)", errno);
+			return GSI_NET_RC_ERROR;
+		}
+
+		ll_now_ms = gsi_tw_now_ms();
+		if ((0 <= i_timeout_msecs) && (ll_now_ms >= ll_end_ms))
+		{
+			LOG_ERROR("no message from server on port %d", p_this->ui_port);
+			return GSI_NET_RC_ERROR;
+		}
+
+		i_rc = gsi_is_network_tcp_client_heartbeat(p_this);
+		if (GSI_NET_RC_SUCCESS != i_rc)
+		{
+			return i_rc;
+		}
+	}
+
+	// Header first - to know the content length
+	i_rc = read_all(p_this->i_connection_fd, p_msg, ui_header_len);
+	if (GSI_NET_RC_SUCCESS != i_rc)
+	{
+		LOG_ERROR("read header failed");
+		return i_rc;
+	}
+
+	// Content with '\0' after it
+	p_msg->s_message = (char *)malloc((size_t)p_msg->ui_len + 1);
+	if (NULL == p_msg->s_message)
+	{
+		LOG_ERROR("memory allocation for message failed");
+		return GSI_NET_RC_ERROR;
+	}
+
+	p_msg->s_message[p_msg->ui_len] = '\0';
+
+	i_rc = read_all(p_this->i_connection_fd, p_msg->s_message, p_msg->ui_len);
+	if (GSI_NET_RC_SUCCESS != i_rc)
+	{
+		free(p_msg->s_message);
+		p_msg->s_message = NULL;
+
+		LOG_ERROR("read message failed");
+		return i_rc;
+	}
+
+	LOG_DEBUG("client read message type %d of %u bytes", p_msg->e_type_msg, p_msg->ui_len);
+	return GSI_NET_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_client_heartbeat
+	 * Description: Send heart beat if the client sent nothing for GSI_IS_HEARTBEAT_MSECS
+	 * 				(every frame is liveness for the server - a busy client doesn't need it).
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Client
+	 * Return:		Success - GSI_NET_RC_SUCCESS (sent, or not needed yet)
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_client_heartbeat(struct gsi_net_tcp *p_this)
+{
+	struct gsi_cs_tcp_message msg;
+
+	// Check input validation
+	if (NULL == p_this)
+	{
+		LOG_ERROR("invalid argument!");
+		return GSI_NET_RC_ERROR;
+	}
+
+	if (gsi_tw_now_ms() - p_this->ll_sent_ms < GSI_IS_HEARTBEAT_MSECS)
+	{
+		return GSI_NET_RC_SUCCESS;
+	}
+
+	// Header only
+	memset(&msg, 0, sizeof(msg));
+	msg.ui_port = p_this->ui_port;
+	msg.e_type_msg = GSI_HEARTBEAT_MSG;
+
+	LOG_DEBUG("heart beat to server on port %d", p_this->ui_port);
+	return gsi_is_network_tcp_send_frames(p_this, (const char *)&msg, sizeof(msg) - sizeof(char *));
+}
+
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_client_cleanup
+	 * Description: Cleans up the TCP Client - close connection and free send buffer.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Client
+	 * Return:		Success - GSI_NET_RC_SUCCESS
+	 * 				Failure - GSI_NET_RC_ERROR
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_client_cleanup(struct gsi_net_tcp *p_this)
+{
+	// Check input validation
+	if (NULL == p_this)
+	{
+		LOG_ERROR("invalid argument!");
+		return GSI_NET_RC_ERROR;
+	}
+
+	// Free the send buffer
+	free(p_this->p_send_buf);
+	p_this->p_send_buf = NULL;
+	p_this->ui_send_buf_size = 0;
+
+	// Close connection socket (if open)
+	if ((0 < p_this->i_connection_fd) && (0 > close(p_this->i_connection_fd)))
+	{
+		LOG_ERROR("close connection fd failed");
+		return GSI_NET_RC_ERROR;
+	}
+
+	p_this->i_connection_fd = 0;
+
+	LOG_INFO("client cleanup successfully");
+	return GSI_NET_RC_SUCCESS;
+}
+
 /*###########################################################################
 	 * Name:		gsi_is_network_tcp_client_init
 	 * Description:	Initializes an Instance of struct TCP Client,
@@ -313,6 +692,40 @@ enum gsi_is_network_return_code gsi_is_network_tcp_server_init(struct gsi_net_tc
     	return GSI_NET_RC_ERROR;
     }
 
+    // Accept all pending connections without blocking (gsi_is_network_tcp_server_wait)
+    if (0 > fcntl(p_this->i_listen_fd, F_SETFL, fcntl(p_this->i_listen_fd, F_GETFL) | O_NONBLOCK))
+    {
+    	LOG_ERROR("cannot set listen socket non-blocking");
+    	return GSI_NET_RC_ERROR;
+    }
+
+    // Epoll of the listen socket, connections are added when accepted
+    p_this->i_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (0 > p_this->i_epoll_fd)
+    {
+    	p_this->i_epoll_fd = 0;
+    	LOG_ERROR("epoll create failed");
+    	return GSI_NET_RC_ERROR;
+    }
+
+    // Liveness of connections
+    p_this->p_wheel = (struct gsi_timer_wheel *)malloc(sizeof(struct gsi_timer_wheel));
+    if (NULL == p_this->p_wheel)
+    {
+    	LOG_ERROR("memory allocation for timer wheel failed");
+    	return GSI_NET_RC_ERROR;
+    }
+
+    gsi_tw_init(p_this->p_wheel, GSI_IS_LIVENESS_TICK_MSECS, gsi_tw_now_ms());
+
+    p_this->a_events[0].events = EPOLLIN;
+    p_this->a_events[0].data.ptr = p_this;
+    if (0 > epoll_ctl(p_this->i_epoll_fd, EPOLL_CTL_ADD, p_this->i_listen_fd, &p_this->a_events[0]))
+    {
+    	LOG_ERROR("epoll add of listen socket failed");
+    	return GSI_NET_RC_ERROR;
+    }
+
     LOG_INFO("server is listening on port %d", p_this->ui_port);
 	return GSI_NET_RC_SUCCESS;
 }
@@ -375,6 +788,9 @@ enum gsi_is_network_return_code gsi_is_network_tcp_server_poll(struct gsi_net_tc
 					LOG_ERROR("accept failed!");
 					return GSI_NET_RC_ERROR;
 				}
+
+				// New client - JSON until it sends hello
+				p_this->ui_encoding = GSI_ENC_JSON;
 				LOG_INFO("new connection accepted on port %d", p_this->ui_port);
 			}
 
@@ -392,69 +808,221 @@ enum gsi_is_network_return_code gsi_is_network_tcp_server_poll(struct gsi_net_tc
 }
 
 /*###########################################################################
-	 * Name:		gsi_is_network_tcp_server_read
-	 * Description: Read one message from the TCP Server (Conn FD).
-	 * 				Note! this function will allocate memory for the s_message buffer
-	 * 				The user is responsible to free it after use.
+	 * Name:		gsi_is_network_tcp_server_wait
+	 * Description:	Wait (epoll) for many clients on the listening port.
+	 * 				New connections are accepted, each one gets its own struct gsi_net_tcp
+	 * 				(encoding, liveness timer, last message, send buffer).
+	 * 				A connection that sent no frame (data or heart beat) for GSI_IS_LIVENESS_MSECS
+	 * 				is closed - the time the caller spends on its frame is not counted.
+	 * 				Heart beat and hello are handled here, a frame with data is read and
+	 * 				its connection is returned - use it with gsi_is_network_tcp_server_read()
+	 * 				(or gsi_is_recv_batch_msg()) and the send functions.
+	 * 				A connection that closed (or broke the protocol) is closed and freed.
+	 * 				Events of one epoll_wait() are taken one by one in the next calls.
+	 * 				The wait wakes up for the next deadline of the liveness timers only
+	 * 				(gsi_tw_next_ms()) - no polling with a short timeout is needed.
 	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Server
-	 * Parameter:   [out] char* s_msg - buffer to fill with the read message.
-	 * Return:		Success - GSI_NET_RC_SUCCESS
-	 * 				Failure	- GSI_NET_RC_ERROR
+	 * Parameter:   [out] struct gsi_net_tcp **pp_conn - connection with data (HASDATA only)
+	 * Parameter:   [in] int i_timeout_msecs - max wait for events (-1 - no limit)
+	 * Return:		Success - GSI_NET_RC_HASDATA *OR* GSI_NET_RC_SUCCESS (nothing to read)
+	 * 						  *OR* GSI_NET_RC_CONNECTERR (a connection was closed)
+	 * 				Failure - GSI_NET_RC_ERROR
 #############################################################################*/
-enum gsi_is_network_return_code gsi_is_network_tcp_server_read(struct gsi_net_tcp *p_this,
-														 	   char* s_msg)
+enum gsi_is_network_return_code gsi_is_network_tcp_server_wait(struct gsi_net_tcp *p_this,
+															   struct gsi_net_tcp **pp_conn,
+															   int i_timeout_msecs)
 {
-	int i_count = 0;
-	struct gsi_cs_tcp_message *p_msg = (struct gsi_cs_tcp_message *)s_msg;
+	struct gsi_net_tcp *p_conn = NULL;
+	long long ll_now_ms = 0;
+	long long ll_end_ms = 0;
+	long long ll_next_ms = 0;
+	int i_wait_msecs = 0;
+	unsigned int ui_events = 0;
+	int i_rc = GSI_NET_RC_SUCCESS;
 
 	// Check input validation
-	if ((NULL == p_this) || (NULL == p_msg))
+	if ((NULL == p_this) || (NULL == pp_conn) || (0 == p_this->i_epoll_fd))
 	{
 		LOG_ERROR("invalid arguments!");
 		return GSI_NET_RC_ERROR;
 	}
 
-	// Reset p_msg buffer
-	memset(p_msg, 0, sizeof(struct gsi_cs_tcp_message));
+	*pp_conn = NULL;
+	ll_now_ms = gsi_tw_now_ms();
+	ll_end_ms = ll_now_ms + i_timeout_msecs;
 
-	// Check if buffer is empty
-	if (NULL == p_this->s_last_msg)
+	// Client of the last frame waited for the server - its time starts now
+	if (NULL != p_this->p_busy)
 	{
-		if (GSI_NET_RC_ERROR == read_check_heartbeat(p_this))
-		{
-			LOG_ERROR("heartbeat failed");
-			return GSI_NET_RC_ERROR;
-		}
+		gsi_tw_set(p_this->p_wheel, &p_this->p_busy->live_timer, ll_now_ms + GSI_IS_LIVENESS_MSECS);
+		p_this->p_busy = NULL;
 	}
 
-	// Read the data from the buffer of last message
-	i_count = strlen(p_this->s_last_msg) + 1;
-
-	// Allocate memory for s_message buffer
-	p_msg->s_message = (char *)malloc(i_count);
-	if (NULL == p_msg->s_message)
+	while (1)
 	{
-		LOG_ERROR("memory allocation for s_message failed");
-		return GSI_NET_RC_ERROR;
-	}
+		// All events were handled - wait for new ones (only the first wait may block)
+		if (p_this->i_next_event >= p_this->i_events)
+		{
+			// Connections without frames for too long
+			ll_now_ms = gsi_tw_now_ms();
+			gsi_tw_expire(p_this->p_wheel, ll_now_ms, server_expire_conn, p_this);
+
+			// Until the caller's timeout, or the next deadline of a connection if it is sooner
+			i_wait_msecs = (0 > i_timeout_msecs) ? -1 : ((ll_end_ms > ll_now_ms) ? (int)(ll_end_ms - ll_now_ms) : 0);
+			ll_next_ms = gsi_tw_next_ms(p_this->p_wheel, ll_now_ms);
+			if ((0 <= ll_next_ms) && ((0 > i_wait_msecs) || (ll_next_ms < i_wait_msecs)))
+			{
+				i_wait_msecs = (int)ll_next_ms;
+			}
 
-	// Copy the message content
-	memcpy(p_msg->s_message, p_this->s_last_msg, i_count);
+			p_this->i_next_event = 0;
+			p_this->i_events = epoll_wait(p_this->i_epoll_fd, p_this->a_events, GSI_IS_MAX_EVENTS, i_wait_msecs);
+			if (0 > p_this->i_events)
+			{
+				p_this->i_events = 0;
+				if (EINTR == errno)
+				{
+					return GSI_NET_RC_SUCCESS;
+				}
 
-	// Set message length
-	p_msg->ui_len = i_count;
+				LOG_ERROR("epoll wait failed (errno %d)", errno);
+				return GSI_NET_RC_ERROR;
+			}
 
-	// Set message type
-	p_msg->e_type_msg = GSI_REGULAR_MSG;
+			// Woke up for a deadline - expire it, and wait again for the rest of the timeout
+			if (0 == p_this->i_events)
+			{
+				if ((0 <= i_timeout_msecs) && (gsi_tw_now_ms() >= ll_end_ms))
+				{
+					return GSI_NET_RC_SUCCESS;
+				}
 
-	// Copy the content of ui_port
-	p_msg->ui_port = p_this->ui_port;
+				continue;
+			}
 
-	// Reset the last message buffer for the next message
-	free(p_this->s_last_msg);
-	p_this->s_last_msg = NULL;
+			i_timeout_msecs = 0;
+			ll_end_ms = 0;
+		}
 
-	LOG_INFO("server read new message");
+		ui_events = p_this->a_events[p_this->i_next_event].events;
+		p_conn = (struct gsi_net_tcp *)p_this->a_events[p_this->i_next_event++].data.ptr;
+
+		// Connection was closed after the wait
+		if (NULL == p_conn)
+		{
+			continue;
+		}
+
+		// Listen socket - new clients
+		if (p_conn == p_this)
+		{
+			if (GSI_NET_RC_SUCCESS != server_accept(p_this))
+			{
+				return GSI_NET_RC_ERROR;
+			}
+
+			continue;
+		}
+
+		// Socket takes bytes again - write the answers that wait for it
+		if ((EPOLLOUT & ui_events) && (GSI_NET_RC_SUCCESS != server_flush_out(p_conn)))
+		{
+			server_close_conn(p_this, p_conn);
+			return GSI_NET_RC_CONNECTERR;
+		}
+
+		if (0 == ((EPOLLIN | EPOLLHUP | EPOLLERR) & ui_events))
+		{
+			continue;
+		}
+
+		// One frame of connection (level triggered - more frames come in next waits)
+		i_rc = read_check_heartbeat(p_conn);
+		if (GSI_NET_RC_HASDATA == i_rc)
+		{
+			// Deadline is set again when the caller is done with the frame (next wait)
+			p_this->p_busy = p_conn;
+			*pp_conn = p_conn;
+			return GSI_NET_RC_HASDATA;
+		}
+
+		// Heart beat (or hello) - any frame is liveness
+		if (GSI_NET_RC_SUCCESS == i_rc)
+		{
+			gsi_tw_set(p_this->p_wheel, &p_conn->live_timer, gsi_tw_now_ms() + GSI_IS_LIVENESS_MSECS);
+			continue;
+		}
+
+		if (GSI_NET_RC_SUCCESS != i_rc)
+		{
+			server_close_conn(p_this, p_conn);
+			return GSI_NET_RC_CONNECTERR;
+		}
+	}
+}
+
+/*###########################################################################
+	 * Name:		gsi_is_network_tcp_server_read
+	 * Description: Read one message from the TCP Server (Conn FD).
+	 * 				Note! the buffer of the received message is moved to s_message (no copy)
+	 * 				e_type_msg is GSI_REGULAR_MSG *OR* GSI_BATCH_MSG.
+	 * 				ui_len is the content length: with the '\0' for JSON, as sent for binary.
+	 * 				The user is responsible to free it after use.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Server
+	 * Parameter:   [out] char* s_msg - buffer to fill with the read message.
+	 * Return:		Success - GSI_NET_RC_SUCCESS
+	 * 				Failure	- GSI_NET_RC_ERROR
+#############################################################################*/
+enum gsi_is_network_return_code gsi_is_network_tcp_server_read(struct gsi_net_tcp *p_this,
+														 	   char* s_msg)
+{
+	int i_count = 0;
+	struct gsi_cs_tcp_message *p_msg = (struct gsi_cs_tcp_message *)s_msg;
+
+	// Check input validation
+	if ((NULL == p_this) || (NULL == p_msg))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_NET_RC_ERROR;
+	}
+
+	// Reset p_msg buffer
+	memset(p_msg, 0, sizeof(struct gsi_cs_tcp_message));
+
+	// Check if buffer is empty
+	if (NULL == p_this->s_last_msg)
+	{
+		if (GSI_NET_RC_ERROR == read_check_heartbeat(p_this))
+		{
+			LOG_ERROR("heartbeat failed");
+			return GSI_NET_RC_ERROR;
+		}
+
+		// Heart beat, hello or part of a frame - no message yet
+		if (NULL == p_this->s_last_msg)
+		{
+			LOG_ERROR("no message to read");
+			return GSI_NET_RC_ERROR;
+		}
+	}
+
+	// Length of message (JSON is '\0' terminated, binary may contain '\0')
+	i_count = (GSI_ENC_BINARY == p_this->ui_encoding) ? p_this->ui_last_len : strlen(p_this->s_last_msg) + 1;
+
+	// Move the buffer of last message to s_message
+	p_msg->s_message = p_this->s_last_msg;
+	p_this->s_last_msg = NULL;
+
+	// Set message length
+	p_msg->ui_len = i_count;
+
+	// Set message type
+	p_msg->e_type_msg = p_this->e_last_type;
+
+	// Copy the content of ui_port
+	p_msg->ui_port = p_this->ui_port;
+
+	LOG_INFO("server read new message");
 	return GSI_NET_RC_SUCCESS;
 }
 
@@ -474,6 +1042,19 @@ enum gsi_is_network_return_code gsi_is_network_tcp_server_cleanup(struct gsi_net
 		return GSI_NET_RC_ERROR;
 	}
 
+	// Free the send buffer, a frame that was not read to the end and answers that were not written
+	free(p_this->p_send_buf);
+	p_this->p_send_buf = NULL;
+	p_this->ui_send_buf_size = 0;
+	free(p_this->p_in_body);
+	p_this->p_in_body = NULL;
+	p_this->ui_in_header = 0;
+	free(p_this->p_out);
+	p_this->p_out = NULL;
+	p_this->ui_out_size = 0;
+	p_this->ui_out_off = 0;
+	p_this->ui_out_len = 0;
+
 	// Close connection socket (if open)
 	if (p_this->i_connection_fd)
 	{
@@ -488,6 +1069,28 @@ enum gsi_is_network_return_code gsi_is_network_tcp_server_cleanup(struct gsi_net
 		p_this->pfds[GSI_IS_POLL_SOCKET_CONNECT].events = 0;
 	}
 
+	// Close connections of server wait
+	for (unsigned int ui_fd = 0; (0 < p_this->ui_conns) && (ui_fd < p_this->ui_conns_cap); ++ui_fd)
+	{
+		if (NULL != p_this->pp_conns[ui_fd])
+		{
+			server_close_conn(p_this, p_this->pp_conns[ui_fd]);
+		}
+	}
+
+	free(p_this->pp_conns);
+	p_this->pp_conns = NULL;
+	p_this->ui_conns_cap = 0;
+
+	free(p_this->p_wheel);
+	p_this->p_wheel = NULL;
+
+	if (0 < p_this->i_epoll_fd)
+	{
+		close(p_this->i_epoll_fd);
+		p_this->i_epoll_fd = 0;
+	}
+
 	// Close listen socket
 	if (0 > close(p_this->i_listen_fd))
 	{
@@ -548,14 +1151,21 @@ static char* set_address_parameters(struct gsi_net_tcp *p_this, char* s_tcp_addr
 /*###########################################################################
 	 * Name:		read_check_heartbeat
 	 * Description: Read from connection fd when it is ready,
-	 * 				Check if there is data or just heartbeat message
+	 * 				Check if there is data or just heartbeat message.
+	 * 				Reads until the frame is complete or the socket has no more bytes -
+	 * 				a partial frame is kept in p_this (in_header / p_in_body) and the
+	 * 				next call goes on from there.
 	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Server
-	 * Return:		Success - GSI_NET_RC_HASDATA *OR* GSI_NET_RC_SUCCESS(non empty buffer)
+	 * Return:		Success - GSI_NET_RC_HASDATA *OR* GSI_NET_RC_SUCCESS(non empty buffer,
+	 * 						  heart beat, hello *OR* part of a frame)
 	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR
 #############################################################################*/
 static enum gsi_is_network_return_code read_check_heartbeat(struct gsi_net_tcp *p_this)
 {
-	struct gsi_cs_tcp_message msg;
+	struct gsi_cs_tcp_message *p_msg = NULL;
+	unsigned int ui_header_len = sizeof(struct gsi_cs_tcp_message) - sizeof(char *);
+	unsigned int ui_offer = 0;
+	int i_rc = GSI_NET_RC_SUCCESS;
 
 	// Check input validation
 	if (NULL == p_this)
@@ -564,105 +1174,675 @@ static enum gsi_is_network_return_code read_check_heartbeat(struct gsi_net_tcp *
 		return GSI_NET_RC_ERROR;
 	}
 
-	// Reset message
-	memset(&msg, 0, sizeof(msg));
+	// Last message was not taken yet
+	if (NULL != p_this->s_last_msg)
+	{
+		return GSI_NET_RC_SUCCESS;
+	}
 
-	// Check if buffer is empty
-	if (NULL == p_this->s_last_msg)
+	p_msg = &p_this->in_header;
+
+	// Header (may come in parts) - it tells what is the message length
+	if (ui_header_len > p_this->ui_in_header)
 	{
-		// Read part of the structure to know what is the message length
-		int i_count = read(p_this->i_connection_fd, &msg, sizeof(msg) - sizeof(char *));
-		if (0 > i_count)
+		i_rc = read_resume(p_this->i_connection_fd, (char *)p_msg, ui_header_len, &p_this->ui_in_header);
+		if (GSI_NET_RC_CONNECTERR == i_rc)
 		{
-			LOG_ERROR("read failed");
-			return GSI_NET_RC_ERROR;
+			LOG_ERROR("client on port %d closed his channel", p_this->ui_port);
+			return i_rc;
 		}
-		else if (0 < i_count)
+
+		if (GSI_NET_RC_SUCCESS != i_rc)
+		{
+			LOG_ERROR("read header failed");
+			return i_rc;
+		}
+
+		// Rest of header comes later
+		if (ui_header_len > p_this->ui_in_header)
 		{
-			LOG_DEBUG("first read %d bytes from fd: %d", i_count, p_this->i_connection_fd);
-			LOG_DEBUG("msg type: %d", msg.e_type_msg);
-			LOG_DEBUG("msg length: %d", msg.ui_len);
+			return GSI_NET_RC_SUCCESS;
+		}
+
+		LOG_DEBUG("msg type: %d", p_msg->e_type_msg);
+		LOG_DEBUG("msg length: %d", p_msg->ui_len);
 
-			switch(msg.e_type_msg)
+		switch (p_msg->e_type_msg)
+		{
+			// Liveness is by time (see gsi_is_network_tcp_server_wait()), not by count
+			case GSI_REGULAR_MSG:
+			case GSI_BATCH_MSG:
+				break;
+			case GSI_HELLO_MSG:
 			{
-				case GSI_REGULAR_MSG:
+				if (sizeof(ui_offer) != p_msg->ui_len)
 				{
-					if (GSI_IS_MAX_MSG_COUNT > p_this->i_msg_count)
-					{
-						// Allocate memory for last message (free it in server_read function)
-						p_this->s_last_msg = (char *)calloc(msg.ui_len, sizeof(char));
-						if (NULL == p_this->s_last_msg)
-						{
-							LOG_ERROR("memory allocation for last message failed");
-							return GSI_NET_RC_ERROR;
-						}
-
-						// Read the message form the connection_fd
-						int i_count = 0;
-						int i_res = 0;
-						int i_len = msg.ui_len;
-						while (0 != i_len)
-						{
-							i_count = read(p_this->i_connection_fd, p_this->s_last_msg + i_res, i_len);
-							if (0 > i_count)
-							{
-								free(p_this->s_last_msg);
-								p_this->s_last_msg = NULL;
-
-								LOG_ERROR("read failed");
-								return GSI_NET_RC_ERROR;
-							}
-
-							i_res += i_count;
-							i_len -= i_count;
-						}
-
-						LOG_DEBUG("second read %d bytes from fd: %d", i_count, p_this->i_connection_fd);
-						LOG_DEBUG("is message complete: %d", (strlen(p_this->s_last_msg) == (i_count - 1)));
-
-						// Update the message counter
-						++(p_this->i_msg_count);
-
-						// Reset the heart beat in case that we are in the first message
-						if (1 == p_this->i_msg_count)
-						{
-							p_this->i_heartbeat = 0;
-						}
-
-						LOG_INFO("has data");
-						return GSI_NET_RC_HASDATA;
-					}
-					else if ((GSI_IS_MAX_MSG_COUNT <= p_this->i_msg_count) && (p_this->i_heartbeat != 1))
-					{
-						// Enter here if after MAX_MSG_COUNT messages there is no heart beat
-						LOG_ERROR("client on port %d is not responding...closing connection", p_this->ui_port);
-						return GSI_NET_RC_CONNECTERR;
-					}
-					break;
+					LOG_ERROR("bad hello length %u", p_msg->ui_len);
+					return GSI_NET_RC_ERROR;
 				}
-				case GSI_HEARTBEAT_MSG:
-				{
-					// Enter here if we got heart beat message
-					++(p_this->i_heartbeat);
 
-					// Reset message counter for next phase
-					p_this->i_msg_count = 0;
-					LOG_INFO("got heartbeat from port: %d\n", p_this->ui_port);
+				break;
+			}
+			case GSI_HEARTBEAT_MSG:
+			{
+				// Enter here if we got heart beat message (the reader sets liveness)
+				LOG_INFO("got heartbeat from port: %d\n", p_this->ui_port);
 
-					break;
-				}
-				default:
-					LOG_ERROR("classified message failed");
-					return GSI_NET_RC_ERROR;
+				p_this->ui_in_header = 0;
+				return GSI_NET_RC_SUCCESS;
+			}
+			default:
+				LOG_ERROR("classified message failed");
+				return GSI_NET_RC_ERROR;
+
+		} /* end  of switch case */
 
-			} /* end  of switch case */
+		// Allocate memory for content (moved to last message when it is complete)
+		// No need to zero it - it is filled by read() and ended here
+		p_this->p_in_body = (char *)malloc((size_t)p_msg->ui_len + 1);
+		if (NULL == p_this->p_in_body)
+		{
+			LOG_ERROR("memory allocation for last message failed");
+			return GSI_NET_RC_ERROR;
 		}
-		else // i_count = 0 so there is connection error
+
+		p_this->p_in_body[p_msg->ui_len] = '\0';
+		p_this->ui_in_body = 0;
+	}
+
+	// Content (may come in parts)
+	i_rc = read_resume(p_this->i_connection_fd, p_this->p_in_body, p_msg->ui_len, &p_this->ui_in_body);
+	if (GSI_NET_RC_SUCCESS != i_rc)
+	{
+		LOG_ERROR("read failed");
+		return i_rc;
+	}
+
+	// Rest of content comes later
+	if (p_msg->ui_len > p_this->ui_in_body)
+	{
+		return GSI_NET_RC_SUCCESS;
+	}
+
+	LOG_DEBUG("read %u bytes of content from fd: %d", p_msg->ui_len, p_this->i_connection_fd);
+
+	// Frame is complete - next read starts with a header
+	p_this->ui_in_header = 0;
+
+	if (GSI_HELLO_MSG == p_msg->e_type_msg)
+	{
+		// Client offers encodings - JSON is always known, binary is preferred
+		char a_answer[sizeof(struct gsi_cs_tcp_message) - sizeof(char *) + sizeof(unsigned int)];
+
+		memcpy(&ui_offer, p_this->p_in_body, sizeof(ui_offer));
+		free(p_this->p_in_body);
+		p_this->p_in_body = NULL;
+
+		p_this->ui_encoding = (GSI_ENC_BINARY & ui_offer) ? GSI_ENC_BINARY : GSI_ENC_JSON;
+
+		// Answer with the chosen encoding
+		p_msg->ui_port = p_this->ui_port;
+		memcpy(a_answer, p_msg, ui_header_len);
+		memcpy(a_answer + ui_header_len, &p_this->ui_encoding, sizeof(unsigned int));
+
+		if (GSI_NET_RC_SUCCESS != gsi_is_network_tcp_send_frames(p_this, a_answer, sizeof(a_answer)))
+		{
+			LOG_ERROR("answer to hello failed");
+			return GSI_NET_RC_ERROR;
+		}
+
+		LOG_INFO("port %d uses encoding %u", p_this->ui_port, p_this->ui_encoding);
+		return GSI_NET_RC_SUCCESS;
+	}
+
+	// Last message is moved to the reader in server_read function
+	p_this->s_last_msg = p_this->p_in_body;
+	p_this->ui_last_len = p_msg->ui_len;
+	p_this->e_last_type = p_msg->e_type_msg;
+	p_this->p_in_body = NULL;
+
+	LOG_INFO("has data");
+	return GSI_NET_RC_HASDATA;
+}
+
+/*###########################################################################
+	 * Name:		read_all
+	 * Description: Read exactly ui_len bytes from fd (more than one read() if needed)
+	 * Parameter:   [in] int i_fd - fd to read from
+	 * Parameter:   [out] void* p_buf - buffer to fill
+	 * Parameter:   [in] unsigned int ui_len - bytes to read
+	 * Return:		Success - GSI_NET_RC_SUCCESS
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR (closed in the middle)
+#############################################################################*/
+static enum gsi_is_network_return_code read_all(int i_fd, void* p_buf, unsigned int ui_len)
+{
+	ssize_t l_count = 0;
+	unsigned int ui_res = 0;
+
+	while (ui_res < ui_len)
+	{
+		l_count = read(i_fd, (char *)p_buf + ui_res, ui_len - ui_res);
+		if (0 > l_count)
+		{
+			return GSI_NET_RC_ERROR;
+		}
+
+		// Other side closed before the whole message was sent
+		if (0 == l_count)
 		{
-			LOG_ERROR("client on port %d closed his channel", p_this->ui_port);
 			return GSI_NET_RC_CONNECTERR;
 		}
+
+		ui_res += (unsigned int)l_count;
 	}
 
 	return GSI_NET_RC_SUCCESS;
 }
+
+/*###########################################################################
+	 * Name:		read_resume
+	 * Description: Go on reading p_buf from *p_done up to ui_len bytes, until it is full
+	 * 				or a non blocking fd has no more bytes (a blocking fd waits for all)
+	 * Parameter:   [in] int i_fd - fd to read from
+	 * Parameter:   [out] char* p_buf - buffer to fill
+	 * Parameter:   [in] unsigned int ui_len - size of p_buf
+	 * Parameter:   [in,out] unsigned int* p_done - bytes of p_buf that were read
+	 * Return:		Success - GSI_NET_RC_SUCCESS (full when *p_done == ui_len)
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR (closed)
+#############################################################################*/
+static enum gsi_is_network_return_code read_resume(int i_fd, char* p_buf, unsigned int ui_len, unsigned int* p_done)
+{
+	ssize_t l_count = 0;
+
+	while (*p_done < ui_len)
+	{
+		l_count = read(i_fd, p_buf + *p_done, ui_len - *p_done);
+		if (0 > l_count)
+		{
+			if (EINTR == errno)
+			{
+				continue;
+			}
+
+			// Nothing more for now - the rest comes with the next ready event
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+			{
+				return GSI_NET_RC_SUCCESS;
+			}
+
+			return GSI_NET_RC_ERROR;
+		}
+
+		// Other side closed
+		if (0 == l_count)
+		{
+			return GSI_NET_RC_CONNECTERR;
+		}
+
+		*p_done += (unsigned int)l_count;
+	}
+
+	return GSI_NET_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		write_resume
+	 * Description: Go on writing p_buf from *p_done up to ui_len bytes, until all is written
+	 * 				or the socket buffer of a non blocking fd is full (a blocking fd waits)
+	 * Parameter:   [in] int i_fd - socket to write to
+	 * Parameter:   [in] const char* p_buf - bytes to write
+	 * Parameter:   [in] unsigned int ui_len - size of p_buf
+	 * Parameter:   [in,out] unsigned int* p_done - bytes of p_buf that were written
+	 * Return:		Success - GSI_NET_RC_SUCCESS (all written when *p_done == ui_len)
+	 * 				Failure - GSI_NET_RC_ERROR
+#############################################################################*/
+static enum gsi_is_network_return_code write_resume(int i_fd, const char* p_buf, unsigned int ui_len, unsigned int* p_done)
+{
+	ssize_t l_count = 0;
+
+	while (*p_done < ui_len)
+	{
+		// Closed peer is an error of this connection, not a signal of the process
+		l_count = send(i_fd, p_buf + *p_done, ui_len - *p_done, MSG_NOSIGNAL);
+		if (0 > l_count)
+		{
+			if (EINTR == errno)
+			{
+				continue;
+			}
+
+			// Socket buffer is full - the rest goes when it is writable again
+			if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+			{
+				return GSI_NET_RC_SUCCESS;
+			}
+
+			return GSI_NET_RC_ERROR;
+		}
+
+		*p_done += (unsigned int)l_count;
+	}
+
+	return GSI_NET_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		client_hello_exchange
+	 * Description: Offer p_this->ui_offered to the server and wait up to
+	 * 				GSI_IS_HELLO_TIMEOUT_MSECS for the one it chose.
+	 * 				Without answer the connection stays with JSON.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Client
+	 * Return:		Success - GSI_NET_RC_SUCCESS (p_this->ui_encoding is set)
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR (hello was not sent)
+#############################################################################*/
+static enum gsi_is_network_return_code client_hello_exchange(struct gsi_net_tcp *p_this)
+{
+	struct gsi_cs_tcp_message msg;
+	unsigned int ui_header_len = sizeof(msg) - sizeof(char *);
+	unsigned int ui_encodings = p_this->ui_offered;
+	unsigned int ui_chosen = 0;
+	unsigned int ui_sent = 0;
+	ssize_t l_count = 0;
+	char a_hello[sizeof(msg) + sizeof(ui_encodings)];
+	struct pollfd pfd;
+	int i_rc = GSI_NET_RC_SUCCESS;
+
+	// Until the server answers
+	p_this->ui_encoding = GSI_ENC_JSON;
+
+	// Build hello message: header + offered encodings (not in the send buffer - it may
+	// hold the message that waits for this reconnect)
+	memset(&msg, 0, sizeof(msg));
+	msg.ui_port = p_this->ui_port;
+	msg.e_type_msg = GSI_HELLO_MSG;
+	msg.ui_len = sizeof(ui_encodings);
+
+	memcpy(a_hello, &msg, ui_header_len);
+	memcpy(a_hello + ui_header_len, &ui_encodings, sizeof(ui_encodings));
+
+	// Plain write - a broken connection is reconnected by the caller
+	for (ui_sent = 0; ui_sent < ui_header_len + sizeof(ui_encodings); ui_sent += (unsigned int)l_count)
+	{
+		l_count = write(p_this->i_connection_fd, a_hello + ui_sent, ui_header_len + sizeof(ui_encodings) - ui_sent);
+		if (0 > l_count)
+		{
+			LOG_ERROR("send hello failed");
+			return GSI_NET_RC_CONNECTERR;
+		}
+	}
+
+	p_this->ll_sent_ms = gsi_tw_now_ms();
+
+	// Wait for the answer - server that doesn't know hello will not answer
+	pfd.fd = p_this->i_connection_fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	if (0 >= poll(&pfd, 1, GSI_IS_HELLO_TIMEOUT_MSECS))
+	{
+		LOG_WARNING("no answer to hello on port %d, use JSON", p_this->ui_port);
+		return GSI_NET_RC_SUCCESS;
+	}
+
+	// Read answer: header + chosen encoding
+	i_rc = read_all(p_this->i_connection_fd, &msg, ui_header_len);
+	if ((GSI_NET_RC_SUCCESS == i_rc) &&
+		((GSI_HELLO_MSG != msg.e_type_msg) || (sizeof(ui_chosen) != msg.ui_len)))
+	{
+		i_rc = GSI_NET_RC_ERROR;
+	}
+
+	if (GSI_NET_RC_SUCCESS == i_rc)
+	{
+		i_rc = read_all(p_this->i_connection_fd, &ui_chosen, sizeof(ui_chosen));
+	}
+
+	if (GSI_NET_RC_SUCCESS != i_rc)
+	{
+		LOG_ERROR("bad answer to hello");
+		return i_rc;
+	}
+
+	// Exactly one of the offered encodings
+	if ((0 == (ui_chosen & ui_encodings)) || (0 != (ui_chosen & (ui_chosen - 1))))
+	{
+		LOG_ERROR("server chose encoding %u that was not offered", ui_chosen);
+		return GSI_NET_RC_ERROR;
+	}
+
+	p_this->ui_encoding = ui_chosen;
+
+	LOG_INFO("port %d uses encoding %u", p_this->ui_port, ui_chosen);
+	return GSI_NET_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		client_reconnect
+	 * Description: Close the connection of client and connect again. The new
+	 * 				connection is JSON until the hello is answered (if the client
+	 * 				said hello before, it is said again).
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Client
+	 * Return:		Success - GSI_NET_RC_SUCCESS (p_this->ui_encoding is set)
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR
+#############################################################################*/
+static enum gsi_is_network_return_code client_reconnect(struct gsi_net_tcp *p_this)
+{
+	enum gsi_is_network_return_code e_rc = GSI_NET_RC_SUCCESS;
+
+	if (0 < p_this->i_connection_fd)
+	{
+		close(p_this->i_connection_fd);
+	}
+
+	p_this->i_connection_fd = -1;
+
+	// Server starts every connection with JSON
+	p_this->ui_encoding = GSI_ENC_JSON;
+
+	e_rc = gsi_is_network_tcp_connect(&p_this->serv_addr, &p_this->i_connection_fd);
+	if (GSI_NET_RC_SUCCESS != e_rc)
+	{
+		if (0 <= p_this->i_connection_fd)
+		{
+			close(p_this->i_connection_fd);
+		}
+		p_this->i_connection_fd = -1;
+		return e_rc;
+	}
+
+	if (0 != p_this->ui_offered)
+	{
+		e_rc = client_hello_exchange(p_this);
+	}
+
+	return e_rc;
+}
+
+/*###########################################################################
+	 * Name:		server_accept
+	 * Description: Accept all pending clients of listen socket, each one
+	 * 				gets its own struct gsi_net_tcp in p_this->pp_conns (by fd)
+	 * 				and is added to the epoll of server
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Server
+	 * Return:		Success - GSI_NET_RC_SUCCESS
+	 * 				Failure - GSI_NET_RC_ERROR
+#############################################################################*/
+static enum gsi_is_network_return_code server_accept(struct gsi_net_tcp *p_this)
+{
+	struct gsi_net_tcp **pp_conns = NULL;
+	struct gsi_net_tcp *p_conn = NULL;
+	struct epoll_event event;
+	unsigned int ui_new_cap = 0;
+	int i_fd = 0;
+
+	// Non blocking - a client that sends part of a frame (or doesn't read) must not hold the others
+	while (0 <= (i_fd = accept4(p_this->i_listen_fd, (struct sockaddr*)NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)))
+	{
+		// Grow array of connections to hold this fd
+		if ((unsigned int)i_fd >= p_this->ui_conns_cap)
+		{
+			ui_new_cap = (0 == p_this->ui_conns_cap) ? GSI_IS_CONNS_INIT_CAP : p_this->ui_conns_cap;
+			while (ui_new_cap <= (unsigned int)i_fd)
+			{
+				ui_new_cap *= 2;
+			}
+
+			pp_conns = (struct gsi_net_tcp **)realloc(p_this->pp_conns, ui_new_cap * sizeof(*pp_conns));
+			if (NULL == pp_conns)
+			{
+				LOG_ERROR("memory allocation for connections failed");
+				close(i_fd);
+				continue;
+			}
+
+			memset(pp_conns + p_this->ui_conns_cap, 0, (ui_new_cap - p_this->ui_conns_cap) * sizeof(*pp_conns));
+			p_this->pp_conns = pp_conns;
+			p_this->ui_conns_cap = ui_new_cap;
+		}
+
+		p_conn = (struct gsi_net_tcp *)calloc(1, sizeof(struct gsi_net_tcp));
+		if (NULL == p_conn)
+		{
+			LOG_ERROR("memory allocation for connection failed");
+			close(i_fd);
+			continue;
+		}
+
+		// Connection of server - answers without reconnect, JSON until it sends hello
+		p_conn->s_tcp_addr = p_this->s_tcp_addr;
+		p_conn->ui_port = p_this->ui_port;
+		p_conn->i_listen_fd = p_this->i_listen_fd;
+		p_conn->i_connection_fd = i_fd;
+		p_conn->i_epoll_fd = p_this->i_epoll_fd;
+		p_conn->ui_encoding = GSI_ENC_JSON;
+
+		event.events = EPOLLIN;
+		event.data.ptr = p_conn;
+		if (0 > epoll_ctl(p_this->i_epoll_fd, EPOLL_CTL_ADD, i_fd, &event))
+		{
+			LOG_ERROR("epoll add of connection failed");
+			close(i_fd);
+			free(p_conn);
+			continue;
+		}
+
+		p_this->pp_conns[i_fd] = p_conn;
+		++(p_this->ui_conns);
+
+		p_conn->live_timer.p_data = p_conn;
+		gsi_tw_set(p_this->p_wheel, &p_conn->live_timer, gsi_tw_now_ms() + GSI_IS_LIVENESS_MSECS);
+
+		LOG_INFO("new connection accepted on port %d (%u open)", p_this->ui_port, p_this->ui_conns);
+	}
+
+	// No more pending clients
+	if ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (ECONNABORTED == errno) || (EINTR == errno))
+	{
+		return GSI_NET_RC_SUCCESS;
+	}
+
+	// Out of fds - the client waits in listen queue until a connection is closed
+	if ((EMFILE == errno) || (ENFILE == errno))
+	{
+		LOG_WARNING("accept on port %d: out of file descriptors", p_this->ui_port);
+		return GSI_NET_RC_SUCCESS;
+	}
+
+	LOG_ERROR("accept failed (errno %d)", errno);
+	return GSI_NET_RC_ERROR;
+}
+
+/*###########################################################################
+	 * Name:		server_close_conn
+	 * Description: Close connection of server wait and free it
+	 * 				(events of it that were not handled yet are dropped)
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - pointer to structure TCP Server
+	 * Parameter:   [in] struct gsi_net_tcp *p_conn - connection to close
+	 * Return:		None
+#############################################################################*/
+static void server_close_conn(struct gsi_net_tcp *p_this, struct gsi_net_tcp *p_conn)
+{
+	int i_index = 0;
+
+	for (i_index = p_this->i_next_event; i_index < p_this->i_events; ++i_index)
+	{
+		if (p_conn == p_this->a_events[i_index].data.ptr)
+		{
+			p_this->a_events[i_index].data.ptr = NULL;
+		}
+	}
+
+	gsi_tw_cancel(p_this->p_wheel, &p_conn->live_timer);
+	if (p_conn == p_this->p_busy)
+	{
+		p_this->p_busy = NULL;
+	}
+
+	epoll_ctl(p_this->i_epoll_fd, EPOLL_CTL_DEL, p_conn->i_connection_fd, NULL);
+	close(p_conn->i_connection_fd);
+
+	p_this->pp_conns[p_conn->i_connection_fd] = NULL;
+	--(p_this->ui_conns);
+
+	LOG_INFO("connection closed on port %d (%u open)", p_this->ui_port, p_this->ui_conns);
+
+	free(p_conn->s_last_msg);
+	free(p_conn->p_in_body);
+	free(p_conn->p_out);
+	free(p_conn->p_send_buf);
+	free(p_conn);
+}
+
+/*###########################################################################
+	 * Name:		server_send
+	 * Description: Write answer frames to a client without waiting for it: what the
+	 * 				socket doesn't take is added to p_this->p_out and written on EPOLLOUT
+	 * 				(see server_flush_out()). Answers that wait there go first.
+	 * 				A client that leaves more than GSI_IS_MAX_OUT bytes unread is shut down
+	 * 				(the next wait closes it).
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - connection of server
+	 * Parameter:   [in] const char* p_frames - frames to send
+	 * Parameter:   [in] unsigned int ui_len - bytes to send
+	 * Return:		Success - GSI_NET_RC_SUCCESS (written *OR* queued)
+	 * 				Failure - GSI_NET_RC_ERROR *OR* GSI_NET_RC_CONNECTERR
+#############################################################################*/
+static enum gsi_is_network_return_code server_send(struct gsi_net_tcp *p_this, const char* p_frames, unsigned int ui_len)
+{
+	struct epoll_event event;
+	unsigned int ui_sent = 0;
+	unsigned int ui_queued = p_this->ui_out_len - p_this->ui_out_off;
+	unsigned int ui_new_size = 0;
+	char* p_out = NULL;
+
+	// Nothing waits before these bytes - write what the socket takes now
+	if ((0 == ui_queued) &&
+		(GSI_NET_RC_SUCCESS != write_resume(p_this->i_connection_fd, p_frames, ui_len, &ui_sent)))
+	{
+		LOG_ERROR("write to client on port %d failed", p_this->ui_port);
+		return GSI_NET_RC_CONNECTERR;
+	}
+
+	if (ui_sent == ui_len)
+	{
+		return GSI_NET_RC_SUCCESS;
+	}
+
+	// Only a connection of server wait gets EPOLLOUT (the socket of server poll blocks)
+	if ((0 >= p_this->i_epoll_fd) || (GSI_IS_MAX_OUT - ui_queued < ui_len - ui_sent))
+	{
+		LOG_ERROR("client on port %d doesn't read its answers", p_this->ui_port);
+		shutdown(p_this->i_connection_fd, SHUT_RDWR);
+		return GSI_NET_RC_CONNECTERR;
+	}
+
+	// No room after the queued bytes - move them to the start, and grow by doubling if still small
+	if (p_this->ui_out_size - p_this->ui_out_len < ui_len - ui_sent)
+	{
+		if (0 < ui_queued)
+		{
+			memmove(p_this->p_out, p_this->p_out + p_this->ui_out_off, ui_queued);
+		}
+
+		p_this->ui_out_off = 0;
+		p_this->ui_out_len = ui_queued;
+
+		if (p_this->ui_out_size - ui_queued < ui_len - ui_sent)
+		{
+			ui_new_size = (0 == p_this->ui_out_size) ? GSI_IS_SEND_BUF_MIN : p_this->ui_out_size;
+			while (ui_new_size - ui_queued < ui_len - ui_sent)
+			{
+				ui_new_size *= 2;
+			}
+
+			p_out = (char *)realloc(p_this->p_out, ui_new_size);
+			if (NULL == p_out)
+			{
+				LOG_ERROR("memory allocation for answers of port %d failed", p_this->ui_port);
+				return GSI_NET_RC_ERROR;
+			}
+
+			p_this->p_out = p_out;
+			p_this->ui_out_size = ui_new_size;
+		}
+	}
+
+	memcpy(p_this->p_out + p_this->ui_out_len, p_frames + ui_sent, ui_len - ui_sent);
+	p_this->ui_out_len += ui_len - ui_sent;
+
+	// First bytes that wait - get told when the socket takes bytes again
+	if (0 == ui_queued)
+	{
+		event.events = EPOLLIN | EPOLLOUT;
+		event.data.ptr = p_this;
+		if (0 > epoll_ctl(p_this->i_epoll_fd, EPOLL_CTL_MOD, p_this->i_connection_fd, &event))
+		{
+			LOG_ERROR("epoll of answers on port %d failed (errno %d)", p_this->ui_port, errno);
+			return GSI_NET_RC_ERROR;
+		}
+	}
+
+	return GSI_NET_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		server_flush_out
+	 * Description: On EPOLLOUT, write the answers that wait in p_this->p_out.
+	 * 				When all were written the connection waits for EPOLLIN only.
+	 * Parameter:   [in] struct gsi_net_tcp *p_this - connection of server
+	 * Return:		Success - GSI_NET_RC_SUCCESS
+	 * 				Failure - GSI_NET_RC_CONNECTERR
+#############################################################################*/
+static enum gsi_is_network_return_code server_flush_out(struct gsi_net_tcp *p_this)
+{
+	struct epoll_event event;
+
+	if (GSI_NET_RC_SUCCESS != write_resume(p_this->i_connection_fd, p_this->p_out,
+										   p_this->ui_out_len, &p_this->ui_out_off))
+	{
+		LOG_ERROR("write to client on port %d failed", p_this->ui_port);
+		return GSI_NET_RC_CONNECTERR;
+	}
+
+	// Socket is full again - wait for the next EPOLLOUT
+	if (p_this->ui_out_off < p_this->ui_out_len)
+	{
+		return GSI_NET_RC_SUCCESS;
+	}
+
+	p_this->ui_out_off = 0;
+	p_this->ui_out_len = 0;
+
+	event.events = EPOLLIN;
+	event.data.ptr = p_this;
+	if (0 > epoll_ctl(p_this->i_epoll_fd, EPOLL_CTL_MOD, p_this->i_connection_fd, &event))
+	{
+		LOG_ERROR("epoll of port %d failed (errno %d)", p_this->ui_port, errno);
+		return GSI_NET_RC_CONNECTERR;
+	}
+
+	return GSI_NET_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		server_expire_conn
+	 * Description: Liveness timer of connection expired - close it, unless frames of
+	 * 				it wait to be read (the server was busy, not the client)
+	 * Parameter:   [in] struct gsi_tw_timer* p_timer - live_timer of connection
+	 * Parameter:   [in] void* p_arg - pointer to structure TCP Server
+	 * Return:		None
+#############################################################################*/
+static void server_expire_conn(struct gsi_tw_timer* p_timer, void* p_arg)
+{
+	struct gsi_net_tcp *p_this = (struct gsi_net_tcp *)p_arg;
+	struct gsi_net_tcp *p_conn = (struct gsi_net_tcp *)p_timer->p_data;
+	char c_peek = 0;
+
+	if (0 < recv(p_conn->i_connection_fd, &c_peek, sizeof(c_peek), MSG_PEEK | MSG_DONTWAIT))
+	{
+		gsi_tw_set(p_this->p_wheel, p_timer, gsi_tw_now_ms() + GSI_IS_LIVENESS_MSECS);
+		return;
+	}
+
+	LOG_ERROR("client on port %d is not responding...closing connection", p_this->ui_port);
+	server_close_conn(p_this, p_conn);
+}
@@ -0,0 +1,357 @@
+/**************************************************************************
+* Name : gsi_is_timer_wheel.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Implementation of "gsi_is_timer_wheel.h"
+*****************************************************************************/
+
+/* Includes */
+#include <stdlib.h>
+#include <time.h>
+#include "gsi_is_timer_wheel.h"
+
+/********************************/
+/* Static functions declaration */
+/********************************/
+static void gsi_tw_insert(struct gsi_timer_wheel* p_wheel, struct gsi_tw_timer* p_timer);
+static void gsi_tw_remove(struct gsi_timer_wheel* p_wheel, struct gsi_tw_timer* p_timer);
+static void gsi_tw_take(struct gsi_timer_wheel* p_wheel, unsigned int ui_level, unsigned int ui_slot, struct gsi_tw_timer* p_taken);
+static void gsi_tw_link(struct gsi_tw_timer* p_head, struct gsi_tw_timer* p_timer);
+static void gsi_tw_unlink(struct gsi_tw_timer* p_timer);
+
+/**********************/
+/* API implementation */
+/**********************/
+/*###########################################################################
+	 * Name:		gsi_tw_now_ms
+	 * Description: Time now for deadlines of timers (CLOCK_MONOTONIC)
+	 * Return:		Milliseconds
+#############################################################################*/
+long long gsi_tw_now_ms()
+{
+	struct timespec ts_now;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts_now);
+
+	return (long long)ts_now.tv_sec * 1000 + ts_now.tv_nsec / 1000000;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tw_init
+	 * Description: Reset wheel to no timers
+	 * Parameter:   [in] struct gsi_timer_wheel* p_wheel - wheel to reset
+	 * Parameter:   [in] unsigned int ui_tick_msecs - milliseconds of tick
+	 * Parameter:   [in] long long ll_now_ms - time now (gsi_tw_now_ms())
+	 * Return:		Success - GSI_TW_RC_SUCCESS
+	 * 				Failure - GSI_TW_RC_INVALID
+#############################################################################*/
+enum gsi_tw_rc gsi_tw_init(struct gsi_timer_wheel* p_wheel, unsigned int ui_tick_msecs, long long ll_now_ms)
+{
+	unsigned int ui_level = 0;
+	unsigned int ui_slot = 0;
+
+	// Check input validation
+	if ((NULL == p_wheel) || (0 == ui_tick_msecs))
+	{
+		return GSI_TW_RC_INVALID;
+	}
+
+	// Each slot is an empty circular list (its head points to itself)
+	for (ui_level = 0; ui_level < GSI_TW_LEVELS; ++ui_level)
+	{
+		for (ui_slot = 0; ui_slot < GSI_TW_LEVEL_SLOTS; ++ui_slot)
+		{
+			p_wheel->a_slots[ui_level][ui_slot].p_next = &p_wheel->a_slots[ui_level][ui_slot];
+			p_wheel->a_slots[ui_level][ui_slot].p_prev = &p_wheel->a_slots[ui_level][ui_slot];
+		}
+
+		p_wheel->a_level_timers[ui_level] = 0;
+	}
+
+	p_wheel->ui_tick_msecs = ui_tick_msecs;
+	p_wheel->ll_tick = ll_now_ms / ui_tick_msecs;
+	p_wheel->ui_timers = 0;
+
+	return GSI_TW_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tw_set
+	 * Description: Set timer to expire at ll_expire_ms (moved if it is set already),
+	 * 				in the first tick that starts at it or after it (at most a tick late).
+	 * 				Deadline that passed expires in the next tick.
+	 * Parameter:   [in] struct gsi_timer_wheel* p_wheel - wheel
+	 * Parameter:   [in] struct gsi_tw_timer* p_timer - timer (p_data is kept)
+	 * Parameter:   [in] long long ll_expire_ms - deadline
+	 * Return:		Success - GSI_TW_RC_SUCCESS
+	 * 				Failure - GSI_TW_RC_INVALID
+#############################################################################*/
+enum gsi_tw_rc gsi_tw_set(struct gsi_timer_wheel* p_wheel, struct gsi_tw_timer* p_timer, long long ll_expire_ms)
+{
+	// Check input validation
+	if ((NULL == p_wheel) || (NULL == p_timer))
+	{
+		return GSI_TW_RC_INVALID;
+	}
+
+	if (NULL != p_timer->p_next)
+	{
+		gsi_tw_remove(p_wheel, p_timer);
+	}
+
+	p_timer->ll_expire_ms = ll_expire_ms;
+	gsi_tw_insert(p_wheel, p_timer);
+
+	return GSI_TW_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tw_cancel
+	 * Description: Remove timer from wheel (nothing if it is not set)
+	 * Parameter:   [in] struct gsi_timer_wheel* p_wheel - wheel
+	 * Parameter:   [in] struct gsi_tw_timer* p_timer - timer
+	 * Return:		Success - GSI_TW_RC_SUCCESS
+	 * 				Failure - GSI_TW_RC_INVALID
+#############################################################################*/
+enum gsi_tw_rc gsi_tw_cancel(struct gsi_timer_wheel* p_wheel, struct gsi_tw_timer* p_timer)
+{
+	// Check input validation
+	if ((NULL == p_wheel) || (NULL == p_timer))
+	{
+		return GSI_TW_RC_INVALID;
+	}
+
+	if (NULL != p_timer->p_next)
+	{
+		gsi_tw_remove(p_wheel, p_timer);
+	}
+
+	return GSI_TW_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tw_next_ms
+	 * Description: Time until the wheel must be expired again: the next tick with
+	 * 				timers in level 0, or the next cascade of the upper levels
+	 * 				(at most GSI_TW_LEVEL_SLOTS slots are looked at)
+	 * Parameter:   [in] const struct gsi_timer_wheel* p_wheel - wheel
+	 * Parameter:   [in] long long ll_now_ms - time now (gsi_tw_now_ms())
+	 * Return:		Milliseconds (0 - a deadline passed), -1 - no timers
+#############################################################################*/
+long long gsi_tw_next_ms(const struct gsi_timer_wheel* p_wheel, long long ll_now_ms)
+{
+	const struct gsi_tw_timer* p_head = NULL;
+	long long ll_tick = 0;
+	long long ll_next_ms = 0;
+	int b_upper = 0;
+
+	// Check input validation
+	if ((NULL == p_wheel) || (0 == p_wheel->ui_timers))
+	{
+		return -1;
+	}
+
+	b_upper = (p_wheel->ui_timers > p_wheel->a_level_timers[0]);
+
+	// A cascade comes every GSI_TW_LEVEL_SLOTS ticks - the wheel is looked at until it
+	for (ll_tick = p_wheel->ll_tick + 1; ll_tick < p_wheel->ll_tick + GSI_TW_LEVEL_SLOTS; ++ll_tick)
+	{
+		p_head = &p_wheel->a_slots[0][ll_tick & GSI_TW_LEVEL_MASK];
+		if ((p_head->p_next != p_head) || (b_upper && (0 == (ll_tick & GSI_TW_LEVEL_MASK))))
+		{
+			break;
+		}
+	}
+
+	ll_next_ms = ll_tick * p_wheel->ui_tick_msecs - ll_now_ms;
+
+	return (0 < ll_next_ms) ? ll_next_ms : 0;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tw_expire
+	 * Description: Take the ticks passed since the last call (cascade of upper levels
+	 * 				when their slot is reached), and call p_func for each timer its
+	 * 				deadline passed
+	 * Parameter:   [in] struct gsi_timer_wheel* p_wheel - wheel
+	 * Parameter:   [in] long long ll_now_ms - time now (gsi_tw_now_ms())
+	 * Parameter:   [in] gsi_tw_func p_func - called for each expired timer
+	 * Parameter:   [in] void* p_arg - passed to p_func
+	 * Return:		Number of expired timers
+#############################################################################*/
+unsigned int gsi_tw_expire(struct gsi_timer_wheel* p_wheel, long long ll_now_ms, gsi_tw_func p_func, void* p_arg)
+{
+	struct gsi_tw_timer taken;
+	struct gsi_tw_timer* p_head = NULL;
+	struct gsi_tw_timer* p_timer = NULL;
+	long long ll_now_tick = 0;
+	long long ll_tick = 0;
+	unsigned int ui_level = 0;
+	unsigned int ui_expired = 0;
+
+	// Check input validation
+	if ((NULL == p_wheel) || (NULL == p_func))
+	{
+		return 0;
+	}
+
+	ll_now_tick = ll_now_ms / p_wheel->ui_tick_msecs;
+
+	while ((p_wheel->ll_tick < ll_now_tick) && (0 < p_wheel->ui_timers))
+	{
+		ll_tick = p_wheel->ll_tick + 1;
+
+		// Start of a slot of level n - its timers go down (level n + 1 first, if it starts too)
+		for (ui_level = 1; ui_level < GSI_TW_LEVELS; ++ui_level)
+		{
+			if (0 != (ll_tick & ((1LL << (GSI_TW_LEVEL_BITS * ui_level)) - 1)))
+			{
+				break;
+			}
+		}
+
+		while (1 < ui_level--)
+		{
+			gsi_tw_take(p_wheel, ui_level, (ll_tick >> (GSI_TW_LEVEL_BITS * ui_level)) & GSI_TW_LEVEL_MASK, &taken);
+
+			while (taken.p_next != &taken)
+			{
+				p_timer = taken.p_next;
+				gsi_tw_unlink(p_timer);
+				gsi_tw_insert(p_wheel, p_timer);
+			}
+		}
+
+		// Timers set from p_func go after this tick - never into its slot
+		p_wheel->ll_tick = ll_tick;
+		p_head = &p_wheel->a_slots[0][ll_tick & GSI_TW_LEVEL_MASK];
+
+		while (p_head->p_next != p_head)
+		{
+			p_timer = p_head->p_next;
+			gsi_tw_remove(p_wheel, p_timer);
+
+			++ui_expired;
+			p_func(p_timer, p_arg);
+		}
+	}
+
+	// No timers - nothing to take until now
+	if (p_wheel->ll_tick < ll_now_tick)
+	{
+		p_wheel->ll_tick = ll_now_tick;
+	}
+
+	return ui_expired;
+}
+
+/***********************************/
+/* Static functions implementation */
+/***********************************/
+/*###########################################################################
+	 * Name:		gsi_tw_insert
+	 * Description: Link timer into the slot of its deadline: level 0 if it is in
+	 * 				the next GSI_TW_LEVEL_SLOTS ticks, else the level that its distance
+	 * 				fits in (deadline that passed - the next tick)
+	 * Parameter:   [in] struct gsi_timer_wheel* p_wheel - wheel
+	 * Parameter:   [in] struct gsi_tw_timer* p_timer - timer (not set, ll_expire_ms is set)
+	 * Return:		None
+#############################################################################*/
+static void gsi_tw_insert(struct gsi_timer_wheel* p_wheel, struct gsi_tw_timer* p_timer)
+{
+	long long ll_tick = 0;
+	long long ll_delta = 0;
+	unsigned int ui_level = 0;
+
+	// First tick that starts at the deadline or after it - never early
+	ll_tick = (p_timer->ll_expire_ms + p_wheel->ui_tick_msecs - 1) / p_wheel->ui_tick_msecs;
+	if (ll_tick <= p_wheel->ll_tick)
+	{
+		ll_tick = p_wheel->ll_tick + 1;
+	}
+
+	// Distance from the first tick that is not taken yet
+	ll_delta = ll_tick - (p_wheel->ll_tick + 1);
+
+	// Further than the wheel - the last slot of the last level, set again when reached
+	if (ll_delta >= (1LL << (GSI_TW_LEVEL_BITS * GSI_TW_LEVELS)))
+	{
+		ll_delta = (1LL << (GSI_TW_LEVEL_BITS * GSI_TW_LEVELS)) - 1;
+		ll_tick = p_wheel->ll_tick + 1 + ll_delta;
+	}
+
+	for (ui_level = 0; ll_delta >= (1LL << (GSI_TW_LEVEL_BITS * (ui_level + 1))); ++ui_level);
+
+	p_timer->ui_level = ui_level;
+	gsi_tw_link(&p_wheel->a_slots[ui_level][(ll_tick >> (GSI_TW_LEVEL_BITS * ui_level)) & GSI_TW_LEVEL_MASK], p_timer);
+	++p_wheel->a_level_timers[ui_level];
+	++p_wheel->ui_timers;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tw_remove
+	 * Description: Unlink timer from its slot (it is not set after it)
+	 * Parameter:   [in] struct gsi_timer_wheel* p_wheel - wheel
+	 * Parameter:   [in] struct gsi_tw_timer* p_timer - timer that is set
+	 * Return:		None
+#############################################################################*/
+static void gsi_tw_remove(struct gsi_timer_wheel* p_wheel, struct gsi_tw_timer* p_timer)
+{
+	gsi_tw_unlink(p_timer);
+	--p_wheel->a_level_timers[p_timer->ui_level];
+	--p_wheel->ui_timers;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tw_take
+	 * Description: Move all timers of slot into a list (they are not counted as set)
+	 * Parameter:   [in] struct gsi_timer_wheel* p_wheel - wheel
+	 * Parameter:   [in] unsigned int ui_level - level of slot
+	 * Parameter:   [in] unsigned int ui_slot - slot
+	 * Parameter:   [out] struct gsi_tw_timer* p_taken - head of list of the timers
+	 * Return:		None
+#############################################################################*/
+static void gsi_tw_take(struct gsi_timer_wheel* p_wheel, unsigned int ui_level, unsigned int ui_slot, struct gsi_tw_timer* p_taken)
+{
+	struct gsi_tw_timer* p_head = &p_wheel->a_slots[ui_level][ui_slot];
+	struct gsi_tw_timer* p_timer = NULL;
+
+	p_taken->p_next = p_taken;
+	p_taken->p_prev = p_taken;
+
+	while (p_head->p_next != p_head)
+	{
+		p_timer = p_head->p_next;
+		gsi_tw_remove(p_wheel, p_timer);
+		gsi_tw_link(p_taken, p_timer);
+	}
+}
+
+/*###########################################################################
+	 * Name:		gsi_tw_link
+	 * Description: Add timer at the end of list
+	 * Parameter:   [in] struct gsi_tw_timer* p_head - head of list
+	 * Parameter:   [in] struct gsi_tw_timer* p_timer - timer to add
+	 * Return:		None
+#############################################################################*/
+static void gsi_tw_link(struct gsi_tw_timer* p_head, struct gsi_tw_timer* p_timer)
+{
+	p_timer->p_next = p_head;
+	p_timer->p_prev = p_head->p_prev;
+	p_head->p_prev->p_next = p_timer;
+	p_head->p_prev = p_timer;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tw_unlink
+	 * Description: Remove timer from its list (it is not set after it)
+	 * Parameter:   [in] struct gsi_tw_timer* p_timer - timer to remove
+	 * Return:		None
+#############################################################################*/
+static void gsi_tw_unlink(struct gsi_tw_timer* p_timer)
+{
+	p_timer->p_prev->p_next = p_timer->p_next;
+	p_timer->p_next->p_prev = p_timer->p_prev;
+	p_timer->p_next = NULL;
+	p_timer->p_prev = NULL;
+}
@@ -0,0 +1,187 @@
+/**************************************************************************
+* Name : gsi_replay.h
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Compiled messages file of client (replay file).
+* 				gsi_replay_compile() reads a messages file once, as
+* 				gsi_is_send_all_json_msg() does, and writes the ready to send
+* 				frames (header of struct gsi_cs_tcp_message and content) into
+* 				a file, with an index of the frames:
+* 					file header | frames | (padding to 8) | index
+* 				A client maps the file and writes it to the socket as is - no
+* 				read of lines, no tokenizers and no encode on each run.
+* 				Frames are compiled for one port and one encoding, the client
+* 				must use the same (see gsi_replay_send()).
+* 				Using: 1. gsi_replay_compile() - offline (see gsi_replay_compile tool)
+* 					   2. gsi_replay_open() - map the file and check its index
+* 					   3. gsi_replay_send() - as much as you want (or gsi_replay_get_frames()).
+* 					   4. gsi_replay_close() - Must be last!
+*****************************************************************************/
+#ifndef GSI_REPLAY_H_
+#define GSI_REPLAY_H_
+
+/* Includes */
+#include <stdio.h>
+#include <stdint.h>
+#include "gsi_is_network_tcp.h"
+
+/* Defines and Macros */
+#define 	GSI_RP_FILE_MAGIC			0x31505247			/* "GRP1" */
+#define 	GSI_RP_MAX_WRITE			(1024 * 1024)		/* frames are written up to this size at once */
+
+/* Typedef */
+typedef struct gsi_replay gsi_replay_t;
+
+/* Enums */
+/***************************************************************************
+ * Name:  		gsi_replay_rc
+ * Description: Return Code values for GSI-REPLAY functions
+ ***************************************************************************/
+enum gsi_replay_rc {
+	GSI_RP_RC_SUCCESS   = 0,	// Function completed Successfully
+	GSI_RP_RC_ERROR     = 1,	// Function completed with Error
+	GSI_RP_RC_INVALID   = 2,	// Function got invalid arguments
+	GSI_RP_RC_MISMATCH  = 3		// Replay was compiled for another port / encoding
+};
+
+/* Structures */
+/*****************************************************************************
+ * Name : gsi_replay_file_hdr
+ * Used by: replay files
+ * Warning: On-disk format - DONT change the order or size of the members!
+ * Members:
+ *----------------------------------------------------------------------------
+ *		uint32_t ui_magic - GSI_RP_FILE_MAGIC
+ *----------------------------------------------------------------------------
+ *		uint32_t ui_encoding - encoding of the frames (GSI_ENC_JSON *OR* GSI_ENC_BINARY)
+ *----------------------------------------------------------------------------
+ *		uint32_t ui_port - port in the header of the frames
+ *----------------------------------------------------------------------------
+ *		uint32_t ui_frames - number of frames (entries of index)
+ *----------------------------------------------------------------------------
+ *		uint64_t ul_index_offset - offset of index in file (8 aligned)
+ *****************************************************************************/
+struct gsi_replay_file_hdr
+{
+	uint32_t ui_magic;
+	uint32_t ui_encoding;
+	uint32_t ui_port;
+	uint32_t ui_frames;
+	uint64_t ul_index_offset;
+};
+
+/*****************************************************************************
+ * Name : gsi_replay_frame
+ * Used by: index of replay files
+ * Warning: On-disk format - DONT change the order or size of the members!
+ * Members:
+ *----------------------------------------------------------------------------
+ *		uint64_t ul_offset - offset of frame in file
+ *----------------------------------------------------------------------------
+ *		uint32_t ui_len - length of frame (header and content)
+ *----------------------------------------------------------------------------
+ *		uint16_t us_type - type of frame (gsi_is_type_message)
+ *----------------------------------------------------------------------------
+ *		uint16_t us_msgs - messages in frame (results of batch reply)
+ *****************************************************************************/
+struct gsi_replay_frame
+{
+	uint64_t ul_offset;
+	uint32_t ui_len;
+	uint16_t us_type;
+	uint16_t us_msgs;
+};
+
+/*****************************************************************************
+ * Name : gsi_replay
+ * Used by: GSI-REPLAY API functions
+ * Members:
+ *----------------------------------------------------------------------------
+ *		char* p_map - the mapped file
+ *----------------------------------------------------------------------------
+ *		size_t ul_map_len - length of the mapping (file size)
+ *----------------------------------------------------------------------------
+ *		struct gsi_replay_file_hdr hdr - copy of the file header
+ *----------------------------------------------------------------------------
+ *		const struct gsi_replay_frame* p_frames - index in the mapping
+ *****************************************************************************/
+struct gsi_replay
+{
+	char* p_map;
+	size_t ul_map_len;
+	struct gsi_replay_file_hdr hdr;
+	const struct gsi_replay_frame* p_frames;
+};
+
+/*******************/
+/* API Declaration */
+/*******************/
+/*###########################################################################
+	 * Name:		gsi_replay_compile
+	 * Description: Compile messages file into replay file. The frames are the ones
+	 * 				gsi_is_send_all_json_msg() sends with the same batch size.
+	 * 				On failure the replay file is removed.
+	 * Parameter:   [in] FILE* f_msg_file - messages file (gsi_is_open_msg_file())
+	 * Parameter:   [in] const char* s_out - replay file to write (replaced if exists)
+	 * Parameter:   [in] unsigned int ui_port - port of client
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Parameter:   [in] int i_batch_size - max messages in one frame (1 - no batches)
+	 * Return:		Success - GSI_RP_RC_SUCCESS
+	 * 				Failure - GSI_RP_RC_ERROR *OR* GSI_RP_RC_INVALID
+#############################################################################*/
+enum gsi_replay_rc gsi_replay_compile(FILE* f_msg_file, const char* s_out, unsigned int ui_port,
+									  unsigned int ui_encoding, int i_batch_size);
+
+
+/*###########################################################################
+	 * Name:		gsi_replay_open
+	 * Description: Map replay file (read ahead) and check its header and index.
+	 * 				Must use gsi_replay_close() after use!
+	 * Parameter:   [in] const char* s_file - replay file
+	 * Return:		Success - pointer to new replay object
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_replay_t* gsi_replay_open(const char* s_file);
+
+
+/*###########################################################################
+	 * Name:		gsi_replay_send
+	 * Description: Send all frames of replay file from client to server.
+	 * 				Frames are written from the mapping as they are, up to
+	 * 				GSI_RP_MAX_WRITE bytes at once. A write ends with a batch frame,
+	 * 				and its reply is waited for before the next one.
+	 * Parameter:   [in] gsi_replay_t* p_replay - replay object
+	 * Parameter:   [in] struct gsi_net_tcp* p_client - connected client (after hello)
+	 * Return:		Success - GSI_RP_RC_SUCCESS
+	 * 				Failure - GSI_RP_RC_ERROR *OR* GSI_RP_RC_INVALID
+	 * 						  *OR* GSI_RP_RC_MISMATCH (port / encoding of client)
+#############################################################################*/
+enum gsi_replay_rc gsi_replay_send(gsi_replay_t* p_replay, struct gsi_net_tcp* p_client);
+
+
+/*###########################################################################
+	 * Name:		gsi_replay_get_frames
+	 * Description: Get the index of replay and the mapping its offsets are in,
+	 * 				for a sender of its own (e.g. event loop of many connections).
+	 * 				Valid until gsi_replay_close().
+	 * Parameter:   [in] gsi_replay_t* p_replay - replay object
+	 * Parameter:   [out] const char** pp_map - start of the mapped file
+	 * Parameter:   [out] unsigned int* p_frames - number of frames
+	 * Return:		Success - index of frames (header of replay has port and encoding)
+	 * 				Failure - NULL
+#############################################################################*/
+const struct gsi_replay_frame* gsi_replay_get_frames(gsi_replay_t* p_replay, const char** pp_map,
+													unsigned int* p_frames);
+
+
+/*###########################################################################
+	 * Name:		gsi_replay_close
+	 * Description: Unmap replay file and free the object
+	 * Parameter:   [in] gsi_replay_t* p_replay - replay to close
+	 * Return:		Success - GSI_RP_RC_SUCCESS
+	 * 				Failure - GSI_RP_RC_ERROR *OR* GSI_RP_RC_INVALID
+#############################################################################*/
+enum gsi_replay_rc gsi_replay_close(gsi_replay_t* p_replay);
+
+
+#endif /* GSI_REPLAY_H_ */
@@ -0,0 +1,521 @@
+/**************************************************************************
+* Name : gsi_replay.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Implementation of "gsi_replay.h"
+* 				Every use of gsi_replay_open() must also use gsi_replay_close() !
+*****************************************************************************/
+
+/* Includes */
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "gsi_replay.h"
+#include "gsi_build_parse_data.h"
+#include "gsi_is_log_api.h"
+
+/* Defines and Macros */
+#define 	GSI_RP_TRUE					1
+#define 	GSI_RP_FALSE				0
+#define 	GSI_RP_HDR_SIZE				(sizeof(struct gsi_replay_file_hdr))
+#define 	GSI_RP_FRAME_SIZE			(sizeof(struct gsi_replay_frame))
+#define 	GSI_RP_INDEX_INIT_CAP		256
+#define 	GSI_RP_ALIGN				8
+
+/* Structures */
+/*****************************************************************************
+ * Name : gsi_replay_compile_ctx
+ * Used by: gsi_replay_compile() (argument of its frame function)
+ * Members:
+ *----------------------------------------------------------------------------
+ *		FILE* f_out - replay file being written
+ *----------------------------------------------------------------------------
+ *		char* p_buf, size_t ul_buf_size - buffer of one frame
+ *----------------------------------------------------------------------------
+ *		uint64_t ul_offset - offset in file of the next frame
+ *----------------------------------------------------------------------------
+ *		struct gsi_replay_frame* p_frames - index so far
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_frames, ui_cap - used / allocated entries of index
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_port, ui_encoding - port and encoding of the frames
+ *****************************************************************************/
+struct gsi_replay_compile_ctx
+{
+	FILE* f_out;
+	char* p_buf;
+	size_t ul_buf_size;
+	uint64_t ul_offset;
+	struct gsi_replay_frame* p_frames;
+	unsigned int ui_frames;
+	unsigned int ui_cap;
+	unsigned int ui_port;
+	unsigned int ui_encoding;
+};
+
+/********************************/
+/* Static functions declaration */
+/********************************/
+static int replay_compile_frame(struct gsi_json_msg* p_json_msgs, int i_count, void* p_arg);
+static int replay_write_index(struct gsi_replay_compile_ctx* p_ctx);
+static int replay_check(gsi_replay_t* p_replay);
+
+/**********************/
+/* API implementation */
+/**********************/
+/*###########################################################################
+	 * Name:		gsi_replay_compile
+	 * Description: Compile messages file into replay file. The frames are the ones
+	 * 				gsi_is_send_all_json_msg() sends with the same batch size.
+	 * 				On failure the replay file is removed.
+	 * Parameter:   [in] FILE* f_msg_file - messages file (gsi_is_open_msg_file())
+	 * Parameter:   [in] const char* s_out - replay file to write (replaced if exists)
+	 * Parameter:   [in] unsigned int ui_port - port of client
+	 * Parameter:   [in] unsigned int ui_encoding - GSI_ENC_JSON *OR* GSI_ENC_BINARY
+	 * Parameter:   [in] int i_batch_size - max messages in one frame (1 - no batches)
+	 * Return:		Success - GSI_RP_RC_SUCCESS
+	 * 				Failure - GSI_RP_RC_ERROR *OR* GSI_RP_RC_INVALID
+#############################################################################*/
+enum gsi_replay_rc gsi_replay_compile(FILE* f_msg_file, const char* s_out, unsigned int ui_port,
+									  unsigned int ui_encoding, int i_batch_size)
+{
+	struct gsi_replay_compile_ctx ctx;
+	struct gsi_replay_file_hdr hdr;
+	int i_ok = GSI_RP_FALSE;
+
+	// Check input validation
+	if ((NULL == f_msg_file) || (NULL == s_out) ||
+		((GSI_ENC_JSON != ui_encoding) && (GSI_ENC_BINARY != ui_encoding)))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_RP_RC_INVALID;
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+	memset(&hdr, 0, sizeof(hdr));
+
+	ctx.ui_port = ui_port;
+	ctx.ui_encoding = ui_encoding;
+	ctx.ul_offset = GSI_RP_HDR_SIZE;
+
+	ctx.f_out = fopen(s_out, "wb");
+	if (NULL == ctx.f_out)
+	{
+		LOG_ERROR("couldn't create replay file %s (errno %d)", s_out, errno);
+		return GSI_RP_RC_ERROR;
+	}
+
+	// Header is written last, when the index offset is known
+	if (1 == fwrite(&hdr, GSI_RP_HDR_SIZE, 1, ctx.f_out))
+	{
+		if ((GSI_JSON_SUCCESS == gsi_is_read_all_frames(f_msg_file, i_batch_size, replay_compile_frame, &ctx)) &&
+			(GSI_RP_TRUE == replay_write_index(&ctx)))
+		{
+			hdr.ui_magic = GSI_RP_FILE_MAGIC;
+			hdr.ui_encoding = ui_encoding;
+			hdr.ui_port = ui_port;
+			hdr.ui_frames = ctx.ui_frames;
+			hdr.ul_index_offset = ctx.ul_offset;
+
+			i_ok = (0 == fseek(ctx.f_out, 0, SEEK_SET)) && (1 == fwrite(&hdr, GSI_RP_HDR_SIZE, 1, ctx.f_out));
+		}
+	}
+
+	if (0 != fclose(ctx.f_out))
+	{
+		i_ok = GSI_RP_FALSE;
+	}
+
+	free(ctx.p_buf);
+	free(ctx.p_frames);
+
+	if (GSI_RP_TRUE != i_ok)
+	{
+		LOG_ERROR("compile of replay file %s failed", s_out);
+		unlink(s_out);
+		return GSI_RP_RC_ERROR;
+	}
+
+	LOG_INFO("replay file %s: %u frames, %lu bytes", s_out, hdr.ui_frames,
+			 (unsigned long)(hdr.ul_index_offset + hdr.ui_frames * GSI_RP_FRAME_SIZE));
+	return GSI_RP_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_replay_open
+	 * Description: Map replay file (read ahead) and check its header and index.
+	 * 				Must use gsi_replay_close() after use!
+	 * Parameter:   [in] const char* s_file - replay file
+	 * Return:		Success - pointer to new replay object
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_replay_t* gsi_replay_open(const char* s_file)
+{
+	gsi_replay_t* p_replay = NULL;
+	struct stat st;
+	int i_fd = -1;
+
+	// Check input validation
+	if (NULL == s_file)
+	{
+		LOG_ERROR("invalid arguments!");
+		return NULL;
+	}
+
+	i_fd = open(s_file, O_RDONLY);
+	if (0 > i_fd)
+	{
+		LOG_ERROR("couldn't open replay file %s (errno %d)", s_file, errno);
+		return NULL;
+	}
+
+	if ((0 != fstat(i_fd, &st)) || ((off_t)GSI_RP_HDR_SIZE > st.st_size))
+	{
+		LOG_ERROR("replay file %s is too short", s_file);
+		close(i_fd);
+		return NULL;
+	}
+
+	// Allocate new replay
+	p_replay = (gsi_replay_t*)calloc(1, sizeof(gsi_replay_t));
+	if (NULL == p_replay)
+	{
+		LOG_ERROR("memory allocation for replay failed");
+		close(i_fd);
+		return NULL;
+	}
+
+	// The whole file is sent - read it in now, not page by page on send
+	p_replay->ul_map_len = (size_t)st.st_size;
+	p_replay->p_map = (char*)mmap(NULL, p_replay->ul_map_len, PROT_READ, MAP_PRIVATE | MAP_POPULATE, i_fd, 0);
+	close(i_fd);
+
+	if (MAP_FAILED == p_replay->p_map)
+	{
+		LOG_ERROR("couldn't map replay file %s (errno %d)", s_file, errno);
+		free(p_replay);
+		return NULL;
+	}
+
+	madvise(p_replay->p_map, p_replay->ul_map_len, MADV_SEQUENTIAL);
+
+	memcpy(&p_replay->hdr, p_replay->p_map, GSI_RP_HDR_SIZE);
+
+	if (GSI_RP_TRUE != replay_check(p_replay))
+	{
+		LOG_ERROR("bad replay file %s", s_file);
+		munmap(p_replay->p_map, p_replay->ul_map_len);
+		free(p_replay);
+		return NULL;
+	}
+
+	LOG_INFO("replay file %s: %u frames for port %u", s_file, p_replay->hdr.ui_frames, p_replay->hdr.ui_port);
+	return p_replay;
+}
+
+/*###########################################################################
+	 * Name:		gsi_replay_send
+	 * Description: Send all frames of replay file from client to server.
+	 * 				Frames are written from the mapping as they are, up to
+	 * 				GSI_RP_MAX_WRITE bytes at once. A write ends with a batch frame,
+	 * 				and its reply is waited for before the next one.
+	 * Parameter:   [in] gsi_replay_t* p_replay - replay object
+	 * Parameter:   [in] struct gsi_net_tcp* p_client - connected client (after hello)
+	 * Return:		Success - GSI_RP_RC_SUCCESS
+	 * 				Failure - GSI_RP_RC_ERROR *OR* GSI_RP_RC_INVALID
+	 * 						  *OR* GSI_RP_RC_MISMATCH (port / encoding of client)
+#############################################################################*/
+enum gsi_replay_rc gsi_replay_send(gsi_replay_t* p_replay, struct gsi_net_tcp* p_client)
+{
+	const struct gsi_replay_frame* p_frame = NULL;
+	unsigned int ui_first = 0;
+	unsigned int ui_next = 0;
+	size_t ul_len = 0;
+
+	// Check input validation
+	if ((NULL == p_replay) || (NULL == p_client))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_RP_RC_INVALID;
+	}
+
+	// Frames are ready - the connection must be the one they were compiled for
+	if ((p_replay->hdr.ui_port != p_client->ui_port) || (p_replay->hdr.ui_encoding != p_client->ui_encoding))
+	{
+		LOG_ERROR("replay of port %u encoding %u, connection of port %u encoding %u",
+				  p_replay->hdr.ui_port, p_replay->hdr.ui_encoding, p_client->ui_port, p_client->ui_encoding);
+		return GSI_RP_RC_MISMATCH;
+	}
+
+	for (ui_first = 0; ui_first < p_replay->hdr.ui_frames; ui_first = ui_next)
+	{
+		// Frames are one after the other in file (checked on open)
+		ul_len = 0;
+		for (ui_next = ui_first; ui_next < p_replay->hdr.ui_frames; )
+		{
+			p_frame = &p_replay->p_frames[ui_next];
+			if ((0 != ul_len) && (GSI_RP_MAX_WRITE < ul_len + p_frame->ui_len))
+			{
+				break;
+			}
+
+			ul_len += p_frame->ui_len;
+			++ui_next;
+
+			if (GSI_BATCH_MSG == p_frame->us_type)
+			{
+				break;
+			}
+		}
+
+		if (GSI_NET_RC_SUCCESS != gsi_is_network_tcp_send_frames(p_client,
+					p_replay->p_map + p_replay->p_frames[ui_first].ul_offset, (unsigned int)ul_len))
+		{
+			LOG_ERROR("send of replay failed on port %d", p_client->ui_port);
+			return GSI_RP_RC_ERROR;
+		}
+
+		// Last frame of write is batch - wait for its results
+		p_frame = &p_replay->p_frames[ui_next - 1];
+		if ((GSI_BATCH_MSG == p_frame->us_type) &&
+			(GSI_JSON_SUCCESS != gsi_is_recv_batch_reply(p_client, p_frame->us_msgs)))
+		{
+			return GSI_RP_RC_ERROR;
+		}
+	}
+
+	LOG_INFO("replay of %u frames sent", p_replay->hdr.ui_frames);
+	return GSI_RP_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_replay_get_frames
+	 * Description: Get the index of replay and the mapping its offsets are in,
+	 * 				for a sender of its own (e.g. event loop of many connections).
+	 * 				Valid until gsi_replay_close().
+	 * Parameter:   [in] gsi_replay_t* p_replay - replay object
+	 * Parameter:   [out] const char** pp_map - start of the mapped file
+	 * Parameter:   [out] unsigned int* p_frames - number of frames
+	 * Return:		Success - index of frames (header of replay has port and encoding)
+	 * 				Failure - NULL
+#############################################################################*/
+const struct gsi_replay_frame* gsi_replay_get_frames(gsi_replay_t* p_replay, const char** pp_map,
+													unsigned int* p_frames)
+{
+	// Check input validation
+	if ((NULL == p_replay) || (NULL == pp_map) || (NULL == p_frames))
+	{
+		LOG_ERROR("invalid arguments!");
+		return NULL;
+	}
+
+	*pp_map = p_replay->p_map;
+	*p_frames = p_replay->hdr.ui_frames;
+
+	return p_replay->p_frames;
+}
+
+/*###########################################################################
+	 * Name:		gsi_replay_close
+	 * Description: Unmap replay file and free the object
+	 * Parameter:   [in] gsi_replay_t* p_replay - replay to close
+	 * Return:		Success - GSI_RP_RC_SUCCESS
+	 * 				Failure - GSI_RP_RC_ERROR *OR* GSI_RP_RC_INVALID
+#############################################################################*/
+enum gsi_replay_rc gsi_replay_close(gsi_replay_t* p_replay)
+{
+	enum gsi_replay_rc e_rc = GSI_RP_RC_SUCCESS;
+
+	// Check input validation
+	if (NULL == p_replay)
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_RP_RC_INVALID;
+	}
+
+	if (0 != munmap(p_replay->p_map, p_replay->ul_map_len))
+	{
+		LOG_ERROR("couldn't unmap replay file (errno %d)", errno);
+		e_rc = GSI_RP_RC_ERROR;
+	}
+
+	free(p_replay);
+
+	return e_rc;
+}
+
+/***********************************/
+/* Static functions implementation */
+/***********************************/
+/*###########################################################################
+	 * Name:		replay_compile_frame
+	 * Description: Frame function of gsi_replay_compile() - encode the frame,
+	 * 				write it to the replay file and add it to the index
+	 * Parameter:   [in] struct gsi_json_msg* p_json_msgs - messages of frame
+	 * Parameter:   [in] int i_count - number of messages
+	 * Parameter:   [in] void* p_arg - struct gsi_replay_compile_ctx*
+	 * Return:		Success - GSI_JSON_SUCCESS
+	 * 				Failure - GSI_JSON_ERROR
+#############################################################################*/
+static int replay_compile_frame(struct gsi_json_msg* p_json_msgs, int i_count, void* p_arg)
+{
+	struct gsi_replay_compile_ctx* p_ctx = (struct gsi_replay_compile_ctx*)p_arg;
+	struct gsi_replay_frame* p_frames = NULL;
+	struct gsi_replay_frame* p_frame = NULL;
+	size_t ul_bound = 0;
+	size_t ul_len = 0;
+	char* p_buf = NULL;
+
+	ul_bound = gsi_is_frame_bound(p_json_msgs, i_count, p_ctx->ui_encoding);
+	if (UINT_MAX < ul_bound)
+	{
+		LOG_ERROR("frame too long");
+		return GSI_JSON_ERROR;
+	}
+
+	// Grow the frame buffer
+	if (ul_bound > p_ctx->ul_buf_size)
+	{
+		p_buf = (char*)realloc(p_ctx->p_buf, ul_bound);
+		if (NULL == p_buf)
+		{
+			LOG_ERROR("memory allocation for frame failed");
+			return GSI_JSON_ERROR;
+		}
+
+		p_ctx->p_buf = p_buf;
+		p_ctx->ul_buf_size = ul_bound;
+	}
+
+	// Grow the index
+	if (p_ctx->ui_frames == p_ctx->ui_cap)
+	{
+		p_ctx->ui_cap = (0 == p_ctx->ui_cap) ? GSI_RP_INDEX_INIT_CAP : (2 * p_ctx->ui_cap);
+		p_frames = (struct gsi_replay_frame*)realloc(p_ctx->p_frames, p_ctx->ui_cap * GSI_RP_FRAME_SIZE);
+		if (NULL == p_frames)
+		{
+			LOG_ERROR("memory allocation for index failed");
+			return GSI_JSON_ERROR;
+		}
+
+		p_ctx->p_frames = p_frames;
+	}
+
+	ul_len = gsi_is_encode_frame(p_ctx->p_buf, p_json_msgs, i_count, p_ctx->ui_port, p_ctx->ui_encoding);
+
+	if (1 != fwrite(p_ctx->p_buf, ul_len, 1, p_ctx->f_out))
+	{
+		LOG_ERROR("write to replay file failed");
+		return GSI_JSON_ERROR;
+	}
+
+	p_frame = &p_ctx->p_frames[p_ctx->ui_frames++];
+	p_frame->ul_offset = p_ctx->ul_offset;
+	p_frame->ui_len = (uint32_t)ul_len;
+	p_frame->us_type = (uint16_t)((1 == i_count) ? p_json_msgs->i_msg_type : GSI_BATCH_MSG);
+	p_frame->us_msgs = (uint16_t)i_count;
+
+	p_ctx->ul_offset += ul_len;
+
+	return GSI_JSON_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		replay_write_index
+	 * Description: Write the index after the frames (8 aligned).
+	 * 				p_ctx->ul_offset is set to the offset of index.
+	 * Parameter:   [in] struct gsi_replay_compile_ctx* p_ctx - compile context
+	 * Return:		Success - GSI_RP_TRUE
+	 * 				Failure - GSI_RP_FALSE
+#############################################################################*/
+static int replay_write_index(struct gsi_replay_compile_ctx* p_ctx)
+{
+	static const char s_pad[GSI_RP_ALIGN] = { 0 };
+	size_t ul_pad = (GSI_RP_ALIGN - (p_ctx->ul_offset % GSI_RP_ALIGN)) % GSI_RP_ALIGN;
+
+	if ((0 != ul_pad) && (1 != fwrite(s_pad, ul_pad, 1, p_ctx->f_out)))
+	{
+		LOG_ERROR("write to replay file failed");
+		return GSI_RP_FALSE;
+	}
+
+	p_ctx->ul_offset += ul_pad;
+
+	if ((0 != p_ctx->ui_frames) &&
+		(p_ctx->ui_frames != fwrite(p_ctx->p_frames, GSI_RP_FRAME_SIZE, p_ctx->ui_frames, p_ctx->f_out)))
+	{
+		LOG_ERROR("write of index to replay file failed");
+		return GSI_RP_FALSE;
+	}
+
+	return GSI_RP_TRUE;
+}
+
+/*###########################################################################
+	 * Name:		replay_check
+	 * Description: Check the header and every entry of index against the frames,
+	 * 				so the send trusts them without checks:
+	 * 				frames are one after the other from the end of the header,
+	 * 				the header of each frame matches its entry.
+	 * 				p_replay->p_frames is set to the index.
+	 * Parameter:   [in] gsi_replay_t* p_replay - mapped replay (hdr copied)
+	 * Return:		Success - GSI_RP_TRUE
+	 * 				Failure - GSI_RP_FALSE
+#############################################################################*/
+static int replay_check(gsi_replay_t* p_replay)
+{
+	const struct gsi_replay_file_hdr* p_hdr = &p_replay->hdr;
+	const struct gsi_replay_frame* p_frame = NULL;
+	struct gsi_cs_tcp_message msg;
+	uint64_t ul_offset = GSI_RP_HDR_SIZE;
+	unsigned int ui_index = 0;
+
+	if ((GSI_RP_FILE_MAGIC != p_hdr->ui_magic) ||
+		((GSI_ENC_JSON != p_hdr->ui_encoding) && (GSI_ENC_BINARY != p_hdr->ui_encoding)) ||
+		(0 != (p_hdr->ul_index_offset % GSI_RP_ALIGN)) ||
+		(GSI_RP_HDR_SIZE > p_hdr->ul_index_offset) ||
+		(p_hdr->ul_index_offset > p_replay->ul_map_len) ||
+		((p_replay->ul_map_len - p_hdr->ul_index_offset) / GSI_RP_FRAME_SIZE != p_hdr->ui_frames) ||
+		((p_replay->ul_map_len - p_hdr->ul_index_offset) % GSI_RP_FRAME_SIZE))
+	{
+		return GSI_RP_FALSE;
+	}
+
+	p_replay->p_frames = (const struct gsi_replay_frame*)(p_replay->p_map + p_hdr->ul_index_offset);
+
+	for (ui_index = 0; ui_index < p_hdr->ui_frames; ++ui_index)
+	{
+		p_frame = &p_replay->p_frames[ui_index];
+
+		if ((ul_offset != p_frame->ul_offset) ||
+			(GSI_IS_FRAME_HEADER_LEN > p_frame->ui_len) ||
+			(p_hdr->ul_index_offset - ul_offset < p_frame->ui_len) ||
+			(1 > p_frame->us_msgs) || (GSI_IS_MAX_BATCH < p_frame->us_msgs) ||
+			((GSI_BATCH_MSG == p_frame->us_type) != (1 < p_frame->us_msgs)) ||
+			((GSI_BATCH_MSG != p_frame->us_type) && (GSI_REGULAR_MSG != p_frame->us_type) &&
+			 (GSI_HEARTBEAT_MSG != p_frame->us_type)))
+		{
+			return GSI_RP_FALSE;
+		}
+
+		memcpy(&msg, p_replay->p_map + ul_offset, GSI_IS_FRAME_HEADER_LEN);
+
+		if ((p_hdr->ui_port != msg.ui_port) || (p_frame->us_type != msg.e_type_msg) ||
+			(p_frame->ui_len - GSI_IS_FRAME_HEADER_LEN != msg.ui_len))
+		{
+			return GSI_RP_FALSE;
+		}
+
+		ul_offset += p_frame->ui_len;
+	}
+
+	// Only padding between the last frame and the index
+	return (p_hdr->ul_index_offset - ul_offset < GSI_RP_ALIGN) ? GSI_RP_TRUE : GSI_RP_FALSE;
+}
@@ -0,0 +1,95 @@
+/**************************************************************************
+* Name : gsi_replay_compile.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Offline tool - compile messages file of client into replay file
+* 				(ready to send frames and index, see "gsi_replay.h").
+* 				The client sends the replay file (client_replay in its config)
+* 				instead of reading and encoding the messages file on each run.
+* 				Port, encoding and batch size must be the ones of the client.
+* 				Usage : ./<a.out> <messages file> <replay file> <port> [json|binary] [batch size]
+*****************************************************************************/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gsi_is_log_api.h"
+#include "gsi_build_parse_data.h"
+#include "gsi_replay.h"
+
+/* Defines and Macros */
+#define 	GSI_RC_FAIL				-1
+
+/*###########################################################################
+ 	 * Name:        main.
+ 	 * Description: Entry point of the program
+ 	 * Parameter:   char** argv - [1] messages file, [2] replay file, [3] port,
+ 	 * 							  [4] encoding (json default), [5] batch size (1 default)
+ 	 * Return: 	    Success - 0
+ 	 * 				Failure - GSI_RC_FAIL
+#############################################################################*/
+int main(int argc, char **argv)
+{
+	FILE* f_messages = NULL;
+	FILE* f_log = NULL;
+	unsigned int ui_encoding = GSI_ENC_JSON;
+	int i_batch_size = 1;
+	int i_rc = GSI_RP_RC_ERROR;
+
+	if ((4 > argc) || (6 < argc))
+	{
+		printf("usage error: <a.out> <messages file> <replay file> <port> [json|binary] [batch size]\n");
+		return GSI_RC_FAIL;
+	}
+
+	if (4 < argc)
+	{
+		if (0 == strcmp(argv[4], "binary"))
+		{
+			ui_encoding = GSI_ENC_BINARY;
+		}
+		else if (0 != strcmp(argv[4], "json"))
+		{
+			printf("unknown encoding %s (json *OR* binary)\n", argv[4]);
+			return GSI_RC_FAIL;
+		}
+	}
+
+	if (5 < argc)
+	{
+		i_batch_size = atoi(argv[5]);
+	}
+
+	// Create log file
+	f_log = gsi_is_create_log_file("gsi-log-replay-compile", NULL);
+	if (NULL == f_log)
+	{
+		return GSI_RC_FAIL;
+	}
+
+	f_messages = gsi_is_open_msg_file(argv[1]);
+	if (NULL == f_messages)
+	{
+		printf("couldn't open messages file %s\n", argv[1]);
+		gsi_is_close_log(f_log);
+		return GSI_RC_FAIL;
+	}
+
+	i_rc = gsi_replay_compile(f_messages, argv[2], (unsigned int)atoi(argv[3]), ui_encoding, i_batch_size);
+
+	printf("%s: %s\n", argv[2], (GSI_RP_RC_SUCCESS == i_rc) ? "compiled" : "compile failed (see log)");
+
+	if (GSI_JSON_SUCCESS != gsi_is_close_msg_file(f_messages))
+	{
+		LOG_ERROR("couldn't close messages file");
+	}
+
+	// Close log file to free resources
+	if (GSI_LOG_RC_SUCCESS != gsi_is_close_log(f_log))
+	{
+		printf("couldn't close log file");
+	}
+
+	return (GSI_RP_RC_SUCCESS == i_rc) ? 0 : GSI_RC_FAIL;
+}
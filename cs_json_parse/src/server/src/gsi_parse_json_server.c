@@ -11,12 +11,17 @@
 
 /* Includes */
 #include <stdlib.h>
+#include <limits.h>
 #include <time.h>
+#include <pthread.h>
 #include "gsi_parse_json_config.h"
 #include "gsi_is_log_api.h"
 #include "gsi_thread_pool.h"
 #include "gsi_is_network_tcp.h"
 #include "gsi_build_parse_data.h"
+#include "gsi_file_cache.h"
+#include "gsi_msg_store.h"
+#include "gsi_file_scan.h"
 
 /* Defines and Macros */
 #define 	GSI_IS_FAIL				-1
@@ -29,12 +34,26 @@
 #define 	GSI_IS_NO_PRINT			0	 /* Boolean flag to indicate that NO print to screen */
 #define 	GSI_IS_PRINT_SCREEN		1	 /* Boolean flag to indicate that print to screen */
 #define		GSI_IS_MAX_BUF_SIZE		1024
+#define		GSI_IS_STATS_SECS		10	 /* Period of writing the counters into the log */
 
 /* Global variables */
 
 // Global array of strings for server READ/WRITE OP_CODES
 static char** g_arr_strings = NULL;
 
+// Cache of file contents for READ_FILE / PRINT_LOG op-codes
+static gsi_file_cache_t* g_p_file_cache = NULL;
+
+// Log-structured store of messages with id for WRITE_FILE / READ_FILE_BY_ID op-codes
+static gsi_msg_store_t* g_p_msg_store = NULL;
+
+// Parallel scanner of files for SEARCH_FILE op-code
+static gsi_file_scan_t* g_p_file_scan = NULL;
+
+// Next time (CLOCK_MONOTONIC) to log the counters, taken by one port thread
+static pthread_mutex_t g_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct timespec g_ts_stats_next;
+
 // instance of client structure contains all its config parameters
 extern struct gsi_prase_json_config_server_params g_config_server_params;
 
@@ -47,14 +66,21 @@ static void gsi_server_clean_strings(int i_index);
 static void* gsi_server_thread_parse_client(void* p_args);
 static void gsi_server_timed_service();
 static void gsi_server_infinite_service();
+static void gsi_server_handle_msgs(struct gsi_net_tcp* p_server);
 static int gsi_server_handle_op_code(struct gsi_json_msg* p_json_msg);
 static int gsi_server_handle_read_str(int i_index);
-static int gsi_server_handle_write_str(int i_index, char* s_new_str, int i_len);
+static int gsi_server_handle_write_str(int i_index, char* s_new_str);
 static int gsi_server_handle_read_file(char* s_file_name, int flags);
 static int gsi_server_handle_write_file(char* s_file_name, char* s_msg);
 static int gsi_server_handle_print_log(char* s_file_name);
 static int gsi_server_handle_read_file_by_id(char* s_file_name, int i_id);
+static int gsi_server_handle_search_file(char* s_file_name, char* s_query);
+static int gsi_server_export_store(const char* s_file_name, unsigned long ul_max_msgs, char** ps_data, size_t* pul_size);
+static size_t gsi_server_lines_len(const char* p_data, size_t ul_len, int i_max_lines, int* pi_lines);
 static int gsi_server_port_to_client(unsigned int ui_port);
+static void gsi_server_log_cache_stats();
+static void gsi_server_log_store_stats();
+static long gsi_server_log_stats_timed();
 
 /*###########################################################################
  	 * Name:        main.
@@ -90,6 +116,30 @@ int main(int argc, char** argv)
 			break;
 		}
 
+		// Create cache for file contents
+		g_p_file_cache = gsi_file_cache_create(g_config_server_params.ul_cache_size);
+		if (NULL == g_p_file_cache)
+		{
+			LOG_ERROR("couldn't create file cache");
+			break;
+		}
+
+		// Open the message store (rebuilds its index from disk)
+		g_p_msg_store = gsi_msg_store_open(g_config_server_params.s_store_dir);
+		if (NULL == g_p_msg_store)
+		{
+			LOG_ERROR("couldn't open message store");
+			break;
+		}
+
+		// Create the scanner for file searches
+		g_p_file_scan = gsi_file_scan_create(GSI_FS_DEFAULT_WORKERS);
+		if (NULL == g_p_file_scan)
+		{
+			LOG_ERROR("couldn't create file scanner");
+			break;
+		}
+
 		// Set up 3 listening threads
 		if (0 != gsi_server_init_clients())
 		{
@@ -99,6 +149,31 @@ int main(int argc, char** argv)
 	while (0);
 
 	// Free resources
+	if (NULL != g_p_file_scan)
+	{
+		gsi_file_scan_destroy(g_p_file_scan);
+		g_p_file_scan = NULL;
+	}
+
+	if (NULL != g_p_msg_store)
+	{
+		// Keep a text view of the stored messages
+		if (GSI_MS_RC_SUCCESS != gsi_msg_store_export_all(g_p_msg_store))
+		{
+			LOG_ERROR("couldn't export message store");
+		}
+		gsi_server_log_store_stats();
+		gsi_msg_store_close(g_p_msg_store);
+		g_p_msg_store = NULL;
+	}
+
+	if (NULL != g_p_file_cache)
+	{
+		gsi_server_log_cache_stats();
+		gsi_file_cache_destroy(g_p_file_cache);
+		g_p_file_cache = NULL;
+	}
+
 	gsi_server_clean_strings(GSI_IS_MAX_STRINGS);
 
 	// Close log file to free resources
@@ -335,7 +410,7 @@ static void* gsi_server_thread_parse_client(void* p_args)
 
 /*###########################################################################
 	 * Name:		gsi_server_timed_service
-	 * Description: run server on timer
+	 * Description: run server on timer, serves all clients of the port
 	 * Parameter:   [in] struct gsi_net_tcp* p_server - pointer to server
 	 * Return:		None
 #############################################################################*/
@@ -343,52 +418,54 @@ static void gsi_server_timed_service(struct gsi_net_tcp* p_server)
 {
 	int i_rc = 0;
 	int i_run_flag = GSI_IS_TRUE;
-	time_t t_seconds = g_config_server_params.i_server_timer;
-	time_t t_start_time = time(NULL);
-	struct gsi_json_msg json_msg;
+	long l_left_msecs = 0;
+	long l_stats_msecs = 0;
+	struct gsi_net_tcp* p_conn = NULL;
+	struct timespec ts_end;
+	struct timespec ts_now;
 
-	// Reset json-msg
-	memset(&json_msg, 0, sizeof(json_msg));
+	clock_gettime(CLOCK_MONOTONIC, &ts_end);
+	ts_end.tv_sec += g_config_server_params.i_server_timer;
 
-	while ((i_run_flag) && (time(NULL) - t_start_time) < t_seconds)
+	while (i_run_flag)
 	{
-		// Check events on fds of server
-		i_rc = gsi_is_network_tcp_server_poll(p_server);
+		// Wait until the timer ends (deadlines of connections are handled by the wait)
+		clock_gettime(CLOCK_MONOTONIC, &ts_now);
+		l_left_msecs = (ts_end.tv_sec - ts_now.tv_sec) * 1000 + (ts_end.tv_nsec - ts_now.tv_nsec) / 1000000;
+		if (0 >= l_left_msecs)
+		{
+			break;
+		}
+
+		// Wake up for the next write of the counters too
+		l_stats_msecs = gsi_server_log_stats_timed();
+		if (l_stats_msecs < l_left_msecs)
+		{
+			l_left_msecs = l_stats_msecs;
+		}
+
+		// Check events on connections of server
+		i_rc = gsi_is_network_tcp_server_wait(p_server, &p_conn, (int)l_left_msecs);
 		switch (i_rc)
 		{
 		case GSI_NET_RC_SUCCESS:
-			LOG_INFO("still listen\n");
 			break;
 
 		case GSI_NET_RC_HASDATA:
-			LOG_INFO("client %d sent message:", gsi_server_port_to_client(p_server->ui_port));
+			LOG_DEBUG("client %d sent message:", gsi_server_port_to_client(p_server->ui_port));
 
-			if (GSI_JSON_SUCCESS != gsi_is_recv_json_msg(p_server, &json_msg))
-			{
-				LOG_ERROR("receive message failed");
-			}
-
-			// Operate according to operation code
-			if (0 != gsi_server_handle_op_code(&json_msg))
-			{
-				LOG_ERROR("server handle op code failed");
-			}
+			// Operate each message of frame according to operation code
+			gsi_server_handle_msgs(p_conn);
 			break;
 
 		case GSI_NET_RC_CONNECTERR:
-			i_run_flag = GSI_IS_FALSE;
-			LOG_ERROR("client from port %d disconnected\n", p_server->ui_port);
+			LOG_INFO("client from port %d disconnected\n", p_server->ui_port);
 			break;
 
 		default:
 			i_run_flag = GSI_IS_FALSE;
 			LOG_ERROR("error has been occurred");
 		}
-
-		// Reset and free resources of json-msg object
-		gsi_build_parse_reset_object(&json_msg);
-
-		sleep(1);
 	}
 
 	// Check finish status
@@ -404,7 +481,7 @@ static void gsi_server_timed_service(struct gsi_net_tcp* p_server)
 
 /*###########################################################################
 	 * Name:		gsi_server_infinite_service
-	 * Description: run server on infinite loop (until error will occur)
+	 * Description: run server on infinite loop (until error will occur), serves all clients of the port
 	 * Parameter:   [in] struct gsi_net_tcp* p_server - pointer to server
 	 * Return:		None
 #############################################################################*/
@@ -412,53 +489,87 @@ static void gsi_server_infinite_service(struct gsi_net_tcp* p_server)
 {
 	int i_rc = 0;
 	int i_run_flag = GSI_IS_TRUE;
-	struct gsi_json_msg json_msg;
-
-	// Reset json-msg
-	memset(&json_msg, 0, sizeof(json_msg));
+	struct gsi_net_tcp* p_conn = NULL;
 
 	while (i_run_flag)
 	{
-		// Check events on fds of server
-		i_rc = gsi_is_network_tcp_server_poll(p_server);
+		// Check events on connections of server, waking up for the next write of the counters
+		i_rc = gsi_is_network_tcp_server_wait(p_server, &p_conn, (int)gsi_server_log_stats_timed());
 		switch (i_rc)
 		{
 		case GSI_NET_RC_SUCCESS:
-			LOG_INFO("still listen\n");
 			break;
 
 		case GSI_NET_RC_HASDATA:
-			LOG_INFO("client %d sent message:", gsi_server_port_to_client(p_server->ui_port));
+			LOG_DEBUG("client %d sent message:", gsi_server_port_to_client(p_server->ui_port));
 
-			if (GSI_JSON_SUCCESS != gsi_is_recv_json_msg(p_server, &json_msg))
-			{
-				LOG_ERROR("receive message failed");
-			}
-
-			// Operate according to operation code
-			if (0 != gsi_server_handle_op_code(&json_msg))
-			{
-				LOG_ERROR("server handle op code failed");
-			}
+			// Operate each message of frame according to operation code
+			gsi_server_handle_msgs(p_conn);
 			break;
 
 		case GSI_NET_RC_CONNECTERR:
-			i_run_flag = GSI_IS_FALSE;
-			LOG_ERROR("client from port %d disconnected\n", p_server->ui_port);
+			LOG_INFO("client from port %d disconnected\n", p_server->ui_port);
 			break;
 
 		default:
 			i_run_flag = GSI_IS_FALSE;
 			LOG_ERROR("error has been occurred");
 		}
+	}
+
+	LOG_ERROR("thread on port %d stopped\n", p_server->ui_port);
+}
+
+/*###########################################################################
+	 * Name:		gsi_server_handle_msgs
+	 * Description: Receive frame of client (batch, or one message), operate each of
+	 * 				its messages according to operation code and answer results of batch
+	 * Parameter:   [in] struct gsi_net_tcp* p_server - pointer to server
+	 * Return:		None
+#############################################################################*/
+static void gsi_server_handle_msgs(struct gsi_net_tcp* p_server)
+{
+	int i_rc = GSI_JSON_SUCCESS;
+	struct gsi_json_batch batch;
+	struct gsi_json_msg json_msg;
 
-		// Reset and free resources of json-msg object
-		gsi_build_parse_reset_object(&json_msg);
+	// Reset json-msg
+	memset(&json_msg, 0, sizeof(json_msg));
 
-		sleep(1);
+	if (GSI_JSON_SUCCESS != gsi_is_recv_batch_msg(p_server, &batch))
+	{
+		LOG_ERROR("receive message failed");
 	}
+	else
+	{
+		for (i_rc = gsi_is_batch_next_msg(&batch, &json_msg);
+			 (GSI_JSON_SUCCESS == i_rc) || (GSI_JSON_ERROR == i_rc);
+			 i_rc = gsi_is_batch_next_msg(&batch, &json_msg))
+		{
+			if (GSI_JSON_SUCCESS != i_rc)
+			{
+				LOG_ERROR("receive message failed");
+			}
+			// Operate according to operation code
+			else if (0 != gsi_server_handle_op_code(&json_msg))
+			{
+				LOG_ERROR("server handle op code failed");
+				gsi_is_batch_set_result(&batch, 1);
+			}
 
-	LOG_ERROR("thread on port %d stopped\n", p_server->ui_port);
+			// Reset and free resources of json-msg object
+			gsi_build_parse_reset_object(&json_msg);
+		}
+
+		// Results of batch to client
+		if (GSI_JSON_SUCCESS != gsi_is_send_batch_reply(p_server, &batch))
+		{
+			LOG_ERROR("reply to batch failed");
+		}
+	}
+
+	// Free the received frame
+	gsi_is_batch_reset(&batch);
 }
 
 /*###########################################################################
@@ -484,7 +595,7 @@ static int gsi_server_handle_op_code(struct gsi_json_msg* p_json_msg)
 			return gsi_server_handle_read_str(p_json_msg->i_index);
 
 		case GSI_WRITE_STR:
-			return gsi_server_handle_write_str(p_json_msg->i_index, p_json_msg->s_data, p_json_msg->i_data_len);
+			return gsi_server_handle_write_str(p_json_msg->i_index, p_json_msg->s_data);
 
 		case GSI_READ_FILE:
 			return gsi_server_handle_read_file(p_json_msg->s_file_name, GSI_IS_NO_PRINT);
@@ -498,6 +609,9 @@ static int gsi_server_handle_op_code(struct gsi_json_msg* p_json_msg)
 		case GSI_READ_FILE_BY_ID:
 			return gsi_server_handle_read_file_by_id(p_json_msg->s_file_name, atoi(p_json_msg->s_data));
 
+		case GSI_SEARCH_FILE:
+			return gsi_server_handle_search_file(p_json_msg->s_file_name, p_json_msg->s_data);
+
 		default:
 			return GSI_IS_FAIL;
 	}
@@ -513,7 +627,7 @@ static int gsi_server_handle_op_code(struct gsi_json_msg* p_json_msg)
 static int gsi_server_handle_read_str(int i_index)
 {
 	// Check input validation
-	if ((0 > i_index) || (GSI_IS_MAX_STRINGS < i_index))
+	if ((0 > i_index) || (GSI_IS_MAX_STRINGS <= i_index))
 	{
 		LOG_ERROR("index %d is out of range", i_index);
 		return GSI_IS_FAIL;
@@ -528,51 +642,74 @@ static int gsi_server_handle_read_str(int i_index)
 /*###########################################################################
 	 * Name:		gsi_server_handle_write_str
 	 * Description:	Handle the Write Str op-code and write the s_new_str into g_arr_strings[i_index]
-	 * 				if the new string length is bigger than the current - the function use realloc
+	 * 				if the new string length is bigger than the current - the function use realloc.
+	 * 				s_new_str is a view into the received message, this is its only copy.
 	 * Parameter:   [in] int i_index - index in global array to write into
 	 * Parameter:   [in] char* s_new_str - the new string to insert
-	 * Parameter:   [in] int i_len - the length of new_str
 	 * Return:		Success - 0
 	 * 				Failure - GSI_IS_FAIL
 #############################################################################*/
-static int gsi_server_handle_write_str(int i_index, char* s_new_str, int i_len)
+static int gsi_server_handle_write_str(int i_index, char* s_new_str)
 {
+	size_t ul_len = 0;
+	char* s_str = NULL;
+
 	// Check input validation
-	if ((0 > i_index) || (GSI_IS_MAX_STRINGS < i_index))
+	if ((0 > i_index) || (GSI_IS_MAX_STRINGS <= i_index))
 	{
 		LOG_ERROR("index %d is out of range", i_index);
 		return GSI_IS_FAIL;
 	}
 
+	if (NULL == s_new_str)
+	{
+		LOG_ERROR("invalid argument!");
+		return GSI_IS_FAIL;
+	}
+
+	// Length of decoded string (the Data Length of message is not trusted)
+	ul_len = strlen(s_new_str);
+
 	// Check if need to use realloc
-	if (i_len > strlen(g_arr_strings[i_index]))
+	if (ul_len > strlen(g_arr_strings[i_index]))
 	{
-		g_arr_strings[i_index] = realloc(g_arr_strings[i_index], i_len);
-		if (NULL == g_arr_strings[i_index])
+		s_str = realloc(g_arr_strings[i_index], ul_len + 1);
+		if (NULL == s_str)
 		{
 			LOG_ERROR("memory reallocation failed");
 			return GSI_IS_FAIL;
 		}
+
+		g_arr_strings[i_index] = s_str;
 	}
 
 	// Copy new string content
-	strcpy(g_arr_strings[i_index], s_new_str);
+	memcpy(g_arr_strings[i_index], s_new_str, ul_len + 1);
 
 	return 0;
 }
 
 /*###########################################################################
 	 * Name:		gsi_server_handle_read_file
-	 * Description: Handle the Read File op-code and read the file's content
+	 * Description: Handle the Read File op-code and read the file's content through
+	 * 				the file cache, followed by the stored messages with id of the
+	 * 				file (up to GSI_IS_MAX_STRINGS lines together). A file that
+	 * 				does not exist is read as empty if it has stored messages.
 	 * Parameter:   [in] char* s_file_name - file to read
+	 * Parameter:   [in] int flags - GSI_IS_PRINT_SCREEN to print the content
 	 * Return:		Success - 0
 	 * 				Failure - GSI_IS_FAIL
 #############################################################################*/
 static int gsi_server_handle_read_file(char* s_file_name, int flags)
 {
-	int i_index = 0;
-	char s_buffer[GSI_IS_MAX_STRINGS][GSI_IS_MAX_STR_LEN];
-	FILE* f_read_file = NULL;
+	int i_lines = 0;
+	int i_store_lines = 0;
+	size_t ul_len = 0;
+	size_t ul_store_len = 0;
+	char* p_store_data = NULL;
+	size_t ul_store_size = 0;
+	unsigned long ul_max_msgs = 0;
+	gsi_file_cache_entry_t* p_entry = NULL;
 
 	// Check input validation
 	if (NULL == s_file_name)
@@ -581,49 +718,62 @@ static int gsi_server_handle_read_file(char* s_file_name, int flags)
 		return GSI_IS_FAIL;
 	}
 
-	// Open file to read from it
-	f_read_file = fopen(s_file_name, "r");
-	if (NULL == f_read_file)
+	// Get file content from cache (read from disk on miss)
+	if (GSI_FC_RC_SUCCESS == gsi_file_cache_get(g_p_file_cache, s_file_name, &p_entry))
 	{
-		perror("open: ");
-		LOG_ERROR("failed to open %s", s_file_name);
-		return GSI_IS_FAIL;
+		ul_len = gsi_server_lines_len(p_entry->p_data, p_entry->ul_len, GSI_IS_MAX_STRINGS, &i_lines);
 	}
 
-	// Reset buffer
-	memset(s_buffer, 0, sizeof(s_buffer));
-
-	// Main loop to read up to GSI_IS_MAX_STRINGS and print them
-	for (i_index = 0; i_index < GSI_IS_MAX_STRINGS; ++i_index)
+	// Stored messages follow the lines of the file (only look for them if they can be printed,
+	// or the file is missing - then one message is enough to know the file exists)
+	if ((NULL == p_entry) || ((GSI_IS_PRINT_SCREEN == flags) && (GSI_IS_MAX_STRINGS > i_lines)))
 	{
-		// Reset buffer
-		memset(s_buffer[i_index], 0, sizeof(s_buffer[i_index]));
-
-		// Read line from file
-		if (NULL == fgets(s_buffer[i_index], GSI_IS_MAX_STR_LEN, f_read_file))
+		ul_max_msgs = (GSI_IS_PRINT_SCREEN == flags) ? (unsigned long)(GSI_IS_MAX_STRINGS - i_lines) : 1;
+		if (0 != gsi_server_export_store(s_file_name, ul_max_msgs, &p_store_data, &ul_store_size))
 		{
-			break;
+			if (NULL != p_entry)
+			{
+				gsi_file_cache_release(g_p_file_cache, p_entry);
+			}
+			return GSI_IS_FAIL;
 		}
+
+		ul_store_len = gsi_server_lines_len(p_store_data, ul_store_size, GSI_IS_MAX_STRINGS - i_lines, &i_store_lines);
+	}
+
+	if ((NULL == p_entry) && (0 == ul_store_size))
+	{
+		free(p_store_data);
+		LOG_ERROR("failed to read %s", s_file_name);
+		return GSI_IS_FAIL;
 	}
 
 	// Check if the user want to print to screen
 	if (GSI_IS_PRINT_SCREEN == flags)
 	{
-		for (int i = 0; i < GSI_IS_MAX_STRINGS; ++i)
+		if (NULL != p_entry)
 		{
-			printf("%s", s_buffer[i]);
+			fwrite(p_entry->p_data, 1, ul_len, stdout);
 		}
+		fwrite(p_store_data, 1, ul_store_len, stdout);
 	}
 
-	// Close file
-	fclose(f_read_file);
+	// Unpin the cached content
+	if (NULL != p_entry)
+	{
+		gsi_file_cache_release(g_p_file_cache, p_entry);
+	}
+
+	free(p_store_data);
 
 	return 0;
 }
 
 /*###########################################################################
 	 * Name:		gsi_server_handle_write_file
-	 * Description: Handle the Write File op-code and write string into file
+	 * Description: Handle the Write File op-code.
+	 * 				Message that starts with id ("<id> <msg>") is appended to the
+	 * 				message store, other messages are written into the file.
 	 * Parameter:   [in] char* s_file_name - target file name
 	 * Parameter:   [in] char* s_msg - new message to insert
 	 * Return:		Success - 0
@@ -631,6 +781,9 @@ static int gsi_server_handle_read_file(char* s_file_name, int flags)
 #############################################################################*/
 static int gsi_server_handle_write_file(char* s_file_name, char* s_msg)
 {
+	char* s_res = NULL;
+	long l_id = 0;
+
 	// Check input validation
 	if ((NULL == s_file_name) || (NULL == s_msg))
 	{
@@ -638,6 +791,21 @@ static int gsi_server_handle_write_file(char* s_file_name, char* s_msg)
 		return GSI_IS_FAIL;
 	}
 
+	// Extract the id from the message
+	l_id = strtol(s_msg, &s_res, 10);
+	if ((s_res != s_msg) && (0 <= l_id) && (UINT_MAX >= l_id) && (' ' == *s_res))
+	{
+		// Skip the separator, the rest is the message data
+		++s_res;
+		if (GSI_MS_RC_SUCCESS != gsi_msg_store_append(g_p_msg_store, s_file_name, (unsigned int)l_id,
+													  s_res, (unsigned int)strlen(s_res)))
+		{
+			LOG_ERROR("failed to store message id %ld of %s", l_id, s_file_name);
+			return GSI_IS_FAIL;
+		}
+		return 0;
+	}
+
 	// Open source file
 	FILE* f_target = fopen(s_file_name, "a+");
 	if (NULL == f_target)
@@ -652,6 +820,9 @@ static int gsi_server_handle_write_file(char* s_file_name, char* s_msg)
 	// Close file
 	fclose(f_target);
 
+	// Drop the old content from cache now, don't wait for inotify
+	gsi_file_cache_invalidate(g_p_file_cache, s_file_name);
+
 	return 0;
 }
 
@@ -669,7 +840,9 @@ static int gsi_server_handle_print_log(char* s_file_name)
 
 /*###########################################################################
 	 * Name:		gsi_server_handle_read_file_by_id
-	 * Description: Open file and search for message with specific id and print to screen
+	 * Description: Search for message with specific id and print to screen.
+	 * 				The message store is searched first (latest message with this id),
+	 * 				then the file itself (first message with this id).
 	 * Parameter:   [in] char* s_file_name - file to open for search
 	 * Parameter:   [in] int i_id - message id
 	 * Return:		Success - 0
@@ -681,6 +854,8 @@ static int gsi_server_handle_read_file_by_id(char* s_file_name, int i_id)
 	char* s_res = s_buffer;
 	int i_current_id = 0;
 	int i_found = GSI_IS_FALSE;
+	char* s_data = NULL;
+	unsigned int ui_len = 0;
 
 	// Check input validation
 	if ((NULL == s_file_name) || (0 > i_id))
@@ -689,6 +864,14 @@ static int gsi_server_handle_read_file_by_id(char* s_file_name, int i_id)
 		return GSI_IS_FAIL;
 	}
 
+	// Lookup in the message store
+	if (GSI_MS_RC_SUCCESS == gsi_msg_store_get(g_p_msg_store, s_file_name, (unsigned int)i_id, &s_data, &ui_len))
+	{
+		printf("message id: %d\ncontent: %s", i_id, s_data);
+		free(s_data);
+		return 0;
+	}
+
 	// Open source file
 	FILE* f_target = fopen(s_file_name, "r");
 	if (NULL == f_target)
@@ -733,6 +916,154 @@ static int gsi_server_handle_read_file_by_id(char* s_file_name, int i_id)
 	return 0;
 }
 
+/*###########################################################################
+	 * Name:		gsi_server_handle_search_file
+	 * Description: Handle the Search File op-code and print all matching lines to screen:
+	 * 				lines of the file, then the stored messages with id of the file
+	 * Parameter:   [in] char* s_file_name - file to search
+	 * Parameter:   [in] char* s_query - pattern, or "id:<from>-<to>"
+	 * Return:		Success - 0
+	 * 				Failure - GSI_IS_FAIL
+#############################################################################*/
+static int gsi_server_handle_search_file(char* s_file_name, char* s_query)
+{
+	struct gsi_file_scan_query query;
+	struct gsi_file_scan_result result;
+	struct gsi_file_scan_result store_result;
+	enum gsi_file_scan_rc e_rc = GSI_FS_RC_SUCCESS;
+	char* p_store_data = NULL;
+	size_t ul_store_size = 0;
+	size_t ul = 0;
+
+	// Check input validation
+	if ((NULL == s_file_name) || (NULL == s_query))
+	{
+		LOG_ERROR("invalid arguments!");
+		return GSI_IS_FAIL;
+	}
+
+	if (GSI_FS_RC_SUCCESS != gsi_file_scan_parse_query(s_query, &query))
+	{
+		LOG_ERROR("invalid search query: %s", s_query);
+		return GSI_IS_FAIL;
+	}
+
+	// Scan the whole file (a missing file may still have stored messages)
+	e_rc = gsi_file_scan_search(g_p_file_scan, s_file_name, &query, &result);
+	if ((GSI_FS_RC_SUCCESS != e_rc) && (GSI_FS_RC_OPEN_ERR != e_rc))
+	{
+		LOG_ERROR("failed to search %s", s_file_name);
+		return GSI_IS_FAIL;
+	}
+
+	// Scan the stored messages of the file
+	if ((0 != gsi_server_export_store(s_file_name, 0, &p_store_data, &ul_store_size)) ||
+		(GSI_FS_RC_SUCCESS != gsi_file_scan_search_buffer(g_p_file_scan, p_store_data, ul_store_size,
+														  &query, &store_result)))
+	{
+		LOG_ERROR("failed to search stored messages of %s", s_file_name);
+		gsi_file_scan_result_free(&result);
+		free(p_store_data);
+		return GSI_IS_FAIL;
+	}
+
+	if ((GSI_FS_RC_OPEN_ERR == e_rc) && (0 == ul_store_size))
+	{
+		LOG_ERROR("failed to search %s", s_file_name);
+		gsi_file_scan_result_free(&store_result);
+		free(p_store_data);
+		return GSI_IS_FAIL;
+	}
+
+	// Print the matching lines
+	printf("search in %s: %zu lines\n", s_file_name, result.ul_count + store_result.ul_count);
+	for (ul = 0; ul < result.ul_count; ++ul)
+	{
+		fwrite(result.p_data + result.p_matches[ul].ul_offset, 1, result.p_matches[ul].ul_len, stdout);
+		fputc('\n', stdout);
+	}
+	for (ul = 0; ul < store_result.ul_count; ++ul)
+	{
+		fwrite(store_result.p_data + store_result.p_matches[ul].ul_offset, 1, store_result.p_matches[ul].ul_len, stdout);
+		fputc('\n', stdout);
+	}
+
+	LOG_INFO("search in %s: %zu lines matched in %zu bytes (%d chunks), %zu in %zu stored bytes",
+			 s_file_name, result.ul_count, result.ul_size, result.i_chunks, store_result.ul_count, ul_store_size);
+
+	gsi_file_scan_result_free(&result);
+	gsi_file_scan_result_free(&store_result);
+	free(p_store_data);
+
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		gsi_server_export_store
+	 * Description: Export the stored messages with id of a file into memory,
+	 * 				as "<id> <msg>" lines. The data MUST be freed by free().
+	 * Parameter:   [in] const char* s_file_name - target file
+	 * Parameter:   [in] unsigned long ul_max_msgs - max messages to export (0 - all)
+	 * Parameter:   [out] char** ps_data - exported lines ('\0' terminated)
+	 * Parameter:   [out] size_t* pul_size - size of exported lines (0 - no stored message)
+	 * Return:		Success - 0
+	 * 				Failure - GSI_IS_FAIL
+#############################################################################*/
+static int gsi_server_export_store(const char* s_file_name, unsigned long ul_max_msgs, char** ps_data, size_t* pul_size)
+{
+	FILE* f_out = NULL;
+	enum gsi_msg_store_rc e_rc = GSI_MS_RC_SUCCESS;
+
+	*ps_data = NULL;
+	*pul_size = 0;
+
+	f_out = open_memstream(ps_data, pul_size);
+	if (NULL == f_out)
+	{
+		LOG_ERROR("memory stream for stored messages failed");
+		return GSI_IS_FAIL;
+	}
+
+	e_rc = gsi_msg_store_export(g_p_msg_store, s_file_name, ul_max_msgs, f_out);
+
+	// Close sets the data and its size
+	fclose(f_out);
+
+	if (GSI_MS_RC_SUCCESS != e_rc)
+	{
+		LOG_ERROR("failed to export stored messages of %s", s_file_name);
+		free(*ps_data);
+		*ps_data = NULL;
+		*pul_size = 0;
+		return GSI_IS_FAIL;
+	}
+
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		gsi_server_lines_len
+	 * Description: Length of the first lines of a text (with their '\n')
+	 * Parameter:   [in] const char* p_data - text
+	 * Parameter:   [in] size_t ul_len - length of text
+	 * Parameter:   [in] int i_max_lines - max lines to count
+	 * Parameter:   [out] int* pi_lines - number of counted lines
+	 * Return:		Length of counted lines
+#############################################################################*/
+static size_t gsi_server_lines_len(const char* p_data, size_t ul_len, int i_max_lines, int* pi_lines)
+{
+	const char* s_end = p_data;
+	const char* s_new_line = NULL;
+
+	for (*pi_lines = 0; (*pi_lines < i_max_lines) && (s_end < p_data + ul_len); ++(*pi_lines))
+	{
+		s_new_line = (const char*)memchr(s_end, '\n', p_data + ul_len - s_end);
+		s_end = (NULL == s_new_line) ? (p_data + ul_len) : (s_new_line + 1);
+	}
+
+	return s_end - p_data;
+}
+
 /*###########################################################################
 	 * Name:		gsi_server_port_to_client
 	 * Description: Convert port number to client number
@@ -757,3 +1088,84 @@ static int gsi_server_port_to_client(unsigned int ui_port)
 
 	return GSI_IS_FAIL;
 }
+
+/*###########################################################################
+	 * Name:		gsi_server_log_cache_stats
+	 * Description: Write the file cache counters into the log
+	 * Return:		None
+#############################################################################*/
+static void gsi_server_log_cache_stats()
+{
+	struct gsi_file_cache_stats stats;
+
+	if (GSI_FC_RC_SUCCESS != gsi_file_cache_get_stats(g_p_file_cache, &stats))
+	{
+		return;
+	}
+
+	LOG_INFO("file cache: hits %lu misses %lu coalesced %lu evictions %lu invalidations %lu entries %u bytes %zu",
+			 stats.ul_hits, stats.ul_misses, stats.ul_coalesced, stats.ul_evictions,
+			 stats.ul_invalidations, stats.ui_entries, stats.ul_bytes);
+}
+
+/*###########################################################################
+	 * Name:		gsi_server_log_store_stats
+	 * Description: Write the message store counters into the log
+	 * Return:		None
+#############################################################################*/
+static void gsi_server_log_store_stats()
+{
+	struct gsi_msg_store_stats stats;
+
+	if (GSI_MS_RC_SUCCESS != gsi_msg_store_get_stats(g_p_msg_store, &stats))
+	{
+		return;
+	}
+
+	LOG_INFO("message store: appends %lu lookups %lu hits %lu records %lu segments %lu bytes %lu dead %lu compactions %lu",
+			 stats.ul_appends, stats.ul_lookups, stats.ul_hits, stats.ul_records,
+			 stats.ul_segments, stats.ul_bytes, stats.ul_dead_bytes, stats.ul_compactions);
+}
+
+/*###########################################################################
+	 * Name:		gsi_server_log_stats_timed
+	 * Description: Write the counters into the log once every GSI_IS_STATS_SECS,
+	 * 				called from the loops of the port threads. Only the thread
+	 * 				that gets the lock writes, the others return at once.
+	 * Return:		Milliseconds until the next write
+#############################################################################*/
+static long gsi_server_log_stats_timed()
+{
+	long l_left_msecs = GSI_IS_STATS_SECS * 1000;
+	struct timespec ts_now;
+
+	if (0 != pthread_mutex_trylock(&g_stats_lock))
+	{
+		return l_left_msecs;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts_now);
+
+	// First call - start the period
+	if (0 == g_ts_stats_next.tv_sec)
+	{
+		g_ts_stats_next = ts_now;
+		g_ts_stats_next.tv_sec += GSI_IS_STATS_SECS;
+	}
+
+	l_left_msecs = (g_ts_stats_next.tv_sec - ts_now.tv_sec) * 1000 +
+				   (g_ts_stats_next.tv_nsec - ts_now.tv_nsec) / 1000000;
+	if (0 >= l_left_msecs)
+	{
+		gsi_server_log_cache_stats();
+		gsi_server_log_store_stats();
+
+		g_ts_stats_next = ts_now;
+		g_ts_stats_next.tv_sec += GSI_IS_STATS_SECS;
+		l_left_msecs = GSI_IS_STATS_SECS * 1000;
+	}
+
+	pthread_mutex_unlock(&g_stats_lock);
+
+	return l_left_msecs;
+}
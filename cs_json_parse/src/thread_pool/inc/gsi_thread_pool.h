@@ -11,17 +11,41 @@
 #include <pthread.h>
 
 /* Defines and Macros */
-#define 	GSI_IS_MAX_THREADS	   5
-#define 	GSI_IS_MAX_QUEUE_SIZE 200
+#define 	GSI_IS_MAX_THREADS	   1024			/* sanity limits of attributes */
+#define 	GSI_IS_MAX_QUEUE_SIZE (1 << 24)
+#define 	GSI_TP_CACHE_LINE	  64	/* positions of queue are on their own lines */
+#define 	GSI_TP_SPIN_COUNT	  200	/* tries of idle worker before it sleeps (more than one CPU) */
+#define 	GSI_TP_DEQUE_SIZE	  256	/* default tasks of deque of worker (work stealing) */
+#define 	GSI_TP_GROW_MSECS	  10	/* default wait of tasks that adds workers (elastic) */
+#define 	GSI_TP_IDLE_MSECS	  10000	/* default idle time of worker before it quits (elastic) */
+#define 	GSI_TP_WAIT_FOREVER	  -1	/* timeout of gsi_is_thread_pool_add_wait() - block until space */
+#define 	GSI_TP_FUTURES		  64	/* default futures allocated with pool (more are allocated alone) */
+#define 	GSI_TP_MAX_LANES	  8		/* priority lanes of pool (lane 0 - the most urgent) */
+#define 	GSI_TP_MAX_WEIGHT	  256	/* turns of lane of weighted policy */
+#define 	GSI_TP_STRAND_BATCH	  64	/* tasks of strand a worker runs before the strand goes back to the queue */
+#define 	GSI_TP_TIMERS		  16	/* first size of heap of timers (doubles when it is full) */
+#define 	GSI_TP_TIMER_RETRY_MSECS 1	/* timer task that found its lane full is added again after it */
 
 /* Typedef */
 
 // pointer to function for threads
 typedef void* (*thread_func_t)(void* args);
 
+// pointer to function called with the result of future
+typedef void (*future_then_func_t)(void* p_result, void* args);
+
 // structures typedefs
 typedef struct gsi_thread_pool gsi_thread_pool_t;
 typedef struct gsi_thread_pool_task gsi_thread_pool_task_t;
+typedef struct gsi_thread_pool_cell gsi_thread_pool_cell_t;
+typedef struct gsi_thread_pool_ring gsi_thread_pool_ring_t;
+typedef struct gsi_thread_pool_lane gsi_thread_pool_lane_t;
+typedef struct gsi_thread_pool_lane_stats gsi_thread_pool_lane_stats_t;
+typedef struct gsi_thread_pool_worker gsi_thread_pool_worker_t;
+typedef struct gsi_thread_pool_attr gsi_thread_pool_attr_t;
+typedef struct gsi_thread_pool_future gsi_thread_pool_future_t;
+typedef struct gsi_thread_pool_strand gsi_thread_pool_strand_t;
+typedef struct gsi_thread_pool_timer gsi_thread_pool_timer_t;
 
 /* Enums */
 /***************************************************************************
@@ -33,6 +57,44 @@ enum gsi_thread_pool_destroy_flags {
 	GSI_TP_DESTROY_IMMIDIATE = 2	// Quit even if there are tasks in Queue
 };
 
+/***************************************************************************
+ * Name:		gsi_thread_pool_worker_state
+ * Description: State of slot of worker (elastic pool starts and quits workers)
+ ***************************************************************************/
+enum gsi_thread_pool_worker_state {
+	GSI_TP_WORKER_FREE    = 0,	// No thread
+	GSI_TP_WORKER_RUNNING = 1,	// Thread runs
+	GSI_TP_WORKER_EXITED  = 2	// Thread quit, wait for join
+};
+
+/***************************************************************************
+ * Name:		gsi_thread_pool_future_state
+ * Description: Bits of state of future
+ ***************************************************************************/
+enum gsi_thread_pool_future_state {
+	GSI_TP_FUTURE_PENDING = 0,	// Task did not finish
+	GSI_TP_FUTURE_DONE    = 1,	// Task finished - result is set
+	GSI_TP_FUTURE_THEN    = 2	// Then function is set
+};
+
+/***************************************************************************
+ * Name:		gsi_thread_pool_mode
+ * Description: Where the workers take their tasks from
+ ***************************************************************************/
+enum gsi_thread_pool_mode {
+	GSI_TP_MODE_SHARED   = 0,	// One queue of all workers
+	GSI_TP_MODE_STEALING = 1	// Deque per worker for tasks added by it, idle workers steal
+};
+
+/***************************************************************************
+ * Name:		gsi_thread_pool_policy
+ * Description: Order of lanes that workers take their tasks from
+ ***************************************************************************/
+enum gsi_thread_pool_policy {
+	GSI_TP_POLICY_STRICT   = 0,	// First lane that has a task (urgent lanes may starve the others)
+	GSI_TP_POLICY_WEIGHTED = 1	// Turns of lanes by their weights
+};
+
 /***************************************************************************
  * Name:  		gsi_thread_pool_rc
  * Description: Return Code values for GSI-THREAD-POOL functions
@@ -40,7 +102,8 @@ enum gsi_thread_pool_destroy_flags {
 enum gsi_thread_pool_rc {
 	GSI_TP_RC_SUCCESS = 0,	// Function completed Successfully
 	GSI_TP_RC_ERROR   = 1,	// Function completed with Error
-	GSI_TP_RC_INVALID = 2	// Function got invalid arguments
+	GSI_TP_RC_INVALID = 2,	// Function got invalid arguments
+	GSI_TP_RC_TIMEOUT = 3	// Queue stayed full until the timeout
 };
 
 /* Structures */
@@ -60,46 +123,365 @@ struct gsi_thread_pool_task
     void* args;
 };
 
+/*****************************************************************************
+ * Name : gsi_thread_pool_cell
+ * Used by: queue of struct gsi_thread_pool
+ * Members:
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_seq - position the cell waits for: equal to the add position -
+ *							   free for it, add position + 1 - has a task for the take
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_task_t task - the task
+ *----------------------------------------------------------------------------
+ *		long long ll_add_ns - Time the task was added (timed positions of lane).
+ *****************************************************************************/
+struct gsi_thread_pool_cell
+{
+	unsigned long ul_seq;
+	gsi_thread_pool_task_t task;
+	long long ll_add_ns;
+};
+
+/*****************************************************************************
+ * Name : gsi_thread_pool_ring
+ * Used by: struct gsi_thread_pool_lane - queue of tasks (rings of a grown queue are linked)
+ * Members:
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_add_pos - Position of the next added task
+ *								   (high bit set - the ring was replaced).
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_take_pos - Position of the next taken task.
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_cell_t *p_cells - Array of cells of the ring.
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_mask - Cells - 1 (cells are power of 2).
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_ring_t *p_next - Ring that replaced this one (NULL - none).
+ *****************************************************************************/
+struct gsi_thread_pool_ring
+{
+	unsigned long ul_add_pos __attribute__((aligned(GSI_TP_CACHE_LINE)));
+	unsigned long ul_take_pos __attribute__((aligned(GSI_TP_CACHE_LINE)));
+	gsi_thread_pool_cell_t* p_cells __attribute__((aligned(GSI_TP_CACHE_LINE)));
+	unsigned long ul_mask;
+	gsi_thread_pool_ring_t* p_next;
+};
+
+/*****************************************************************************
+ * Name : gsi_thread_pool_lane
+ * Used by: struct gsi_thread_pool - one per priority lane
+ * Members:
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_ring_t *p_add_ring - Ring of the added tasks.
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_ring_t *p_take_ring - Ring of the taken tasks (rings before
+ *											  the add ring are left after their tasks).
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_space_seq - Futex of adders that wait for space (changes on take).
+ *----------------------------------------------------------------------------
+ *		int i_add_waiters - Number of adders that wait (or go to wait) on ui_space_seq.
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_timed - Taken tasks that were timed (one of 16 positions).
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_wait_ns - Sum of waits of the timed tasks.
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_max_wait_ns - Longest wait of a timed task.
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_ring_t *p_first_ring - First ring (all the rings, until destroy).
+ *****************************************************************************/
+struct gsi_thread_pool_lane
+{
+	gsi_thread_pool_ring_t* p_add_ring __attribute__((aligned(GSI_TP_CACHE_LINE)));
+	gsi_thread_pool_ring_t* p_take_ring __attribute__((aligned(GSI_TP_CACHE_LINE)));
+	unsigned int ui_space_seq __attribute__((aligned(GSI_TP_CACHE_LINE)));
+	int i_add_waiters;
+	unsigned long ul_timed __attribute__((aligned(GSI_TP_CACHE_LINE)));
+	unsigned long ul_wait_ns;
+	unsigned long ul_max_wait_ns;
+	gsi_thread_pool_ring_t* p_first_ring __attribute__((aligned(GSI_TP_CACHE_LINE)));
+};
+
+/*****************************************************************************
+ * Name : gsi_thread_pool_lane_stats
+ * Used by: gsi_is_thread_pool_lane_stats()
+ * Members:
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_depth - Tasks that wait in the lane now.
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_added, ul_taken - Tasks added to / taken from the lane since create.
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_timed - Taken tasks that were timed (one of 16 positions - a
+ *								 sample, a clock read costs as much as the add).
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_wait_ns - Sum of waits of the timed tasks (/ ul_timed - average).
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_max_wait_ns - Longest wait of a timed task.
+ *****************************************************************************/
+struct gsi_thread_pool_lane_stats
+{
+	unsigned long ul_depth;
+	unsigned long ul_added;
+	unsigned long ul_taken;
+	unsigned long ul_timed;
+	unsigned long ul_wait_ns;
+	unsigned long ul_max_wait_ns;
+};
+
+/*****************************************************************************
+ * Name : gsi_thread_pool_attr
+ * Used by: gsi_is_thread_pool_create_attr() (set by gsi_is_thread_pool_attr_init() first)
+ * Members:
+ *----------------------------------------------------------------------------
+ *		int i_thread_count - Number of threads (the minimum of elastic pool).
+ *----------------------------------------------------------------------------
+ *		int i_max_threads - Maximum number of threads (i_thread_count - fixed).
+ *----------------------------------------------------------------------------
+ *		int i_queue_size - Size of the task queue.
+ *----------------------------------------------------------------------------
+ *		int i_max_queue_size - Size the queue may grow to (i_queue_size - fixed).
+ *----------------------------------------------------------------------------
+ *		enum gsi_thread_pool_mode e_mode - Shared queue / work stealing.
+ *----------------------------------------------------------------------------
+ *		int i_deque_size - Size of deque of each worker (work stealing, power of 2).
+ *----------------------------------------------------------------------------
+ *		int i_grow_msecs - Wait of tasks in queue that adds workers (elastic).
+ *----------------------------------------------------------------------------
+ *		int i_idle_msecs - Idle time of worker before it quits (elastic).
+ *----------------------------------------------------------------------------
+ *		int i_futures - Futures allocated with the pool.
+ *----------------------------------------------------------------------------
+ *		int i_lanes - Priority lanes (1 - one queue), each of i_queue_size.
+ *----------------------------------------------------------------------------
+ *		enum gsi_thread_pool_policy e_policy - Strict / weighted order of lanes.
+ *----------------------------------------------------------------------------
+ *		int a_weights[] - Turns of each lane (weighted policy, 1 - GSI_TP_MAX_WEIGHT).
+ *****************************************************************************/
+struct gsi_thread_pool_attr
+{
+	int i_thread_count;
+	int i_max_threads;
+	int i_queue_size;
+	int i_max_queue_size;
+	enum gsi_thread_pool_mode e_mode;
+	int i_deque_size;
+	int i_grow_msecs;
+	int i_idle_msecs;
+	int i_futures;
+	int i_lanes;
+	enum gsi_thread_pool_policy e_policy;
+	int a_weights[GSI_TP_MAX_LANES];
+};
+
+/*****************************************************************************
+ * Name : gsi_thread_pool_future
+ * Used by: gsi_is_thread_pool_add_future() and its owner
+ * Members:
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_state - Bits of gsi_thread_pool_future_state (futex of waiters).
+ *----------------------------------------------------------------------------
+ *		int i_waiters - Number of threads that wait (or go to wait) on ui_state.
+ *----------------------------------------------------------------------------
+ *		int i_refs - Owner and task (back to the free futures when both left).
+ *----------------------------------------------------------------------------
+ *		int i_alone - 1 - allocated alone (freed), 0 - one of the futures of pool.
+ *----------------------------------------------------------------------------
+ *		thread_func_t thread_func, void* args - The task.
+ *----------------------------------------------------------------------------
+ *		void* p_result - Return value of thread_func (when done).
+ *----------------------------------------------------------------------------
+ *		future_then_func_t then_func, void* then_args - Called with the result.
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_t* p_pool - Pool of future.
+ *****************************************************************************/
+struct gsi_thread_pool_future
+{
+	unsigned int ui_state;
+	int i_waiters;
+	int i_refs;
+	int i_alone;
+	thread_func_t thread_func;
+	void* args;
+	void* p_result;
+	future_then_func_t then_func;
+	void* then_args;
+	gsi_thread_pool_t* p_pool;
+};
+
+/*****************************************************************************
+ * Name : gsi_thread_pool_strand
+ * Used by: gsi_is_thread_pool_strand_post() and its owner
+ * Members:
+ *----------------------------------------------------------------------------
+ *		int i_pending - Posted tasks that did not finish (0 - the strand is not in the pool).
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_ring_t *p_ring - Tasks of strand in their order.
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_t *p_pool - Pool that runs the strand.
+ *----------------------------------------------------------------------------
+ *		int i_lane - Lane of pool of the strand.
+ *****************************************************************************/
+struct gsi_thread_pool_strand
+{
+	int i_pending __attribute__((aligned(GSI_TP_CACHE_LINE)));
+	gsi_thread_pool_ring_t* p_ring __attribute__((aligned(GSI_TP_CACHE_LINE)));
+	gsi_thread_pool_t* p_pool;
+	int i_lane;
+};
+
+/*****************************************************************************
+ * Name : gsi_thread_pool_timer
+ * Used by: gsi_is_thread_pool_add_timer() and its owner (heap of timers of pool)
+ * Members:
+ *----------------------------------------------------------------------------
+ *		long long ll_expire_ns - Next deadline (CLOCK_MONOTONIC).
+ *----------------------------------------------------------------------------
+ *		long long ll_period_ns - Time between runs (0 - once).
+ *----------------------------------------------------------------------------
+ *		thread_func_t thread_func, void* args - The task.
+ *----------------------------------------------------------------------------
+ *		int i_lane - Lane of pool of the task.
+ *----------------------------------------------------------------------------
+ *		int i_index - Place in heap of timers (-1 - not in it: fired once / canceled).
+ *****************************************************************************/
+struct gsi_thread_pool_timer
+{
+	long long ll_expire_ns;
+	long long ll_period_ns;
+	thread_func_t thread_func;
+	void* args;
+	int i_lane;
+	int i_index;
+};
+
+/*****************************************************************************
+ * Name : gsi_thread_pool_worker
+ * Used by: struct gsi_thread_pool - one per worker thread
+ * Members:
+ *----------------------------------------------------------------------------
+ *		long l_top - Index of the oldest task of deque (thieves take it by CAS).
+ *----------------------------------------------------------------------------
+ *		long l_bottom - Index after the newest task of deque (only its worker changes it).
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_task_t *p_deque - Tasks of deque (NULL - shared mode).
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_t *p_pool - Pool of worker.
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_seed - Seed of rand_r() for the first worker to steal from.
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_turn - Next turn of lanes (weighted policy).
+ *----------------------------------------------------------------------------
+ *		int i_state - GSI_TP_WORKER_FREE / RUNNING / EXITED (quit, not joined yet).
+ *****************************************************************************/
+struct gsi_thread_pool_worker
+{
+	long l_top __attribute__((aligned(GSI_TP_CACHE_LINE)));
+	long l_bottom __attribute__((aligned(GSI_TP_CACHE_LINE)));
+	gsi_thread_pool_task_t* p_deque;
+	gsi_thread_pool_t* p_pool;
+	unsigned int ui_seed;
+	unsigned int ui_turn;
+	int i_state;
+};
+
 /*****************************************************************************
  * Name : gsi_thread_pool
  * Used by: GSI-THREAD-POOL API functions
  * Members:
  *----------------------------------------------------------------------------
- *		pthread_mutex_t lock - Mutex to lock critical sections.
+ *		unsigned int ui_wake_seq - Futex of sleeping workers (changes on each wake up).
  *----------------------------------------------------------------------------
- *		pthread_cond_t notify - Condition variable to notify worker threads.
+ *		int i_sleepers - Number of workers that sleep (or go to sleep) on ui_wake_seq.
  *----------------------------------------------------------------------------
- *		pthread_t *p_threads - Array containing worker threads ID
+ *		gsi_thread_pool_lane_t *p_lanes - Queue of each priority lane.
  *----------------------------------------------------------------------------
- *		gsi_thread_pool_task_t *queue - Array containing the task queue.
+ *		int i_lanes - Number of lanes.
  *----------------------------------------------------------------------------
- *		int i_thread_count - Number of threads.
+ *		enum gsi_thread_pool_policy e_policy - Strict / weighted order of lanes.
  *----------------------------------------------------------------------------
- *		int i_queue_size - Size of the task queue.
+ *		int *p_turns, i_turns - Lane of each turn (weighted policy - sum of weights).
+ *----------------------------------------------------------------------------
+ *		unsigned long ul_max_cells - Cells a ring may grow to.
+ *----------------------------------------------------------------------------
+ *		pthread_mutex_t grow_lock - Replace of full ring (one at a time).
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_future_t *p_futures - Futures allocated with the pool.
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_ring_t *p_free_futures - Free futures (args of cells).
  *----------------------------------------------------------------------------
- *		int i_head - Index of the first element.
+ *		int i_spin_count - Tries of idle worker before it sleeps (0 on one CPU).
  *----------------------------------------------------------------------------
- *		int i_tail - Index of the last element.
+ *		pthread_t *p_threads - Array containing worker threads ID (by worker)
  *----------------------------------------------------------------------------
- *		int i_count - Number of pending tasks.
+ *		gsi_thread_pool_worker_t *p_workers - Array of workers (deque of each one).
  *----------------------------------------------------------------------------
- *		int i_shutdown - Flag indicating if the pool is shutting down.
+ *		int i_workers - Workers that were ever started (thieves scan them).
+ *----------------------------------------------------------------------------
+ *		enum gsi_thread_pool_mode e_mode - Shared queue / work stealing.
+ *----------------------------------------------------------------------------
+ *		long l_deque_mask - Tasks of deque - 1 (work stealing).
+ *----------------------------------------------------------------------------
+ *		pthread_t manager - Thread that adds and joins workers (elastic).
+ *----------------------------------------------------------------------------
+ *		int i_manager - 1 - the manager thread runs.
+ *----------------------------------------------------------------------------
+ *		int i_min_threads, i_max_threads - Limits of number of threads.
+ *----------------------------------------------------------------------------
+ *		int i_grow_msecs, i_idle_msecs - Wait of tasks that adds workers, idle
+ *										 time of worker before it quits.
+ *----------------------------------------------------------------------------
+ *		int i_thread_count - Number of threads.
+ *----------------------------------------------------------------------------
+ *		int i_queue_size - Size of the queue of each lane (i_queue_size rounded up to power of 2, at least 2).
+ *----------------------------------------------------------------------------
+ *		int i_shutdown - Flag indicating if the pool is shutting down (futex of manager).
  *----------------------------------------------------------------------------
  *		int i_started - Number of started threads.
+ *----------------------------------------------------------------------------
+ *		pthread_mutex_t timer_lock - Heap of timers and timerfd.
+ *----------------------------------------------------------------------------
+ *		gsi_thread_pool_timer_t **p_timers - Min-heap of timers by deadline.
+ *----------------------------------------------------------------------------
+ *		int i_timers, i_timers_size - Timers in heap, size of heap.
+ *----------------------------------------------------------------------------
+ *		int i_timer_fd - Timerfd of first deadline (-1 - no timer was added yet).
+ *----------------------------------------------------------------------------
+ *		pthread_t timer_thread - Thread that adds the tasks of timers (with i_timer_fd).
  *****************************************************************************/
 struct gsi_thread_pool
 {
-	pthread_mutex_t lock;
-	pthread_cond_t notify;
+	unsigned int ui_wake_seq __attribute__((aligned(GSI_TP_CACHE_LINE)));
+	int i_sleepers;
+	gsi_thread_pool_lane_t* p_lanes __attribute__((aligned(GSI_TP_CACHE_LINE)));
+	int i_lanes;
+	enum gsi_thread_pool_policy e_policy;
+	int* p_turns;
+	int i_turns;
+	unsigned long ul_max_cells;
+	pthread_mutex_t grow_lock;
+	gsi_thread_pool_future_t* p_futures;
+	gsi_thread_pool_ring_t* p_free_futures;
+	int i_spin_count;
 	pthread_t* p_threads;
-	gsi_thread_pool_task_t* queue;
+	gsi_thread_pool_worker_t* p_workers;
+	int i_workers;
+	enum gsi_thread_pool_mode e_mode;
+	long l_deque_mask;
+	pthread_t manager;
+	int i_manager;
+	int i_min_threads;
+	int i_max_threads;
+	int i_grow_msecs;
+	int i_idle_msecs;
 	int i_thread_count;
 	int i_queue_size;
-	int i_head;
-	int i_tail;
-	int i_count;
 	int i_shutdown;
 	int i_started;
+	pthread_mutex_t timer_lock;
+	gsi_thread_pool_timer_t** p_timers;
+	int i_timers;
+	int i_timers_size;
+	int i_timer_fd;
+	pthread_t timer_thread;
 };
 
 /*******************/
@@ -115,9 +497,45 @@ struct gsi_thread_pool
 #############################################################################*/
 gsi_thread_pool_t *gsi_is_thread_pool_create(int i_thread_count, int i_queue_size);
 
+/*###########################################################################
+	 * Name:   		gsi_is_thread_pool_attr_init
+	 * Description: Set attributes of pool to the defaults of gsi_is_thread_pool_create()
+	 * Parameter:   [out] gsi_thread_pool_attr_t *p_attr - attributes to set
+	 * Parameter:   [in] int i_thread_count - number of threads in pool
+	 * Parameter:   [in] int i_queue_size - size of the queue
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_attr_init(gsi_thread_pool_attr_t* p_attr, int i_thread_count, int i_queue_size);
+
+/*###########################################################################
+	 * Name:   		gsi_is_thread_pool_create_attr
+	 * Description: Creates a gsi_thread_pool_t object by attributes (e.g. work stealing,
+	 * 				elastic number of threads and size of queue).
+	 * 				Work stealing (GSI_TP_MODE_STEALING): each worker owns a deque (Chase-Lev) -
+	 * 				a task added from a worker goes to its own deque and is taken by it LIFO
+	 * 				(its data is still in cache), an idle worker steals the oldest tasks of
+	 * 				the others. Tasks of other threads use the queue.
+	 * 				Elastic (i_max_threads / i_max_queue_size above the initial ones): a manager
+	 * 				thread adds workers when tasks wait longer than i_grow_msecs and no worker
+	 * 				is idle, a worker that is idle for i_idle_msecs quits (not below
+	 * 				i_thread_count). A full queue is replaced by one of twice its size (the
+	 * 				tasks left in it are taken first).
+	 * Parameter:   [in] const gsi_thread_pool_attr_t *p_attr - attributes of pool
+	 * Return: 	    Success - pointer to new thread_pool object
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_thread_pool_t *gsi_is_thread_pool_create_attr(const gsi_thread_pool_attr_t* p_attr);
+
 /*###########################################################################
 	 * Name:      	gsi_is_thread_pool_add
-	 * Description: Add a new task in the queue of a thread pool.
+	 * Description: Add a new task in the queue of a thread pool (fails if it is full).
+	 * 				Lock-free: the queue (MPMC) is a ring of sequence numbered cells - add and
+	 * 				take claim a cell by one CAS of their position. An idle worker spins up to
+	 * 				GSI_TP_SPIN_COUNT times, then sleeps on a futex - the task wakes one
+	 * 				sleeping worker (if there is one). The task goes to the last lane.
+	 * 				Work stealing - a task added by a worker of the pool goes to its
+	 * 				own deque (to the queue if the deque is full).
 	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to which add the task.
 	 * Parameter:   [in] thread_func_t thread_func - Pointer to the function that will perform the task.
 	 * Parameter:   [in] void* args - Argument to be passed to the function.
@@ -126,9 +544,197 @@ gsi_thread_pool_t *gsi_is_thread_pool_create(int i_thread_count, int i_queue_siz
 #############################################################################*/
 enum gsi_thread_pool_rc gsi_is_thread_pool_add(gsi_thread_pool_t* p_pool, thread_func_t thread_func, void* args);
 
+/*###########################################################################
+	 * Name:      	gsi_is_thread_pool_add_wait
+	 * Description: Add a new task, waiting for space while the queue is full (backpressure).
+	 * 				Each taken task wakes one waiting adder. A worker of the pool never
+	 * 				waits (it may be the one to take) - it fails like gsi_is_thread_pool_add().
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to which add the task.
+	 * Parameter:   [in] thread_func_t thread_func - Pointer to the function that will perform the task.
+	 * Parameter:   [in] void* args - Argument to be passed to the function.
+	 * Parameter:   [in] int i_timeout_msecs - GSI_TP_WAIT_FOREVER - block, 0 - fail fast,
+	 * 										   else - wait up to milliseconds
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_TIMEOUT *OR* GSI_TP_RC_ERROR (full / shutdown) *OR* GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_add_wait(gsi_thread_pool_t* p_pool, thread_func_t thread_func, void* args,
+													int i_timeout_msecs);
+
+/*###########################################################################
+	 * Name:      	gsi_is_thread_pool_add_lane
+	 * Description: Add a new task to a priority lane (like gsi_is_thread_pool_add_wait()).
+	 * 				Each lane (i_lanes of attributes) is a queue of its own. Strict policy - a
+	 * 				worker takes from the first lane that has a task, weighted - the lanes get
+	 * 				turns by their weights (a lane without a task gives its turn to the next).
+	 * 				Only the last lane uses the deque of worker (work stealing).
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to which add the task.
+	 * Parameter:   [in] int i_lane - lane of task (0 - the most urgent).
+	 * Parameter:   [in] thread_func_t thread_func - Pointer to the function that will perform the task.
+	 * Parameter:   [in] void* args - Argument to be passed to the function.
+	 * Parameter:   [in] int i_timeout_msecs - wait for space of lane (see gsi_is_thread_pool_add_wait())
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_TIMEOUT *OR* GSI_TP_RC_ERROR (full / shutdown) *OR* GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_add_lane(gsi_thread_pool_t* p_pool, int i_lane, thread_func_t thread_func,
+													void* args, int i_timeout_msecs);
+
+/*###########################################################################
+	 * Name:      	gsi_is_thread_pool_add_batch
+	 * Description: Add tasks to a lane at once - one CAS claims the cells of all of them
+	 * 				(instead of one per task), and one system call wakes min(tasks, sleeping
+	 * 				workers). Fails fast like gsi_is_thread_pool_add() - the rest may be
+	 * 				added again from p_tasks + *p_added.
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to which add the tasks.
+	 * Parameter:   [in] int i_lane - lane of tasks (0 - the most urgent).
+	 * Parameter:   [in] const gsi_thread_pool_task_t *p_tasks - tasks, in order.
+	 * Parameter:   [in] int i_count - number of tasks.
+	 * Parameter:   [out] int* p_added - number of tasks that were added (the first ones)
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS (all were added)
+	 * 				Failure - GSI_TP_RC_ERROR (full / shutdown) *OR* GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_add_batch(gsi_thread_pool_t* p_pool, int i_lane, const gsi_thread_pool_task_t* p_tasks,
+													 int i_count, int* p_added);
+
+/*###########################################################################
+	 * Name:      	gsi_is_thread_pool_add_future
+	 * Description: Add a new task (like gsi_is_thread_pool_add_wait()) and return its future.
+	 * 				The future is taken from the free futures of the pool (allocated alone
+	 * 				when there is none) - the result of the task is waited for, or passed
+	 * 				to a "then" function. The owner must release it by
+	 * 				gsi_is_thread_pool_future_release(), before destroy of pool.
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to which add the task.
+	 * Parameter:   [in] thread_func_t thread_func - Pointer to the function that will perform the task.
+	 * Parameter:   [in] void* args - Argument to be passed to the function.
+	 * Parameter:   [in] int i_timeout_msecs - wait for space (see gsi_is_thread_pool_add_wait())
+	 * Return: 	    Success - future of task
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_thread_pool_future_t* gsi_is_thread_pool_add_future(gsi_thread_pool_t* p_pool, thread_func_t thread_func, void* args,
+														int i_timeout_msecs);
+
+/*###########################################################################
+	 * Name:      	gsi_is_thread_pool_future_wait
+	 * Description: Wait for task of future to finish (a task left in the queue by an
+	 * 				immediate destroy never finishes)
+	 * Parameter:   [in] gsi_thread_pool_future_t *p_future - future of task.
+	 * Parameter:   [in] int i_timeout_msecs - GSI_TP_WAIT_FOREVER - block, 0 - check only,
+	 * 										   else - wait up to milliseconds
+	 * Parameter:   [out] void** pp_result - return value of the task (may be NULL)
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_TIMEOUT (not done) *OR* GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_future_wait(gsi_thread_pool_future_t* p_future, int i_timeout_msecs,
+													   void** pp_result);
+
+/*###########################################################################
+	 * Name:      	gsi_is_thread_pool_future_then
+	 * Description: Set function to call with the result of task - by the worker when
+	 * 				it finishes, or now by the caller if it finished already (once only)
+	 * Parameter:   [in] gsi_thread_pool_future_t *p_future - future of task.
+	 * Parameter:   [in] future_then_func_t then_func - function to call.
+	 * Parameter:   [in] void* args - Argument to be passed to the function.
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_ERROR (set already) *OR* GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_future_then(gsi_thread_pool_future_t* p_future, future_then_func_t then_func,
+													   void* args);
+
+/*###########################################################################
+	 * Name:      	gsi_is_thread_pool_future_release
+	 * Description: Owner is done with future (its task may still run - its then
+	 * 				function is still called). Further use is undefined.
+	 * Parameter:   [in] gsi_thread_pool_future_t *p_future - future of task.
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_future_release(gsi_thread_pool_future_t* p_future);
+
+/*###########################################################################
+	 * Name:      	gsi_is_thread_pool_strand_create
+	 * Description: Creates a strand - its tasks run on the pool one at a time, in order
+	 * 				(no lock is needed between them), different strands run in parallel.
+	 * 				A strand is a task of the pool while it has tasks - a worker runs up to
+	 * 				GSI_TP_STRAND_BATCH of them before the strand goes back to the queue.
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool that runs the strand.
+	 * Parameter:   [in] int i_lane - lane of pool of the strand (0 - the most urgent).
+	 * Parameter:   [in] int i_queue_size - tasks that may wait in the strand.
+	 * Return: 	    Success - pointer to new strand
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_thread_pool_strand_t* gsi_is_thread_pool_strand_create(gsi_thread_pool_t* p_pool, int i_lane, int i_queue_size);
+
+/*###########################################################################
+	 * Name:      	gsi_is_thread_pool_strand_post
+	 * Description: Add a task to a strand - it runs after the tasks posted before it, and
+	 * 				not together with any of them. Lock-free. The first task of an idle
+	 * 				strand adds it to the pool - if the pool is full (or shuts down), the
+	 * 				caller runs the strand itself until it is idle.
+	 * Parameter:   [in] gsi_thread_pool_strand_t *p_strand - strand of the task.
+	 * Parameter:   [in] thread_func_t thread_func - Pointer to the function that will perform the task.
+	 * Parameter:   [in] void* args - Argument to be passed to the function.
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_ERROR (strand is full) *OR* GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_strand_post(gsi_thread_pool_strand_t* p_strand, thread_func_t thread_func,
+													   void* args);
+
+/*###########################################################################
+	 * Name:      	gsi_is_thread_pool_strand_destroy
+	 * Description: Waits for the tasks of strand to finish and destroys it (before destroy
+	 * 				of its pool - tasks left by an immediate destroy never finish).
+	 * Parameter:   [in] gsi_thread_pool_strand_t *p_strand - strand to destroy.
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_strand_destroy(gsi_thread_pool_strand_t* p_strand);
+
+/*###########################################################################
+	 * Name:      	gsi_is_thread_pool_add_timer
+	 * Description: Add a task to a lane after a delay, and every period after it. A timer
+	 * 				thread of the pool (started by the first timer) sleeps on a timerfd until
+	 * 				the first deadline of a min-heap of timers. Runs of a task that is slower
+	 * 				than its period may overlap (post to a strand to keep them in order);
+	 * 				late ticks are not made up.
+	 * 				The owner must cancel the timer (after it fired too), before destroy of pool.
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to which add the task.
+	 * Parameter:   [in] int i_lane - lane of task (0 - the most urgent).
+	 * Parameter:   [in] thread_func_t thread_func - Pointer to the function that will perform the task.
+	 * Parameter:   [in] void* args - Argument to be passed to the function.
+	 * Parameter:   [in] int i_delay_msecs - time until the first run (0 - now)
+	 * Parameter:   [in] int i_period_msecs - time between runs (0 - once)
+	 * Return: 	    Success - the timer
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_thread_pool_timer_t* gsi_is_thread_pool_add_timer(gsi_thread_pool_t* p_pool, int i_lane, thread_func_t thread_func,
+													  void* args, int i_delay_msecs, int i_period_msecs);
+
+/*###########################################################################
+	 * Name:      	gsi_is_thread_pool_cancel_timer
+	 * Description: Stop timer and free it - no run starts after it (a run that was
+	 * 				added already may still be in the pool). Further use is undefined.
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool of timer.
+	 * Parameter:   [in] gsi_thread_pool_timer_t *p_timer - timer to cancel.
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_cancel_timer(gsi_thread_pool_t* p_pool, gsi_thread_pool_timer_t* p_timer);
+
+/*###########################################################################
+	 * Name:      	gsi_is_thread_pool_lane_stats
+	 * Description: Depth and wait of tasks of a lane (tasks of the deques of workers
+	 * 				are not in lanes). Counters are read one by one - not one moment.
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool.
+	 * Parameter:   [in] int i_lane - lane (0 - the most urgent).
+	 * Parameter:   [out] gsi_thread_pool_lane_stats_t *p_stats - counters of lane.
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_lane_stats(gsi_thread_pool_t* p_pool, int i_lane,
+													  gsi_thread_pool_lane_stats_t* p_stats);
+
 /*###########################################################################
 	 * Name:        gsi_is_thread_pool_destroy
-	 * Description: Stops and destroys a thread pool.
+	 * Description: Stops and destroys a thread pool (waiting adders fail).
 	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to destroy.
 	 * Parameter:   [in] int i_flags - Flags for shutdown - 1 default, 2 - graceful
 	 * Return: 	    Success - GSI_TP_RC_SUCCESS
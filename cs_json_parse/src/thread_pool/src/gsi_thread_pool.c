@@ -4,20 +4,97 @@
 * Version : 1.0.0
 * Description : Thread Pool API implementation.
 * 				Every use of thread_pool_create() must also use thread_pool_destroy() !
+* 				Queue is the bounded MPMC queue of D. Vyukov: cell i of turn n has
+* 				sequence n * cells + i while it is free, + 1 while it has a task -
+* 				add / take compare its sequence with their position and claim the
+* 				position by CAS, so only threads on the same position retry.
+* 				Deque of worker (work stealing) is the one of Chase and Lev (orders of
+* 				Le et al. for C11): its worker pushes and takes at the bottom, thieves
+* 				take the top by CAS - only the last task is raced by the worker.
+* 				Grow of queue: a full ring is closed (bit of its add position) after
+* 				the new ring is linked to it - adds go to the new ring, takes go on
+* 				with the old ring until each position claimed in it was taken.
+* 				Rings are freed by destroy only (a thread may still look at an old
+* 				one) - they double, so all of them take less than twice the last.
+* 				Free futures wait in a ring too (pointer in args of cell) - a future
+* 				goes back to it when both its owner and its task left it.
+* 				Each priority lane is such a queue (rings, waiting adders, counters) -
+* 				the policy only picks the lane a worker looks at first.
+* 				Strand is a ring of its tasks and a count of them: the post that counts
+* 				the first one adds the strand to the pool, its task runs the tasks of the
+* 				ring until the count is back to 0 - one worker at a time.
+* 				Timers are a min-heap by deadline (each one knows its place - cancel
+* 				takes it out in O(log n)) under a mutex - the timer thread sleeps on a
+* 				timerfd set to the deadline of the top, an add of an earlier one sets it
+* 				again. A periodic timer goes back to the heap by the timer thread.
 *****************************************************************************/
 
 /* Includes */
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <linux/futex.h>
 #include "gsi_thread_pool.h"
 
 /* Defines and Macros */
+#if defined(__x86_64__) || defined(__i386__)
+#define 	GSI_TP_CPU_RELAX()	__builtin_ia32_pause()
+#else
+#define 	GSI_TP_CPU_RELAX()	__asm__ __volatile__("" ::: "memory")
+#endif
+#define 	GSI_TP_RING_CLOSED	(~(ULONG_MAX >> 1))	/* bit of add position of replaced ring */
+#define 	GSI_TP_TIMED_MASK	15	/* wait of lane is timed at one of 16 positions (a clock read costs as much as the add) */
+
+/* Globals */
+// Worker of the current thread (NULL - not a worker) - add from it pushes to its deque
+static __thread gsi_thread_pool_worker_t* g_p_worker = NULL;
 
 /********************************/
 /* Static functions declaration */
 /********************************/
 static void* gsi_is_thread_run(void* args);
+static void* gsi_is_thread_manager_run(void* args);
+static void* gsi_is_thread_timer_run(void* args);
 static enum gsi_thread_pool_rc gsi_is_thread_pool_free(gsi_thread_pool_t* p_pool);
+static int gsi_is_thread_pool_start_worker(gsi_thread_pool_t* p_pool, int i_worker);
+static gsi_thread_pool_ring_t* gsi_is_thread_pool_ring_create(unsigned long ul_cells);
+static int gsi_is_thread_pool_ring_push(gsi_thread_pool_ring_t* p_ring, thread_func_t thread_func, void* args,
+										int i_timed);
+static int gsi_is_thread_pool_ring_push_batch(gsi_thread_pool_ring_t* p_ring, const gsi_thread_pool_task_t* p_tasks,
+											  int i_count);
+static int gsi_is_thread_pool_ring_pop(gsi_thread_pool_ring_t* p_ring, gsi_thread_pool_task_t* p_task, long long* p_add_ns);
+static int gsi_is_thread_pool_grow_queue(gsi_thread_pool_t* p_pool, gsi_thread_pool_lane_t* p_lane,
+										 gsi_thread_pool_ring_t* p_ring);
+static int gsi_is_thread_pool_push(gsi_thread_pool_t* p_pool, gsi_thread_pool_lane_t* p_lane, thread_func_t thread_func,
+								   void* args);
+static int gsi_is_thread_pool_push_batch(gsi_thread_pool_t* p_pool, gsi_thread_pool_lane_t* p_lane,
+										 const gsi_thread_pool_task_t* p_tasks, int i_count);
+static int gsi_is_thread_pool_submit(gsi_thread_pool_t* p_pool, gsi_thread_pool_lane_t* p_lane, thread_func_t thread_func,
+									 void* args);
+static int gsi_is_thread_pool_is_full(gsi_thread_pool_lane_t* p_lane);
+static int gsi_is_thread_pool_pop(gsi_thread_pool_lane_t* p_lane, gsi_thread_pool_task_t* p_task);
+static void gsi_is_thread_pool_count(gsi_thread_pool_lane_t* p_lane, unsigned long* p_added, unsigned long* p_taken);
+static long long gsi_is_thread_pool_time_left(long long ll_end_ns, struct timespec* p_left);
+static void* gsi_is_thread_pool_future_run(void* args);
+static void* gsi_is_thread_pool_strand_run(void* args);
+static void gsi_is_thread_pool_timer_arm(gsi_thread_pool_t* p_pool);
+static void gsi_is_thread_pool_heap_up(gsi_thread_pool_t* p_pool, int i_index);
+static void gsi_is_thread_pool_heap_down(gsi_thread_pool_t* p_pool, int i_index);
+static void gsi_is_thread_pool_heap_remove(gsi_thread_pool_t* p_pool, int i_index);
+static void gsi_is_thread_pool_future_put(gsi_thread_pool_future_t* p_future);
+static int gsi_is_thread_pool_deque_push(gsi_thread_pool_worker_t* p_worker, thread_func_t thread_func, void* args);
+static int gsi_is_thread_pool_deque_take(gsi_thread_pool_worker_t* p_worker, gsi_thread_pool_task_t* p_task);
+static int gsi_is_thread_pool_deque_steal(gsi_thread_pool_worker_t* p_victim, gsi_thread_pool_task_t* p_task);
+static int gsi_is_thread_pool_find(gsi_thread_pool_worker_t* p_worker, gsi_thread_pool_task_t* p_task);
+static int gsi_is_thread_pool_take(gsi_thread_pool_worker_t* p_worker, gsi_thread_pool_task_t* p_task);
+static void gsi_is_thread_pool_wake(gsi_thread_pool_t* p_pool, int i_workers);
 
 /*###########################################################################
 	 * Name:   		thread_pool_create
@@ -28,82 +105,284 @@ static enum gsi_thread_pool_rc gsi_is_thread_pool_free(gsi_thread_pool_t* p_pool
 	 * 				Failure - NULL
 #############################################################################*/
 gsi_thread_pool_t* gsi_is_thread_pool_create(int i_thread_count, int i_queue_size)
+{
+	gsi_thread_pool_attr_t attr;
+
+	gsi_is_thread_pool_attr_init(&attr, i_thread_count, i_queue_size);
+
+	return gsi_is_thread_pool_create_attr(&attr);
+}
+
+/*###########################################################################
+	 * Name:   		thread_pool_attr_init
+	 * Description: Set attributes of pool to the defaults of thread_pool_create()
+	 * Parameter:   [out] gsi_thread_pool_attr_t *p_attr - attributes to set
+	 * Parameter:   [in] int i_thread_count - number of threads in pool
+	 * Parameter:   [in] int i_queue_size - size of the queue
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_attr_init(gsi_thread_pool_attr_t* p_attr, int i_thread_count, int i_queue_size)
+{
+	// Check input validation
+	if (NULL == p_attr)
+	{
+		return GSI_TP_RC_INVALID;
+	}
+
+	p_attr->i_thread_count = i_thread_count;
+	p_attr->i_max_threads = i_thread_count;
+	p_attr->i_queue_size = i_queue_size;
+	p_attr->i_max_queue_size = i_queue_size;
+	p_attr->e_mode = GSI_TP_MODE_SHARED;
+	p_attr->i_deque_size = GSI_TP_DEQUE_SIZE;
+	p_attr->i_grow_msecs = GSI_TP_GROW_MSECS;
+	p_attr->i_idle_msecs = GSI_TP_IDLE_MSECS;
+	p_attr->i_futures = GSI_TP_FUTURES;
+	p_attr->i_lanes = 1;
+	p_attr->e_policy = GSI_TP_POLICY_STRICT;
+
+	for (int i = 0; i < GSI_TP_MAX_LANES; ++i)
+	{
+		p_attr->a_weights[i] = 1;
+	}
+
+	return GSI_TP_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:   		thread_pool_create_attr
+	 * Description: Creates a gsi_thread_pool_t object by attributes. Must Use thread_pool_destroy() before exit!
+	 * Parameter:   [in] const gsi_thread_pool_attr_t *p_attr - attributes of pool
+	 * Return: 	    Success - pointer to new thread_pool object
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_thread_pool_t* gsi_is_thread_pool_create_attr(const gsi_thread_pool_attr_t* p_attr)
 {
 	gsi_thread_pool_t* p_pool = NULL;
+	unsigned long ul_cells = 2;
+	unsigned long ul_max_cells = 2;
+	unsigned long ul_future_cells = 2;
+	int a_credits[GSI_TP_MAX_LANES] = {0};
+	int i_max_threads = 0;
+	int i_turns = 0;
+	int i_best = 0;
 
 	// Check input validation
-	if ((0 >= i_thread_count) || (GSI_IS_MAX_THREADS < i_thread_count) ||
-		(0 >= i_queue_size)   || (GSI_IS_MAX_QUEUE_SIZE < i_queue_size))
+	if ((NULL == p_attr) ||
+		(0 >= p_attr->i_thread_count) || (p_attr->i_thread_count > p_attr->i_max_threads) ||
+		(GSI_IS_MAX_THREADS < p_attr->i_max_threads) ||
+		(0 >= p_attr->i_queue_size)   || (p_attr->i_queue_size > p_attr->i_max_queue_size) ||
+		(GSI_IS_MAX_QUEUE_SIZE < p_attr->i_max_queue_size) ||
+		((GSI_TP_MODE_SHARED != p_attr->e_mode) && (GSI_TP_MODE_STEALING != p_attr->e_mode)) ||
+		((GSI_TP_MODE_STEALING == p_attr->e_mode) &&
+		 ((0 >= p_attr->i_deque_size) || (0 != (p_attr->i_deque_size & (p_attr->i_deque_size - 1))))) ||
+		((p_attr->i_thread_count < p_attr->i_max_threads) &&
+		 ((0 >= p_attr->i_grow_msecs) || (0 >= p_attr->i_idle_msecs))) ||
+		(0 > p_attr->i_futures) || (GSI_IS_MAX_QUEUE_SIZE < p_attr->i_futures) ||
+		(0 >= p_attr->i_lanes) || (GSI_TP_MAX_LANES < p_attr->i_lanes) ||
+		((GSI_TP_POLICY_STRICT != p_attr->e_policy) && (GSI_TP_POLICY_WEIGHTED != p_attr->e_policy)))
 	{
 		printf("gsi_is_thread_pool_create: invalid arguments\n");
 		return NULL;
 	}
 
-	// Allocate new thread pool
-	p_pool = (gsi_thread_pool_t*) malloc(sizeof(gsi_thread_pool_t));
-	if (NULL == p_pool)
+	// Weighted - every lane has turns
+	for (int i = 0; (GSI_TP_POLICY_WEIGHTED == p_attr->e_policy) && (i < p_attr->i_lanes); ++i)
+	{
+		if ((0 >= p_attr->a_weights[i]) || (GSI_TP_MAX_WEIGHT < p_attr->a_weights[i]))
+		{
+			printf("gsi_is_thread_pool_create: invalid arguments\n");
+			return NULL;
+		}
+
+		i_turns += p_attr->a_weights[i];
+	}
+
+	i_max_threads = p_attr->i_max_threads;
+
+	// Allocate new thread pool (its positions are aligned on cache lines)
+	if (0 != posix_memalign((void **)&p_pool, GSI_TP_CACHE_LINE, sizeof(gsi_thread_pool_t)))
 	{
 		printf("gsi_is_thread_pool_create: malloc failed\n");
 		return NULL;
 	}
 
+	// Cells are power of 2 - cell of position is position & mask. At least 2: a task in
+	// the cell of a ring of 1 has the sequence of the free cell of the next position
+	while (ul_cells < (unsigned long)p_attr->i_queue_size)
+	{
+		ul_cells <<= 1;
+	}
+
+	while (ul_max_cells < (unsigned long)p_attr->i_max_queue_size)
+	{
+		ul_max_cells <<= 1;
+	}
+
+	while (ul_future_cells < (unsigned long)p_attr->i_futures)
+	{
+		ul_future_cells <<= 1;
+	}
+
 	// Update fields
+	p_pool->ui_wake_seq = 0;
+	p_pool->i_sleepers = 0;
+	p_pool->p_lanes = NULL;
+	p_pool->i_lanes = p_attr->i_lanes;
+	p_pool->e_policy = p_attr->e_policy;
+	p_pool->p_turns = NULL;
+	p_pool->i_turns = i_turns;
+	p_pool->ul_max_cells = ul_max_cells;
+	pthread_mutex_init(&p_pool->grow_lock, NULL);
+	pthread_mutex_init(&p_pool->timer_lock, NULL);
+	p_pool->p_timers = NULL;
+	p_pool->i_timers = 0;
+	p_pool->i_timers_size = 0;
+	p_pool->i_timer_fd = -1;
+	p_pool->p_futures = NULL;
+	p_pool->p_free_futures = NULL;
+
+	// Spin of one CPU only delays the thread that adds
+	p_pool->i_spin_count = (1 < sysconf(_SC_NPROCESSORS_ONLN)) ? GSI_TP_SPIN_COUNT : 0;
+	p_pool->p_threads = NULL;
+	p_pool->p_workers = NULL;
+	p_pool->i_workers = 0;
+	p_pool->e_mode = p_attr->e_mode;
+	p_pool->l_deque_mask = (GSI_TP_MODE_STEALING == p_attr->e_mode) ? (long)p_attr->i_deque_size - 1 : 0;
+	p_pool->i_manager = 0;
+	p_pool->i_min_threads = p_attr->i_thread_count;
+	p_pool->i_max_threads = i_max_threads;
+	p_pool->i_grow_msecs = p_attr->i_grow_msecs;
+	p_pool->i_idle_msecs = p_attr->i_idle_msecs;
 	p_pool->i_thread_count = 0;
-	p_pool->i_queue_size = i_queue_size;
-	p_pool->i_head = 0;
-	p_pool->i_tail = 0;
-	p_pool->i_count = 0;
+	p_pool->i_queue_size = (int)ul_cells;
 	p_pool->i_shutdown = 0;
 	p_pool->i_started = 0;
 
 	// Allocate array of threads
-	p_pool->p_threads = (pthread_t*)malloc(sizeof(pthread_t) * i_thread_count);
+	p_pool->p_threads = (pthread_t*)malloc(sizeof(pthread_t) * i_max_threads);
 	if (NULL == p_pool->p_threads)
 	{
-		free(p_pool);
+		gsi_is_thread_pool_free(p_pool);
 		return NULL;
 	}
 
-	// Allocate queue of tasks
-	p_pool->queue = (gsi_thread_pool_task_t*)malloc(sizeof(gsi_thread_pool_task_t) * i_queue_size);
-	if (NULL == p_pool->queue)
+	// Allocate lanes (positions on their own lines) - no ring yet, for free on failure
+	if (0 != posix_memalign((void **)&p_pool->p_lanes, GSI_TP_CACHE_LINE, sizeof(gsi_thread_pool_lane_t) * p_pool->i_lanes))
 	{
-		free(p_pool->p_threads);
-		free(p_pool);
+		p_pool->p_lanes = NULL;
+		gsi_is_thread_pool_free(p_pool);
 		return NULL;
 	}
 
-	// Init the mutex
-	if (0 != pthread_mutex_init(&(p_pool->lock), NULL))
+	for (int i = 0; i < p_pool->i_lanes; ++i)
+	{
+		p_pool->p_lanes[i].p_first_ring = NULL;
+	}
+
+	// Allocate queue of tasks of each lane - each cell is free for the position of its index
+	for (int i = 0; i < p_pool->i_lanes; ++i)
+	{
+		p_pool->p_lanes[i].p_first_ring = gsi_is_thread_pool_ring_create(ul_cells);
+		if (NULL == p_pool->p_lanes[i].p_first_ring)
+		{
+			gsi_is_thread_pool_free(p_pool);
+			return NULL;
+		}
+
+		p_pool->p_lanes[i].p_add_ring = p_pool->p_lanes[i].p_first_ring;
+		p_pool->p_lanes[i].p_take_ring = p_pool->p_lanes[i].p_first_ring;
+		p_pool->p_lanes[i].ui_space_seq = 0;
+		p_pool->p_lanes[i].i_add_waiters = 0;
+		p_pool->p_lanes[i].ul_timed = 0;
+		p_pool->p_lanes[i].ul_wait_ns = 0;
+		p_pool->p_lanes[i].ul_max_wait_ns = 0;
+	}
+
+	// Weighted - turns in smooth order: each turn goes to the lane of most credit
+	// (weights 2, 1 - lanes 0, 1, 0 - not 0, 0, 1)
+	if (GSI_TP_POLICY_WEIGHTED == p_pool->e_policy)
+	{
+		p_pool->p_turns = (int*)malloc(sizeof(int) * i_turns);
+		if (NULL == p_pool->p_turns)
+		{
+			gsi_is_thread_pool_free(p_pool);
+			return NULL;
+		}
+
+		for (int i_turn = 0; i_turn < i_turns; ++i_turn)
+		{
+			i_best = 0;
+			for (int i = 0; i < p_pool->i_lanes; ++i)
+			{
+				a_credits[i] += p_attr->a_weights[i];
+				if (a_credits[i] > a_credits[i_best])
+				{
+					i_best = i;
+				}
+			}
+
+			a_credits[i_best] -= i_turns;
+			p_pool->p_turns[i_turn] = i_best;
+		}
+	}
+
+	// Allocate futures (at least one - malloc(0) may fail) - all of them are free
+	p_pool->p_free_futures = gsi_is_thread_pool_ring_create(ul_future_cells);
+	p_pool->p_futures = (gsi_thread_pool_future_t*)malloc(sizeof(gsi_thread_pool_future_t) * (p_attr->i_futures + 1));
+	if ((NULL == p_pool->p_free_futures) || (NULL == p_pool->p_futures))
 	{
-		free(p_pool->queue);
-		free(p_pool->p_threads);
-		free(p_pool);
+		gsi_is_thread_pool_free(p_pool);
 		return NULL;
 	}
 
-	// Init the condition variable
-	if (0 != pthread_cond_init(&(p_pool->notify), NULL))
+	for (int i = 0; i < p_attr->i_futures; ++i)
+	{
+		p_pool->p_futures[i].i_alone = 0;
+		p_pool->p_futures[i].p_pool = p_pool;
+		gsi_is_thread_pool_ring_push(p_pool->p_free_futures, NULL, &p_pool->p_futures[i], 0);
+	}
+
+	// Allocate workers (top and bottom of deque on their own lines)
+	if (0 != posix_memalign((void **)&p_pool->p_workers, GSI_TP_CACHE_LINE, sizeof(gsi_thread_pool_worker_t) * i_max_threads))
 	{
-		pthread_mutex_destroy(&(p_pool->lock));
-		free(p_pool->queue);
-		free(p_pool->p_threads);
-		free(p_pool);
+		p_pool->p_workers = NULL;
+		gsi_is_thread_pool_free(p_pool);
 		return NULL;
 	}
 
+	for (int i = 0; i < i_max_threads; ++i)
+	{
+		p_pool->p_workers[i].l_top = 0;
+		p_pool->p_workers[i].l_bottom = 0;
+		p_pool->p_workers[i].p_deque = NULL;
+		p_pool->p_workers[i].p_pool = p_pool;
+		p_pool->p_workers[i].ui_seed = (unsigned int)i + 1;
+		p_pool->p_workers[i].ui_turn = (unsigned int)i;
+		p_pool->p_workers[i].i_state = GSI_TP_WORKER_FREE;
+	}
+
 	// Start worker threads
-	for (int i = 0; i < i_thread_count; ++i)
+	for (int i = 0; i < p_pool->i_min_threads; ++i)
+	{
+		if (0 != gsi_is_thread_pool_start_worker(p_pool, i))
+		{
+			gsi_is_thread_pool_destroy(p_pool, GSI_TP_DESTROY_IMMIDIATE);
+			return NULL;
+		}
+	}
+
+	// Elastic - start the manager of workers
+	if (p_pool->i_min_threads < i_max_threads)
 	{
-		if (0 != pthread_create(&(p_pool->p_threads[i]), NULL, gsi_is_thread_run, p_pool))
+		if (0 != pthread_create(&p_pool->manager, NULL, gsi_is_thread_manager_run, p_pool))
 		{
 			gsi_is_thread_pool_destroy(p_pool, GSI_TP_DESTROY_IMMIDIATE);
 			return NULL;
 		}
 
-		// Add 1 to the number of current working threads
-		p_pool->i_thread_count++;
-		p_pool->i_started++;
+		p_pool->i_manager = 1;
 	}
 
 	return p_pool;
@@ -111,7 +390,10 @@ gsi_thread_pool_t* gsi_is_thread_pool_create(int i_thread_count, int i_queue_siz
 
 /*###########################################################################
 	 * Name:      	thread_pool_add
-	 * Description: Add a new task in the queue of a thread pool.
+	 * Description: Add a new task in the queue of a thread pool (fails if it is full).
+	 * 				Lock-free, wakes one sleeping worker. The task goes to the last lane.
+	 * 				Work stealing - a task added by a worker of the pool goes to its
+	 * 				own deque (to the queue if the deque is full).
 	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to which add the task.
 	 * Parameter:   [in] thread_func_t thread_func - Pointer to the function that will perform the task.
 	 * Parameter:   [in] void* args - Argument to be passed to the function.
@@ -119,228 +401,2087 @@ gsi_thread_pool_t* gsi_is_thread_pool_create(int i_thread_count, int i_queue_siz
 	 * 				Failure - GSI_TP_RC_ERROR *OR* GSI_TP_RC_INVALID
 #############################################################################*/
 enum gsi_thread_pool_rc gsi_is_thread_pool_add(gsi_thread_pool_t* p_pool, thread_func_t thread_func, void* args)
+{
+	return gsi_is_thread_pool_add_wait(p_pool, thread_func, args, 0);
+}
+
+/*###########################################################################
+	 * Name:      	thread_pool_add_wait
+	 * Description: Add a new task to the last lane, waiting for space while it is full
+	 * 				(backpressure, see thread_pool_add_lane())
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to which add the task.
+	 * Parameter:   [in] thread_func_t thread_func - Pointer to the function that will perform the task.
+	 * Parameter:   [in] void* args - Argument to be passed to the function.
+	 * Parameter:   [in] int i_timeout_msecs - GSI_TP_WAIT_FOREVER - block, 0 - fail fast,
+	 * 										   else - wait up to milliseconds
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_TIMEOUT *OR* GSI_TP_RC_ERROR *OR* GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_add_wait(gsi_thread_pool_t* p_pool, thread_func_t thread_func, void* args,
+													int i_timeout_msecs)
 {
 	// Check input validation
-	if ((NULL == p_pool) || (NULL == thread_func))
+	if (NULL == p_pool)
 	{
 		return GSI_TP_RC_INVALID;
 	}
 
-	// Try to lock the mutex to own the thread pool
-	if (0 != pthread_mutex_lock(&(p_pool->lock)))
-	{
-		return GSI_TP_RC_ERROR;
-	}
+	return gsi_is_thread_pool_add_lane(p_pool, p_pool->i_lanes - 1, thread_func, args, i_timeout_msecs);
+}
+
+/*###########################################################################
+	 * Name:      	thread_pool_add_lane
+	 * Description: Add a new task to a lane, waiting for space while it is full (backpressure).
+	 * 				The adder is counted as waiter of the lane before it tries again, and
+	 * 				sleeps only when no take claimed a cell of the full ring
+	 * 				(gsi_is_thread_pool_is_full()). A worker of the pool never waits
+	 * 				(it may be the one to take).
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to which add the task.
+	 * Parameter:   [in] int i_lane - lane of task (0 - the most urgent).
+	 * Parameter:   [in] thread_func_t thread_func - Pointer to the function that will perform the task.
+	 * Parameter:   [in] void* args - Argument to be passed to the function.
+	 * Parameter:   [in] int i_timeout_msecs - GSI_TP_WAIT_FOREVER - block, 0 - fail fast,
+	 * 										   else - wait up to milliseconds
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_TIMEOUT *OR* GSI_TP_RC_ERROR *OR* GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_add_lane(gsi_thread_pool_t* p_pool, int i_lane, thread_func_t thread_func,
+													void* args, int i_timeout_msecs)
+{
+	enum gsi_thread_pool_rc e_rc = GSI_TP_RC_ERROR;
+	gsi_thread_pool_lane_t* p_lane = NULL;
+	struct timespec left;
+	long long ll_end_ns = 0;
+	unsigned int ui_seq = 0;
 
-	// Check if the queue is full
-	if (p_pool->i_count == p_pool->i_queue_size)
+	// Check input validation
+	if ((NULL == p_pool) || (0 > i_lane) || (p_pool->i_lanes <= i_lane) || (NULL == thread_func) ||
+		(GSI_TP_WAIT_FOREVER > i_timeout_msecs))
 	{
-		return GSI_TP_RC_ERROR;
+		return GSI_TP_RC_INVALID;
 	}
 
+	p_lane = &p_pool->p_lanes[i_lane];
+
 	// Check if we are in shutdown
-	if (0 < p_pool->i_shutdown)
+	if (0 < __atomic_load_n(&p_pool->i_shutdown, __ATOMIC_ACQUIRE))
 	{
 		return GSI_TP_RC_ERROR;
 	}
 
-	// Add task to queue
-	p_pool->queue[p_pool->i_tail].thread_func = thread_func;
-	p_pool->queue[p_pool->i_tail].args = args;
-
-	// Update the tail index
-	p_pool->i_tail = (p_pool->i_tail + 1) % p_pool->i_queue_size;
-
-	// Update the number of pending tasks
-	p_pool->i_count++;
+	if (0 == gsi_is_thread_pool_submit(p_pool, p_lane, thread_func, args))
+	{
+		return GSI_TP_RC_SUCCESS;
+	}
 
-	// Notify that there is new work in queue
-	if (0 != pthread_cond_broadcast(&(p_pool->notify)))
+	// Queue is full - fail fast (a worker too, it may be the one to take)
+	if ((0 == i_timeout_msecs) || ((NULL != g_p_worker) && (p_pool == g_p_worker->p_pool)))
 	{
 		return GSI_TP_RC_ERROR;
 	}
 
-	// Unlock the mutex
-	if (0 != pthread_mutex_unlock(&p_pool->lock))
+	ll_end_ns = gsi_is_thread_pool_time_left(0, NULL) + i_timeout_msecs * 1000000LL;
+
+	// Counted before each try - see gsi_is_thread_pool_pop()
+	__atomic_add_fetch(&p_lane->i_add_waiters, 1, __ATOMIC_SEQ_CST);
+
+	while (1)
 	{
-		return GSI_TP_RC_ERROR;
+		ui_seq = __atomic_load_n(&p_lane->ui_space_seq, __ATOMIC_ACQUIRE);
+
+		if (0 < __atomic_load_n(&p_pool->i_shutdown, __ATOMIC_SEQ_CST))
+		{
+			e_rc = GSI_TP_RC_ERROR;
+			break;
+		}
+
+		if (0 == gsi_is_thread_pool_submit(p_pool, p_lane, thread_func, args))
+		{
+			e_rc = GSI_TP_RC_SUCCESS;
+			break;
+		}
+
+		if ((GSI_TP_WAIT_FOREVER != i_timeout_msecs) && (0 == gsi_is_thread_pool_time_left(ll_end_ns, &left)))
+		{
+			e_rc = GSI_TP_RC_TIMEOUT;
+			break;
+		}
+
+		// A take claimed a cell already - it is free soon
+		if (0 == gsi_is_thread_pool_is_full(p_lane))
+		{
+			sched_yield();
+			continue;
+		}
+
+		// Wait for a take of the lane (or destroy) that changes ui_space_seq
+		syscall(SYS_futex, &p_lane->ui_space_seq, FUTEX_WAIT_PRIVATE, ui_seq,
+				(GSI_TP_WAIT_FOREVER != i_timeout_msecs) ? &left : NULL, NULL, 0);
 	}
 
-	return GSI_TP_RC_SUCCESS;
+	// Destroy waits for it to leave
+	__atomic_sub_fetch(&p_lane->i_add_waiters, 1, __ATOMIC_RELEASE);
+
+	return e_rc;
 }
 
 /*###########################################################################
-	 * Name:        thread_pool_destroy
-	 * Description: Stops and destroys a thread pool. Must be called after use of thread_pool_create()
-	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to destroy.
-	 * Parameter:   [in] int i_flags - Flags for shutdown - 1 default, 2 - graceful
-	 * Return: 	    Success - GSI_TP_RC_SUCCESS
-	 * 				Failure - GSI_TP_RC_ERROR *OR* GSI_TP_RC_INVALID
+	 * Name:      	thread_pool_add_batch
+	 * Description: Add tasks to a lane at once - consecutive cells of its queue are
+	 * 				claimed by one CAS (work stealing, last lane - tasks of worker go to
+	 * 				its deque while it has room), then min(tasks, sleeping) workers are
+	 * 				woken by one system call. Fails fast like thread_pool_add().
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to which add the tasks.
+	 * Parameter:   [in] int i_lane - lane of tasks (0 - the most urgent).
+	 * Parameter:   [in] const gsi_thread_pool_task_t *p_tasks - tasks, in order.
+	 * Parameter:   [in] int i_count - number of tasks.
+	 * Parameter:   [out] int* p_added - number of tasks that were added (the first ones)
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS (all were added)
+	 * 				Failure - GSI_TP_RC_ERROR (full / shutdown) *OR* GSI_TP_RC_INVALID
 #############################################################################*/
-enum gsi_thread_pool_rc gsi_is_thread_pool_destroy(gsi_thread_pool_t* p_pool, int i_flags)
+enum gsi_thread_pool_rc gsi_is_thread_pool_add_batch(gsi_thread_pool_t* p_pool, int i_lane, const gsi_thread_pool_task_t* p_tasks,
+													 int i_count, int* p_added)
 {
+	int i_added = 0;
+
 	// Check input validation
-	if (NULL == p_pool)
+	if ((NULL == p_pool) || (0 > i_lane) || (p_pool->i_lanes <= i_lane) || (NULL == p_tasks) || (0 > i_count) ||
+		(NULL == p_added))
 	{
 		return GSI_TP_RC_INVALID;
 	}
 
-	// Try to lock the mutex to own the thread pool
-	if (0 != pthread_mutex_lock(&(p_pool->lock)))
-	{
-		return GSI_TP_RC_ERROR;
-	}
-
-	// Check if already in shutdown
-	if (0 != p_pool->i_shutdown)
-	{
-		return GSI_TP_RC_ERROR;
-	}
-
-	// Update shutdown according to i_flags
-	if (GSI_TP_DESTROY_GRACEFUL == i_flags)
-	{
-		p_pool->i_shutdown = GSI_TP_DESTROY_GRACEFUL;
-	}
-	else
-	{
-		p_pool->i_shutdown = GSI_TP_DESTROY_IMMIDIATE;
-	}
+	*p_added = 0;
 
-	// Wake up all threads
-	if (0 != pthread_cond_broadcast(&(p_pool->notify)))
+	for (int i = 0; i < i_count; ++i)
 	{
-		return GSI_TP_RC_ERROR;
+		if (NULL == p_tasks[i].thread_func)
+		{
+			return GSI_TP_RC_INVALID;
+		}
 	}
 
-	// Unlock the mutex to get threads continue
-	if (0 != pthread_mutex_unlock(&(p_pool->lock)))
+	// Check if we are in shutdown
+	if (0 < __atomic_load_n(&p_pool->i_shutdown, __ATOMIC_ACQUIRE))
 	{
 		return GSI_TP_RC_ERROR;
 	}
 
-	// Join all worker thread
-	for (int i = 0; i < p_pool->i_thread_count; ++i)
+	// Tasks of worker stay with it (see gsi_is_thread_pool_submit())
+	if ((NULL != g_p_worker) && (p_pool == g_p_worker->p_pool) && (NULL != g_p_worker->p_deque) &&
+		(p_pool->i_lanes - 1 == i_lane))
 	{
-		if (0 != pthread_join(p_pool->p_threads[i], NULL))
+		while ((i_added < i_count) &&
+			   (0 == gsi_is_thread_pool_deque_push(g_p_worker, p_tasks[i_added].thread_func, p_tasks[i_added].args)))
 		{
-			return GSI_TP_RC_ERROR;
+			++i_added;
 		}
 	}
 
-	// Free the thread pool
-	gsi_is_thread_pool_free(p_pool);
+	i_added += gsi_is_thread_pool_push_batch(p_pool, &p_pool->p_lanes[i_lane], p_tasks + i_added, i_count - i_added);
+	*p_added = i_added;
 
-	return GSI_TP_RC_SUCCESS;
+	// Notify the workers that there is new work in queue
+	gsi_is_thread_pool_wake(p_pool, i_added);
+
+	return (i_count == i_added) ? GSI_TP_RC_SUCCESS : GSI_TP_RC_ERROR;
 }
 
-/***********************************/
-/* Static functions implementation */
-/***********************************/
 /*###########################################################################
-	 * Name:		thread_run
-	 * Description: That is the main loop of each thread in thread pool
-	 * Parameter:   [in] void* args - must be pointer to thread pool object
-	 * Return:		NULL
+	 * Name:      	thread_pool_add_future
+	 * Description: Add a new task (like thread_pool_add_wait()) and return its future.
+	 * 				The owner must release it by thread_pool_future_release(), before destroy.
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to which add the task.
+	 * Parameter:   [in] thread_func_t thread_func - Pointer to the function that will perform the task.
+	 * Parameter:   [in] void* args - Argument to be passed to the function.
+	 * Parameter:   [in] int i_timeout_msecs - wait for space (see thread_pool_add_wait())
+	 * Return: 	    Success - future of task
+	 * 				Failure - NULL
 #############################################################################*/
-static void* gsi_is_thread_run(void* args)
+gsi_thread_pool_future_t* gsi_is_thread_pool_add_future(gsi_thread_pool_t* p_pool, thread_func_t thread_func, void* args,
+														int i_timeout_msecs)
 {
-	gsi_thread_pool_t* p_pool = (gsi_thread_pool_t*)args;
+	gsi_thread_pool_future_t* p_future = NULL;
 	gsi_thread_pool_task_t task;
 
 	// Check input validation
-	if (NULL == args)
+	if ((NULL == p_pool) || (NULL == thread_func))
 	{
 		return NULL;
 	}
 
-	// Main loop
-	while (1)
+	// Free future of pool, else one alone
+	if (0 == gsi_is_thread_pool_ring_pop(p_pool->p_free_futures, &task, NULL))
 	{
-		// Lock the mutex
-		if (0 != pthread_mutex_lock(&(p_pool->lock)))
+		p_future = (gsi_thread_pool_future_t*)task.args;
+	}
+	else
+	{
+		p_future = (gsi_thread_pool_future_t*)malloc(sizeof(gsi_thread_pool_future_t));
+		if (NULL == p_future)
 		{
-			break;
+			return NULL;
 		}
 
-		// Wait on condition variable until we have tasks, check for spurious wakeups.
-        // When returning from pthread_cond_wait(), we own the lock.
-		while ((p_pool->i_count == 0) && (!p_pool->i_shutdown))
-		{
-			pthread_cond_wait(&(p_pool->notify), &(p_pool->lock));
-		}
+		p_future->i_alone = 1;
+		p_future->p_pool = p_pool;
+	}
 
-		// Check destroy status
-		if ((p_pool->i_shutdown == GSI_TP_DESTROY_IMMIDIATE) ||
-		   ((p_pool->i_shutdown == GSI_TP_DESTROY_GRACEFUL) && (p_pool->i_count == 0)))
-		{
-			break;
-		}
+	p_future->ui_state = GSI_TP_FUTURE_PENDING;
+	p_future->i_waiters = 0;
+	p_future->i_refs = 2;
+	p_future->thread_func = thread_func;
+	p_future->args = args;
+	p_future->p_result = NULL;
+	p_future->then_func = NULL;
+	p_future->then_args = NULL;
+
+	if (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add_wait(p_pool, gsi_is_thread_pool_future_run, p_future, i_timeout_msecs))
+	{
+		p_future->i_refs = 1;
+		gsi_is_thread_pool_future_put(p_future);
+		return NULL;
+	}
+
+	return p_future;
+}
+
+/*###########################################################################
+	 * Name:      	thread_pool_future_wait
+	 * Description: Wait for task of future to finish. The waiter is counted before
+	 * 				it reads the state - the task that didn't see it was seen done.
+	 * Parameter:   [in] gsi_thread_pool_future_t *p_future - future of task.
+	 * Parameter:   [in] int i_timeout_msecs - GSI_TP_WAIT_FOREVER - block, 0 - check only,
+	 * 										   else - wait up to milliseconds
+	 * Parameter:   [out] void** pp_result - return value of the task (may be NULL)
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_TIMEOUT *OR* GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_future_wait(gsi_thread_pool_future_t* p_future, int i_timeout_msecs,
+													   void** pp_result)
+{
+	struct timespec left;
+	long long ll_end_ns = 0;
+	unsigned int ui_state = 0;
 
-		// Get the first task
-		task.thread_func = p_pool->queue[p_pool->i_head].thread_func;
-		task.args = p_pool->queue[p_pool->i_head].args;
+	// Check input validation
+	if ((NULL == p_future) || (GSI_TP_WAIT_FOREVER > i_timeout_msecs))
+	{
+		return GSI_TP_RC_INVALID;
+	}
 
-		// Update the head index
-		p_pool->i_head = (p_pool->i_head + 1) % p_pool->i_queue_size;
+	if ((0 == (__atomic_load_n(&p_future->ui_state, __ATOMIC_ACQUIRE) & GSI_TP_FUTURE_DONE)) &&
+		(0 != i_timeout_msecs))
+	{
+		ll_end_ns = gsi_is_thread_pool_time_left(0, NULL) + i_timeout_msecs * 1000000LL;
 
-		// Decrease the number of pending tasks
-		p_pool->i_count--;
+		__atomic_add_fetch(&p_future->i_waiters, 1, __ATOMIC_SEQ_CST);
 
-		// Unlock the mutex
-		if (0 != pthread_mutex_unlock(&(p_pool->lock)))
+		while (1)
 		{
-			break;
+			ui_state = __atomic_load_n(&p_future->ui_state, __ATOMIC_SEQ_CST);
+			if ((0 != (ui_state & GSI_TP_FUTURE_DONE)) ||
+				((GSI_TP_WAIT_FOREVER != i_timeout_msecs) && (0 == gsi_is_thread_pool_time_left(ll_end_ns, &left))))
+			{
+				break;
+			}
+
+			syscall(SYS_futex, &p_future->ui_state, FUTEX_WAIT_PRIVATE, ui_state,
+					(GSI_TP_WAIT_FOREVER != i_timeout_msecs) ? &left : NULL, NULL, 0);
 		}
 
-		// Go to work
-		(*(task.thread_func))(task.args);
+		__atomic_sub_fetch(&p_future->i_waiters, 1, __ATOMIC_RELAXED);
 	}
 
-	// Decrease the number of working threads
-	p_pool->i_started--;
+	if (0 == (__atomic_load_n(&p_future->ui_state, __ATOMIC_ACQUIRE) & GSI_TP_FUTURE_DONE))
+	{
+		return GSI_TP_RC_TIMEOUT;
+	}
 
-	// Unlock the mutex
-	pthread_mutex_unlock(&(p_pool->lock));
+	if (NULL != pp_result)
+	{
+		*pp_result = p_future->p_result;
+	}
 
-	return NULL;
+	return GSI_TP_RC_SUCCESS;
 }
 
 /*###########################################################################
-	 * Name:		thread_pool_free
-	 * Description: clean up all the allocations of threadpool_create
-	 * Parameter:   [in] - gsi_thread_pool_t* p_pool - object to be free
-	 * Return:		Success - GSI_TP_RC_SUCCESS
+	 * Name:      	thread_pool_future_then
+	 * Description: Set function to call with the result of task - the one of the
+	 * 				owner / the task that sets its bit second calls it
+	 * Parameter:   [in] gsi_thread_pool_future_t *p_future - future of task.
+	 * Parameter:   [in] future_then_func_t then_func - function to call.
+	 * Parameter:   [in] void* args - Argument to be passed to the function.
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
 	 * 				Failure - GSI_TP_RC_ERROR *OR* GSI_TP_RC_INVALID
 #############################################################################*/
-static enum gsi_thread_pool_rc gsi_is_thread_pool_free(gsi_thread_pool_t* p_pool)
+enum gsi_thread_pool_rc gsi_is_thread_pool_future_then(gsi_thread_pool_future_t* p_future, future_then_func_t then_func,
+													   void* args)
 {
+	unsigned int ui_state = 0;
+
 	// Check input validation
-	if (NULL == p_pool)
+	if ((NULL == p_future) || (NULL == then_func))
 	{
 		return GSI_TP_RC_INVALID;
 	}
 
-	// Check if there are still running threads
-	if (0 < p_pool->i_started)
+	// Once only
+	if (0 != (__atomic_load_n(&p_future->ui_state, __ATOMIC_RELAXED) & GSI_TP_FUTURE_THEN))
 	{
 		return GSI_TP_RC_ERROR;
 	}
 
-	free(p_pool->p_threads);
-	free(p_pool->queue);
+	p_future->then_func = then_func;
+	p_future->then_args = args;
 
-	if (0 != pthread_mutex_destroy(&(p_pool->lock)))
+	ui_state = __atomic_fetch_or(&p_future->ui_state, GSI_TP_FUTURE_THEN, __ATOMIC_ACQ_REL);
+	if (0 != (ui_state & GSI_TP_FUTURE_DONE))
 	{
-		return GSI_TP_RC_ERROR;
+		(*then_func)(p_future->p_result, args);
 	}
 
-	if (0 != pthread_cond_destroy(&(p_pool->notify)))
+	return GSI_TP_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:      	thread_pool_future_release
+	 * Description: Owner is done with future (back to the free futures when its task left it too)
+	 * Parameter:   [in] gsi_thread_pool_future_t *p_future - future of task.
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_future_release(gsi_thread_pool_future_t* p_future)
+{
+	// Check input validation
+	if (NULL == p_future)
 	{
-		return GSI_TP_RC_ERROR;
+		return GSI_TP_RC_INVALID;
 	}
 
-	free(p_pool);
+	gsi_is_thread_pool_future_put(p_future);
 
 	return GSI_TP_RC_SUCCESS;
 }
+
+/*###########################################################################
+	 * Name:      	thread_pool_strand_create
+	 * Description: Creates a strand - its tasks run on the pool one at a time, in order
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool that runs the strand.
+	 * Parameter:   [in] int i_lane - lane of pool of the strand (0 - the most urgent).
+	 * Parameter:   [in] int i_queue_size - tasks that may wait in the strand.
+	 * Return: 	    Success - pointer to new strand
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_thread_pool_strand_t* gsi_is_thread_pool_strand_create(gsi_thread_pool_t* p_pool, int i_lane, int i_queue_size)
+{
+	gsi_thread_pool_strand_t* p_strand = NULL;
+	unsigned long ul_cells = 2;
+
+	// Check input validation
+	if ((NULL == p_pool) || (0 > i_lane) || (p_pool->i_lanes <= i_lane) ||
+		(0 >= i_queue_size) || (GSI_IS_MAX_QUEUE_SIZE < i_queue_size))
+	{
+		return NULL;
+	}
+
+	// Its count is aligned on cache line
+	if (0 != posix_memalign((void **)&p_strand, GSI_TP_CACHE_LINE, sizeof(gsi_thread_pool_strand_t)))
+	{
+		return NULL;
+	}
+
+	while (ul_cells < (unsigned long)i_queue_size)
+	{
+		ul_cells <<= 1;
+	}
+
+	p_strand->p_ring = gsi_is_thread_pool_ring_create(ul_cells);
+	if (NULL == p_strand->p_ring)
+	{
+		free(p_strand);
+		return NULL;
+	}
+
+	p_strand->i_pending = 0;
+	p_strand->p_pool = p_pool;
+	p_strand->i_lane = i_lane;
+
+	return p_strand;
+}
+
+/*###########################################################################
+	 * Name:      	thread_pool_strand_post
+	 * Description: Add a task to a strand. The task is counted after it is in the ring -
+	 * 				the post that counts the first task adds the strand to the pool
+	 * 				(the pool is full - runs it by itself, it is not lost).
+	 * Parameter:   [in] gsi_thread_pool_strand_t *p_strand - strand of the task.
+	 * Parameter:   [in] thread_func_t thread_func - Pointer to the function that will perform the task.
+	 * Parameter:   [in] void* args - Argument to be passed to the function.
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_ERROR *OR* GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_strand_post(gsi_thread_pool_strand_t* p_strand, thread_func_t thread_func,
+													   void* args)
+{
+	// Check input validation
+	if ((NULL == p_strand) || (NULL == thread_func))
+	{
+		return GSI_TP_RC_INVALID;
+	}
+
+	// Ring of strand is never replaced - not 0 is full
+	if (0 != gsi_is_thread_pool_ring_push(p_strand->p_ring, thread_func, args, 0))
+	{
+		return GSI_TP_RC_ERROR;
+	}
+
+	if ((0 == __atomic_fetch_add(&p_strand->i_pending, 1, __ATOMIC_ACQ_REL)) &&
+		(GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add_lane(p_strand->p_pool, p_strand->i_lane,
+														  gsi_is_thread_pool_strand_run, p_strand, 0)))
+	{
+		gsi_is_thread_pool_strand_run(p_strand);
+	}
+
+	return GSI_TP_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:      	thread_pool_strand_destroy
+	 * Description: Waits for the tasks of strand to finish and destroys it
+	 * Parameter:   [in] gsi_thread_pool_strand_t *p_strand - strand to destroy.
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_strand_destroy(gsi_thread_pool_strand_t* p_strand)
+{
+	// Check input validation
+	if (NULL == p_strand)
+	{
+		return GSI_TP_RC_INVALID;
+	}
+
+	// Its task doesn't look at it after the last count
+	while (0 < __atomic_load_n(&p_strand->i_pending, __ATOMIC_ACQUIRE))
+	{
+		sched_yield();
+	}
+
+	free(p_strand->p_ring->p_cells);
+	free(p_strand->p_ring);
+	free(p_strand);
+
+	return GSI_TP_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:      	thread_pool_add_timer
+	 * Description: Add a task to a lane after a delay, and every period after it. The
+	 * 				first timer starts the timer thread and its timerfd. A timer that
+	 * 				is the first deadline now sets the timerfd again.
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to which add the task.
+	 * Parameter:   [in] int i_lane - lane of task (0 - the most urgent).
+	 * Parameter:   [in] thread_func_t thread_func - Pointer to the function that will perform the task.
+	 * Parameter:   [in] void* args - Argument to be passed to the function.
+	 * Parameter:   [in] int i_delay_msecs - time until the first run (0 - now)
+	 * Parameter:   [in] int i_period_msecs - time between runs (0 - once)
+	 * Return: 	    Success - the timer
+	 * 				Failure - NULL
+#############################################################################*/
+gsi_thread_pool_timer_t* gsi_is_thread_pool_add_timer(gsi_thread_pool_t* p_pool, int i_lane, thread_func_t thread_func,
+													  void* args, int i_delay_msecs, int i_period_msecs)
+{
+	gsi_thread_pool_timer_t* p_timer = NULL;
+	gsi_thread_pool_timer_t** p_timers = NULL;
+	int i_size = 0;
+	int i_added = 0;
+
+	// Check input validation
+	if ((NULL == p_pool) || (0 > i_lane) || (p_pool->i_lanes <= i_lane) || (NULL == thread_func) ||
+		(0 > i_delay_msecs) || (0 > i_period_msecs))
+	{
+		return NULL;
+	}
+
+	p_timer = (gsi_thread_pool_timer_t*)malloc(sizeof(gsi_thread_pool_timer_t));
+	if (NULL == p_timer)
+	{
+		return NULL;
+	}
+
+	p_timer->ll_expire_ns = gsi_is_thread_pool_time_left(0, NULL) + i_delay_msecs * 1000000LL;
+	p_timer->ll_period_ns = i_period_msecs * 1000000LL;
+	p_timer->thread_func = thread_func;
+	p_timer->args = args;
+	p_timer->i_lane = i_lane;
+	p_timer->i_index = -1;
+
+	pthread_mutex_lock(&p_pool->timer_lock);
+
+	do
+	{
+		// Check if we are in shutdown (under the lock - destroy stops the timer thread under it)
+		if (0 < __atomic_load_n(&p_pool->i_shutdown, __ATOMIC_ACQUIRE))
+		{
+			break;
+		}
+
+		// First timer - start the timer thread (pools without timers have none)
+		if (-1 == p_pool->i_timer_fd)
+		{
+			p_pool->i_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+			if (-1 == p_pool->i_timer_fd)
+			{
+				break;
+			}
+
+			if (0 != pthread_create(&p_pool->timer_thread, NULL, gsi_is_thread_timer_run, p_pool))
+			{
+				close(p_pool->i_timer_fd);
+				p_pool->i_timer_fd = -1;
+				break;
+			}
+		}
+
+		// Heap is full - double it
+		if (p_pool->i_timers == p_pool->i_timers_size)
+		{
+			i_size = (0 == p_pool->i_timers_size) ? GSI_TP_TIMERS : p_pool->i_timers_size * 2;
+			p_timers = (gsi_thread_pool_timer_t**)realloc(p_pool->p_timers, sizeof(gsi_thread_pool_timer_t*) * i_size);
+			if (NULL == p_timers)
+			{
+				break;
+			}
+
+			p_pool->p_timers = p_timers;
+			p_pool->i_timers_size = i_size;
+		}
+
+		p_timer->i_index = p_pool->i_timers;
+		p_pool->p_timers[p_pool->i_timers++] = p_timer;
+		gsi_is_thread_pool_heap_up(p_pool, p_timer->i_index);
+		i_added = 1;
+
+		// First deadline now - the timer thread sleeps until it
+		if (0 == p_timer->i_index)
+		{
+			gsi_is_thread_pool_timer_arm(p_pool);
+		}
+	}
+	while (0);
+
+	pthread_mutex_unlock(&p_pool->timer_lock);
+
+	// Not p_timer->i_index - the timer may have fired once already (the timer thread owns it now)
+	if (0 == i_added)
+	{
+		free(p_timer);
+		return NULL;
+	}
+
+	return p_timer;
+}
+
+/*###########################################################################
+	 * Name:      	thread_pool_cancel_timer
+	 * Description: Take timer out of the heap (if it is in it) and free it. The timerfd
+	 * 				is left set - the timer thread wakes up for nothing once.
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool of timer.
+	 * Parameter:   [in] gsi_thread_pool_timer_t *p_timer - timer to cancel.
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_cancel_timer(gsi_thread_pool_t* p_pool, gsi_thread_pool_timer_t* p_timer)
+{
+	// Check input validation
+	if ((NULL == p_pool) || (NULL == p_timer))
+	{
+		return GSI_TP_RC_INVALID;
+	}
+
+	pthread_mutex_lock(&p_pool->timer_lock);
+
+	if (-1 != p_timer->i_index)
+	{
+		gsi_is_thread_pool_heap_remove(p_pool, p_timer->i_index);
+	}
+
+	pthread_mutex_unlock(&p_pool->timer_lock);
+
+	free(p_timer);
+
+	return GSI_TP_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:      	thread_pool_lane_stats
+	 * Description: Depth and wait of tasks of a lane (taken is read before added -
+	 * 				the depth is never negative)
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool.
+	 * Parameter:   [in] int i_lane - lane (0 - the most urgent).
+	 * Parameter:   [out] gsi_thread_pool_lane_stats_t *p_stats - counters of lane.
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_lane_stats(gsi_thread_pool_t* p_pool, int i_lane,
+													  gsi_thread_pool_lane_stats_t* p_stats)
+{
+	gsi_thread_pool_lane_t* p_lane = NULL;
+
+	// Check input validation
+	if ((NULL == p_pool) || (0 > i_lane) || (p_pool->i_lanes <= i_lane) || (NULL == p_stats))
+	{
+		return GSI_TP_RC_INVALID;
+	}
+
+	p_lane = &p_pool->p_lanes[i_lane];
+
+	p_stats->ul_added = 0;
+	p_stats->ul_taken = 0;
+	gsi_is_thread_pool_count(p_lane, &p_stats->ul_added, &p_stats->ul_taken);
+
+	p_stats->ul_depth = p_stats->ul_added - p_stats->ul_taken;
+	p_stats->ul_timed = __atomic_load_n(&p_lane->ul_timed, __ATOMIC_RELAXED);
+	p_stats->ul_wait_ns = __atomic_load_n(&p_lane->ul_wait_ns, __ATOMIC_RELAXED);
+	p_stats->ul_max_wait_ns = __atomic_load_n(&p_lane->ul_max_wait_ns, __ATOMIC_RELAXED);
+
+	return GSI_TP_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:        thread_pool_destroy
+	 * Description: Stops and destroys a thread pool. Must be called after use of thread_pool_create()
+	 * Parameter:   [in] gsi_thread_pool_t *p_pool - Thread pool to destroy.
+	 * Parameter:   [in] int i_flags - Flags for shutdown - 1 default, 2 - graceful
+	 * Return: 	    Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_ERROR *OR* GSI_TP_RC_INVALID
+#############################################################################*/
+enum gsi_thread_pool_rc gsi_is_thread_pool_destroy(gsi_thread_pool_t* p_pool, int i_flags)
+{
+	int i_shutdown = 0;
+
+	// Check input validation
+	if (NULL == p_pool)
+	{
+		return GSI_TP_RC_INVALID;
+	}
+
+	// Update shutdown according to i_flags (fails if already in shutdown)
+	if (!__atomic_compare_exchange_n(&p_pool->i_shutdown, &i_shutdown,
+									 (GSI_TP_DESTROY_GRACEFUL == i_flags) ? GSI_TP_DESTROY_GRACEFUL : GSI_TP_DESTROY_IMMIDIATE,
+									 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+	{
+		return GSI_TP_RC_ERROR;
+	}
+
+	// Wake up all threads (and the adders that wait for space - they fail)
+	gsi_is_thread_pool_wake(p_pool, INT_MAX);
+	for (int i = 0; i < p_pool->i_lanes; ++i)
+	{
+		__atomic_add_fetch(&p_pool->p_lanes[i].ui_space_seq, 1, __ATOMIC_RELEASE);
+		syscall(SYS_futex, &p_pool->p_lanes[i].ui_space_seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+	}
+
+	// Stop the timer thread (it adds tasks) - the timerfd fires now, it sees the shutdown
+	pthread_mutex_lock(&p_pool->timer_lock);
+	if (-1 != p_pool->i_timer_fd)
+	{
+		gsi_is_thread_pool_timer_arm(p_pool);
+	}
+	pthread_mutex_unlock(&p_pool->timer_lock);
+
+	if ((-1 != p_pool->i_timer_fd) && (0 != pthread_join(p_pool->timer_thread, NULL)))
+	{
+		return GSI_TP_RC_ERROR;
+	}
+
+	// Stop the manager first - no worker is started after it
+	if (0 != p_pool->i_manager)
+	{
+		syscall(SYS_futex, &p_pool->i_shutdown, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+		if (0 != pthread_join(p_pool->manager, NULL))
+		{
+			return GSI_TP_RC_ERROR;
+		}
+	}
+
+	// Join all worker thread (quit ones too - the manager didn't join them yet)
+	for (int i = 0; i < p_pool->i_max_threads; ++i)
+	{
+		if ((GSI_TP_WORKER_FREE != __atomic_load_n(&p_pool->p_workers[i].i_state, __ATOMIC_ACQUIRE)) &&
+			(0 != pthread_join(p_pool->p_threads[i], NULL)))
+		{
+			return GSI_TP_RC_ERROR;
+		}
+	}
+
+	// Waiting adders still look at the pool
+	for (int i = 0; i < p_pool->i_lanes; ++i)
+	{
+		while (0 < __atomic_load_n(&p_pool->p_lanes[i].i_add_waiters, __ATOMIC_ACQUIRE))
+		{
+			sched_yield();
+		}
+	}
+
+	// Free the thread pool
+	gsi_is_thread_pool_free(p_pool);
+
+	return GSI_TP_RC_SUCCESS;
+}
+
+/***********************************/
+/* Static functions implementation */
+/***********************************/
+/*###########################################################################
+	 * Name:		thread_run
+	 * Description: That is the main loop of each thread in thread pool
+	 * Parameter:   [in] void* args - must be pointer to worker of thread pool
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_is_thread_run(void* args)
+{
+	gsi_thread_pool_worker_t* p_worker = (gsi_thread_pool_worker_t*)args;
+	gsi_thread_pool_t* p_pool = NULL;
+	gsi_thread_pool_task_t task;
+
+	// Check input validation
+	if (NULL == args)
+	{
+		return NULL;
+	}
+
+	p_pool = p_worker->p_pool;
+	g_p_worker = p_worker;
+
+	// Main loop - until shutdown (graceful - and no task is left)
+	while (0 == gsi_is_thread_pool_take(p_worker, &task))
+	{
+		// Go to work
+		(*(task.thread_func))(task.args);
+	}
+
+	// Decrease the number of working threads (the manager may join it now)
+	__atomic_sub_fetch(&p_pool->i_started, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&p_worker->i_state, GSI_TP_WORKER_EXITED, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		thread_manager_run
+	 * Description: Main loop of manager of elastic pool - each i_grow_msecs joins the
+	 * 				workers that quit, and when tasks that were added before the last
+	 * 				check are still in the lanes (they waited i_grow_msecs) and no
+	 * 				worker is idle, starts a worker for each of them (up to double
+	 * 				the workers, not more than i_max_threads)
+	 * Parameter:   [in] void* args - must be pointer to thread pool object
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_is_thread_manager_run(void* args)
+{
+	gsi_thread_pool_t* p_pool = (gsi_thread_pool_t*)args;
+	struct timespec period;
+	unsigned long ul_added_before = 0;
+	unsigned long ul_added = 0;
+	unsigned long ul_taken = 0;
+	long l_grow = 0;
+	int i_count = 0;
+
+	// Check input validation
+	if (NULL == args)
+	{
+		return NULL;
+	}
+
+	period.tv_sec = p_pool->i_grow_msecs / 1000;
+	period.tv_nsec = (long)(p_pool->i_grow_msecs % 1000) * 1000000;
+
+	while (1)
+	{
+		// Destroy wakes it up
+		syscall(SYS_futex, &p_pool->i_shutdown, FUTEX_WAIT_PRIVATE, 0, &period, NULL, 0);
+		if (0 != __atomic_load_n(&p_pool->i_shutdown, __ATOMIC_ACQUIRE))
+		{
+			break;
+		}
+
+		// Join the workers that quit (idle) - their place is free for new ones
+		for (int i = 0; i < p_pool->i_max_threads; ++i)
+		{
+			if (GSI_TP_WORKER_EXITED == __atomic_load_n(&p_pool->p_workers[i].i_state, __ATOMIC_ACQUIRE))
+			{
+				pthread_join(p_pool->p_threads[i], NULL);
+				__atomic_store_n(&p_pool->p_workers[i].i_state, GSI_TP_WORKER_FREE, __ATOMIC_RELAXED);
+			}
+		}
+
+		ul_added = 0;
+		ul_taken = 0;
+		for (int i = 0; i < p_pool->i_lanes; ++i)
+		{
+			gsi_is_thread_pool_count(&p_pool->p_lanes[i], &ul_added, &ul_taken);
+		}
+
+		// Tasks of the last check still wait
+		l_grow = (long)(ul_added_before - ul_taken);
+		i_count = __atomic_load_n(&p_pool->i_thread_count, __ATOMIC_RELAXED);
+		if ((0 < l_grow) && (0 == __atomic_load_n(&p_pool->i_sleepers, __ATOMIC_SEQ_CST)))
+		{
+			l_grow = (l_grow < i_count) ? l_grow : i_count;
+			for (int i = 0; (i < p_pool->i_max_threads) && (0 < l_grow); ++i)
+			{
+				if ((GSI_TP_WORKER_FREE == __atomic_load_n(&p_pool->p_workers[i].i_state, __ATOMIC_RELAXED)) &&
+					(0 == gsi_is_thread_pool_start_worker(p_pool, i)))
+				{
+					--l_grow;
+				}
+			}
+		}
+
+		ul_added_before = ul_added;
+	}
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		thread_timer_run
+	 * Description: Main loop of timer thread - sleeps on the timerfd until the first
+	 * 				deadline, then adds the task of each timer its deadline passed
+	 * 				(to the lane of timer - a full lane is tried again after
+	 * 				GSI_TP_TIMER_RETRY_MSECS). Once timer leaves the heap, periodic
+	 * 				one goes back to it at its next deadline (not before now).
+	 * Parameter:   [in] void* args - must be pointer to thread pool object
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_is_thread_timer_run(void* args)
+{
+	gsi_thread_pool_t* p_pool = (gsi_thread_pool_t*)args;
+	gsi_thread_pool_timer_t* p_timer = NULL;
+	uint64_t ull_expirations = 0;
+	long long ll_now_ns = 0;
+
+	// Check input validation
+	if (NULL == args)
+	{
+		return NULL;
+	}
+
+	while (1)
+	{
+		// Deadline, earlier timer or destroy (EINTR - look again, no harm)
+		if (sizeof(ull_expirations) != read(p_pool->i_timer_fd, &ull_expirations, sizeof(ull_expirations)))
+		{
+			continue;
+		}
+
+		pthread_mutex_lock(&p_pool->timer_lock);
+
+		if (0 != __atomic_load_n(&p_pool->i_shutdown, __ATOMIC_ACQUIRE))
+		{
+			pthread_mutex_unlock(&p_pool->timer_lock);
+			break;
+		}
+
+		ll_now_ns = gsi_is_thread_pool_time_left(0, NULL);
+		while ((0 < p_pool->i_timers) && (p_pool->p_timers[0]->ll_expire_ns <= ll_now_ns))
+		{
+			p_timer = p_pool->p_timers[0];
+
+			if (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add_lane(p_pool, p_timer->i_lane, p_timer->thread_func,
+																 p_timer->args, 0))
+			{
+				p_timer->ll_expire_ns = ll_now_ns + GSI_TP_TIMER_RETRY_MSECS * 1000000LL;
+			}
+			else if (0 == p_timer->ll_period_ns)
+			{
+				gsi_is_thread_pool_heap_remove(p_pool, 0);
+				continue;
+			}
+			else
+			{
+				p_timer->ll_expire_ns += p_timer->ll_period_ns;
+				if (p_timer->ll_expire_ns <= ll_now_ns)
+				{
+					p_timer->ll_expire_ns = ll_now_ns + p_timer->ll_period_ns;
+				}
+			}
+
+			gsi_is_thread_pool_heap_down(p_pool, 0);
+		}
+
+		gsi_is_thread_pool_timer_arm(p_pool);
+
+		pthread_mutex_unlock(&p_pool->timer_lock);
+	}
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_free
+	 * Description: clean up all the allocations of threadpool_create
+	 * Parameter:   [in] - gsi_thread_pool_t* p_pool - object to be free
+	 * Return:		Success - GSI_TP_RC_SUCCESS
+	 * 				Failure - GSI_TP_RC_ERROR *OR* GSI_TP_RC_INVALID
+#############################################################################*/
+static enum gsi_thread_pool_rc gsi_is_thread_pool_free(gsi_thread_pool_t* p_pool)
+{
+	gsi_thread_pool_ring_t* p_ring = NULL;
+	gsi_thread_pool_task_t task;
+
+	// Check input validation
+	if (NULL == p_pool)
+	{
+		return GSI_TP_RC_INVALID;
+	}
+
+	// Check if there are still running threads
+	if (0 < __atomic_load_n(&p_pool->i_started, __ATOMIC_ACQUIRE))
+	{
+		return GSI_TP_RC_ERROR;
+	}
+
+	for (int i = 0; (i < p_pool->i_max_threads) && (NULL != p_pool->p_workers); ++i)
+	{
+		free(p_pool->p_workers[i].p_deque);
+	}
+
+	// Futures that were allocated alone (the others are freed with p_futures)
+	while ((NULL != p_pool->p_free_futures) && (0 == gsi_is_thread_pool_ring_pop(p_pool->p_free_futures, &task, NULL)))
+	{
+		if (0 != ((gsi_thread_pool_future_t*)task.args)->i_alone)
+		{
+			free(task.args);
+		}
+	}
+
+	if (NULL != p_pool->p_free_futures)
+	{
+		free(p_pool->p_free_futures->p_cells);
+		free(p_pool->p_free_futures);
+	}
+
+	free(p_pool->p_futures);
+
+	for (int i = 0; (i < p_pool->i_lanes) && (NULL != p_pool->p_lanes); ++i)
+	{
+		while (NULL != p_pool->p_lanes[i].p_first_ring)
+		{
+			p_ring = p_pool->p_lanes[i].p_first_ring;
+			p_pool->p_lanes[i].p_first_ring = p_ring->p_next;
+			free(p_ring->p_cells);
+			free(p_ring);
+		}
+	}
+
+	free(p_pool->p_lanes);
+	free(p_pool->p_turns);
+	if (-1 != p_pool->i_timer_fd)
+	{
+		close(p_pool->i_timer_fd);
+	}
+
+	free(p_pool->p_timers);
+	pthread_mutex_destroy(&p_pool->timer_lock);
+	pthread_mutex_destroy(&p_pool->grow_lock);
+	free(p_pool->p_threads);
+	free(p_pool->p_workers);
+	free(p_pool);
+
+	return GSI_TP_RC_SUCCESS;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_start_worker
+	 * Description: Start thread of worker at a free place (by create / the manager only)
+	 * Parameter:   [in] gsi_thread_pool_t* p_pool - thread pool
+	 * Parameter:   [in] int i_worker - index of free worker
+	 * Return:		0 - started, -1 - failed
+#############################################################################*/
+static int gsi_is_thread_pool_start_worker(gsi_thread_pool_t* p_pool, int i_worker)
+{
+	gsi_thread_pool_worker_t* p_worker = &p_pool->p_workers[i_worker];
+
+	// Deque is kept when the worker quits - it is empty then
+	if ((GSI_TP_MODE_STEALING == p_pool->e_mode) && (NULL == p_worker->p_deque))
+	{
+		p_worker->p_deque = (gsi_thread_pool_task_t*)malloc(sizeof(gsi_thread_pool_task_t) * (p_pool->l_deque_mask + 1));
+		if (NULL == p_worker->p_deque)
+		{
+			return -1;
+		}
+	}
+
+	// Thieves look at the deque from now
+	if (__atomic_load_n(&p_pool->i_workers, __ATOMIC_RELAXED) <= i_worker)
+	{
+		__atomic_store_n(&p_pool->i_workers, i_worker + 1, __ATOMIC_RELEASE);
+	}
+
+	// Counted before it runs - it may quit at once
+	__atomic_store_n(&p_worker->i_state, GSI_TP_WORKER_RUNNING, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&p_pool->i_thread_count, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&p_pool->i_started, 1, __ATOMIC_RELAXED);
+
+	if (0 != pthread_create(&(p_pool->p_threads[i_worker]), NULL, gsi_is_thread_run, p_worker))
+	{
+		__atomic_sub_fetch(&p_pool->i_started, 1, __ATOMIC_RELAXED);
+		__atomic_sub_fetch(&p_pool->i_thread_count, 1, __ATOMIC_RELAXED);
+		__atomic_store_n(&p_worker->i_state, GSI_TP_WORKER_FREE, __ATOMIC_RELAXED);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_ring_create
+	 * Description: Allocate ring of the queue - each cell is free for the position of its index
+	 * Parameter:   [in] unsigned long ul_cells - cells of ring (power of 2)
+	 * Return:		Success - the ring
+	 * 				Failure - NULL
+#############################################################################*/
+static gsi_thread_pool_ring_t* gsi_is_thread_pool_ring_create(unsigned long ul_cells)
+{
+	gsi_thread_pool_ring_t* p_ring = NULL;
+
+	// Its positions are aligned on cache lines
+	if (0 != posix_memalign((void **)&p_ring, GSI_TP_CACHE_LINE, sizeof(gsi_thread_pool_ring_t)))
+	{
+		return NULL;
+	}
+
+	p_ring->p_cells = (gsi_thread_pool_cell_t*)malloc(sizeof(gsi_thread_pool_cell_t) * ul_cells);
+	if (NULL == p_ring->p_cells)
+	{
+		free(p_ring);
+		return NULL;
+	}
+
+	for (unsigned long ul_cell = 0; ul_cell < ul_cells; ++ul_cell)
+	{
+		p_ring->p_cells[ul_cell].ul_seq = ul_cell;
+	}
+
+	p_ring->ul_add_pos = 0;
+	p_ring->ul_take_pos = 0;
+	p_ring->ul_mask = ul_cells - 1;
+	p_ring->p_next = NULL;
+
+	return p_ring;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_ring_push
+	 * Description: Put task in the cell of the add position (lock-free)
+	 * Parameter:   [in] gsi_thread_pool_ring_t* p_ring - ring of queue
+	 * Parameter:   [in] thread_func_t thread_func - function of task
+	 * Parameter:   [in] void* args - argument of task
+	 * Parameter:   [in] int i_timed - 1 - time of add is kept at timed positions (lane)
+	 * Return:		0 - task was added, -1 - ring is full, 1 - ring was replaced
+#############################################################################*/
+static int gsi_is_thread_pool_ring_push(gsi_thread_pool_ring_t* p_ring, thread_func_t thread_func, void* args,
+										int i_timed)
+{
+	gsi_thread_pool_cell_t* p_cell = NULL;
+	unsigned long ul_pos = __atomic_load_n(&p_ring->ul_add_pos, __ATOMIC_ACQUIRE);
+	long l_diff = 0;
+
+	while (1)
+	{
+		// Closed - its CAS fails on the bit, the new ring is seen
+		if (0 != (ul_pos & GSI_TP_RING_CLOSED))
+		{
+			return 1;
+		}
+
+		p_cell = &p_ring->p_cells[ul_pos & p_ring->ul_mask];
+		l_diff = (long)(__atomic_load_n(&p_cell->ul_seq, __ATOMIC_ACQUIRE) - ul_pos);
+
+		// Cell is free for this position - claim it
+		if (0 == l_diff)
+		{
+			if (__atomic_compare_exchange_n(&p_ring->ul_add_pos, &ul_pos, ul_pos + 1,
+											1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+			{
+				break;
+			}
+		}
+		// Cell still has the task of the turn before - ring is full
+		else if (0 > l_diff)
+		{
+			return -1;
+		}
+		// Another thread added at this position - try the next one
+		else
+		{
+			ul_pos = __atomic_load_n(&p_ring->ul_add_pos, __ATOMIC_ACQUIRE);
+		}
+	}
+
+	p_cell->task.thread_func = thread_func;
+	p_cell->task.args = args;
+	if ((0 != i_timed) && (0 == (ul_pos & GSI_TP_TIMED_MASK)))
+	{
+		p_cell->ll_add_ns = gsi_is_thread_pool_time_left(0, NULL);
+	}
+
+	// Publish the task to take position
+	__atomic_store_n(&p_cell->ul_seq, ul_pos + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_ring_push_batch
+	 * Description: Put tasks in the cells from the add position (lock-free): the free
+	 * 				cells in a row are claimed by one CAS of the add position - no other
+	 * 				add may claim them then, and a take waits for their publish
+	 * Parameter:   [in] gsi_thread_pool_ring_t* p_ring - ring of queue (of lane)
+	 * Parameter:   [in] const gsi_thread_pool_task_t* p_tasks - tasks, in order
+	 * Parameter:   [in] int i_count - number of tasks (at least one)
+	 * Return:		Number of added tasks (0 - ring is full), -1 - ring was replaced
+#############################################################################*/
+static int gsi_is_thread_pool_ring_push_batch(gsi_thread_pool_ring_t* p_ring, const gsi_thread_pool_task_t* p_tasks,
+											  int i_count)
+{
+	gsi_thread_pool_cell_t* p_cell = NULL;
+	unsigned long ul_pos = __atomic_load_n(&p_ring->ul_add_pos, __ATOMIC_ACQUIRE);
+	unsigned long ul_seq = 0;
+	long long ll_add_ns = 0;
+	int i_free = 0;
+
+	while (1)
+	{
+		// Closed - its CAS fails on the bit, the new ring is seen
+		if (0 != (ul_pos & GSI_TP_RING_CLOSED))
+		{
+			return -1;
+		}
+
+		// Cells in a row that are free for their positions
+		for (i_free = 0; i_free < i_count; ++i_free)
+		{
+			ul_seq = __atomic_load_n(&p_ring->p_cells[(ul_pos + i_free) & p_ring->ul_mask].ul_seq, __ATOMIC_ACQUIRE);
+			if (ul_pos + i_free != ul_seq)
+			{
+				break;
+			}
+		}
+
+		// Claim them all (a failed CAS reads the position again)
+		if (0 < i_free)
+		{
+			if (__atomic_compare_exchange_n(&p_ring->ul_add_pos, &ul_pos, ul_pos + i_free,
+											1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+			{
+				break;
+			}
+		}
+		// First cell still has the task of the turn before - ring is full
+		else if (0 > (long)(ul_seq - ul_pos))
+		{
+			return 0;
+		}
+		// Another thread added at this position - try the next one
+		else
+		{
+			ul_pos = __atomic_load_n(&p_ring->ul_add_pos, __ATOMIC_ACQUIRE);
+		}
+	}
+
+	// One time for the batch - read only if one of its positions is timed
+	if (((ul_pos + GSI_TP_TIMED_MASK) & ~(unsigned long)GSI_TP_TIMED_MASK) < ul_pos + i_free)
+	{
+		ll_add_ns = gsi_is_thread_pool_time_left(0, NULL);
+	}
+
+	// Publish in order of positions - takes claim them in that order
+	for (int i = 0; i < i_free; ++i)
+	{
+		p_cell = &p_ring->p_cells[(ul_pos + i) & p_ring->ul_mask];
+		p_cell->task = p_tasks[i];
+		p_cell->ll_add_ns = ll_add_ns;
+		__atomic_store_n(&p_cell->ul_seq, ul_pos + i + 1, __ATOMIC_RELEASE);
+	}
+
+	return i_free;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_ring_pop
+	 * Description: Take task from the cell of the take position (lock-free)
+	 * Parameter:   [in] gsi_thread_pool_ring_t* p_ring - ring of queue
+	 * Parameter:   [out] gsi_thread_pool_task_t* p_task - the task
+	 * Parameter:   [out] long long* p_add_ns - time the task was added (0 - position is not
+	 * 										  timed, may be NULL)
+	 * Return:		0 - task was taken, -1 - ring is empty
+#############################################################################*/
+static int gsi_is_thread_pool_ring_pop(gsi_thread_pool_ring_t* p_ring, gsi_thread_pool_task_t* p_task, long long* p_add_ns)
+{
+	gsi_thread_pool_cell_t* p_cell = NULL;
+	unsigned long ul_pos = __atomic_load_n(&p_ring->ul_take_pos, __ATOMIC_RELAXED);
+	long l_diff = 0;
+
+	while (1)
+	{
+		p_cell = &p_ring->p_cells[ul_pos & p_ring->ul_mask];
+		l_diff = (long)(__atomic_load_n(&p_cell->ul_seq, __ATOMIC_ACQUIRE) - (ul_pos + 1));
+
+		// Cell has the task of this position - claim it
+		if (0 == l_diff)
+		{
+			// Seq_cst - ordered with the waiters of space (a locked CAS anyway)
+			if (__atomic_compare_exchange_n(&p_ring->ul_take_pos, &ul_pos, ul_pos + 1,
+											1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			{
+				break;
+			}
+		}
+		// Task of this position was not added yet - ring is empty
+		else if (0 > l_diff)
+		{
+			return -1;
+		}
+		// Another worker took this position - try the next one
+		else
+		{
+			ul_pos = __atomic_load_n(&p_ring->ul_take_pos, __ATOMIC_RELAXED);
+		}
+	}
+
+	*p_task = p_cell->task;
+	if (NULL != p_add_ns)
+	{
+		*p_add_ns = (0 == (ul_pos & GSI_TP_TIMED_MASK)) ? p_cell->ll_add_ns : 0;
+	}
+
+	// Free the cell for the add of the next turn
+	__atomic_store_n(&p_cell->ul_seq, ul_pos + p_ring->ul_mask + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_grow_queue
+	 * Description: Replace full ring by a ring of twice its cells (not above
+	 * 				ul_max_cells). The new ring is linked and added to before the
+	 * 				old one is closed - an add that sees it closed finds the new one.
+	 * Parameter:   [in] gsi_thread_pool_t* p_pool - thread pool
+	 * Parameter:   [in] gsi_thread_pool_lane_t* p_lane - lane of ring
+	 * Parameter:   [in] gsi_thread_pool_ring_t* p_ring - the full ring
+	 * Return:		0 - ring was replaced (maybe by another thread), -1 - queue is full
+#############################################################################*/
+static int gsi_is_thread_pool_grow_queue(gsi_thread_pool_t* p_pool, gsi_thread_pool_lane_t* p_lane,
+										 gsi_thread_pool_ring_t* p_ring)
+{
+	gsi_thread_pool_ring_t* p_new_ring = NULL;
+	int i_rc = 0;
+
+	// Fixed queue - full without lock
+	if (p_ring->ul_mask + 1 >= p_pool->ul_max_cells)
+	{
+		return -1;
+	}
+
+	pthread_mutex_lock(&p_pool->grow_lock);
+
+	if (p_ring == __atomic_load_n(&p_lane->p_add_ring, __ATOMIC_ACQUIRE))
+	{
+		p_new_ring = gsi_is_thread_pool_ring_create((p_ring->ul_mask + 1) << 1);
+		if (NULL == p_new_ring)
+		{
+			i_rc = -1;
+		}
+		else
+		{
+			__atomic_store_n(&p_ring->p_next, p_new_ring, __ATOMIC_RELEASE);
+			__atomic_store_n(&p_lane->p_add_ring, p_new_ring, __ATOMIC_RELEASE);
+			__atomic_fetch_or(&p_ring->ul_add_pos, GSI_TP_RING_CLOSED, __ATOMIC_SEQ_CST);
+		}
+	}
+
+	pthread_mutex_unlock(&p_pool->grow_lock);
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_push
+	 * Description: Put task in the ring of adds of lane (the queue grows when it is full)
+	 * Parameter:   [in] gsi_thread_pool_t* p_pool - thread pool
+	 * Parameter:   [in] gsi_thread_pool_lane_t* p_lane - lane of task
+	 * Parameter:   [in] thread_func_t thread_func - function of task
+	 * Parameter:   [in] void* args - argument of task
+	 * Return:		0 - task was added, -1 - queue is full
+#############################################################################*/
+static int gsi_is_thread_pool_push(gsi_thread_pool_t* p_pool, gsi_thread_pool_lane_t* p_lane, thread_func_t thread_func,
+								   void* args)
+{
+	gsi_thread_pool_ring_t* p_ring = NULL;
+	int i_rc = 0;
+
+	while (1)
+	{
+		p_ring = __atomic_load_n(&p_lane->p_add_ring, __ATOMIC_ACQUIRE);
+		i_rc = gsi_is_thread_pool_ring_push(p_ring, thread_func, args, 1);
+		if (0 == i_rc)
+		{
+			return 0;
+		}
+
+		if ((0 > i_rc) && (0 != gsi_is_thread_pool_grow_queue(p_pool, p_lane, p_ring)))
+		{
+			return -1;
+		}
+	}
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_push_batch
+	 * Description: Put tasks in the ring of adds of lane - as many as its free cells
+	 * 				in a row, the rest to the next ring (the queue grows when it is full)
+	 * Parameter:   [in] gsi_thread_pool_t* p_pool - thread pool
+	 * Parameter:   [in] gsi_thread_pool_lane_t* p_lane - lane of tasks
+	 * Parameter:   [in] const gsi_thread_pool_task_t* p_tasks - tasks, in order
+	 * Parameter:   [in] int i_count - number of tasks
+	 * Return:		Number of added tasks (less than i_count - queue is full)
+#############################################################################*/
+static int gsi_is_thread_pool_push_batch(gsi_thread_pool_t* p_pool, gsi_thread_pool_lane_t* p_lane,
+										 const gsi_thread_pool_task_t* p_tasks, int i_count)
+{
+	gsi_thread_pool_ring_t* p_ring = NULL;
+	int i_added = 0;
+	int i_rc = 0;
+
+	while (i_added < i_count)
+	{
+		p_ring = __atomic_load_n(&p_lane->p_add_ring, __ATOMIC_ACQUIRE);
+		i_rc = gsi_is_thread_pool_ring_push_batch(p_ring, p_tasks + i_added, i_count - i_added);
+		if (0 < i_rc)
+		{
+			i_added += i_rc;
+		}
+		else if ((0 == i_rc) && (0 != gsi_is_thread_pool_grow_queue(p_pool, p_lane, p_ring)))
+		{
+			break;
+		}
+	}
+
+	return i_added;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_submit
+	 * Description: Add task without wait - to deque of the current worker (work
+	 * 				stealing, last lane, when it isn't full) or to the queue of lane -
+	 * 				and wake a worker
+	 * Parameter:   [in] gsi_thread_pool_t* p_pool - thread pool
+	 * Parameter:   [in] gsi_thread_pool_lane_t* p_lane - lane of task
+	 * Parameter:   [in] thread_func_t thread_func - function of task
+	 * Parameter:   [in] void* args - argument of task
+	 * Return:		0 - task was added, -1 - queue is full
+#############################################################################*/
+static int gsi_is_thread_pool_submit(gsi_thread_pool_t* p_pool, gsi_thread_pool_lane_t* p_lane, thread_func_t thread_func,
+									 void* args)
+{
+	// Task of worker stays with it (its deque is taken as the last lane), else check if the lane is full
+	if (((NULL == g_p_worker) || (p_pool != g_p_worker->p_pool) || (NULL == g_p_worker->p_deque) ||
+		 (&p_pool->p_lanes[p_pool->i_lanes - 1] != p_lane) ||
+		 (0 != gsi_is_thread_pool_deque_push(g_p_worker, thread_func, args))) &&
+		(0 != gsi_is_thread_pool_push(p_pool, p_lane, thread_func, args)))
+	{
+		return -1;
+	}
+
+	// Notify one worker that there is new work in queue
+	gsi_is_thread_pool_wake(p_pool, 1);
+
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_is_full
+	 * Description: Check if the ring of adds of lane is full and no take claimed any of
+	 * 				its cells (its task may not be out of the cell yet). Read after the
+	 * 				adder is counted as waiter, both by seq_cst: a take that didn't
+	 * 				see the waiter claimed its cell before - its position is seen here.
+	 * Parameter:   [in] gsi_thread_pool_lane_t* p_lane - lane of adder
+	 * Return:		1 - full (sleep until a take), 0 - a cell is free or soon free
+#############################################################################*/
+static int gsi_is_thread_pool_is_full(gsi_thread_pool_lane_t* p_lane)
+{
+	gsi_thread_pool_ring_t* p_ring = __atomic_load_n(&p_lane->p_add_ring, __ATOMIC_ACQUIRE);
+	unsigned long ul_add_pos = __atomic_load_n(&p_ring->ul_add_pos, __ATOMIC_SEQ_CST);
+
+	// Replaced - the new ring has cells
+	if (0 != (ul_add_pos & GSI_TP_RING_CLOSED))
+	{
+		return 0;
+	}
+
+	return (__atomic_load_n(&p_ring->ul_take_pos, __ATOMIC_SEQ_CST) + p_ring->ul_mask + 1 <= ul_add_pos);
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_pop
+	 * Description: Take task from the ring of takes of lane - a closed ring is left for
+	 * 				the next one when every position claimed in it was taken (a task
+	 * 				that is written yet keeps it). The free cell wakes one adder that
+	 * 				waits for space of the lane. The wait of a timed task is counted.
+	 * Parameter:   [in] gsi_thread_pool_lane_t* p_lane - lane
+	 * Parameter:   [out] gsi_thread_pool_task_t* p_task - the task
+	 * Return:		0 - task was taken, -1 - queue is empty
+#############################################################################*/
+static int gsi_is_thread_pool_pop(gsi_thread_pool_lane_t* p_lane, gsi_thread_pool_task_t* p_task)
+{
+	gsi_thread_pool_ring_t* p_ring = __atomic_load_n(&p_lane->p_take_ring, __ATOMIC_ACQUIRE);
+	gsi_thread_pool_ring_t* p_expected = NULL;
+	gsi_thread_pool_ring_t* p_next = NULL;
+	unsigned long ul_add_pos = 0;
+	unsigned long ul_wait_ns = 0;
+	unsigned long ul_max_wait_ns = 0;
+	long long ll_add_ns = 0;
+
+	while (1)
+	{
+		if (0 == gsi_is_thread_pool_ring_pop(p_ring, p_task, &ll_add_ns))
+		{
+			// After the CAS of take position (no fence) - see gsi_is_thread_pool_is_full()
+			if (0 < __atomic_load_n(&p_lane->i_add_waiters, __ATOMIC_SEQ_CST))
+			{
+				__atomic_add_fetch(&p_lane->ui_space_seq, 1, __ATOMIC_RELEASE);
+				syscall(SYS_futex, &p_lane->ui_space_seq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+			}
+
+			// Wait of timed task in lane (the longest one changes seldom - no CAS on most takes)
+			if (0 != ll_add_ns)
+			{
+				ul_wait_ns = (unsigned long)(gsi_is_thread_pool_time_left(0, NULL) - ll_add_ns);
+				__atomic_add_fetch(&p_lane->ul_timed, 1, __ATOMIC_RELAXED);
+				__atomic_add_fetch(&p_lane->ul_wait_ns, ul_wait_ns, __ATOMIC_RELAXED);
+				ul_max_wait_ns = __atomic_load_n(&p_lane->ul_max_wait_ns, __ATOMIC_RELAXED);
+				while ((ul_max_wait_ns < ul_wait_ns) &&
+					   !__atomic_compare_exchange_n(&p_lane->ul_max_wait_ns, &ul_max_wait_ns, ul_wait_ns,
+													1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+			}
+
+			return 0;
+		}
+
+		ul_add_pos = __atomic_load_n(&p_ring->ul_add_pos, __ATOMIC_ACQUIRE);
+		if ((0 == (ul_add_pos & GSI_TP_RING_CLOSED)) ||
+			((ul_add_pos & ~GSI_TP_RING_CLOSED) != __atomic_load_n(&p_ring->ul_take_pos, __ATOMIC_ACQUIRE)))
+		{
+			return -1;
+		}
+
+		// Linked before it was closed
+		p_next = __atomic_load_n(&p_ring->p_next, __ATOMIC_ACQUIRE);
+		p_expected = p_ring;
+		if (__atomic_compare_exchange_n(&p_lane->p_take_ring, &p_expected, p_next,
+										0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		{
+			p_ring = p_next;
+		}
+		else
+		{
+			p_ring = p_expected;
+		}
+	}
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_count
+	 * Description: Tasks that were added to / taken from the queue of lane since create
+	 * 				(sum of positions of all rings - not one moment, for the manager / stats)
+	 * Parameter:   [in] gsi_thread_pool_lane_t* p_lane - lane
+	 * Parameter:   [in,out] unsigned long* p_added - added tasks are added to it
+	 * Parameter:   [in,out] unsigned long* p_taken - taken tasks are added to it
+	 * Return:		None
+#############################################################################*/
+static void gsi_is_thread_pool_count(gsi_thread_pool_lane_t* p_lane, unsigned long* p_added, unsigned long* p_taken)
+{
+	gsi_thread_pool_ring_t* p_ring = p_lane->p_first_ring;
+
+	for (; NULL != p_ring; p_ring = __atomic_load_n(&p_ring->p_next, __ATOMIC_ACQUIRE))
+	{
+		*p_taken += __atomic_load_n(&p_ring->ul_take_pos, __ATOMIC_RELAXED);
+		*p_added += __atomic_load_n(&p_ring->ul_add_pos, __ATOMIC_RELAXED) & ~GSI_TP_RING_CLOSED;
+	}
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_deque_push
+	 * Description: Put task at the bottom of deque of worker (only by its own thread)
+	 * Parameter:   [in] gsi_thread_pool_worker_t* p_worker - worker of the current thread
+	 * Parameter:   [in] thread_func_t thread_func - function of task
+	 * Parameter:   [in] void* args - argument of task
+	 * Return:		0 - task was added, -1 - deque is full
+#############################################################################*/
+static int gsi_is_thread_pool_deque_push(gsi_thread_pool_worker_t* p_worker, thread_func_t thread_func, void* args)
+{
+	gsi_thread_pool_task_t* p_slot = NULL;
+	long l_bottom = __atomic_load_n(&p_worker->l_bottom, __ATOMIC_RELAXED);
+	long l_top = __atomic_load_n(&p_worker->l_top, __ATOMIC_ACQUIRE);
+
+	// Top may only grow - a stale one never lets a task be written over
+	if (p_worker->p_pool->l_deque_mask < l_bottom - l_top)
+	{
+		return -1;
+	}
+
+	// A thief may still read the slot (its CAS then fails) - the task is written atomically
+	p_slot = &p_worker->p_deque[l_bottom & p_worker->p_pool->l_deque_mask];
+	__atomic_store_n(&p_slot->thread_func, thread_func, __ATOMIC_RELAXED);
+	__atomic_store_n(&p_slot->args, args, __ATOMIC_RELAXED);
+
+	// Publish the task to thieves
+	__atomic_store_n(&p_worker->l_bottom, l_bottom + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_deque_take
+	 * Description: Take the newest task from the bottom of deque of worker (only by its
+	 * 				own thread). Bottom is moved before top is read - a thief that
+	 * 				reads the old bottom is seen, only the last task is raced by CAS.
+	 * Parameter:   [in] gsi_thread_pool_worker_t* p_worker - worker of the current thread
+	 * Parameter:   [out] gsi_thread_pool_task_t* p_task - the task
+	 * Return:		0 - task was taken, -1 - deque is empty
+#############################################################################*/
+static int gsi_is_thread_pool_deque_take(gsi_thread_pool_worker_t* p_worker, gsi_thread_pool_task_t* p_task)
+{
+	gsi_thread_pool_task_t* p_slot = NULL;
+	long l_bottom = __atomic_load_n(&p_worker->l_bottom, __ATOMIC_RELAXED) - 1;
+	long l_top = 0;
+	int i_rc = 0;
+
+	__atomic_store_n(&p_worker->l_bottom, l_bottom, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	l_top = __atomic_load_n(&p_worker->l_top, __ATOMIC_RELAXED);
+
+	// Deque is empty - restore bottom
+	if (l_top > l_bottom)
+	{
+		__atomic_store_n(&p_worker->l_bottom, l_bottom + 1, __ATOMIC_RELAXED);
+		return -1;
+	}
+
+	p_slot = &p_worker->p_deque[l_bottom & p_worker->p_pool->l_deque_mask];
+	p_task->thread_func = __atomic_load_n(&p_slot->thread_func, __ATOMIC_RELAXED);
+	p_task->args = __atomic_load_n(&p_slot->args, __ATOMIC_RELAXED);
+
+	// Last task - thieves want it too, the one that moves top has it
+	if (l_top == l_bottom)
+	{
+		if (!__atomic_compare_exchange_n(&p_worker->l_top, &l_top, l_top + 1,
+										 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		{
+			i_rc = -1;
+		}
+
+		__atomic_store_n(&p_worker->l_bottom, l_bottom + 1, __ATOMIC_RELAXED);
+	}
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_deque_steal
+	 * Description: Take the oldest task from the top of deque of another worker (by CAS)
+	 * Parameter:   [in] gsi_thread_pool_worker_t* p_victim - worker to steal from
+	 * Parameter:   [out] gsi_thread_pool_task_t* p_task - the task
+	 * Return:		0 - task was taken, -1 - deque is empty, 1 - lost the race, try again
+#############################################################################*/
+static int gsi_is_thread_pool_deque_steal(gsi_thread_pool_worker_t* p_victim, gsi_thread_pool_task_t* p_task)
+{
+	gsi_thread_pool_task_t* p_slot = NULL;
+	long l_top = __atomic_load_n(&p_victim->l_top, __ATOMIC_ACQUIRE);
+	long l_bottom = 0;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	l_bottom = __atomic_load_n(&p_victim->l_bottom, __ATOMIC_ACQUIRE);
+
+	if (l_top >= l_bottom)
+	{
+		return -1;
+	}
+
+	// Read before the CAS - after it the slot may be written by the owner
+	p_slot = &p_victim->p_deque[l_top & p_victim->p_pool->l_deque_mask];
+	p_task->thread_func = __atomic_load_n(&p_slot->thread_func, __ATOMIC_RELAXED);
+	p_task->args = __atomic_load_n(&p_slot->args, __ATOMIC_RELAXED);
+
+	if (!__atomic_compare_exchange_n(&p_victim->l_top, &l_top, l_top + 1,
+									 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_find
+	 * Description: One look for a task of worker: the lane of its turn (weighted), the
+	 * 				lanes by priority - its own deque before the last lane (its tasks
+	 * 				are of the last lane) - then the deques of the other workers from
+	 * 				a random one (work stealing)
+	 * Parameter:   [in] gsi_thread_pool_worker_t* p_worker - worker of the current thread
+	 * Parameter:   [out] gsi_thread_pool_task_t* p_task - the task
+	 * Return:		0 - task was found, -1 - no task
+#############################################################################*/
+static int gsi_is_thread_pool_find(gsi_thread_pool_worker_t* p_worker, gsi_thread_pool_task_t* p_task)
+{
+	gsi_thread_pool_t* p_pool = p_worker->p_pool;
+	gsi_thread_pool_worker_t* p_victim = NULL;
+	int i_last = p_pool->i_lanes - 1;
+	int i_lane = 0;
+	int i_workers = 0;
+	int i_first = 0;
+	int i_rc = 0;
+
+	// Weighted - the lane of the turn first (an empty one gives its turn to the priority order)
+	if (GSI_TP_POLICY_WEIGHTED == p_pool->e_policy)
+	{
+		i_lane = p_pool->p_turns[p_worker->ui_turn++ % (unsigned int)p_pool->i_turns];
+		if (((i_last == i_lane) && (NULL != p_worker->p_deque) && (0 == gsi_is_thread_pool_deque_take(p_worker, p_task))) ||
+			(0 == gsi_is_thread_pool_pop(&p_pool->p_lanes[i_lane], p_task)))
+		{
+			return 0;
+		}
+	}
+
+	for (i_lane = 0; i_lane < i_last; ++i_lane)
+	{
+		if (0 == gsi_is_thread_pool_pop(&p_pool->p_lanes[i_lane], p_task))
+		{
+			return 0;
+		}
+	}
+
+	if (((NULL != p_worker->p_deque) && (0 == gsi_is_thread_pool_deque_take(p_worker, p_task))) ||
+		(0 == gsi_is_thread_pool_pop(&p_pool->p_lanes[i_last], p_task)))
+	{
+		return 0;
+	}
+
+	if (NULL == p_worker->p_deque)
+	{
+		return -1;
+	}
+
+	// Random first victim - thieves don't all go for the same worker
+	i_workers = __atomic_load_n(&p_pool->i_workers, __ATOMIC_ACQUIRE);
+	i_first = rand_r(&p_worker->ui_seed) % i_workers;
+	for (int i = 0; i < i_workers; ++i)
+	{
+		p_victim = &p_pool->p_workers[(i_first + i) % i_workers];
+		if (p_victim == p_worker)
+		{
+			continue;
+		}
+
+		// Lost race - the deque may have more tasks
+		do
+		{
+			i_rc = gsi_is_thread_pool_deque_steal(p_victim, p_task);
+		} while (0 < i_rc);
+
+		if (0 == i_rc)
+		{
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_take
+	 * Description: Next task of worker: look for it i_spin_count times (see
+	 * 				gsi_is_thread_pool_find()), then sleep on futex until a task is
+	 * 				added (or shutdown). The tasks are looked for again after the worker
+	 * 				is counted as sleeper - an add that didn't see it was seen by the look.
+	 * 				Elastic - a worker that sleeps i_idle_msecs quits (not below i_min_threads).
+	 * Parameter:   [in] gsi_thread_pool_worker_t* p_worker - worker of the current thread
+	 * Parameter:   [out] gsi_thread_pool_task_t* p_task - the task
+	 * Return:		0 - task was taken, -1 - shutdown *OR* idle (worker quits)
+#############################################################################*/
+static int gsi_is_thread_pool_take(gsi_thread_pool_worker_t* p_worker, gsi_thread_pool_task_t* p_task)
+{
+	gsi_thread_pool_t* p_pool = p_worker->p_pool;
+	struct timespec idle;
+	unsigned int ui_seq = 0;
+	int i_sleepers = 0;
+	int i_shutdown = 0;
+	int i_count = 0;
+	int i_spin = 0;
+
+	idle.tv_sec = p_pool->i_idle_msecs / 1000;
+	idle.tv_nsec = (long)(p_pool->i_idle_msecs % 1000) * 1000000;
+
+	while (1)
+	{
+		for (i_spin = 0; ; ++i_spin)
+		{
+			// Check destroy status (graceful - only when no task is left)
+			i_shutdown = __atomic_load_n(&p_pool->i_shutdown, __ATOMIC_ACQUIRE);
+			if (GSI_TP_DESTROY_IMMIDIATE == i_shutdown)
+			{
+				return -1;
+			}
+
+			if (0 == gsi_is_thread_pool_find(p_worker, p_task))
+			{
+				return 0;
+			}
+
+			if (GSI_TP_DESTROY_GRACEFUL == i_shutdown)
+			{
+				return -1;
+			}
+
+			if (p_pool->i_spin_count <= i_spin)
+			{
+				break;
+			}
+
+			GSI_TP_CPU_RELAX();
+		}
+
+		// Sleep - the value of futex is read before the last look for tasks
+		ui_seq = __atomic_load_n(&p_pool->ui_wake_seq, __ATOMIC_ACQUIRE);
+		__atomic_add_fetch(&p_pool->i_sleepers, 1, __ATOMIC_SEQ_CST);
+
+		// Shutdown is checked again by the spin
+		if (0 == __atomic_load_n(&p_pool->i_shutdown, __ATOMIC_SEQ_CST))
+		{
+			// Stays counted as sleeper - the next add wakes nobody, no harm
+			if (0 == gsi_is_thread_pool_find(p_worker, p_task))
+			{
+				return 0;
+			}
+
+			// The add that wakes takes the worker out of i_sleepers - it is not counted
+			// anymore when it runs, so the next adds don't wake it again
+			if ((0 == syscall(SYS_futex, &p_pool->ui_wake_seq, FUTEX_WAIT_PRIVATE, ui_seq,
+							  (p_pool->i_min_threads < p_pool->i_max_threads) ? &idle : NULL, NULL, 0)) ||
+				(ETIMEDOUT != errno))
+			{
+				continue;
+			}
+
+			// Timed out - not a sleeper anymore (unless an add took it out already)
+			i_sleepers = __atomic_load_n(&p_pool->i_sleepers, __ATOMIC_SEQ_CST);
+			while ((0 < i_sleepers) &&
+				   !__atomic_compare_exchange_n(&p_pool->i_sleepers, &i_sleepers, i_sleepers - 1,
+												1, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+
+			// Idle - quit if there are more than the minimum of workers
+			i_count = __atomic_load_n(&p_pool->i_thread_count, __ATOMIC_RELAXED);
+			if ((p_pool->i_min_threads >= i_count) ||
+				!__atomic_compare_exchange_n(&p_pool->i_thread_count, &i_count, i_count - 1,
+											 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			{
+				continue;
+			}
+
+			// A task that was added meanwhile is done before quit
+			if (0 == gsi_is_thread_pool_find(p_worker, p_task))
+			{
+				__atomic_add_fetch(&p_pool->i_thread_count, 1, __ATOMIC_RELAXED);
+				return 0;
+			}
+
+			return -1;
+		}
+	}
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_wake
+	 * Description: Wake up sleeping workers (nothing if none sleeps - no system call).
+	 * 				Some workers - they are taken out of i_sleepers by the waker. A change of
+	 * 				ui_wake_seq also stops every worker that is on its way to sleep,
+	 * 				they may stay counted - too many sleepers cost a wake only.
+	 * Parameter:   [in] gsi_thread_pool_t* p_pool - thread pool
+	 * Parameter:   [in] int i_workers - number of workers (up to the sleeping ones) *OR*
+	 * 									 INT_MAX - all (shutdown)
+	 * Return:		None
+#############################################################################*/
+static void gsi_is_thread_pool_wake(gsi_thread_pool_t* p_pool, int i_workers)
+{
+	int i_sleepers = 0;
+	int i_wake = 0;
+
+	// The task (or shutdown) is seen before the sleepers - see gsi_is_thread_pool_take()
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	i_sleepers = __atomic_load_n(&p_pool->i_sleepers, __ATOMIC_SEQ_CST);
+	if (INT_MAX != i_workers)
+	{
+		do
+		{
+			if ((0 >= i_sleepers) || (0 >= i_workers))
+			{
+				return;
+			}
+
+			i_wake = (i_workers < i_sleepers) ? i_workers : i_sleepers;
+		} while (!__atomic_compare_exchange_n(&p_pool->i_sleepers, &i_sleepers, i_sleepers - i_wake,
+											  1, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+
+		i_workers = i_wake;
+	}
+	else if (0 == i_sleepers)
+	{
+		return;
+	}
+
+	__atomic_add_fetch(&p_pool->ui_wake_seq, 1, __ATOMIC_RELEASE);
+	syscall(SYS_futex, &p_pool->ui_wake_seq, FUTEX_WAKE_PRIVATE, i_workers, NULL, NULL, 0);
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_time_left
+	 * Description: Time left until a deadline (CLOCK_MONOTONIC)
+	 * Parameter:   [in] long long ll_end_ns - deadline (0 - none, returns the time now)
+	 * Parameter:   [out] struct timespec* p_left - time left (may be NULL)
+	 * Return:		Nanoseconds left (0 - the deadline passed)
+#############################################################################*/
+static long long gsi_is_thread_pool_time_left(long long ll_end_ns, struct timespec* p_left)
+{
+	struct timespec now;
+	long long ll_left_ns = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ll_left_ns = now.tv_sec * 1000000000LL + now.tv_nsec;
+
+	if (0 == ll_end_ns)
+	{
+		return ll_left_ns;
+	}
+
+	ll_left_ns = (ll_end_ns > ll_left_ns) ? ll_end_ns - ll_left_ns : 0;
+	if (NULL != p_left)
+	{
+		p_left->tv_sec = ll_left_ns / 1000000000LL;
+		p_left->tv_nsec = ll_left_ns % 1000000000LL;
+	}
+
+	return ll_left_ns;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_future_run
+	 * Description: Task of future - runs its function, sets the result and wakes the
+	 * 				waiters (the done bit is set before the waiters are read), then
+	 * 				calls the then function if it was set before
+	 * Parameter:   [in] void* args - gsi_thread_pool_future_t*
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_is_thread_pool_future_run(void* args)
+{
+	gsi_thread_pool_future_t* p_future = (gsi_thread_pool_future_t*)args;
+	unsigned int ui_state = 0;
+
+	p_future->p_result = (*(p_future->thread_func))(p_future->args);
+
+	ui_state = __atomic_fetch_or(&p_future->ui_state, GSI_TP_FUTURE_DONE, __ATOMIC_SEQ_CST);
+	if (0 < __atomic_load_n(&p_future->i_waiters, __ATOMIC_SEQ_CST))
+	{
+		syscall(SYS_futex, &p_future->ui_state, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+	}
+
+	if (0 != (ui_state & GSI_TP_FUTURE_THEN))
+	{
+		(*(p_future->then_func))(p_future->p_result, p_future->then_args);
+	}
+
+	gsi_is_thread_pool_future_put(p_future);
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_future_put
+	 * Description: Owner / task left future - the last one puts it back to the free
+	 * 				futures (alone one is freed when there is no room)
+	 * Parameter:   [in] gsi_thread_pool_future_t* p_future - future
+	 * Return:		None
+#############################################################################*/
+static void gsi_is_thread_pool_future_put(gsi_thread_pool_future_t* p_future)
+{
+	if (0 != __atomic_sub_fetch(&p_future->i_refs, 1, __ATOMIC_ACQ_REL))
+	{
+		return;
+	}
+
+	// No room (alone futures took it) - future of pool stays out until destroy frees p_futures
+	if ((0 != gsi_is_thread_pool_ring_push(p_future->p_pool->p_free_futures, NULL, p_future, 0)) &&
+		(0 != p_future->i_alone))
+	{
+		free(p_future);
+	}
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_strand_run
+	 * Description: Task of strand - runs its tasks in order until none is left. After
+	 * 				GSI_TP_STRAND_BATCH tasks the strand goes back to the queue of pool
+	 * 				(other tasks run meanwhile), unless the pool is full.
+	 * Parameter:   [in] void* args - gsi_thread_pool_strand_t*
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_is_thread_pool_strand_run(void* args)
+{
+	gsi_thread_pool_strand_t* p_strand = (gsi_thread_pool_strand_t*)args;
+	gsi_thread_pool_task_t task;
+	int i_run = 0;
+
+	while (1)
+	{
+		// Counted task is in the ring - a post before it may still write its cell
+		while (0 != gsi_is_thread_pool_ring_pop(p_strand->p_ring, &task, NULL))
+		{
+			sched_yield();
+		}
+
+		(*(task.thread_func))(task.args);
+
+		// Last task - the next post adds the strand to the pool again
+		if (0 == __atomic_sub_fetch(&p_strand->i_pending, 1, __ATOMIC_ACQ_REL))
+		{
+			return NULL;
+		}
+
+		if (GSI_TP_STRAND_BATCH <= ++i_run)
+		{
+			i_run = 0;
+			if (GSI_TP_RC_SUCCESS == gsi_is_thread_pool_add_lane(p_strand->p_pool, p_strand->i_lane,
+																 gsi_is_thread_pool_strand_run, p_strand, 0))
+			{
+				return NULL;
+			}
+		}
+	}
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_timer_arm
+	 * Description: Set timerfd to the first deadline (under timer_lock) - at once when
+	 * 				the pool shuts down, off when there is no timer
+	 * Parameter:   [in] gsi_thread_pool_t* p_pool - thread pool
+	 * Return:		None
+#############################################################################*/
+static void gsi_is_thread_pool_timer_arm(gsi_thread_pool_t* p_pool)
+{
+	struct itimerspec deadline = {{0, 0}, {0, 0}};
+	long long ll_expire_ns = 0;
+
+	// Absolute time that passed fires at once (0 - off)
+	if (0 != __atomic_load_n(&p_pool->i_shutdown, __ATOMIC_ACQUIRE))
+	{
+		ll_expire_ns = 1;
+	}
+	else if (0 < p_pool->i_timers)
+	{
+		ll_expire_ns = p_pool->p_timers[0]->ll_expire_ns;
+	}
+
+	deadline.it_value.tv_sec = ll_expire_ns / 1000000000LL;
+	deadline.it_value.tv_nsec = ll_expire_ns % 1000000000LL;
+
+	timerfd_settime(p_pool->i_timer_fd, TFD_TIMER_ABSTIME, &deadline, NULL);
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_heap_up
+	 * Description: Move timer up the heap while its deadline is before its parent's
+	 * Parameter:   [in] gsi_thread_pool_t* p_pool - thread pool
+	 * Parameter:   [in] int i_index - place of timer
+	 * Return:		None
+#############################################################################*/
+static void gsi_is_thread_pool_heap_up(gsi_thread_pool_t* p_pool, int i_index)
+{
+	gsi_thread_pool_timer_t* p_timer = p_pool->p_timers[i_index];
+	int i_parent = 0;
+
+	while (0 < i_index)
+	{
+		i_parent = (i_index - 1) / 2;
+		if (p_pool->p_timers[i_parent]->ll_expire_ns <= p_timer->ll_expire_ns)
+		{
+			break;
+		}
+
+		p_pool->p_timers[i_index] = p_pool->p_timers[i_parent];
+		p_pool->p_timers[i_index]->i_index = i_index;
+		i_index = i_parent;
+	}
+
+	p_pool->p_timers[i_index] = p_timer;
+	p_timer->i_index = i_index;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_heap_down
+	 * Description: Move timer down the heap while a child's deadline is before its own
+	 * Parameter:   [in] gsi_thread_pool_t* p_pool - thread pool
+	 * Parameter:   [in] int i_index - place of timer
+	 * Return:		None
+#############################################################################*/
+static void gsi_is_thread_pool_heap_down(gsi_thread_pool_t* p_pool, int i_index)
+{
+	gsi_thread_pool_timer_t* p_timer = p_pool->p_timers[i_index];
+	int i_child = 0;
+
+	while ((i_child = 2 * i_index + 1) < p_pool->i_timers)
+	{
+		// The earlier child
+		if ((i_child + 1 < p_pool->i_timers) &&
+			(p_pool->p_timers[i_child + 1]->ll_expire_ns < p_pool->p_timers[i_child]->ll_expire_ns))
+		{
+			++i_child;
+		}
+
+		if (p_timer->ll_expire_ns <= p_pool->p_timers[i_child]->ll_expire_ns)
+		{
+			break;
+		}
+
+		p_pool->p_timers[i_index] = p_pool->p_timers[i_child];
+		p_pool->p_timers[i_index]->i_index = i_index;
+		i_index = i_child;
+	}
+
+	p_pool->p_timers[i_index] = p_timer;
+	p_timer->i_index = i_index;
+}
+
+/*###########################################################################
+	 * Name:		thread_pool_heap_remove
+	 * Description: Take timer out of the heap - the last timer takes its place
+	 * Parameter:   [in] gsi_thread_pool_t* p_pool - thread pool
+	 * Parameter:   [in] int i_index - place of timer
+	 * Return:		None
+#############################################################################*/
+static void gsi_is_thread_pool_heap_remove(gsi_thread_pool_t* p_pool, int i_index)
+{
+	p_pool->p_timers[i_index]->i_index = -1;
+
+	if (--p_pool->i_timers == i_index)
+	{
+		return;
+	}
+
+	p_pool->p_timers[i_index] = p_pool->p_timers[p_pool->i_timers];
+	gsi_is_thread_pool_heap_up(p_pool, i_index);
+	gsi_is_thread_pool_heap_down(p_pool, i_index);
+}
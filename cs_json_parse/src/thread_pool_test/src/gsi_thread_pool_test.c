@@ -0,0 +1,1880 @@
+/**************************************************************************
+* Name : gsi_thread_pool_test.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Tests of the thread pool (gsi_thread_pool.h):
+* 				ring 	- MPMC queue: producers add while workers take, each task runs once
+* 				full 	- add to a full queue fails at once, the tasks in it run in order
+* 				deque 	- work stealing: tasks added by workers (Chase-Lev deques) run once
+* 				steal 	- idle workers take the tasks of a busy worker's deque
+* 				growth 	- a full queue of elastic pool is replaced by a bigger ring in order
+* 				elastic - waiting tasks add workers up to the maximum, idle ones quit
+* 				wait 	- add_wait() on a full queue: fail fast, timeout, block until space
+* 				worker 	- add_wait() of a worker of the pool fails fast (never blocks)
+* 				shutdown - destroy wakes a blocked adder, which fails
+* 				future 	- wait of future: check, timeout, block - results of many futures
+* 				then 	- then function is called once with the result, set before or after
+* 						  the task finished
+* 				release - futures released before their tasks finish still call then
+* 				strict 	- priority lanes: the urgent lanes run first, each in its order
+* 				weighted - lanes take turns by their weights, an empty lane gives its turn
+* 				lanes 	- depth, added / taken and timed waits of lane stats
+* 				batch 	- a batch fills a full queue partly, the rest is added after, in order
+* 				batches - producers add batches while workers take, each task runs once
+* 				strand 	- tasks of a strand run one at a time in the order of each poster
+* 				poster 	- a strand of a full pool is run by its poster
+* 				timer 	- heap of timers: no task runs before its deadline, canceled never run
+* 				periodic - a periodic timer runs about every period until it is canceled
+* 				Usage : ./<a.out> (exit code - number of failed tests)
+*****************************************************************************/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "gsi_thread_pool.h"
+
+/* Defines and Macros */
+#define 	GSI_TPT_PASS			0
+#define 	GSI_TPT_FAIL			1
+#define 	GSI_TPT_PRODUCERS		4		/* threads that add tasks */
+#define 	GSI_TPT_RING_TASKS		50000	/* tasks of each producer (ring) */
+#define 	GSI_TPT_FULL_QUEUE		4		/* queue of the full test */
+#define 	GSI_TPT_TREE_DEPTH		10		/* each task adds 2 until this depth (deque) */
+#define 	GSI_TPT_TREE_ROOTS		32
+#define 	GSI_TPT_STEAL_TASKS		64		/* tasks added by one worker to its deque (steal) */
+#define 	GSI_TPT_GROW_TASKS		5000	/* tasks added to a queue of 4 (growth) */
+#define 	GSI_TPT_MIN_THREADS		1		/* limits of workers (elastic) */
+#define 	GSI_TPT_MAX_THREADS		4
+#define 	GSI_TPT_IDLE_MSECS		100		/* idle time of worker before it quits (elastic) */
+#define 	GSI_TPT_WAIT_MSECS		50		/* timeout of add_wait() (wait) */
+#define 	GSI_TPT_FUTURES			20000	/* futures of one test (more than GSI_TP_FUTURES) */
+#define 	GSI_TPT_HELD_FUTURES	32		/* futures released before their tasks ran */
+#define 	GSI_TPT_LANES			3		/* priority lanes (strict) */
+#define 	GSI_TPT_LANE_TASKS		30		/* tasks of each lane */
+#define 	GSI_TPT_BATCH			40		/* tasks of batch (more than the queue of 16) */
+#define 	GSI_TPT_BATCH_TASKS		3200	/* tasks of each producer, in batches of GSI_TPT_BATCH */
+#define 	GSI_TPT_STRANDS			16
+#define 	GSI_TPT_STRAND_TASKS	20000	/* tasks of each producer (strand) */
+#define 	GSI_TPT_TIMERS			1000
+#define 	GSI_TPT_MAX_DELAY_MSECS	200
+#define 	GSI_TPT_PERIOD_MSECS	10
+
+/*****************************************************************************
+ * Name : gsi_tpt_strand_state
+ * Used by: strand test - state of one strand, changed by its tasks only
+ * Members:
+ *		int i_inside - a task of the strand runs now
+ *		long a_last[] - sequence of the last task of each producer
+ *		long l_count - tasks that ran
+ *****************************************************************************/
+struct gsi_tpt_strand_state
+{
+	int i_inside;
+	long a_last[GSI_TPT_PRODUCERS];
+	long l_count;
+};
+
+/*****************************************************************************
+ * Name : gsi_tpt_strand_item
+ * Used by: strand test - argument of one task
+ * Members:
+ *		int i_strand - index of strand
+ *		int i_producer - index of producer
+ *		long l_seq - sequence of task of producer
+ *****************************************************************************/
+struct gsi_tpt_strand_item
+{
+	int i_strand;
+	int i_producer;
+	long l_seq;
+};
+
+/*****************************************************************************
+ * Name : gsi_tpt_timer_item
+ * Used by: timer test - argument of one timer
+ * Members:
+ *		long long ll_deadline_ms - time the task may run from
+ *		int i_runs - times the task ran
+ *****************************************************************************/
+struct gsi_tpt_timer_item
+{
+	long long ll_deadline_ms;
+	int i_runs;
+};
+
+/* Global variables */
+static gsi_thread_pool_t* g_p_pool = NULL;
+static long g_l_done = 0;
+static long g_l_sum = 0;
+static long g_l_bad = 0;
+static int g_i_gate = 0;
+static int g_i_held = 0;
+static pthread_t g_root_thread;
+static int g_i_add_rc = -1;
+static int g_a_then[GSI_TPT_FUTURES];
+static long g_a_order[GSI_TPT_LANES * GSI_TPT_LANE_TASKS];
+static struct gsi_tpt_strand_state g_a_states[GSI_TPT_STRANDS];
+static gsi_thread_pool_strand_t* g_a_strands[GSI_TPT_STRANDS];
+
+/********************************/
+/* Static functions declaration */
+/********************************/
+static long long gsi_tpt_now_ms();
+static void gsi_tpt_reset();
+static void gsi_tpt_hold_worker();
+static int gsi_tpt_wait_value(int* p_value, int i_expected, int i_msecs);
+static void* gsi_tpt_count_task(void* args);
+static void* gsi_tpt_gate_task(void* args);
+static void* gsi_tpt_tree_task(void* args);
+static void* gsi_tpt_steal_root_task(void* args);
+static void* gsi_tpt_steal_task(void* args);
+static void* gsi_tpt_fill_task(void* args);
+static void* gsi_tpt_double_task(void* args);
+static void* gsi_tpt_lane_task(void* args);
+static void* gsi_tpt_strand_task(void* args);
+static void* gsi_tpt_timer_task(void* args);
+static void gsi_tpt_then(void* p_result, void* args);
+static void* gsi_tpt_ring_producer(void* args);
+static void* gsi_tpt_batch_producer(void* args);
+static void* gsi_tpt_strand_producer(void* args);
+static void* gsi_tpt_blocked_adder(void* args);
+static void* gsi_tpt_destroyer(void* args);
+static int gsi_tpt_ring();
+static int gsi_tpt_full();
+static int gsi_tpt_deque();
+static int gsi_tpt_steal();
+static int gsi_tpt_growth();
+static int gsi_tpt_elastic();
+static int gsi_tpt_wait();
+static int gsi_tpt_worker();
+static int gsi_tpt_shutdown();
+static int gsi_tpt_future();
+static int gsi_tpt_then_once();
+static int gsi_tpt_release();
+static int gsi_tpt_strict();
+static int gsi_tpt_weighted();
+static int gsi_tpt_lanes();
+static int gsi_tpt_batch();
+static int gsi_tpt_batches();
+static int gsi_tpt_strand();
+static int gsi_tpt_poster();
+static int gsi_tpt_timer();
+static int gsi_tpt_periodic();
+
+int main(int argc, char **argv)
+{
+	int i_failed = 0;
+	int i = 0;
+
+	struct
+	{
+		const char* s_name;
+		int (*f_test)();
+	} a_tests[] = {
+		{ "ring", gsi_tpt_ring },
+		{ "full", gsi_tpt_full },
+		{ "deque", gsi_tpt_deque },
+		{ "steal", gsi_tpt_steal },
+		{ "growth", gsi_tpt_growth },
+		{ "elastic", gsi_tpt_elastic },
+		{ "wait", gsi_tpt_wait },
+		{ "worker", gsi_tpt_worker },
+		{ "shutdown", gsi_tpt_shutdown },
+		{ "future", gsi_tpt_future },
+		{ "then", gsi_tpt_then_once },
+		{ "release", gsi_tpt_release },
+		{ "strict", gsi_tpt_strict },
+		{ "weighted", gsi_tpt_weighted },
+		{ "lanes", gsi_tpt_lanes },
+		{ "batch", gsi_tpt_batch },
+		{ "batches", gsi_tpt_batches },
+		{ "strand", gsi_tpt_strand },
+		{ "poster", gsi_tpt_poster },
+		{ "timer", gsi_tpt_timer },
+		{ "periodic", gsi_tpt_periodic }
+	};
+
+	for (i = 0; i < (int)(sizeof(a_tests) / sizeof(a_tests[0])); ++i)
+	{
+		gsi_tpt_reset();
+		if (GSI_TPT_PASS == a_tests[i].f_test())
+		{
+			printf("%-8s PASS\n", a_tests[i].s_name);
+		}
+		else
+		{
+			printf("%-8s FAIL\n", a_tests[i].s_name);
+			++i_failed;
+		}
+	}
+
+	return i_failed;
+}
+
+/***********************************/
+/* Static functions implementation */
+/***********************************/
+/*###########################################################################
+	 * Name:		gsi_tpt_ring
+	 * Description: Producers add numbered tasks to a small fixed queue (retry when it
+	 * 				is full) - every number is taken once: the count and sum match.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_ring()
+{
+	pthread_t a_producers[GSI_TPT_PRODUCERS];
+	long l_tasks = (long)GSI_TPT_PRODUCERS * GSI_TPT_RING_TASKS;
+	long l_sum = (long)GSI_TPT_PRODUCERS * GSI_TPT_RING_TASKS * (GSI_TPT_RING_TASKS + 1) / 2;
+	int i = 0;
+
+	g_p_pool = gsi_is_thread_pool_create(3, 64);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	for (i = 0; i < GSI_TPT_PRODUCERS; ++i)
+	{
+		pthread_create(&a_producers[i], NULL, gsi_tpt_ring_producer, NULL);
+	}
+
+	for (i = 0; i < GSI_TPT_PRODUCERS; ++i)
+	{
+		pthread_join(a_producers[i], NULL);
+	}
+
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	if ((l_tasks != g_l_done) || (l_sum != g_l_sum))
+	{
+		printf("ring: %ld tasks (sum %ld), expected %ld (sum %ld)\n", g_l_done, g_l_sum, l_tasks, l_sum);
+		return GSI_TPT_FAIL;
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_full
+	 * Description: The only worker is held on a gate - the queue takes GSI_TPT_FULL_QUEUE
+	 * 				tasks and the next add fails at once. After the gate opens the tasks
+	 * 				run in the order they were added (one worker).
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_full()
+{
+	long l_index = 0;
+	int i_rc = GSI_TPT_PASS;
+
+	g_p_pool = gsi_is_thread_pool_create(1, GSI_TPT_FULL_QUEUE);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	gsi_tpt_hold_worker();
+
+	// Tasks check their order by their sum so far (each adds its index)
+	for (l_index = 0; l_index < GSI_TPT_FULL_QUEUE; ++l_index)
+	{
+		if (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add(g_p_pool, gsi_tpt_count_task, (void*)(l_index + 1)))
+		{
+			printf("full: add %ld of %d failed\n", l_index, GSI_TPT_FULL_QUEUE);
+			i_rc = GSI_TPT_FAIL;
+		}
+	}
+
+	if (GSI_TP_RC_ERROR != gsi_is_thread_pool_add(g_p_pool, gsi_tpt_count_task, (void*)(l_index + 1)))
+	{
+		printf("full: add to a full queue didn't fail\n");
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	if ((GSI_TPT_PASS == i_rc) && ((GSI_TPT_FULL_QUEUE != g_l_done) || (0 != g_l_bad)))
+	{
+		printf("full: %ld of %d ran, %ld out of order\n", g_l_done, GSI_TPT_FULL_QUEUE, g_l_bad);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_deque
+	 * Description: Work stealing pool - each task adds two more from its worker (to its
+	 * 				deque, with a small deque that overflows to the queue) until a depth.
+	 * 				Tasks that were not added run inline - every task of the trees runs once.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_deque()
+{
+	gsi_thread_pool_attr_t attr;
+	long l_tasks = ((2L << GSI_TPT_TREE_DEPTH) - 1) * GSI_TPT_TREE_ROOTS;
+	long l_sent = 0;
+
+	gsi_is_thread_pool_attr_init(&attr, 4, 128);
+	attr.e_mode = GSI_TP_MODE_STEALING;
+	attr.i_deque_size = 64;
+
+	g_p_pool = gsi_is_thread_pool_create_attr(&attr);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	while (GSI_TPT_TREE_ROOTS > l_sent)
+	{
+		if (GSI_TP_RC_SUCCESS == gsi_is_thread_pool_add(g_p_pool, gsi_tpt_tree_task, (void*)(long)GSI_TPT_TREE_DEPTH))
+		{
+			++l_sent;
+		}
+		else
+		{
+			sched_yield();
+		}
+	}
+
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	if (l_tasks != g_l_done)
+	{
+		printf("deque: %ld tasks, expected %ld\n", g_l_done, l_tasks);
+		return GSI_TPT_FAIL;
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_steal
+	 * Description: One task adds GSI_TPT_STEAL_TASKS slow tasks from its worker - all
+	 * 				of them fit in its deque, so the ones that other workers run were
+	 * 				stolen. Every task runs once, and some run on the other workers.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_steal()
+{
+	gsi_thread_pool_attr_t attr;
+	int i_waits = 0;
+
+	gsi_is_thread_pool_attr_init(&attr, 4, 16);
+	attr.e_mode = GSI_TP_MODE_STEALING;
+	attr.i_deque_size = 2 * GSI_TPT_STEAL_TASKS;
+
+	g_p_pool = gsi_is_thread_pool_create_attr(&attr);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	if (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add(g_p_pool, gsi_tpt_steal_root_task, NULL))
+	{
+		gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_IMMIDIATE);
+		return GSI_TPT_FAIL;
+	}
+
+	// Adds of workers fail after shutdown - wait for the tasks first (5 seconds at most)
+	while ((GSI_TPT_STEAL_TASKS > __atomic_load_n(&g_l_done, __ATOMIC_ACQUIRE) + g_l_bad) && (5000 > i_waits++))
+	{
+		usleep(1000);
+	}
+
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	// g_l_sum - tasks that ran on another worker than the one that added them
+	if ((GSI_TPT_STEAL_TASKS != g_l_done) || (0 != g_l_bad) || (0 == g_l_sum))
+	{
+		printf("steal: %ld of %d tasks ran, %ld stolen, %ld adds failed\n",
+			   g_l_done, GSI_TPT_STEAL_TASKS, g_l_sum, g_l_bad);
+		return GSI_TPT_FAIL;
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_growth
+	 * Description: The only worker waits on a gate while tasks are added to a queue of 4
+	 * 				(fail fast) - the queue grows for all of them, and they run in the
+	 * 				order they were added (one worker) after the gate opens.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_growth()
+{
+	gsi_thread_pool_attr_t attr;
+	long l_index = 0;
+
+	gsi_is_thread_pool_attr_init(&attr, 1, 4);
+	attr.i_max_queue_size = 2 * GSI_TPT_GROW_TASKS;
+
+	g_p_pool = gsi_is_thread_pool_create_attr(&attr);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	gsi_tpt_hold_worker();
+
+	// Tasks check their order by their sum so far (each adds its index)
+	for (l_index = 0; l_index < GSI_TPT_GROW_TASKS; ++l_index)
+	{
+		if (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add(g_p_pool, gsi_tpt_count_task, (void*)(l_index + 1)))
+		{
+			printf("growth: add %ld failed\n", l_index);
+			break;
+		}
+	}
+
+	__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	if ((GSI_TPT_GROW_TASKS != l_index) || (GSI_TPT_GROW_TASKS != g_l_done) || (0 != g_l_bad))
+	{
+		printf("growth: %ld added, %ld ran, %ld out of order\n", l_index, g_l_done, g_l_bad);
+		return GSI_TPT_FAIL;
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_elastic
+	 * Description: Twice GSI_TPT_MAX_THREADS tasks wait on a gate in a pool of
+	 * 				GSI_TPT_MIN_THREADS - workers are added until GSI_TPT_MAX_THREADS of
+	 * 				them run a task, and not more. After the gate opens the workers above
+	 * 				the minimum quit when they are idle, and the pool still runs tasks.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_elastic()
+{
+	gsi_thread_pool_attr_t attr;
+	int i_rc = GSI_TPT_PASS;
+	int i = 0;
+
+	gsi_is_thread_pool_attr_init(&attr, GSI_TPT_MIN_THREADS, 64);
+	attr.i_max_threads = GSI_TPT_MAX_THREADS;
+	attr.i_grow_msecs = 10;
+	attr.i_idle_msecs = GSI_TPT_IDLE_MSECS;
+
+	g_p_pool = gsi_is_thread_pool_create_attr(&attr);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	for (i = 0; i < 2 * GSI_TPT_MAX_THREADS; ++i)
+	{
+		gsi_is_thread_pool_add(g_p_pool, gsi_tpt_gate_task, NULL);
+	}
+
+	// Grows to the maximum, then stays there while the tasks wait
+	i_rc = gsi_tpt_wait_value(&g_i_held, GSI_TPT_MAX_THREADS, 2000);
+	usleep(10 * attr.i_grow_msecs * 1000);
+
+	if ((GSI_TPT_PASS != i_rc) || (GSI_TPT_MAX_THREADS != __atomic_load_n(&g_i_held, __ATOMIC_ACQUIRE)) ||
+		(GSI_TPT_MAX_THREADS != __atomic_load_n(&g_p_pool->i_thread_count, __ATOMIC_ACQUIRE)))
+	{
+		printf("elastic: %d tasks run on %d workers, expected %d\n", g_i_held, g_p_pool->i_thread_count, GSI_TPT_MAX_THREADS);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+
+	// Idle workers quit down to the minimum
+	if ((GSI_TPT_PASS == i_rc) &&
+		(GSI_TPT_PASS != gsi_tpt_wait_value(&g_p_pool->i_thread_count, GSI_TPT_MIN_THREADS, 20 * GSI_TPT_IDLE_MSECS)))
+	{
+		printf("elastic: %d workers after idle time, expected %d\n", g_p_pool->i_thread_count, GSI_TPT_MIN_THREADS);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	gsi_is_thread_pool_add(g_p_pool, gsi_tpt_count_task, (void*)1L);
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	if ((GSI_TPT_PASS == i_rc) && (1 != g_l_done))
+	{
+		printf("elastic: task after shrink didn't run\n");
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_wait
+	 * Description: The only worker is held and the queue of 4 is full - add_wait() fails
+	 * 				at once with 0, returns GSI_TP_RC_TIMEOUT after its timeout, and with
+	 * 				GSI_TP_WAIT_FOREVER blocks until the gate opens. The blocked task runs
+	 * 				after the ones before it.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_wait()
+{
+	pthread_t adder;
+	long long ll_start_ms = 0;
+	long long ll_waited_ms = 0;
+	long l_index = 0;
+	int i_rc = GSI_TPT_PASS;
+	int i_add_rc = 0;
+
+	g_p_pool = gsi_is_thread_pool_create(1, GSI_TPT_FULL_QUEUE);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	gsi_tpt_hold_worker();
+
+	for (l_index = 0; l_index < GSI_TPT_FULL_QUEUE; ++l_index)
+	{
+		gsi_is_thread_pool_add(g_p_pool, gsi_tpt_count_task, (void*)(l_index + 1));
+	}
+
+	// Fail fast
+	ll_start_ms = gsi_tpt_now_ms();
+	i_add_rc = gsi_is_thread_pool_add_wait(g_p_pool, gsi_tpt_count_task, (void*)(l_index + 1), 0);
+	ll_waited_ms = gsi_tpt_now_ms() - ll_start_ms;
+	if ((GSI_TP_RC_ERROR != i_add_rc) || (GSI_TPT_WAIT_MSECS <= ll_waited_ms))
+	{
+		printf("wait: fail fast returned %d after %lld ms\n", i_add_rc, ll_waited_ms);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	// Timeout
+	ll_start_ms = gsi_tpt_now_ms();
+	i_add_rc = gsi_is_thread_pool_add_wait(g_p_pool, gsi_tpt_count_task, (void*)(l_index + 1), GSI_TPT_WAIT_MSECS);
+	ll_waited_ms = gsi_tpt_now_ms() - ll_start_ms;
+	if ((GSI_TP_RC_TIMEOUT != i_add_rc) || (GSI_TPT_WAIT_MSECS > ll_waited_ms) || (20 * GSI_TPT_WAIT_MSECS < ll_waited_ms))
+	{
+		printf("wait: timed add returned %d after %lld ms (timeout %d)\n", i_add_rc, ll_waited_ms, GSI_TPT_WAIT_MSECS);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	// Blocks while the queue is full, adds once the gate opens
+	pthread_create(&adder, NULL, gsi_tpt_blocked_adder, (void*)(l_index + 1));
+	usleep(GSI_TPT_WAIT_MSECS * 1000);
+	if (-1 != __atomic_load_n(&g_i_add_rc, __ATOMIC_ACQUIRE))
+	{
+		printf("wait: blocking add returned %d on a full queue\n", g_i_add_rc);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+	pthread_join(adder, NULL);
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	if ((GSI_TP_RC_SUCCESS != g_i_add_rc) || (GSI_TPT_FULL_QUEUE + 1 != g_l_done) || (0 != g_l_bad))
+	{
+		printf("wait: blocking add returned %d, %ld tasks ran, %ld out of order\n", g_i_add_rc, g_l_done, g_l_bad);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_worker
+	 * Description: A task fills the queue of its own pool of one worker, then blocks
+	 * 				with add_wait() - it fails at once, else no one would take.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_worker()
+{
+	g_p_pool = gsi_is_thread_pool_create(1, GSI_TPT_FULL_QUEUE);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	gsi_is_thread_pool_add(g_p_pool, gsi_tpt_fill_task, NULL);
+	gsi_tpt_wait_value(&g_i_add_rc, GSI_TP_RC_ERROR, 5000);
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	if ((GSI_TP_RC_ERROR != g_i_add_rc) || (GSI_TPT_FULL_QUEUE != g_l_done))
+	{
+		printf("worker: add_wait() of worker returned %d, %ld of %d tasks ran\n", g_i_add_rc, g_l_done, GSI_TPT_FULL_QUEUE);
+		return GSI_TPT_FAIL;
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_shutdown
+	 * Description: An adder blocks on the full queue of a held worker - destroy (from
+	 * 				another thread) wakes it and it fails, before the worker is released.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_shutdown()
+{
+	pthread_t adder;
+	pthread_t destroyer;
+	long l_index = 0;
+	int i_rc = GSI_TPT_PASS;
+
+	g_p_pool = gsi_is_thread_pool_create(1, GSI_TPT_FULL_QUEUE);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	gsi_tpt_hold_worker();
+
+	for (l_index = 0; l_index < GSI_TPT_FULL_QUEUE; ++l_index)
+	{
+		gsi_is_thread_pool_add(g_p_pool, gsi_tpt_count_task, (void*)(l_index + 1));
+	}
+
+	pthread_create(&adder, NULL, gsi_tpt_blocked_adder, (void*)(l_index + 1));
+	usleep(GSI_TPT_WAIT_MSECS * 1000);
+	pthread_create(&destroyer, NULL, gsi_tpt_destroyer, NULL);
+
+	if (GSI_TPT_PASS != gsi_tpt_wait_value(&g_i_add_rc, GSI_TP_RC_ERROR, 5000))
+	{
+		printf("shutdown: blocked add returned %d on destroy\n", g_i_add_rc);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+	pthread_join(adder, NULL);
+	pthread_join(destroyer, NULL);
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_future
+	 * Description: Future of a task of a held worker - a check (0) and a timed wait
+	 * 				return GSI_TP_RC_TIMEOUT, a blocking wait returns the result after the
+	 * 				gate opens. Then GSI_TPT_FUTURES futures (most allocated alone) give
+	 * 				the result of their own task.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_future()
+{
+	gsi_thread_pool_future_t** p_futures = NULL;
+	void* p_result = NULL;
+	long long ll_start_ms = 0;
+	long long ll_waited_ms = 0;
+	long l_index = 0;
+	int i_rc = GSI_TPT_PASS;
+	int i_wait_rc = 0;
+
+	g_p_pool = gsi_is_thread_pool_create(1, 64);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	gsi_tpt_hold_worker();
+
+	p_futures = (gsi_thread_pool_future_t**)calloc(GSI_TPT_FUTURES, sizeof(*p_futures));
+	if (NULL == p_futures)
+	{
+		__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+		gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+		return GSI_TPT_FAIL;
+	}
+
+	p_futures[0] = gsi_is_thread_pool_add_future(g_p_pool, gsi_tpt_double_task, (void*)21L, 0);
+	if (NULL == p_futures[0])
+	{
+		printf("future: add failed\n");
+		i_rc = GSI_TPT_FAIL;
+	}
+	else
+	{
+		ll_start_ms = gsi_tpt_now_ms();
+		i_wait_rc = gsi_is_thread_pool_future_wait(p_futures[0], GSI_TPT_WAIT_MSECS, &p_result);
+		ll_waited_ms = gsi_tpt_now_ms() - ll_start_ms;
+
+		if ((GSI_TP_RC_TIMEOUT != gsi_is_thread_pool_future_wait(p_futures[0], 0, &p_result)) ||
+			(GSI_TP_RC_TIMEOUT != i_wait_rc) || (GSI_TPT_WAIT_MSECS > ll_waited_ms))
+		{
+			printf("future: wait of held task returned %d after %lld ms\n", i_wait_rc, ll_waited_ms);
+			i_rc = GSI_TPT_FAIL;
+		}
+
+		__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+
+		if ((GSI_TP_RC_SUCCESS != gsi_is_thread_pool_future_wait(p_futures[0], GSI_TP_WAIT_FOREVER, &p_result)) ||
+			(42L != (long)p_result))
+		{
+			printf("future: blocking wait gave %ld, expected 42\n", (long)p_result);
+			i_rc = GSI_TPT_FAIL;
+		}
+
+		gsi_is_thread_pool_future_release(p_futures[0]);
+	}
+
+	__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	// Many futures at once - the free list of pool runs out
+	g_p_pool = gsi_is_thread_pool_create(4, 1024);
+	if (NULL == g_p_pool)
+	{
+		free(p_futures);
+		return GSI_TPT_FAIL;
+	}
+
+	for (l_index = 0; l_index < GSI_TPT_FUTURES; ++l_index)
+	{
+		p_futures[l_index] = gsi_is_thread_pool_add_future(g_p_pool, gsi_tpt_double_task, (void*)l_index, GSI_TP_WAIT_FOREVER);
+	}
+
+	for (l_index = 0; l_index < GSI_TPT_FUTURES; ++l_index)
+	{
+		p_result = NULL;
+		if ((NULL == p_futures[l_index]) ||
+			(GSI_TP_RC_SUCCESS != gsi_is_thread_pool_future_wait(p_futures[l_index], GSI_TP_WAIT_FOREVER, &p_result)) ||
+			(2 * l_index != (long)p_result))
+		{
+			++g_l_bad;
+		}
+
+		gsi_is_thread_pool_future_release(p_futures[l_index]);
+	}
+
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+	free(p_futures);
+
+	if (0 != g_l_bad)
+	{
+		printf("future: %ld of %d futures failed or gave another result\n", g_l_bad, GSI_TPT_FUTURES);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_then_once
+	 * Description: Then function is set right after each add - the task may have finished
+	 * 				(the caller calls it) or not (the worker calls it). Either way it is
+	 * 				called once with the result, and a second then fails.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_then_once()
+{
+	gsi_thread_pool_future_t* p_future = NULL;
+	long l_index = 0;
+	long l_twice = 0;
+
+	g_p_pool = gsi_is_thread_pool_create(4, 1024);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	for (l_index = 0; l_index < GSI_TPT_FUTURES; ++l_index)
+	{
+		p_future = gsi_is_thread_pool_add_future(g_p_pool, gsi_tpt_double_task, (void*)l_index, GSI_TP_WAIT_FOREVER);
+		if (NULL == p_future)
+		{
+			++g_l_bad;
+			continue;
+		}
+
+		if ((GSI_TP_RC_SUCCESS != gsi_is_thread_pool_future_then(p_future, gsi_tpt_then, (void*)l_index)) ||
+			(GSI_TP_RC_ERROR != gsi_is_thread_pool_future_then(p_future, gsi_tpt_then, (void*)l_index)))
+		{
+			++l_twice;
+		}
+
+		gsi_is_thread_pool_future_release(p_future);
+	}
+
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	for (l_index = 0; l_index < GSI_TPT_FUTURES; ++l_index)
+	{
+		if (1 != g_a_then[l_index])
+		{
+			++g_l_bad;
+		}
+	}
+
+	if ((0 != g_l_bad) || (0 != l_twice))
+	{
+		printf("then: %ld of %d not called once or with another result, %ld second then not refused\n",
+			   g_l_bad, GSI_TPT_FUTURES, l_twice);
+		return GSI_TPT_FAIL;
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_release
+	 * Description: Futures of tasks of a held worker are released before the tasks run -
+	 * 				their then functions are still called once, by the worker. Then the
+	 * 				futures of the pool are reused many times over.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_release()
+{
+	gsi_thread_pool_future_t* p_future = NULL;
+	void* p_result = NULL;
+	long l_index = 0;
+
+	g_p_pool = gsi_is_thread_pool_create(1, 64);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	gsi_tpt_hold_worker();
+
+	for (l_index = 0; l_index < GSI_TPT_HELD_FUTURES; ++l_index)
+	{
+		p_future = gsi_is_thread_pool_add_future(g_p_pool, gsi_tpt_double_task, (void*)l_index, 0);
+		if ((NULL == p_future) || (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_future_then(p_future, gsi_tpt_then, (void*)l_index)))
+		{
+			++g_l_bad;
+		}
+
+		gsi_is_thread_pool_future_release(p_future);
+	}
+
+	if (0 != __atomic_load_n(&g_l_done, __ATOMIC_ACQUIRE))
+	{
+		printf("release: tasks ran while the worker was held\n");
+		++g_l_bad;
+	}
+
+	__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+
+	// Futures go back to the free list and are taken again
+	for (l_index = 0; l_index < GSI_TPT_FUTURES; ++l_index)
+	{
+		p_future = gsi_is_thread_pool_add_future(g_p_pool, gsi_tpt_double_task, (void*)l_index, GSI_TP_WAIT_FOREVER);
+		if ((NULL == p_future) ||
+			(GSI_TP_RC_SUCCESS != gsi_is_thread_pool_future_wait(p_future, GSI_TP_WAIT_FOREVER, &p_result)) ||
+			(2 * l_index != (long)p_result))
+		{
+			++g_l_bad;
+		}
+
+		gsi_is_thread_pool_future_release(p_future);
+	}
+
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	for (l_index = 0; l_index < GSI_TPT_HELD_FUTURES; ++l_index)
+	{
+		if (1 != g_a_then[l_index])
+		{
+			++g_l_bad;
+		}
+	}
+
+	if (0 != g_l_bad)
+	{
+		printf("release: %ld futures failed, gave another result or didn't call then once\n", g_l_bad);
+		return GSI_TPT_FAIL;
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_strict
+	 * Description: The only worker is held while GSI_TPT_LANE_TASKS tasks are added to
+	 * 				each lane, the least urgent lane first - after the gate opens the
+	 * 				lanes run one after the other (lane 0 first), each in its order.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_strict()
+{
+	gsi_thread_pool_attr_t attr;
+	long l_index = 0;
+	int i_lane = 0;
+
+	gsi_is_thread_pool_attr_init(&attr, 1, 64);
+	attr.i_lanes = GSI_TPT_LANES;
+	attr.e_policy = GSI_TP_POLICY_STRICT;
+
+	g_p_pool = gsi_is_thread_pool_create_attr(&attr);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	gsi_tpt_hold_worker();
+
+	// Number of task - lane * GSI_TPT_LANE_TASKS + index (the order it must run in)
+	for (i_lane = GSI_TPT_LANES - 1; i_lane >= 0; --i_lane)
+	{
+		for (l_index = 0; l_index < GSI_TPT_LANE_TASKS; ++l_index)
+		{
+			if (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add_lane(g_p_pool, i_lane, gsi_tpt_lane_task,
+																 (void*)(i_lane * GSI_TPT_LANE_TASKS + l_index), 0))
+			{
+				++g_l_bad;
+			}
+		}
+	}
+
+	__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	for (l_index = 0; l_index < g_l_done; ++l_index)
+	{
+		if (l_index != g_a_order[l_index])
+		{
+			printf("strict: task %ld ran at %ld\n", g_a_order[l_index], l_index);
+			++g_l_bad;
+			break;
+		}
+	}
+
+	if ((GSI_TPT_LANES * GSI_TPT_LANE_TASKS != g_l_done) || (0 != g_l_bad))
+	{
+		printf("strict: %ld of %d tasks ran, %ld failed or out of order\n", g_l_done, GSI_TPT_LANES * GSI_TPT_LANE_TASKS, g_l_bad);
+		return GSI_TPT_FAIL;
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_weighted
+	 * Description: Two lanes of weights 2:1 are filled while the only worker is held -
+	 * 				after the gate opens every run so far is about 2:1 while lane 0 has
+	 * 				tasks, then lane 1 runs alone (lane 0 gives its turns). Each lane
+	 * 				runs in its order.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_weighted()
+{
+	gsi_thread_pool_attr_t attr;
+	long a_next[2] = { 0, GSI_TPT_LANE_TASKS };
+	long l_both = 3 * GSI_TPT_LANE_TASKS / 2;
+	long l_second = 0;
+	long l_index = 0;
+	int i_lane = 0;
+
+	gsi_is_thread_pool_attr_init(&attr, 1, 64);
+	attr.i_lanes = 2;
+	attr.e_policy = GSI_TP_POLICY_WEIGHTED;
+	attr.a_weights[0] = 2;
+	attr.a_weights[1] = 1;
+
+	g_p_pool = gsi_is_thread_pool_create_attr(&attr);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	gsi_tpt_hold_worker();
+
+	for (i_lane = 0; i_lane < 2; ++i_lane)
+	{
+		for (l_index = 0; l_index < GSI_TPT_LANE_TASKS; ++l_index)
+		{
+			if (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add_lane(g_p_pool, i_lane, gsi_tpt_lane_task,
+																 (void*)(i_lane * GSI_TPT_LANE_TASKS + l_index), 0))
+			{
+				++g_l_bad;
+			}
+		}
+	}
+
+	__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	// Turns 0, 1, 0 from any start - lane 1 has a third of the runs so far (+- 1)
+	for (l_index = 0; (l_index < g_l_done) && (0 == g_l_bad); ++l_index)
+	{
+		i_lane = (int)(g_a_order[l_index] / GSI_TPT_LANE_TASKS);
+		if (a_next[i_lane]++ != g_a_order[l_index])
+		{
+			printf("weighted: task %ld ran out of order of its lane\n", g_a_order[l_index]);
+			++g_l_bad;
+		}
+
+		l_second += i_lane;
+		if (((l_index < l_both) && (3 <= labs(3 * l_second - (l_index + 1)))) ||
+			((l_index >= l_both) && (1 != i_lane)))
+		{
+			printf("weighted: %ld of %ld runs were of lane 1\n", l_second, l_index + 1);
+			++g_l_bad;
+		}
+	}
+
+	if ((2 * GSI_TPT_LANE_TASKS != g_l_done) || (0 != g_l_bad))
+	{
+		printf("weighted: %ld of %d tasks ran, %ld failed or out of turn\n", g_l_done, 2 * GSI_TPT_LANE_TASKS, g_l_bad);
+		return GSI_TPT_FAIL;
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_lanes
+	 * Description: Stats of lanes while the only worker is held - the tasks wait in
+	 * 				their lanes (the gate task was taken from the last one). After the
+	 * 				gate opens all are taken, a task of each 16 was timed, and the
+	 * 				longest wait is at least the time the worker was held.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_lanes()
+{
+	gsi_thread_pool_attr_t attr;
+	gsi_thread_pool_lane_stats_t a_stats[2];
+	long l_index = 0;
+	int i_waits = 0;
+	int i_rc = GSI_TPT_PASS;
+
+	gsi_is_thread_pool_attr_init(&attr, 1, 64);
+	attr.i_lanes = 2;
+
+	g_p_pool = gsi_is_thread_pool_create_attr(&attr);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	gsi_tpt_hold_worker();
+
+	for (l_index = 0; l_index < GSI_TPT_LANE_TASKS; ++l_index)
+	{
+		gsi_is_thread_pool_add_lane(g_p_pool, 0, gsi_tpt_lane_task, (void*)l_index, 0);
+	}
+
+	gsi_is_thread_pool_add(g_p_pool, gsi_tpt_lane_task, (void*)l_index);
+
+	gsi_is_thread_pool_lane_stats(g_p_pool, 0, &a_stats[0]);
+	gsi_is_thread_pool_lane_stats(g_p_pool, 1, &a_stats[1]);
+	if ((GSI_TPT_LANE_TASKS != a_stats[0].ul_depth) || (GSI_TPT_LANE_TASKS != a_stats[0].ul_added) ||
+		(0 != a_stats[0].ul_taken) || (1 != a_stats[1].ul_depth) || (2 != a_stats[1].ul_added) ||
+		(1 != a_stats[1].ul_taken))
+	{
+		printf("lanes: held - depth %lu / %lu, added %lu / %lu, taken %lu / %lu\n",
+			   a_stats[0].ul_depth, a_stats[1].ul_depth, a_stats[0].ul_added, a_stats[1].ul_added,
+			   a_stats[0].ul_taken, a_stats[1].ul_taken);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	if (GSI_TP_RC_INVALID != gsi_is_thread_pool_lane_stats(g_p_pool, 2, &a_stats[0]))
+	{
+		printf("lanes: stats of a lane out of range didn't fail\n");
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	usleep(GSI_TPT_WAIT_MSECS * 1000);
+	__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+
+	while ((GSI_TPT_LANE_TASKS + 1 > __atomic_load_n(&g_l_done, __ATOMIC_ACQUIRE)) && (5000 > i_waits++))
+	{
+		usleep(1000);
+	}
+
+	gsi_is_thread_pool_lane_stats(g_p_pool, 0, &a_stats[0]);
+	gsi_is_thread_pool_lane_stats(g_p_pool, 1, &a_stats[1]);
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	if ((0 != a_stats[0].ul_depth) || (GSI_TPT_LANE_TASKS != a_stats[0].ul_taken) ||
+		(0 != a_stats[1].ul_depth) || (2 != a_stats[1].ul_taken) ||
+		((GSI_TPT_LANE_TASKS + 15) / 16 != a_stats[0].ul_timed) ||
+		(GSI_TPT_WAIT_MSECS * 1000000UL > a_stats[0].ul_max_wait_ns) ||
+		(a_stats[0].ul_max_wait_ns > a_stats[0].ul_wait_ns))
+	{
+		printf("lanes: done - depth %lu / %lu, taken %lu / %lu, %lu timed, wait %lu ns (max %lu ns)\n",
+			   a_stats[0].ul_depth, a_stats[1].ul_depth, a_stats[0].ul_taken, a_stats[1].ul_taken,
+			   a_stats[0].ul_timed, a_stats[0].ul_wait_ns, a_stats[0].ul_max_wait_ns);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_batch
+	 * Description: Batches of a task without function or of a lane out of range add
+	 * 				nothing. The only worker is held - a batch of GSI_TPT_BATCH tasks
+	 * 				fills the queue of 16 and fails, the rest is added from where it
+	 * 				stopped after the gate opens. All run in the order of the batch.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_batch()
+{
+	gsi_thread_pool_task_t a_tasks[GSI_TPT_BATCH];
+	int i_added = -1;
+	int i_total = 0;
+	int i_rc = GSI_TPT_PASS;
+	int i = 0;
+
+	g_p_pool = gsi_is_thread_pool_create(1, 16);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	// Tasks check their order by their sum so far (each adds its index)
+	for (i = 0; i < GSI_TPT_BATCH; ++i)
+	{
+		a_tasks[i].thread_func = gsi_tpt_count_task;
+		a_tasks[i].args = (void*)(long)(i + 1);
+	}
+
+	a_tasks[1].thread_func = NULL;
+	if ((GSI_TP_RC_INVALID != gsi_is_thread_pool_add_batch(g_p_pool, 0, a_tasks, GSI_TPT_BATCH, &i_added)) || (0 != i_added) ||
+		(GSI_TP_RC_INVALID != gsi_is_thread_pool_add_batch(g_p_pool, 1, a_tasks, 1, &i_added)))
+	{
+		printf("batch: invalid batch wasn't refused (%d added)\n", i_added);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	a_tasks[1].thread_func = gsi_tpt_count_task;
+
+	gsi_tpt_hold_worker();
+
+	if ((GSI_TP_RC_ERROR != gsi_is_thread_pool_add_batch(g_p_pool, 0, a_tasks, GSI_TPT_BATCH, &i_added)) || (16 != i_added))
+	{
+		printf("batch: %d of %d added to a queue of 16\n", i_added, GSI_TPT_BATCH);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	i_total = i_added;
+	__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+
+	while (GSI_TPT_BATCH > i_total)
+	{
+		gsi_is_thread_pool_add_batch(g_p_pool, 0, a_tasks + i_total, GSI_TPT_BATCH - i_total, &i_added);
+		i_total += i_added;
+		sched_yield();
+	}
+
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	if ((GSI_TPT_BATCH != g_l_done) || (0 != g_l_bad))
+	{
+		printf("batch: %ld of %d ran, %ld out of order\n", g_l_done, GSI_TPT_BATCH, g_l_bad);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_batches
+	 * Description: Producers add numbered tasks in batches to a small fixed queue (the
+	 * 				rest of a batch again when it is full) - every number is taken once:
+	 * 				the count and sum match.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_batches()
+{
+	pthread_t a_producers[GSI_TPT_PRODUCERS];
+	long l_tasks = (long)GSI_TPT_PRODUCERS * GSI_TPT_BATCH_TASKS;
+	long l_sum = (long)GSI_TPT_PRODUCERS * GSI_TPT_BATCH_TASKS * (GSI_TPT_BATCH_TASKS + 1) / 2;
+	int i = 0;
+
+	g_p_pool = gsi_is_thread_pool_create(3, 64);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	for (i = 0; i < GSI_TPT_PRODUCERS; ++i)
+	{
+		pthread_create(&a_producers[i], NULL, gsi_tpt_batch_producer, NULL);
+	}
+
+	for (i = 0; i < GSI_TPT_PRODUCERS; ++i)
+	{
+		pthread_join(a_producers[i], NULL);
+	}
+
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	if ((l_tasks != g_l_done) || (l_sum != g_l_sum))
+	{
+		printf("batches: %ld tasks (sum %ld), expected %ld (sum %ld)\n", g_l_done, g_l_sum, l_tasks, l_sum);
+		return GSI_TPT_FAIL;
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_strand
+	 * Description: Producers post numbered tasks to random strands - no two tasks of a
+	 * 				strand run together, the tasks of each producer run in its order.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_strand()
+{
+	pthread_t a_producers[GSI_TPT_PRODUCERS];
+	long l_count = 0;
+	int i = 0;
+	int j = 0;
+
+	g_p_pool = gsi_is_thread_pool_create(3, 64);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	for (i = 0; i < GSI_TPT_STRANDS; ++i)
+	{
+		memset(&g_a_states[i], 0, sizeof(g_a_states[i]));
+		for (j = 0; j < GSI_TPT_PRODUCERS; ++j)
+		{
+			g_a_states[i].a_last[j] = -1;
+		}
+
+		g_a_strands[i] = gsi_is_thread_pool_strand_create(g_p_pool, 0, 128);
+		if (NULL == g_a_strands[i])
+		{
+			printf("strand: create failed\n");
+			gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_IMMIDIATE);
+			return GSI_TPT_FAIL;
+		}
+	}
+
+	for (i = 0; i < GSI_TPT_PRODUCERS; ++i)
+	{
+		pthread_create(&a_producers[i], NULL, gsi_tpt_strand_producer, (void*)(long)i);
+	}
+
+	for (i = 0; i < GSI_TPT_PRODUCERS; ++i)
+	{
+		pthread_join(a_producers[i], NULL);
+	}
+
+	for (i = 0; i < GSI_TPT_STRANDS; ++i)
+	{
+		gsi_is_thread_pool_strand_destroy(g_a_strands[i]);
+		l_count += g_a_states[i].l_count;
+	}
+
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	if (((long)GSI_TPT_PRODUCERS * GSI_TPT_STRAND_TASKS != l_count) || (0 != g_l_bad))
+	{
+		printf("strand: %ld tasks ran, %ld together or out of order\n", l_count, g_l_bad);
+		return GSI_TPT_FAIL;
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_poster
+	 * Description: The only worker is held and the queue is full - the strand can't be
+	 * 				added to the pool, so its poster runs the tasks (in their order)
+	 * 				before the post returns.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_poster()
+{
+	gsi_thread_pool_strand_t* p_strand = NULL;
+	long l_count = 0;
+	long l_index = 0;
+
+	g_p_pool = gsi_is_thread_pool_create(1, 1);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	gsi_tpt_hold_worker();
+
+	// Fill the queue - the strand can't be added after it
+	while (GSI_TP_RC_SUCCESS == gsi_is_thread_pool_add(g_p_pool, gsi_tpt_gate_task, NULL))
+	{
+	}
+
+	p_strand = gsi_is_thread_pool_strand_create(g_p_pool, 0, 4);
+	if (NULL == p_strand)
+	{
+		__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+		gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+		return GSI_TPT_FAIL;
+	}
+
+	// Tasks check their order by their sum so far (each adds its index)
+	for (l_index = 0; l_index < 3; ++l_index)
+	{
+		gsi_is_thread_pool_strand_post(p_strand, gsi_tpt_count_task, (void*)(l_index + 1));
+	}
+
+	l_count = __atomic_load_n(&g_l_done, __ATOMIC_ACQUIRE);
+
+	__atomic_store_n(&g_i_gate, 1, __ATOMIC_RELEASE);
+	gsi_is_thread_pool_strand_destroy(p_strand);
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	if ((3 != l_count) || (0 != g_l_bad))
+	{
+		printf("poster: %ld of 3 tasks ran by the poster of a full pool, %ld out of order\n", l_count, g_l_bad);
+		return GSI_TPT_FAIL;
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_timer
+	 * Description: Timers of random delays (every other one canceled before it fires)
+	 * 				go through the heap - each one runs once and not before its deadline,
+	 * 				canceled ones never run.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_timer()
+{
+	struct gsi_tpt_timer_item* p_items = NULL;
+	gsi_thread_pool_timer_t** p_timers = NULL;
+	unsigned int ui_seed = 1;
+	int i_delay_msecs = 0;
+	int i_rc = GSI_TPT_PASS;
+	int i = 0;
+
+	p_items = (struct gsi_tpt_timer_item*)calloc(GSI_TPT_TIMERS, sizeof(*p_items));
+	p_timers = (gsi_thread_pool_timer_t**)calloc(GSI_TPT_TIMERS, sizeof(*p_timers));
+	g_p_pool = gsi_is_thread_pool_create(4, 256);
+	if ((NULL == p_items) || (NULL == p_timers) || (NULL == g_p_pool))
+	{
+		gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+		free(p_items);
+		free(p_timers);
+		return GSI_TPT_FAIL;
+	}
+
+	// Heap is filled in random order of deadlines
+	for (i = 0; i < GSI_TPT_TIMERS; ++i)
+	{
+		i_delay_msecs = rand_r(&ui_seed) % GSI_TPT_MAX_DELAY_MSECS;
+		p_items[i].ll_deadline_ms = gsi_tpt_now_ms() + i_delay_msecs;
+		p_timers[i] = gsi_is_thread_pool_add_timer(g_p_pool, 0, gsi_tpt_timer_task, &p_items[i], i_delay_msecs, 0);
+		if (NULL == p_timers[i])
+		{
+			printf("timer: add %d failed\n", i);
+			i_rc = GSI_TPT_FAIL;
+		}
+	}
+
+	// Canceled right away - a timer with delay 0 may have run already
+	for (i = 0; i < GSI_TPT_TIMERS; i += 2)
+	{
+		if (__atomic_load_n(&p_items[i].ll_deadline_ms, __ATOMIC_ACQUIRE) > gsi_tpt_now_ms() + GSI_TPT_PERIOD_MSECS)
+		{
+			gsi_is_thread_pool_cancel_timer(g_p_pool, p_timers[i]);
+			p_timers[i] = NULL;
+		}
+	}
+
+	usleep((GSI_TPT_MAX_DELAY_MSECS + 100) * 1000);
+
+	for (i = 0; i < GSI_TPT_TIMERS; ++i)
+	{
+		if ((NULL != p_timers[i]) && (1 != __atomic_load_n(&p_items[i].i_runs, __ATOMIC_ACQUIRE)))
+		{
+			printf("timer: %d ran %d times\n", i, p_items[i].i_runs);
+			i_rc = GSI_TPT_FAIL;
+		}
+		else if ((NULL == p_timers[i]) && (0 != p_items[i].i_runs))
+		{
+			printf("timer: %d ran after it was canceled\n", i);
+			i_rc = GSI_TPT_FAIL;
+		}
+
+		gsi_is_thread_pool_cancel_timer(g_p_pool, p_timers[i]);
+	}
+
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+	free(p_items);
+	free(p_timers);
+
+	if (0 != g_l_bad)
+	{
+		printf("timer: %ld runs before their deadline\n", g_l_bad);
+		i_rc = GSI_TPT_FAIL;
+	}
+
+	return i_rc;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_periodic
+	 * Description: A periodic timer runs about every period (never before its deadline)
+	 * 				for a while, and at most a run that was added already after it
+	 * 				is canceled.
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL
+#############################################################################*/
+static int gsi_tpt_periodic()
+{
+	gsi_thread_pool_timer_t* p_periodic = NULL;
+	struct gsi_tpt_timer_item periodic;
+	int i_ticks = 0;
+	int i_ticks_after = 0;
+
+	g_p_pool = gsi_is_thread_pool_create(4, 256);
+	if (NULL == g_p_pool)
+	{
+		return GSI_TPT_FAIL;
+	}
+
+	periodic.ll_deadline_ms = gsi_tpt_now_ms() + GSI_TPT_PERIOD_MSECS;
+	periodic.i_runs = 0;
+	p_periodic = gsi_is_thread_pool_add_timer(g_p_pool, 0, gsi_tpt_timer_task, &periodic,
+											  GSI_TPT_PERIOD_MSECS, GSI_TPT_PERIOD_MSECS);
+	if (NULL == p_periodic)
+	{
+		gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+		return GSI_TPT_FAIL;
+	}
+
+	usleep((GSI_TPT_MAX_DELAY_MSECS + 100) * 1000);
+	gsi_is_thread_pool_cancel_timer(g_p_pool, p_periodic);
+	i_ticks = __atomic_load_n(&periodic.i_runs, __ATOMIC_ACQUIRE);
+
+	// Runs that were added before the cancel are done after a while
+	usleep(50 * 1000);
+	i_ticks_after = __atomic_load_n(&periodic.i_runs, __ATOMIC_ACQUIRE);
+
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+
+	// 300 msecs of period 10 - at least half of the ticks, no more than all of them
+	if ((0 != g_l_bad) || (15 > i_ticks) || (31 < i_ticks) || (i_ticks + 1 < i_ticks_after))
+	{
+		printf("periodic: %ld early runs, %d ticks (%d after cancel)\n", g_l_bad, i_ticks, i_ticks_after);
+		return GSI_TPT_FAIL;
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_ring_producer
+	 * Description: Add tasks 1..GSI_TPT_RING_TASKS, retry while the queue is full
+	 * Parameter:   [in] void* args - not used
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_ring_producer(void* args)
+{
+	long l_index = 0;
+
+	for (l_index = 1; l_index <= GSI_TPT_RING_TASKS; ++l_index)
+	{
+		while (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add(g_p_pool, gsi_tpt_count_task, (void*)l_index))
+		{
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_batch_producer
+	 * Description: Add tasks 1..GSI_TPT_BATCH_TASKS in batches of GSI_TPT_BATCH, add the
+	 * 				rest of a batch again while the queue is full
+	 * Parameter:   [in] void* args - not used
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_batch_producer(void* args)
+{
+	gsi_thread_pool_task_t a_tasks[GSI_TPT_BATCH];
+	long l_first = 0;
+	int i_added = 0;
+	int i_total = 0;
+	int i = 0;
+
+	for (l_first = 1; l_first <= GSI_TPT_BATCH_TASKS; l_first += GSI_TPT_BATCH)
+	{
+		for (i = 0; i < GSI_TPT_BATCH; ++i)
+		{
+			a_tasks[i].thread_func = gsi_tpt_count_task;
+			a_tasks[i].args = (void*)(l_first + i);
+		}
+
+		for (i_total = 0; GSI_TPT_BATCH > i_total; i_total += i_added)
+		{
+			if (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add_batch(g_p_pool, 0, a_tasks + i_total, GSI_TPT_BATCH - i_total,
+																  &i_added))
+			{
+				sched_yield();
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_strand_producer
+	 * Description: Post numbered tasks to random strands, retry while a strand is full
+	 * Parameter:   [in] void* args - index of producer
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_strand_producer(void* args)
+{
+	struct gsi_tpt_strand_item* p_item = NULL;
+	unsigned int ui_seed = (unsigned int)(long)args + 1;
+	long l_seq = 0;
+
+	for (l_seq = 0; l_seq < GSI_TPT_STRAND_TASKS; ++l_seq)
+	{
+		p_item = (struct gsi_tpt_strand_item*)malloc(sizeof(*p_item));
+		if (NULL == p_item)
+		{
+			__atomic_add_fetch(&g_l_bad, 1, __ATOMIC_RELAXED);
+			return NULL;
+		}
+
+		p_item->i_strand = rand_r(&ui_seed) % GSI_TPT_STRANDS;
+		p_item->i_producer = (int)(long)args;
+		p_item->l_seq = l_seq;
+
+		while (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_strand_post(g_a_strands[p_item->i_strand],
+																  gsi_tpt_strand_task, p_item))
+		{
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_blocked_adder
+	 * Description: Add a numbered task with GSI_TP_WAIT_FOREVER, keep its return code
+	 * Parameter:   [in] void* args - number of task
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_blocked_adder(void* args)
+{
+	int i_add_rc = gsi_is_thread_pool_add_wait(g_p_pool, gsi_tpt_count_task, args, GSI_TP_WAIT_FOREVER);
+
+	__atomic_store_n(&g_i_add_rc, i_add_rc, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_destroyer
+	 * Description: Destroy the pool (gracefully) from another thread than the test
+	 * Parameter:   [in] void* args - not used
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_destroyer(void* args)
+{
+	gsi_is_thread_pool_destroy(g_p_pool, GSI_TP_DESTROY_GRACEFUL);
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_fill_task
+	 * Description: Fill the queue of the pool of this worker, then add with
+	 * 				GSI_TP_WAIT_FOREVER and keep its return code
+	 * Parameter:   [in] void* args - not used
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_fill_task(void* args)
+{
+	long l_index = 0;
+	int i_add_rc = 0;
+
+	for (l_index = 0; l_index < GSI_TPT_FULL_QUEUE; ++l_index)
+	{
+		gsi_is_thread_pool_add(g_p_pool, gsi_tpt_count_task, (void*)(l_index + 1));
+	}
+
+	i_add_rc = gsi_is_thread_pool_add_wait(g_p_pool, gsi_tpt_count_task, (void*)(l_index + 1), GSI_TP_WAIT_FOREVER);
+	__atomic_store_n(&g_i_add_rc, i_add_rc, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_double_task
+	 * Description: Count the task and return twice its number (result of its future)
+	 * Parameter:   [in] void* args - number of task
+	 * Return:		2 * number
+#############################################################################*/
+static void* gsi_tpt_double_task(void* args)
+{
+	__atomic_add_fetch(&g_l_done, 1, __ATOMIC_RELEASE);
+	return (void*)(2 * (long)args);
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_lane_task
+	 * Description: Keep the number of task at the place it ran in (tests with one worker)
+	 * Parameter:   [in] void* args - number of task
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_lane_task(void* args)
+{
+	long l_place = __atomic_fetch_add(&g_l_done, 1, __ATOMIC_RELEASE);
+
+	if (GSI_TPT_LANES * GSI_TPT_LANE_TASKS > l_place)
+	{
+		g_a_order[l_place] = (long)args;
+	}
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_strand_task
+	 * Description: Check that no other task of the strand runs and that the task is
+	 * 				after the last one of its producer
+	 * Parameter:   [in] void* args - struct gsi_tpt_strand_item (freed here)
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_strand_task(void* args)
+{
+	struct gsi_tpt_strand_item* p_item = (struct gsi_tpt_strand_item*)args;
+	struct gsi_tpt_strand_state* p_state = &g_a_states[p_item->i_strand];
+
+	if (0 != __atomic_exchange_n(&p_state->i_inside, 1, __ATOMIC_ACQ_REL))
+	{
+		__atomic_add_fetch(&g_l_bad, 1, __ATOMIC_RELAXED);
+	}
+
+	if (p_state->a_last[p_item->i_producer] >= p_item->l_seq)
+	{
+		__atomic_add_fetch(&g_l_bad, 1, __ATOMIC_RELAXED);
+	}
+
+	p_state->a_last[p_item->i_producer] = p_item->l_seq;
+	++(p_state->l_count);
+
+	__atomic_store_n(&p_state->i_inside, 0, __ATOMIC_RELEASE);
+	free(p_item);
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_timer_task
+	 * Description: Count the run of timer, a run before its deadline is bad.
+	 * 				The deadline moves by the period (for the periodic timer).
+	 * Parameter:   [in] void* args - struct gsi_tpt_timer_item
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_timer_task(void* args)
+{
+	struct gsi_tpt_timer_item* p_item = (struct gsi_tpt_timer_item*)args;
+
+	if (gsi_tpt_now_ms() < __atomic_fetch_add(&p_item->ll_deadline_ms, GSI_TPT_PERIOD_MSECS, __ATOMIC_ACQ_REL))
+	{
+		__atomic_add_fetch(&g_l_bad, 1, __ATOMIC_RELAXED);
+	}
+
+	__atomic_add_fetch(&p_item->i_runs, 1, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_then
+	 * Description: Then function - count its calls for the number of task, a result
+	 * 				that isn't twice the number is bad
+	 * Parameter:   [in] void* p_result - result of gsi_tpt_double_task()
+	 * Parameter:   [in] void* args - number of task
+	 * Return:		None
+#############################################################################*/
+static void gsi_tpt_then(void* p_result, void* args)
+{
+	long l_index = (long)args;
+
+	if (2 * l_index != (long)p_result)
+	{
+		__atomic_add_fetch(&g_l_bad, 1, __ATOMIC_RELAXED);
+	}
+
+	__atomic_add_fetch(&g_a_then[l_index], 1, __ATOMIC_RELAXED);
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_count_task
+	 * Description: Count the task and add its number to the sum. A task that finds the
+	 * 				sum is not the one of the numbers before it (1 + 2 + ... + number - 1)
+	 * 				ran out of order - only checked by tests with one worker.
+	 * Parameter:   [in] void* args - number of task
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_count_task(void* args)
+{
+	long l_number = (long)args;
+	long l_before = __atomic_fetch_add(&g_l_sum, l_number, __ATOMIC_RELAXED);
+
+	if (l_before != (l_number - 1) * l_number / 2)
+	{
+		__atomic_add_fetch(&g_l_bad, 1, __ATOMIC_RELAXED);
+	}
+
+	__atomic_add_fetch(&g_l_done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_tree_task
+	 * Description: Add two tasks of depth - 1 (run them inline if the pool is full)
+	 * Parameter:   [in] void* args - depth
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_tree_task(void* args)
+{
+	long l_depth = (long)args;
+	int i = 0;
+
+	for (i = 0; (0 < l_depth) && (i < 2); ++i)
+	{
+		if (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add(g_p_pool, gsi_tpt_tree_task, (void*)(l_depth - 1)))
+		{
+			gsi_tpt_tree_task((void*)(l_depth - 1));
+		}
+	}
+
+	__atomic_add_fetch(&g_l_done, 1, __ATOMIC_RELAXED);
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_steal_root_task
+	 * Description: Add GSI_TPT_STEAL_TASKS tasks to the deque of this worker
+	 * Parameter:   [in] void* args - not used
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_steal_root_task(void* args)
+{
+	int i = 0;
+
+	g_root_thread = pthread_self();
+
+	for (i = 0; i < GSI_TPT_STEAL_TASKS; ++i)
+	{
+		if (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add(g_p_pool, gsi_tpt_steal_task, NULL))
+		{
+			__atomic_add_fetch(&g_l_bad, 1, __ATOMIC_RELAXED);
+		}
+	}
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_steal_task
+	 * Description: Take a while, count the task and whether another worker ran it
+	 * Parameter:   [in] void* args - not used
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_steal_task(void* args)
+{
+	usleep(1000);
+
+	if (!pthread_equal(g_root_thread, pthread_self()))
+	{
+		__atomic_add_fetch(&g_l_sum, 1, __ATOMIC_RELAXED);
+	}
+
+	__atomic_add_fetch(&g_l_done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_gate_task
+	 * Description: Count the held worker and hold it until the test opens the gate
+	 * Parameter:   [in] void* args - not used
+	 * Return:		NULL
+#############################################################################*/
+static void* gsi_tpt_gate_task(void* args)
+{
+	__atomic_add_fetch(&g_i_held, 1, __ATOMIC_RELEASE);
+
+	while (0 == __atomic_load_n(&g_i_gate, __ATOMIC_ACQUIRE))
+	{
+		usleep(1000);
+	}
+
+	return NULL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_hold_worker
+	 * Description: Add a gate task and wait until a worker runs it (its cell is free)
+	 * Return:		None
+#############################################################################*/
+static void gsi_tpt_hold_worker()
+{
+	__atomic_store_n(&g_i_held, 0, __ATOMIC_RELEASE);
+
+	while (GSI_TP_RC_SUCCESS != gsi_is_thread_pool_add(g_p_pool, gsi_tpt_gate_task, NULL))
+	{
+		sched_yield();
+	}
+
+	while (0 == __atomic_load_n(&g_i_held, __ATOMIC_ACQUIRE))
+	{
+		usleep(1000);
+	}
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_wait_value
+	 * Description: Wait until a counter of the pool or the tests has a value
+	 * Parameter:   [in] int* p_value - counter
+	 * Parameter:   [in] int i_expected - value to wait for
+	 * Parameter:   [in] int i_msecs - max wait
+	 * Return:		GSI_TPT_PASS *OR* GSI_TPT_FAIL (timeout)
+#############################################################################*/
+static int gsi_tpt_wait_value(int* p_value, int i_expected, int i_msecs)
+{
+	while (i_expected != __atomic_load_n(p_value, __ATOMIC_ACQUIRE))
+	{
+		if (0 > --i_msecs)
+		{
+			return GSI_TPT_FAIL;
+		}
+
+		usleep(1000);
+	}
+
+	return GSI_TPT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_now_ms
+	 * Description: Monotonic time in milliseconds
+	 * Return:		time
+#############################################################################*/
+static long long gsi_tpt_now_ms()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/*###########################################################################
+	 * Name:		gsi_tpt_reset
+	 * Description: Reset the counters of the tests
+	 * Return:		None
+#############################################################################*/
+static void gsi_tpt_reset()
+{
+	g_p_pool = NULL;
+	g_l_done = 0;
+	g_l_sum = 0;
+	g_l_bad = 0;
+	g_i_gate = 0;
+	g_i_held = 0;
+	g_i_add_rc = -1;
+	memset(g_a_then, 0, sizeof(g_a_then));
+}
@@ -0,0 +1,578 @@
+/**************************************************************************
+* Name : gsi_timer_wheel_test.c
+* Author : Guy Cohen Zedek
+* Version : 1.0.0
+* Description : Tests of the hierarchical timer wheel (gsi_is_timer_wheel.h), on a
+* 				time of the test (no clock, no sleep):
+* 				insert  - level and slot of a deadline, passed deadline, tick rounded up
+* 				clamp 	- deadline past GSI_TW_LEVEL_SLOTS^GSI_TW_LEVELS ticks waits in the
+* 						  last slot and fires once at its deadline
+* 				cascade - a timer goes down a level when its slot is reached
+* 				next 	- gsi_tw_next_ms() of no timers, passed, level 0 and upper levels
+* 				cancel 	- canceled timer doesn't fire, moved timer fires at its new deadline
+* 				levels  - timers of all levels (and past the wheel), some set again when
+* 						  they fire, each fires once at the start of the tick of its
+* 						  deadline when the wait is gsi_tw_next_ms()
+* 				Usage : ./<a.out> (exit code - number of failed tests)
+*****************************************************************************/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gsi_is_timer_wheel.h"
+
+/* Defines and Macros */
+#define 	GSI_TWT_PASS			0
+#define 	GSI_TWT_FAIL			1
+#define 	GSI_TWT_WHEEL_TICKS		(1LL << (GSI_TW_LEVEL_BITS * GSI_TW_LEVELS))
+#define 	GSI_TWT_TIMERS			3000
+#define 	GSI_TWT_TICK_MSECS		10
+#define 	GSI_TWT_START_MS		123457				/* not a start of a tick */
+#define 	GSI_TWT_MAX_WAITS		(8 * GSI_TWT_WHEEL_TICKS / GSI_TW_LEVEL_SLOTS)
+
+/* Structures */
+/*****************************************************************************
+ * Name : gsi_twt_timer
+ * Used by: tests of the wheel
+ * Members:
+ *----------------------------------------------------------------------------
+ *		struct gsi_tw_timer timer - timer of the wheel (its p_data is this)
+ *----------------------------------------------------------------------------
+ *		long long ll_deadline_ms - deadline it was set to
+ *----------------------------------------------------------------------------
+ *		int i_armed - set and didn't fire yet
+ *----------------------------------------------------------------------------
+ *		int i_again - set again when it fires (0 - no)
+ *****************************************************************************/
+struct gsi_twt_timer
+{
+	struct gsi_tw_timer timer;
+	long long ll_deadline_ms;
+	int i_armed;
+	int i_again;
+};
+
+/*****************************************************************************
+ * Name : gsi_twt_run
+ * Used by: gsi_twt_on_expire() - argument of gsi_tw_expire()
+ * Members:
+ *----------------------------------------------------------------------------
+ *		struct gsi_timer_wheel* p_wheel - wheel of the test
+ *----------------------------------------------------------------------------
+ *		long long ll_now_ms - time of the test
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_fired - timers that fired
+ *----------------------------------------------------------------------------
+ *		unsigned int ui_errors - timers that fired twice, early or late
+ *****************************************************************************/
+struct gsi_twt_run
+{
+	struct gsi_timer_wheel* p_wheel;
+	long long ll_now_ms;
+	unsigned int ui_fired;
+	unsigned int ui_errors;
+};
+
+/* Global variables */
+static struct gsi_timer_wheel g_wheel;
+static struct gsi_twt_timer g_a_timers[GSI_TWT_TIMERS];
+static unsigned long long g_ull_seed = 88172645463325252ULL;
+
+/********************************/
+/* Static functions declaration */
+/********************************/
+static unsigned long long gsi_twt_random();
+static long long gsi_twt_tick_start(long long ll_deadline_ms, unsigned int ui_tick_msecs);
+static int gsi_twt_in_slot(unsigned int ui_level, unsigned int ui_slot, const struct gsi_tw_timer* p_timer);
+static void gsi_twt_set(struct gsi_twt_timer* p_timer, long long ll_deadline_ms);
+static void gsi_twt_on_expire(struct gsi_tw_timer* p_timer, void* p_arg);
+static int gsi_twt_expire_to(struct gsi_twt_run* p_run, long long ll_now_ms, unsigned int ui_fired);
+static int gsi_twt_insert();
+static int gsi_twt_clamp();
+static int gsi_twt_cascade();
+static int gsi_twt_next();
+static int gsi_twt_cancel();
+static int gsi_twt_levels();
+
+int main(int argc, char **argv)
+{
+	int i_failed = 0;
+	int i = 0;
+
+	struct
+	{
+		const char* s_name;
+		int (*f_test)();
+	} a_tests[] = {
+		{ "insert", gsi_twt_insert },
+		{ "clamp", gsi_twt_clamp },
+		{ "cascade", gsi_twt_cascade },
+		{ "next", gsi_twt_next },
+		{ "cancel", gsi_twt_cancel },
+		{ "levels", gsi_twt_levels }
+	};
+
+	for (i = 0; i < (int)(sizeof(a_tests) / sizeof(a_tests[0])); ++i)
+	{
+		if (GSI_TWT_PASS == a_tests[i].f_test())
+		{
+			printf("%-8s PASS\n", a_tests[i].s_name);
+		}
+		else
+		{
+			printf("%-8s FAIL\n", a_tests[i].s_name);
+			++i_failed;
+		}
+	}
+
+	return i_failed;
+}
+
+/***********************************/
+/* Static functions implementation */
+/***********************************/
+/*###########################################################################
+	 * Name:		gsi_twt_insert
+	 * Description: Deadline in the next GSI_TW_LEVEL_SLOTS ticks is in level 0, further
+	 * 				ones in the level their distance fits in, at the slot of their tick
+	 * 				in that level. Deadline inside a tick goes to the next tick, passed
+	 * 				deadline to the first tick not taken yet.
+	 * Return:		GSI_TWT_PASS *OR* GSI_TWT_FAIL
+#############################################################################*/
+static int gsi_twt_insert()
+{
+	struct
+	{
+		long long ll_deadline_ms;
+		unsigned int ui_level;
+		unsigned int ui_slot;
+	} a_cases[] = {
+		{ 1, 0, 1 },								// next tick
+		{ -5, 0, 1 },								// passed
+		{ 64, 0, 0 },								// last tick of level 0
+		{ 65, 1, 1 },
+		{ 4096, 1, 0 },								// last tick of level 1
+		{ 4097, 2, 1 },
+		{ 262145, 3, 1 },
+		{ GSI_TWT_WHEEL_TICKS, 3, 0 }				// last tick of the wheel
+	};
+	struct gsi_twt_timer timer;
+	int i = 0;
+
+	for (i = 0; i < (int)(sizeof(a_cases) / sizeof(a_cases[0])); ++i)
+	{
+		memset(&timer, 0, sizeof(timer));
+		gsi_tw_init(&g_wheel, 1, 0);
+		gsi_twt_set(&timer, a_cases[i].ll_deadline_ms);
+
+		if ((a_cases[i].ui_level != timer.timer.ui_level) ||
+			!gsi_twt_in_slot(a_cases[i].ui_level, a_cases[i].ui_slot, &timer.timer) ||
+			(1 != g_wheel.ui_timers) || (1 != g_wheel.a_level_timers[a_cases[i].ui_level]))
+		{
+			printf("insert: deadline %lld is in level %u, expected slot %u of level %u\n",
+				   a_cases[i].ll_deadline_ms, timer.timer.ui_level, a_cases[i].ui_slot, a_cases[i].ui_level);
+			return GSI_TWT_FAIL;
+		}
+	}
+
+	// Ticks of 10 ms from 1005 (tick 100 is taken) - 1011 is in tick 102, 1010 in tick 101
+	memset(&timer, 0, sizeof(timer));
+	gsi_tw_init(&g_wheel, 10, 1005);
+	gsi_twt_set(&timer, 1011);
+	if (!gsi_twt_in_slot(0, 102 & GSI_TW_LEVEL_MASK, &timer.timer))
+	{
+		printf("insert: deadline inside a tick is not in the next tick\n");
+		return GSI_TWT_FAIL;
+	}
+
+	gsi_twt_set(&timer, 1010);
+	if (!gsi_twt_in_slot(0, 101 & GSI_TW_LEVEL_MASK, &timer.timer) || (1 != g_wheel.ui_timers))
+	{
+		printf("insert: moved timer is not in the tick of its deadline\n");
+		return GSI_TWT_FAIL;
+	}
+
+	return GSI_TWT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_twt_clamp
+	 * Description: Deadline three wheels away is kept in the last slot of the last
+	 * 				level, set again each time it is reached, and fires once - at the
+	 * 				start of its tick, not at the end of the first wheel.
+	 * Return:		GSI_TWT_PASS *OR* GSI_TWT_FAIL
+#############################################################################*/
+static int gsi_twt_clamp()
+{
+	struct gsi_twt_run run = { &g_wheel, 0, 0, 0 };
+	struct gsi_twt_timer* p_timer = &g_a_timers[0];
+	long long ll_deadline_ms = 3 * GSI_TWT_WHEEL_TICKS + 17;
+
+	memset(p_timer, 0, sizeof(*p_timer));
+	gsi_tw_init(&g_wheel, 1, 0);
+	gsi_twt_set(p_timer, ll_deadline_ms);
+
+	if ((GSI_TW_LEVELS - 1 != p_timer->timer.ui_level) ||
+		!gsi_twt_in_slot(GSI_TW_LEVELS - 1, (GSI_TWT_WHEEL_TICKS >> (GSI_TW_LEVEL_BITS * (GSI_TW_LEVELS - 1))) & GSI_TW_LEVEL_MASK,
+						 &p_timer->timer))
+	{
+		printf("clamp: deadline past the wheel is not in the last slot of level %u\n", GSI_TW_LEVELS - 1);
+		return GSI_TWT_FAIL;
+	}
+
+	// Each wheel that passes sets it again, until it is in reach
+	if ((GSI_TWT_PASS != gsi_twt_expire_to(&run, GSI_TWT_WHEEL_TICKS, 0)) ||
+		(GSI_TWT_PASS != gsi_twt_expire_to(&run, 2 * GSI_TWT_WHEEL_TICKS + 1, 0)) ||
+		(GSI_TWT_PASS != gsi_twt_expire_to(&run, ll_deadline_ms - 1, 0)) ||
+		(GSI_TWT_PASS != gsi_twt_expire_to(&run, ll_deadline_ms, 1)) ||
+		(GSI_TWT_PASS != gsi_twt_expire_to(&run, 5 * GSI_TWT_WHEEL_TICKS, 1)))
+	{
+		printf("clamp: deadline %lld fired %u times by %lld\n", ll_deadline_ms, run.ui_fired, run.ll_now_ms);
+		return GSI_TWT_FAIL;
+	}
+
+	return (0 == run.ui_errors) ? GSI_TWT_PASS : GSI_TWT_FAIL;
+}
+
+/*###########################################################################
+	 * Name:		gsi_twt_cascade
+	 * Description: Timer of level 2 goes to level 1 when its slot of level 2 is reached,
+	 * 				to level 0 when its slot of level 1 is reached, and fires at its tick.
+	 * Return:		GSI_TWT_PASS *OR* GSI_TWT_FAIL
+#############################################################################*/
+static int gsi_twt_cascade()
+{
+	struct gsi_twt_run run = { &g_wheel, 0, 0, 0 };
+	struct gsi_twt_timer* p_timer = &g_a_timers[0];
+
+	memset(p_timer, 0, sizeof(*p_timer));
+	gsi_tw_init(&g_wheel, 1, 0);
+	gsi_twt_set(p_timer, 5000);
+
+	// 5000 - slot 1 of level 2 (ticks 4096-8191), slot 14 of level 1 (ticks 4992-5055)
+	if ((GSI_TWT_PASS != gsi_twt_expire_to(&run, 4095, 0)) || (2 != p_timer->timer.ui_level))
+	{
+		printf("cascade: timer left level 2 before its slot\n");
+		return GSI_TWT_FAIL;
+	}
+
+	if ((GSI_TWT_PASS != gsi_twt_expire_to(&run, 4096, 0)) || !gsi_twt_in_slot(1, 14, &p_timer->timer) ||
+		(0 != g_wheel.a_level_timers[2]) || (1 != g_wheel.a_level_timers[1]))
+	{
+		printf("cascade: timer is not in slot 14 of level 1 after the cascade of level 2\n");
+		return GSI_TWT_FAIL;
+	}
+
+	if ((GSI_TWT_PASS != gsi_twt_expire_to(&run, 4991, 0)) || (1 != p_timer->timer.ui_level) ||
+		(GSI_TWT_PASS != gsi_twt_expire_to(&run, 4992, 0)) || !gsi_twt_in_slot(0, 5000 & GSI_TW_LEVEL_MASK, &p_timer->timer))
+	{
+		printf("cascade: timer is not in level 0 after the cascade of level 1\n");
+		return GSI_TWT_FAIL;
+	}
+
+	if ((GSI_TWT_PASS != gsi_twt_expire_to(&run, 4999, 0)) || (GSI_TWT_PASS != gsi_twt_expire_to(&run, 5000, 1)) ||
+		(0 != g_wheel.ui_timers) || (0 != run.ui_errors))
+	{
+		printf("cascade: timer fired %u times by %lld\n", run.ui_fired, run.ll_now_ms);
+		return GSI_TWT_FAIL;
+	}
+
+	return GSI_TWT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_twt_next
+	 * Description: No timers - -1. A timer of level 0 - time to the start of its tick.
+	 * 				Timers of upper levels only - time to the next cascade (never after
+	 * 				the deadline). Passed deadline (expire is late) - 0.
+	 * Return:		GSI_TWT_PASS *OR* GSI_TWT_FAIL
+#############################################################################*/
+static int gsi_twt_next()
+{
+	struct gsi_twt_timer* p_near = &g_a_timers[0];
+	struct gsi_twt_timer* p_far = &g_a_timers[1];
+	long long ll_next_ms = 0;
+
+	memset(p_near, 0, sizeof(*p_near));
+	memset(p_far, 0, sizeof(*p_far));
+
+	// Ticks of 10 ms, 1005 is inside tick 100
+	gsi_tw_init(&g_wheel, 10, 1005);
+	if (-1 != gsi_tw_next_ms(&g_wheel, 1005))
+	{
+		printf("next: empty wheel has a next time\n");
+		return GSI_TWT_FAIL;
+	}
+
+	// Deadline 1234 - tick 124 starts at 1240
+	gsi_twt_set(p_near, 1234);
+	ll_next_ms = gsi_tw_next_ms(&g_wheel, 1007);
+	if (1240 - 1007 != ll_next_ms)
+	{
+		printf("next: %lld ms to the tick of a deadline of level 0, expected %d\n", ll_next_ms, 1240 - 1007);
+		return GSI_TWT_FAIL;
+	}
+
+	// Deadline of level 2 - wake up for the cascade at tick 128 first
+	gsi_tw_cancel(&g_wheel, &p_near->timer);
+	gsi_twt_set(p_far, 50000);
+	ll_next_ms = gsi_tw_next_ms(&g_wheel, 1007);
+	if (1280 - 1007 != ll_next_ms)
+	{
+		printf("next: %lld ms to the cascade, expected %d\n", ll_next_ms, 1280 - 1007);
+		return GSI_TWT_FAIL;
+	}
+
+	// Level 0 deadline before the cascade is taken first
+	gsi_twt_set(p_near, 1101);
+	ll_next_ms = gsi_tw_next_ms(&g_wheel, 1007);
+	if (1110 - 1007 != ll_next_ms)
+	{
+		printf("next: %lld ms with a deadline before the cascade, expected %d\n", ll_next_ms, 1110 - 1007);
+		return GSI_TWT_FAIL;
+	}
+
+	// Not expired in time
+	if (0 != gsi_tw_next_ms(&g_wheel, 2000))
+	{
+		printf("next: passed deadline has to be expired now\n");
+		return GSI_TWT_FAIL;
+	}
+
+	return GSI_TWT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_twt_cancel
+	 * Description: Canceled timer (of any level) doesn't fire and can be canceled twice,
+	 * 				a moved timer fires only at its new deadline.
+	 * Return:		GSI_TWT_PASS *OR* GSI_TWT_FAIL
+#############################################################################*/
+static int gsi_twt_cancel()
+{
+	struct gsi_twt_run run = { &g_wheel, 0, 0, 0 };
+	int i = 0;
+
+	memset(g_a_timers, 0, 4 * sizeof(g_a_timers[0]));
+	gsi_tw_init(&g_wheel, 1, 0);
+
+	for (i = 0; i < 4; ++i)
+	{
+		gsi_twt_set(&g_a_timers[i], 1LL << (GSI_TW_LEVEL_BITS * i));
+	}
+
+	// Cancel all of levels 0 and 2, move 1 later and 3 earlier
+	gsi_tw_cancel(&g_wheel, &g_a_timers[0].timer);
+	g_a_timers[0].i_armed = 0;
+	gsi_tw_cancel(&g_wheel, &g_a_timers[2].timer);
+	gsi_tw_cancel(&g_wheel, &g_a_timers[2].timer);
+	g_a_timers[2].i_armed = 0;
+	gsi_twt_set(&g_a_timers[1], 300);
+	gsi_twt_set(&g_a_timers[3], 200);
+
+	if ((GSI_TW_RC_INVALID != gsi_tw_cancel(&g_wheel, NULL)) || (2 != g_wheel.ui_timers))
+	{
+		printf("cancel: %u timers are set, expected 2\n", g_wheel.ui_timers);
+		return GSI_TWT_FAIL;
+	}
+
+	if ((GSI_TWT_PASS != gsi_twt_expire_to(&run, 199, 0)) || (GSI_TWT_PASS != gsi_twt_expire_to(&run, 200, 1)) ||
+		(GSI_TWT_PASS != gsi_twt_expire_to(&run, 299, 1)) || (GSI_TWT_PASS != gsi_twt_expire_to(&run, 300, 2)) ||
+		(GSI_TWT_PASS != gsi_twt_expire_to(&run, 2 * GSI_TWT_WHEEL_TICKS, 2)) || (0 != run.ui_errors))
+	{
+		printf("cancel: %u timers fired by %lld\n", run.ui_fired, run.ll_now_ms);
+		return GSI_TWT_FAIL;
+	}
+
+	return GSI_TWT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_twt_levels
+	 * Description: Timers with deadlines spread over all the levels and past the wheel,
+	 * 				a quarter of them set again when they fire. The test waits exactly
+	 * 				gsi_tw_next_ms() each time, like a reactor - so every timer fires
+	 * 				once, at the start of the tick of its deadline (never early, at
+	 * 				most a tick late, and a wait never passes a deadline).
+	 * Return:		GSI_TWT_PASS *OR* GSI_TWT_FAIL
+#############################################################################*/
+static int gsi_twt_levels()
+{
+	struct gsi_twt_run run = { &g_wheel, GSI_TWT_START_MS, 0, 0 };
+	long long ll_ticks = 0;
+	long long ll_next_ms = 0;
+	unsigned int ui_sets = 0;
+	unsigned int ui_past = 0;
+	unsigned int ui_waits = 0;
+	int i = 0;
+
+	memset(g_a_timers, 0, sizeof(g_a_timers));
+	gsi_tw_init(&g_wheel, GSI_TWT_TICK_MSECS, run.ll_now_ms);
+
+	for (i = 0; i < GSI_TWT_TIMERS; ++i)
+	{
+		// Distance of up to 2^1 .. 2^25 ticks - each level, and past the wheel
+		ll_ticks = (long long)(gsi_twt_random() % (1ULL << (1 + i % (GSI_TW_LEVEL_BITS * GSI_TW_LEVELS + 1))));
+		ui_past += (ll_ticks >= GSI_TWT_WHEEL_TICKS);
+
+		g_a_timers[i].i_again = (0 == i % 4);
+		gsi_twt_set(&g_a_timers[i], run.ll_now_ms + ll_ticks * GSI_TWT_TICK_MSECS + (long long)(gsi_twt_random() % 23));
+		++ui_sets;
+	}
+
+	ui_sets += GSI_TWT_TIMERS / 4;
+
+	if (0 == ui_past)
+	{
+		printf("levels: no deadline is past the wheel\n");
+		return GSI_TWT_FAIL;
+	}
+
+	while (-1 != (ll_next_ms = gsi_tw_next_ms(&g_wheel, run.ll_now_ms)))
+	{
+		if (GSI_TWT_MAX_WAITS < ++ui_waits)
+		{
+			printf("levels: %u timers are left after %u waits\n", g_wheel.ui_timers, ui_waits);
+			return GSI_TWT_FAIL;
+		}
+
+		run.ll_now_ms += ll_next_ms;
+		gsi_tw_expire(&g_wheel, run.ll_now_ms, gsi_twt_on_expire, &run);
+	}
+
+	for (i = 0; i < GSI_TWT_TIMERS; ++i)
+	{
+		if (g_a_timers[i].i_armed || g_a_timers[i].i_again)
+		{
+			printf("levels: timer %d didn't fire\n", i);
+			return GSI_TWT_FAIL;
+		}
+	}
+
+	if ((ui_sets != run.ui_fired) || (0 != run.ui_errors))
+	{
+		printf("levels: %u of %u timers fired, %u errors\n", run.ui_fired, ui_sets, run.ui_errors);
+		return GSI_TWT_FAIL;
+	}
+
+	return GSI_TWT_PASS;
+}
+
+/*###########################################################################
+	 * Name:		gsi_twt_random
+	 * Description: Pseudo random numbers of a fixed seed (xorshift) - same run each time
+	 * Return:		Random number
+#############################################################################*/
+static unsigned long long gsi_twt_random()
+{
+	g_ull_seed ^= g_ull_seed << 13;
+	g_ull_seed ^= g_ull_seed >> 7;
+	g_ull_seed ^= g_ull_seed << 17;
+
+	return g_ull_seed;
+}
+
+/*###########################################################################
+	 * Name:		gsi_twt_tick_start
+	 * Description: Start of the first tick that starts at the deadline or after it
+	 * Parameter:   [in] long long ll_deadline_ms - deadline
+	 * Parameter:   [in] unsigned int ui_tick_msecs - milliseconds of tick
+	 * Return:		Milliseconds
+#############################################################################*/
+static long long gsi_twt_tick_start(long long ll_deadline_ms, unsigned int ui_tick_msecs)
+{
+	return (ll_deadline_ms + ui_tick_msecs - 1) / ui_tick_msecs * ui_tick_msecs;
+}
+
+/*###########################################################################
+	 * Name:		gsi_twt_in_slot
+	 * Description: Check that timer is in the list of slot
+	 * Parameter:   [in] unsigned int ui_level - level of slot
+	 * Parameter:   [in] unsigned int ui_slot - slot
+	 * Parameter:   [in] const struct gsi_tw_timer* p_timer - timer
+	 * Return:		1 - in the slot, 0 - not
+#############################################################################*/
+static int gsi_twt_in_slot(unsigned int ui_level, unsigned int ui_slot, const struct gsi_tw_timer* p_timer)
+{
+	const struct gsi_tw_timer* p_head = &g_wheel.a_slots[ui_level][ui_slot];
+	const struct gsi_tw_timer* p_node = NULL;
+
+	for (p_node = p_head->p_next; p_node != p_head; p_node = p_node->p_next)
+	{
+		if (p_node == p_timer)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*###########################################################################
+	 * Name:		gsi_twt_set
+	 * Description: Set timer of the test in g_wheel
+	 * Parameter:   [in] struct gsi_twt_timer* p_timer - timer
+	 * Parameter:   [in] long long ll_deadline_ms - deadline
+	 * Return:		None
+#############################################################################*/
+static void gsi_twt_set(struct gsi_twt_timer* p_timer, long long ll_deadline_ms)
+{
+	p_timer->timer.p_data = p_timer;
+	p_timer->ll_deadline_ms = ll_deadline_ms;
+	p_timer->i_armed = 1;
+	gsi_tw_set(&g_wheel, &p_timer->timer, ll_deadline_ms);
+}
+
+/*###########################################################################
+	 * Name:		gsi_twt_on_expire
+	 * Description: Expire function of the tests - counts the timer, and an error if it
+	 * 				wasn't set or it isn't the start of the tick of its deadline.
+	 * 				A timer to set again gets a deadline 1 to 2^20 ticks from now.
+	 * Parameter:   [in] struct gsi_tw_timer* p_timer - expired timer
+	 * Parameter:   [in] void* p_arg - struct gsi_twt_run of the test
+	 * Return:		None
+#############################################################################*/
+static void gsi_twt_on_expire(struct gsi_tw_timer* p_timer, void* p_arg)
+{
+	struct gsi_twt_run* p_run = (struct gsi_twt_run*)p_arg;
+	struct gsi_twt_timer* p_test = (struct gsi_twt_timer*)p_timer->p_data;
+	long long ll_due_ms = gsi_twt_tick_start(p_test->ll_deadline_ms, p_run->p_wheel->ui_tick_msecs);
+
+	++p_run->ui_fired;
+
+	if (!p_test->i_armed)
+	{
+		printf("timer of deadline %lld fired again at %lld\n", p_test->ll_deadline_ms, p_run->ll_now_ms);
+		++p_run->ui_errors;
+	}
+	else if (ll_due_ms != p_run->ll_now_ms)
+	{
+		printf("timer of deadline %lld fired at %lld, expected %lld\n", p_test->ll_deadline_ms, p_run->ll_now_ms, ll_due_ms);
+		++p_run->ui_errors;
+	}
+
+	p_test->i_armed = 0;
+
+	if (p_test->i_again)
+	{
+		p_test->i_again = 0;
+		gsi_twt_set(p_test, p_run->ll_now_ms + (long long)(1 + gsi_twt_random() % (1ULL << 20)) * p_run->p_wheel->ui_tick_msecs);
+	}
+}
+
+/*###########################################################################
+	 * Name:		gsi_twt_expire_to
+	 * Description: Expire g_wheel at time, and check the number of timers fired until it
+	 * Parameter:   [in] struct gsi_twt_run* p_run - run of the test
+	 * Parameter:   [in] long long ll_now_ms - time
+	 * Parameter:   [in] unsigned int ui_fired - timers that should have fired by then
+	 * Return:		GSI_TWT_PASS *OR* GSI_TWT_FAIL
+#############################################################################*/
+static int gsi_twt_expire_to(struct gsi_twt_run* p_run, long long ll_now_ms, unsigned int ui_fired)
+{
+	p_run->ll_now_ms = ll_now_ms;
+	gsi_tw_expire(p_run->p_wheel, ll_now_ms, gsi_twt_on_expire, p_run);
+
+	return ((ui_fired == p_run->ui_fired) && (0 == p_run->ui_errors)) ? GSI_TWT_PASS : GSI_TWT_FAIL;
+}